@@ -0,0 +1,67 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#pragma once
+
+// Fixtures shared by the refined API's orbit tests
+
+// Standard WGS-84 value (km^3/s^2)
+inline const FSMassConstant EarthGM(398600.4418);
+
+// State propagated dt seconds on a conic, by prop2b
+inline FSStateVector TwoBody(const FSStateVector& State, double dt, const FSMassConstant& GM = EarthGM)
+{
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    FSStateVector Result;
+    USpice::prop2b(ResultCode, ErrorMessage, GM, State, FSEphemerisPeriod(dt), Result);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    return Result;
+}
+
+inline void ExpectNear(const FSStateVector& Actual, const double(&Expected)[6], double PositionTolerance, double VelocityTolerance)
+{
+    double a[6];
+    Actual.CopyTo(a);
+    for (int i = 0; i < 6; ++i)
+    {
+        EXPECT_NEAR(a[i], Expected[i], i < 3 ? PositionTolerance : VelocityTolerance);
+    }
+}
+
+inline void ExpectNear(const FSStateVector& Actual, const FSStateVector& Expected, double PositionTolerance, double VelocityTolerance)
+{
+    double e[6];
+    Expected.CopyTo(e);
+    ExpectNear(Actual, e, PositionTolerance, VelocityTolerance);
+}
+
+// Velocities to a thousandth of the position tolerance
+inline void ExpectNear(const FSStateVector& Actual, const FSStateVector& Expected, double Tolerance)
+{
+    ExpectNear(Actual, Expected, Tolerance, Tolerance * 1e-3);
+}
+
+// getelm's elements: degrees and revolutions/day in, radians and
+// radians/minute out
+inline FSTwoLineElements TleElements(double Epoch, double Inclination, double Node, double Eccentricity, double Perigee, double MeanAnomaly, double MeanMotion, double Bstar = 0.)
+{
+    const double r = UE_DOUBLE_PI / 180.;
+    double elems[10] = { 0., 0., Bstar, Inclination * r, Node * r, Eccentricity, Perigee * r, MeanAnomaly * r, MeanMotion * 2. * UE_DOUBLE_PI / 1440., Epoch };
+    return FSTwoLineElements(elems);
+}
+
+// Greenwich mean sidereal time (IAU 1982), from UTC
+inline double Gmst(double et)
+{
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    FSEphemerisPeriod delta;
+    USpice::deltet(ResultCode, ErrorMessage, et, ES_EpochType::ET, delta);
+    const double T = (et - delta.seconds) / 86400. / 36525.;
+    return FMath::Fmod(67310.54841 + (876600. * 3600. + 8640184.812866) * T + 0.093104 * T * T - 6.2e-6 * T * T * T, 86400.) * 2. * UE_DOUBLE_PI / 86400.;
+}
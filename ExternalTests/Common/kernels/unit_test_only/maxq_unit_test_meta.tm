@@ -15,6 +15,7 @@ Unreal Engine 5.
        KERNELS_TO_LOAD = (  'maxq_unit_test_lsk.tls'
                             'maxq_unit_test_fk.tf'
                             'maxq_unit_test_pck.tpc'
-                            'maxq_unit_test_spk.bsp'  )
+                            'maxq_unit_test_spk.bsp'
+                            'maxq_unit_test_sclk.tsc'  )
         \begintext
 
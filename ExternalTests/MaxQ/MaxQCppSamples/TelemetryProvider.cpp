@@ -0,0 +1,347 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "TelemetryProvider.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Misc/QueuedThreadPool.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace MaxQSamples;
+
+namespace
+{
+    const char* FixtureDirectory = "maxq_telemetry_test";
+
+    const char* Iss[3] = {
+        "ISS (ZARYA)",
+        "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+        "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537" };
+    const char* Vanguard[3] = {
+        "0 VANGUARD 1",
+        "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+        "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667" };
+    const char* Molniya[2] = {
+        "1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813",
+        "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656" };
+
+    // The ISS, with its line 2 checksum off by one
+    const char* BadChecksum[2] = {
+        "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+        "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563538" };
+
+    // Everything a request's callback was called with
+    struct FCompletion
+    {
+        int32 Count = 0;
+        bool bSuccess = false;
+        TArray<FString> ObjectIds;
+        FString Telemetry;
+    };
+
+    FTelemetryBatchCallback Record(FCompletion& Completion)
+    {
+        return FTelemetryBatchCallback::CreateLambda([&Completion](bool bSuccess, const TArray<FString>& ObjectIds, const FString& Telemetry)
+        {
+            EXPECT_TRUE(IsInGameThread());
+            ++Completion.Count;
+            Completion.bSuccess = bSuccess;
+            Completion.ObjectIds = ObjectIds;
+            Completion.Telemetry = Telemetry;
+        });
+    }
+
+    // Runs game thread tasks until every completion has been called, or a
+    // few seconds have passed.  Then once more, to catch a second call.
+    bool Wait(std::initializer_list<const FCompletion*> Completions)
+    {
+        auto Done = [&]()
+        {
+            for (const FCompletion* Completion : Completions)
+            {
+                if (Completion->Count == 0) return false;
+            }
+            return true;
+        };
+
+        for (int i = 0; i < 500 && !Done(); ++i)
+        {
+            FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+            if (!Done()) FPlatformProcess::Sleep(0.01f);
+        }
+
+        FPlatformProcess::Sleep(0.05f);
+        FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+        return Done();
+    }
+
+    // The 3LE text the local provider serves for a TLE
+    FString Served(const char* Name, const char* Line1, const char* Line2)
+    {
+        return FString(Name) + TEXT("\r\n") + Line1 + TEXT("\r\n") + Line2 + TEXT("\r\n");
+    }
+
+    int32 Occurrences(const FString& Text, const FString& Part)
+    {
+        int32 Count = 0;
+        for (int32 i = Text.Find(Part, ESearchCase::CaseSensitive); i != INDEX_NONE; i = Text.Find(Part, ESearchCase::CaseSensitive, ESearchDir::FromStart, i + 1))
+        {
+            ++Count;
+        }
+        return Count;
+    }
+
+    void WriteFile(const std::filesystem::path& Path, const std::string& Text)
+    {
+        std::ofstream File(Path, std::ios::binary);
+        File << Text;
+    }
+
+    // stations.txt: the ISS and Vanguard, as 3LEs.
+    // other.tle: Molniya as a 2LE, and the ISS with a bad checksum.
+    // notes.md: not a TLE file.
+    FString WriteFixture()
+    {
+        std::filesystem::remove_all(FixtureDirectory);
+        std::filesystem::create_directory(FixtureDirectory);
+
+        const std::filesystem::path Directory(FixtureDirectory);
+        WriteFile(Directory / "stations.txt",
+            std::string(Iss[0]) + "\r\n" + Iss[1] + "\r\n" + Iss[2] + "\r\n" +
+            Vanguard[0] + "\r\n" + Vanguard[1] + "\r\n" + Vanguard[2] + "\r\n");
+        WriteFile(Directory / "other.tle",
+            std::string(Molniya[0]) + "\n" + Molniya[1] + "\n" + BadChecksum[0] + "\n" + BadChecksum[1] + "\n");
+        WriteFile(Directory / "notes.md", std::string(Iss[0]) + "\n" + Iss[1] + "\n" + Iss[2] + "\n");
+
+        // Absolute, as relative paths are relative to the project's content
+        return FString(std::filesystem::absolute(Directory).string().c_str());
+    }
+}
+
+
+class MaxQTelemetryProviderTest : public testing::Test
+{
+protected:
+    // Requests complete on game thread tasks, and the local provider reads
+    // and serves on the thread pool, so both have to be running.
+    static void SetUpTestSuite()
+    {
+        if (!FTaskGraphInterface::IsRunning())
+        {
+            FTaskGraphInterface::Startup(FPlatformMisc::NumberOfCores());
+            FTaskGraphInterface::Get().AttachToThread(ENamedThreads::GameThread);
+        }
+
+        if (!GThreadPool)
+        {
+            GThreadPool = FQueuedThreadPool::Allocate();
+            GThreadPool->Create(4, 128 * 1024);
+        }
+    }
+
+    void SetUp() override
+    {
+        USpice::init_all();
+        USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(FixtureDirectory);
+    }
+};
+
+
+TEST_F(MaxQTelemetryProviderTest, Mock_Batch) {
+    FMockTelemetryProvider Mock;
+    Mock.Responses.Add(TEXT("CATNR=25544"), TEXT("ISS\r\n"));
+    Mock.Responses.Add(TEXT("GROUP=STATIONS"), TEXT("STATIONS\r\n"));
+
+    // One completion for the batch, never from inside Fetch
+    FCompletion Completion;
+    Mock.Fetch({ TEXT("CATNR=25544"), TEXT("GROUP=STATIONS") }, TEXT("TLE"), Record(Completion));
+    EXPECT_EQ(Completion.Count, 0);
+
+    EXPECT_TRUE(Wait({ &Completion }));
+    EXPECT_EQ(Completion.Count, 1);
+    EXPECT_TRUE(Completion.bSuccess);
+    EXPECT_EQ(Completion.ObjectIds, TArray<FString>({ TEXT("CATNR=25544"), TEXT("GROUP=STATIONS") }));
+    EXPECT_TRUE(Completion.Telemetry == TEXT("ISS\r\nSTATIONS\r\n"));
+    EXPECT_EQ(Mock.NumRequests, 1);
+
+    // Two batches, two completions
+    FCompletion First, Second;
+    Mock.Fetch({ TEXT("CATNR=25544") }, TEXT("TLE"), Record(First));
+    Mock.Fetch({ TEXT("GROUP=STATIONS") }, TEXT("TLE"), Record(Second));
+    EXPECT_TRUE(Wait({ &First, &Second }));
+    EXPECT_EQ(First.Count, 1);
+    EXPECT_EQ(Second.Count, 1);
+    EXPECT_TRUE(First.Telemetry == TEXT("ISS\r\n"));
+    EXPECT_TRUE(Second.Telemetry == TEXT("STATIONS\r\n"));
+    EXPECT_EQ(Mock.NumRequests, 3);
+}
+
+
+TEST_F(MaxQTelemetryProviderTest, Mock_Failures) {
+    FMockTelemetryProvider Mock;
+    Mock.Responses.Add(TEXT("CATNR=25544"), TEXT("ISS\r\n"));
+
+    // Any missing ID fails the whole batch
+    FCompletion Missing;
+    Mock.Fetch({ TEXT("CATNR=25544"), TEXT("CATNR=99999") }, TEXT("TLE"), Record(Missing));
+    EXPECT_TRUE(Wait({ &Missing }));
+    EXPECT_EQ(Missing.Count, 1);
+    EXPECT_FALSE(Missing.bSuccess);
+    EXPECT_EQ(Missing.ObjectIds.Num(), 2);
+    EXPECT_FALSE(Missing.Telemetry.Contains(TEXT("ISS")));
+
+    FCompletion None;
+    Mock.Fetch({}, TEXT("TLE"), Record(None));
+    EXPECT_TRUE(Wait({ &None }));
+    EXPECT_EQ(None.Count, 1);
+    EXPECT_FALSE(None.bSuccess);
+
+    Mock.bFail = true;
+    FCompletion Failed;
+    Mock.Fetch({ TEXT("CATNR=25544") }, TEXT("TLE"), Record(Failed));
+    EXPECT_EQ(Failed.Count, 0);
+    EXPECT_TRUE(Wait({ &Failed }));
+    EXPECT_EQ(Failed.Count, 1);
+    EXPECT_FALSE(Failed.bSuccess);
+    EXPECT_EQ(Mock.NumRequests, 3);
+}
+
+
+TEST_F(MaxQTelemetryProviderTest, Mock_Global) {
+    TSharedRef<FMockTelemetryProvider> Mock = MakeShared<FMockTelemetryProvider>();
+    SetTelemetryProvider(Mock);
+    EXPECT_TRUE(&GetTelemetryProvider().Get() == &Mock.Get());
+
+    // Null restores CelesTrak
+    SetTelemetryProvider(nullptr);
+    EXPECT_TRUE(&GetTelemetryProvider().Get() != &Mock.Get());
+}
+
+
+TEST_F(MaxQTelemetryProviderTest, Local_Queries) {
+    TSharedRef<FLocalTelemetryProvider> Local = MakeShared<FLocalTelemetryProvider>(WriteFixture());
+
+    // Both wait on the same load
+    FCompletion Catnr, Group;
+    Local->Fetch({ TEXT("CATNR=25544") }, TEXT("TLE"), Record(Catnr));
+    Local->Fetch({ TEXT("GROUP=stations") }, TEXT("TLE"), Record(Group));
+    EXPECT_EQ(Catnr.Count, 0);
+    EXPECT_EQ(Group.Count, 0);
+
+    EXPECT_TRUE(Wait({ &Catnr, &Group }));
+    EXPECT_EQ(Catnr.Count, 1);
+    EXPECT_TRUE(Catnr.bSuccess);
+    EXPECT_TRUE(Catnr.Telemetry == Served(Iss[0], Iss[1], Iss[2]));
+
+    EXPECT_EQ(Group.Count, 1);
+    EXPECT_TRUE(Group.bSuccess);
+    EXPECT_TRUE(Group.Telemetry == Served(Iss[0], Iss[1], Iss[2]) + Served("VANGUARD 1", Vanguard[1], Vanguard[2]));
+
+    // The 2LE's group is its file's name; its bad-checksum ISS is skipped
+    FCompletion Other;
+    Local->Fetch({ TEXT("GROUP=OTHER") }, TEXT("TLE"), Record(Other));
+    EXPECT_EQ(Other.Count, 0);
+    EXPECT_TRUE(Wait({ &Other }));
+    EXPECT_TRUE(Other.bSuccess);
+    EXPECT_EQ(Occurrences(Other.Telemetry, TEXT("\r\n1 ")), 1);
+    EXPECT_TRUE(Other.Telemetry.Contains(Molniya[0]));
+    EXPECT_TRUE(Other.Telemetry.Contains(Molniya[1]));
+
+    FCompletion Name, Intdes;
+    Local->Fetch({ TEXT("NAME=VANGUARD") }, TEXT("TLE"), Record(Name));
+    Local->Fetch({ TEXT("INTDES=1975-081") }, TEXT("TLE"), Record(Intdes));
+    EXPECT_TRUE(Wait({ &Name, &Intdes }));
+    EXPECT_TRUE(Name.bSuccess);
+    EXPECT_TRUE(Name.Telemetry == Served("VANGUARD 1", Vanguard[1], Vanguard[2]));
+    EXPECT_TRUE(Intdes.bSuccess);
+    EXPECT_TRUE(Intdes.Telemetry.Contains(Molniya[1]));
+    EXPECT_FALSE(Intdes.Telemetry.Contains(Iss[1]));
+
+    // Each TLE once, however many IDs match it
+    FCompletion Overlap;
+    Local->Fetch({ TEXT("CATNR=25544"), TEXT("GROUP=STATIONS"), TEXT("NAME=ISS") }, TEXT("TLE"), Record(Overlap));
+    EXPECT_TRUE(Wait({ &Overlap }));
+    EXPECT_EQ(Overlap.Count, 1);
+    EXPECT_EQ(Occurrences(Overlap.Telemetry, Iss[1]), 1);
+    EXPECT_EQ(Occurrences(Overlap.Telemetry, Vanguard[1]), 1);
+}
+
+
+TEST_F(MaxQTelemetryProviderTest, Local_Missing) {
+    TSharedRef<FLocalTelemetryProvider> Local = MakeShared<FLocalTelemetryProvider>(WriteFixture());
+
+    // Unmatched IDs are left out...
+    FCompletion Partial;
+    Local->Fetch({ TEXT("CATNR=25544"), TEXT("CATNR=99999") }, TEXT("TLE"), Record(Partial));
+    EXPECT_TRUE(Wait({ &Partial }));
+    EXPECT_EQ(Partial.Count, 1);
+    EXPECT_TRUE(Partial.bSuccess);
+    EXPECT_EQ(Partial.ObjectIds.Num(), 2);
+    EXPECT_TRUE(Partial.Telemetry == Served(Iss[0], Iss[1], Iss[2]));
+
+    // ...and fail the request only if none matches.  notes.md isn't read.
+    FCompletion Missing;
+    Local->Fetch({ TEXT("CATNR=99999"), TEXT("GROUP=NOTES"), TEXT("BOGUS") }, TEXT("TLE"), Record(Missing));
+    EXPECT_TRUE(Wait({ &Missing }));
+    EXPECT_EQ(Missing.Count, 1);
+    EXPECT_FALSE(Missing.bSuccess);
+
+    FCompletion Format;
+    Local->Fetch({ TEXT("CATNR=25544") }, TEXT("JSON"), Record(Format));
+    EXPECT_EQ(Format.Count, 0);
+    EXPECT_TRUE(Wait({ &Format }));
+    EXPECT_EQ(Format.Count, 1);
+    EXPECT_FALSE(Format.bSuccess);
+
+    // Nothing to read
+    TSharedRef<FLocalTelemetryProvider> Nowhere = MakeShared<FLocalTelemetryProvider>(FString(FixtureDirectory) + TEXT("/missing.tle"));
+    FCompletion Empty;
+    Nowhere->Fetch({ TEXT("CATNR=25544") }, TEXT("TLE"), Record(Empty));
+    EXPECT_TRUE(Wait({ &Empty }));
+    EXPECT_EQ(Empty.Count, 1);
+    EXPECT_FALSE(Empty.bSuccess);
+}
+
+
+TEST_F(MaxQTelemetryProviderTest, Local_Refresh) {
+    WriteFixture();
+    const std::filesystem::path Stations = std::filesystem::path(FixtureDirectory) / "stations.txt";
+    TSharedRef<FLocalTelemetryProvider> Local = MakeShared<FLocalTelemetryProvider>(FString(std::filesystem::absolute(Stations).string().c_str()));
+
+    FCompletion Before;
+    Local->Fetch({ TEXT("CATNR=5") }, TEXT("TLE"), Record(Before));
+    EXPECT_TRUE(Wait({ &Before }));
+    EXPECT_TRUE(Before.bSuccess);
+
+    // Served from the snapshot until Refresh
+    WriteFile(Stations, std::string(Iss[0]) + "\r\n" + Iss[1] + "\r\n" + Iss[2] + "\r\n");
+
+    FCompletion Snapshot;
+    Local->Fetch({ TEXT("CATNR=5") }, TEXT("TLE"), Record(Snapshot));
+    EXPECT_TRUE(Wait({ &Snapshot }));
+    EXPECT_TRUE(Snapshot.bSuccess);
+
+    Local->Refresh();
+    FCompletion After;
+    Local->Fetch({ TEXT("CATNR=5") }, TEXT("TLE"), Record(After));
+    EXPECT_TRUE(Wait({ &After }));
+    EXPECT_EQ(After.Count, 1);
+    EXPECT_FALSE(After.bSuccess);
+
+    // A single file's group is its name, too
+    FCompletion Group;
+    Local->Fetch({ TEXT("GROUP=STATIONS") }, TEXT("TLE"), Record(Group));
+    EXPECT_TRUE(Wait({ &Group }));
+    EXPECT_TRUE(Group.Telemetry == Served(Iss[0], Iss[1], Iss[2]));
+}
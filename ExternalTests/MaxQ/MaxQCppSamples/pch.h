@@ -0,0 +1,20 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+// 
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/ 
+
+#pragma once
+
+#define WINVER 0x0A00
+#define _WIN32_WINNT 0x0A00
+
+#include "UE5HostDefs.h"
+#include "SpiceHostDefs.h"
+#include "MaxQCppSamplesHostDefs.h"
+
+#include "Spice.h"
+#include "SpiceTypes.h"
+
+#include "gtest/gtest.h"
\ No newline at end of file
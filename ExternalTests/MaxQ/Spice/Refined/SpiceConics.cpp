@@ -0,0 +1,282 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceConics.h"
+#include "SpiceOrbits.h"
+
+using namespace MaxQ::Conics;
+
+namespace
+{
+    FSConicElements MakeOrbit(double rp, double ecc, double m0)
+    {
+        return FSConicElements(FSDistance(rp), ecc, FSAngle(0.4), FSAngle(1.2), FSAngle(2.5), FSAngle(m0), FSEphemerisTime(1.e6), FSMassConstant(398600.4418));
+    }
+
+    // Elliptic, near-circular, parabolic and hyperbolic
+    TArray<FSConicElements> TestOrbits()
+    {
+        return {
+            MakeOrbit(7000., 0.1, 0.3),
+            MakeOrbit(42164., 0.0001, -2.),
+            MakeOrbit(9000., 0.95, 3.),
+            MakeOrbit(6800., 1., 0.5),
+            MakeOrbit(7200., 1.8, -1.),
+            MakeOrbit(7200., 5., 4.)
+        };
+    }
+
+    void ExpectNearState(const FSStateVector& Actual, const FSStateVector& Expected, double RelativeTolerance)
+    {
+        const double r = Expected.r.Magnitude().km;
+        const double v = Expected.v.Magnitude().kmps;
+        EXPECT_NEAR(Actual.r.x.km, Expected.r.x.km, r * RelativeTolerance);
+        EXPECT_NEAR(Actual.r.y.km, Expected.r.y.km, r * RelativeTolerance);
+        EXPECT_NEAR(Actual.r.z.km, Expected.r.z.km, r * RelativeTolerance);
+        EXPECT_NEAR(Actual.v.dx.kmps, Expected.v.dx.kmps, v * RelativeTolerance);
+        EXPECT_NEAR(Actual.v.dy.kmps, Expected.v.dy.kmps, v * RelativeTolerance);
+        EXPECT_NEAR(Actual.v.dz.kmps, Expected.v.dz.kmps, v * RelativeTolerance);
+    }
+}
+
+
+TEST(MaxQConicsTest, Batch_Matches_conics) {
+    TArray<FSConicElements> Orbits = TestOrbits();
+
+    FConicBatch Batch;
+    EXPECT_TRUE(Batch.Add(Orbits));
+    EXPECT_EQ(Batch.Num(), Orbits.Num());
+
+    for (double et : { 1.e6, 1.e6 + 60., 1.e6 - 5000., 3.e6, -2.e7 })
+    {
+        TArray<FSStateVector> States;
+        States.SetNum(Batch.Num());
+        EXPECT_TRUE(Batch.Evaluate(FSEphemerisTime(et), States));
+
+        for (int i = 0; i < Orbits.Num(); ++i)
+        {
+            ES_ResultCode ResultCode;
+            FString ErrorMessage;
+            FSStateVector Expected;
+            USpice::conics(ResultCode, ErrorMessage, Orbits[i], FSEphemerisTime(et), Expected);
+            EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+            ExpectNearState(States[i], Expected, 1e-9);
+
+            FSStateVector Single;
+            EXPECT_TRUE(Evaluate(Orbits[i], FSEphemerisTime(et), Single));
+            ExpectNearState(Single, States[i], 0.);
+        }
+    }
+}
+
+
+TEST(MaxQConicsTest, Positions_Match_States) {
+    FConicBatch Batch;
+    EXPECT_TRUE(Batch.Add(TestOrbits()));
+
+    TArray<FSStateVector> States;
+    States.SetNum(Batch.Num());
+    TArray<FSDistanceVector> Positions;
+    Positions.SetNum(Batch.Num());
+
+    EXPECT_TRUE(Batch.Evaluate(FSEphemerisTime(2.e6), States));
+    EXPECT_TRUE(Batch.Evaluate(FSEphemerisTime(2.e6), Positions));
+
+    for (int i = 0; i < Batch.Num(); ++i)
+    {
+        EXPECT_DOUBLE_EQ(Positions[i].x.km, States[i].r.x.km);
+        EXPECT_DOUBLE_EQ(Positions[i].y.km, States[i].r.y.km);
+        EXPECT_DOUBLE_EQ(Positions[i].z.km, States[i].r.z.km);
+    }
+}
+
+
+TEST(MaxQConicsTest, Rotation_Applies_To_Whole_Batch) {
+    FConicBatch Batch;
+    EXPECT_TRUE(Batch.Add(TestOrbits()));
+
+    // 90 degrees about z: (x, y, z) -> (-y, x, z)
+    const double m[3][3] = { { 0., -1., 0. }, { 1., 0., 0. }, { 0., 0., 1. } };
+
+    TArray<FSStateVector> States, Rotated;
+    States.SetNum(Batch.Num());
+    Rotated.SetNum(Batch.Num());
+    EXPECT_TRUE(Batch.Evaluate(FSEphemerisTime(2.e6), States));
+    EXPECT_TRUE(Batch.Evaluate(FSEphemerisTime(2.e6), FSRotationMatrix(m), Rotated));
+
+    for (int i = 0; i < Batch.Num(); ++i)
+    {
+        EXPECT_DOUBLE_EQ(Rotated[i].r.x.km, -States[i].r.y.km);
+        EXPECT_DOUBLE_EQ(Rotated[i].r.y.km, States[i].r.x.km);
+        EXPECT_DOUBLE_EQ(Rotated[i].r.z.km, States[i].r.z.km);
+        EXPECT_DOUBLE_EQ(Rotated[i].v.dx.kmps, -States[i].v.dy.kmps);
+        EXPECT_DOUBLE_EQ(Rotated[i].v.dy.kmps, States[i].v.dx.kmps);
+        EXPECT_DOUBLE_EQ(Rotated[i].v.dz.kmps, States[i].v.dz.kmps);
+    }
+}
+
+
+TEST(MaxQConicsTest, Invalid_Elements_Are_Errors) {
+    FConicBatch Batch;
+    EXPECT_TRUE(Batch.Add(MakeOrbit(7000., 0.1, 0.)));
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+
+    EXPECT_FALSE(Batch.Add(MakeOrbit(7000., -0.1, 0.), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    EXPECT_FALSE(Batch.Add(MakeOrbit(0., 0.1, 0.)));
+
+    FSConicElements NoGM = MakeOrbit(7000., 0.1, 0.);
+    NoGM.GravitationalParameter = FSMassConstant(0.);
+    EXPECT_FALSE(Batch.Add(NoGM));
+
+    // A list with one bad orbit adds nothing
+    TArray<FSConicElements> Orbits = TestOrbits();
+    Orbits.Add(NoGM);
+    EXPECT_FALSE(Batch.Add(Orbits));
+    EXPECT_EQ(Batch.Num(), 1);
+}
+
+
+TEST(MaxQConicsTest, EvaluateOrbits_Matches_EvaluateOrbit) {
+    TArray<FSConicElements> Orbits = TestOrbits();
+    FSEphemerisTime et(5.e6);
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    TArray<FSStateVector> States;
+
+    USpiceOrbits::EvaluateOrbits(ResultCode, ErrorMessage, States, et, Orbits, TEXT("J2000"), TEXT("ECLIPJ2000"));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    EXPECT_EQ(States.Num(), Orbits.Num());
+
+    for (int i = 0; i < States.Num(); ++i)
+    {
+        FSStateVector Expected;
+        USpiceOrbits::EvaluateOrbit(ResultCode, ErrorMessage, Expected, et, Orbits[i], TEXT("J2000"), TEXT("ECLIPJ2000"));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        ExpectNearState(States[i], Expected, 1e-9);
+    }
+
+    USpiceOrbits::EvaluateOrbits(ResultCode, ErrorMessage, States, et, Orbits, TEXT("J2000"), TEXT("NOT_A_FRAME"));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(States.Num(), 0);
+}
+
+
+TEST(MaxQConicsTest, Osculate_Matches_oscltx) {
+    const FSMassConstant mu(398600.4418);
+    const FSEphemerisTime et(1.e6);
+
+    // Inclined, circular equatorial, retrograde equatorial, polar, parabolic
+    // and hyperbolic
+    const double s[][6] = {
+        { 7000., 1000., -200., 0.5, 7.2, 1.1 },
+        { 7000., 0., 0., 0., 7.5460491, 0. },
+        { 7000., 0., 0., 0., -8.3, 0. },
+        { 7000., 100., 0., 0., 0., 9.8 },
+        { 7000., 0., 0., 0., 10.6718920, 0. },
+        { 7000., 0., 0., 0., 22.6, 0.1 }
+    };
+
+    TArray<FSStateVector> States;
+    for (const auto& state : s)
+    {
+        States.Add(FSStateVector(state));
+    }
+
+    TArray<FSConicElements> Elements;
+    TArray<FSAngle> TrueAnomaly;
+    TArray<FSDistance> SemiMajorAxis;
+    TArray<FSEphemerisPeriod> Period;
+    Elements.SetNum(States.Num());
+    TrueAnomaly.SetNum(States.Num());
+    SemiMajorAxis.SetNum(States.Num());
+    Period.SetNum(States.Num());
+
+    EXPECT_TRUE(Osculate(States, et, mu, Elements, TrueAnomaly, SemiMajorAxis, Period));
+
+    for (int i = 0; i < States.Num(); ++i)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSConicElements Expected;
+        FSAngle nu;
+        FSDistance a;
+        FSEphemerisPeriod tau;
+        USpice::oscltx(ResultCode, ErrorMessage, States[i], et, mu, Expected, nu, a, tau);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+        EXPECT_NEAR(Elements[i].PerifocalDistance.km, Expected.PerifocalDistance.km, 1e-9);
+        EXPECT_NEAR(Elements[i].Eccentricity, Expected.Eccentricity, 1e-12);
+        EXPECT_NEAR(Elements[i].Inclination.AsRadians(), Expected.Inclination.AsRadians(), 1e-12);
+        EXPECT_NEAR(Elements[i].LongitudeOfAscendingNode.AsRadians(), Expected.LongitudeOfAscendingNode.AsRadians(), 1e-12);
+        EXPECT_NEAR(Elements[i].ArgumentOfPeriapse.AsRadians(), Expected.ArgumentOfPeriapse.AsRadians(), 1e-12);
+        EXPECT_NEAR(Elements[i].MeanAnomalyAtEpoch.AsRadians(), Expected.MeanAnomalyAtEpoch.AsRadians(), 1e-12);
+        EXPECT_EQ(Elements[i].Epoch.seconds, Expected.Epoch.seconds);
+        EXPECT_EQ(Elements[i].GravitationalParameter.GM, Expected.GravitationalParameter.GM);
+        EXPECT_NEAR(TrueAnomaly[i].AsRadians(), nu.AsRadians(), 1e-12);
+        EXPECT_NEAR(SemiMajorAxis[i].km, a.km, 1e-6);
+        EXPECT_NEAR(Period[i].seconds, tau.seconds, 1e-6);
+    }
+}
+
+
+TEST(MaxQConicsTest, Osculate_Roundtrips) {
+    TArray<FSConicElements> Orbits = TestOrbits();
+
+    TArray<FSStateVector> States;
+    States.SetNum(Orbits.Num());
+    EXPECT_TRUE(Evaluate(Orbits, States));
+
+    TArray<FSConicElements> Elements;
+    Elements.SetNum(Orbits.Num());
+    EXPECT_TRUE(Osculate(States, Orbits[0].Epoch, Orbits[0].GravitationalParameter, Elements));
+
+    TArray<FSStateVector> Roundtrip;
+    Roundtrip.SetNum(Orbits.Num());
+    EXPECT_TRUE(Evaluate(Elements, Roundtrip));
+
+    for (int i = 0; i < Orbits.Num(); ++i)
+    {
+        ExpectNearState(Roundtrip[i], States[i], 1e-9);
+    }
+}
+
+
+TEST(MaxQConicsTest, Degenerate_States_Are_Errors) {
+    const double s[][6] = {
+        { 7000., 0., 0., 0., 7.5, 0. },
+        { 7000., 0., 0., 0., 0., 0. },
+        { 7000., 0., 0., 3., 0., 0. }
+    };
+
+    TArray<FSStateVector> States;
+    for (const auto& state : s)
+    {
+        States.Add(FSStateVector(state));
+    }
+
+    TArray<FSConicElements> Elements;
+    Elements.SetNum(States.Num());
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Osculate(States, FSEphemerisTime(0.), FSMassConstant(398600.4418), Elements, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    // The good state is still converted
+    EXPECT_NEAR(Elements[0].PerifocalDistance.km, 7000., 1e-6);
+
+    EXPECT_FALSE(Osculate(States, FSEphemerisTime(0.), FSMassConstant(0.), Elements));
+}
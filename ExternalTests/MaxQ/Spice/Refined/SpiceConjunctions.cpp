@@ -0,0 +1,152 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceConjunctions.h"
+
+using namespace MaxQ;
+using Conjunctions::FConjunction;
+
+namespace
+{
+    constexpr double Epoch = 7e8;
+    constexpr double Day = 86400.;
+
+    // Satellites 0 and 1 are in planes 10 degrees apart, phased to meet
+    // where they cross, twice an orbit.  2 is sun-synchronous, and crosses
+    // them both.  3 and 4's shells are clear of the others'.
+    Sgp4::FTleBatch MakeBatch()
+    {
+        Sgp4::FTleBatch Batch;
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 51.6, 0., 0.0005, 0., 0., 15.5)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 51.6, 10., 0.0005, 0., 353.78, 15.5)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 97.5, 40., 0.001, 90., 200., 15.45)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 98.7, 0., 0.001, 0., 0., 14.)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 0.05, 0., 0.0002, 0., 0., 1.0027)));
+        return Batch;
+    }
+
+    double Distance(const Sgp4::FTleBatch& Batch, int32 i, int32 j, double et, TArray<FSStateVector>& States)
+    {
+        Batch.Evaluate(FSEphemerisTime(et), States);
+        double a[6], b[6];
+        States[i].CopyTo(a);
+        States[j].CopyTo(b);
+        return FMath::Sqrt(FMath::Square(a[0] - b[0]) + FMath::Square(a[1] - b[1]) + FMath::Square(a[2] - b[2]));
+    }
+}
+
+
+TEST(MaxQConjunctionsTest, Matches_BruteForce) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const Sgp4::FTleBatch Batch = MakeBatch();
+    const int32 Count = Batch.Num();
+    const double Threshold = 50.;
+
+    TArray<FConjunction> Found;
+    EXPECT_TRUE(Conjunctions::Screen(Batch, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + Day), FSDistance(Threshold), Found));
+    EXPECT_GT(Found.Num(), 20);
+
+    // Every pair, every second, then each local minimum golden-sectioned
+    TArray<FSStateVector> States;
+    States.SetNum(Count);
+    int32 Expected = 0;
+    for (int32 i = 0; i < Count; ++i)
+    {
+        for (int32 j = i + 1; j < Count; ++j)
+        {
+            double d0 = Distance(Batch, i, j, Epoch, States);
+            double d1 = Distance(Batch, i, j, Epoch + 1., States);
+            for (double t = Epoch + 1.; t < Epoch + Day; t += 1.)
+            {
+                const double d2 = Distance(Batch, i, j, t + 1., States);
+                if (d1 <= d0 && d1 < d2 && d1 < Threshold + 10.)
+                {
+                    double a = t - 1., b = t + 1.;
+                    const double g = 0.5 * (FMath::Sqrt(5.) - 1.);
+                    for (int k = 0; k < 60; ++k)
+                    {
+                        const double x1 = b - g * (b - a), x2 = a + g * (b - a);
+                        if (Distance(Batch, i, j, x1, States) < Distance(Batch, i, j, x2, States)) b = x2;
+                        else a = x1;
+                    }
+                    const double tca = 0.5 * (a + b);
+                    const double miss = Distance(Batch, i, j, tca, States);
+
+                    const int32 Match = Found.IndexOfByPredicate([&](const FConjunction& c)
+                    {
+                        return c.Primary == i && c.Secondary == j && FMath::Abs(c.TCA.seconds - tca) < 1.;
+                    });
+
+                    if (miss <= Threshold - 1e-3)
+                    {
+                        ++Expected;
+                        EXPECT_NE(Match, INDEX_NONE);
+                    }
+                    if (Match != INDEX_NONE)
+                    {
+                        EXPECT_NEAR(Found[Match].TCA.seconds, tca, 1e-3);
+                        EXPECT_NEAR(Found[Match].MissDistance.km, miss, 1e-4);
+                    }
+                }
+                d0 = d1;
+                d1 = d2;
+            }
+        }
+    }
+    EXPECT_EQ(Found.Num(), Expected);
+
+    for (int32 n = 0; n < Found.Num(); ++n)
+    {
+        EXPECT_TRUE(Found[n].Primary < Found[n].Secondary);
+        EXPECT_TRUE(Found[n].Secondary <= 2);
+        EXPECT_TRUE(Found[n].RelativeSpeed.kmps > 0.);
+        EXPECT_TRUE(n == 0 || Found[n - 1].TCA.seconds <= Found[n].TCA.seconds);
+    }
+}
+
+
+TEST(MaxQConjunctionsTest, Settings) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const Sgp4::FTleBatch Batch = MakeBatch();
+
+    // A coarser step finds the same approaches
+    TArray<FConjunction> Fine, Coarse;
+    Conjunctions::FSettings Settings;
+    Settings.Step = FSEphemerisPeriod(20.);
+    EXPECT_TRUE(Conjunctions::Screen(Batch, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + 0.25 * Day), FSDistance(50.), Fine, Settings));
+    Settings.Step = FSEphemerisPeriod(120.);
+    EXPECT_TRUE(Conjunctions::Screen(Batch, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + 0.25 * Day), FSDistance(50.), Coarse, Settings));
+
+    EXPECT_EQ(Fine.Num(), Coarse.Num());
+    for (int32 n = 0; n < FMath::Min(Fine.Num(), Coarse.Num()); ++n)
+    {
+        EXPECT_EQ(Fine[n].Primary, Coarse[n].Primary);
+        EXPECT_EQ(Fine[n].Secondary, Coarse[n].Secondary);
+        EXPECT_NEAR(Fine[n].TCA.seconds, Coarse[n].TCA.seconds, 1e-2);
+        EXPECT_NEAR(Fine[n].MissDistance.km, Coarse[n].MissDistance.km, 1e-3);
+    }
+
+    // Bad arguments
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Conjunctions::Screen(Batch, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch - 1.), FSDistance(50.), Fine, Conjunctions::FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+
+    // A zero-length span
+    ResultCode = ES_ResultCode::Success;
+    ErrorMessage.Empty();
+    EXPECT_FALSE(Conjunctions::Screen(Batch, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch), FSDistance(50.), Fine, Conjunctions::FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+}
@@ -0,0 +1,187 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceConics.h"
+#include "SpiceCovariance.h"
+#include "SpicePropagator.h"
+
+using namespace MaxQ;
+using Covariance::FStateMatrix;
+
+namespace
+{
+    // Central differences of prop2b
+    FStateMatrix DifferencedTransition(const FSStateVector& State, double dt)
+    {
+        double state[6];
+        State.CopyTo(state);
+
+        FStateMatrix Phi;
+        for (int j = 0; j < 6; ++j)
+        {
+            const double h = j < 3 ? 1e-3 : 1e-6;
+            double Plus[6], Minus[6];
+            FMemory::Memcpy(Plus, state, sizeof(state));
+            FMemory::Memcpy(Minus, state, sizeof(state));
+            Plus[j] += h;
+            Minus[j] -= h;
+
+            double p[6], m[6];
+            TwoBody(FSStateVector(Plus), dt).CopyTo(p);
+            TwoBody(FSStateVector(Minus), dt).CopyTo(m);
+            for (int i = 0; i < 6; ++i)
+            {
+                Phi.m[i][j] = (p[i] - m[i]) / (2. * h);
+            }
+        }
+        return Phi;
+    }
+
+    void ExpectNear(const FStateMatrix& Actual, const FStateMatrix& Expected, double RelativeTolerance)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            for (int j = 0; j < 6; ++j)
+            {
+                EXPECT_NEAR(Actual.m[i][j], Expected.m[i][j], RelativeTolerance * (FMath::Abs(Expected.m[i][j]) + 1e-3));
+            }
+        }
+    }
+
+    FStateMatrix SampleCovariance()
+    {
+        FStateMatrix P;
+        for (int i = 0; i < 6; ++i)
+        {
+            for (int j = 0; j < 6; ++j)
+            {
+                P.m[i][j] = i < 3 && j < 3 ? 0.1 : 0.;
+            }
+            P.m[i][i] += i < 3 ? 1. : 1e-6;
+        }
+        P.m[0][3] = P.m[3][0] = 1e-4;
+        return P;
+    }
+}
+
+
+TEST(MaxQCovarianceTest, Conic_Transition_Matches_Differences) {
+    const FSStateVector States[] = {
+        // Elliptic, forwards and backwards
+        FSStateVector(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.)),
+        FSStateVector(FSDistanceVector(7000., 100., 300.), FSVelocityVector(0.5, 7.2, 1.)),
+        // Hyperbolic
+        FSStateVector(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 11.2, 0.3))
+    };
+
+    for (const FSStateVector& State : States)
+    {
+        for (double dt : { 3000., -5000. })
+        {
+            FSStateVector Final;
+            FStateMatrix Phi;
+            EXPECT_TRUE(Conics::Transition(State, FSEphemerisPeriod(dt), EarthGM, Final, Phi));
+
+            const FSStateVector Expected = TwoBody(State, dt);
+            EXPECT_NEAR(Final.r.x.km, Expected.r.x.km, 1e-8);
+            EXPECT_NEAR(Final.r.y.km, Expected.r.y.km, 1e-8);
+            EXPECT_NEAR(Final.r.z.km, Expected.r.z.km, 1e-8);
+
+            ExpectNear(Phi, DifferencedTransition(State, dt), 1e-6);
+        }
+    }
+
+    // No transition for a zero position
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    FSStateVector Final;
+    FStateMatrix Phi;
+    EXPECT_FALSE(Conics::Transition(FSStateVector(), FSEphemerisPeriod(10.), EarthGM, Final, Phi, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+}
+
+
+TEST(MaxQCovarianceTest, Numerical_Transition_Matches_Conic) {
+    Propagator::FForceModel Model;
+    Model.GM = EarthGM;
+
+    const FSStateVector State(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.));
+    const TArray<FSEphemerisTime> ets{ FSEphemerisTime(3000.), FSEphemerisTime(20000.) };
+
+    TArray<FSStateVector> States;
+    TArray<FStateMatrix> Transitions;
+    States.SetNum(ets.Num());
+    Transitions.SetNum(ets.Num());
+    EXPECT_TRUE(Propagator::PropagateTransition(Model, Propagator::FSettings(), State, FSEphemerisTime(), ets, States, Transitions));
+
+    for (int i = 0; i < ets.Num(); ++i)
+    {
+        FSStateVector Final;
+        FStateMatrix Phi;
+        EXPECT_TRUE(Conics::Transition(State, FSEphemerisPeriod(ets[i].seconds), EarthGM, Final, Phi));
+        ExpectNear(Transitions[i], Phi, 1e-8);
+    }
+
+    // The batch gives the same matrices
+    TArray<FSStateVector> Batch{ State, State };
+    TArray<FStateMatrix> BatchTransitions;
+    BatchTransitions.SetNum(Batch.Num());
+    EXPECT_TRUE(Propagator::PropagateTransition(Model, Propagator::FSettings(), Batch, BatchTransitions, FSEphemerisTime(), ets.Last()));
+    ExpectNear(BatchTransitions[1], Transitions.Last(), 1e-12);
+}
+
+
+TEST(MaxQCovarianceTest, Transform_Matches_Triple_Product) {
+    FSStateVector Final;
+    FStateMatrix Phi;
+    EXPECT_TRUE(Conics::Transition(FSStateVector(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.)), FSEphemerisPeriod(20000.), EarthGM, Final, Phi));
+
+    const FStateMatrix P = SampleCovariance();
+
+    FStateMatrix Expected;
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            double Sum = 0.;
+            for (int k = 0; k < 6; ++k)
+            {
+                for (int l = 0; l < 6; ++l)
+                {
+                    Sum += Phi.m[i][k] * P.m[k][l] * Phi.m[j][l];
+                }
+            }
+            Expected.m[i][j] = Sum;
+        }
+    }
+
+    FStateMatrix Result;
+    Covariance::Transform(Phi, P, Result);
+    ExpectNear(Result, Expected, 1e-12);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            EXPECT_EQ(Result.m[i][j], Result.m[j][i]);
+        }
+    }
+
+    // Batched, with one transition per covariance and with a shared one
+    TArray<FStateMatrix> Covariances;
+    Covariances.Init(P, 100);
+    TArray<FStateMatrix> Transitions;
+    Transitions.Init(Phi, 100);
+    Covariance::Propagate(Transitions, Covariances);
+    ExpectNear(Covariances[99], Result, 1e-15);
+
+    Covariances.Init(P, 100);
+    Covariance::Propagate(Phi, Covariances);
+    ExpectNear(Covariances[42], Result, 1e-15);
+}
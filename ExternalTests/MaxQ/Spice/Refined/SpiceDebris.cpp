@@ -0,0 +1,323 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceDebris.h"
+#include "SpiceTeme.h"
+
+using namespace MaxQ;
+using namespace MaxQ::Debris;
+
+namespace
+{
+    // A LEO parent, 700km circular, in TEME
+    FSStateVector LeoParent()
+    {
+        const double r = 6378.137 + 700.;
+        const double v = FMath::Sqrt(398600.8 / r);
+        const double i = 98. * UE_DOUBLE_PI / 180.;
+        const double s[6] = { r, 0., 0., 0., v * FMath::Cos(i), v * FMath::Sin(i) };
+        return FSStateVector(s);
+    }
+
+    double Speed(const FSStateVector& State)
+    {
+        double s[6];
+        State.CopyTo(s);
+        return FMath::Sqrt(s[3] * s[3] + s[4] * s[4] + s[5] * s[5]);
+    }
+
+    // Vis-viva
+    double SemiMajorAxis(const FSStateVector& State, double GM)
+    {
+        double s[6];
+        State.CopyTo(s);
+        const double r = FMath::Sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+        return 1. / (2. / r - FMath::Square(Speed(State)) / GM);
+    }
+}
+
+
+TEST(MaxQDebrisTest, Fragment_Count_Follows_Power_Law) {
+    FBreakup Explosion;
+    Explosion.MinLength = 0.1;
+    Explosion.MaxLength = 10.;
+    // 6 (0.1^-1.6 - 10^-1.6)
+    EXPECT_EQ(NumFragments(Explosion), 239);
+
+    FBreakup Collision;
+    Collision.Type = EBreakup::Collision;
+    Collision.Mass = 1000.;
+    Collision.MinLength = 0.01;
+    // 0.1 1000^0.75 (0.01^-1.71 - 10^-1.71)
+    EXPECT_EQ(NumFragments(Collision), 46773);
+
+    Collision.MinLength = 0.;
+    EXPECT_EQ(NumFragments(Collision), 0);
+
+    // MaxFragments caps the count
+    Collision.MinLength = 0.01;
+    Collision.MaxFragments = 100;
+    FFragments Fragments;
+    EXPECT_TRUE(Generate(Collision, LeoParent(), Fragments));
+    EXPECT_EQ(Fragments.Num(), 100);
+}
+
+
+TEST(MaxQDebrisTest, Fragments_Are_In_Range) {
+    FBreakup Breakup;
+    Breakup.Type = EBreakup::Collision;
+    Breakup.Mass = 1000.;
+    Breakup.MinLength = 0.01;
+    Breakup.MaxLength = 1.;
+
+    FFragments Fragments;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Fragments));
+    EXPECT_EQ(Fragments.Num(), NumFragments(Breakup));
+    EXPECT_EQ(Fragments.Length.Num(), Fragments.Num());
+    EXPECT_EQ(Fragments.Mass.Num(), Fragments.Num());
+
+    const double ParentSpeed = Speed(LeoParent());
+    for (int i = 0; i < Fragments.Num(); ++i)
+    {
+        EXPECT_GE(Fragments.Length[i], Breakup.MinLength);
+        EXPECT_LE(Fragments.Length[i], Breakup.MaxLength);
+        EXPECT_GT(Fragments.AreaToMass[i], 0.);
+        EXPECT_NEAR(Fragments.Mass[i] * Fragments.AreaToMass[i], Fragments.Area[i], 1e-12);
+        // The delta-v is all that's added
+        EXPECT_LE(FMath::Abs(Speed(Fragments.States[i]) - ParentSpeed), Fragments.DeltaV[i] + 1e-12);
+    }
+
+    // Smaller fragments are more numerous: most are under 2cm
+    int32 Small = 0;
+    for (double Length : Fragments.Length)
+    {
+        Small += Length < 0.02 ? 1 : 0;
+    }
+    EXPECT_GT(Small, Fragments.Num() / 2);
+}
+
+
+TEST(MaxQDebrisTest, Same_Seed_Same_Cloud) {
+    FBreakup Breakup;
+    Breakup.Type = EBreakup::Collision;
+    Breakup.Mass = 1000.;
+    Breakup.MinLength = 0.01;
+    Breakup.Seed = 42;
+
+    // Enough to be split across workers
+    FFragments First, Second, Other;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), First));
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Second));
+    Breakup.Seed = 43;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Other));
+    EXPECT_GT(First.Num(), 2048);
+
+    bool bDiffer = false;
+    for (int i = 0; i < First.Num(); ++i)
+    {
+        EXPECT_EQ(First.Length[i], Second.Length[i]);
+        EXPECT_EQ(First.AreaToMass[i], Second.AreaToMass[i]);
+        EXPECT_EQ(First.DeltaV[i], Second.DeltaV[i]);
+        bDiffer |= First.Length[i] != Other.Length[i];
+    }
+    EXPECT_TRUE(bDiffer);
+}
+
+
+TEST(MaxQDebrisTest, DeltaV_Follows_Model) {
+    for (EBreakup Type : { EBreakup::Explosion, EBreakup::Collision })
+    {
+        FBreakup Breakup;
+        Breakup.Type = Type;
+        Breakup.Scale = 1.;
+        Breakup.Mass = 1000.;
+        Breakup.MinLength = 0.01;
+        Breakup.MaxFragments = 20000;
+
+        const FSStateVector Parent = LeoParent();
+        FFragments Fragments;
+        EXPECT_TRUE(Generate(Breakup, Parent, Fragments));
+        const int32 n = Fragments.Num();
+        EXPECT_GT(n, 1000);
+
+        double p[6];
+        Parent.CopyTo(p);
+
+        // log10(dv, m/s) - its mean, given A/M, is N(0, 0.4)
+        double Sum = 0., SumSq = 0.;
+        double Direction[3] = { 0., 0., 0. };
+        for (int i = 0; i < n; ++i)
+        {
+            const double Chi = FMath::LogX(10., Fragments.AreaToMass[i]);
+            const double Mean = Type == EBreakup::Explosion ? 0.2 * Chi + 1.85 : 0.9 * Chi + 2.9;
+            const double Residual = FMath::LogX(10., Fragments.DeltaV[i] * 1000.) - Mean;
+            Sum += Residual;
+            SumSq += Residual * Residual;
+
+            double s[6];
+            Fragments.States[i].CopyTo(s);
+            for (int k = 0; k < 3; ++k)
+            {
+                EXPECT_EQ(s[k], p[k]);
+                Direction[k] += (s[k + 3] - p[k + 3]) / Fragments.DeltaV[i];
+            }
+        }
+
+        const double Mean = Sum / n;
+        EXPECT_NEAR(Mean, 0., 0.02);
+        EXPECT_NEAR(FMath::Sqrt(SumSq / n - Mean * Mean), 0.4, 0.02);
+
+        // Isotropic: the unit vectors average out
+        for (int k = 0; k < 3; ++k)
+        {
+            EXPECT_NEAR(Direction[k] / n, 0., 0.05);
+        }
+    }
+}
+
+
+TEST(MaxQDebrisTest, ToConics_Reproduces_States) {
+    FBreakup Breakup;
+    Breakup.MinLength = 0.05;
+
+    FFragments Fragments;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Fragments));
+
+    const FSEphemerisTime et(1e8);
+    Conics::FConicBatch Orbits;
+    EXPECT_TRUE(ToConics(Fragments, et, EarthGM, Orbits));
+    EXPECT_EQ(Orbits.Num(), Fragments.Num());
+
+    TArray<FSStateVector> States;
+    States.SetNum(Orbits.Num());
+    EXPECT_TRUE(Orbits.Evaluate(et, States));
+    for (int i = 0; i < Fragments.Num(); ++i)
+    {
+        ExpectNear(States[i], Fragments.States[i], 1e-6, 1e-9);
+    }
+}
+
+
+TEST(MaxQDebrisTest, ToTles_Starts_At_Fragments) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    FBreakup Breakup;
+    Breakup.Type = EBreakup::Collision;
+    Breakup.Mass = 1000.;
+    Breakup.MinLength = 0.05;
+
+    FFragments Fragments;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Fragments));
+
+    // One more, falling straight down
+    const double Falling[6] = { 6378.137 + 700., 0., 0., -1., 0., 0. };
+    Fragments.Length.Add(1.);
+    Fragments.AreaToMass.Add(0.1);
+    Fragments.Area.Add(1.);
+    Fragments.Mass.Add(10.);
+    Fragments.DeltaV.Add(0.);
+    Fragments.States.Add(FSStateVector(Falling));
+
+    const FSEphemerisTime et(6e8);
+    Sgp4::FTleBatch Satellites;
+    TArray<bool> Added;
+    Added.SetNum(Fragments.Num());
+    EXPECT_TRUE(ToTles(Fragments, et, TEXT("TEME"), Satellites, Added));
+    EXPECT_FALSE(Added.Last());
+
+    TArray<int32> Indices;
+    for (int i = 0; i < Added.Num(); ++i)
+    {
+        if (Added[i])
+        {
+            Indices.Add(i);
+        }
+    }
+    EXPECT_EQ(Satellites.Num(), Indices.Num());
+    EXPECT_GT(Indices.Num(), Fragments.Num() * 9 / 10);
+
+    // Osculating elements, taken as mean ones, are off by J2's short-period
+    // terms.  Deep-space orbits (over 225 minutes) have lunar and solar ones
+    // on top.
+    TArray<FSStateVector> States;
+    States.SetNum(Satellites.Num());
+    Satellites.Evaluate(et, States);
+    for (int j = 0; j < Indices.Num(); ++j)
+    {
+        if (SemiMajorAxis(Fragments.States[Indices[j]], 398600.8) > 12000.)
+        {
+            continue;
+        }
+
+        double Expected[6], Actual[6];
+        Fragments.States[Indices[j]].CopyTo(Expected);
+        States[j].CopyTo(Actual);
+        const double Distance = FMath::Sqrt(FMath::Square(Actual[0] - Expected[0]) + FMath::Square(Actual[1] - Expected[1]) + FMath::Square(Actual[2] - Expected[2]));
+        EXPECT_LT(Distance, 30.);
+    }
+
+    // States in another frame come to the same place
+    FSEphemerisTime Later(et.seconds + 600.);
+    Covariance::FStateMatrix ToJ2000;
+    EXPECT_TRUE(Teme::ToFrame(et, TEXT("J2000"), ToJ2000));
+    FFragments InJ2000 = Fragments;
+    Teme::Transform(ToJ2000, InJ2000.States);
+
+    Sgp4::FTleBatch FromJ2000;
+    TArray<bool> AddedFromJ2000;
+    AddedFromJ2000.SetNum(Fragments.Num());
+    EXPECT_TRUE(ToTles(InJ2000, et, TEXT("J2000"), FromJ2000, AddedFromJ2000));
+    EXPECT_EQ(FromJ2000.Num(), Satellites.Num());
+
+    TArray<FSStateVector> TemeStates, J2000States;
+    TemeStates.SetNum(Satellites.Num());
+    J2000States.SetNum(Satellites.Num());
+    Satellites.Evaluate(Later, TemeStates);
+    FromJ2000.Evaluate(Later, J2000States);
+    for (int j = 0; j < TemeStates.Num(); ++j)
+    {
+        double a[6], b[6];
+        TemeStates[j].CopyTo(a);
+        J2000States[j].CopyTo(b);
+        EXPECT_NEAR(a[0], b[0], 1e-3);
+        EXPECT_NEAR(a[1], b[1], 1e-3);
+        EXPECT_NEAR(a[2], b[2], 1e-3);
+    }
+}
+
+
+TEST(MaxQDebrisTest, Errors) {
+    FFragments Fragments;
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+
+    FBreakup Breakup;
+    Breakup.MinLength = 1.;
+    Breakup.MaxLength = 0.5;
+    EXPECT_FALSE(Generate(Breakup, LeoParent(), Fragments, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+
+    Breakup = FBreakup();
+    Breakup.Type = EBreakup::Collision;
+    EXPECT_FALSE(Generate(Breakup, LeoParent(), Fragments, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(Fragments.Num(), 0);
+
+    Breakup.Mass = 100.;
+    EXPECT_TRUE(Generate(Breakup, LeoParent(), Fragments, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+    Sgp4::FTleBatch Satellites;
+    TArray<bool> Added;
+    Added.SetNum(Fragments.Num());
+    EXPECT_FALSE(ToTles(Fragments, FSEphemerisTime(0.), TEXT("NO SUCH FRAME"), Satellites, Added, 2.2, FSMassConstant(398600.8), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(Satellites.Num(), 0);
+}
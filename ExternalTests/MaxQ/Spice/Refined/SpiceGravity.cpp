@@ -0,0 +1,267 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceGravity.h"
+#include "SpicePropagator.h"
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace MaxQ;
+using Gravity::FGravityField;
+using Gravity::FAcceleration;
+using Gravity::FGradient;
+
+namespace
+{
+    const FSDistance EarthRadius(6378.137);
+    const double J2 = 1.08262668e-3;
+    const char* FieldFile = "maxq_gravity_test.gfc";
+
+    // A degree 8 field with made-up, Earth-sized coefficients
+    FGravityField MakeField(int32 Degree = 8)
+    {
+        TArray<double> C, S;
+        C.SetNumZeroed(FGravityField::Index(Degree + 1, 0));
+        S.SetNumZeroed(C.Num());
+        C[0] = 1.;
+        C[FGravityField::Index(2, 0)] = -J2 / FMath::Sqrt(5.);
+        for (int32 n = 2; n <= Degree; ++n)
+        {
+            for (int32 m = n == 2 ? 1 : 0; m <= n; ++m)
+            {
+                C[FGravityField::Index(n, m)] = 1e-6 * FMath::Sin(7. * n + 3. * m);
+                S[FGravityField::Index(n, m)] = m > 0 ? 1e-6 * FMath::Cos(5. * n - 2. * m) : 0.;
+            }
+        }
+
+        FGravityField Field;
+        EXPECT_TRUE(Field.Set(EarthGM, EarthRadius, Degree, C, S));
+        return Field;
+    }
+
+    // The potential from degree 1 (the point mass differences poorly),
+    // straight from the associated Legendre functions
+    double Potential(const FGravityField& Field, const double* r)
+    {
+        const double rn = FMath::Sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+        const double u = r[2] / rn;
+        const double Longitude = FMath::Atan2(r[1], r[0]);
+        const double R = Field.GetReferenceRadius().km;
+
+        double Sum = 0.;
+        for (int32 n = 1; n <= Field.GetDegree(); ++n)
+        {
+            for (int32 m = 0; m <= n; ++m)
+            {
+                const double N = FMath::Sqrt((m == 0 ? 1. : 2.) * (2. * n + 1.) * std::tgamma(n - m + 1.) / std::tgamma(n + m + 1.));
+                const double P = N * std::assoc_legendre(n, m, u);
+                Sum += std::pow(R / rn, n) * P * (Field.GetC(n, m) * FMath::Cos(m * Longitude) + Field.GetS(n, m) * FMath::Sin(m * Longitude));
+            }
+        }
+        return Field.GetGM().GM / rn * Sum;
+    }
+
+    TArray<FSDistanceVector> SamplePositions()
+    {
+        return {
+            FSDistanceVector(7000., 0., 0.),
+            FSDistanceVector(-3000., 5500., 2500.),
+            FSDistanceVector(1200., -800., -6900.),
+            FSDistanceVector(26000., 15000., 100.),
+            FSDistanceVector(0.5, -0.2, 6800.),
+            FSDistanceVector(4000., 4000., -4000.),
+            FSDistanceVector(-6600., -1500., 900.)
+        };
+    }
+}
+
+
+TEST(MaxQGravityTest, J2_Matches_Closed_Form) {
+    FGravityField Field;
+    TArray<double> C{ 1., 0., 0., -J2 / FMath::Sqrt(5.), 0., 0. };
+    TArray<double> S{ 0., 0., 0., 0., 0., 0. };
+    EXPECT_TRUE(Field.Set(EarthGM, EarthRadius, 2, C, S));
+
+    for (const FSDistanceVector& Position : SamplePositions())
+    {
+        double r[3];
+        Position.CopyTo(r);
+        const double r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+        const double rn = FMath::Sqrt(r2);
+        const double k = 1.5 * J2 * EarthGM.GM * EarthRadius.km * EarthRadius.km / (r2 * r2 * rn);
+        const double z2 = 5. * r[2] * r[2] / r2;
+        const double Expected[3] = {
+            k * r[0] * (z2 - 1.),
+            k * r[1] * (z2 - 1.),
+            k * r[2] * (z2 - 3.)
+        };
+
+        FAcceleration a;
+        Field.Acceleration(Position, a, nullptr, 1);
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(a.a[i], Expected[i], 1e-15 + 1e-10 * FMath::Abs(Expected[i]));
+        }
+
+        // With the point mass
+        Field.Acceleration(Position, a);
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(a.a[i], Expected[i] - EarthGM.GM * r[i] / (r2 * rn), 1e-14);
+        }
+    }
+}
+
+
+TEST(MaxQGravityTest, Acceleration_And_Gradient_Match_Differences) {
+    const FGravityField Field = MakeField();
+    const TArray<FSDistanceVector> Positions = SamplePositions();
+
+    TArray<FAcceleration> Accelerations;
+    TArray<FGradient> Gradients;
+    Accelerations.SetNum(Positions.Num());
+    Gradients.SetNum(Positions.Num());
+    Field.Acceleration(Positions, Accelerations, Gradients);
+
+    for (int p = 0; p < Positions.Num(); ++p)
+    {
+        double r[3];
+        Positions[p].CopyTo(r);
+        const double h = 1e-3;
+
+        FAcceleration Perturbation;
+        Field.Acceleration(Positions[p], Perturbation, nullptr, 1);
+
+        for (int j = 0; j < 3; ++j)
+        {
+            double Plus[3] = { r[0], r[1], r[2] }, Minus[3] = { r[0], r[1], r[2] };
+            Plus[j] += h;
+            Minus[j] -= h;
+
+            // The acceleration is the potential's gradient
+            const double Expected = (Potential(Field, Plus) - Potential(Field, Minus)) / (2. * h);
+            EXPECT_NEAR(Perturbation.a[j], Expected, 1e-12);
+
+            // The gradient is the acceleration's
+            FAcceleration aPlus, aMinus;
+            Field.Acceleration(FSDistanceVector(Plus[0], Plus[1], Plus[2]), aPlus);
+            Field.Acceleration(FSDistanceVector(Minus[0], Minus[1], Minus[2]), aMinus);
+            for (int i = 0; i < 3; ++i)
+            {
+                EXPECT_NEAR(Gradients[p].m[i][j], (aPlus.a[i] - aMinus.a[i]) / (2. * h), 1e-13);
+            }
+        }
+
+        // The batch's four-wide lanes match single positions
+        FAcceleration a;
+        FGradient g;
+        Field.Acceleration(Positions[p], a, &g);
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(Accelerations[p].a[i], a.a[i], 1e-18);
+            for (int j = 0; j < 3; ++j)
+            {
+                EXPECT_NEAR(Gradients[p].m[i][j], g.m[i][j], 1e-21);
+            }
+        }
+    }
+}
+
+
+TEST(MaxQGravityTest, Load_Icgem_File) {
+    std::remove(FieldFile);
+    {
+        std::ofstream File(FieldFile);
+        File << "product_type          gravity_field\n"
+                "modelname             MAXQ_TEST\n"
+                "earth_gravity_constant  0.3986004415E+15\n"
+                "radius                  0.63781363E+07\n"
+                "max_degree            3\n"
+                "norm                  fully_normalized\n"
+                "\n"
+                "key    L    M         C                  S               sigma C    sigma S\n"
+                "end_of_head =================================================================\n"
+                "gfc    0    0  1.0D+00                  0.0D+00            0.0 0.0\n"
+                "gfc    2    0 -0.484165143790815D-03    0.0D+00            0.0 0.0\n"
+                "gfc    2    2  0.243938357328313D-05   -0.140027370385934D-05 0.0 0.0\n"
+                "gfc    3    1  0.203046201047864D-05    0.248200415856872D-06 0.0 0.0\n";
+    }
+
+    // Absolute, as relative paths are relative to the project's content
+    const FString Path(std::filesystem::absolute(FieldFile).string().c_str());
+
+    FGravityField Field;
+    EXPECT_TRUE(Field.Load(Path));
+    EXPECT_EQ(Field.GetDegree(), 3);
+    EXPECT_NEAR(Field.GetGM().GM, 398600.4415, 1e-9);
+    EXPECT_NEAR(Field.GetReferenceRadius().km, 6378.1363, 1e-9);
+    EXPECT_DOUBLE_EQ(Field.GetC(2, 0), -0.484165143790815e-3);
+    EXPECT_DOUBLE_EQ(Field.GetS(2, 2), -0.140027370385934e-5);
+    EXPECT_DOUBLE_EQ(Field.GetC(3, 1), 0.203046201047864e-5);
+    EXPECT_EQ(Field.GetC(3, 3), 0.);
+
+    // Truncated
+    EXPECT_TRUE(Field.Load(Path, 2));
+    EXPECT_EQ(Field.GetDegree(), 2);
+    EXPECT_DOUBLE_EQ(Field.GetC(2, 2), 0.243938357328313e-5);
+
+    std::remove(FieldFile);
+
+    // Missing
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Field.Load(Path, 0, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+    EXPECT_FALSE(Field.IsValid());
+
+    // Short
+    ResultCode = ES_ResultCode::Success;
+    TArray<double> C{ 1., 0., 0. };
+    EXPECT_FALSE(Field.Set(EarthGM, EarthRadius, 2, C, C, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+}
+
+
+TEST(MaxQGravityTest, Propagator_Field_Matches_Zonal_J2) {
+    USpice::init_all();
+
+    Propagator::FForceModel Zonal;
+    Zonal.GM = EarthGM;
+    Zonal.ReferenceRadius = EarthRadius;
+    Zonal.J[2] = J2;
+
+    TArray<double> C{ 1., 0., 0., -J2 / FMath::Sqrt(5.), 0., 0. };
+    TArray<double> S{ 0., 0., 0., 0., 0., 0. };
+    TSharedPtr<FGravityField> Field = MakeShared<FGravityField>();
+    EXPECT_TRUE(Field->Set(EarthGM, EarthRadius, 2, C, S));
+
+    // Zonal, so the spin doesn't matter
+    Propagator::FForceModel Harmonic;
+    Harmonic.GM = EarthGM;
+    Harmonic.GravityField = Field;
+    const double Spin[3] = { 0., 0., 7.292115e-5 };
+    Harmonic.AtmosphereRotation = FSAngularVelocity(Spin);
+
+    const FSStateVector State(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 6.5, 3.5));
+    const TArray<FSEphemerisTime> ets{ FSEphemerisTime(3000.), FSEphemerisTime(20000.) };
+
+    TArray<FSStateVector> Expected, Actual;
+    Expected.SetNum(ets.Num());
+    Actual.SetNum(ets.Num());
+    EXPECT_TRUE(Propagator::Propagate(Zonal, Propagator::FSettings(), State, FSEphemerisTime(0.), ets, Expected));
+    EXPECT_TRUE(Propagator::Propagate(Harmonic, Propagator::FSettings(), State, FSEphemerisTime(0.), ets, Actual));
+
+    for (int i = 0; i < ets.Num(); ++i)
+    {
+        ExpectNear(Actual[i], Expected[i], 1e-6, 1e-9);
+    }
+}
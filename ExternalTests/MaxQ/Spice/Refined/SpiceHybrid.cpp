@@ -0,0 +1,271 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceHybrid.h"
+#include "SpiceTeme.h"
+
+using namespace MaxQ;
+using namespace MaxQ::Hybrid;
+
+namespace
+{
+    // 51.6 degrees, 15.5 revolutions a day, at et
+    FSTwoLineElements Tle(double et)
+    {
+        return TleElements(et, 51.6, 30., 0.0005, 10., 20., 15.5, 1e-4);
+    }
+
+    FSStateVector AddVelocity(const FSStateVector& State, const double(&dv)[3])
+    {
+        double s[6];
+        State.CopyTo(s);
+        s[3] += dv[0];
+        s[4] += dv[1];
+        s[5] += dv[2];
+        return FSStateVector(s);
+    }
+}
+
+
+TEST(MaxQHybridTest, Tle_Matches_Sgp4) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const double et = 6e8;
+    Sgp4::FTleBatch Batch;
+    EXPECT_TRUE(Batch.Add(Tle(et)));
+
+    for (const FString Frame : { TEXT("TEME"), TEXT("J2000") })
+    {
+        FTrajectory Trajectory(Frame, EarthGM);
+        EXPECT_TRUE(Trajectory.AddTle(FSEphemerisTime(et + 100.), Tle(et)));
+        EXPECT_EQ(Trajectory.Num(), 1);
+
+        // Before the first segment too
+        for (double dt : { 0., 100., 5000., -3000. })
+        {
+            FSStateVector Actual, Expected[1];
+            EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(et + dt), Actual));
+            EXPECT_TRUE(Teme::Evaluate(Batch, FSEphemerisTime(et + dt), Frame, Expected));
+            ExpectNear(Actual, Expected[0], 0., 0.);
+        }
+    }
+}
+
+
+TEST(MaxQHybridTest, Maneuvers_Append_Conics) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const double et = 6e8, Burn = et + 1800.;
+    FTrajectory Trajectory(TEXT("TEME"), EarthGM);
+    EXPECT_TRUE(Trajectory.AddTle(FSEphemerisTime(et), Tle(et)));
+
+    FSStateVector BeforeBurn, AtBurn;
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(et + 600.), BeforeBurn));
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn), AtBurn));
+
+    const double dv[3] = { 0.01, -0.02, 0.005 };
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn), FSVelocityVector(dv)));
+    EXPECT_EQ(Trajectory.Num(), 2);
+    EXPECT_EQ(Trajectory.GetSegment(1).Type, ESegment::Conic);
+    EXPECT_EQ(Trajectory.FindSegment(FSEphemerisTime(Burn - 1.)), 0);
+    EXPECT_EQ(Trajectory.FindSegment(FSEphemerisTime(Burn)), 1);
+
+    // Up to the burn, still the TLE
+    FSStateVector State;
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(et + 600.), State));
+    ExpectNear(State, BeforeBurn, 0., 0.);
+
+    // From it, two-body from the TLE's state plus the delta-v
+    const FSStateVector AfterBurn = AddVelocity(AtBurn, dv);
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn), State));
+    ExpectNear(State, AfterBurn, 1e-6, 1e-9);
+    for (double dt : { 60., 3000., 86400. })
+    {
+        EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn + dt), State));
+        ExpectNear(State, TwoBody(AfterBurn, dt), 1e-5, 1e-8);
+    }
+
+    // The conic is the segment's own
+    FSConicElements Elements;
+    EXPECT_TRUE(Trajectory.Osculate(FSEphemerisTime(Burn + 3000.), Elements));
+    double Actual[8], Expected[8];
+    Elements.CopyTo(Actual);
+    Trajectory.GetSegment(1).Elements.CopyTo(Expected);
+    for (int i = 0; i < 8; ++i)
+    {
+        EXPECT_EQ(Actual[i], Expected[i]);
+    }
+
+    // Later maneuvers don't change what came before: a copy replays exactly
+    const FTrajectory Replay = Trajectory;
+    const double Correction[3] = { 0., 0., 0.001 };
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn + 7200.), FSVelocityVector(Correction)));
+    EXPECT_EQ(Trajectory.Num(), 3);
+    for (double t : { et + 600., Burn, Burn + 3600., Burn + 7199. })
+    {
+        FSStateVector Replayed;
+        EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(t), State));
+        EXPECT_TRUE(Replay.Evaluate(FSEphemerisTime(t), Replayed));
+        ExpectNear(State, Replayed, 0., 0.);
+    }
+
+    // A maneuver before the last segment replaces it
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn + 600.), FSVelocityVector(Correction)));
+    EXPECT_EQ(Trajectory.Num(), 3);
+    EXPECT_EQ(Trajectory.GetSegment(2).Begin.seconds, Burn + 600.);
+
+    // Two at the same epoch add up
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn + 600.), FSVelocityVector(Correction)));
+    EXPECT_EQ(Trajectory.Num(), 3);
+    FSStateVector Coasted;
+    EXPECT_TRUE(Replay.Evaluate(FSEphemerisTime(Burn + 600.), Coasted));
+    const double Twice[3] = { 0., 0., 0.002 };
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn + 600.), State));
+    ExpectNear(State, AddVelocity(Coasted, Twice), 1e-6, 1e-9);
+}
+
+
+TEST(MaxQHybridTest, Maneuvers_Same_Epoch) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const double et = 6e8, Burn = et + 1800.;
+    FTrajectory Trajectory(TEXT("TEME"), EarthGM);
+    EXPECT_TRUE(Trajectory.AddTle(FSEphemerisTime(et), Tle(et)));
+
+    FSStateVector AtBurn;
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn), AtBurn));
+
+    // The second starts from the first's state, and replaces its segment,
+    // so the segment's DeltaV is their sum
+    const double First[3] = { 0.01, -0.02, 0.005 };
+    const double Second[3] = { -0.003, 0.004, 0.002 };
+    const double Sum[3] = { 0.007, -0.016, 0.007 };
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn), FSVelocityVector(First)));
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(Burn), FSVelocityVector(Second), ESegment::Conic));
+    EXPECT_EQ(Trajectory.Num(), 2);
+
+    double DeltaV[3];
+    Trajectory.GetSegment(1).DeltaV.CopyTo(DeltaV);
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_NEAR(DeltaV[i], Sum[i], 1e-15);
+    }
+
+    const FSStateVector AfterBurn = AddVelocity(AtBurn, Sum);
+    ExpectNear(Trajectory.GetSegment(1).State, AfterBurn, 1e-6, 1e-9);
+
+    FSStateVector State;
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Burn + 3000.), State));
+    ExpectNear(State, TwoBody(AfterBurn, 3000.), 1e-5, 1e-8);
+
+    // A segment that no maneuver started contributes no delta-v
+    FTrajectory Restarted(TEXT("TEME"), EarthGM);
+    EXPECT_TRUE(Restarted.AddTle(FSEphemerisTime(et), Tle(et)));
+    EXPECT_TRUE(Restarted.AddState(FSEphemerisTime(Burn), AtBurn));
+    EXPECT_TRUE(Restarted.Maneuver(FSEphemerisTime(Burn), FSVelocityVector(Second)));
+    EXPECT_EQ(Restarted.Num(), 2);
+    Restarted.GetSegment(1).DeltaV.CopyTo(DeltaV);
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(DeltaV[i], Second[i]);
+    }
+}
+
+
+TEST(MaxQHybridTest, Numerical_Segments) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // Two-body, so it can be checked against prop2b
+    Propagator::FForceModel Model;
+    Model.GM = EarthGM;
+
+    const double et = 1000.;
+    const double s[6] = { 7000., 0., 0., 0., 7.5, 1. };
+    const FSStateVector Start(s);
+
+    FTrajectory Trajectory(TEXT("J2000"), EarthGM);
+    Trajectory.SetForceModel(Model);
+    EXPECT_TRUE(Trajectory.AddState(FSEphemerisTime(et), Start, ESegment::Numerical));
+
+    const double dv[3] = { 0., 0.05, 0. };
+    EXPECT_TRUE(Trajectory.Maneuver(FSEphemerisTime(et + 3000.), FSVelocityVector(dv), ESegment::Numerical));
+    EXPECT_EQ(Trajectory.Num(), 2);
+
+    const FSStateVector AfterBurn = AddVelocity(TwoBody(Start, 3000.), dv);
+
+    // Out of order, across both segments
+    TArray<FSEphemerisTime> ets;
+    for (double dt : { 5000., 100., 2999., 3000., 9000., 0., 1500., 4000. })
+    {
+        ets.Add(FSEphemerisTime(et + dt));
+    }
+    TArray<FSStateVector> States;
+    States.SetNum(ets.Num());
+    EXPECT_TRUE(Trajectory.Evaluate(ets, States));
+
+    for (int i = 0; i < ets.Num(); ++i)
+    {
+        const double dt = ets[i].seconds - et;
+        const FSStateVector Expected = dt < 3000. ? TwoBody(Start, dt) : TwoBody(AfterBurn, dt - 3000.);
+        ExpectNear(States[i], Expected, 1e-5, 1e-8);
+
+        // Integrated on its own, the steps differ, within the tolerances
+        FSStateVector Single;
+        EXPECT_TRUE(Trajectory.Evaluate(ets[i], Single));
+        ExpectNear(Single, States[i], 1e-6, 1e-9);
+    }
+
+    // Numerical segments don't cover the time before them
+    FSStateVector State;
+    EXPECT_FALSE(Trajectory.Evaluate(FSEphemerisTime(et - 1.), State));
+
+    // The force model's captured when the segment's appended
+    Model.GM = FSMassConstant(1.);
+    Trajectory.SetForceModel(Model);
+    EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(et + 9000.), State));
+    ExpectNear(State, TwoBody(AfterBurn, 6000.), 1e-5, 1e-8);
+}
+
+
+TEST(MaxQHybridTest, Errors) {
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+
+    FTrajectory Trajectory;
+    FSStateVector State;
+    EXPECT_EQ(Trajectory.FindSegment(FSEphemerisTime()), INDEX_NONE);
+    EXPECT_FALSE(Trajectory.Evaluate(FSEphemerisTime(), State, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+    EXPECT_FALSE(Trajectory.Maneuver(FSEphemerisTime(), FSVelocityVector(), ESegment::Conic, &ResultCode, &ErrorMessage));
+
+    const double s[6] = { 7000., 0., 0., 0., 7.5, 1. };
+    EXPECT_FALSE(Trajectory.AddState(FSEphemerisTime(), FSStateVector(s), ESegment::Tle, &ResultCode, &ErrorMessage));
+    EXPECT_FALSE(Trajectory.AddState(FSEphemerisTime(), FSStateVector(s), ESegment::Numerical, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(Trajectory.Num(), 0);
+
+    Propagator::FForceModel Model;
+    Model.GM = EarthGM;
+    Model.Frame = TEXT("ECLIPJ2000");
+    Trajectory.SetForceModel(Model);
+    EXPECT_FALSE(Trajectory.AddState(FSEphemerisTime(), FSStateVector(s), ESegment::Numerical, &ResultCode, &ErrorMessage));
+
+    // Degenerate states have no conic
+    const double Falling[6] = { 7000., 0., 0., -1., 0., 0. };
+    EXPECT_FALSE(Trajectory.AddState(FSEphemerisTime(), FSStateVector(Falling), ESegment::Conic, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(Trajectory.Num(), 0);
+
+    EXPECT_TRUE(Trajectory.AddState(FSEphemerisTime(), FSStateVector(s), ESegment::Conic, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    EXPECT_TRUE(ErrorMessage.IsEmpty());
+}
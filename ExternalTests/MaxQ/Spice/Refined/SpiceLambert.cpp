@@ -0,0 +1,159 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceLambert.h"
+
+using namespace MaxQ::Lambert;
+
+namespace
+{
+    const FSMassConstant SunGM(1.32712440018e11);
+
+    // Propagates (r1, v1) by tof and checks it arrives at (r2, v2)
+    void ExpectArrives(const FSDistanceVector& r1, const FSVelocityVector& v1, const FSDistanceVector& r2, const FSVelocityVector& v2, double tof)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSStateVector Arrival;
+        USpice::prop2b(ResultCode, ErrorMessage, SunGM, FSStateVector(r1, v1), FSEphemerisPeriod(tof), Arrival);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+        const double r = r2.Magnitude().km;
+        EXPECT_NEAR(Arrival.r.x.km, r2.x.km, r * 1e-9);
+        EXPECT_NEAR(Arrival.r.y.km, r2.y.km, r * 1e-9);
+        EXPECT_NEAR(Arrival.r.z.km, r2.z.km, r * 1e-9);
+
+        const double v = v2.Magnitude().kmps;
+        EXPECT_NEAR(Arrival.v.dx.kmps, v2.dx.kmps, v * 1e-9);
+        EXPECT_NEAR(Arrival.v.dy.kmps, v2.dy.kmps, v * 1e-9);
+        EXPECT_NEAR(Arrival.v.dz.kmps, v2.dz.kmps, v * 1e-9);
+    }
+
+    // Circular orbits, roughly Earth's and Mars'
+    FSStateVector Circular(double r, double et, double Phase, double z = 0.)
+    {
+        const double v = FMath::Sqrt(SunGM.GM / r);
+        const double Angle = Phase + et * v / r;
+        return FSStateVector(
+            FSDistanceVector(r * FMath::Cos(Angle), r * FMath::Sin(Angle), z),
+            FSVelocityVector(-v * FMath::Sin(Angle), v * FMath::Cos(Angle), 0.)
+        );
+    }
+}
+
+
+TEST(MaxQLambertTest, Transfer_Reaches_Target) {
+    const FSDistanceVector r1(1.496e8, 0., 0.);
+    const double tof = 200. * 86400.;
+
+    // Short and long way, prograde and retrograde
+    for (const FSDistanceVector& r2 : { FSDistanceVector(-1.5e8, 1.6e8, 3.e6), FSDistanceVector(-1.5e8, -1.6e8, -3.e6) })
+    {
+        for (bool bRetrograde : { false, true })
+        {
+            FSVelocityVector v1, v2;
+            EXPECT_TRUE(Solve(r1, r2, FSEphemerisPeriod(tof), SunGM, v1, v2, bRetrograde));
+            ExpectArrives(r1, v1, r2, v2, tof);
+
+            // Prograde transfers turn counter-clockwise about +z
+            const double hz = r1.x.km * v1.dy.kmps - r1.y.km * v1.dx.kmps;
+            EXPECT_EQ(hz > 0., !bRetrograde);
+        }
+    }
+}
+
+
+TEST(MaxQLambertTest, Multi_Revolution_Transfers_Reach_Target) {
+    const FSDistanceVector r1(1.496e8, 0., 0.);
+    const FSDistanceVector r2(-1.2e8, 1.9e8, 5.e6);
+    const double tof = 1500. * 86400.;
+
+    TArray<FSolution> Solutions;
+    EXPECT_TRUE(Solve(r1, r2, FSEphemerisPeriod(tof), SunGM, Solutions, 2));
+
+    // Zero revolutions, then two per revolution count
+    ASSERT_EQ(Solutions.Num(), 5);
+    EXPECT_EQ(Solutions[0].Revolutions, 0);
+    EXPECT_EQ(Solutions[1].Revolutions, 1);
+    EXPECT_EQ(Solutions[2].Revolutions, 1);
+    EXPECT_EQ(Solutions[3].Revolutions, 2);
+    EXPECT_EQ(Solutions[4].Revolutions, 2);
+
+    for (const FSolution& Solution : Solutions)
+    {
+        ExpectArrives(r1, Solution.v1, r2, Solution.v2, tof);
+    }
+
+    // Too short for any revolutions
+    EXPECT_TRUE(Solve(r1, r2, FSEphemerisPeriod(100. * 86400.), SunGM, Solutions, 2));
+    EXPECT_EQ(Solutions.Num(), 1);
+}
+
+
+TEST(MaxQLambertTest, Porkchop_Matches_Solve) {
+    TArray<FSEphemerisTime> DepartureTimes, ArrivalTimes;
+    TArray<FSStateVector> DepartureStates, ArrivalStates;
+
+    for (int i = 0; i < 7; ++i)
+    {
+        DepartureTimes.Add(FSEphemerisTime(i * 20. * 86400.));
+        DepartureStates.Add(Circular(1.496e8, DepartureTimes.Last().seconds, 0.));
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        ArrivalTimes.Add(FSEphemerisTime((100. + i * 40.) * 86400.));
+        ArrivalStates.Add(Circular(2.279e8, ArrivalTimes.Last().seconds, 1., 2.e6));
+    }
+
+    TArray<double> C3, VInfinity;
+    C3.SetNum(DepartureTimes.Num() * ArrivalTimes.Num());
+    VInfinity.SetNum(C3.Num());
+    EXPECT_TRUE(Porkchop(DepartureTimes, DepartureStates, ArrivalTimes, ArrivalStates, SunGM, C3, VInfinity));
+
+    for (int a = 0; a < ArrivalTimes.Num(); ++a)
+    {
+        for (int d = 0; d < DepartureTimes.Num(); ++d)
+        {
+            const int Cell = a * DepartureTimes.Num() + d;
+            const double tof = ArrivalTimes[a].seconds - DepartureTimes[d].seconds;
+
+            if (tof <= 0.)
+            {
+                EXPECT_EQ(C3[Cell], NoTransfer);
+                EXPECT_EQ(VInfinity[Cell], NoTransfer);
+                continue;
+            }
+
+            FSVelocityVector v1, v2;
+            EXPECT_TRUE(Solve(DepartureStates[d].r, ArrivalStates[a].r, FSEphemerisPeriod(tof), SunGM, v1, v2));
+
+            const FSVelocityVector Departure = v1 - DepartureStates[d].v;
+            const FSVelocityVector Arrival = v2 - ArrivalStates[a].v;
+            EXPECT_NEAR(C3[Cell], Departure.Magnitude().kmps * Departure.Magnitude().kmps, 1e-9);
+            EXPECT_NEAR(VInfinity[Cell], Arrival.Magnitude().kmps, 1e-9);
+        }
+    }
+}
+
+
+TEST(MaxQLambertTest, Degenerate_Geometry_Is_Error) {
+    const FSDistanceVector r1(1.496e8, 0., 0.);
+    FSVelocityVector v1, v2;
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+
+    // 180 degree transfer: no unique plane
+    EXPECT_FALSE(Solve(r1, FSDistanceVector(-2.e8, 0., 0.), FSEphemerisPeriod(1.e7), SunGM, v1, v2, false, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    EXPECT_FALSE(Solve(r1, FSDistanceVector(0., 2.e8, 0.), FSEphemerisPeriod(-1.e7), SunGM, v1, v2));
+    EXPECT_FALSE(Solve(FSDistanceVector(), FSDistanceVector(0., 2.e8, 0.), FSEphemerisPeriod(1.e7), SunGM, v1, v2));
+    EXPECT_FALSE(Solve(r1, FSDistanceVector(0., 2.e8, 0.), FSEphemerisPeriod(1.e7), FSMassConstant(0.), v1, v2));
+}
@@ -0,0 +1,272 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpicePasses.h"
+#include "SpicePropagator.h"
+#include <cstdio>
+
+using namespace MaxQ;
+using Passes::FPass;
+using Passes::FStation;
+
+namespace
+{
+    constexpr double Epoch = 7e8;
+    constexpr double Day = 86400.;
+
+    // Station-like, sun-synchronous, and Molniya (deep space)
+    Sgp4::FTleBatch MakeBatch()
+    {
+        Sgp4::FTleBatch Batch;
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 51.6, 30., 0.0005, 0., 0., 15.5)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 97.5, 200., 0.001, 90., 120., 14.8)));
+        EXPECT_TRUE(Batch.Add(TleElements(Epoch, 63.4, 100., 0.72, 270., 0., 2.006)));
+        return Batch;
+    }
+
+    FStation Station(double Latitude, double Longitude, double Altitude, double Mask)
+    {
+        FStation Result;
+        Result.Latitude = FSAngle::FromDegrees(Latitude);
+        Result.Longitude = FSAngle::FromDegrees(Longitude);
+        Result.Altitude = FSDistance(Altitude);
+        Result.MinimumElevation = FSAngle::FromDegrees(Mask);
+        return Result;
+    }
+
+    const FStation Stations[] = {
+        Station(40., -105., 1.6, 0.),
+        Station(-35.4, 148.98, 0.7, 10.),
+        Station(69.7, 18.9, 0.1, 5.)
+    };
+    constexpr int32 NumStations = sizeof(Stations) / sizeof(Stations[0]);
+
+    // Sine of the elevation of an Earth-fixed position (km) above a station,
+    // on WGS-84
+    double SinElevation(const FStation& Station, const double* r)
+    {
+        const double f = 1. / 298.257223563, e2 = f * (2. - f);
+        const double Lat = Station.Latitude.AsRadians(), Lon = Station.Longitude.AsRadians();
+        const double N = 6378.137 / FMath::Sqrt(1. - e2 * FMath::Square(FMath::Sin(Lat)));
+        const double Up[3] = { FMath::Cos(Lat) * FMath::Cos(Lon), FMath::Cos(Lat) * FMath::Sin(Lon), FMath::Sin(Lat) };
+        const double s[3] = { (N + Station.Altitude.km) * Up[0], (N + Station.Altitude.km) * Up[1], (N * (1. - e2) + Station.Altitude.km) * Up[2] };
+        const double rho[3] = { r[0] - s[0], r[1] - s[1], r[2] - s[2] };
+        return (rho[0] * Up[0] + rho[1] * Up[1] + rho[2] * Up[2]) / FMath::Sqrt(rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2]);
+    }
+
+    // Earth-fixed positions of every satellite
+    void EarthFixed(const Sgp4::FTleBatch& Batch, double et, TArray<FSStateVector>& States, TArray<double>& Positions)
+    {
+        Batch.Evaluate(FSEphemerisTime(et), States);
+        const double Theta = Gmst(et);
+
+        Positions.SetNum(States.Num() * 3);
+        for (int32 i = 0; i < States.Num(); ++i)
+        {
+            double s[6];
+            States[i].CopyTo(s);
+            Positions[i * 3 + 0] = FMath::Cos(Theta) * s[0] + FMath::Sin(Theta) * s[1];
+            Positions[i * 3 + 1] = -FMath::Sin(Theta) * s[0] + FMath::Cos(Theta) * s[1];
+            Positions[i * 3 + 2] = s[2];
+        }
+    }
+
+    // The same, with velocities, for one satellite
+    FSStateVector EarthFixedState(const Sgp4::FTleBatch& Batch, int32 Satellite, double et)
+    {
+        TArray<FSStateVector> States;
+        States.SetNum(Batch.Num());
+        Batch.Evaluate(FSEphemerisTime(et), States);
+        const double Theta = Gmst(et), c = FMath::Cos(Theta), s = FMath::Sin(Theta);
+        const double EarthRate = 7.29211514670698e-5;
+
+        double teme[6];
+        States[Satellite].CopyTo(teme);
+        const double x = c * teme[0] + s * teme[1], y = -s * teme[0] + c * teme[1];
+        const double vx = c * teme[3] + s * teme[4] + EarthRate * y;
+        const double vy = -s * teme[3] + c * teme[4] - EarthRate * x;
+        return FSStateVector(FSDistanceVector(x, y, teme[2]), FSVelocityVector(vx, vy, teme[5]));
+    }
+}
+
+
+TEST(MaxQPassesTest, Tle_Matches_BruteForce) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const Sgp4::FTleBatch Batch = MakeBatch();
+    const int32 Count = Batch.Num();
+
+    TArray<FPass> Found;
+    EXPECT_TRUE(Passes::Predict(Batch, Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + Day), Found));
+    EXPECT_GT(Found.Num(), 10);
+
+    // Every second: rises, sets and the highest elevation in between
+    TArray<FSStateVector> States;
+    TArray<double> Positions;
+    States.SetNum(Count);
+
+    struct FBrute { int32 Satellite = 0; double Rise = 0.; double Set = 0.; double Max = -1.; };
+    TArray<FBrute> Expected[NumStations];
+    bool bUp[NumStations][3] = {};
+    FBrute Current[NumStations][3];
+    for (double t = Epoch; t <= Epoch + Day; t += 1.)
+    {
+        EarthFixed(Batch, t, States, Positions);
+        for (int32 s = 0; s < NumStations; ++s)
+        {
+            const double SinMask = FMath::Sin(Stations[s].MinimumElevation.AsRadians());
+            for (int32 i = 0; i < Count; ++i)
+            {
+                const double Sine = SinElevation(Stations[s], &Positions[i * 3]);
+                const bool bAbove = Sine > SinMask;
+                if (bAbove && !bUp[s][i])
+                {
+                    Current[s][i] = FBrute();
+                    Current[s][i].Satellite = i;
+                    Current[s][i].Rise = t;
+                }
+                if (bAbove)
+                {
+                    Current[s][i].Max = FMath::Max(Current[s][i].Max, Sine);
+                }
+                if ((!bAbove || t + 1. > Epoch + Day) && bUp[s][i])
+                {
+                    Current[s][i].Set = t;
+                    Expected[s].Add(Current[s][i]);
+                }
+                bUp[s][i] = bAbove;
+            }
+        }
+    }
+
+    int32 NumExpected = 0;
+    for (int32 s = 0; s < NumStations; ++s)
+    {
+        NumExpected += Expected[s].Num();
+        for (const FBrute& Brute : Expected[s])
+        {
+            const int32 Match = Found.IndexOfByPredicate([&](const FPass& Pass)
+            {
+                return Pass.Station == s && Pass.Satellite == Brute.Satellite && FMath::Abs(Pass.Rise.seconds - Brute.Rise) <= 1.;
+            });
+            ASSERT_NE(Match, INDEX_NONE);
+
+            const FPass& Pass = Found[Match];
+            EXPECT_NEAR(Pass.Set.seconds, Brute.Set, 1.);
+            EXPECT_TRUE(Pass.Rise.seconds <= Pass.Culmination.seconds && Pass.Culmination.seconds <= Pass.Set.seconds);
+            // The brute force's highest is up to half a second off the peak, and
+            // the peak is found on interpolated states
+            EXPECT_GE(FMath::Sin(Pass.MaximumElevation.AsRadians()), Brute.Max - 1e-6);
+            EXPECT_LE(FMath::Sin(Pass.MaximumElevation.AsRadians()), Brute.Max + 2e-4);
+        }
+    }
+    EXPECT_EQ(Found.Num(), NumExpected);
+
+    // Rises and sets are on the mask, with exact (not interpolated) states
+    for (const FPass& Pass : Found)
+    {
+        const double SinMask = FMath::Sin(Stations[Pass.Station].MinimumElevation.AsRadians());
+        for (const double t : { Pass.Rise.seconds, Pass.Set.seconds })
+        {
+            if (t > Epoch && t < Epoch + Day)
+            {
+                EarthFixed(Batch, t, States, Positions);
+                EXPECT_NEAR(SinElevation(Stations[Pass.Station], &Positions[Pass.Satellite * 3]), SinMask, 1e-5);
+            }
+        }
+    }
+
+    // Sorted by rise
+    for (int32 n = 1; n < Found.Num(); ++n)
+    {
+        EXPECT_TRUE(Found[n - 1].Rise.seconds <= Found[n].Rise.seconds);
+    }
+}
+
+
+TEST(MaxQPassesTest, Spk_Matches_Tle) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // The first satellite's Earth-fixed states, written to an SPK, have the
+    // same passes.  The frame's label is J2000, but it's Earth-fixed.
+    const char* SatelliteSpk = "maxq_passes_test.bsp";
+    std::remove(SatelliteSpk);
+
+    const Sgp4::FTleBatch Batch = MakeBatch();
+    TArray<FSEphemerisTime> ets;
+    TArray<FSStateVector> States;
+    for (double t = Epoch - 600.; t <= Epoch + Day + 600.; t += 20.)
+    {
+        ets.Add(FSEphemerisTime(t));
+        States.Add(EarthFixedState(Batch, 0, t));
+    }
+    EXPECT_TRUE(Propagator::WriteSpk(SatelliteSpk, TEXT("-9201"), TEXT("EARTH"), TEXT("J2000"), ets, States));
+    USpice::furnsh_absolute(SatelliteSpk);
+
+    TArray<FPass> FromTle, FromSpk;
+    EXPECT_TRUE(Passes::Predict(Batch, Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + Day), FromTle));
+    FromTle.RemoveAll([](const FPass& Pass) { return Pass.Satellite != 0; });
+
+    const FString Targets[] = { TEXT("-9201") };
+    EXPECT_TRUE(Passes::Predict(Targets, TEXT("J2000"), Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + Day), FromSpk));
+    ASSERT_EQ(FromSpk.Num(), FromTle.Num());
+    EXPECT_GT(FromSpk.Num(), 3);
+
+    for (int32 n = 0; n < FromSpk.Num(); ++n)
+    {
+        EXPECT_EQ(FromSpk[n].Station, FromTle[n].Station);
+        EXPECT_EQ(FromSpk[n].Satellite, 0);
+        EXPECT_NEAR(FromSpk[n].Rise.seconds, FromTle[n].Rise.seconds, 0.01);
+        EXPECT_NEAR(FromSpk[n].Set.seconds, FromTle[n].Set.seconds, 0.01);
+        EXPECT_NEAR(FromSpk[n].MaximumElevation.AsRadians(), FromTle[n].MaximumElevation.AsRadians(), 1e-6);
+    }
+
+    std::remove(SatelliteSpk);
+}
+
+
+TEST(MaxQPassesTest, Sort) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    TArray<FPass> Found;
+    EXPECT_TRUE(Passes::Predict(MakeBatch(), Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + 0.5 * Day), Found));
+    ASSERT_GT(Found.Num(), 3);
+
+    Passes::Sort(Found, Passes::EPassOrder::Station);
+    for (int32 n = 1; n < Found.Num(); ++n)
+    {
+        EXPECT_TRUE(Found[n - 1].Station < Found[n].Station || (Found[n - 1].Station == Found[n].Station && Found[n - 1].Rise.seconds <= Found[n].Rise.seconds));
+    }
+
+    Passes::Sort(Found, Passes::EPassOrder::MaximumElevation);
+    for (int32 n = 1; n < Found.Num(); ++n)
+    {
+        EXPECT_TRUE(Found[n - 1].MaximumElevation.AsRadians() >= Found[n].MaximumElevation.AsRadians());
+    }
+
+    Passes::Sort(Found, Passes::EPassOrder::Duration);
+    for (int32 n = 1; n < Found.Num(); ++n)
+    {
+        EXPECT_TRUE(Found[n - 1].Set.seconds - Found[n - 1].Rise.seconds >= Found[n].Set.seconds - Found[n].Rise.seconds);
+    }
+
+    // Bad arguments
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Passes::Predict(MakeBatch(), Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch), Found, Passes::FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+
+    const FString Unknown[] = { TEXT("NO SUCH BODY") };
+    EXPECT_FALSE(Passes::Predict(Unknown, TEXT("IAU_EARTH"), Stations, FSEphemerisTime(Epoch), FSEphemerisTime(Epoch + Day), Found, Passes::FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+}
@@ -0,0 +1,231 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpicePatchedConics.h"
+#include "SpicePropagator.h"
+#include <cstdio>
+
+using namespace MaxQ;
+using namespace MaxQ::PatchedConics;
+
+namespace
+{
+    const FSMassConstant MoonGM(4902.8);
+    const double MoonDistance = 384400.;
+    const double Span = 300000.;
+    const char* MoonSpk = "maxq_patched_conics_test.bsp";
+
+    FSStateVector MoonState(double et)
+    {
+        const FSStateVector Start(FSDistanceVector(MoonDistance, 0., 0.), FSVelocityVector(0., FMath::Sqrt(EarthGM.GM / MoonDistance), 0.));
+        return TwoBody(Start, et);
+    }
+
+    // An earth and a moon on a circular orbit about it, from an SPK written
+    // for the test
+    FSystem LoadEarthMoon()
+    {
+        USpice::init_all();
+        std::remove(MoonSpk);
+
+        TArray<FSEphemerisTime> ets;
+        TArray<FSStateVector> States;
+        for (double et = -3600.; et <= Span + 3600.; et += 600.)
+        {
+            ets.Add(FSEphemerisTime(et));
+            States.Add(MoonState(et));
+        }
+        EXPECT_TRUE(Propagator::WriteSpk(MoonSpk, TEXT("-9101"), TEXT("-9100"), TEXT("J2000"), ets, States));
+        USpice::furnsh_absolute(MoonSpk);
+
+        FSystem System;
+        System.Bodies.Add(FBody{ TEXT("-9100"), EarthGM, FSDistance(), INDEX_NONE });
+        System.Bodies.Add(FBody{ TEXT("-9101"), MoonGM, FSDistance(MoonDistance * FMath::Pow(MoonGM.GM / EarthGM.GM, 0.4)), 0 });
+        return System;
+    }
+
+    // Behind the moon, closing on it at about 1 km/s
+    FSStateVector Approach()
+    {
+        FSStateVector Moon = MoonState(0.);
+        return FSStateVector(Moon.r + FSDistanceVector(-5000., -80000., 0.), Moon.v + FSVelocityVector(0., 1., 0.));
+    }
+}
+
+
+TEST(MaxQPatchedConicsTest, Single_Body_Matches_prop2b) {
+    FSystem System;
+    System.Bodies.Add(FBody{ TEXT("EARTH"), EarthGM, FSDistance(), INDEX_NONE });
+
+    const FSStateVector State(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.));
+    FTrajectory Trajectory;
+    EXPECT_TRUE(Trajectory.Build(System, 0, State, FSEphemerisTime(100.), FSEphemerisTime(50000.)));
+    EXPECT_EQ(Trajectory.NumLegs(), 1);
+
+    TArray<FSEphemerisTime> ets;
+    for (int i = 0; i < 50; ++i)
+    {
+        ets.Add(FSEphemerisTime(50000. - i * 997.));
+    }
+
+    TArray<FSStateVector> States;
+    States.SetNum(ets.Num());
+    EXPECT_TRUE(Trajectory.Evaluate(ets, States));
+
+    for (int i = 0; i < ets.Num(); ++i)
+    {
+        ExpectNear(States[i], TwoBody(State, ets[i].seconds - 100.), 1e-6);
+    }
+
+    // Outside the trajectory
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    FSStateVector Outside = State;
+    EXPECT_FALSE(Trajectory.Evaluate(FSEphemerisTime(0.), Outside, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    ExpectNear(Outside, State, 0.);
+}
+
+
+TEST(MaxQPatchedConicsTest, Flyby_Crosses_Sphere_Of_Influence) {
+    const FSystem System = LoadEarthMoon();
+    const double Soi = System.Bodies[1].SphereOfInfluence.km;
+
+    FTrajectory Trajectory;
+    FSettings Settings;
+    Settings.EphemerisStep = FSEphemerisPeriod(600.);
+    EXPECT_TRUE(Trajectory.Build(System, 0, Approach(), FSEphemerisTime(0.), FSEphemerisTime(Span), Settings));
+
+    // Earth, moon, earth
+    ASSERT_EQ(Trajectory.NumLegs(), 3);
+    EXPECT_EQ(Trajectory.GetLeg(0).Body, 0);
+    EXPECT_EQ(Trajectory.GetLeg(1).Body, 1);
+    EXPECT_EQ(Trajectory.GetLeg(2).Body, 0);
+
+    for (int Leg = 1; Leg <= 2; ++Leg)
+    {
+        const double Crossing = Trajectory.GetLeg(Leg).Begin.seconds;
+        EXPECT_EQ(Trajectory.FindLeg(FSEphemerisTime(Crossing)), Leg);
+        EXPECT_EQ(Trajectory.FindLeg(FSEphemerisTime(Crossing - 1e-3)), Leg - 1);
+
+        // On the boundary, against the moon's SPK state
+        FSStateVector State;
+        EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Crossing), State));
+        const FSStateVector Moon = MoonState(Crossing);
+        double r[3], m[3];
+        State.r.CopyTo(r);
+        Moon.r.CopyTo(m);
+        const double Distance = FMath::Sqrt((r[0] - m[0]) * (r[0] - m[0]) + (r[1] - m[1]) * (r[1] - m[1]) + (r[2] - m[2]) * (r[2] - m[2]));
+        EXPECT_NEAR(Distance, Soi, 0.01);
+
+        // Continuous across it
+        FSStateVector Before, After;
+        EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Crossing - 1e-3), Before));
+        EXPECT_TRUE(Trajectory.Evaluate(FSEphemerisTime(Crossing + 1e-3), After));
+        ExpectNear(Before, After, 0.01);
+    }
+
+    // A moon leg is a conic about the moon
+    const FLeg& MoonLeg = Trajectory.GetLeg(1);
+    const double Middle = 0.5 * (MoonLeg.Begin.seconds + Trajectory.GetLeg(2).Begin.seconds);
+    FSStateVector Start, Local;
+    int32 Body = INDEX_NONE;
+    EXPECT_TRUE(Trajectory.EvaluateLocal(MoonLeg.Begin, Start, Body));
+    EXPECT_TRUE(Trajectory.EvaluateLocal(FSEphemerisTime(Middle), Local, Body));
+    EXPECT_EQ(Body, 1);
+    ExpectNear(Local, TwoBody(Start, Middle - MoonLeg.Begin.seconds, MoonGM), 1e-5);
+
+    // The batch matches single evaluations
+    TArray<FSEphemerisTime> ets;
+    for (int i = 0; i <= 300; ++i)
+    {
+        ets.Add(FSEphemerisTime(i * Span / 300.));
+    }
+    TArray<FSStateVector> States;
+    States.SetNum(ets.Num());
+    EXPECT_TRUE(Trajectory.Evaluate(ets, States));
+    for (int i = 0; i < ets.Num(); i += 37)
+    {
+        FSStateVector State;
+        EXPECT_TRUE(Trajectory.Evaluate(ets[i], State));
+        ExpectNear(States[i], State, 0.);
+    }
+
+    std::remove(MoonSpk);
+}
+
+
+TEST(MaxQPatchedConicsTest, Failed_Build_Discards_Trajectory) {
+    const FSystem System = LoadEarthMoon();
+
+    FTrajectory Trajectory;
+    FSettings Settings;
+    Settings.EphemerisStep = FSEphemerisPeriod(600.);
+    EXPECT_TRUE(Trajectory.Build(System, 0, Approach(), FSEphemerisTime(0.), FSEphemerisTime(Span), Settings));
+    EXPECT_EQ(Trajectory.NumLegs(), 3);
+
+    // The flyby needs three legs
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    Settings.MaxLegs = 2;
+    EXPECT_FALSE(Trajectory.Build(System, 0, Approach(), FSEphemerisTime(0.), FSEphemerisTime(Span), Settings, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(Trajectory.NumLegs(), 0);
+    EXPECT_EQ(Trajectory.Begin().seconds, Trajectory.End().seconds);
+
+    // Neither the partial trajectory nor the previous one is evaluated
+    const FSStateVector Unchanged = Approach();
+    TArray<FSEphemerisTime> ets = { FSEphemerisTime(0.), FSEphemerisTime(Span / 2.) };
+    TArray<FSStateVector> States = { Unchanged, Unchanged };
+    ResultCode = ES_ResultCode::Success;
+    EXPECT_FALSE(Trajectory.Evaluate(ets, States, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    for (const FSStateVector& State : States)
+    {
+        ExpectNear(State, Unchanged, 0.);
+    }
+
+    std::remove(MoonSpk);
+}
+
+
+TEST(MaxQPatchedConicsTest, Invalid_Input_Is_Error) {
+    FSystem System;
+    System.Bodies.Add(FBody{ TEXT("EARTH"), EarthGM, FSDistance(), INDEX_NONE });
+    const FSStateVector State(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.));
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    FTrajectory Trajectory;
+
+    // Backwards
+    EXPECT_FALSE(Trajectory.Build(System, 0, State, FSEphemerisTime(10.), FSEphemerisTime(0.), FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+
+    // No such body
+    ResultCode = ES_ResultCode::Success;
+    EXPECT_FALSE(Trajectory.Build(System, 1, State, FSEphemerisTime(0.), FSEphemerisTime(10.), FSettings(), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+
+    // Not built, which leaves the states alone
+    FSStateVector Result = State;
+    ResultCode = ES_ResultCode::Success;
+    EXPECT_FALSE(Trajectory.Evaluate(FSEphemerisTime(0.), Result, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    ExpectNear(Result, State, 0.);
+
+    // A second root, and a parent that isn't in the system
+    ResultCode = ES_ResultCode::Success;
+    EXPECT_FALSE(AddBody(System, TEXT("MOON"), TEXT(""), FSEphemerisTime(0.), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    ResultCode = ES_ResultCode::Success;
+    EXPECT_FALSE(AddBody(System, TEXT("PHOBOS"), TEXT("MARS"), FSEphemerisTime(0.), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(System.Bodies.Num(), 1);
+}
@@ -0,0 +1,233 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpicePropagator.h"
+#include <cstdio>
+
+using namespace MaxQ::Propagator;
+
+namespace
+{
+    const FSStateVector LowOrbit(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 7.5, 1.));
+    const char* SpkFile = "maxq_propagator_test.bsp";
+
+    FSettings Settings(EIntegrator Integrator)
+    {
+        FSettings Result;
+        Result.Integrator = Integrator;
+        return Result;
+    }
+}
+
+
+TEST(MaxQPropagatorTest, Two_Body_Matches_prop2b) {
+    FForceModel Model;
+    Model.GM = EarthGM;
+
+    TArray<FSEphemerisTime> ets;
+    for (int i = 1; i <= 100; ++i)
+    {
+        ets.Add(FSEphemerisTime(i * 864. + 0.37));
+    }
+
+    for (EIntegrator Integrator : { EIntegrator::DormandPrince853, EIntegrator::GaussJackson8 })
+    {
+        TArray<FSStateVector> States;
+        States.SetNum(ets.Num());
+        EXPECT_TRUE(Propagate(Model, Settings(Integrator), LowOrbit, FSEphemerisTime(), ets, States));
+
+        for (int i = 0; i < ets.Num(); ++i)
+        {
+            ExpectNear(States[i], TwoBody(LowOrbit, ets[i].seconds), 1e-5);
+        }
+
+        // Backwards
+        TArray<FSEphemerisTime> Earlier;
+        for (int i = 1; i <= 50; ++i)
+        {
+            Earlier.Add(FSEphemerisTime(-i * 1000.));
+        }
+        States.SetNum(Earlier.Num());
+        EXPECT_TRUE(Propagate(Model, Settings(Integrator), LowOrbit, FSEphemerisTime(), Earlier, States));
+
+        for (int i = 0; i < Earlier.Num(); ++i)
+        {
+            ExpectNear(States[i], TwoBody(LowOrbit, Earlier[i].seconds), 1e-5);
+        }
+    }
+}
+
+
+TEST(MaxQPropagatorTest, Maneuver_Changes_Velocity_At_Its_Epoch) {
+    FForceModel Model;
+    Model.GM = EarthGM;
+
+    FManeuver Burn;
+    Burn.et = FSEphemerisTime(5000.37);
+    Burn.dv = FSVelocityVector(0.01, 0.02, -0.01);
+
+    FSStateVector AfterBurn = TwoBody(LowOrbit, Burn.et.seconds);
+    AfterBurn.v += Burn.dv;
+
+    const TArray<FSEphemerisTime> ets{ FSEphemerisTime(3000.), Burn.et, FSEphemerisTime(20000.) };
+
+    for (EIntegrator Integrator : { EIntegrator::DormandPrince853, EIntegrator::GaussJackson8 })
+    {
+        TArray<FSStateVector> States;
+        States.SetNum(ets.Num());
+        EXPECT_TRUE(Propagate(Model, Settings(Integrator), LowOrbit, FSEphemerisTime(), ets, States, { Burn }));
+
+        ExpectNear(States[0], TwoBody(LowOrbit, 3000.), 1e-5);
+        ExpectNear(States[1], AfterBurn, 1e-5);
+        ExpectNear(States[2], TwoBody(AfterBurn, 20000. - Burn.et.seconds), 1e-5);
+    }
+}
+
+
+TEST(MaxQPropagatorTest, Batch_Matches_Single) {
+    FForceModel Model;
+    Model.GM = EarthGM;
+    Model.J[2] = 1.082616e-3;
+    Model.ReferenceRadius = FSDistance(6378.135);
+
+    TArray<FSStateVector> Initial;
+    for (int i = 0; i < 10; ++i)
+    {
+        Initial.Add(FSStateVector(FSDistanceVector(7000. + i * 100., 0., 0.), FSVelocityVector(0., 7.5 - i * 0.01, 1.)));
+    }
+
+    const FSEphemerisTime etEnd(86400.);
+    for (EIntegrator Integrator : { EIntegrator::DormandPrince853, EIntegrator::GaussJackson8 })
+    {
+        TArray<FSStateVector> Batch = Initial;
+        EXPECT_TRUE(Propagate(Model, Settings(Integrator), Batch, FSEphemerisTime(), etEnd));
+
+        for (int i = 0; i < Initial.Num(); ++i)
+        {
+            FSStateVector Single;
+            EXPECT_TRUE(Propagate(Model, Settings(Integrator), Initial[i], FSEphemerisTime(), { etEnd }, TArrayView<FSStateVector>(&Single, 1)));
+            ExpectNear(Batch[i], Single, 1e-9);
+        }
+    }
+}
+
+
+TEST(MaxQPropagatorTest, J2_Regresses_The_Node) {
+    FForceModel Model;
+    Model.GM = EarthGM;
+    Model.J[2] = 1.082616e-3;
+    Model.ReferenceRadius = FSDistance(6378.135);
+
+    // Circular, inclined 40 degrees
+    const double r = 7000.;
+    const double v = FMath::Sqrt(EarthGM.GM / r);
+    const double Inclination = 0.7;
+    const FSStateVector State(FSDistanceVector(r, 0., 0.), FSVelocityVector(0., v * FMath::Cos(Inclination), v * FMath::Sin(Inclination)));
+
+    const double Days = 10.;
+    FSStateVector Final;
+    EXPECT_TRUE(Propagate(Model, FSettings(), State, FSEphemerisTime(), { FSEphemerisTime(Days * 86400.) }, TArrayView<FSStateVector>(&Final, 1)));
+
+    // The node started at +x
+    const double hx = Final.r.y.km * Final.v.dz.kmps - Final.r.z.km * Final.v.dy.kmps;
+    const double hy = Final.r.z.km * Final.v.dx.kmps - Final.r.x.km * Final.v.dz.kmps;
+    const double Node = FMath::Atan2(hx, -hy);
+
+    const double n = FMath::Sqrt(EarthGM.GM / (r * r * r));
+    const double Expected = -1.5 * n * Model.J[2] * FMath::Square(Model.ReferenceRadius.km / r) * FMath::Cos(Inclination) * Days * 86400.;
+    EXPECT_NEAR(Node, Expected, FMath::Abs(Expected) * 0.01);
+}
+
+
+TEST(MaxQPropagatorTest, Invalid_Input_Is_Error) {
+    FForceModel Model;
+    Model.GM = EarthGM;
+    FSStateVector Final;
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+
+    // No GM
+    EXPECT_FALSE(Propagate(FForceModel(), FSettings(), LowOrbit, FSEphemerisTime(), { FSEphemerisTime(100.) }, TArrayView<FSStateVector>(&Final, 1), {}, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    // Output epochs out of order
+    const TArray<FSEphemerisTime> Unordered{ FSEphemerisTime(200.), FSEphemerisTime(100.) };
+    TArray<FSStateVector> States;
+    States.SetNum(Unordered.Num());
+    EXPECT_FALSE(Propagate(Model, FSettings(), LowOrbit, FSEphemerisTime(), Unordered, States));
+
+    // Too few steps allowed
+    FSettings Settings;
+    Settings.MaxSteps = 2;
+    EXPECT_FALSE(Propagate(Model, Settings, LowOrbit, FSEphemerisTime(), { FSEphemerisTime(86400.) }, TArrayView<FSStateVector>(&Final, 1)));
+}
+
+
+TEST(MaxQPropagatorTest, WriteSpk_Round_Trip) {
+    USpice::init_all();
+    std::remove(SpkFile);
+
+    FForceModel Model;
+    Model.GM = EarthGM;
+
+    TArray<FSEphemerisTime> ets;
+    for (int i = 0; i <= 100; ++i)
+    {
+        ets.Add(FSEphemerisTime(i * 60.));
+    }
+    TArray<FSStateVector> States;
+    States.SetNum(ets.Num());
+    EXPECT_TRUE(Propagate(Model, FSettings(), LowOrbit, FSEphemerisTime(), ets, States));
+
+    ES_ResultCode ResultCode = ES_ResultCode::Error;
+    FString ErrorMessage;
+    EXPECT_TRUE(WriteSpk(SpkFile, TEXT("-9200"), TEXT("399"), TEXT("J2000"), ets, States, TEXT("MaxQ propagation"), 7, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    USpice::furnsh_absolute(SpkFile);
+
+    // At the samples, and interpolated between them
+    for (double t : { 0., 60., 1230., 3000., 4321.5, 5999., 6000. })
+    {
+        FSStateVector State;
+        FSEphemerisPeriod lt;
+        USpice::spkezr(ResultCode, ErrorMessage, FSEphemerisTime(t), State, lt, TEXT("-9200"), TEXT("399"), TEXT("J2000"));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        ExpectNear(State, TwoBody(LowOrbit, t), 1e-5);
+    }
+
+    // Outside the segment
+    FSStateVector State;
+    FSEphemerisPeriod lt;
+    USpice::spkezr(ResultCode, ErrorMessage, FSEphemerisTime(6060.), State, lt, TEXT("-9200"), TEXT("399"), TEXT("J2000"));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+
+    USpice::init_all();
+    std::remove(SpkFile);
+
+    // An unknown frame, and a file that can't be created
+    ResultCode = ES_ResultCode::Success;
+    ErrorMessage.Empty();
+    EXPECT_FALSE(WriteSpk(SpkFile, TEXT("-9200"), TEXT("399"), TEXT("NOT_A_FRAME"), ets, States, TEXT("MaxQ propagation"), 7, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    ResultCode = ES_ResultCode::Success;
+    ErrorMessage.Empty();
+    EXPECT_FALSE(WriteSpk(TEXT("maxq_no_such_directory/maxq_propagator_test.bsp"), TEXT("-9200"), TEXT("399"), TEXT("J2000"), ets, States, TEXT("MaxQ propagation"), 7, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    // An even degree
+    EXPECT_FALSE(WriteSpk(SpkFile, TEXT("-9200"), TEXT("399"), TEXT("J2000"), ets, States, TEXT("MaxQ propagation"), 6));
+
+    USpice::init_all();
+    std::remove(SpkFile);
+}
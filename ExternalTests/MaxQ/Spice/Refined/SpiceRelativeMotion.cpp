@@ -0,0 +1,146 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceRelativeMotion.h"
+
+using namespace MaxQ;
+using RelativeMotion::EModel;
+
+namespace
+{
+    TArray<FSStateVector> SampleOffsets()
+    {
+        return {
+            FSStateVector(FSDistanceVector(0.01, 0., 0.), FSVelocityVector(0., 0., 0.)),
+            FSStateVector(FSDistanceVector(0., -0.02, 0.005), FSVelocityVector(0.00001, 0., 0.)),
+            FSStateVector(FSDistanceVector(0.003, 0.008, -0.01), FSVelocityVector(0., -0.00002, 0.00001))
+        };
+    }
+}
+
+
+TEST(MaxQRelativeMotionTest, Lvlh_Roundtrip) {
+    const FSStateVector Chief(FSDistanceVector(7000., 100., 300.), FSVelocityVector(0.5, 7.2, 1.));
+
+    TArray<FSStateVector> Deputies;
+    for (const FSStateVector& Offset : SampleOffsets())
+    {
+        Deputies.Add(Chief + Offset);
+    }
+
+    TArray<FSStateVector> Relative;
+    Relative.SetNum(Deputies.Num());
+    EXPECT_TRUE(RelativeMotion::ToLvlh(Chief, Deputies, Relative));
+
+    TArray<FSStateVector> Roundtrip;
+    Roundtrip.SetNum(Relative.Num());
+    EXPECT_TRUE(RelativeMotion::FromLvlh(Chief, Relative, Roundtrip));
+
+    for (int i = 0; i < Deputies.Num(); ++i)
+    {
+        ExpectNear(Roundtrip[i], Deputies[i], 1e-9, 1e-12);
+    }
+
+    // A deputy further out along the radius is +x, and moving with the frame
+    const FSStateVector Circular(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., FMath::Sqrt(EarthGM.GM / 7000.), 0.));
+    const double Rate = Circular.v.dy.kmps / 7000.;
+    TArray<FSStateVector> Above{ FSStateVector(FSDistanceVector(7001., 0., 0.), FSVelocityVector(0., Rate * 7001., 0.)) };
+    EXPECT_TRUE(RelativeMotion::ToLvlh(Circular, Above, Above));
+    ExpectNear(Above[0], FSStateVector(FSDistanceVector(1., 0., 0.), FSVelocityVector()), 1e-9, 1e-12);
+}
+
+
+TEST(MaxQRelativeMotionTest, YamanakaAnkersen_Matches_TwoBody) {
+    const FSStateVector Chiefs[] = {
+        // Eccentric (e ~ 0.27), inclined
+        FSStateVector(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 8.5, 0.5)),
+        // Past periapsis, climbing
+        FSStateVector(FSDistanceVector(7000., 100., 300.), FSVelocityVector(0.5, 7.2, 1.))
+    };
+
+    for (const FSStateVector& Chief : Chiefs)
+    {
+        TArray<FSStateVector> Deputies;
+        for (const FSStateVector& Offset : SampleOffsets())
+        {
+            Deputies.Add(Chief + Offset);
+        }
+
+        TArray<FSStateVector> Relative;
+        Relative.SetNum(Deputies.Num());
+        EXPECT_TRUE(RelativeMotion::ToLvlh(Chief, Deputies, Relative));
+
+        for (double dt : { 2000., 9000., -4000. })
+        {
+            TArray<FSStateVector> Propagated;
+            Propagated.SetNum(Relative.Num());
+            EXPECT_TRUE(RelativeMotion::Propagate(Chief, EarthGM, FSEphemerisPeriod(dt), Relative, Propagated));
+
+            TArray<FSStateVector> Expected;
+            for (const FSStateVector& Deputy : Deputies)
+            {
+                Expected.Add(TwoBody(Deputy, dt));
+            }
+            EXPECT_TRUE(RelativeMotion::ToLvlh(TwoBody(Chief, dt), Expected, Expected));
+
+            // Linearization error only: second order in a separation of ~10 m
+            for (int i = 0; i < Expected.Num(); ++i)
+            {
+                ExpectNear(Propagated[i], Expected[i], 2e-4, 2e-7);
+            }
+        }
+    }
+}
+
+
+TEST(MaxQRelativeMotionTest, ClohessyWiltshire_Matches_YamanakaAnkersen_When_Circular) {
+    const FSStateVector Chief(FSDistanceVector(0., 7000., 0.), FSVelocityVector(-FMath::Sqrt(EarthGM.GM / 7000.), 0., 0.));
+
+    Covariance::FStateMatrix CW, YA;
+    EXPECT_TRUE(RelativeMotion::Transition(Chief, EarthGM, FSEphemerisPeriod(3500.), CW, EModel::ClohessyWiltshire));
+    EXPECT_TRUE(RelativeMotion::Transition(Chief, EarthGM, FSEphemerisPeriod(3500.), YA, EModel::YamanakaAnkersen));
+
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            EXPECT_NEAR(CW.m[i][j], YA.m[i][j], 1e-8 * (FMath::Abs(CW.m[i][j]) + 1.));
+        }
+    }
+
+    // A zero dt is the identity
+    EXPECT_TRUE(RelativeMotion::Transition(Chief, EarthGM, FSEphemerisPeriod(0.), YA));
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            EXPECT_NEAR(YA.m[i][j], i == j ? 1. : 0., 1e-12);
+        }
+    }
+}
+
+
+TEST(MaxQRelativeMotionTest, Hyperbolic_Chief_Is_Error) {
+    const FSStateVector Chief(FSDistanceVector(7000., 0., 0.), FSVelocityVector(0., 11.2, 0.3));
+
+    TArray<FSStateVector> Relative = SampleOffsets();
+    const TArray<FSStateVector> Original = Relative;
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(RelativeMotion::Propagate(Chief, EarthGM, FSEphemerisPeriod(100.), Relative, Relative, EModel::YamanakaAnkersen, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+
+    // Left as they were
+    for (int i = 0; i < Relative.Num(); ++i)
+    {
+        ExpectNear(Relative[i], Original[i], 0., 0.);
+    }
+}
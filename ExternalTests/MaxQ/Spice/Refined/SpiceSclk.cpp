@@ -0,0 +1,186 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceSclk.h"
+
+using namespace MaxQ::Sclk;
+
+namespace
+{
+    void LoadTestKernels()
+    {
+        USpice::init_all();
+
+        ES_ResultCode ResultCode = ES_ResultCode::Success;
+        FString ErrorMessage;
+
+        USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+        USpice::get_implied_result(ResultCode, ErrorMessage);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    }
+
+    // See maxq_unit_test_sclk.tsc.  -9990 maps to TDB, -9991 to TDT.
+    const int TestClocks[] = { -9990, -9991 };
+}
+
+
+TEST(MaxQSclkTest, NoKernel_Is_Error) {
+    LoadTestKernels();
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    double sclkdp = 7.;
+
+    bool bSuccess = EtToTicks(-12345, FSEphemerisTime(0.), sclkdp, &ResultCode, &ErrorMessage);
+
+    EXPECT_FALSE(bSuccess);
+    EXPECT_FALSE(HasClock(-12345));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+    EXPECT_DOUBLE_EQ(sclkdp, 7.);
+}
+
+
+TEST(MaxQSclkTest, EtToTicks_Uses_Coefficients) {
+    LoadTestKernels();
+
+    for (int sc : TestClocks)
+    {
+        EXPECT_TRUE(HasClock(sc));
+
+        double sclkdp;
+        EXPECT_TRUE(EtToTicks(sc, FSEphemerisTime(0.), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 0.);
+        EXPECT_TRUE(EtToTicks(sc, FSEphemerisTime(100.), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 10000.);
+        EXPECT_TRUE(EtToTicks(sc, FSEphemerisTime(300.), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 25000.);
+        EXPECT_TRUE(EtToTicks(sc, FSEphemerisTime(7800.), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 400000.);
+
+        FSEphemerisTime et;
+        EXPECT_TRUE(TicksToEt(sc, 1234., et));
+        EXPECT_DOUBLE_EQ(et.seconds, 12.34);
+        EXPECT_TRUE(TicksToEt(sc, 25000., et));
+        EXPECT_DOUBLE_EQ(et.seconds, 300.);
+        EXPECT_TRUE(TicksToEt(sc, 400001., et));
+        EXPECT_DOUBLE_EQ(et.seconds, 7800.02);
+    }
+}
+
+
+TEST(MaxQSclkTest, OutsideCoverage_Is_Error) {
+    LoadTestKernels();
+
+    for (int sc : TestClocks)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        double sclkdp = 7.;
+        FSEphemerisTime et(7.);
+
+        EXPECT_FALSE(EtToTicks(sc, FSEphemerisTime(-1.), sclkdp, &ResultCode, &ErrorMessage));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+        EXPECT_FALSE(EtToTicks(sc, FSEphemerisTime(2e8), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 7.);
+
+        EXPECT_FALSE(TicksToEt(sc, -1., et, &ResultCode, &ErrorMessage));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+        EXPECT_FALSE(TicksToEt(sc, 9999900001., et));
+        EXPECT_TRUE(TicksToEt(sc, 9999900000., et));
+    }
+}
+
+
+TEST(MaxQSclkTest, StrToTicks_Handles_Partitions) {
+    LoadTestKernels();
+
+    for (int sc : TestClocks)
+    {
+        double sclkdp;
+        EXPECT_TRUE(StrToTicks(sc, TEXT("12.34"), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 1234.);
+        EXPECT_TRUE(StrToTicks(sc, TEXT(" 1/12:34 "), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 1234.);
+
+        // The second partition starts at 5000.00, 4000.00 counts after the first one's 0.00
+        EXPECT_TRUE(StrToTicks(sc, TEXT("2/5000.00"), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 400000.);
+        EXPECT_TRUE(StrToTicks(sc, TEXT("5000.00"), sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp, 400000.);
+
+        FSEphemerisTime et;
+        EXPECT_TRUE(StrToEt(sc, TEXT("2/5000.01"), et));
+        EXPECT_DOUBLE_EQ(et.seconds, 7800.02);
+
+        // Between partitions, wrong partition, no such partition, too many fields
+        EXPECT_FALSE(StrToTicks(sc, TEXT("4500"), sclkdp));
+        EXPECT_FALSE(StrToTicks(sc, TEXT("2/12.34"), sclkdp));
+        EXPECT_FALSE(StrToTicks(sc, TEXT("3/1"), sclkdp));
+        EXPECT_FALSE(StrToTicks(sc, TEXT("1/12.34.56"), sclkdp));
+    }
+}
+
+
+TEST(MaxQSclkTest, Batch_Matches_Scalar) {
+    LoadTestKernels();
+
+    for (int sc : TestClocks)
+    {
+        TArray<FSEphemerisTime> et;
+        for (int i = 0; i < 10000; ++i) et.Add(FSEphemerisTime(i * 7.5));
+
+        TArray<double> sclkdp;
+        sclkdp.SetNumZeroed(et.Num());
+        EXPECT_TRUE(EtToTicks(sc, et, sclkdp));
+
+        TArray<FSEphemerisTime> et2;
+        et2.SetNumZeroed(et.Num());
+        EXPECT_TRUE(TicksToEt(sc, sclkdp, et2));
+
+        for (int i = 0; i < et.Num(); ++i)
+        {
+            double expected;
+            EXPECT_TRUE(EtToTicks(sc, et[i], expected));
+            EXPECT_DOUBLE_EQ(sclkdp[i], expected);
+            EXPECT_NEAR(et2[i].seconds, et[i].seconds, 1e-9);
+        }
+
+        // One bad entry fails the batch, and is left unchanged
+        et[5] = FSEphemerisTime(-1.);
+        sclkdp[5] = 7.;
+        EXPECT_FALSE(EtToTicks(sc, et, sclkdp));
+        EXPECT_DOUBLE_EQ(sclkdp[5], 7.);
+        EXPECT_DOUBLE_EQ(sclkdp[6], 4500.);
+    }
+}
+
+
+TEST(MaxQSclkTest, USpice_Falls_Back_To_CSPICE) {
+    LoadTestKernels();
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    double sclkdp;
+    FSEphemerisTime et;
+
+    USpice::sce2c(ResultCode, ErrorMessage, -9990, FSEphemerisTime(300.), sclkdp);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    EXPECT_DOUBLE_EQ(sclkdp, 25000.);
+
+    // A blank field isn't in the native parser's syntax, CSPICE reads it as the field's offset
+    USpice::scs2e(ResultCode, ErrorMessage, -9990, TEXT("12."), et);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    EXPECT_DOUBLE_EQ(et.seconds, 12.);
+
+    // Errors still come from CSPICE
+    USpice::sct2e(ResultCode, ErrorMessage, -9990, -1., et);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+    EXPECT_FALSE(ErrorMessage.StartsWith(TEXT("MaxQ::Sclk")));
+}
@@ -0,0 +1,185 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceSgp4.h"
+
+using namespace MaxQ;
+using Sgp4::FTleBatch;
+using Sgp4::EError;
+
+namespace
+{
+    // Mostly from Vallado's SGP4 verification set (SGP4-VER.TLE).  More
+    // than four near-Earth satellites, for a full set of SIMD lanes and more.
+    const char* Tles[][2] = {
+        // Near-Earth, eccentric
+        { "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+          "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667" },
+        // Near-Earth, perigee under 220 km (the simple model)
+        { "1 06251U 62025E   06176.82412014  .00008885  00000-0  12808-3 0  3985",
+          "2 06251  58.0579  54.0425 0030035 139.1568 221.1854 15.56387291  6774" },
+        // Near-Earth, near circular
+        { "1 28057U 03049A   06177.78615833  .00000060  00000-0  35940-4 0  1836",
+          "2 28057  98.4283 247.6961 0000884  88.1964 272.0282 14.34845215142938" },
+        // Near-Earth, Spacetrack Report #3's test case
+        { "1 88888U          80275.98708465  .00073094  13844-3  66816-4 0    8",
+          "2 88888  72.8435 115.9689 0086731  52.6988 110.5714 16.05824518  105" },
+        // Near-Earth, the ISS
+        { "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+          "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537" },
+        // Molniya (12 hour resonance)
+        { "1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813",
+          "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656" },
+        // Geostationary (24 hour resonance)
+        { "1 28626U 05008A   06176.46683397 -.00000205  00000-0  10000-3 0  2190",
+          "2 28626   0.0019 286.9433 0000335  13.7918  55.6504  1.00270176  4891" },
+        // Deep space, low inclination (Lyddane)
+        { "1 23177U 94040C   06175.45752052  .00000386  00000-0  76590-3 0    95",
+          "2 23177   7.0496 179.8238 7258491 296.0482   8.3061  2.25906668 97438" },
+        // Deep space, eccentric, another epoch
+        { "1 04632U 70093B   04031.91070959 -.00000084  00000-0  10000-3 0  9955",
+          "2 04632  11.4628 273.1101 1450506 207.6000 143.9350  1.20231981 44145" },
+        // Deep space, eccentric, decades before the others
+        { "1 11801U          80230.29629788  .01431103  00000-0  14311-1 0    13",
+          "2 11801  46.7916 230.4354 7318036  47.4722  10.4117  2.28537848    13" },
+        // Deep space, e = 0.91, where Kepler's equation needs the damped
+        // Newton steps
+        { "1 90001U 00001A   00179.78495062  .00000000  00000-0  00000-0 0  1003",
+          "2 90001  28.5000 279.0717 9100000 270.0000  20.2257  0.40000000  1002" },
+    };
+    constexpr int NumTles = sizeof(Tles) / sizeof(Tles[0]);
+
+    // Near-Earth, decays within days
+    const char* Decaying[2] = {
+        "1 29141U 85108AA  06170.26783845  .99999999  00000-0  13519-0 0   718",
+        "2 29141  82.4288 273.4882 0015848 277.2124  83.9133 15.93343074  6828"
+    };
+
+    // WGS-72, as in geophysical.ker
+    FSTLEGeophysicalConstants Wgs72()
+    {
+        double geophs[8] = { 1.082616e-3, -2.53881e-6, -1.65597e-6, 7.43669161e-2, 120., 78., 6378.135, 1. };
+        return FSTLEGeophysicalConstants(geophs);
+    }
+
+    FSTwoLineElements ReadTle(const char* const (&Lines)[2])
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSEphemerisTime epoch;
+        FSTwoLineElements elems;
+        USpice::getelm(ResultCode, ErrorMessage, epoch, elems, Lines[0], Lines[1]);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        return elems;
+    }
+
+    TArray<FSTwoLineElements> ReadTles()
+    {
+        TArray<FSTwoLineElements> Elements;
+        for (int i = 0; i < NumTles; ++i)
+        {
+            Elements.Add(ReadTle(Tles[i]));
+        }
+        return Elements;
+    }
+}
+
+
+TEST(MaxQSgp4Test, Matches_Evsgp4) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const TArray<FSTwoLineElements> Elements = ReadTles();
+    const FSTLEGeophysicalConstants geophs = Wgs72();
+
+    FTleBatch Batch(geophs);
+    EXPECT_TRUE(Batch.Add(Elements));
+    EXPECT_EQ(Batch.Num(), NumTles);
+    EXPECT_FALSE(Batch.IsDeepSpace(0));
+    EXPECT_FALSE(Batch.IsDeepSpace(4));
+    EXPECT_TRUE(Batch.IsDeepSpace(5));
+    EXPECT_TRUE(Batch.IsDeepSpace(6));
+
+    TArray<FSStateVector> States;
+    TArray<EError> Errors;
+    States.SetNum(NumTles);
+    Errors.SetNum(NumTles);
+
+    // Monthly, for six years from a day before the first epoch, so the
+    // epochs are crossed in both directions
+    const double First = Elements[0].elems[FSTwoLineElements::EPOCH];
+    for (double dt = -86400.; dt < 6.5 * 365.25 * 86400.; dt += 29.3 * 86400.)
+    {
+        const FSEphemerisTime et(First + dt);
+        Batch.Evaluate(et, States, Errors);
+        EXPECT_EQ(Errors[NumTles - 1], EError::None);
+
+        for (int i = 0; i < NumTles; ++i)
+        {
+            ES_ResultCode ResultCode;
+            FString ErrorMessage;
+            FSStateVector Expected;
+            USpice::evsgp4(ResultCode, ErrorMessage, Expected, et, geophs, Elements[i], false);
+
+            EXPECT_EQ(ResultCode == ES_ResultCode::Success, Errors[i] == EError::None);
+            if (Errors[i] != EError::None)
+            {
+                continue;
+            }
+
+            double a[6], b[6];
+            States[i].CopyTo(a);
+            Expected.CopyTo(b);
+            for (int k = 0; k < 3; ++k)
+            {
+                EXPECT_NEAR(a[k], b[k], 1e-6);
+                EXPECT_NEAR(a[k + 3], b[k + 3], 1e-9);
+            }
+        }
+    }
+}
+
+
+TEST(MaxQSgp4Test, Errors) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    TArray<FSTwoLineElements> Elements = ReadTles();
+
+    // The defaults are WGS-72, too
+    FTleBatch Batch;
+    EXPECT_TRUE(Batch.Add(Elements[0]));
+    const FSTwoLineElements Decayed = ReadTle(Decaying);
+    EXPECT_TRUE(Batch.Add(Decayed));
+    EXPECT_EQ(Batch.Num(), 2);
+
+    // Satellite 1 has decayed a year on; satellite 0 is left alone
+    const FSEphemerisTime et(Decayed.elems[FSTwoLineElements::EPOCH] + 365.25 * 86400.);
+    TArray<FSStateVector> States;
+    States.SetNum(2);
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    EXPECT_FALSE(Batch.Evaluate(et, States, {}, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+
+    double r[6];
+    States[1].CopyTo(r);
+    EXPECT_EQ(r[0], 0.);
+    States[0].CopyTo(r);
+    EXPECT_NE(r[0], 0.);
+
+    // Suborbital: nothing is added
+    Elements[1].elems[FSTwoLineElements::XNO] *= 2.;
+    EXPECT_FALSE(Batch.Add(Elements, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(Batch.Num(), 2);
+
+    Batch.Reset();
+    EXPECT_EQ(Batch.Num(), 0);
+}
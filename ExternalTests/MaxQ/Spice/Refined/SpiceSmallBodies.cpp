@@ -0,0 +1,187 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceSmallBodies.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using namespace MaxQ;
+using SmallBodies::FCatalog;
+
+namespace
+{
+    const char* CatalogFile = "maxq_mpcorb_test.dat";
+
+    // Ceres, from MPCORB.DAT, and a made-up NEO with no readable designation
+    const char* Ceres = "00001    3.34  0.15 K2555 188.70269   73.27343   80.25221   10.58780  0.0794013  0.21424651   2.7660512  0 E2024-V47  7330 125 1801-2024 0.80 M-v 30k MPCLINUX   4000      (1) Ceres              20241101";
+    const char* Neo = "K24A00A 24.50  0.15 K24AM  12.34567   45.67890  123.45678    5.43210  0.4567890  0.54321000   1.4567890";
+
+    // Julian dates of the packed epochs K2555 and K24AM, 0h
+    const double CeresEpoch = 2460800.5;
+    const double NeoEpoch = 2460605.5;
+
+    FString WriteCatalog()
+    {
+        std::remove(CatalogFile);
+        {
+            // The last line has no newline
+            std::ofstream File(CatalogFile, std::ios::binary);
+            File << "MINOR PLANET CENTER ORBIT DATABASE (MPCORB)\r\n"
+                    "\r\n"
+                    "Des'n     H     G   Epoch     M        Peri.      Node       Incl.       e            n           a        Reference #Obs #Opp    Arc    rms  Perts   Computer\r\n"
+                    "----------------------------------------------------------------------------------------------------------------------------------------------------------------\r\n"
+                 << Ceres << "\r\n\r\n"
+                 << Neo;
+        }
+
+        // Absolute, as relative paths are relative to the project's content
+        return FString(std::filesystem::absolute(CatalogFile).string().c_str());
+    }
+
+    FSConicElements Elements(double a, double e, double i, double Node, double Peri, double M, double JD)
+    {
+        return FSConicElements(
+            FSDistance::FromAstronomicalUnits(a * (1. - e)),
+            e,
+            FSAngle::FromDegrees(i),
+            FSAngle::FromDegrees(Node),
+            FSAngle::FromDegrees(Peri),
+            FSAngle::FromDegrees(M),
+            FSEphemerisTime((JD - 2451545.) * 86400.),
+            FSMassConstant(SmallBodies::SunGM)
+        );
+    }
+}
+
+
+TEST(MaxQSmallBodiesTest, Load_Mpcorb) {
+    const FString Path = WriteCatalog();
+
+    FCatalog Catalog;
+    EXPECT_TRUE(SmallBodies::LoadMpcorb(Path, Catalog));
+    EXPECT_EQ(Catalog.Num(), 2);
+    EXPECT_TRUE(FString(Catalog.GetName(0)) == FString(TEXT("(1) Ceres")));
+    EXPECT_TRUE(FString(Catalog.GetName(1)) == FString(TEXT("K24A00A")));
+    EXPECT_FLOAT_EQ(Catalog.GetAbsoluteMagnitude(0), 3.34f);
+    EXPECT_FLOAT_EQ(Catalog.GetAbsoluteMagnitude(1), 24.5f);
+
+    // Same positions as the elements, read by hand
+    const FSConicElements Expected[2] = {
+        Elements(2.7660512, 0.0794013, 10.58780, 80.25221, 73.27343, 188.70269, CeresEpoch),
+        Elements(1.4567890, 0.4567890, 5.43210, 123.45678, 45.67890, 12.34567, NeoEpoch)
+    };
+
+    const FSEphemerisTime et(8e8);
+    TArray<FSDistanceVector> Positions;
+    Positions.SetNum(2);
+    EXPECT_TRUE(Catalog.Orbits.Evaluate(et, Positions));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        FSStateVector State;
+        EXPECT_TRUE(Conics::Evaluate(Expected[i], et, State));
+
+        double a[3], b[3];
+        Positions[i].CopyTo(a);
+        State.r.CopyTo(b);
+        for (int k = 0; k < 3; ++k)
+        {
+            EXPECT_NEAR(a[k], b[k], 1e-3);
+        }
+    }
+
+    // Appends
+    EXPECT_TRUE(SmallBodies::LoadMpcorb(Path, Catalog));
+    EXPECT_EQ(Catalog.Num(), 4);
+    EXPECT_TRUE(FString(Catalog.GetName(2)) == FString(TEXT("(1) Ceres")));
+
+    std::remove(CatalogFile);
+
+    // Missing
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(SmallBodies::LoadMpcorb(Path, Catalog, 30.f, FSMassConstant(SmallBodies::SunGM), &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+}
+
+
+TEST(MaxQSmallBodiesTest, Magnitude_Culling) {
+    const FString Path = WriteCatalog();
+
+    FCatalog Catalog;
+    EXPECT_TRUE(SmallBodies::LoadMpcorb(Path, Catalog, 10.f));
+    EXPECT_EQ(Catalog.Num(), 1);
+    EXPECT_TRUE(FString(Catalog.GetName(0)) == FString(TEXT("(1) Ceres")));
+
+    Catalog.Reset();
+    EXPECT_EQ(Catalog.Num(), 0);
+    EXPECT_TRUE(SmallBodies::LoadMpcorb(Path, Catalog));
+
+    TArray<int32> Indices;
+    Catalog.Select(10.f, Indices);
+    EXPECT_EQ(Indices.Num(), 1);
+    EXPECT_EQ(Indices[0], 0);
+    Catalog.Select(30.f, Indices);
+    EXPECT_EQ(Indices.Num(), 2);
+
+    // Just the NEO, by index
+    TArray<FSDistanceVector> All, One;
+    All.SetNum(2);
+    One.SetNum(1);
+    const TArray<int32> Neos{ 1 };
+    EXPECT_TRUE(Catalog.Orbits.Evaluate(FSEphemerisTime(0.), FSRotationMatrix(), All));
+    EXPECT_TRUE(Catalog.Orbits.Evaluate(Neos, FSEphemerisTime(0.), FSRotationMatrix(), One));
+
+    double a[3], b[3];
+    All[1].CopyTo(a);
+    One[0].CopyTo(b);
+    for (int k = 0; k < 3; ++k)
+    {
+        EXPECT_DOUBLE_EQ(a[k], b[k]);
+    }
+
+    std::remove(CatalogFile);
+}
+
+
+TEST(MaxQSmallBodiesTest, Unknown_Magnitude) {
+    // The NEO, once without its H, and once as bright as H = 0
+    std::string NoMagnitude(Neo), Zero(Neo);
+    NoMagnitude.replace(8, 5, "     ");
+    Zero.replace(8, 5, " 0.00");
+    std::remove(CatalogFile);
+    {
+        std::ofstream File(CatalogFile, std::ios::binary);
+        File << NoMagnitude << "\n" << Zero << "\n";
+    }
+    const FString Path(std::filesystem::absolute(CatalogFile).string().c_str());
+
+    FCatalog Catalog;
+    EXPECT_TRUE(SmallBodies::LoadMpcorb(Path, Catalog, 10.f));
+    EXPECT_EQ(Catalog.Num(), 2);
+    EXPECT_FALSE(Catalog.HasAbsoluteMagnitude(0));
+    EXPECT_TRUE(FMath::IsNaN(Catalog.GetAbsoluteMagnitude(0)));
+    EXPECT_TRUE(Catalog.HasAbsoluteMagnitude(1));
+    EXPECT_EQ(Catalog.GetAbsoluteMagnitude(1), 0.f);
+
+    // Unknown magnitudes are selected at any limit
+    EXPECT_TRUE(Catalog.Add(Elements(1.4567890, 0.4567890, 5.43210, 123.45678, 45.67890, 12.34567, NeoEpoch), TEXT("Faint"), 25.f));
+    TArray<int32> Indices;
+    Catalog.Select(-1.f, Indices);
+    EXPECT_EQ(Indices.Num(), 1);
+    EXPECT_EQ(Indices[0], 0);
+    Catalog.Select(10.f, Indices);
+    EXPECT_EQ(Indices.Num(), 2);
+    EXPECT_EQ(Indices[1], 1);
+    Catalog.Select(30.f, Indices);
+    EXPECT_EQ(Indices.Num(), 3);
+
+    std::remove(CatalogFile);
+}
@@ -0,0 +1,189 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "MaxQTestHelpers.h"
+#include "SpiceTeme.h"
+
+using namespace MaxQ;
+using Covariance::FStateMatrix;
+
+namespace
+{
+    void Multiply(const FStateMatrix& xform, const double(&In)[6], double(&Out)[6])
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            Out[i] = 0.;
+            for (int k = 0; k < 6; ++k)
+            {
+                Out[i] += xform.m[i][k] * In[k];
+            }
+        }
+    }
+
+    // Vallado, Crawford, Hujsak & Kelso, "Revisiting Spacetrack Report #3"
+    // (2006), the TEME example, at 2004-04-06 07:51:28.386009 UTC
+    const double ExampleTeme[6] = { 5094.18016210, 6127.64465950, 6380.34453270, -4.746131487, 0.785818041, 5.531931288 };
+    const double ExampleUt1MinusUtc = -0.4399619;
+
+    // GCRF, which is J2000 with the IERS corrections to the nutation, that
+    // move it by a few meters
+    const double ExampleGcrf[6] = { 5102.508958, 6123.011401, 6378.136928, -4.74322016, 0.79053650, 5.53375528 };
+    const double ExamplePef[6] = { -1033.47503130, 7901.30558560, 6380.34453270, -3.225632747, -2.872442511, 5.531931288 };
+
+    FSEphemerisTime ExampleEpoch()
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSEphemerisTime et;
+        USpice::str2et(ResultCode, ErrorMessage, et, TEXT("2004-04-06T07:51:28.386009"));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        return et;
+    }
+}
+
+
+TEST(MaxQTemeTest, Vallado_Example) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const FSEphemerisTime et = ExampleEpoch();
+    FSStateVector States[] = { FSStateVector(ExampleTeme) };
+
+    FStateMatrix ToJ2000;
+    Teme::ToJ2000(et, ToJ2000);
+    FSStateVector J2000[1];
+    Teme::Transform(ToJ2000, States, J2000);
+    ExpectNear(J2000[0], ExampleGcrf, 0.005, 5e-6);
+
+    FStateMatrix ToPef;
+    EXPECT_TRUE(Teme::ToPseudoEarthFixed(et, ToPef, FSEphemerisPeriod(ExampleUt1MinusUtc)));
+    Teme::Transform(ToPef, States);
+    // To a centimeter: the example's GMST is from a Julian date, and its
+    // rotation rate has the length of day in it
+    ExpectNear(States[0], ExamplePef, 1e-5, 2e-8);
+}
+
+
+TEST(MaxQTemeTest, Rates_Match_Differences) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // A point fixed in TEME moves only by the frame's rotation
+    const double et = ExampleEpoch().seconds, h = 10.;
+    const double Fixed[6] = { 7000., -2000., 3000., 0., 0., 0. };
+
+    for (const FString Frame : { TEXT("J2000"), TEXT("PEF"), TEXT("ECLIPJ2000") })
+    {
+        // PEF turns at a constant rate, which isn't quite GMST's
+        const double Tolerance = Frame == TEXT("PEF") ? 1e-7 : 1e-9;
+
+        FStateMatrix Before, At, After;
+        EXPECT_TRUE(Teme::ToFrame(FSEphemerisTime(et - h), Frame, Before));
+        EXPECT_TRUE(Teme::ToFrame(FSEphemerisTime(et), Frame, At));
+        EXPECT_TRUE(Teme::ToFrame(FSEphemerisTime(et + h), Frame, After));
+
+        double r0[6], r1[6], Moved[6];
+        Multiply(Before, Fixed, r0);
+        Multiply(After, Fixed, r1);
+        Multiply(At, Fixed, Moved);
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(Moved[i + 3], (r1[i] - r0[i]) / (2. * h), Tolerance);
+        }
+    }
+}
+
+
+TEST(MaxQTemeTest, Batch_Matches_Single) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const FSEphemerisTime et = ExampleEpoch();
+    FStateMatrix ToEcliptic;
+    EXPECT_TRUE(Teme::ToFrame(et, TEXT("ECLIPJ2000"), ToEcliptic));
+
+    // Enough to be split across workers
+    TArray<FSStateVector> In, Out;
+    for (int i = 0; i < 5000; ++i)
+    {
+        const double s[6] = { 7000. + i, -2000. + 0.5 * i, 3000. - i, 1. + 1e-3 * i, -5. + 1e-3 * i, 3. };
+        In.Add(FSStateVector(s));
+    }
+    Out.SetNum(In.Num());
+    Teme::Transform(ToEcliptic, In, Out);
+
+    for (int i = 0; i < In.Num(); i += 97)
+    {
+        double s[6], Expected[6];
+        In[i].CopyTo(s);
+        Multiply(ToEcliptic, s, Expected);
+        ExpectNear(Out[i], Expected, 1e-9, 1e-12);
+    }
+
+    // TLE batches, in frame
+    Sgp4::FTleBatch Batch;
+    EXPECT_TRUE(Batch.Add(TleElements(et.seconds, 51.6, 30., 0.0005, 0., 0., 15.5)));
+    EXPECT_TRUE(Batch.Add(TleElements(et.seconds, 97.5, 30., 0.0005, 0., 0., 15.5)));
+
+    TArray<FSStateVector> TemeStates, InFrame;
+    TemeStates.SetNum(Batch.Num());
+    InFrame.SetNum(Batch.Num());
+    const FSEphemerisTime Later(et.seconds + 3600.);
+    EXPECT_TRUE(Batch.Evaluate(Later, TemeStates));
+    EXPECT_TRUE(Teme::Evaluate(Batch, Later, TEXT("J2000"), InFrame));
+
+    FStateMatrix ToJ2000;
+    Teme::ToJ2000(Later, ToJ2000);
+    for (int i = 0; i < Batch.Num(); ++i)
+    {
+        double s[6], Expected[6];
+        TemeStates[i].CopyTo(s);
+        Multiply(ToJ2000, s, Expected);
+        ExpectNear(InFrame[i], Expected, 1e-9, 1e-12);
+    }
+
+    // TEME is no change at all
+    EXPECT_TRUE(Teme::Evaluate(Batch, Later, TEXT("TEME"), InFrame));
+    for (int i = 0; i < Batch.Num(); ++i)
+    {
+        double s[6];
+        TemeStates[i].CopyTo(s);
+        ExpectNear(InFrame[i], s, 0., 0.);
+    }
+
+    // Unknown frames are errors
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Teme::Evaluate(Batch, Later, TEXT("NO SUCH FRAME"), InFrame, {}, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+}
+
+
+TEST(MaxQTemeTest, FromFrame_Inverts_ToFrame) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    const FSEphemerisTime et = ExampleEpoch();
+
+    for (const FString Frame : { TEXT("J2000"), TEXT("PEF"), TEXT("ECLIPJ2000"), TEXT("TEME") })
+    {
+        FStateMatrix To, From;
+        EXPECT_TRUE(Teme::ToFrame(et, Frame, To));
+        EXPECT_TRUE(Teme::FromFrame(et, Frame, From));
+
+        FSStateVector States[] = { FSStateVector(ExampleTeme) };
+        Teme::Transform(To, States);
+        Teme::Transform(From, States);
+        ExpectNear(States[0], ExampleTeme, 1e-8, 1e-11);
+    }
+
+    FStateMatrix Unknown;
+    EXPECT_FALSE(Teme::FromFrame(et, TEXT("NO SUCH FRAME"), Unknown));
+}
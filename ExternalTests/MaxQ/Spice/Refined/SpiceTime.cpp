@@ -0,0 +1,338 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+// 
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/ 
+
+#include "pch.h"
+#include "SpiceTime.h"
+
+using namespace MaxQ::Time;
+
+namespace
+{
+    void LoadTestKernels()
+    {
+        USpice::init_all();
+
+        ES_ResultCode ResultCode = ES_ResultCode::Success;
+        FString ErrorMessage;
+
+        USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+        USpice::get_implied_result(ResultCode, ErrorMessage);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    }
+
+    // Around the unit test LSK's only leapsecond (2021-12-31T23:59:60), and either side of it
+    const double TestEpochs[] = { -1.0e9, -1234567.891, 0., 694267200., 694267258.5, 694267259.25, 694267260., 694267260.9999, 7.5e8, 2.1e9 };
+}
+
+
+TEST(MaxQTimeTest, NoLeapSeconds_Is_Error) {
+    USpice::init_all();
+
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    double tai = 7.;
+
+    bool bSuccess = EtToTai(FSEphemerisTime(0.), tai, &ResultCode, &ErrorMessage);
+
+    EXPECT_FALSE(bSuccess);
+    EXPECT_FALSE(HasLeapSeconds());
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+    EXPECT_DOUBLE_EQ(tai, 7.);
+}
+
+
+TEST(MaxQTimeTest, UniformScales_Match_TestKernel) {
+    LoadTestKernels();
+
+    // The unit test LSK has K = 0, so TDB = TDT = TAI + DELTA_T_A (10s) exactly
+    for (double epoch : TestEpochs)
+    {
+        double tai;
+        EXPECT_TRUE(EtToTai(FSEphemerisTime(epoch), tai));
+        EXPECT_DOUBLE_EQ(tai, epoch - 10.);
+
+        double tt;
+        EXPECT_TRUE(EtToTt(FSEphemerisTime(epoch), tt));
+        EXPECT_DOUBLE_EQ(tt, epoch);
+
+        FSEphemerisTime et;
+        EXPECT_TRUE(TaiToEt(epoch, et));
+        EXPECT_DOUBLE_EQ(et.seconds, epoch + 10.);
+
+        EXPECT_TRUE(TtToEt(epoch, et));
+        EXPECT_DOUBLE_EQ(et.seconds, epoch);
+    }
+}
+
+
+TEST(MaxQTimeTest, ConvertTimeScale_Handles_JulianDates) {
+    LoadTestKernels();
+
+    double out;
+    EXPECT_TRUE(ConvertTimeScale(0., ES_TimeScale::ET, ES_TimeScale::JED, out));
+    EXPECT_DOUBLE_EQ(out, 2451545.);
+    EXPECT_TRUE(ConvertTimeScale(2451546.5, ES_TimeScale::JDTDB, ES_TimeScale::TDB, out));
+    EXPECT_DOUBLE_EQ(out, 129600.);
+    EXPECT_TRUE(ConvertTimeScale(2451545., ES_TimeScale::JDTDT, ES_TimeScale::TAI, out));
+    EXPECT_DOUBLE_EQ(out, -10.);
+    EXPECT_TRUE(ConvertTimeScale(-10., ES_TimeScale::TAI, ES_TimeScale::JDTDT, out));
+    EXPECT_DOUBLE_EQ(out, 2451545.);
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    EXPECT_FALSE(ConvertTimeScale(0., ES_TimeScale::NONE, ES_TimeScale::TAI, out, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+
+    // The Blueprint list version, which matches unitim one epoch at a time
+    TArray<double> epochs { -1.0e9, 0., 7.5e8 };
+    TArray<double> jed;
+    USpice::unitim_list(ResultCode, ErrorMessage, jed, epochs, ES_TimeScale::TAI, ES_TimeScale::JED);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    ASSERT_EQ(jed.Num(), epochs.Num());
+    for (int32 i = 0; i < epochs.Num(); ++i)
+    {
+        double expected;
+        USpice::unitim(ResultCode, ErrorMessage, expected, epochs[i], ES_TimeScale::TAI, ES_TimeScale::JED);
+        EXPECT_DOUBLE_EQ(jed[i], expected);
+    }
+}
+
+
+TEST(MaxQTimeTest, DeltaEt_Steps_At_LeapSecond) {
+    LoadTestKernels();
+
+    // TAI-UTC goes from 49 to 50 at 2022-01-01 (694267200 UTC seconds), ET-UTC = 10 + TAI-UTC
+    FSEphemerisPeriod delta;
+    EXPECT_TRUE(DeltaEt(694267199.5, ES_EpochType::UTC, delta));
+    EXPECT_DOUBLE_EQ(delta.seconds, 59.);
+    EXPECT_TRUE(DeltaEt(694267200., ES_EpochType::UTC, delta));
+    EXPECT_DOUBLE_EQ(delta.seconds, 60.);
+
+    // ... which is 694267260 ET
+    EXPECT_TRUE(DeltaEt(694267259.5, ES_EpochType::ET, delta));
+    EXPECT_DOUBLE_EQ(delta.seconds, 59.);
+    EXPECT_TRUE(DeltaEt(694267260., ES_EpochType::ET, delta));
+    EXPECT_DOUBLE_EQ(delta.seconds, 60.);
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    TArray<double> epochs { 0., 694267259.5, 694267260., 7.5e8 };
+    TArray<FSEphemerisPeriod> deltas;
+    USpice::deltet_list(ResultCode, ErrorMessage, epochs, ES_EpochType::ET, deltas);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+    ASSERT_EQ(deltas.Num(), epochs.Num());
+    EXPECT_DOUBLE_EQ(deltas[0].seconds, 59.);
+    EXPECT_DOUBLE_EQ(deltas[1].seconds, 59.);
+    EXPECT_DOUBLE_EQ(deltas[2].seconds, 60.);
+    EXPECT_DOUBLE_EQ(deltas[3].seconds, 60.);
+}
+
+
+TEST(MaxQTimeTest, TimeScaleLists_Without_LeapSeconds_Are_Errors) {
+    USpice::init_all();
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    TArray<double> epochs { 0., 1. };
+
+    TArray<double> out;
+    USpice::unitim_list(ResultCode, ErrorMessage, out, epochs, ES_TimeScale::TAI, ES_TimeScale::TDB);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_GT(ErrorMessage.Len(), 0);
+
+    TArray<FSEphemerisPeriod> deltas;
+    USpice::deltet_list(ResultCode, ErrorMessage, epochs, ES_EpochType::UTC, deltas);
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(deltas.Num(), 0);
+}
+
+
+TEST(MaxQTimeTest, EtToUtcString_Matches_et2utc) {
+    LoadTestKernels();
+
+    const ES_UTCTimeFormat Formats[] = { ES_UTCTimeFormat::Calendar, ES_UTCTimeFormat::DayOfYear, ES_UTCTimeFormat::ISOCalendar, ES_UTCTimeFormat::ISODayOfYear };
+    const int Precisions[] = { 0, 3, 4, 9 };
+
+    for (double epoch : TestEpochs)
+    {
+        for (auto format : Formats)
+        {
+            for (int prec : Precisions)
+            {
+                ES_ResultCode ResultCode;
+                FString ErrorMessage;
+                FString expected;
+                USpice::et2utc(ResultCode, ErrorMessage, FSEphemerisTime(epoch), format, expected, prec);
+                EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+                FString actual;
+                EXPECT_TRUE(EtToUtcString(FSEphemerisTime(epoch), format, prec, actual));
+                EXPECT_EQ(actual, expected);
+            }
+        }
+    }
+}
+
+
+TEST(MaxQTimeTest, EtToUtc_LeapSecond_Is_Sixty) {
+    LoadTestKernels();
+
+    FSEphemerisTime et;
+    FUtcCalendar utc;
+    utc.Year = 2021;
+    utc.Month = 12;
+    utc.Day = 31;
+    utc.Hour = 23;
+    utc.Minute = 59;
+    utc.Second = 60.25;
+
+    EXPECT_TRUE(UtcToEt(utc, et));
+
+    FUtcCalendar roundTrip;
+    EXPECT_TRUE(EtToUtc(et, roundTrip));
+
+    EXPECT_EQ(roundTrip.Year, 2021);
+    EXPECT_EQ(roundTrip.Month, 12);
+    EXPECT_EQ(roundTrip.Day, 31);
+    EXPECT_EQ(roundTrip.DayOfYear, 365);
+    EXPECT_EQ(roundTrip.Hour, 23);
+    EXPECT_EQ(roundTrip.Minute, 59);
+    EXPECT_NEAR(roundTrip.Second, 60.25, 1e-6);
+}
+
+
+TEST(MaxQTimeTest, StrToEt_Matches_str2et) {
+    LoadTestKernels();
+
+    const TCHAR* Strings[][2] = {
+        { TEXT("2022-03-15T12:34:56.789Z"), TEXT("2022-03-15T12:34:56.789") },
+        { TEXT("2022-074T12:34:56.789"), TEXT("2022-074T12:34:56.789") },
+        { TEXT("2021-12-31T23:59:60.5"), TEXT("2021-12-31T23:59:60.5") },
+        { TEXT("2022-01-01"), TEXT("2022-01-01") },
+        { TEXT("1999-12-31 23:59 UTC"), TEXT("1999-12-31T23:59") },
+        { TEXT("2000-060T00:00:00"), TEXT("2000-060T00:00:00") }
+    };
+
+    for (auto& pair : Strings)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSEphemerisTime expected;
+        USpice::str2et(ResultCode, ErrorMessage, expected, pair[1]);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+
+        FSEphemerisTime actual;
+        EXPECT_TRUE(StrToEt(pair[0], actual, &ResultCode, &ErrorMessage));
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        EXPECT_NEAR(actual.seconds, expected.seconds, 1e-6);
+    }
+}
+
+
+TEST(MaxQTimeTest, ParseUtc_Rejects_Malformed) {
+    const TCHAR* Strings[] = {
+        TEXT(""),
+        TEXT("2022"),
+        TEXT("2022-13-01"),
+        TEXT("2021-02-29"),
+        TEXT("2022-366"),
+        TEXT("2022-03-15T24:00:00"),
+        TEXT("2022-03-15T12:00:60"),
+        TEXT("2022-03-15T12:00:00 PST"),
+        TEXT("1500-01-01"),
+        TEXT("2022 MAR 15 12:00:00")
+    };
+
+    for (auto str : Strings)
+    {
+        FUtcCalendar utc;
+        EXPECT_FALSE(ParseUtc(str, utc));
+    }
+}
+
+
+TEST(MaxQTimeTest, Batch_Matches_Scalar) {
+    LoadTestKernels();
+
+    TArray<FSEphemerisTime> et;
+    for (int32 i = 0; i < 10000; ++i)
+    {
+        et.Add(FSEphemerisTime(694262000. + i * 0.999));
+    }
+
+    TArray<double> tai;
+    tai.SetNum(et.Num());
+    TArray<FUtcCalendar> utc;
+    utc.SetNum(et.Num());
+    TArray<FSEphemerisTime> roundTrip;
+    roundTrip.SetNum(et.Num());
+
+    TArray<double> epochs;
+    for (const FSEphemerisTime& e : et) epochs.Add(e.seconds);
+    TArray<double> jdtdt;
+    jdtdt.SetNum(et.Num());
+    TArray<FSEphemerisPeriod> deltas;
+    deltas.SetNum(et.Num());
+
+    EXPECT_TRUE(EtToTai(et, tai));
+    EXPECT_TRUE(EtToUtc(et, utc));
+    EXPECT_TRUE(UtcToEt(utc, roundTrip));
+    EXPECT_TRUE(ConvertTimeScale(epochs, ES_TimeScale::ET, ES_TimeScale::JDTDT, jdtdt));
+    EXPECT_TRUE(DeltaEt(epochs, ES_EpochType::ET, deltas));
+
+    for (int32 i = 0; i < et.Num(); i += 97)
+    {
+        double expectedTai;
+        FUtcCalendar expectedUtc;
+        EtToTai(et[i], expectedTai);
+        EtToUtc(et[i], expectedUtc);
+
+        EXPECT_DOUBLE_EQ(tai[i], expectedTai);
+        EXPECT_EQ(utc[i].Day, expectedUtc.Day);
+        EXPECT_EQ(utc[i].Minute, expectedUtc.Minute);
+        EXPECT_DOUBLE_EQ(utc[i].Second, expectedUtc.Second);
+        EXPECT_NEAR(roundTrip[i].seconds, et[i].seconds, 1e-6);
+
+        double expectedJd;
+        FSEphemerisPeriod expectedDelta;
+        ConvertTimeScale(epochs[i], ES_TimeScale::ET, ES_TimeScale::JDTDT, expectedJd);
+        DeltaEt(epochs[i], ES_EpochType::ET, expectedDelta);
+
+        EXPECT_DOUBLE_EQ(jdtdt[i], expectedJd);
+        EXPECT_DOUBLE_EQ(deltas[i].seconds, expectedDelta.seconds);
+    }
+}
+
+
+TEST(MaxQTimeTest, UtcFormatter_Matches_EtToUtcString) {
+    LoadTestKernels();
+
+    const ES_UTCTimeFormat Formats[] = { ES_UTCTimeFormat::Calendar, ES_UTCTimeFormat::DayOfYear, ES_UTCTimeFormat::JulianDate, ES_UTCTimeFormat::ISOCalendar, ES_UTCTimeFormat::ISODayOfYear };
+
+    for (ES_UTCTimeFormat format : Formats)
+    {
+        for (int precision : { 0, 3, 9 })
+        {
+            FUtcFormatter Formatter(format, precision);
+
+            // Frame-sized steps across the leapsecond and midnight, then some jumps
+            double et = 694267250.;
+            for (int32 i = 0; i < 2000; ++i)
+            {
+                et += (i % 1000 == 999) ? -86400.7 : 0.0167;
+
+                FString expected;
+                EXPECT_TRUE(EtToUtcString(FSEphemerisTime(et), format, precision, expected));
+
+                const TCHAR* actual = Formatter.Update(FSEphemerisTime(et));
+                EXPECT_STREQ(actual, *expected);
+                EXPECT_EQ(Formatter.Len(), expected.Len());
+            }
+        }
+    }
+}
@@ -0,0 +1,263 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "pch.h"
+#include "SpiceTleCatalog.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace MaxQ;
+using Tle::FCatalog;
+
+namespace
+{
+    const char* CatalogFile = "maxq_tle_test.txt";
+
+    // Named, as in a 3LE file
+    const char* Tles[][3] = {
+        { "0 VANGUARD 1",
+          "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+          "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667" },
+        { "ISS (ZARYA)",
+          "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+          "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537" },
+        { "MOLNIYA 2-14",
+          "1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813",
+          "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656" },
+    };
+    constexpr int NumTles = sizeof(Tles) / sizeof(Tles[0]);
+
+    // The ISS, with its line 2 checksum off by one
+    const char* BadChecksum[2] = {
+        "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927",
+        "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563538"
+    };
+
+    // The ISS, as an OMM CSV row
+    const char* OmmCsv =
+        "OBJECT_NAME,OBJECT_ID,EPOCH,MEAN_MOTION,ECCENTRICITY,INCLINATION,RA_OF_ASC_NODE,ARG_OF_PERICENTER,MEAN_ANOMALY,EPHEMERIS_TYPE,CLASSIFICATION_TYPE,NORAD_CAT_ID,ELEMENT_SET_NO,REV_AT_EPOCH,BSTAR,MEAN_MOTION_DOT,MEAN_MOTION_DDOT\r\n"
+        "ISS (ZARYA),1998-067A,2008-09-20T12:25:40.104192,15.72125391,.0006703,51.6416,247.4627,130.5360,325.0288,0,U,25544,292,56353,-.11606E-4,-.00002182,0\r\n";
+
+    // Line with its checksum (column 69) recomputed
+    std::string WithChecksum(std::string Line)
+    {
+        int Sum = 0;
+        for (int c = 0; c < 68; ++c)
+        {
+            if (Line[c] >= '0' && Line[c] <= '9') Sum += Line[c] - '0';
+            else if (Line[c] == '-') Sum += 1;
+        }
+        Line[68] = char('0' + Sum % 10);
+        return Line;
+    }
+
+    FString WriteFile(const std::string& Text)
+    {
+        std::remove(CatalogFile);
+        {
+            std::ofstream File(CatalogFile, std::ios::binary);
+            File << Text;
+        }
+
+        // Absolute, as relative paths are relative to the project's content
+        return FString(std::filesystem::absolute(CatalogFile).string().c_str());
+    }
+
+    FSTwoLineElements ReadTle(const char* Line1, const char* Line2)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        FSEphemerisTime epoch;
+        FSTwoLineElements elems;
+        USpice::getelm(ResultCode, ErrorMessage, epoch, elems, Line1, Line2);
+        EXPECT_EQ(ResultCode, ES_ResultCode::Success);
+        return elems;
+    }
+
+    void ExpectElements(const FSTwoLineElements& Actual, const FSTwoLineElements& Expected, double EpochTolerance)
+    {
+        for (int k = 0; k < FSTwoLineElements::EPOCH; ++k)
+        {
+            EXPECT_NEAR(Actual.elems[k], Expected.elems[k], 1e-12 * FMath::Max(1., FMath::Abs(Expected.elems[k])));
+        }
+        EXPECT_NEAR(Actual.elems[FSTwoLineElements::EPOCH], Expected.elems[FSTwoLineElements::EPOCH], EpochTolerance);
+    }
+}
+
+
+TEST(MaxQTleCatalogTest, Load_3le) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // A bad checksum between good records, and no newline at the end
+    std::string Text;
+    for (int i = 0; i < NumTles; ++i)
+    {
+        Text += std::string(Tles[i][0]) + "\r\n" + Tles[i][1] + "\r\n" + Tles[i][2];
+        Text += i == 0 ? std::string("\r\nBAD\r\n") + BadChecksum[0] + "\r\n" + BadChecksum[1] + "\r\n" : (i + 1 < NumTles ? "\r\n" : "");
+    }
+    const FString Path = WriteFile(Text);
+
+    FCatalog Catalog;
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Catalog, false));
+    EXPECT_EQ(Catalog.Num(), NumTles);
+    EXPECT_EQ(Catalog.Satellites.Num(), NumTles);
+    EXPECT_TRUE(FString(Catalog.GetName(0)) == FString(TEXT("VANGUARD 1")));
+    EXPECT_TRUE(FString(Catalog.GetName(1)) == FString(TEXT("ISS (ZARYA)")));
+    EXPECT_EQ(Catalog.GetCatalogNumber(2), 8195);
+    EXPECT_EQ(Catalog.Find(25544), 1);
+    EXPECT_EQ(Catalog.Find(99999), INDEX_NONE);
+
+    for (int i = 0; i < NumTles; ++i)
+    {
+        ExpectElements(Catalog.GetElements(i), ReadTle(Tles[i][1], Tles[i][2]), 1e-6);
+    }
+
+    // The same states as a batch of getelm's elements
+    Sgp4::FTleBatch Expected;
+    for (int i = 0; i < NumTles; ++i)
+    {
+        EXPECT_TRUE(Expected.Add(ReadTle(Tles[i][1], Tles[i][2])));
+    }
+
+    const FSEphemerisTime et(Catalog.GetElements(1).elems[FSTwoLineElements::EPOCH] + 86400.);
+    TArray<FSStateVector> a, b;
+    a.SetNum(NumTles);
+    b.SetNum(NumTles);
+    EXPECT_TRUE(Catalog.Satellites.Evaluate(et, a));
+    EXPECT_TRUE(Expected.Evaluate(et, b));
+    for (int i = 0; i < NumTles; ++i)
+    {
+        double x[6], y[6];
+        a[i].CopyTo(x);
+        b[i].CopyTo(y);
+        for (int k = 0; k < 3; ++k)
+        {
+            EXPECT_NEAR(x[k], y[k], 1e-6);
+        }
+    }
+
+    std::remove(CatalogFile);
+}
+
+
+TEST(MaxQTleCatalogTest, Load_2le_Alpha5) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // No names; the second is catalog number 100005 ("A0005")
+    std::string Alpha1 = WithChecksum(std::string(Tles[0][1]).replace(2, 5, "A0005"));
+    std::string Alpha2 = WithChecksum(std::string(Tles[0][2]).replace(2, 5, "A0005"));
+    const FString Path = WriteFile(std::string(Tles[1][1]) + "\n" + Tles[1][2] + "\n" + Alpha1 + "\n" + Alpha2 + "\n");
+
+    FCatalog Catalog;
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Catalog, false));
+    EXPECT_EQ(Catalog.Num(), 2);
+    EXPECT_EQ(Catalog.GetCatalogNumber(1), 100005);
+    EXPECT_EQ(Catalog.Find(100005), 1);
+    EXPECT_TRUE(FString(Catalog.GetName(0)) == FString(TEXT("25544")));
+
+    // Appends
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Catalog, false));
+    EXPECT_EQ(Catalog.Num(), 4);
+    EXPECT_EQ(Catalog.Find(25544), 2);
+
+    std::remove(CatalogFile);
+
+    // Missing
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Tle::LoadCatalog(Path, Catalog, false, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_FALSE(ErrorMessage.IsEmpty());
+}
+
+
+TEST(MaxQTleCatalogTest, Parse_Omm) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    FCatalog Catalog;
+    EXPECT_TRUE(Tle::ParseCatalog(OmmCsv, Catalog));
+    EXPECT_EQ(Catalog.Num(), 1);
+    EXPECT_EQ(Catalog.GetCatalogNumber(0), 25544);
+    EXPECT_TRUE(FString(Catalog.GetName(0)) == FString(TEXT("ISS (ZARYA)")));
+
+    // The CSV's epoch is rounded to the microsecond
+    ExpectElements(Catalog.GetElements(0), ReadTle(Tles[1][1], Tles[1][2]), 1e-5);
+
+    // A required column is missing
+    ES_ResultCode ResultCode = ES_ResultCode::Success;
+    FString ErrorMessage;
+    EXPECT_FALSE(Tle::ParseCatalog("OBJECT_NAME,MEAN_MOTION\nISS,15.7\n", Catalog, &ResultCode, &ErrorMessage));
+    EXPECT_EQ(ResultCode, ES_ResultCode::Error);
+    EXPECT_EQ(Catalog.Num(), 1);
+}
+
+
+TEST(MaxQTleCatalogTest, Parse_Records) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    // The bad checksum is skipped, so there's no record for it
+    std::string Text = std::string(Tles[0][0]) + "\r\n" + Tles[0][1] + "\r\n" + Tles[0][2] + "\r\n"
+        + BadChecksum[0] + "\r\n" + BadChecksum[1] + "\r\n"
+        + Tles[2][1] + "\r\n" + Tles[2][2] + "\r\n";
+
+    FCatalog Catalog;
+    TArray<FAnsiStringView> Records;
+    EXPECT_TRUE(Tle::ParseCatalog(FAnsiStringView(Text.c_str(), int32(Text.size())), Catalog, Records));
+    EXPECT_EQ(Catalog.Num(), 2);
+    EXPECT_EQ(Records.Num(), 2);
+
+    for (int i = 0; i < Records.Num(); ++i)
+    {
+        const int t = i == 0 ? 0 : 2;
+        EXPECT_EQ(std::string(Records[i].GetData(), Records[i].Len()), std::string(Tles[t][1]) + "\r\n" + Tles[t][2]);
+    }
+
+    // OMM rows
+    Records.Reset();
+    EXPECT_TRUE(Tle::ParseCatalog(OmmCsv, Catalog, Records));
+    EXPECT_EQ(Catalog.Num(), 3);
+    EXPECT_EQ(Records.Num(), 1);
+    EXPECT_EQ(std::string(Records[0].GetData(), Records[0].Len()).rfind("ISS (ZARYA),1998-067A,", 0), 0u);
+}
+
+
+TEST(MaxQTleCatalogTest, Cache) {
+    USpice::init_all();
+    USpice::furnsh_absolute("maxq_unit_test_meta.tm");
+
+    std::string Text;
+    for (int i = 0; i < NumTles; ++i)
+    {
+        Text += std::string(Tles[i][0]) + "\n" + Tles[i][1] + "\n" + Tles[i][2] + "\n";
+    }
+    const FString Path = WriteFile(Text);
+
+    // Parsed, then cached, then from the cache
+    FCatalog Parsed, Written, Cached;
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Parsed, false));
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Written));
+    EXPECT_TRUE(Tle::LoadCatalog(Path, Cached));
+
+    EXPECT_EQ(Cached.Num(), NumTles);
+    for (int i = 0; i < NumTles; ++i)
+    {
+        EXPECT_TRUE(FString(Cached.GetName(i)) == FString(Parsed.GetName(i)));
+        EXPECT_EQ(Cached.GetCatalogNumber(i), Parsed.GetCatalogNumber(i));
+        for (int k = 0; k < 10; ++k)
+        {
+            EXPECT_EQ(Cached.GetElements(i).elems[k], Parsed.GetElements(i).elems[k]);
+        }
+    }
+
+    std::remove(CatalogFile);
+}
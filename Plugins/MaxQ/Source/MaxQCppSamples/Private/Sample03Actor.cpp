@@ -100,6 +100,7 @@ void ASample03Actor::BeginPlay()
     }
 
     PrimaryActorTick.SetTickFunctionEnable(EnableTick);
+    MaxQSamples::UseSharedClock(this);
 }
 
 
@@ -558,7 +559,7 @@ void ASample03Actor::InitializeSolarSystem(FSamplesSolarSystemState& State)
 
 void ASample03Actor::UpdateSolarSystem(FSamplesSolarSystemState& State, float DeltaTime)
 {
-    SolarSystemState.CurrentTime += DeltaTime * SolarSystemState.TimeScale;
+    MaxQSamples::UpdateTime(this, SolarSystemState, DeltaTime);
 
     // Intermediate outputs:
     // r: sun's position relative to earth
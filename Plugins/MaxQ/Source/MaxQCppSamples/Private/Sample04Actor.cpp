@@ -85,6 +85,7 @@ void ASample04Actor::BeginPlay()
     }
 
     PrimaryActorTick.SetTickFunctionEnable(EnableTick);
+    MaxQSamples::UseSharedClock(this);
 }
 
 
@@ -427,7 +428,7 @@ void ASample04Actor::InitializeSolarSystem()
 
 void ASample04Actor::UpdateSolarSystem(float DeltaTime)
 {
-    SolarSystemState.CurrentTime += DeltaTime * SolarSystemState.TimeScale;
+    MaxQSamples::UpdateTime(this, SolarSystemState, DeltaTime);
 
     bool success = true;
     success &= MaxQSamples::UpdateSunDirection(OriginNaifName, OriginReferenceFrame, SolarSystemState.CurrentTime, SunNaifName, SunDirectionalLight);
@@ -446,7 +447,7 @@ void ASample04Actor::UpdateSolarSystem(float DeltaTime)
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Time Scale: %f x"), SolarSystemState.TimeScale.AsSeconds()));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Scale PLANETS/MOON : 1/%d"), (int)(BodyScale * UE_Units_Per_KM)));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Scale Solar System Distances : 1/%d"), (int)(DistanceScale * UE_Units_Per_KM)));
-        GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Display Time: %s"), *SolarSystemState.CurrentTime.ToString()));
+        GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Display Time: %s UTC"), DisplayTime.Update(SolarSystemState.CurrentTime)));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Origin Reference Frame: %s"), *OriginReferenceFrame.ToString()));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Origin Observer Naif Name: %s"), *OriginNaifName.ToString()));
     }
@@ -12,7 +12,14 @@
 #include "SampleUtilities.h"
 #include "Sample05TelemetryActor.h"
 #include "SpiceOrbits.h"
+#include "MaxQOrbitPathComponent.h"
 #include "GetTelemetryFromServer.h"
+#include "TelemetryProvider.h"
+#include "SpiceTeme.h"
+#include "MaxQSatelliteCatalogComponent.h"
+#include "SampleNametagWidget.h"
+#include "SampleLabelManagerComponent.h"
+#include "Components/StaticMeshComponent.h"
 
 using MaxQSamples::Log;
 using namespace MaxQ::Data;
@@ -30,6 +37,13 @@ ASample05Actor::ASample05Actor()
 {
     SetRootComponent(CreateDefaultSubobject<USceneComponent>("Root"));
 
+    SatelliteCatalog = CreateDefaultSubobject<UMaxQSatelliteCatalogComponent>("SatelliteCatalog");
+    SatelliteCatalog->SetupAttachment(GetRootComponent());
+    bInstancedTelemetry = true;
+
+    Labels = CreateDefaultSubobject<USampleLabelManagerComponent>("Labels");
+    OriginRadii = FVector::ZeroVector;
+
     USampleUtilities::GetDefaultBasicKernels(BasicKernels);
 
     // We need to add geophysical.ker to get physical constants of Earth needed
@@ -74,11 +88,13 @@ void ASample05Actor::BeginPlay()
         TLEs();
 
         InitAnimation();
+        InitSatelliteCatalog();
 
         // Get telemetry from server and create objects in orbit
         RequestTelemetryByHttp();
     }
     PrimaryActorTick.SetTickFunctionEnable(EnableTick);
+    MaxQSamples::UseSharedClock(this);
 }
 
 
@@ -91,7 +107,7 @@ void ASample05Actor::Tick(float DeltaSeconds)
 {
     Super::Tick(DeltaSeconds);
 
-    SolarSystemState.CurrentTime += DeltaSeconds * SolarSystemState.TimeScale;
+    MaxQSamples::UpdateTime(this, SolarSystemState, DeltaSeconds);
 
     bool success = true;
     success &= MaxQSamples::UpdateBodyPositions(OriginNaifName, OriginReferenceFrame, DistanceScale, SolarSystemState);
@@ -101,11 +117,17 @@ void ASample05Actor::Tick(float DeltaSeconds)
     if (GEngine)
     {
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Time Scale: %f x"), SolarSystemState.TimeScale.AsSeconds()));
-        GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Display Time: %s"), *SolarSystemState.CurrentTime.ToString()));
+        GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Display Time: %s UTC"), DisplayTime.Update(SolarSystemState.CurrentTime)));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Origin Reference Frame: %s"), *OriginReferenceFrame.ToString()));
         GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Origin Observer Naif Name: %s"), *OriginNaifName.ToString()));
+        if (bInstancedTelemetry)
+        {
+            GEngine->AddOnScreenDebugMessage(-1, 0.f, FColor::White, *FString::Printf(TEXT("Objects Drawn: %d of %d"), SatelliteCatalog->GetNumVisible(), SatelliteCatalog->GetNumSatellites()));
+        }
     }
 
+    UpdateLabels();
+
     if (!success)
     {
         // Restart time...
@@ -293,6 +315,17 @@ void ASample05Actor::TLEs()
         USpice::evsgp4(ResultCode, ErrorMessage, state, et, GeophysicalConstants, TwoLineElements);
 
         Log(FString::Printf(TEXT("TLEs Hubble Space Telescope's State Vector (TEME Frame) = %s"), *state.ToString()), ResultCode);
+
+        // TEME isn't a SPICE frame, so sxform can't convert it.  The TEME to
+        // J2000 transformation only depends on the time, so for a whole
+        // catalog it's computed once and applied to every state at once.
+        MaxQ::Covariance::FStateMatrix TemeToJ2000;
+        MaxQ::Teme::ToJ2000(et, TemeToJ2000);
+
+        FSStateVector j2000State;
+        MaxQ::Teme::Transform(TemeToJ2000, MakeArrayView(&state, 1), MakeArrayView(&j2000State, 1));
+
+        Log(FString::Printf(TEXT("TLEs Hubble Space Telescope's State Vector (J2000 Frame) = %s"), *j2000State.ToString()), ResultCode);
     }
 
     if (ResultCode != ES_ResultCode::Success)
@@ -321,17 +354,32 @@ void ASample05Actor::InitAnimation()
 //-----------------------------------------------------------------------------
 // Name: RequestTelemetryByHttp
 // Desc:
-// Send a telemetry data request to Celestrak
+// Send a telemetry data request to Celestrak (or read it from TelemetryPath)
 //-----------------------------------------------------------------------------
 
 void ASample05Actor::RequestTelemetryByHttp()
 {
-    Log(TEXT("RequestTelemetryByHttp sending telemetry request to server by http"));
+    if (!TelemetryPath.IsEmpty())
+    {
+        Log(FString::Printf(TEXT("RequestTelemetryByHttp reading telemetry from %s"), *TelemetryPath));
+
+        // This actor's requests are served from one snapshot of the files.
+        // Everyone else's still go to the server.
+        if (!TelemetryProvider.IsValid())
+        {
+            TelemetryProvider = MakeShared<MaxQSamples::FLocalTelemetryProvider>(MaxQSamples::MaxQPathAbsolutified(TelemetryPath));
+        }
+    }
+    else
+    {
+        Log(TEXT("RequestTelemetryByHttp sending telemetry request to server by http"));
+    }
 
     // Uses the Http module to send request by http
     UGetTelemetryFromServer_AsyncExecution* Request = UGetTelemetryFromServer_AsyncExecution::IssueTelemetryRequest(GetWorld(), TelemetryObjectId, TEXT("TLE"));
     if (ensure(IsValid(Request)))
     {
+        Request->Provider = TelemetryProvider;
         Request->OnSuccess.AddDynamic(this, &ASample05Actor::ProcessTelemetryResponseAsTLE);
         Request->OnError.AddDynamic(this, &ASample05Actor::ProcessTelemetryResponseError);
     }
@@ -355,6 +403,26 @@ void ASample05Actor::ProcessTelemetryResponseAsTLE(const FString& ObjectId, cons
     Log(TEXT("ProcessTelemetryResponseAsTLE Telemetry response received from server"));
     Log(FString::Printf(TEXT("ProcessTelemetryResponseAsTLE Telemetry : %s"), *(Telemetry.Left(750) + TEXT("..."))), FColor::Green, 15.f);
 
+    // Every object in one component: no actors, widgets or ticks per object
+    if (bInstancedTelemetry)
+    {
+        ES_ResultCode ResultCode;
+        FString ErrorMessage;
+        const int32 First = SatelliteCatalog->GetNumSatellites();
+        SatelliteCatalog->AddTelemetry(ResultCode, ErrorMessage, Telemetry);
+        Log(FString::Printf(TEXT("ProcessTelemetryResponseAsTLE added %d objects %s"), SatelliteCatalog->GetNumSatellites() - First, *ErrorMessage), ResultCode);
+
+        // By default always label, and render orbits for, ISS-related objects
+        for (int32 i = First; i < SatelliteCatalog->GetNumSatellites(); ++i)
+        {
+            const FString Name = SatelliteCatalog->GetSatelliteName(i);
+            const bool bIss = Name.StartsWith(TEXT("ISS"));
+            SatelliteCatalog->SetSelected(i, bIss);
+            CatalogLabels.Add(Labels->AddLabel(Name, bIss));
+        }
+        return;
+    }
+
     TArray<FString> TLEArray;
     if (0 == (Telemetry.ParseIntoArrayLines(TLEArray, true) % 3))
     {
@@ -438,24 +506,40 @@ void ASample05Actor::AddTelemetryObject(const FString& ObjectId, const FString&
             // There's several ways this could have been done, obviously.
             // Is this the best?
             // Hey, there's no right or wrong solutions, only solutions optimized to different criteria.
-            TelemetryObject->PropagateByTLEs.BindUObject(this, &ASample05Actor::PropagateTLE);
+            TelemetryObject->CurrentTime.BindUObject(this, &ASample05Actor::GetCurrentTime);
             TelemetryObject->XformPositionCallback.BindUObject(this, &ASample05Actor::TransformPosition);
-
-            TelemetryObject->ComputeConic.BindUObject(this, &ASample05Actor::ComputeConic);
-            TelemetryObject->RenderDebugOrbit.BindUObject(this, &ASample05Actor::RenderDebugOrbit);
-            TelemetryObject->PropagateByKeplerianElements.BindUObject(this, &ASample05Actor::EvaluateOrbitalElements);
-            TelemetryObject->GetOrbitalElements.BindUObject(this, &ASample05Actor::GetOrbitalElements);
             TelemetryObject->GetConicFromKepler.BindUObject(this, &ASample05Actor::GetConicFromKepler);
 
-            // By default only render debug orbits for ISS-related objects
+            // The telemetry object propagates its own trajectory
+            TelemetryObject->GeophysicalConstants = EarthConstants;
+            TelemetryObject->gm = gm;
+
+            // Orbits are in km, centered on the planet
+            TelemetryObject->OrbitPathComponent->SetWorldTransform(FTransform(FScaleMatrix(1. / DistanceScale)));
+
+            // By default only render orbits for ISS-related objects
             bool bShouldRenderOrbit = ObjectName.StartsWith(TEXT("ISS"));
 
-            TelemetryObject->Init(ObjectId, ObjectName, Elements, bShouldRenderOrbit);
+            TelemetryObject->Init(ObjectId, ObjectName, Elements, bShouldRenderOrbit, Labels);
         }
     }
 }
 
 
+// ============================================================================
+//
+//-----------------------------------------------------------------------------
+// Name: GetCurrentTime
+// Desc:
+// The telemetry objects' clock
+//-----------------------------------------------------------------------------
+
+FSEphemerisTime ASample05Actor::GetCurrentTime() const
+{
+    return SolarSystemState.CurrentTime;
+}
+
+
 // ============================================================================
 //
 //-----------------------------------------------------------------------------
@@ -476,6 +560,93 @@ bool ASample05Actor::PropagateTLE(const FSTwoLineElements& TLEs, FSStateVector&
 }
 
 
+// ============================================================================
+//
+//-----------------------------------------------------------------------------
+// Name: InitSatelliteCatalog
+// Desc:
+// Sets up the instanced alternative to spawning an actor per object.  The
+// catalog's positions are km from the Earth's center, so it's scaled down
+// like the orbit paths are.  Unless it has its own, it borrows the
+// telemetry actor's mesh and nametag, so the sample looks the same either
+// way.  Either way, nametags come from the label manager.
+//-----------------------------------------------------------------------------
+void ASample05Actor::InitSatelliteCatalog()
+{
+    const ASample05TelemetryActor* Defaults = TelemetryObjectClass ? TelemetryObjectClass->GetDefaultObject<ASample05TelemetryActor>() : nullptr;
+    if (!NametagWidgetClass && Defaults)
+    {
+        NametagWidgetClass = Defaults->NametagWidgetClass;
+    }
+    Labels->NametagWidgetClass = NametagWidgetClass;
+
+    // Labels behind the planet are hidden
+    ES_ResultCode ResultCode;
+    FSDistanceVector Radii;
+    Bodvrd(Radii, OriginNaifName, Name_RADII, &ResultCode);
+    if (ResultCode == ES_ResultCode::Success)
+    {
+        OriginRadii = FVector(Radii.x.km, Radii.y.km, Radii.z.km) / DistanceScale;
+    }
+
+    SatelliteCatalog->SetVisibility(bInstancedTelemetry);
+    SatelliteCatalog->SetComponentTickEnabled(bInstancedTelemetry);
+    if (!bInstancedTelemetry)
+    {
+        return;
+    }
+
+    SatelliteCatalog->SetWorldTransform(FTransform(FScaleMatrix(1. / DistanceScale)));
+    SatelliteCatalog->ObserverReferenceFrame = OriginReferenceFrame.ToString();
+
+    const UStaticMeshComponent* Mesh = Defaults ? Defaults->MeshComponent.Get() : nullptr;
+    if (!SatelliteCatalog->GetStaticMesh() && Mesh && Mesh->GetStaticMesh())
+    {
+        SatelliteCatalog->SetStaticMesh(Mesh->GetStaticMesh());
+        for (int32 i = 0; i < Mesh->GetNumMaterials(); ++i)
+        {
+            SatelliteCatalog->SetMaterial(i, Mesh->GetMaterial(i));
+        }
+
+        // The same size in the world, inside the scaled-down catalog
+        SatelliteCatalog->SatelliteScale = Mesh->GetRelativeScale3D().GetMax() * DistanceScale;
+    }
+}
+
+
+// ============================================================================
+//
+//-----------------------------------------------------------------------------
+// Name: UpdateLabels
+// Desc:
+// Hands the label manager the planet, and the catalog's objects' locations.
+// It works out which nametags to show, for every object at once.  (Telemetry
+// actors update their own labels.)
+//-----------------------------------------------------------------------------
+void ASample05Actor::UpdateLabels()
+{
+    const TWeakObjectPtr<AActor>* Origin = SolarSystemState.SolarSystemBodyMap.Find(OriginNaifName);
+    if (Origin && Origin->IsValid() && !OriginRadii.IsZero())
+    {
+        const AActor* Body = Origin->Get();
+        Labels->SetOccluder(FTransform(Body->GetActorQuat(), Body->GetActorLocation()), OriginRadii);
+    }
+    else
+    {
+        Labels->ClearOccluder();
+    }
+
+    const int32 NumSatellites = CatalogLabels.Num();
+    CatalogLocations.SetNumUninitialized(NumSatellites, false);
+    CatalogLocated.SetNumUninitialized(NumSatellites, false);
+    for (int32 i = 0; i < NumSatellites; ++i)
+    {
+        CatalogLocated[i] = SatelliteCatalog->GetSatelliteLocation(i, CatalogLocations[i]);
+    }
+    Labels->SetLocations(CatalogLabels, CatalogLocations, CatalogLocated);
+}
+
+
 // ============================================================================
 //
 //-----------------------------------------------------------------------------
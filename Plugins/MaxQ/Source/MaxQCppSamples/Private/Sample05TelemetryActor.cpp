@@ -8,8 +8,10 @@
 #include "Sample05TelemetryActor.h"
 #include "Components/StaticMeshComponent.h"
 #include "GameFramework/PlayerController.h"
+#include "MaxQOrbitPathComponent.h"
 #include "Spice.h"
 #include "SampleUtilities.h"
+#include "SampleLabelManagerComponent.h"
 
 using MaxQSamples::Log;
 using namespace MaxQ::Data;
@@ -25,6 +27,15 @@ ASample05TelemetryActor::ASample05TelemetryActor()
     MeshComponent = CreateDefaultSubobject<UStaticMeshComponent>("Root");
     SetRootComponent(MeshComponent);
 
+    // The orbit is in the planet's frame, not the object's, so it doesn't
+    // move with the object.  Its conic is only retessellated when it changes.
+    OrbitPathComponent = CreateDefaultSubobject<UMaxQOrbitPathComponent>("OrbitPath");
+    OrbitPathComponent->SetupAttachment(MeshComponent);
+    OrbitPathComponent->SetUsingAbsoluteLocation(true);
+    OrbitPathComponent->SetUsingAbsoluteRotation(true);
+    OrbitPathComponent->SetUsingAbsoluteScale(true);
+    OrbitPathComponent->SetVisibility(false);
+
     PrimaryActorTick.bCanEverTick = true;
     PrimaryActorTick.TickGroup = ETickingGroup::TG_PostPhysics;
 
@@ -42,49 +53,55 @@ void ASample05TelemetryActor::BeginPlay()
 }
 
 
+//-----------------------------------------------------------------------------
+// Name: EndPlay
+// Desc: 
+//-----------------------------------------------------------------------------
+void ASample05TelemetryActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (LabelManager.IsValid())
+    {
+        LabelManager->RemoveLabel(Label);
+    }
+    LabelManager.Reset();
+    Label = INDEX_NONE;
+
+    Super::EndPlay(EndPlayReason);
+}
+
+
 //-----------------------------------------------------------------------------
 // Name: Init
 // Desc: Initialize this object with data (it's name, etc.)
 //-----------------------------------------------------------------------------
-void ASample05TelemetryActor::Init(const FString& NewObjectId, const FString& NewObjectName, const FSTwoLineElements& NewTLEs, bool bNewShouldRenderOrbit)
+void ASample05TelemetryActor::Init(const FString& NewObjectId, const FString& NewObjectName, const FSTwoLineElements& NewTLEs, bool bNewShouldRenderOrbit, USampleLabelManagerComponent* Labels)
 {
     ObjectId = NewObjectId;
     ObjectName = NewObjectName;
     TLElements = NewTLEs;
     bShouldRenderOrbit = false;
 
-    // Create the Nametag UI-widget.
-    if (NametagWidgetInstance.Get() == nullptr && NametagWidgetClass && GetNetMode() != ENetMode::NM_DedicatedServer)
+    // The nametag is one of the label manager's labels.  It decides when to
+    // show it (on screen, not behind the planet, not cluttered)
+    if (Labels && Label == INDEX_NONE)
     {
-        USampleNametagWidget* Nametag = CreateWidget<USampleNametagWidget>(GetWorld()->GetFirstPlayerController(), NametagWidgetClass);
-
-        if (Nametag)
-        {
-            // The nametag needs to know:
-            // 1. The object's name.
-            // 2. When the position updates.
-            // 3. When the nametag is visible or hidden behind the planet
-            Nametag->Init(ObjectName, PositionUpdate, VisibilityUpdate);
-        }
+        LabelManager = Labels;
+        Label = Labels->AddLabel(ObjectName);
+    }
 
-        // Initially hide the nametag until we know otherwise.
-        NametagWidgetInstance = Nametag;
-        VisibilityUpdate.ExecuteIfBound(false);
+    // The object's trajectory starts out as its TLE, from now.  Bumps append
+    // conics to it.  States stay in TEME, as evsgp4's always have here.
+    Trajectory = MaxQ::Hybrid::FTrajectory(TEXT("TEME"), gm);
+    PropagateStateByTLEs = true;
+    Segment = INDEX_NONE;
 
-        // Use the telemetry to compute a state vector (location & velocity)
-        if (ComputeConic.IsBound())
+    if (CurrentTime.IsBound() && Trajectory.AddTle(CurrentTime.Execute(), TLElements, GeophysicalConstants))
+    {
+        // Compute the shape of the orbit (conic: ellipse or hyperbola)
+        // This will be used to render the orbit if desired.
+        if (UpdateConic())
         {
-            FSStateVector StateVector;
-            
-            // Compute the shape of the orbit (conic: ellipse or hyperbola)
-            // This will be used to render the orbit if desired.
-            if (PropagateByTLEs.Execute(TLElements, StateVector))
-            {
-                if (ComputeConic.Execute(StateVector, OrbitalConic, bIsHyperbolic))
-                {
-                    bShouldRenderOrbit = bNewShouldRenderOrbit;
-                }
-            }
+            bShouldRenderOrbit = bNewShouldRenderOrbit;
         }
     }
 }
@@ -96,77 +113,52 @@ void ASample05TelemetryActor::Init(const FString& NewObjectId, const FString& Ne
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::Tick(float DeltaSeconds)
 {
-    // Which mode are we in?  Propagate accordingly
-    if (PropagateStateByTLEs)
-    {
-        PropagateTLE();
-    }
-    else
-    {
-        PropagateKepler();
-    }
+    Propagate();
 
-    bool bVisible = true;
-
-    // Don't bother unless this is a client/listen server...
-    // But fade the object's label out unless it's near the front of the
-    // planet... don't let it be so visible behind it.
-    if (GetNetMode() != ENetMode::NM_DedicatedServer)
+    // Render the orbit for a sub-set of objects.
+    // The path component only rebuilds its lines when the conic changes.
+    if (bShouldRenderOrbit)
     {
-        // Dirty hack cheat... Knowing the view is centered around the origin
-        APlayerController* PC = GetWorld()->GetFirstPlayerController();
-        if (PC && PC->PlayerCameraManager)
-        {
-            FVector CameraLocation = PC->PlayerCameraManager->GetCameraLocation();
-            FVector MyLocation = GetActorLocation();
-            FVector LookDirection = MyLocation - CameraLocation;
-
-            bVisible = LookDirection.Dot(MyLocation) < 0;
-            if (bWasVisible ^ bVisible)
-            {
-                VisibilityUpdate.ExecuteIfBound(bVisible);
-                bWasVisible = bVisible;
-            }
-        }
-    }
-
-    // Render the debug orbit for a sub-set of objects.
-    // Debug orbit rendering is SLOW.
-    if (RenderDebugOrbit.IsBound() && bShouldRenderOrbit)
-    {
-        RenderDebugOrbit.Execute(OrbitalConic, bIsHyperbolic, PropagateStateByTLEs ? FColor::Red : FColor::Yellow, PropagateStateByTLEs ? 0.2f : 0.5f);
+        OrbitPathComponent->SetConic(OrbitalConic, bIsHyperbolic);
+        OrbitPathComponent->SetLineColor(PropagateStateByTLEs ? FColor::Red : FColor::Yellow);
+        OrbitPathComponent->SetLineThickness(PropagateStateByTLEs ? 1.f : 2.f);
     }
+    OrbitPathComponent->SetVisibility(bShouldRenderOrbit);
 }
 
 
 // ============================================================================
 //
 //-----------------------------------------------------------------------------
-// Name: PropagateTLE
+// Name: Propagate
 // Desc:
-// Call the main actor, which owns the state to propagate the orbit by
-// "Two Line Element"
+// Evaluate the trajectory at the current time, whether that's by "Two Line
+// Element" or by a conic from a bump.  It's a lookup of which segment of
+// the trajectory is flying, and one propagation.
 //-----------------------------------------------------------------------------
 
-void ASample05TelemetryActor::PropagateTLE()
+void ASample05TelemetryActor::Propagate()
 {
     // Sample05Actor owns the state of the universe... the current time, etc
-    // Instead of pulling thee state from there or pushing it to here,
-    // have that actor do the propagating etc.
-    if (PropagateByTLEs.IsBound() && XformPositionCallback.IsBound())
+    if (CurrentTime.IsBound() && XformPositionCallback.IsBound())
     {
-        FSStateVector StateVector;
-        bool bResult = PropagateByTLEs.Execute(TLElements, StateVector);
+        const FSEphemerisTime et = CurrentTime.Execute();
 
-        // We got an orbital state vector (location etc)
-        // So transform it to a UE position and place the actor.
+        FSStateVector StateVector;
         FVector UEScenegraphVector;
-        bResult &= XformPositionCallback.Execute(StateVector.r, UEScenegraphVector);
+        if (Trajectory.Evaluate(et, StateVector) && XformPositionCallback.Execute(StateVector.r, UEScenegraphVector))
+        {
+            MoveTo(UEScenegraphVector);
+        }
 
-        if (bResult)
+        // Time can run backwards, past a bump, so which mode we're in is
+        // whichever segment is flying now
+        const int32 Current = Trajectory.FindSegment(et);
+        if (Current != Segment)
         {
-            SetActorLocation(UEScenegraphVector);
-            PositionUpdate.ExecuteIfBound(UEScenegraphVector);
+            Segment = Current;
+            PropagateStateByTLEs = Segment != INDEX_NONE && Trajectory.GetSegment(Segment).Type == MaxQ::Hybrid::ESegment::Tle;
+            UpdateConic();
         }
     }
 }
@@ -175,29 +167,42 @@ void ASample05TelemetryActor::PropagateTLE()
 // ============================================================================
 //
 //-----------------------------------------------------------------------------
-// Name: PropagateKepler
+// Name: UpdateConic
 // Desc:
-// Call the main actor, which owns the state to propagate the orbit by
-// "classical" orbital elements.
+// Update the debug-orbit conic (ellipse/hyperbola) for orbit rendering.
+// Conics from bumps keep their elements, so there's no oscelt to do.
 //-----------------------------------------------------------------------------
 
-void ASample05TelemetryActor::PropagateKepler()
+bool ASample05TelemetryActor::UpdateConic()
 {
-    // Same deal as above (PropagateTLE) about the state of the universe etc.
-    if (PropagateByKeplerianElements.IsBound() && XformPositionCallback.IsBound())
+    if (CurrentTime.IsBound() && GetConicFromKepler.IsBound())
     {
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
+        if (Trajectory.Osculate(CurrentTime.Execute(), KeplerianElements))
         {
-            // Transform the state to a UE position and place the actor.
-            FVector UEScenegraphVector;
-            if (XformPositionCallback.Execute(StateVector.r, UEScenegraphVector))
-            {
-                SetActorLocation(UEScenegraphVector);
-                PositionUpdate.ExecuteIfBound(UEScenegraphVector);
-            }
+            return GetConicFromKepler.Execute(KeplerianElements, OrbitalConic, bIsHyperbolic);
         }
     }
+
+    return false;
+}
+
+
+
+// ============================================================================
+//
+//-----------------------------------------------------------------------------
+// Name: MoveTo
+// Desc:
+// Place the actor, and its label.
+//-----------------------------------------------------------------------------
+
+void ASample05TelemetryActor::MoveTo(const FVector& Location)
+{
+    SetActorLocation(Location);
+    if (LabelManager.IsValid())
+    {
+        LabelManager->SetLocation(Label, Location);
+    }
 }
 
 
@@ -213,23 +218,10 @@ void ASample05TelemetryActor::PropagateKepler()
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::GoKeplerian()
 {
-    if (PropagateStateByTLEs && PropagateByTLEs.IsBound())
+    if (PropagateStateByTLEs)
     {
-        FSStateVector StateVector;
-        bool bResult = PropagateByTLEs.Execute(TLElements, StateVector);
-
-        if (bResult)
-        {
-            bResult &= GetOrbitalElements.Execute(StateVector, KeplerianElements);
-        }
-
-        if (bResult)
-        {   // No more updating by TLEs!  Go Kepler!
-            PropagateStateByTLEs = false;
-        }
-        
-        // Start rendering this orbit, if we're not already.
-        bShouldRenderOrbit = true;
+        // A maneuver without any velocity change: from now on, a conic
+        BumpVelocity(FSVelocityVector::Zero);
     }
 }
 
@@ -237,34 +229,39 @@ void ASample05TelemetryActor::GoKeplerian()
 //-----------------------------------------------------------------------------
 // Name: BumpVelocity
 // Desc:
-// Modify the state vector to add velocity.
-// Update the orbital params and the debug orbit accordingly.
+// Add velocity to the current state.
+// The trajectory gets a new conic from now, and the debug orbit with it.
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpVelocity(const FSVelocityVector& Direction)
 {
-    if (PropagateByKeplerianElements.IsBound() && GetOrbitalElements.IsBound() && GetConicFromKepler.IsBound())
+    if (CurrentTime.IsBound())
     {
-        // Make sure the orbital elements are valid.
-        GoKeplerian();
-
-        // Compute the current statevector from orbital elements.
-        FSStateVector StateVector;
-        if (!PropagateStateByTLEs && PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
+        const FSEphemerisTime et = CurrentTime.Execute();
+        if (Trajectory.Maneuver(et, Direction))
         {
-            // Adjust the velocity.
-            StateVector.v += Direction;
-            
-            // Now recompute the new orbital elements
-            if (GetOrbitalElements.Execute(StateVector, KeplerianElements))
-            {
-                // And update the debug-orbit conic (ellipse/hyperbola) for orbit rendering
-                GetConicFromKepler.Execute(KeplerianElements, OrbitalConic, bIsHyperbolic);
-            }
+            // No more updating by TLEs!  Go Kepler!
+            Segment = Trajectory.FindSegment(et);
+            PropagateStateByTLEs = false;
+            UpdateConic();
         }
+
+        // Start rendering this orbit, if we're not already.
+        bShouldRenderOrbit = true;
     }
 }
 
 
+//-----------------------------------------------------------------------------
+// Name: GetState
+// Desc:
+// The current state vector, to bump relative to
+//-----------------------------------------------------------------------------
+bool ASample05TelemetryActor::GetState(FSStateVector& StateVector) const
+{
+    return CurrentTime.IsBound() && Trajectory.Evaluate(CurrentTime.Execute(), StateVector);
+}
+
+
 //-----------------------------------------------------------------------------
 // Name: BumpPrograde
 // Desc:
@@ -272,15 +269,10 @@ void ASample05TelemetryActor::BumpVelocity(const FSVelocityVector& Direction)
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpPrograde()
 {
-    if(PropagateByKeplerianElements.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
-
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            BumpVelocity(StateVector.v * VelocityBumpFraction);
-        }
+        BumpVelocity(StateVector.v * VelocityBumpFraction);
     }
 }
 
@@ -292,15 +284,10 @@ void ASample05TelemetryActor::BumpPrograde()
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpRetrograde()
 {
-    if (PropagateByKeplerianElements.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
-
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            BumpVelocity(-StateVector.v * VelocityBumpFraction);
-        }
+        BumpVelocity(-StateVector.v * VelocityBumpFraction);
     }
 }
 
@@ -312,19 +299,14 @@ void ASample05TelemetryActor::BumpRetrograde()
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpRadial()
 {
-    if (PropagateByKeplerianElements.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
-
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            FSDistance Speed;
-            auto Radial = Unorm(Speed, StateVector.r);
-            FSVelocityVector bump = VelocityBumpFraction * StateVector.v.Magnitude() * Radial;
+        FSDistance Speed;
+        auto Radial = Unorm(Speed, StateVector.r);
+        FSVelocityVector bump = VelocityBumpFraction * StateVector.v.Magnitude() * Radial;
 
-            BumpVelocity(bump);
-        }
+        BumpVelocity(bump);
     }
 }
 
@@ -336,19 +318,14 @@ void ASample05TelemetryActor::BumpRadial()
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpAntiRadial()
 {
-    if (PropagateByKeplerianElements.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
+        FSDistance Speed;
+        auto Radial = Unorm(Speed, StateVector.r);
+        FSVelocityVector bump = -VelocityBumpFraction * Radial * StateVector.v.Magnitude();
 
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            FSDistance Speed;
-            auto Radial = Unorm(Speed, StateVector.r);
-            FSVelocityVector bump = -VelocityBumpFraction * Radial * StateVector.v.Magnitude();
-
-            BumpVelocity(bump);
-        }
+        BumpVelocity(bump);
     }
 }
 
@@ -362,18 +339,13 @@ void ASample05TelemetryActor::BumpAntiRadial()
 //-----------------------------------------------------------------------------
 void ASample05TelemetryActor::BumpNormal()
 {
-    if (PropagateByKeplerianElements.IsBound() && GetOrbitalElements.IsBound() && GetConicFromKepler.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
-
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            auto Normal = Ucrss(StateVector);
+        auto Normal = Ucrss(StateVector);
 
-            FSVelocityVector bump = VelocityBumpFraction * Normal * StateVector.v.Magnitude();
-            BumpVelocity(bump);
-        }
+        FSVelocityVector bump = VelocityBumpFraction * Normal * StateVector.v.Magnitude();
+        BumpVelocity(bump);
     }
 }
 
@@ -387,17 +359,12 @@ void ASample05TelemetryActor::BumpNormal()
 
 void ASample05TelemetryActor::BumpAntiNormal()
 {
-    if (PropagateByKeplerianElements.IsBound() && GetOrbitalElements.IsBound() && GetConicFromKepler.IsBound())
+    FSStateVector StateVector;
+    if (GetState(StateVector))
     {
-        GoKeplerian();
+        auto Normal = Ucrss(StateVector);
 
-        FSStateVector StateVector;
-        if (PropagateByKeplerianElements.Execute(KeplerianElements, StateVector))
-        {
-            auto Normal = Ucrss(StateVector);
-
-            FSVelocityVector bump = -VelocityBumpFraction * Normal * StateVector.v.Magnitude();
-            BumpVelocity(bump);
-        }
+        FSVelocityVector bump = -VelocityBumpFraction * Normal * StateVector.v.Magnitude();
+        BumpVelocity(bump);
     }
 }
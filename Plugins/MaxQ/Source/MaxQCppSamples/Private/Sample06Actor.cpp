@@ -197,6 +197,7 @@ void ASample06Actor::BeginPlay()
 
 
     PrimaryActorTick.SetTickFunctionEnable(EnableTick);
+    MaxQSamples::UseSharedClock(this);
 }
 
 
@@ -237,7 +238,7 @@ void ASample06Actor::InitializeSolarSystem()
 
 void ASample06Actor::UpdateSolarSystem(float DeltaTime)
 {
-    SolarSystemState.CurrentTime += DeltaTime * SolarSystemState.TimeScale;
+    MaxQSamples::UpdateTime(this, SolarSystemState, DeltaTime);
 
     bool success = true;
     success &= MaxQSamples::UpdateSunDirection(OriginNaifName, OriginReferenceFrame, SolarSystemState.CurrentTime, SunNaifName, SunDirectionalLight);
@@ -0,0 +1,397 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+// 
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/ 
+
+#include "SampleLabelManagerComponent.h"
+#include "SampleNametagWidget.h"
+#include "Async/ParallelFor.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "SceneView.h"
+
+namespace
+{
+    // Labels per batch, per worker
+    constexpr int32 BatchSize = 1024;
+
+    // Not shown, whatever the reason
+    constexpr double Hidden = TNumericLimits<double>::Max();
+
+    // Does the segment from the camera to the label pass through the unit
+    // sphere?  Both are in the occluder's space.  A camera inside it sees
+    // everything.
+    bool IsOccluded(const FVector& Camera, const FVector& Label)
+    {
+        const FVector d = Label - Camera;
+        const double a = d | d;
+        const double b = Camera | d;
+        const double c = (Camera | Camera) - 1.;
+        if (c <= 0. || a <= 0.)
+        {
+            return false;
+        }
+
+        const double Discriminant = b * b - a * c;
+        if (Discriminant <= 0.)
+        {
+            return false;
+        }
+
+        // The nearer intersection, as a fraction of the way to the label
+        const double t = (-b - FMath::Sqrt(Discriminant)) / a;
+        return t > 0. && t < 1.;
+    }
+}
+
+
+USampleLabelManagerComponent::USampleLabelManagerComponent()
+{
+    MaxLabels = 32;
+    MinLabelSpacing = 24.f;
+    ToOccluder = FMatrix::Identity;
+    bHaveOccluder = false;
+    NumShown = 0;
+
+    // After everything has moved, and the camera has too
+    PrimaryComponentTick.bCanEverTick = true;
+    PrimaryComponentTick.TickGroup = ETickingGroup::TG_PostUpdateWork;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: AddLabel
+// Desc: Reuses a removed label's slot, if there is one
+//-----------------------------------------------------------------------------
+int32 USampleLabelManagerComponent::AddLabel(const FString& Name, bool bNewPinned)
+{
+    int32 Label;
+    if (FreeLabels.Num() > 0)
+    {
+        Label = FreeLabels.Pop(false);
+    }
+    else
+    {
+        Label = Names.AddDefaulted();
+        Locations.AddZeroed();
+        bValid.Add(false);
+        bPinned.Add(false);
+        bActive.Add(false);
+        LabelWidgets.Add(INDEX_NONE);
+    }
+
+    Names[Label] = Name;
+    bValid[Label] = false;
+    bPinned[Label] = bNewPinned;
+    bActive[Label] = true;
+    return Label;
+}
+
+
+void USampleLabelManagerComponent::RemoveLabel(int32 Label)
+{
+    if (!bActive.IsValidIndex(Label) || !bActive[Label])
+    {
+        return;
+    }
+
+    const int32 Widget = LabelWidgets[Label];
+    if (Widget != INDEX_NONE)
+    {
+        Widgets[Widget]->Hide();
+        WidgetLabels[Widget] = INDEX_NONE;
+        LabelWidgets[Label] = INDEX_NONE;
+    }
+
+    Names[Label].Empty();
+    bActive[Label] = false;
+    FreeLabels.Add(Label);
+}
+
+
+void USampleLabelManagerComponent::RemoveAllLabels()
+{
+    HideAll();
+    Names.Reset();
+    Locations.Reset();
+    bValid.Reset();
+    bPinned.Reset();
+    bActive.Reset();
+    LabelWidgets.Reset();
+    FreeLabels.Reset();
+}
+
+
+void USampleLabelManagerComponent::SetPinned(int32 Label, bool bNewPinned)
+{
+    if (bActive.IsValidIndex(Label))
+    {
+        bPinned[Label] = bNewPinned;
+    }
+}
+
+
+void USampleLabelManagerComponent::SetLocation(int32 Label, const FVector& WorldLocation, bool bNewValid)
+{
+    if (bActive.IsValidIndex(Label))
+    {
+        Locations[Label] = WorldLocation;
+        bValid[Label] = bNewValid;
+    }
+}
+
+
+void USampleLabelManagerComponent::SetLocations(TConstArrayView<int32> Labels, TConstArrayView<FVector> WorldLocations, TConstArrayView<bool> Valid)
+{
+    check(Labels.Num() == WorldLocations.Num());
+    check(Valid.Num() == 0 || Valid.Num() == Labels.Num());
+
+    for (int32 i = 0; i < Labels.Num(); ++i)
+    {
+        SetLocation(Labels[i], WorldLocations[i], Valid.Num() == 0 || Valid[i]);
+    }
+}
+
+
+void USampleLabelManagerComponent::SetOccluder(const FTransform& BodyToWorld, const FVector& Radii)
+{
+    const FTransform Unscaled(BodyToWorld.GetRotation(), BodyToWorld.GetTranslation());
+    ToOccluder = Unscaled.ToInverseMatrixWithScale() * FScaleMatrix(FVector(1.) / Radii.ComponentMax(FVector(UE_SMALL_NUMBER)));
+    bHaveOccluder = true;
+}
+
+
+void USampleLabelManagerComponent::ClearOccluder()
+{
+    bHaveOccluder = false;
+}
+
+
+void USampleLabelManagerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    if (GetNetMode() != ENetMode::NM_DedicatedServer)
+    {
+        Update();
+    }
+}
+
+
+void USampleLabelManagerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    for (USampleNametagWidget* Widget : Widgets)
+    {
+        if (IsValid(Widget))
+        {
+            Widget->RemoveFromParent();
+        }
+    }
+    Widgets.Reset();
+    WidgetLabels.Reset();
+    LabelWidgets.Init(INDEX_NONE, Names.Num());
+
+    Super::EndPlay(EndPlayReason);
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: Update
+// Desc:
+// 1. In parallel, project every label and test it against the occluder,
+//    giving each visible one a priority (pinned, then nearest first)
+// 2. Pop the visible labels off a heap, best first, keeping each that's far
+//    enough from those kept so far (by a grid of MinLabelSpacing cells),
+//    until there are MaxLabels.  Only as many as it takes are popped.
+// 3. Labels that are still shown keep their widgets; the rest are handed
+//    out from the pool, which only grows up to MaxLabels.
+//-----------------------------------------------------------------------------
+void USampleLabelManagerComponent::Update()
+{
+    APlayerController* Player = GetWorld()->GetFirstPlayerController();
+    ULocalPlayer* LocalPlayer = Player ? Player->GetLocalPlayer() : nullptr;
+
+    FSceneViewProjectionData Projection;
+    if (!LocalPlayer || !LocalPlayer->ViewportClient || !LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, Projection))
+    {
+        HideAll();
+        return;
+    }
+
+    const FMatrix ViewProjection = Projection.ComputeViewProjectionMatrix();
+    const FIntRect ViewRect = Projection.GetConstrainedViewRect();
+    const FVector Camera = Projection.ViewOrigin;
+    const FVector CameraInOccluder = ToOccluder.TransformPosition(Camera);
+
+    const int32 NumLabels = Names.Num();
+    ScreenLocations.SetNumUninitialized(NumLabels, false);
+    Priorities.SetNumUninitialized(NumLabels, false);
+
+    const int32 NumBatches = (NumLabels + BatchSize - 1) / BatchSize;
+    ParallelFor(NumBatches, [&](int32 Batch)
+    {
+        const int32 End = FMath::Min(NumLabels, (Batch + 1) * BatchSize);
+        for (int32 i = Batch * BatchSize; i < End; ++i)
+        {
+            Priorities[i] = Hidden;
+            if (!bActive[i] || !bValid[i])
+            {
+                continue;
+            }
+
+            const FVector& Location = Locations[i];
+            FVector2D Screen;
+            if (!FSceneView::ProjectWorldToScreen(Location, ViewRect, ViewProjection, Screen)
+                || Screen.X < ViewRect.Min.X || Screen.X >= ViewRect.Max.X
+                || Screen.Y < ViewRect.Min.Y || Screen.Y >= ViewRect.Max.Y)
+            {
+                continue;
+            }
+
+            if (bHaveOccluder && IsOccluded(CameraInOccluder, ToOccluder.TransformPosition(Location)))
+            {
+                continue;
+            }
+
+            // Pinned labels sort ahead of every other, nearest first
+            const double DistanceSquared = FVector::DistSquared(Camera, Location);
+            ScreenLocations[i] = Screen;
+            Priorities[i] = bPinned[i] ? -1. / (1. + DistanceSquared) : DistanceSquared;
+        }
+    }, NumBatches <= 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+    TArray<int32> Candidates;
+    for (int32 i = 0; i < NumLabels; ++i)
+    {
+        if (Priorities[i] != Hidden)
+        {
+            Candidates.Add(i);
+        }
+    }
+
+    const auto Before = [this](int32 A, int32 B) { return Priorities[A] < Priorities[B]; };
+    Candidates.Heapify(Before);
+
+    // Kept labels' screen locations, by cell
+    const double CellSize = FMath::Max(MinLabelSpacing, 1.f);
+    const double SpacingSquared = FMath::Square(double(MinLabelSpacing));
+    TMap<FIntPoint, TArray<FVector2D, TInlineAllocator<2>>> Cells;
+
+    TBitArray<> bShown(false, NumLabels);
+    NumShown = 0;
+    while (Candidates.Num() > 0 && NumShown < MaxLabels)
+    {
+        int32 i;
+        Candidates.HeapPop(i, Before, false);
+
+        const FVector2D& Screen = ScreenLocations[i];
+        const FIntPoint Cell(FMath::FloorToInt32(Screen.X / CellSize), FMath::FloorToInt32(Screen.Y / CellSize));
+
+        bool bCluttered = false;
+        for (int32 y = -1; y <= 1 && !bCluttered && !bPinned[i]; ++y)
+        {
+            for (int32 x = -1; x <= 1 && !bCluttered; ++x)
+            {
+                if (const auto* Kept = Cells.Find(Cell + FIntPoint(x, y)))
+                {
+                    for (const FVector2D& Other : *Kept)
+                    {
+                        if (FVector2D::DistSquared(Screen, Other) < SpacingSquared)
+                        {
+                            bCluttered = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!bCluttered)
+        {
+            Cells.FindOrAdd(Cell).Add(Screen);
+            bShown[i] = true;
+            ++NumShown;
+        }
+    }
+
+    // Free the widgets of labels no longer shown
+    TArray<int32> FreeWidgets;
+    for (int32 w = 0; w < Widgets.Num(); ++w)
+    {
+        const int32 Label = WidgetLabels[w];
+        if (Label != INDEX_NONE && !bShown[Label])
+        {
+            LabelWidgets[Label] = INDEX_NONE;
+            WidgetLabels[w] = INDEX_NONE;
+        }
+        if (WidgetLabels[w] == INDEX_NONE)
+        {
+            FreeWidgets.Add(w);
+        }
+    }
+
+    for (TConstSetBitIterator<> It(bShown); It; ++It)
+    {
+        const int32 Label = It.GetIndex();
+        if (LabelWidgets[Label] != INDEX_NONE)
+        {
+            continue;
+        }
+
+        int32 w = INDEX_NONE;
+        if (FreeWidgets.Num() > 0)
+        {
+            w = FreeWidgets.Pop(false);
+        }
+        else if (NametagWidgetClass)
+        {
+            USampleNametagWidget* Widget = CreateWidget<USampleNametagWidget>(Player, NametagWidgetClass);
+            if (Widget)
+            {
+                w = Widgets.Add(Widget);
+                WidgetLabels.Add(INDEX_NONE);
+            }
+        }
+
+        if (w != INDEX_NONE)
+        {
+            WidgetLabels[w] = Label;
+            LabelWidgets[Label] = w;
+        }
+    }
+
+    for (int32 w = 0; w < Widgets.Num(); ++w)
+    {
+        const int32 Label = WidgetLabels[w];
+        if (Label != INDEX_NONE)
+        {
+            Widgets[w]->Show(Names[Label]);
+            Widgets[w]->SetWorldLocation(Locations[Label]);
+        }
+        else
+        {
+            Widgets[w]->Hide();
+        }
+    }
+}
+
+
+void USampleLabelManagerComponent::HideAll()
+{
+    for (int32 w = 0; w < Widgets.Num(); ++w)
+    {
+        const int32 Label = WidgetLabels[w];
+        if (Label != INDEX_NONE)
+        {
+            LabelWidgets[Label] = INDEX_NONE;
+            WidgetLabels[w] = INDEX_NONE;
+        }
+        Widgets[w]->Hide();
+    }
+    NumShown = 0;
+}
@@ -7,3 +7,45 @@
 
 #include "SampleNametagWidget.h"
 
+
+void USampleNametagWidget::Rename_Implementation(const FString& NewObjectName)
+{
+    Init(NewObjectName, PositionUpdate, VisibilityUpdate);
+}
+
+
+void USampleNametagWidget::Show(const FString& NewObjectName)
+{
+    if (!bInitialized)
+    {
+        Init(NewObjectName, PositionUpdate, VisibilityUpdate);
+        bInitialized = true;
+    }
+    else if (NewObjectName != ObjectName)
+    {
+        Rename(NewObjectName);
+    }
+    ObjectName = NewObjectName;
+
+    if (!bShown)
+    {
+        VisibilityUpdate.ExecuteIfBound(true);
+        bShown = true;
+    }
+}
+
+
+void USampleNametagWidget::Hide()
+{
+    if (bShown)
+    {
+        VisibilityUpdate.ExecuteIfBound(false);
+        bShown = false;
+    }
+}
+
+
+void USampleNametagWidget::SetWorldLocation(const FVector& Location)
+{
+    PositionUpdate.ExecuteIfBound(Location);
+}
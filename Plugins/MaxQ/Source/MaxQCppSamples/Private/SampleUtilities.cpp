@@ -6,10 +6,9 @@
 // GitHub:         https://github.com/Gamergenic1/MaxQ/ 
 
 #include "SampleUtilities.h"
-#include "HttpModule.h"
-#include "Interfaces/IHttpRequest.h"
-#include "Interfaces/IHttpResponse.h"
+#include "TelemetryProvider.h"
 #include "Spice.h"
+#include "MaxQClockSubsystem.h"
 #include "Misc/Paths.h"
 #include "HAL/PlatformFileManager.h"
 #include "GenericPlatform/GenericPlatformFile.h"
@@ -339,6 +338,57 @@ namespace MaxQSamples
     }
 
 
+    //-----------------------------------------------------------------------------
+    // Name: UseSharedClock
+    // Desc:
+    // Makes the actor tick after the world's MaxQ clock, so it sees this
+    // frame's time.
+    //-----------------------------------------------------------------------------
+    void UseSharedClock(AActor* Actor)
+    {
+        UMaxQClockSubsystem* Clock = UMaxQClockSubsystem::Get(Actor);
+        if (Clock)
+        {
+            Clock->AddTickPrerequisite(Actor->PrimaryActorTick);
+        }
+    }
+
+
+    //-----------------------------------------------------------------------------
+    // Name: UpdateTime
+    // Desc:
+    // Takes the current time from the world's MaxQ clock, so all samples in a
+    // world share one time.
+    // The samples' buttons (Restart, Now, faster, ...) still just set
+    // CurrentTime and TimeScale.  Only those changes (and the initial values)
+    // are handed to the clock here, so one sample doesn't keep overriding
+    // another's; otherwise the sample just follows the clock.
+    //-----------------------------------------------------------------------------
+    void UpdateTime(const UObject* WorldContextObject, FSamplesSolarSystemState& SolarSystemState, float DeltaTime)
+    {
+        UMaxQClockSubsystem* Clock = UMaxQClockSubsystem::Get(WorldContextObject);
+        if (!Clock)
+        {
+            SolarSystemState.CurrentTime += DeltaTime * SolarSystemState.TimeScale;
+            return;
+        }
+
+        const bool bInitialize = !SolarSystemState.bClockInitialized;
+        if (bInitialize || SolarSystemState.CurrentTime != SolarSystemState.ClockTime)
+        {
+            Clock->SetEphemerisTime(SolarSystemState.CurrentTime);
+        }
+        if (bInitialize || SolarSystemState.TimeScale.seconds != SolarSystemState.ClockTimeScale.seconds)
+        {
+            Clock->SetTimeScale(SolarSystemState.TimeScale);
+        }
+        SolarSystemState.bClockInitialized = true;
+
+        SolarSystemState.CurrentTime = SolarSystemState.ClockTime = Clock->GetEphemerisTime();
+        SolarSystemState.TimeScale = SolarSystemState.ClockTimeScale = Clock->GetTimeScale();
+    }
+
+
     //-----------------------------------------------------------------------------
     // Name: Log
     // Desc:
@@ -580,110 +630,27 @@ void USampleUtilities::GetDefaultInsightMissionKernels(TArray<FString>& InsightM
 
 
 /* DEPRECATED */
-// telemetry will use the celestrak server.
-#define CELESTRAK_URL_BASE "https://celestrak.com"
-
 //-----------------------------------------------------------------------------
 // Name: GetTelemetryFromServer
 // Desc:
 // Fetch telemetry data from a SatCat (satellite catalog).
-// It's tied to a specific server (celestrak) so it doesn't become an overly
-// generalized "swiss army knife" used for more than intended.
+// The data comes from the current telemetry provider (see TelemetryProvider.h),
+// which by default is the celestrak server.
 // Exposed to Blueprints & the Blueprint samples also use this, because
 // it's not implementable in Blueprints alone without a Third Party plugin.
 //-----------------------------------------------------------------------------
 void USampleUtilities::GetTelemetryFromServer(FTelemetryCallback Callback, FString ObjectId, FString Format)
 {
-    // Example URLs
-    // https://celestrak.com/NORAD/elements/gp.php?CATNR=25544&FORMAT=TLE
-    // https://celestrak.com/NORAD/elements/gp.php?GROUP=STATIONS&FORMAT=TLE
-    // https://celestrak.com/NORAD/elements/gp.php?NAME=MICROSAT-R&FORMAT=JSON
-    // https://celestrak.com/NORAD/elements/gp.php?INTDES=2020-025&FORMAT=JSON-PRETTY
-    FString uriBase = CELESTRAK_URL_BASE;
-    FString uriQuery = uriBase + TEXT("/NORAD/elements/gp.php?") + ObjectId + TEXT("&FORMAT") + Format;
-
-    // Requires inclusion of Http module.
-    // (MaxQCppSamples.Build.cs: PrivateDependencyModuleNames.Add("HTTP");)
-    FHttpModule& httpModule = FHttpModule::Get();
-
-    // Create an http request
-    // The request will execute asynchronously, and call us back on the Lambda below
-    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest = httpModule.CreateRequest();
-
-    FString RequestContent;
-
-    // Set up the Http calls (GET vs POST et al, content type, URL).
-    pRequest->SetVerb(TEXT("GET"));
-    pRequest->SetHeader(TEXT("Content-Type"), TEXT("application/x-www-form-urlencoded"));
-
-    pRequest->SetURL(uriQuery);
-
-    // Binds a "Lambda" callback.
-    // The lambda does not execute immediately.  Rather, the function we're in
-    // exits, and when the HTTP response is received the lambda will be called back.
-    // (The lambda in turn will execute a callback delegate so the caller can handle the data.)
-    pRequest->OnProcessRequestComplete().BindLambda(
-        // This is a capture list.
-        // It is necessary because the function executes & returns immediately, yet
-        // the lambda needs access to some of the local variables that went out of scope.
-        // The callback preserves the local variables so the Lambda has access to them.
-        // The 'this' pointer for the object could be preserved here, but we don't need it
-        // and this is a static function anyways (no 'this' pointer to save.)
-        [ObjectId, Callback](
-            // Parameters the caller (http module) send into the callback.
-            FHttpRequestPtr pRequest,
-            FHttpResponsePtr pResponse,
-            bool connectedSuccessfully) mutable {
-
-                // Validate http called us back on the Game Thread...
-                check(IsInGameThread());
-
-                // Was the callback successful?
-                if (connectedSuccessfully) {
-                    // Yes!  Log it...
-                    UE_LOG(LogTemp, Log, TEXT("Space-Track response: %s"), *(pResponse->GetContentAsString().Left(64)));
-
-                    // ...and send the data to the user
-                    if (Callback.IsBound())
-                    {
-                        Callback.Execute(true, ObjectId, pResponse->GetContentAsString());
-                    }
-                }
-                else {
-                    // No.  Mistakes were made.
-                    FString Mistake;
-
-                    switch (pRequest->GetStatus()) {
-                    case EHttpRequestStatus::Failed:
-                        if (pRequest->GetFailureReason() == EHttpFailureReason::ConnectionError)
-                        {
-                            Mistake = TEXT("Connection failed.");
-                        }
-                    default:
-                        Mistake = TEXT("Request failed.");
-                    }
+    // The lambda does not execute immediately.  The provider calls it back on
+    // the game thread once the telemetry arrives.
+    MaxQSamples::GetTelemetryProvider()->Fetch({ ObjectId }, Format, FTelemetryBatchCallback::CreateLambda(
+        [ObjectId, Callback](bool bSuccess, const TArray<FString>& ObjectIds, const FString& Telemetry) mutable {
 
-                    /*
-                    Now on Kindle Prime:
-                        Strings Of Failure, or Bits of Redemption?
-                        How I learned to overcome my mistakes through the power of TCHAR Logs
-                        By SamplesUtility.cpp
-                    */
-                    UE_LOG(LogTemp, Error, TEXT("GetTelemetryFromServer Error: %s"), *Mistake);
-
-                    // Confess the mistake but of course don't divulge any details to anyone.
-                    if (Callback.IsBound())
-                    {
-                        Callback.Execute(false, ObjectId, Mistake);
-                    }
-                }
-                Callback.Unbind();
-        });
-
-    UE_LOG(LogTemp, Log, TEXT("request: %s; content:%s"), *uriBase, *uriQuery);
-
-    pRequest->ProcessRequest();
+            if (Callback.IsBound())
+            {
+                Callback.Execute(bSuccess, ObjectId, Telemetry);
+            }
+            Callback.Unbind();
+        }));
 }
-
-#undef CELESTRAK_URL_BASE
 /* /DEPRECATED */
\ No newline at end of file
@@ -0,0 +1,408 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#include "TelemetryProvider.h"
+#include "SampleUtilities.h"
+#include "SpiceTleCatalog.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+// telemetry will use the celestrak server.
+#define CELESTRAK_URL_BASE "https://celestrak.com"
+
+
+namespace
+{
+    using MaxQSamples::FLocalTelemetryProvider;
+
+    TSharedPtr<MaxQSamples::ITelemetryProvider> TelemetryProvider;
+
+    void Complete(FTelemetryBatchCallback&& Callback, bool bSuccess, TArray<FString>&& ObjectIds, FString&& Telemetry)
+    {
+        AsyncTask(ENamedThreads::GameThread, [Callback = MoveTemp(Callback), bSuccess, ObjectIds = MoveTemp(ObjectIds), Telemetry = MoveTemp(Telemetry)]()
+        {
+            Callback.ExecuteIfBound(bSuccess, ObjectIds, Telemetry);
+        });
+    }
+
+    // Columns 10-17, "98067A" as "1998-067A"
+    FString InternationalDesignator(const FString& Line1)
+    {
+        const FString Field = Line1.Mid(9, 8).TrimStartAndEnd();
+        if (Field.Len() < 5)
+        {
+            return FString();
+        }
+        const int32 Year = FCString::Atoi(*Field.Left(2));
+        return FString::Printf(TEXT("%d-%s"), Year < 57 ? 2000 + Year : 1900 + Year, *Field.Mid(2));
+    }
+}
+
+
+namespace MaxQSamples
+{
+
+// Satellite i of Catalog is the TLE whose lines are Line1s[i] and Line2s[i]
+struct FLocalTelemetryProvider::FSnapshot
+{
+    MaxQ::Tle::FCatalog Catalog;
+    TArray<FString> Line1s;
+    TArray<FString> Line2s;
+
+    // "1998-067A"
+    TArray<FString> InternationalDesignators;
+
+    TMultiMap<FString, int32> Groups;
+};
+
+
+//-----------------------------------------------------------------------------
+// Name: FCelestrakTelemetryProvider::Fetch
+// Desc:
+// One http request per object ID, gathered into one completion.
+//-----------------------------------------------------------------------------
+void FCelestrakTelemetryProvider::Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback)
+{
+    check(IsInGameThread());
+
+    if (ObjectIds.IsEmpty())
+    {
+        Complete(MoveTemp(Callback), false, TArray<FString>(), TEXT("No object IDs requested."));
+        return;
+    }
+
+    // Shared by every request in the batch; the last to finish completes it.
+    struct FBatch
+    {
+        TArray<FString> ObjectIds;
+        TArray<FString> Responses;
+        FTelemetryBatchCallback Callback;
+        int32 Remaining = 0;
+        FString Mistake;
+    };
+
+    TSharedRef<FBatch> Batch = MakeShared<FBatch>();
+    Batch->ObjectIds = ObjectIds;
+    Batch->Responses.SetNum(ObjectIds.Num());
+    Batch->Callback = MoveTemp(Callback);
+    Batch->Remaining = ObjectIds.Num();
+
+    // Requires inclusion of Http module.
+    // (MaxQCppSamples.Build.cs: PrivateDependencyModuleNames.Add("HTTP");)
+    FHttpModule& httpModule = FHttpModule::Get();
+
+    for (int32 i = 0; i < ObjectIds.Num(); ++i)
+    {
+        // Example URLs
+        // https://celestrak.com/NORAD/elements/gp.php?CATNR=25544&FORMAT=TLE
+        // https://celestrak.com/NORAD/elements/gp.php?GROUP=STATIONS&FORMAT=TLE
+        const FString uriQuery = FString::Printf(TEXT(CELESTRAK_URL_BASE "/NORAD/elements/gp.php?%s&FORMAT=%s"), *ObjectIds[i], *Format);
+
+        TSharedRef<IHttpRequest, ESPMode::ThreadSafe> pRequest = httpModule.CreateRequest();
+        pRequest->SetVerb(TEXT("GET"));
+        pRequest->SetHeader(TEXT("Content-Type"), TEXT("application/x-www-form-urlencoded"));
+        pRequest->SetURL(uriQuery);
+
+        pRequest->OnProcessRequestComplete().BindLambda(
+            [Batch, i](FHttpRequestPtr pRequest, FHttpResponsePtr pResponse, bool connectedSuccessfully)
+            {
+                // Validate http called us back on the Game Thread...
+                check(IsInGameThread());
+
+                if (connectedSuccessfully && pResponse.IsValid() && EHttpResponseCodes::IsOk(pResponse->GetResponseCode()))
+                {
+                    Batch->Responses[i] = pResponse->GetContentAsString();
+                }
+                else if (Batch->Mistake.IsEmpty())
+                {
+                    Batch->Mistake = pRequest->GetFailureReason() == EHttpFailureReason::ConnectionError ? TEXT("Connection failed.") : TEXT("Request failed.");
+                    UE_LOG(LogMaxQSamples, Error, TEXT("FCelestrakTelemetryProvider %s: %s"), *Batch->ObjectIds[i], *Batch->Mistake);
+                }
+
+                if (--Batch->Remaining == 0)
+                {
+                    const bool bSuccess = Batch->Mistake.IsEmpty();
+                    FString Telemetry = bSuccess ? FString::Join(Batch->Responses, TEXT("")) : Batch->Mistake;
+                    Batch->Callback.ExecuteIfBound(bSuccess, Batch->ObjectIds, Telemetry);
+                    Batch->Callback.Unbind();
+                }
+            });
+
+        pRequest->ProcessRequest();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FLocalTelemetryProvider::Fetch
+// Desc:
+// Serve the request from the snapshot, loading it first if need be.
+//-----------------------------------------------------------------------------
+void FLocalTelemetryProvider::Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback)
+{
+    check(IsInGameThread());
+
+    if (Format != TEXT("TLE"))
+    {
+        Complete(MoveTemp(Callback), false, TArray<FString>(ObjectIds), FString::Printf(TEXT("FLocalTelemetryProvider serves TLE, not %s."), *Format));
+        return;
+    }
+
+    FRequest Request{ ObjectIds, MoveTemp(Callback) };
+    if (Snapshot.IsValid())
+    {
+        Serve(Snapshot.ToSharedRef(), MoveTemp(Request));
+        return;
+    }
+
+    Pending.Add(MoveTemp(Request));
+    if (bLoading)
+    {
+        return;
+    }
+
+    bLoading = true;
+    Async(EAsyncExecution::ThreadPool, [WeakThis = AsWeak(), Path = Path]()
+    {
+        TArray<FFile> Files = Read(Path);
+
+        AsyncTask(ENamedThreads::GameThread, [WeakThis, Path, Files = MoveTemp(Files)]()
+        {
+            if (TSharedPtr<FLocalTelemetryProvider> This = WeakThis.Pin())
+            {
+                TSharedRef<const FSnapshot> Loaded = Parse(Path, Files);
+                This->Snapshot = Loaded;
+                This->bLoading = false;
+                for (FRequest& Request : This->Pending)
+                {
+                    Serve(Loaded, MoveTemp(Request));
+                }
+                This->Pending.Empty();
+            }
+        });
+    });
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FLocalTelemetryProvider::Read
+// Desc:
+// Read Path's file(s).  Worker thread.
+//-----------------------------------------------------------------------------
+TArray<FLocalTelemetryProvider::FFile> FLocalTelemetryProvider::Read(const FString& Path)
+{
+    TArray<FString> Paths;
+    IFileManager& FileManager = IFileManager::Get();
+    if (FileManager.DirectoryExists(*Path))
+    {
+        for (const TCHAR* Extension : { TEXT("*.txt"), TEXT("*.tle"), TEXT("*.3le") })
+        {
+            TArray<FString> Found;
+            FileManager.FindFiles(Found, *FPaths::Combine(Path, Extension), true, false);
+            for (const FString& File : Found)
+            {
+                Paths.Add(FPaths::Combine(Path, File));
+            }
+        }
+        Paths.Sort();
+    }
+    else
+    {
+        Paths.Add(Path);
+    }
+
+    TArray<FFile> Files;
+    for (const FString& File : Paths)
+    {
+        FFile& Loaded = Files.AddDefaulted_GetRef();
+        Loaded.Group = FPaths::GetBaseFilename(File).ToUpper();
+        if (!FFileHelper::LoadFileToArray(Loaded.Text, *File))
+        {
+            UE_LOG(LogMaxQSamples, Warning, TEXT("FLocalTelemetryProvider could not read %s"), *File);
+            Files.Pop();
+        }
+    }
+
+    return Files;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FLocalTelemetryProvider::Parse
+// Desc:
+// Parse every TLE in the files, keeping each one's lines to serve.
+// Game thread, as ParseCatalog needs the leapseconds kernel.
+//-----------------------------------------------------------------------------
+TSharedRef<const FLocalTelemetryProvider::FSnapshot> FLocalTelemetryProvider::Parse(const FString& Path, const TArray<FFile>& Files)
+{
+    check(IsInGameThread());
+
+    TSharedRef<FSnapshot> Loaded = MakeShared<FSnapshot>();
+    TArray<FAnsiStringView> Records;
+    for (const FFile& File : Files)
+    {
+        const int32 First = Loaded->Catalog.Num();
+        Records.Reset();
+
+        FString ErrorMessage;
+        if (!MaxQ::Tle::ParseCatalog(FAnsiStringView((const ANSICHAR*)File.Text.GetData(), File.Text.Num()), Loaded->Catalog, Records, nullptr, &ErrorMessage))
+        {
+            UE_LOG(LogMaxQSamples, Warning, TEXT("FLocalTelemetryProvider could not parse %s: %s"), *File.Group, *ErrorMessage);
+            continue;
+        }
+
+        for (int32 i = 0; i < Records.Num(); ++i)
+        {
+            // A TLE's record is its two lines.  OMM CSV rows have no lines
+            // to serve, so they're left empty, and never match.
+            FAnsiStringView Line1, Line2;
+            int32 Newline;
+            if (Records[i].FindChar('\n', Newline))
+            {
+                Line1 = Records[i].Left(Newline);
+                Line2 = Records[i].RightChop(Newline + 1);
+                if (Line1.EndsWith('\r'))
+                {
+                    Line1.LeftChopInline(1);
+                }
+            }
+
+            Loaded->Line1s.Add(FString(Line1));
+            Loaded->Line2s.Add(FString(Line2));
+            Loaded->InternationalDesignators.Add(InternationalDesignator(Loaded->Line1s.Last()));
+            Loaded->Groups.Add(File.Group, First + i);
+        }
+    }
+
+    UE_LOG(LogMaxQSamples, Log, TEXT("FLocalTelemetryProvider read %d TLEs from %d file(s) in %s"), Loaded->Catalog.Num(), Files.Num(), *Path);
+    return Loaded;
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FLocalTelemetryProvider::Serve
+// Desc:
+// Gather the request's records, each once, as 3LE text.  Worker thread.
+//-----------------------------------------------------------------------------
+void FLocalTelemetryProvider::Serve(TSharedRef<const FSnapshot> Snapshot, FRequest&& Request)
+{
+    Async(EAsyncExecution::ThreadPool, [Snapshot, Request = MoveTemp(Request)]() mutable
+    {
+        TArray<int32> Matches;
+        TSet<int32> Served;
+        auto Match = [&](int32 Index)
+        {
+            if (Snapshot->Line1s[Index].IsEmpty())
+            {
+                return;
+            }
+
+            bool bAlreadyServed;
+            Served.Add(Index, &bAlreadyServed);
+            if (!bAlreadyServed) Matches.Add(Index);
+        };
+
+        for (const FString& ObjectId : Request.ObjectIds)
+        {
+            FString Key, Value;
+            ObjectId.Split(TEXT("="), &Key, &Value);
+            Key.TrimStartAndEndInline();
+            Value.TrimStartAndEndInline();
+
+            const int32 NumMatches = Matches.Num();
+            if (Key == TEXT("CATNR"))
+            {
+                const int32 Index = Snapshot->Catalog.Find(FCString::Atoi(*Value));
+                if (Index != INDEX_NONE)
+                {
+                    Match(Index);
+                }
+            }
+            else if (Key == TEXT("GROUP"))
+            {
+                TArray<int32> Group;
+                Snapshot->Groups.MultiFind(Value.ToUpper(), Group, true);
+                for (int32 Index : Group) Match(Index);
+            }
+            else if (Key == TEXT("NAME") || Key == TEXT("INTDES"))
+            {
+                const bool bName = Key == TEXT("NAME");
+                for (int32 Index = 0; Index < Snapshot->Catalog.Num(); ++Index)
+                {
+                    if (bName ? FString(Snapshot->Catalog.GetName(Index)).Contains(Value) : Snapshot->InternationalDesignators[Index].StartsWith(Value))
+                    {
+                        Match(Index);
+                    }
+                }
+            }
+
+            if (Matches.Num() == NumMatches)
+            {
+                UE_LOG(LogMaxQSamples, Warning, TEXT("FLocalTelemetryProvider has no GP data for %s"), *ObjectId);
+            }
+        }
+
+        FString Telemetry;
+        for (int32 Index : Matches)
+        {
+            Telemetry += FString(Snapshot->Catalog.GetName(Index)) + TEXT("\r\n") + Snapshot->Line1s[Index] + TEXT("\r\n") + Snapshot->Line2s[Index] + TEXT("\r\n");
+        }
+
+        const bool bSuccess = Matches.Num() > 0;
+        Complete(MoveTemp(Request.Callback), bSuccess, MoveTemp(Request.ObjectIds), bSuccess ? MoveTemp(Telemetry) : FString(TEXT("No GP data found")));
+    });
+}
+
+
+//-----------------------------------------------------------------------------
+// Name: FMockTelemetryProvider::Fetch
+// Desc:
+// Canned responses, completed on a later game thread task, like http's.
+//-----------------------------------------------------------------------------
+void FMockTelemetryProvider::Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback)
+{
+    check(IsInGameThread());
+    ++NumRequests;
+
+    bool bSuccess = !bFail && !ObjectIds.IsEmpty();
+    FString Telemetry;
+    for (const FString& ObjectId : ObjectIds)
+    {
+        const FString* Response = Responses.Find(ObjectId);
+        bSuccess &= Response != nullptr;
+        if (Response) Telemetry += *Response;
+    }
+
+    Complete(MoveTemp(Callback), bSuccess, TArray<FString>(ObjectIds), bSuccess ? MoveTemp(Telemetry) : FString(TEXT("Request failed.")));
+}
+
+
+void SetTelemetryProvider(TSharedPtr<ITelemetryProvider> Provider)
+{
+    check(IsInGameThread());
+    TelemetryProvider = Provider;
+}
+
+
+TSharedRef<ITelemetryProvider> GetTelemetryProvider()
+{
+    check(IsInGameThread());
+    if (!TelemetryProvider.IsValid())
+    {
+        TelemetryProvider = MakeShared<FCelestrakTelemetryProvider>();
+    }
+    return TelemetryProvider.ToSharedRef();
+}
+
+}
+
+#undef CELESTRAK_URL_BASE
@@ -14,6 +14,8 @@
 #include "GetTelemetryFromServer.generated.h"
 
 
+namespace MaxQSamples { class ITelemetryProvider; }
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTelemetryCallback_AsyncExecutionCompleted, const FString&, ObjectId, const FString&, Telemetry);
 
 
@@ -29,6 +31,11 @@ public:
     UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", Category = "MaxQSamples", WorldContext = "WorldContextObject"))
     static UGetTelemetryFromServer_AsyncExecution* IssueTelemetryRequest(UObject* WorldContextObject, FString ObjectId, FString Format);
 
+    // Many objects, one completion: OnSuccess's ObjectId is the IDs, comma
+    // separated, and its Telemetry every object's, end to end.
+    UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", Category = "MaxQSamples", WorldContext = "WorldContextObject"))
+    static UGetTelemetryFromServer_AsyncExecution* IssueTelemetryBatchRequest(UObject* WorldContextObject, const TArray<FString>& ObjectIds, FString Format);
+
     UPROPERTY(BlueprintAssignable)
     FTelemetryCallback_AsyncExecutionCompleted OnSuccess;
 
@@ -37,5 +44,13 @@ public:
 
     // Args from IssueTelemetryRequest (to be used by Activate)
     FString ObjectIdArg;
+    TArray<FString> ObjectIdsArg;
     FString FormatArg;
+
+    // If set before Activate, the request's provider, instead of the one
+    // GetTelemetryProvider returns (see TelemetryProvider.h)
+    TSharedPtr<MaxQSamples::ITelemetryProvider> Provider;
+
+private:
+    void TelemetryReceived(bool bSuccess, const TArray<FString>& ObjectIds, const FString& Telemetry);
 };
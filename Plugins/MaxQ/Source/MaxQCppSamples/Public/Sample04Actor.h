@@ -11,6 +11,7 @@
 #include "GameFramework/Actor.h"
 #include "SpiceConstants.h"
 #include "SpiceTypes.h"
+#include "SpiceTime.h"
 #include "SampleUtilities.h"
 #include "UObject/WeakObjectPtrTemplates.h"
 #include "Sample04Actor.generated.h"
@@ -56,6 +57,9 @@ class MAXQCPPSAMPLES_API ASample04Actor : public AActor
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     TWeakObjectPtr<AActor> SunDirectionalLight;
 
+    // Formats the on-screen clock without re-formatting the date every frame
+    MaxQ::Time::FUtcFormatter DisplayTime {ES_UTCTimeFormat::Calendar, 4};
+
 public:
     ASample04Actor();
 
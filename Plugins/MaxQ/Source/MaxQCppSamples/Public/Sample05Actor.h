@@ -9,6 +9,7 @@
 
 #include "CoreMinimal.h"
 #include "SampleUtilities.h"
+#include "SpiceTime.h"
 #include "GameFramework/Actor.h"
 #include "Sample05Actor.generated.h"
 
@@ -50,6 +51,10 @@
 
 
 class ASample05TelemetryActor;
+class UMaxQSatelliteCatalogComponent;
+class USampleNametagWidget;
+class USampleLabelManagerComponent;
+namespace MaxQSamples { class ITelemetryProvider; }
 
 UCLASS(Blueprintable, HideCategories = (Transform, Rendering, Replication, Collision, HLOD, Input, Actor, Advanced, Cooking))
 class MAXQCPPSAMPLES_API ASample05Actor : public AActor
@@ -67,9 +72,32 @@ public:
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     FString TelemetryObjectId;
 
+    // If set, telemetry comes from the TLE files here (a file, or a directory
+    // of them) instead of from celestrak.  For offline use.
+    UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
+    FString TelemetryPath;
+
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     TSubclassOf<ASample05TelemetryActor> TelemetryObjectClass;
 
+    // Draws every tracked object as an instance of one mesh.  Only the
+    // nearest few, and the ISS, get orbits.
+    UPROPERTY(VisibleAnywhere, Category = "MaxQ|Samples")
+    TObjectPtr<UMaxQSatelliteCatalogComponent> SatelliteCatalog;
+
+    // If false, each object is a TelemetryObjectClass actor instead, which
+    // is only practical for a few hundred of them
+    UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
+    bool bInstancedTelemetry;
+
+    // Nametags for every tracked object, shown only for those on screen
+    UPROPERTY(VisibleAnywhere, Category = "MaxQ|Samples")
+    TObjectPtr<USampleLabelManagerComponent> Labels;
+
+    // If unset, TelemetryObjectClass's
+    UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
+    TSubclassOf<USampleNametagWidget> NametagWidgetClass;
+
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     FName OriginNaifName;
 
@@ -92,6 +120,20 @@ public:
     UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
     FSMassConstant gm;
 
+    // Formats the on-screen clock without re-formatting the date every frame
+    MaxQ::Time::FUtcFormatter DisplayTime {ES_UTCTimeFormat::Calendar, 4};
+
+    // Each of SatelliteCatalog's objects' label, and where it is
+    TArray<int32> CatalogLabels;
+    TArray<FVector> CatalogLocations;
+    TArray<bool> CatalogLocated;
+
+    // The origin body's radii, in world units, which hide labels behind it
+    FVector OriginRadii;
+
+    // TelemetryPath's files, for this actor's requests only
+    TSharedPtr<MaxQSamples::ITelemetryProvider> TelemetryProvider;
+
 public:
     ASample05Actor();
 
@@ -114,6 +156,11 @@ private:
 
     void AddTelemetryObject(const FString& ObjectId, const FString& ObjectName, const FSTwoLineElements& Elements);
 
+    void InitSatelliteCatalog();
+    void UpdateLabels();
+
+    FSEphemerisTime GetCurrentTime() const;
+
     // This is what you came for...
     UFUNCTION(BlueprintCallable, Category = "MaxQ|Samples")
     bool PropagateTLE(const FSTwoLineElements& TLEs, FSStateVector& StateVector);
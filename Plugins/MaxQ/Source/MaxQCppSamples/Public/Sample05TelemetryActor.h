@@ -9,18 +9,21 @@
 
 #include "CoreMinimal.h"
 #include "SpiceTypes.h"
+#include "SpiceHybrid.h"
 #include "SampleUtilities.h"
 #include "SampleNametagWidget.h"
 #include "Sample05TelemetryActor.generated.h"
 
 class UStaticMeshComponent;
+class UMaxQOrbitPathComponent;
+class USampleLabelManagerComponent;
 
 // This actor represents an object who's state was obtained
 // by the celestrak server... It updates its location
 // ("propagates" its orbit) to a given time and displays a position.
 // The orbit is updated from "Two-Line Elements" NORAD
 // type telemetry data.
-// Also, it renders a debug orbit, which is computed from it's
+// Also, it renders its orbit, which is computed from it's
 // current state.
 UCLASS(Blueprintable, HideCategories = (Rendering, Replication, Collision, HLOD, Input, Actor, Advanced, Cooking))
 class MAXQCPPSAMPLES_API ASample05TelemetryActor : public AActor
@@ -32,15 +35,16 @@ public:
     UPROPERTY(EditDefaultsOnly, Category = "MaxQ|Samples")
     TObjectPtr<UStaticMeshComponent> MeshComponent;
 
+    UPROPERTY(VisibleAnywhere, Category = "MaxQ|Samples")
+    TObjectPtr<UMaxQOrbitPathComponent> OrbitPathComponent;
+
+    // The nametag ASample05Actor's label manager uses, unless it has its own
     UPROPERTY(EditDefaultsOnly, Category = "MaxQ|Samples")
     TSubclassOf<USampleNametagWidget> NametagWidgetClass;
 
     UPROPERTY(EditAnywhere, Category = "MaxQ|Samples")
     double VelocityBumpFraction;
 
-    UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
-    TWeakObjectPtr<USampleNametagWidget> NametagWidgetInstance;
-
     UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
     FString ObjectId;
 
@@ -53,27 +57,27 @@ public:
     UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
     FSTLEGeophysicalConstants GeophysicalConstants;
 
+    UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
+    FSMassConstant gm;
+
     UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
     bool PropagateStateByTLEs = true;
 
     UPROPERTY(EditInstanceOnly, Transient, Category = "MaxQ|Samples")
     FSConicElements KeplerianElements;
 
-    UPROPERTY()
-    FPositionUpdate PositionUpdate;
+    // Whether the nametag's shown is up to the label manager
+    TWeakObjectPtr<USampleLabelManagerComponent> LabelManager;
+    int32 Label = INDEX_NONE;
 
-    UPROPERTY()
-    FVisibilityUpdate VisibilityUpdate;
+    // The TLE, then a conic from each bump
+    MaxQ::Hybrid::FTrajectory Trajectory;
+    int32 Segment = INDEX_NONE;
 
-    FTLEGetStateVectorCallback PropagateByTLEs;
+    FGetEphemerisTime CurrentTime;
     FXformPositionCallback XformPositionCallback;
-    FComputeConic ComputeConic;
-    FRenderDebugOrbit RenderDebugOrbit;
-    FEvaluateOrbitalElements PropagateByKeplerianElements;
-    FGetOrbitalElements GetOrbitalElements;
     FGetConicFromKepler GetConicFromKepler;
 
-    bool bWasVisible = false;
     bool bShouldRenderOrbit;
 
     FSEllipse OrbitalConic;
@@ -83,13 +87,16 @@ public:
     ASample05TelemetryActor();
 
     void BeginPlay() override;
-    void Init(const FString& NewObjectId, const FString& NewObjectName, const FSTwoLineElements& NewTLEs, bool bNewShouldRenderOrbit);
+    void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+    void Init(const FString& NewObjectId, const FString& NewObjectName, const FSTwoLineElements& NewTLEs, bool bNewShouldRenderOrbit, USampleLabelManagerComponent* Labels);
     void Tick(float DeltaSeconds) override;
-    void PropagateTLE();
-    void PropagateKepler();
+    void Propagate();
+    bool UpdateConic();
+    void MoveTo(const FVector& Location);
 
     void GoKeplerian();
     void BumpVelocity(const FSVelocityVector& Direction);
+    bool GetState(FSStateVector& StateVector) const;
 
     UFUNCTION(CallInEditor, Category = "Editor")
     void BumpPrograde();
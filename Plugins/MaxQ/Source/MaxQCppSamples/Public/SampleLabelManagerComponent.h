@@ -0,0 +1,106 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+// 
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/ 
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Containers/ArrayView.h"
+#include "SampleLabelManagerComponent.generated.h"
+
+class USampleNametagWidget;
+
+//-----------------------------------------------------------------------------
+// USampleLabelManagerComponent
+// Nametags for many objects, from a small pool of widgets
+//-----------------------------------------------------------------------------
+//
+// Objects register a label (a name), and update its world location whenever
+// they move.  Once a frame, in one pass over every label, the manager:
+// * Projects each label to the screen, dropping those off-screen
+// * Drops those hidden behind the occluding body (an ellipsoid, e.g. the
+//   planet, with its radii from bodvrd)
+// * Declutters what's left: nearest first (pinned labels before any), a
+//   label is only shown if no shown label is within MinLabelSpacing pixels
+//   of it, up to MaxLabels
+// ...and hands the shown labels to pooled widgets.  So the widget cost
+// scales with the labels on screen, not with the objects tracked.
+
+UCLASS(ClassGroup = "MaxQSamples", meta = (BlueprintSpawnableComponent))
+class MAXQCPPSAMPLES_API USampleLabelManagerComponent : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY(EditAnywhere, Category = "MaxQ|Samples")
+    TSubclassOf<USampleNametagWidget> NametagWidgetClass;
+
+    // The most labels shown at once, which is the size of the widget pool
+    UPROPERTY(EditAnywhere, Category = "MaxQ|Samples", meta = (ClampMin = "0"))
+    int32 MaxLabels;
+
+    // Shown labels are at least this far apart, in pixels
+    UPROPERTY(EditAnywhere, Category = "MaxQ|Samples", meta = (ClampMin = "0"))
+    float MinLabelSpacing;
+
+public:
+    USampleLabelManagerComponent();
+
+    // Returns the new label's handle.  It's hidden until it has a location.
+    int32 AddLabel(const FString& Name, bool bNewPinned = false);
+    void RemoveLabel(int32 Label);
+    void RemoveAllLabels();
+
+    // Pinned labels are shown before any others, and aren't decluttered
+    void SetPinned(int32 Label, bool bNewPinned);
+
+    // bNewValid false hides the label (e.g. its object's position is unknown)
+    void SetLocation(int32 Label, const FVector& WorldLocation, bool bNewValid = true);
+
+    // Many labels' locations.  Valid may be empty, if they all are.
+    void SetLocations(TConstArrayView<int32> Labels, TConstArrayView<FVector> WorldLocations, TConstArrayView<bool> Valid = {});
+
+    // Labels behind this ellipsoid are hidden.  Radii are along its local
+    // axes, in world units.
+    void SetOccluder(const FTransform& BodyToWorld, const FVector& Radii);
+    void ClearOccluder();
+
+    int32 GetNumLabels() const { return Names.Num() - FreeLabels.Num(); }
+    int32 GetNumShown() const { return NumShown; }
+
+    // UActorComponent
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    void Update();
+    void HideAll();
+
+    // Per label
+    TArray<FString> Names;
+    TArray<FVector> Locations;
+    TArray<bool> bValid;
+    TArray<bool> bPinned;
+    TArray<bool> bActive;
+    TArray<int32> LabelWidgets;
+    TArray<int32> FreeLabels;
+
+    // Scratch, per label
+    TArray<FVector2D> ScreenLocations;
+    TArray<double> Priorities;
+
+    // Per widget: the label it shows, or INDEX_NONE
+    UPROPERTY(Transient)
+    TArray<TObjectPtr<USampleNametagWidget>> Widgets;
+    TArray<int32> WidgetLabels;
+
+    // World to occluder space, where the occluder is the unit sphere
+    FMatrix ToOccluder;
+    bool bHaveOccluder;
+
+    int32 NumShown;
+};
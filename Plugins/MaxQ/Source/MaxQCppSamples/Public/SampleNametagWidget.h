@@ -22,4 +22,28 @@ class MAXQCPPSAMPLES_API USampleNametagWidget : public UUserWidget
 public:
     UFUNCTION(BlueprintImplementableEvent)
     void Init(const FString& NewObjectName, FPositionUpdate& NewPositionUpdate, FVisibilityUpdate& VisibilityUpdate);
+
+    // Called when a pooled nametag is moved to another object.  By default,
+    // Init again with the same delegates.
+    UFUNCTION(BlueprintNativeEvent)
+    void Rename(const FString& NewObjectName);
+
+    // Pooled nametags (see SampleLabelManagerComponent.h) own their
+    // delegates, and are shown, moved and hidden through these.
+    void Show(const FString& NewObjectName);
+    void Hide();
+    void SetWorldLocation(const FVector& Location);
+
+    const FString& GetObjectName() const { return ObjectName; }
+
+private:
+    UPROPERTY()
+    FPositionUpdate PositionUpdate;
+
+    UPROPERTY()
+    FVisibilityUpdate VisibilityUpdate;
+
+    FString ObjectName;
+    bool bInitialized = false;
+    bool bShown = false;
 };
@@ -42,9 +42,21 @@ struct MAXQCPPSAMPLES_API FSamplesSolarSystemState
     UPROPERTY(Transient)
     FSEphemerisTime CurrentTime;
 
+    // The clock's time as of the last UpdateTime, to detect edits to CurrentTime
+    UPROPERTY(Transient)
+    FSEphemerisTime ClockTime;
+
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     FSEphemerisPeriod TimeScale;
 
+    // The clock's time scale as of the last UpdateTime, to detect edits to TimeScale
+    UPROPERTY(Transient)
+    FSEphemerisPeriod ClockTimeScale;
+
+    // Whether UpdateTime has handed this state's time and time scale to the clock yet
+    UPROPERTY(Transient)
+    bool bClockInitialized;
+
     UPROPERTY(EditInstanceOnly, Category = "MaxQ|Samples")
     TMap<FName, TWeakObjectPtr<AActor> > SolarSystemBodyMap;
 
@@ -53,6 +65,7 @@ struct MAXQCPPSAMPLES_API FSamplesSolarSystemState
         InitializeTimeToNow = true;
         InitialTime = TEXT("25 DEC 2021 12:00:00");
         TimeScale = FSEphemerisPeriod::FromSeconds(10000000.0);
+        bClockInitialized = false;
     }
 };
 
@@ -67,12 +80,8 @@ DECLARE_DYNAMIC_DELEGATE_ThreeParams(FTelemetryCallback, bool, Success, const FS
 
 DECLARE_DYNAMIC_DELEGATE_OneParam(FPositionUpdate, const FVector&, Position);
 DECLARE_DYNAMIC_DELEGATE_OneParam(FVisibilityUpdate, bool, bIsVisible);
-DECLARE_DELEGATE_RetVal_ThreeParams(bool, FComputeConic, const FSStateVector&, FSEllipse&, bool&);
-DECLARE_DELEGATE_FourParams(FRenderDebugOrbit, const FSEllipse&, bool, const FColor&, float);
-DECLARE_DELEGATE_RetVal_TwoParams(bool, FTLEGetStateVectorCallback, const FSTwoLineElements&, FSStateVector&);
+DECLARE_DELEGATE_RetVal(FSEphemerisTime, FGetEphemerisTime);
 DECLARE_DELEGATE_RetVal_TwoParams(bool, FXformPositionCallback, const FSDistanceVector&, FVector&);
-DECLARE_DELEGATE_RetVal_TwoParams(bool, FEvaluateOrbitalElements, const FSConicElements&, FSStateVector&);
-DECLARE_DELEGATE_RetVal_TwoParams(bool, FGetOrbitalElements, const FSStateVector&, FSConicElements&);
 DECLARE_DELEGATE_RetVal_ThreeParams(bool, FGetConicFromKepler, const FSConicElements&, FSEllipse&, bool&);
 
 
@@ -135,4 +144,8 @@ namespace MaxQSamples
     bool UpdateBodyPositions(const FName& OriginNaifName, const FName& OriginReferenceFrame, float DistanceScale, const FSamplesSolarSystemState& SolarSystemState);
     bool UpdateBodyOrientations(const FName& OriginReferenceFrame, const FSamplesSolarSystemState& SolarSystemState);
     bool UpdateSunDirection(const FName& OriginNaifName, const FName& OriginReferenceFrame, const FSEphemerisTime& et, const FName& SunNaifName, const TWeakObjectPtr<AActor>& SunDirectionalLight);
+
+    // Shared simulation time (UMaxQClockSubsystem)
+    void UseSharedClock(AActor* Actor);
+    void UpdateTime(const UObject* WorldContextObject, FSamplesSolarSystemState& SolarSystemState, float DeltaTime);
 }
@@ -0,0 +1,140 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+
+
+//-----------------------------------------------------------------------------
+// TelemetryProvider
+// Where the samples' telemetry (TLEs) comes from
+//-----------------------------------------------------------------------------
+//
+// Object IDs are CelesTrak GP queries:
+//   "CATNR=25544", "GROUP=STATIONS", "NAME=ISS", "INTDES=1998-067"
+//
+// A request carries any number of object IDs, and completes once, on the game
+// thread, with all of their telemetry (3LE text, for Format "TLE") end to end,
+// or with an error.  It never completes from inside Fetch.
+//
+// Providers:
+// * FCelestrakTelemetryProvider: CelesTrak, by http.  The default.
+// * FLocalTelemetryProvider: TLE files, from a directory or a single file,
+//   read once into a snapshot every request is served from.  Works offline,
+//   and isn't rate-limited.
+// * FMockTelemetryProvider: canned responses, standing in for http in tests.
+//
+// SetTelemetryProvider picks the one UGetTelemetryFromServer_AsyncExecution
+// uses, unless the request was given its own (as Sample05's are, when it
+// reads TLE files).
+//-----------------------------------------------------------------------------
+
+// bSuccess, the request's object IDs, and the telemetry (or error message)
+DECLARE_DELEGATE_ThreeParams(FTelemetryBatchCallback, bool, const TArray<FString>&, const FString&);
+
+
+namespace MaxQSamples
+{
+    class MAXQCPPSAMPLES_API ITelemetryProvider
+    {
+    public:
+        virtual ~ITelemetryProvider() {}
+
+        // Game thread only.  Callback executes once, on the game thread.
+        virtual void Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback) = 0;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // CelesTrak has no batch queries, so this sends one request per object ID,
+    // all at once, and completes when the last response arrives.  It fails if
+    // any of them does.
+    //-------------------------------------------------------------------------
+    class MAXQCPPSAMPLES_API FCelestrakTelemetryProvider : public ITelemetryProvider
+    {
+    public:
+        virtual void Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback) override;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Path is a 2LE/3LE file, or a directory of them (*.txt, *.tle, *.3le).
+    // Each file is a group, named for the file: stations.txt is
+    // "GROUP=STATIONS", as CelesTrak's group files are named.
+    //
+    // The files are read, on a worker thread, by the first request, and
+    // parsed by MaxQ::Tle::ParseCatalog (SpiceTleCatalog.h) on the game
+    // thread, as it needs the leapseconds kernel.  Every request after is
+    // served from that snapshot until Refresh.  Object IDs matching nothing
+    // are logged and left out; a request only fails if none of its IDs
+    // matches anything.
+    //
+    // Create with MakeShared; requests hold a weak pointer to the provider.
+    //-------------------------------------------------------------------------
+    class MAXQCPPSAMPLES_API FLocalTelemetryProvider : public ITelemetryProvider, public TSharedFromThis<FLocalTelemetryProvider>
+    {
+    public:
+        explicit FLocalTelemetryProvider(const FString& Path) : Path(Path) {}
+
+        virtual void Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback) override;
+
+        // Re-reads the files on the next request
+        void Refresh() { Snapshot.Reset(); }
+
+    private:
+        struct FSnapshot;
+
+        // A file's group, and its text
+        struct FFile
+        {
+            FString Group;
+            TArray<uint8> Text;
+        };
+
+        struct FRequest
+        {
+            TArray<FString> ObjectIds;
+            FTelemetryBatchCallback Callback;
+        };
+
+        static TArray<FFile> Read(const FString& Path);
+        static TSharedRef<const FSnapshot> Parse(const FString& Path, const TArray<FFile>& Files);
+        static void Serve(TSharedRef<const FSnapshot> Snapshot, FRequest&& Request);
+
+        FString Path;
+        TSharedPtr<const FSnapshot> Snapshot;
+
+        // Requests waiting on a load
+        TArray<FRequest> Pending;
+        bool bLoading = false;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Responses, by object ID, and whether to fail every request instead.
+    // A request fails if any of its IDs has no response.
+    //-------------------------------------------------------------------------
+    class MAXQCPPSAMPLES_API FMockTelemetryProvider : public ITelemetryProvider
+    {
+    public:
+        virtual void Fetch(const TArray<FString>& ObjectIds, const FString& Format, FTelemetryBatchCallback Callback) override;
+
+        TMap<FString, FString> Responses;
+        bool bFail = false;
+
+        // Requests (not object IDs) fetched so far
+        int32 NumRequests = 0;
+    };
+
+
+    // Game thread only.  A null Provider restores the default (CelesTrak).
+    // It's process-wide, so prefer giving requests their own provider.
+    MAXQCPPSAMPLES_API void SetTelemetryProvider(TSharedPtr<ITelemetryProvider> Provider);
+    MAXQCPPSAMPLES_API TSharedRef<ITelemetryProvider> GetTelemetryProvider();
+}
@@ -0,0 +1,211 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQClockSubsystem.cpp
+//
+// Implementation Comments
+//
+// Purpose: One authoritative simulation clock per world.
+//
+// The clock's tick function runs in TG_PrePhysics as a high priority tick,
+// so it's dispatched ahead of ordinary actor ticks.  Consumers that must see
+// this frame's time (not last frame's) call AddTickPrerequisite.
+//------------------------------------------------------------------------------
+
+#include "MaxQClockSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "SpiceData.h"
+
+namespace
+{
+    constexpr double SecondsPerDay = 86400.;
+}
+
+
+void FMaxQClockTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+    if (Clock && TickType != LEVELTICK_ViewportsOnly)
+    {
+        Clock->Tick(DeltaTime);
+    }
+}
+
+FString FMaxQClockTickFunction::DiagnosticMessage()
+{
+    return TEXT("UMaxQClockSubsystem::Tick");
+}
+
+
+UMaxQClockSubsystem::UMaxQClockSubsystem()
+{
+    Days = 0;
+    Seconds = 0.;
+    TimeScale = 1.;
+    FixedStep = 60.;
+    Mode = ES_ClockMode::Scaled;
+    bPaused = false;
+    PendingDelta = 0.;
+    UpdateNumber = 0;
+}
+
+
+void UMaxQClockSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    Super::Initialize(Collection);
+
+    SetEphemerisTime(MaxQ::Data::Now());
+    PendingDelta = 0.;
+}
+
+
+void UMaxQClockSubsystem::Deinitialize()
+{
+    if (TickFunction.IsTickFunctionRegistered())
+    {
+        TickFunction.UnRegisterTickFunction();
+    }
+    TickFunction.Clock = nullptr;
+
+    OnTimeUpdated.Clear();
+    OnTimeUpdatedNative.Clear();
+
+    Super::Deinitialize();
+}
+
+
+void UMaxQClockSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    TickFunction.Clock = this;
+    TickFunction.bCanEverTick = true;
+    TickFunction.bStartWithTickEnabled = true;
+    TickFunction.bHighPriority = true;
+    TickFunction.TickGroup = TG_PrePhysics;
+    TickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+}
+
+
+bool UMaxQClockSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+    return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+
+UMaxQClockSubsystem* UMaxQClockSubsystem::Get(const UObject* WorldContextObject)
+{
+    UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+    return World ? World->GetSubsystem<UMaxQClockSubsystem>() : nullptr;
+}
+
+
+FSEphemerisTime UMaxQClockSubsystem::GetEphemerisTime() const
+{
+    return FSEphemerisTime((double)Days * SecondsPerDay + Seconds);
+}
+
+
+void UMaxQClockSubsystem::GetTwoPartTime(int64& OutDays, double& OutSeconds) const
+{
+    OutDays = Days;
+    OutSeconds = Seconds;
+}
+
+
+void UMaxQClockSubsystem::SetEphemerisTime(const FSEphemerisTime& et)
+{
+    const FSEphemerisTime Previous = GetEphemerisTime();
+
+    const double WholeDays = FMath::FloorToDouble(et.seconds / SecondsPerDay);
+    Days = (int64)WholeDays;
+    Seconds = et.seconds - WholeDays * SecondsPerDay;
+    Advance(0.);
+
+    PendingDelta += et.seconds - Previous.seconds;
+}
+
+
+void UMaxQClockSubsystem::Scrub(const FSEphemerisPeriod& DeltaEt)
+{
+    Advance(DeltaEt.seconds);
+    PendingDelta += DeltaEt.seconds;
+}
+
+
+void UMaxQClockSubsystem::SetTimeScale(const FSEphemerisPeriod& InTimeScale)
+{
+    TimeScale = InTimeScale.seconds;
+}
+
+
+void UMaxQClockSubsystem::SetMode(ES_ClockMode InMode)
+{
+    Mode = InMode;
+}
+
+
+void UMaxQClockSubsystem::SetFixedStep(const FSEphemerisPeriod& InFixedStep)
+{
+    FixedStep = InFixedStep.seconds;
+}
+
+
+void UMaxQClockSubsystem::SetPaused(bool bInPaused)
+{
+    bPaused = bInPaused;
+}
+
+
+void UMaxQClockSubsystem::AddTickPrerequisite(FTickFunction& ConsumerTick)
+{
+    ConsumerTick.AddPrerequisite(this, TickFunction);
+}
+
+
+void UMaxQClockSubsystem::Tick(float DeltaTime)
+{
+    double DeltaEt = PendingDelta;
+    PendingDelta = 0.;
+
+    if (!bPaused)
+    {
+        const double Step = (Mode == ES_ClockMode::FixedStep) ? FixedStep : (double)DeltaTime * TimeScale;
+        Advance(Step);
+        DeltaEt += Step;
+    }
+
+    ++UpdateNumber;
+
+    const FSEphemerisTime et = GetEphemerisTime();
+    const FSEphemerisPeriod Delta(DeltaEt);
+
+    OnTimeUpdatedNative.Broadcast(et, Delta);
+    OnTimeUpdated.Broadcast(et, Delta);
+}
+
+
+void UMaxQClockSubsystem::Advance(double DeltaSeconds)
+{
+    // Carry whole days separately, so Seconds never holds more than a day
+    // and keeps its precision however far the clock runs.
+    const double WholeDays = FMath::FloorToDouble(DeltaSeconds / SecondsPerDay);
+    Days += (int64)WholeDays;
+    Seconds += DeltaSeconds - WholeDays * SecondsPerDay;
+
+    const double Carry = FMath::FloorToDouble(Seconds / SecondsPerDay);
+    Days += (int64)Carry;
+    Seconds -= Carry * SecondsPerDay;
+
+    // (A tiny negative Seconds rounds up to a full day)
+    if (Seconds >= SecondsPerDay)
+    {
+        ++Days;
+        Seconds = 0.;
+    }
+}
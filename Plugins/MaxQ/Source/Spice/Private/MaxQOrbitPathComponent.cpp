@@ -0,0 +1,286 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQOrbitPathComponent.cpp
+//
+// Implementation Comments
+//
+// Levels of detail are spaced by a factor of 4 in relative chord error, which
+// is a factor of 2 in segment count.  The level is chosen per view from the
+// pixels-per-unit at the point of the path's bounding box nearest the
+// camera, so the part of a large orbit close to the camera decides.
+//
+// Lines go through the view's PDI, which the renderer batches with every
+// other line drawn that frame.
+//------------------------------------------------------------------------------
+
+#include "MaxQOrbitPathComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+#include "SpiceMath.h"
+#include "SpiceOperators.h"
+#include "SpiceOrbits.h"
+
+namespace
+{
+    // Coarsest and finest levels of detail, as chord error / semi-major axis
+    constexpr double CoarsestRelativeError = 0.05;
+    constexpr double FinestRelativeError = 0.000001;
+}
+
+
+struct FMaxQOrbitPathGeometry
+{
+    // Coarsest first.  Points are local space, in Unreal axes.
+    TArray<TArray<FVector>> Lods;
+    TArray<double> RelativeErrors;
+
+    // Semi-major axis length, local units
+    double Size = 0.;
+    FBox Bounds = FBox(ForceInit);
+
+    const TArray<FVector>& SelectLod(double AllowedRelativeError) const
+    {
+        for (int32 i = 0; i < Lods.Num(); ++i)
+        {
+            if (RelativeErrors[i] <= AllowedRelativeError) return Lods[i];
+        }
+        return Lods.Last();
+    }
+};
+
+
+class FMaxQOrbitPathSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+    SIZE_T GetTypeHash() const override
+    {
+        static size_t UniquePointer;
+        return reinterpret_cast<size_t>(&UniquePointer);
+    }
+
+    FMaxQOrbitPathSceneProxy(const UMaxQOrbitPathComponent* Component, const TSharedPtr<const FMaxQOrbitPathGeometry, ESPMode::ThreadSafe>& InGeometry)
+        : FPrimitiveSceneProxy(Component)
+        , Geometry(InGeometry)
+        , Color(Component->LineColor)
+        , Thickness(Component->LineThickness)
+        , ScreenSpaceError(Component->ScreenSpaceError)
+    {
+        bWillEverBeLit = false;
+    }
+
+    virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+    {
+        const FMatrix& LocalToWorld = GetLocalToWorld();
+        const double WorldSize = Geometry->Size * LocalToWorld.GetMaximumAxisScale();
+        const FBox WorldBounds = GetBounds().GetBox();
+
+        for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+        {
+            if (!(VisibilityMap & (1 << ViewIndex)))
+            {
+                continue;
+            }
+
+            const FSceneView* View = Views[ViewIndex];
+            FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+
+            // Screen size of one world unit, where the path is nearest the camera
+            const FVector Nearest = WorldBounds.GetClosestPointTo(View->ViewMatrices.GetViewOrigin());
+            const double PixelsPerUnit = FMath::Sqrt(ComputeBoundsScreenRadiusSquared(Nearest, 1.f, *View)) * View->UnscaledViewRect.Width();
+            const double AllowedRelativeError = ScreenSpaceError / FMath::Max(PixelsPerUnit * WorldSize, UE_DOUBLE_SMALL_NUMBER);
+
+            const TArray<FVector>& Points = Geometry->SelectLod(AllowedRelativeError);
+
+            FVector Previous = LocalToWorld.TransformPosition(Points[0]);
+            for (int32 i = 1; i < Points.Num(); ++i)
+            {
+                const FVector Next = LocalToWorld.TransformPosition(Points[i]);
+                PDI->DrawLine(Previous, Next, Color, SDPG_World, Thickness, 0.f, true);
+                Previous = Next;
+            }
+        }
+    }
+
+    virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+    {
+        FPrimitiveViewRelevance Result;
+        Result.bDrawRelevance = IsShown(View);
+        Result.bDynamicRelevance = true;
+        Result.bShadowRelevance = false;
+        Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+        return Result;
+    }
+
+    virtual uint32 GetMemoryFootprint() const override
+    {
+        return sizeof(*this) + GetAllocatedSize();
+    }
+
+private:
+    TSharedPtr<const FMaxQOrbitPathGeometry, ESPMode::ThreadSafe> Geometry;
+    FLinearColor Color;
+    float Thickness;
+    float ScreenSpaceError;
+};
+
+
+UMaxQOrbitPathComponent::UMaxQOrbitPathComponent()
+{
+    ScreenSpaceError = 0.5f;
+    LineColor = FColor::White;
+    LineThickness = 1.f;
+    HyperbolicAnomalyLimit = MaxQ::Math::twopi;
+    RebuildTolerance = 0.000001;
+    bIsHyperbolic = false;
+
+    PrimaryComponentTick.bCanEverTick = false;
+    CastShadow = false;
+    SetGenerateOverlapEvents(false);
+    SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+}
+
+
+void UMaxQOrbitPathComponent::SetConic(const FSEllipse& conic, bool isHyperbolic)
+{
+    if (Geometry.IsValid() && isHyperbolic == bIsHyperbolic)
+    {
+        const double Change = FMath::Max3(
+            (conic.center - Conic.center).Magnitude().km,
+            (conic.v_major - Conic.v_major).Magnitude().km,
+            (conic.v_minor - Conic.v_minor).Magnitude().km
+        );
+
+        if (Change <= RebuildTolerance * Geometry->Size)
+        {
+            return;
+        }
+    }
+
+    Conic = conic;
+    bIsHyperbolic = isHyperbolic;
+    Rebuild();
+}
+
+
+void UMaxQOrbitPathComponent::SetOrbit(
+    const FSConicElements& orbit,
+    const FSEphemerisTime& et,
+    const FString& orbitReferenceFrame,
+    const FString& observerReferenceFrame
+)
+{
+    FSEllipse conic;
+    bool isHyperbolic;
+    USpiceOrbits::ComputeConic(conic, isHyperbolic, et, orbit, orbitReferenceFrame, observerReferenceFrame);
+    SetConic(conic, isHyperbolic);
+}
+
+
+void UMaxQOrbitPathComponent::SetLineColor(const FColor& color)
+{
+    if (color != LineColor)
+    {
+        LineColor = color;
+        MarkRenderStateDirty();
+    }
+}
+
+
+void UMaxQOrbitPathComponent::SetLineThickness(float thickness)
+{
+    if (thickness != LineThickness)
+    {
+        LineThickness = thickness;
+        MarkRenderStateDirty();
+    }
+}
+
+
+void UMaxQOrbitPathComponent::SetScreenSpaceError(float pixels)
+{
+    if (pixels != ScreenSpaceError)
+    {
+        ScreenSpaceError = pixels;
+        MarkRenderStateDirty();
+    }
+}
+
+
+void UMaxQOrbitPathComponent::Rebuild()
+{
+    TSharedRef<FMaxQOrbitPathGeometry, ESPMode::ThreadSafe> NewGeometry = MakeShared<FMaxQOrbitPathGeometry, ESPMode::ThreadSafe>();
+    NewGeometry->Size = Conic.v_major.Magnitude().km;
+
+    TArray<FSDistanceVector> Points;
+    for (double RelativeError = CoarsestRelativeError; RelativeError >= FinestRelativeError; RelativeError *= 0.25)
+    {
+        USpiceOrbits::ComputeConicPolyline(Points, Conic, bIsHyperbolic, RelativeError, HyperbolicAnomalyLimit);
+        if (Points.Num() < 2)
+        {
+            break;
+        }
+
+        TArray<FVector>& Lod = NewGeometry->Lods.AddDefaulted_GetRef();
+        Lod.Reserve(Points.Num());
+        for (const FSDistanceVector& Point : Points)
+        {
+            Lod.Add(MaxQ::Math::Swizzle(Point));
+        }
+        NewGeometry->RelativeErrors.Add(RelativeError);
+    }
+
+    if (NewGeometry->Lods.Num() > 0)
+    {
+        // From the finest level, the closest fit to the conic
+        NewGeometry->Bounds = FBox(NewGeometry->Lods.Last());
+        Geometry = NewGeometry;
+    }
+    else
+    {
+        Geometry.Reset();
+    }
+
+    UpdateBounds();
+    MarkRenderStateDirty();
+}
+
+
+FPrimitiveSceneProxy* UMaxQOrbitPathComponent::CreateSceneProxy()
+{
+    return Geometry.IsValid() ? new FMaxQOrbitPathSceneProxy(this, Geometry) : nullptr;
+}
+
+
+FBoxSphereBounds UMaxQOrbitPathComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+    if (Geometry.IsValid())
+    {
+        return FBoxSphereBounds(Geometry->Bounds).TransformBy(LocalToWorld);
+    }
+
+    return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.);
+}
+
+
+#if WITH_EDITOR
+void UMaxQOrbitPathComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+    Super::PostEditChangeProperty(PropertyChangedEvent);
+
+    if (PropertyChangedEvent.GetPropertyName() == GET_MEMBER_NAME_CHECKED(UMaxQOrbitPathComponent, HyperbolicAnomalyLimit) && Geometry.IsValid())
+    {
+        Rebuild();
+    }
+    else
+    {
+        MarkRenderStateDirty();
+    }
+}
+#endif
@@ -0,0 +1,493 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQSatelliteCatalogComponent.cpp
+//
+// Implementation Comments
+//
+// An update is:
+// 1. Propagate every satellite (FTleBatch::Evaluate), and rotate them all to
+//    the observer's frame (Teme::Transform), in parallel
+// 2. Cull against the first local player's view and build each satellite's
+//    transform, in parallel
+// 3. Compact the visible transforms, and write them to the instance buffer
+//    as one batch, as MaxQSmallBodiesComponent
+// 4. Promote the MaxPromoted nearest visible satellites, plus the selected
+//    ones, and give each one a pooled orbit path
+//
+// The view test is against a cone around the camera's forward axis that
+// contains the whole frustum (its half-angle is the diagonal's), widened by
+// the instance's bounding radius.  The size test is the bounding sphere's
+// projected diameter in pixels.  Both run in the component's space, so the
+// camera's moved into it once, rather than each satellite out of it.
+//
+// The nearest N come from a bounded max-heap, so promotion is O(n log N).
+// Orbit paths are osculating conics of the promoted satellites' states.
+// They're set when a satellite is promoted, and re-osculated only every
+// OrbitRefreshInterval: J2's short-period terms alone move the osculating
+// conic by far more than UMaxQOrbitPathComponent's RebuildTolerance every
+// update, so re-osculating every update rebuilt every path every frame.
+// Each path stays with its satellite while it's promoted.
+//
+// This is a plain ISM rather than an HISM, for the same reason as
+// MaxQSmallBodiesComponent: every transform changes every update.
+//------------------------------------------------------------------------------
+
+#include "MaxQSatelliteCatalogComponent.h"
+#include "MaxQClockSubsystem.h"
+#include "MaxQOrbitPathComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "SpiceConics.h"
+#include "SpiceLog.h"
+#include "SpiceMath.h"
+#include "SpiceTeme.h"
+#include "SpiceUtilities.h"
+#include "Algo/BinarySearch.h"
+
+namespace
+{
+    constexpr int32 BatchSize = 1024;
+
+    // Standard WGS-84 value (km^3/s^2)
+    constexpr double EarthGM = 398600.4418;
+
+    struct FViewCone
+    {
+        FVector Origin;
+        FVector Forward;
+
+        // Of the frustum's corners
+        double TanHalfAngle;
+        double SecHalfAngle;
+
+        // Pixels per unit of (size / distance)
+        double PixelsPerRadian;
+    };
+}
+
+
+UMaxQSatelliteCatalogComponent::UMaxQSatelliteCatalogComponent()
+{
+    ObserverReferenceFrame = TEXT("J2000");
+    SatelliteScale = 1.f;
+    bCullByView = true;
+    MinScreenSize = 1.f;
+    MaxPromoted = 8;
+    bDrawPromotedOrbits = true;
+    OrbitColor = FColor::Red;
+    OrbitRefreshInterval = 600.;
+    GM = FSMassConstant(EarthGM);
+    bFollowClock = true;
+    LastClockUpdate = 0;
+
+    PrimaryComponentTick.bCanEverTick = true;
+    CastShadow = false;
+    SetGenerateOverlapEvents(false);
+    SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+}
+
+
+void UMaxQSatelliteCatalogComponent::LoadCatalog(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    const FString& file
+)
+{
+    MaxQ::Tle::LoadCatalog(file, Catalog, true, &ResultCode, &ErrorMessage);
+    CatalogChanged();
+}
+
+
+void UMaxQSatelliteCatalogComponent::AddTelemetry(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    const FString& Telemetry
+)
+{
+    const auto Text = StringCast<ANSICHAR>(*Telemetry, Telemetry.Len());
+    MaxQ::Tle::ParseCatalog(FAnsiStringView(Text.Get(), Text.Length()), Catalog, &ResultCode, &ErrorMessage);
+    CatalogChanged();
+}
+
+
+void UMaxQSatelliteCatalogComponent::ClearCatalog()
+{
+    Catalog.Reset();
+    Selected.Reset();
+    CatalogChanged();
+}
+
+
+void UMaxQSatelliteCatalogComponent::CatalogChanged()
+{
+    // Satellites keep their indices as others are added, but the states are
+    // stale either way
+    States.Init(FSStateVector(), Catalog.Num());
+    Errors.Init(MaxQ::Sgp4::EError::None, Catalog.Num());
+    LastClockUpdate = 0;
+
+    // Indices may now be other satellites, so every orbit path is released,
+    // to be re-osculated at the next update
+    for (const TPair<int32, int32>& SatelliteOrbitPath : SatelliteOrbitPaths)
+    {
+        OrbitPaths[SatelliteOrbitPath.Value]->SetVisibility(false);
+        FreeOrbitPaths.Add(SatelliteOrbitPath.Value);
+    }
+    SatelliteOrbitPaths.Reset();
+
+    // ...and every satellite demoted, until the next update promotes them
+    // again
+    if (Promoted.Num() > 0)
+    {
+        const TArray<int32> Demoted = MoveTemp(Promoted);
+        Promoted.Reset();
+        OnPromotionChanged.Broadcast(TArray<int32>(), Demoted);
+    }
+}
+
+
+void UMaxQSatelliteCatalogComponent::SetEphemerisTime(const FSEphemerisTime& et)
+{
+    Update(et);
+}
+
+
+void UMaxQSatelliteCatalogComponent::SetSelected(int32 SatelliteIndex, bool bSelected)
+{
+    if (bSelected && SatelliteIndex >= 0 && SatelliteIndex < Catalog.Num())
+    {
+        Selected.Add(SatelliteIndex);
+    }
+    else
+    {
+        Selected.Remove(SatelliteIndex);
+    }
+}
+
+
+void UMaxQSatelliteCatalogComponent::ClearSelection()
+{
+    Selected.Reset();
+}
+
+
+int32 UMaxQSatelliteCatalogComponent::GetInstanceSatellite(int32 InstanceIndex) const
+{
+    return InstanceSatellites.IsValidIndex(InstanceIndex) ? InstanceSatellites[InstanceIndex] : INDEX_NONE;
+}
+
+
+FString UMaxQSatelliteCatalogComponent::GetSatelliteName(int32 SatelliteIndex) const
+{
+    return SatelliteIndex >= 0 && SatelliteIndex < Catalog.Num() ? FString(Catalog.GetName(SatelliteIndex)) : FString();
+}
+
+
+bool UMaxQSatelliteCatalogComponent::GetSatelliteLocation(int32 SatelliteIndex, FVector& WorldLocation) const
+{
+    if (!States.IsValidIndex(SatelliteIndex) || Errors[SatelliteIndex] != MaxQ::Sgp4::EError::None)
+    {
+        return false;
+    }
+
+    WorldLocation = GetComponentTransform().TransformPosition(MaxQ::Math::Swizzle(States[SatelliteIndex].r));
+    return true;
+}
+
+
+void UMaxQSatelliteCatalogComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    UMaxQClockSubsystem* Clock = UMaxQClockSubsystem::Get(this);
+    if (Clock)
+    {
+        Clock->AddTickPrerequisite(PrimaryComponentTick);
+    }
+}
+
+
+void UMaxQSatelliteCatalogComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    const UMaxQClockSubsystem* Clock = bFollowClock ? UMaxQClockSubsystem::Get(this) : nullptr;
+    if (Clock && Clock->GetUpdateNumber() != LastClockUpdate)
+    {
+        LastClockUpdate = Clock->GetUpdateNumber();
+        Update(Clock->GetEphemerisTime());
+    }
+}
+
+
+void UMaxQSatelliteCatalogComponent::Update(const FSEphemerisTime& et)
+{
+    const int32 NumSatellites = Catalog.Num();
+    States.SetNum(NumSatellites);
+    Errors.SetNum(NumSatellites);
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    MaxQ::Covariance::FStateMatrix ToObserver;
+    if (!MaxQ::Teme::ToFrame(et, ObserverReferenceFrame, ToObserver, &ResultCode, &ErrorMessage))
+    {
+        UE_LOG(LogSpice, Warning, TEXT("UMaxQSatelliteCatalogComponent: %s"), *ErrorMessage);
+        return;
+    }
+
+    // Satellites that fail (e.g. decayed) are culled below
+    Catalog.Satellites.Evaluate(et, States, Errors);
+    MaxQ::Teme::Transform(ToObserver, States);
+
+    // The view, in the component's space
+    FViewCone View = { FVector::ZeroVector, FVector::ForwardVector, 0., 1., 0. };
+    bool bHaveView = false;
+    const UWorld* World = GetWorld();
+    const APlayerController* Player = World ? World->GetFirstPlayerController() : nullptr;
+    if (Player && Player->PlayerCameraManager)
+    {
+        const FTransform& ToWorld = GetComponentTransform();
+        const APlayerCameraManager* Camera = Player->PlayerCameraManager;
+
+        int32 Width = 0, Height = 0;
+        Player->GetViewportSize(Width, Height);
+
+        const double TanHalfFov = FMath::Tan(FMath::DegreesToRadians(0.5 * FMath::Clamp(Camera->GetFOVAngle(), 1.f, 179.f)));
+        const double Aspect = Width > 0 && Height > 0 ? double(Height) / double(Width) : 1.;
+
+        View.Origin = ToWorld.InverseTransformPosition(Camera->GetCameraLocation());
+        View.Forward = ToWorld.InverseTransformVectorNoScale(Camera->GetCameraRotation().Vector());
+        View.TanHalfAngle = TanHalfFov * FMath::Sqrt(1. + Aspect * Aspect);
+        View.SecHalfAngle = FMath::Sqrt(1. + View.TanHalfAngle * View.TanHalfAngle);
+        View.PixelsPerRadian = 0.5 * FMath::Max(Width, 1) / TanHalfFov;
+        bHaveView = true;
+    }
+
+    const UStaticMesh* Mesh = GetStaticMesh();
+    const double Radius = (Mesh ? Mesh->GetBounds().SphereRadius : 0.) * SatelliteScale;
+    const bool bCullView = bCullByView && bHaveView;
+    const bool bCullSize = MinScreenSize > 0.f && bHaveView && Radius > 0.;
+    const double MinSize = MinScreenSize;
+    const FVector Scale(SatelliteScale);
+
+    Transforms.SetNumUninitialized(NumSatellites, false);
+    Visible.SetNumUninitialized(NumSatellites, false);
+    CameraDistances.SetNumUninitialized(NumSatellites, false);
+
+    MaxQ::Private::ForEachBatch(NumSatellites, BatchSize, [&](int32 Begin, int32 End)
+    {
+        for (int32 i = Begin; i < End; ++i)
+        {
+            const FVector Location = MaxQ::Math::Swizzle(States[i].r);
+            bool bVisible = Errors[i] == MaxQ::Sgp4::EError::None;
+
+            const FVector FromCamera = Location - View.Origin;
+            const double Distance = bHaveView ? FromCamera.Size() : 0.;
+
+            if (bVisible && bCullView)
+            {
+                const double Along = FromCamera | View.Forward;
+                const double Across = (FromCamera - Along * View.Forward).Size();
+                bVisible = Along >= -Radius && Across <= Along * View.TanHalfAngle + Radius * View.SecHalfAngle;
+            }
+
+            if (bVisible && bCullSize)
+            {
+                bVisible = Distance <= Radius || 2. * Radius * View.PixelsPerRadian >= MinSize * Distance;
+            }
+
+            Visible[i] = bVisible;
+            CameraDistances[i] = Distance;
+            Transforms[i] = FTransform(FQuat::Identity, Location, Scale);
+        }
+    });
+
+    InstanceSatellites.Reset();
+    int32 NumVisible = 0;
+    for (int32 i = 0; i < NumSatellites; ++i)
+    {
+        if (Visible[i])
+        {
+            Transforms[NumVisible++] = Transforms[i];
+            InstanceSatellites.Add(i);
+        }
+    }
+    Transforms.SetNum(NumVisible, false);
+
+    const int32 NumInstances = GetInstanceCount();
+    if (NumVisible > NumInstances)
+    {
+        TArray<FTransform> Added;
+        Added.Init(FTransform::Identity, NumVisible - NumInstances);
+        AddInstances(Added, false);
+    }
+    else if (NumVisible < NumInstances)
+    {
+        TArray<int32> Removed;
+        Removed.Reserve(NumInstances - NumVisible);
+        for (int32 i = NumInstances - 1; i >= NumVisible; --i)
+        {
+            Removed.Add(i);
+        }
+        RemoveInstances(Removed);
+    }
+
+    if (NumVisible > 0)
+    {
+        BatchUpdateInstancesTransforms(0, Transforms, false, true, true);
+    }
+
+    UpdatePromoted(bHaveView);
+    UpdateOrbits(et);
+}
+
+
+void UMaxQSatelliteCatalogComponent::UpdatePromoted(bool bHaveView)
+{
+    // The nearest MaxPromoted visible satellites, farthest at the heap's top
+    TArray<int32> Nearest;
+    if (bHaveView && MaxPromoted > 0)
+    {
+        Nearest.Reserve(MaxPromoted + 1);
+        const auto Farther = [this](int32 A, int32 B) { return CameraDistances[A] > CameraDistances[B]; };
+
+        for (const int32 i : InstanceSatellites)
+        {
+            if (Nearest.Num() < MaxPromoted)
+            {
+                Nearest.HeapPush(i, Farther);
+            }
+            else if (CameraDistances[i] < CameraDistances[Nearest.HeapTop()])
+            {
+                int32 Dropped;
+                Nearest.HeapPop(Dropped, Farther, false);
+                Nearest.HeapPush(i, Farther);
+            }
+        }
+    }
+
+    TArray<int32> NowPromoted;
+    NowPromoted.Reserve(Nearest.Num() + Selected.Num());
+    for (const int32 i : Selected)
+    {
+        if (i < Catalog.Num() && Errors[i] == MaxQ::Sgp4::EError::None)
+        {
+            NowPromoted.Add(i);
+        }
+    }
+    for (const int32 i : Nearest)
+    {
+        if (!Selected.Contains(i))
+        {
+            NowPromoted.Add(i);
+        }
+    }
+    NowPromoted.Sort();
+
+    // Both sorted, so the differences are a merge
+    TArray<int32> Added, Removed;
+    int32 a = 0, b = 0;
+    while (a < NowPromoted.Num() || b < Promoted.Num())
+    {
+        if (b == Promoted.Num() || (a < NowPromoted.Num() && NowPromoted[a] < Promoted[b]))
+        {
+            Added.Add(NowPromoted[a++]);
+        }
+        else if (a == NowPromoted.Num() || Promoted[b] < NowPromoted[a])
+        {
+            Removed.Add(Promoted[b++]);
+        }
+        else
+        {
+            ++a;
+            ++b;
+        }
+    }
+
+    Promoted = MoveTemp(NowPromoted);
+
+    if (Added.Num() > 0 || Removed.Num() > 0)
+    {
+        OnPromotionChanged.Broadcast(Added, Removed);
+    }
+}
+
+
+void UMaxQSatelliteCatalogComponent::UpdateOrbits(const FSEphemerisTime& et)
+{
+    // Release the paths of satellites no longer promoted
+    for (auto It = SatelliteOrbitPaths.CreateIterator(); It; ++It)
+    {
+        if (!bDrawPromotedOrbits || Algo::BinarySearch(Promoted, It.Key()) == INDEX_NONE)
+        {
+            OrbitPaths[It.Value()]->SetVisibility(false);
+            FreeOrbitPaths.Add(It.Value());
+            It.RemoveCurrent();
+        }
+    }
+
+    if (!bDrawPromotedOrbits)
+    {
+        return;
+    }
+
+    // Newly promoted satellites, and those whose orbits are due a refresh
+    TArray<int32> Stale;
+    for (const int32 i : Promoted)
+    {
+        if (const int32* Path = SatelliteOrbitPaths.Find(i))
+        {
+            if (FMath::Abs(et.seconds - OrbitPathEpochs[*Path]) < OrbitRefreshInterval)
+            {
+                continue;
+            }
+        }
+        else if (FreeOrbitPaths.Num() > 0)
+        {
+            SatelliteOrbitPaths.Add(i, FreeOrbitPaths.Pop(false));
+        }
+        else
+        {
+            UMaxQOrbitPathComponent* OrbitPath = NewObject<UMaxQOrbitPathComponent>(GetOwner(), NAME_None, RF_Transient);
+            OrbitPath->SetupAttachment(this);
+            OrbitPath->RegisterComponent();
+            SatelliteOrbitPaths.Add(i, OrbitPaths.Add(OrbitPath));
+            OrbitPathEpochs.Add(0.);
+        }
+        Stale.Add(i);
+    }
+
+    if (Stale.Num() > 0)
+    {
+        TArray<FSStateVector> StaleStates;
+        StaleStates.Reserve(Stale.Num());
+        for (const int32 i : Stale)
+        {
+            StaleStates.Add(States[i]);
+        }
+
+        // Degenerate states are left as default elements, which draw nothing
+        TArray<FSConicElements> Elements;
+        Elements.SetNum(Stale.Num());
+        MaxQ::Conics::Osculate(StaleStates, et, GM, Elements);
+
+        for (int32 k = 0; k < Stale.Num(); ++k)
+        {
+            const int32 Path = SatelliteOrbitPaths[Stale[k]];
+            UMaxQOrbitPathComponent* OrbitPath = OrbitPaths[Path];
+            OrbitPath->SetOrbit(Elements[k], et, ObserverReferenceFrame, ObserverReferenceFrame);
+            OrbitPath->SetLineColor(OrbitColor);
+            OrbitPath->SetVisibility(true);
+            OrbitPathEpochs[Path] = et.seconds;
+        }
+    }
+}
@@ -0,0 +1,199 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQSmallBodiesComponent.cpp
+//
+// Implementation Comments
+//
+// An update is:
+// 1. (Only when MaxMagnitude changes) select the candidate bodies
+// 2. Propagate the candidates, rotated to the observer's frame, in parallel
+//    (FConicBatch::Evaluate)
+// 3. Distance-cull and build each candidate's transform, in parallel
+// 4. Compact the visible transforms, and write them to the instance buffer
+//    as one batch
+// Instances are only added or removed when the visible count changes; a
+// body's instance index changes whenever a body ahead of it is culled, so
+// InstanceBodies maps instances back to the catalog.
+//
+// This is a plain ISM rather than an HISM: an HISM rebuilds its cluster tree
+// whenever its transforms change, which is every update here.
+//------------------------------------------------------------------------------
+
+#include "MaxQSmallBodiesComponent.h"
+#include "MaxQClockSubsystem.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/DataTable.h"
+#include "Spice.h"
+#include "SpiceLog.h"
+#include "SpiceMath.h"
+#include "SpiceUtilities.h"
+
+namespace
+{
+    constexpr int32 BatchSize = 1024;
+}
+
+
+UMaxQSmallBodiesComponent::UMaxQSmallBodiesComponent()
+{
+    MaxMagnitude = 30.f;
+    MaxDistance = FSDistance(0.);
+    CullingOrigin = FSDistanceVector();
+    ObserverReferenceFrame = TEXT("ECLIPJ2000");
+    BodyScale = 1.f;
+    bFollowClock = true;
+    CandidatesMagnitude = -1.f;
+    LastClockUpdate = 0;
+
+    PrimaryComponentTick.bCanEverTick = true;
+    CastShadow = false;
+    SetGenerateOverlapEvents(false);
+    SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+}
+
+
+void UMaxQSmallBodiesComponent::LoadMpcorb(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    const FString& file,
+    float maxMagnitude
+)
+{
+    Catalog.Reset();
+    CandidatesMagnitude = -1.f;
+    LastClockUpdate = 0;
+    MaxQ::SmallBodies::LoadMpcorb(file, Catalog, maxMagnitude, FSMassConstant(MaxQ::SmallBodies::SunGM), &ResultCode, &ErrorMessage);
+}
+
+
+void UMaxQSmallBodiesComponent::ImportDataTable(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    const UDataTable* Table
+)
+{
+    Catalog.Reset();
+    CandidatesMagnitude = -1.f;
+    LastClockUpdate = 0;
+    MaxQ::SmallBodies::ImportDataTable(Table, Catalog, FSMassConstant(MaxQ::SmallBodies::SunGM), &ResultCode, &ErrorMessage);
+}
+
+
+void UMaxQSmallBodiesComponent::SetEphemerisTime(const FSEphemerisTime& et)
+{
+    Update(et);
+}
+
+
+FString UMaxQSmallBodiesComponent::GetBodyName(int32 InstanceIndex) const
+{
+    return InstanceBodies.IsValidIndex(InstanceIndex) ? FString(Catalog.GetName(InstanceBodies[InstanceIndex])) : FString();
+}
+
+
+void UMaxQSmallBodiesComponent::BeginPlay()
+{
+    Super::BeginPlay();
+
+    UMaxQClockSubsystem* Clock = UMaxQClockSubsystem::Get(this);
+    if (Clock)
+    {
+        Clock->AddTickPrerequisite(PrimaryComponentTick);
+    }
+}
+
+
+void UMaxQSmallBodiesComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    const UMaxQClockSubsystem* Clock = bFollowClock ? UMaxQClockSubsystem::Get(this) : nullptr;
+    if (Clock && Clock->GetUpdateNumber() != LastClockUpdate)
+    {
+        LastClockUpdate = Clock->GetUpdateNumber();
+        Update(Clock->GetEphemerisTime());
+    }
+}
+
+
+void UMaxQSmallBodiesComponent::Update(const FSEphemerisTime& et)
+{
+    if (MaxMagnitude != CandidatesMagnitude)
+    {
+        Catalog.Select(MaxMagnitude, Candidates);
+        CandidatesMagnitude = MaxMagnitude;
+    }
+
+    const int32 NumCandidates = Candidates.Num();
+    Positions.SetNumUninitialized(NumCandidates, false);
+
+    ES_ResultCode ResultCode;
+    FString ErrorMessage;
+    FSRotationMatrix m;
+    USpice::pxform(ResultCode, ErrorMessage, m, et, Catalog.Frame, ObserverReferenceFrame);
+
+    if (ResultCode != ES_ResultCode::Success || !Catalog.Orbits.Evaluate(Candidates, et, m, Positions, &ResultCode, &ErrorMessage))
+    {
+        UE_LOG(LogSpice, Warning, TEXT("UMaxQSmallBodiesComponent: %s"), *ErrorMessage);
+        return;
+    }
+
+    // Culled in Unreal's axes, in km
+    const FVector Origin = MaxQ::Math::Swizzle(CullingOrigin);
+    const double Limit = MaxDistance.km > 0. ? MaxDistance.km * MaxDistance.km : TNumericLimits<double>::Max();
+    const FVector Scale(BodyScale);
+
+    Transforms.SetNumUninitialized(NumCandidates, false);
+    Visible.SetNumUninitialized(NumCandidates, false);
+
+    MaxQ::Private::ForEachBatch(NumCandidates, BatchSize, [&](int32 Begin, int32 End)
+    {
+        for (int32 i = Begin; i < End; ++i)
+        {
+            const FVector Location = MaxQ::Math::Swizzle(Positions[i]);
+            Visible[i] = FVector::DistSquared(Location, Origin) <= Limit;
+            Transforms[i] = FTransform(FQuat::Identity, Location, Scale);
+        }
+    });
+
+    InstanceBodies.Reset();
+    int32 NumVisible = 0;
+    for (int32 i = 0; i < NumCandidates; ++i)
+    {
+        if (Visible[i])
+        {
+            Transforms[NumVisible++] = Transforms[i];
+            InstanceBodies.Add(Candidates[i]);
+        }
+    }
+    Transforms.SetNum(NumVisible, false);
+
+    const int32 NumInstances = GetInstanceCount();
+    if (NumVisible > NumInstances)
+    {
+        TArray<FTransform> Added;
+        Added.Init(FTransform::Identity, NumVisible - NumInstances);
+        AddInstances(Added, false);
+    }
+    else if (NumVisible < NumInstances)
+    {
+        TArray<int32> Removed;
+        Removed.Reserve(NumInstances - NumVisible);
+        for (int32 i = NumInstances - 1; i >= NumVisible; --i)
+        {
+            Removed.Add(i);
+        }
+        RemoveInstances(Removed);
+    }
+
+    if (NumVisible > 0)
+    {
+        BatchUpdateInstancesTransforms(0, Transforms, false, true, true);
+    }
+}
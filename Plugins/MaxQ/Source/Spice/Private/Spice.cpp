@@ -58,6 +58,9 @@
 #include "SpicePlatformDefs.h"
 #include "SpiceUtilities.h"
 #include "SpiceMath.h"
+#include "SpiceData.h"
+#include "SpiceSclk.h"
+#include "SpiceTime.h"
 #include "algorithm"
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
@@ -2242,6 +2245,12 @@ void USpice::deltet(
     FSEphemerisPeriod& delta
 )
 {
+    // The leapseconds table is cached natively.  Without one, CSPICE diagnoses the error.
+    if (MaxQ::Time::DeltaEt(epoch, eptype, delta, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Inputs
     SpiceDouble		_epoch = epoch;
     ConstSpiceChar* _eptype = eptype == ES_EpochType::UTC ? "UTC" : "ET";
@@ -2258,6 +2267,30 @@ void USpice::deltet(
     ErrorCheck(ResultCode, ErrorMessage);
 }
 
+
+void USpice::deltet_list(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    const TArray<double>& epochs,
+    ES_EpochType eptype,
+    TArray<FSEphemerisPeriod>& deltas
+)
+{
+    deltas.SetNumUninitialized(epochs.Num());
+    if (MaxQ::Time::DeltaEt(epochs, eptype, deltas, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
+    // No leapseconds kernel, let CSPICE diagnose it
+    deltas.Empty();
+    if (epochs.Num() > 0)
+    {
+        FSEphemerisPeriod delta;
+        deltet(ResultCode, ErrorMessage, epochs[0], eptype, delta);
+    }
+}
+
 /*
 Exceptions
 
@@ -5350,11 +5383,7 @@ void USpice::tparse(
 
 void USpice::et_now(FSEphemerisTime& Now)
 {
-    auto now = FDateTime::UtcNow();
-    auto j2000 = FDateTime::FromJulianDay(2451545.0);
-    auto now_j2000 = now - j2000;
-
-    Now = FSEphemerisTime(now_j2000.GetTotalSeconds());
+    Now = MaxQ::Data::Now();
 }
 
 
@@ -8371,6 +8400,13 @@ void USpice::sce2c(
     double& sclkdp
 )
 {
+    // Type 1 clocks convert natively.  Anything else, and any failure, goes
+    // through CSPICE, so errors are diagnosed the same way as always.
+    if (MaxQ::Sclk::EtToTicks(sc, et, sclkdp, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Inputs
     SpiceInt    _sc = sc;
     SpiceDouble _et = et.AsSpiceDouble();
@@ -8554,6 +8590,13 @@ void USpice::scencd(
     double& sclkdp
 )
 {
+    // Type 1 clocks convert natively.  Anything else, and any failure, goes
+    // through CSPICE, so errors are diagnosed the same way as always.
+    if (MaxQ::Sclk::StrToTicks(sc, sclkch, sclkdp, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Outputs
     SpiceDouble     _sclkdp = 0;
 
@@ -8706,6 +8749,13 @@ void USpice::scs2e(
     FSEphemerisTime& et
 )
 {
+    // Type 1 clocks convert natively.  Anything else, and any failure, goes
+    // through CSPICE, so errors are diagnosed the same way as always.
+    if (MaxQ::Sclk::StrToEt(sc, sclkch, et, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Outputs
     SpiceDouble     _et = 0;
 
@@ -8762,6 +8812,13 @@ void USpice::sct2e(
     FSEphemerisTime& et
 )
 {
+    // Type 1 clocks convert natively.  Anything else, and any failure, goes
+    // through CSPICE, so errors are diagnosed the same way as always.
+    if (MaxQ::Sclk::TicksToEt(sc, sclkdp, et, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Inputs
     SpiceInt    _sc = sc;
     SpiceDouble _sclkdp = sclkdp;
@@ -10941,6 +10998,12 @@ void USpice::unitim(
     ES_TimeScale outsys
 )
 {
+    // The leapseconds table is cached natively.  Without one, CSPICE diagnoses the error.
+    if (MaxQ::Time::ConvertTimeScale(epoch, insys, outsys, out, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
     // Inputs
     SpiceDouble     _epoch = epoch;
     ConstSpiceChar* _insys = MaxQ::Core::ToANSIString(insys);
@@ -10959,6 +11022,31 @@ void USpice::unitim(
     ErrorCheck(ResultCode, ErrorMessage);
 }
 
+
+void USpice::unitim_list(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<double>& out,
+    const TArray<double>& epochs,
+    ES_TimeScale insys,
+    ES_TimeScale outsys
+)
+{
+    out.SetNumUninitialized(epochs.Num());
+    if (MaxQ::Time::ConvertTimeScale(epochs, insys, outsys, out, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
+    // No leapseconds kernel (or a bad time scale), let CSPICE diagnose it
+    out.Empty();
+    if (epochs.Num() > 0)
+    {
+        double first;
+        unitim(ResultCode, ErrorMessage, first, epochs[0], insys, outsys);
+    }
+}
+
 /*
 Exceptions
 
@@ -0,0 +1,1035 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceConics.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Native two-body propagation of many conic orbits at once
+//
+// Add() mirrors conics: the periapsis state, mean motion and (for ellipses)
+// the period are computed exactly as conics computes them, so the time past
+// periapsis matches conics bit for bit.
+//
+// Evaluate() replaces prop2b.  Propagating from periapsis means the radial
+// velocity is zero, so with the universal anomaly x and z = alpha*x^2 the
+// universal Kepler equation and its derivatives are
+//   F(x)   = rp*x + e*x^3*S(z) - sqrt(mu)*dt
+//   F'(x)  = rp + e*x^2*C(z) = r
+//   F''(x) = e*x*(1 - z*S(z))
+// where C and S are the Stumpff functions.  F is monotonic (r >= rp), so the
+// root is bracketed by [0, sqrt(mu)*dt/rp]; the Laguerre-Conway iteration is
+// used inside that bracket, falling back to bisection if a step leaves it.
+// Ellipses are first reduced to within half a period of periapsis.
+//
+// The f and g functions are written in terms of x*(1 - z*S), x^2*C and
+// x^3*S so nothing large cancels, e.g. g = rp*x*(1 - z*S)/sqrt(mu) rather
+// than dt - x^3*S/sqrt(mu).
+//
+// Each orbit's solve takes a data-dependent number of iterations, so the
+// batch is parallelized across worker threads rather than across SIMD lanes.
+//
+// Transition() propagates arbitrary states, so it solves the universal
+// Kepler equation from the state itself (r0*U1 + sigma0*U2 + U3 =
+// sqrt(mu)*dt, with the same Laguerre-Conway iteration but no bracket), and
+// builds the transition matrix from Battin's closed form in the universal
+// functions U0..U5.  It isn't reduced by whole periods: the matrix grows
+// secularly with dt, and the reduction would lose that.
+//
+// Osculate() follows oscelt and oscltx step for step, including their
+// tolerances and singular cases: ucrss and vsep are reproduced so circular,
+// equatorial and parabolic orbits come out the same.  Vectors are normed
+// without vnorm's rescaling, so results can differ from CSPICE's in the last
+// bit or so.  It's branchy, but with no iteration, so it's threaded the same
+// way.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceConics.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceConics.h"
+#include "SpiceUtilities.h"
+#include "Misc/ScopeLock.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Conics
+{
+    namespace
+    {
+        // Orbits per batch, per worker
+        constexpr int32 BatchSize = 1024;
+
+        // Laguerre-Conway's order
+        constexpr double LaguerreN = 5.;
+
+        // Below this |z| the Stumpff functions come from their series
+        constexpr double SeriesLimit = 1.;
+        constexpr int SeriesTerms = 9;
+
+        struct FUniversal
+        {
+            // x*(1 - z*S(z)), x^2*C(z), x^3*S(z)
+            double s1;
+            double s2;
+            double s3;
+        };
+
+        FUniversal UniversalFunctions(double x, double Alpha)
+        {
+            const double x2 = x * x;
+            const double z = Alpha * x2;
+
+            double C, S, OneMinusZS;
+
+            if (FMath::Abs(z) < SeriesLimit)
+            {
+                // C = 1/2! - z/4! + z^2/6! ...,  S = 1/3! - z/5! + z^2/7! ...
+                double c = 1., s = 1.;
+                for (int k = SeriesTerms; k >= 1; --k)
+                {
+                    c = 1. - z * c / ((2. * k + 1.) * (2. * k + 2.));
+                    s = 1. - z * s / ((2. * k + 2.) * (2. * k + 3.));
+                }
+                C = c / 2.;
+                S = s / 6.;
+                OneMinusZS = 1. - z * S;
+            }
+            else if (z > 0.)
+            {
+                const double y = FMath::Sqrt(z);
+                const double SinY = FMath::Sin(y);
+                C = (1. - FMath::Cos(y)) / z;
+                S = (y - SinY) / (y * z);
+                OneMinusZS = SinY / y;
+            }
+            else
+            {
+                const double y = FMath::Sqrt(-z);
+                const double SinhY = sinh(y);
+                C = (cosh(y) - 1.) / -z;
+                S = (SinhY - y) / (y * -z);
+                OneMinusZS = SinhY / y;
+            }
+
+            return FUniversal{ x * OneMinusZS, x2 * C, x2 * x * S };
+        }
+
+        struct FLagrange
+        {
+            double f;
+            double g;
+            double fdot;
+            double gdot;
+        };
+
+        // f and g for a propagation of dt seconds from periapsis
+        FLagrange SolveFromPeriapsis(double Rp, double Ecc, double Alpha, double SqrtMu, double dt, double Tolerance, int32 MaxIterations)
+        {
+            if (dt == 0.)
+            {
+                return FLagrange{ 1., 0., 0., 1. };
+            }
+
+            const double Target = SqrtMu * dt;
+            const double Sign = dt > 0. ? 1. : -1.;
+
+            // r >= rp, so |x| <= |sqrt(mu)*dt/rp|.  For parabolas and
+            // hyperbolas S(z) >= 1/6 as well, so |x| <= cbrt(6*|sqrt(mu)*dt|/e).
+            double Bound = FMath::Abs(Target) / Rp;
+            if (Alpha <= 0.)
+            {
+                Bound = FMath::Min(Bound, FMath::Pow(6. * FMath::Abs(Target) / Ecc, 1. / 3.));
+            }
+            double Lo = dt > 0. ? 0. : -Bound;
+            double Hi = dt > 0. ? Bound : 0.;
+
+            // Starting guess: Danby's E0 = M + 0.85*e for ellipses (x is
+            // sqrt(a) times the change in eccentric anomaly), and the usual
+            // asymptotic guess for hyperbolas far from periapsis.
+            double x = Sign * Bound;
+            if (Alpha > 0.)
+            {
+                const double SqrtAlpha = FMath::Sqrt(Alpha);
+                x = (Target * Alpha * SqrtAlpha + 0.85 * Ecc * Sign) / SqrtAlpha;
+            }
+            else if (Alpha < 0.)
+            {
+                const double Arg = -2. * Alpha * FMath::Abs(Target) / (FMath::Sqrt(-1. / Alpha) * Ecc);
+                if (Arg > 1.)
+                {
+                    x = Sign * FMath::Sqrt(-1. / Alpha) * FMath::Loge(Arg);
+                }
+            }
+            x = FMath::Clamp(x, Lo, Hi);
+
+            for (int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+            {
+                const FUniversal U = UniversalFunctions(x, Alpha);
+                const double F = Rp * x + Ecc * U.s3 - Target;
+                if (F == 0.) break;
+
+                if (F < 0.) Lo = x; else Hi = x;
+
+                const double dF = Rp + Ecc * U.s2;
+                const double ddF = Ecc * U.s1;
+                const double Disc = FMath::Abs((LaguerreN - 1.) * (LaguerreN - 1.) * dF * dF - LaguerreN * (LaguerreN - 1.) * F * ddF);
+                double Next = x - LaguerreN * F / (dF + FMath::Sqrt(Disc));
+
+                if (!(Next >= Lo && Next <= Hi))
+                {
+                    Next = 0.5 * (Lo + Hi);
+                }
+
+                const bool bConverged = FMath::Abs(Next - x) <= Tolerance * FMath::Abs(Next);
+                x = Next;
+                if (bConverged) break;
+            }
+
+            const FUniversal U = UniversalFunctions(x, Alpha);
+            const double r = Rp + Ecc * U.s2;
+
+            return FLagrange{
+                1. - U.s2 / Rp,
+                Rp * U.s1 / SqrtMu,
+                -SqrtMu * U.s1 / (r * Rp),
+                1. - U.s2 / r
+            };
+        }
+
+        inline void Store(FSStateVector& Out, const double(&state)[6])
+        {
+            Out = FSStateVector(state);
+        }
+
+        inline void Store(FSDistanceVector& Out, const double(&state)[6])
+        {
+            Out = FSDistanceVector(state[0], state[1], state[2]);
+        }
+    }
+
+
+    void FConicBatch::Reset()
+    {
+        for (TArray<double>* Field : { &R0x, &R0y, &R0z, &V0x, &V0y, &V0z, &Rp, &Eccentricity, &Alpha, &SqrtMu, &Epoch, &MeanAnomalyTime, &Period })
+        {
+            Field->Reset();
+        }
+    }
+
+    void FConicBatch::Reserve(int32 Count)
+    {
+        for (TArray<double>* Field : { &R0x, &R0y, &R0z, &V0x, &V0y, &V0z, &Rp, &Eccentricity, &Alpha, &SqrtMu, &Epoch, &MeanAnomalyTime, &Period })
+        {
+            Field->Reserve(Count);
+        }
+    }
+
+    bool FConicBatch::Add(const FSConicElements& Orbit, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        double elts[8];
+        Orbit.CopyTo(elts);
+
+        const double rp = elts[0];
+        const double ecc = elts[1];
+        const double mu = elts[7];
+
+        // Same checks, in the same order, as conics
+        if (ecc < 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: eccentricity %f is negative"), ecc));
+        }
+        if (rp <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: periapsis distance %f is not positive"), rp));
+        }
+        if (mu <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: GM %f is not positive"), mu));
+        }
+
+        const double cosi = FMath::Cos(elts[2]);
+        const double sini = FMath::Sin(elts[2]);
+        const double cosn = FMath::Cos(elts[3]);
+        const double sinn = FMath::Sin(elts[3]);
+        const double cosw = FMath::Cos(elts[4]);
+        const double sinw = FMath::Sin(elts[4]);
+        const double snci = sinn * cosi;
+        const double cnci = cosn * cosi;
+
+        const double v = FMath::Sqrt(mu * (ecc + 1.) / rp);
+
+        R0x.Add(rp * (cosn * cosw - snci * sinw));
+        R0y.Add(rp * (sinn * cosw + cnci * sinw));
+        R0z.Add(rp * (sini * sinw));
+        V0x.Add(v * (-cosn * sinw - snci * cosw));
+        V0y.Add(v * (-sinn * sinw + cnci * cosw));
+        V0z.Add(v * (sini * cosw));
+
+        double n = 0.;
+        if (ecc < 1.)
+        {
+            const double ainvrs = (1. - ecc) / rp;
+            n = FMath::Sqrt(mu * ainvrs) * ainvrs;
+            Alpha.Add(ainvrs);
+            Period.Add(UE_DOUBLE_TWO_PI / n);
+        }
+        else if (ecc > 1.)
+        {
+            const double ainvrs = (ecc - 1.) / rp;
+            n = FMath::Sqrt(mu * ainvrs) * ainvrs;
+            Alpha.Add(-ainvrs);
+            Period.Add(0.);
+        }
+        else
+        {
+            n = FMath::Sqrt(mu / (rp * 2.)) / rp;
+            Alpha.Add(0.);
+            Period.Add(0.);
+        }
+
+        Rp.Add(rp);
+        Eccentricity.Add(ecc);
+        SqrtMu.Add(FMath::Sqrt(mu));
+        Epoch.Add(elts[6]);
+        MeanAnomalyTime.Add(elts[5] / n);
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Add(TConstArrayView<FSConicElements> Orbits, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const int32 Start = Num();
+        Reserve(Start + Orbits.Num());
+
+        for (int32 i = 0; i < Orbits.Num(); ++i)
+        {
+            if (!Add(Orbits[i], ResultCode, ErrorMessage))
+            {
+                for (TArray<double>* Field : { &R0x, &R0y, &R0z, &V0x, &V0y, &V0z, &Rp, &Eccentricity, &Alpha, &SqrtMu, &Epoch, &MeanAnomalyTime, &Period })
+                {
+                    Field->SetNum(Start);
+                }
+                if (ErrorMessage) *ErrorMessage += FString::Printf(TEXT(" (index %d)"), i);
+                return false;
+            }
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    template<typename OutType>
+    bool FConicBatch::EvaluateBatch(double et, const FSEphemerisTime* ets, const int32* Orbits, const double(*m)[3], TArrayView<OutType> Out, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(Orbits || Out.Num() == Num());
+        constexpr bool bVelocity = std::is_same_v<OutType, FSStateVector>;
+
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+
+        ForEachBatch(Out.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                const int32 j = Orbits ? Orbits[i] : i;
+                double dt = ((ets ? ets[i].seconds : et) - Epoch[j]) + MeanAnomalyTime[j];
+
+                // Ellipses: conics' d_mod (not fmod, which rounds differently),
+                // then the nearer periapsis passage
+                const double P = Period[j];
+                if (P > 0.)
+                {
+                    dt = dt - P * FMath::TruncToDouble(dt / P);
+                    if (dt > 0.5 * P) dt -= P;
+                    else if (dt < -0.5 * P) dt += P;
+                }
+
+                const FLagrange L = SolveFromPeriapsis(Rp[j], Eccentricity[j], Alpha[j], SqrtMu[j], dt, Tolerance, MaxIterations);
+
+                double state[6];
+                state[0] = L.f * R0x[j] + L.g * V0x[j];
+                state[1] = L.f * R0y[j] + L.g * V0y[j];
+                state[2] = L.f * R0z[j] + L.g * V0z[j];
+                if constexpr (bVelocity)
+                {
+                    state[3] = L.fdot * R0x[j] + L.gdot * V0x[j];
+                    state[4] = L.fdot * R0y[j] + L.gdot * V0y[j];
+                    state[5] = L.fdot * R0z[j] + L.gdot * V0z[j];
+                }
+                else
+                {
+                    state[3] = state[4] = state[5] = 0.;
+                }
+
+                if (m)
+                {
+                    for (int v = 0; v < (bVelocity ? 6 : 3); v += 3)
+                    {
+                        const double x = state[v], y = state[v + 1], z = state[v + 2];
+                        state[v] = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+                        state[v + 1] = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+                        state[v + 2] = m[2][0] * x + m[2][1] * y + m[2][2] * z;
+                    }
+                }
+
+                bool bFinite = true;
+                for (double Component : state) bFinite &= FMath::IsFinite(Component);
+
+                if (bFinite)
+                {
+                    Store(Out[i], state);
+                }
+                else
+                {
+                    FScopeLock Lock(&FailureLock);
+                    FirstFailure = (FirstFailure == INDEX_NONE) ? i : FMath::Min(FirstFailure, i);
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: the state of orbit %d at ET %f overflowed"), Orbits ? Orbits[FirstFailure] : FirstFailure, ets ? ets[FirstFailure].seconds : et));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(const FSEphemerisTime& et, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        return EvaluateBatch(et.seconds, nullptr, nullptr, nullptr, States, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(const FSEphemerisTime& et, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        return EvaluateBatch(et.seconds, nullptr, nullptr, nullptr, Positions, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        double _m[3][3];
+        m.CopyTo(_m);
+        return EvaluateBatch(et.seconds, nullptr, nullptr, _m, States, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        double _m[3][3];
+        m.CopyTo(_m);
+        return EvaluateBatch(et.seconds, nullptr, nullptr, _m, Positions, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(ets.Num() == Num());
+        return EvaluateBatch(0., ets.GetData(), nullptr, nullptr, States, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(TConstArrayView<int32> Orbits, TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(ets.Num() == Orbits.Num() && States.Num() == Orbits.Num());
+        return EvaluateBatch(0., ets.GetData(), Orbits.GetData(), nullptr, States, ResultCode, ErrorMessage);
+    }
+
+    bool FConicBatch::Evaluate(TConstArrayView<int32> Orbits, const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(Positions.Num() == Orbits.Num());
+        double _m[3][3];
+        m.CopyTo(_m);
+        return EvaluateBatch(et.seconds, nullptr, Orbits.GetData(), _m, Positions, ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool Evaluate(const FSConicElements& Orbit, const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        FConicBatch Batch;
+        return Batch.Add(Orbit, ResultCode, ErrorMessage) && Batch.Evaluate(et, TArrayView<FSStateVector>(&State, 1), ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool Evaluate(TConstArrayView<FSConicElements> Orbits, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        FConicBatch Batch;
+        if (!Batch.Add(Orbits, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        TArray<FSEphemerisTime> Epochs;
+        Epochs.Reserve(Orbits.Num());
+        for (const FSConicElements& Orbit : Orbits)
+        {
+            Epochs.Add(Orbit.Epoch);
+        }
+
+        return Batch.Evaluate(Epochs, States, ResultCode, ErrorMessage);
+    }
+
+
+    namespace
+    {
+        // oscltx's bound on a and tau, dpmax/200
+        constexpr double OsculateLimit = DBL_MAX / 200.;
+
+        // oscelt's tolerances for a parabola, and for an equatorial orbit
+        constexpr double ParabolicTolerance = 1e-10;
+        constexpr double EquatorialTolerance = 1e-10;
+
+        enum class EDegenerateState : uint8
+        {
+            None,
+            Position,
+            Velocity,
+            AngularMomentum
+        };
+
+        inline double Dot(const double* a, const double* b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline double Norm(const double* a)
+        {
+            return FMath::Sqrt(Dot(a, a));
+        }
+
+        inline bool IsZero(const double* a)
+        {
+            return a[0] == 0. && a[1] == 0. && a[2] == 0.;
+        }
+
+        inline void Cross(const double* a, const double* b, double* out)
+        {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        // vhat: unit vector, or zero
+        inline void Hat(const double* a, double* out)
+        {
+            const double Length = Norm(a);
+            const double Scale = Length > 0. ? 1. / Length : 0.;
+            for (int k = 0; k < 3; ++k) out[k] = a[k] * Scale;
+        }
+
+        // ucrss: the inputs are scaled by their largest component first, so
+        // the product can't overflow or underflow
+        inline void UnitCross(const double* a, const double* b, double* out)
+        {
+            const double MaxA = FMath::Max3(FMath::Abs(a[0]), FMath::Abs(a[1]), FMath::Abs(a[2]));
+            const double MaxB = FMath::Max3(FMath::Abs(b[0]), FMath::Abs(b[1]), FMath::Abs(b[2]));
+            double ta[3], tb[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                ta[k] = MaxA != 0. ? a[k] / MaxA : 0.;
+                tb[k] = MaxB != 0. ? b[k] / MaxB : 0.;
+            }
+            double c[3];
+            Cross(ta, tb, c);
+            Hat(c, out);
+        }
+
+        // vsep: the angle between two vectors, accurate near 0 and pi
+        inline double Separation(const double* a, const double* b)
+        {
+            double ua[3], ub[3];
+            Hat(a, ua);
+            Hat(b, ub);
+            if (IsZero(ua) || IsZero(ub)) return 0.;
+
+            const double d = Dot(ua, ub);
+            double t[3];
+            if (d > 0.)
+            {
+                for (int k = 0; k < 3; ++k) t[k] = ua[k] - ub[k];
+                return 2. * FMath::Asin(0.5 * Norm(t));
+            }
+            if (d < 0.)
+            {
+                for (int k = 0; k < 3; ++k) t[k] = ua[k] + ub[k];
+                return UE_DOUBLE_PI - 2. * FMath::Asin(0.5 * Norm(t));
+            }
+            return UE_DOUBLE_HALF_PI;
+        }
+
+        // |a| with the sign of b (Fortran's SIGN)
+        inline double CopySign(double a, double b)
+        {
+            return b >= 0. ? FMath::Abs(a) : -FMath::Abs(a);
+        }
+
+        // oscelt's elements, then oscltx's true anomaly, a and tau, step for step
+        EDegenerateState OsculateOne(const double(&state)[6], double et, double mu, double(&elts)[8], double(&extended)[3])
+        {
+            const double* r = state;
+            const double* v = state + 3;
+
+            if (IsZero(r)) return EDegenerateState::Position;
+            if (IsZero(v)) return EDegenerateState::Velocity;
+
+            const double rmag = Norm(r);
+            const double vmag = Norm(v);
+
+            double h[3];
+            Cross(r, v, h);
+            if (IsZero(h)) return EDegenerateState::AngularMomentum;
+
+            double n[3] = { -h[1], h[0], 0. };
+
+            double e[3];
+            const double c1 = vmag * vmag - mu / rmag;
+            const double c2 = -Dot(r, v);
+            for (int k = 0; k < 3; ++k) e[k] = (c1 * r[k] + c2 * v[k]) * (1. / mu);
+
+            double ecc = Norm(e);
+            if (FMath::Abs(ecc - 1.) <= ParabolicTolerance) ecc = 1.;
+
+            const double p = Dot(h, h) / mu;
+            const double rp = p / (ecc + 1.);
+
+            static const double zvec[3] = { 0., 0., 1. };
+            double inc = Separation(h, zvec);
+            if (FMath::Abs(inc) < EquatorialTolerance)
+            {
+                inc = 0.;
+                n[0] = 1.; n[1] = 0.; n[2] = 0.;
+            }
+            else if (FMath::Abs(inc - UE_DOUBLE_PI) < EquatorialTolerance)
+            {
+                inc = UE_DOUBLE_PI;
+                n[0] = 1.; n[1] = 0.; n[2] = 0.;
+            }
+
+            double lnode = FMath::Atan2(n[1], n[0]);
+            if (lnode < 0.) lnode += UE_DOUBLE_TWO_PI;
+
+            double argp = 0.;
+            if (ecc != 0.)
+            {
+                argp = Separation(n, e);
+                if (argp != 0.)
+                {
+                    if (inc == 0. || inc == UE_DOUBLE_PI)
+                    {
+                        double xprod[3];
+                        UnitCross(h, n, xprod);
+                        if (Dot(e, xprod) < 0.) argp = UE_DOUBLE_TWO_PI - argp;
+                    }
+                    else if (e[2] < 0.)
+                    {
+                        argp = UE_DOUBLE_TWO_PI - argp;
+                    }
+                }
+            }
+
+            double perix[3], periy[3];
+            Hat(ecc == 0. ? n : e, perix);
+            UnitCross(h, perix, periy);
+
+            const double nu = FMath::Atan2(Dot(r, periy), Dot(r, perix));
+
+            double m0;
+            if (ecc < 1.)
+            {
+                const double cosea = (ecc + FMath::Cos(nu)) / (ecc * FMath::Cos(nu) + 1.);
+                const double sinea = rmag / rp * FMath::Sqrt((1. - ecc) / (ecc + 1.)) * FMath::Sin(nu);
+                const double ea = FMath::Atan2(sinea, cosea);
+                m0 = CopySign(ea - ecc * FMath::Sin(ea), nu);
+                if (m0 < 0.) m0 += UE_DOUBLE_TWO_PI;
+            }
+            else if (ecc > 1.)
+            {
+                const double coshf = FMath::Max(1., (ecc + FMath::Cos(nu)) / (ecc * FMath::Cos(nu) + 1.));
+                const double ea = FMath::Loge(coshf + coshf * FMath::Sqrt(1. - 1. / coshf / coshf));
+                m0 = CopySign(ecc * sinh(ea) - ea, nu);
+            }
+            else
+            {
+                const double ea = FMath::Tan(nu / 2.);
+                m0 = CopySign(ea + ea * ea * ea / 3., nu);
+            }
+
+            elts[0] = rp;
+            elts[1] = ecc;
+            elts[2] = inc;
+            elts[3] = lnode;
+            elts[4] = argp;
+            elts[5] = m0;
+            elts[6] = et;
+            elts[7] = mu;
+
+            // oscltx: the true anomaly is measured from the eccentricity
+            // vector (the same periapsis direction as above) in [0, 2pi), or
+            // is the mean anomaly for a circle.
+            double TrueAnomaly = m0;
+            if (FMath::Abs(ecc) > ParabolicTolerance)
+            {
+                TrueAnomaly = nu < 0. ? nu + UE_DOUBLE_TWO_PI : nu;
+            }
+
+            extended[0] = TrueAnomaly;
+            extended[1] = 0.;
+            extended[2] = 0.;
+
+            if (ecc == 1. || rmag <= mu / OsculateLimit)
+            {
+                return EDegenerateState::None;
+            }
+
+            const double Energy = vmag * vmag * 0.5 - mu / rmag;
+            if (FMath::Abs(Energy) < FMath::Abs(mu) / OsculateLimit)
+            {
+                return EDegenerateState::None;
+            }
+
+            const double a = -mu / (Energy * 2.);
+            extended[1] = a;
+
+            if (ecc < 1.)
+            {
+                const double b = FMath::Pow(OsculateLimit / UE_DOUBLE_TWO_PI, 2. / 3.);
+                const double mucubr = FMath::Pow(mu, 1. / 3.);
+                const bool bComputeTau = mu >= 1. ? a / mucubr < b : a < b * mucubr;
+                if (bComputeTau)
+                {
+                    extended[2] = UE_DOUBLE_TWO_PI * FMath::Pow(a / mucubr, 1.5);
+                }
+            }
+
+            return EDegenerateState::None;
+        }
+
+        const TCHAR* DegenerateStateMessage(EDegenerateState Degenerate)
+        {
+            switch (Degenerate)
+            {
+            case EDegenerateState::Position:
+                return TEXT("has a zero position vector");
+            case EDegenerateState::Velocity:
+                return TEXT("has a zero velocity vector");
+            default:
+                return TEXT("has parallel position and velocity; the specific angular momentum vector is zero");
+            }
+        }
+    }
+
+
+    SPICE_API bool Osculate(TConstArrayView<FSStateVector> States, const FSEphemerisTime& et, const FSMassConstant& mu, TArrayView<FSConicElements> Elements, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        return Osculate(States, et, mu, Elements, TArrayView<FSAngle>(), TArrayView<FSDistance>(), TArrayView<FSEphemerisPeriod>(), ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool Osculate(TConstArrayView<FSStateVector> States, const FSEphemerisTime& et, const FSMassConstant& mu, TArrayView<FSConicElements> Elements, TArrayView<FSAngle> TrueAnomaly, TArrayView<FSDistance> SemiMajorAxis, TArrayView<FSEphemerisPeriod> Period, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(Elements.Num() == States.Num());
+        check(TrueAnomaly.Num() == 0 || TrueAnomaly.Num() == States.Num());
+        check(SemiMajorAxis.Num() == 0 || SemiMajorAxis.Num() == States.Num());
+        check(Period.Num() == 0 || Period.Num() == States.Num());
+
+        const double GM = mu.GM;
+        if (GM <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: GM %f is not positive"), GM));
+        }
+
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+        EDegenerateState FirstFailureReason = EDegenerateState::None;
+
+        ForEachBatch(States.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                double state[6];
+                States[i].CopyTo(state);
+
+                double elts[8];
+                double extended[3];
+                const EDegenerateState Degenerate = OsculateOne(state, et.seconds, GM, elts, extended);
+
+                if (Degenerate == EDegenerateState::None)
+                {
+                    Elements[i] = FSConicElements(elts);
+                    if (TrueAnomaly.Num()) TrueAnomaly[i] = FSAngle(extended[0]);
+                    if (SemiMajorAxis.Num()) SemiMajorAxis[i] = FSDistance(extended[1]);
+                    if (Period.Num()) Period[i] = FSEphemerisPeriod(extended[2]);
+                }
+                else
+                {
+                    FScopeLock Lock(&FailureLock);
+                    if (FirstFailure == INDEX_NONE || i < FirstFailure)
+                    {
+                        FirstFailure = i;
+                        FirstFailureReason = Degenerate;
+                    }
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: state %d %s"), FirstFailure, DegenerateStateMessage(FirstFailureReason)));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    namespace
+    {
+        // Transition()'s Kepler solve
+        constexpr double TransitionTolerance = 1e-13;
+        constexpr int32 TransitionMaxIterations = 64;
+
+        // Stumpff functions c2(z) .. c5(z), with c[n - 2] = cn
+        void Stumpff(double z, double(&c)[4])
+        {
+            if (FMath::Abs(z) < SeriesLimit)
+            {
+                // cn = 1/n! - z/(n+2)! + z^2/(n+4)! ...
+                double Factorial = 1.;
+                for (int n = 2; n <= 5; ++n)
+                {
+                    Factorial *= n;
+                    double Sum = 1.;
+                    for (int k = SeriesTerms; k >= 1; --k)
+                    {
+                        Sum = 1. - z * Sum / ((n + 2. * k - 1.) * (n + 2. * k));
+                    }
+                    c[n - 2] = Sum / Factorial;
+                }
+                return;
+            }
+
+            if (z > 0.)
+            {
+                const double y = FMath::Sqrt(z);
+                c[0] = (1. - FMath::Cos(y)) / z;
+                c[1] = (y - FMath::Sin(y)) / (y * z);
+            }
+            else
+            {
+                const double y = FMath::Sqrt(-z);
+                c[0] = (cosh(y) - 1.) / -z;
+                c[1] = (sinh(y) - y) / (y * -z);
+            }
+            c[2] = (0.5 - c[0]) / z;
+            c[3] = (1. / 6. - c[1]) / z;
+        }
+
+        inline void AddOuter(double(&m)[6][6], int32 Row, int32 Column, double Scale, const double* a, const double* b)
+        {
+            for (int32 i = 0; i < 3; ++i)
+            {
+                for (int32 j = 0; j < 3; ++j)
+                {
+                    m[Row + i][Column + j] += Scale * a[i] * b[j];
+                }
+            }
+        }
+
+        inline void AddIdentity(double(&m)[6][6], int32 Row, int32 Column, double Scale)
+        {
+            for (int32 i = 0; i < 3; ++i)
+            {
+                m[Row + i][Column + i] += Scale;
+            }
+        }
+
+        // Propagates state by dt, and its transition matrix, from the
+        // universal-variable solution (Battin, "An Introduction to the
+        // Mathematics and Methods of Astrodynamics", section 9.7)
+        bool TransitionOne(const double(&state)[6], double dt, double mu, double(&phi)[6][6], double(&propagated)[6])
+        {
+            const double* r0 = state;
+            const double* v0 = state + 3;
+
+            const double R0 = Norm(r0);
+            if (R0 == 0.)
+            {
+                return false;
+            }
+
+            const double SqrtMu = FMath::Sqrt(mu);
+            const double Sigma0 = Dot(r0, v0) / SqrtMu;
+            const double Alpha = 2. / R0 - Dot(v0, v0) / mu;
+            const double Target = SqrtMu * dt;
+
+            // Starting guess (Vallado, algorithm 8)
+            double x = Alpha > 0. ? Target * Alpha : Target / R0;
+            if (Alpha < 0. && dt != 0.)
+            {
+                const double Sign = dt > 0. ? 1. : -1.;
+                const double a = 1. / Alpha;
+                const double Arg = -2. * mu * Alpha * dt / (Dot(r0, v0) + Sign * FMath::Sqrt(-mu * a) * (1. - R0 * Alpha));
+                if (Arg > 0.)
+                {
+                    x = Sign * FMath::Sqrt(-a) * FMath::Loge(Arg);
+                }
+            }
+
+            // Universal functions U0 .. U5 of x
+            double U[6];
+            auto Evaluate = [&]()
+            {
+                const double x2 = x * x;
+                double c[4];
+                Stumpff(Alpha * x2, c);
+                U[2] = x2 * c[0];
+                U[3] = x2 * x * c[1];
+                U[4] = x2 * x2 * c[2];
+                U[5] = x2 * x2 * x * c[3];
+                U[1] = x - Alpha * U[3];
+                U[0] = 1. - Alpha * U[2];
+            };
+
+            bool bConverged = false;
+            for (int32 Iteration = 0; Iteration < TransitionMaxIterations && !bConverged; ++Iteration)
+            {
+                Evaluate();
+                const double F = R0 * U[1] + Sigma0 * U[2] + U[3] - Target;
+                const double dF = R0 * U[0] + Sigma0 * U[1] + U[2];
+                const double ddF = Sigma0 * U[0] + (1. - Alpha * R0) * U[1];
+                const double Disc = FMath::Abs((LaguerreN - 1.) * (LaguerreN - 1.) * dF * dF - LaguerreN * (LaguerreN - 1.) * F * ddF);
+                const double Step = LaguerreN * F / (dF + FMath::Sqrt(Disc));
+
+                if (!FMath::IsFinite(Step))
+                {
+                    return false;
+                }
+
+                x -= Step;
+                bConverged = FMath::Abs(Step) <= TransitionTolerance * FMath::Abs(x) || F == 0.;
+            }
+            Evaluate();
+
+            const double R = R0 * U[0] + Sigma0 * U[1] + U[2];
+            const double f = 1. - U[2] / R0;
+            const double g = (R0 * U[1] + Sigma0 * U[2]) / SqrtMu;
+            const double fdot = -SqrtMu * U[1] / (R * R0);
+            const double gdot = 1. - U[2] / R;
+
+            double* r = propagated;
+            double* v = propagated + 3;
+            for (int32 i = 0; i < 3; ++i)
+            {
+                r[i] = f * r0[i] + g * v0[i];
+                v[i] = fdot * r0[i] + gdot * v0[i];
+            }
+
+            if (!bConverged || !FMath::IsFinite(Dot(r, r)) || !FMath::IsFinite(Dot(v, v)))
+            {
+                return false;
+            }
+
+            const double C = (3. * U[5] - x * U[4]) / SqrtMu - dt * U[2];
+
+            double dr[3], dv[3];
+            for (int32 i = 0; i < 3; ++i)
+            {
+                dr[i] = r[i] - r0[i];
+                dv[i] = v[i] - v0[i];
+            }
+
+            FMemory::Memzero(phi, sizeof(phi));
+
+            // dr/dr0
+            AddOuter(phi, 0, 0, R / mu, dv, dv);
+            AddOuter(phi, 0, 0, (1. - f) / (R0 * R0), r, r0);
+            AddOuter(phi, 0, 0, C / (R0 * R0 * R0), v, r0);
+            AddIdentity(phi, 0, 0, f);
+
+            // dr/dv0
+            AddOuter(phi, 0, 3, R0 * (1. - f) / mu, dr, v0);
+            AddOuter(phi, 0, 3, -R0 * (1. - f) / mu, dv, r0);
+            AddOuter(phi, 0, 3, C / mu, v, v0);
+            AddIdentity(phi, 0, 3, g);
+
+            // dv/dr0
+            double Rotated[3];
+            const double rv = Dot(r, v);
+            const double rr = Dot(r, r);
+            for (int32 i = 0; i < 3; ++i)
+            {
+                // (r v^T - v r^T) r
+                Rotated[i] = r[i] * rv - v[i] * rr;
+            }
+            AddOuter(phi, 3, 0, -1. / (R0 * R0), dv, r0);
+            AddOuter(phi, 3, 0, -1. / (R * R), r, dv);
+            AddIdentity(phi, 3, 0, fdot);
+            AddOuter(phi, 3, 0, -fdot / (R * R), r, r);
+            AddOuter(phi, 3, 0, fdot / (mu * R), Rotated, dv);
+            AddOuter(phi, 3, 0, -mu * C / (R * R * R * R0 * R0 * R0), r, r0);
+
+            // dv/dv0
+            AddOuter(phi, 3, 3, R0 / mu, dv, dv);
+            AddOuter(phi, 3, 3, R0 * (1. - f) / (R * R * R), r, r0);
+            AddOuter(phi, 3, 3, -C / (R * R * R), r, v0);
+            AddIdentity(phi, 3, 3, gdot);
+
+            return true;
+        }
+    }
+
+
+    SPICE_API bool Transition(const FSStateVector& State, const FSEphemerisPeriod& dt, const FSMassConstant& mu, FSStateVector& Final, Covariance::FStateMatrix& Phi, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        return Transition(TConstArrayView<FSStateVector>(&State, 1), dt, mu, TArrayView<FSStateVector>(&Final, 1), TArrayView<Covariance::FStateMatrix>(&Phi, 1), ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool Transition(TConstArrayView<FSStateVector> States, const FSEphemerisPeriod& dt, const FSMassConstant& mu, TArrayView<FSStateVector> Finals, TArrayView<Covariance::FStateMatrix> Transitions, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(Finals.Num() == States.Num());
+        check(Transitions.Num() == States.Num());
+
+        const double GM = mu.GM;
+        if (GM <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: GM %f is not positive"), GM));
+        }
+
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+
+        ForEachBatch(States.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                double state[6];
+                States[i].CopyTo(state);
+
+                double transition[6][6];
+                double propagated[6];
+                if (TransitionOne(state, dt.seconds, GM, transition, propagated))
+                {
+                    Finals[i] = FSStateVector(propagated);
+                    Transitions[i] = Covariance::FStateMatrix(transition);
+                }
+                else
+                {
+                    FScopeLock Lock(&FailureLock);
+                    if (FirstFailure == INDEX_NONE || i < FirstFailure)
+                    {
+                        FirstFailure = i;
+                    }
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Conics: state %d can't be propagated (zero position, or an unbounded hyperbola)"), FirstFailure));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,410 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceConjunctions.cpp
+//
+// Implementation Comments
+//
+// Purpose:  All-vs-all conjunction screening of satellite catalogs
+//
+// Shells: sorted by perigee, a satellite overlaps an earlier one if the
+// largest apogee before it reaches its perigee (less the threshold and
+// margin).  That satellite, and the one with that apogee, are kept.
+//
+// Steps: the distance between two satellites changes no faster than the
+// sum of their speeds, so if it's under D at some time in a step of length
+// h, it's under D + vmax h at one of the step's ends, where vmax bounds
+// every satellite's speed.  vmax is each kept satellite's speed at perigee,
+// from its mean elements, with a margin for the osculating orbit.  Each
+// step's positions are hashed into cubic cells that size, and each
+// satellite is compared to those in its own cell and the 26 around it.
+//
+// Pairs found at step k are refined on steps [k-1, k] and [k, k+1].  The
+// refined step [k-1, k] is done once step k's states are in (with the pairs
+// found at k-1 and k together), so only two steps' states are kept.
+//
+// Refinement: the pair's relative position over the step is a cubic
+// Hermite spline of the relative states at its ends.  Closest approaches
+// are where r.v changes sign from negative to positive; the step is
+// sampled for sign changes, and each is bisected.  An approach closest at
+// a step's end is found on that step, where r.v reaches zero, and not on
+// the next, where it starts at zero, so it's reported once.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceConjunctions.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceConjunctions.h"
+#include "SpiceUtilities.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/ScopeLock.h"
+
+using namespace MaxQ::Private;
+using MaxQ::Sgp4::FTleBatch;
+
+namespace MaxQ::Conjunctions
+{
+    namespace
+    {
+        // Satellites (or pairs) per batch, per worker
+        constexpr int32 BatchSize = 256;
+
+        // WGS-72's GM, km^3/s^2, and a margin on the speed at perigee
+        constexpr double EarthGM = 398600.8;
+        constexpr double SpeedMargin = 1.05;
+
+        // Sign changes of r.v are looked for at this many points per step,
+        // then bisected this many times
+        constexpr int32 Samples = 8;
+        constexpr int32 Bisections = 48;
+
+        // Cell coordinates, 21 bits each.  Coordinates that wrap only cost
+        // a few extra distance checks.
+        constexpr uint64 CellMask = (1ull << 21) - 1;
+
+        uint64 CellKey(int64 x, int64 y, int64 z)
+        {
+            return ((uint64(x) & CellMask) << 42) | ((uint64(y) & CellMask) << 21) | (uint64(z) & CellMask);
+        }
+
+        uint64 PairKey(int32 i, int32 j)
+        {
+            return (uint64(i) << 32) | uint64(uint32(j));
+        }
+
+        // Every satellite's state at one step, 6 per satellite
+        struct FStep
+        {
+            double et = 0.;
+            TArray<double> States;
+            TArray<bool> Valid;
+        };
+
+        struct FCell
+        {
+            uint64 Key;
+            int32 Satellite;
+
+            bool operator<(const FCell& Other) const { return Key < Other.Key; }
+        };
+
+        // Relative position and velocity, at s in [0, 1] along a step of h
+        // seconds, from the relative states at its ends
+        void Hermite(const double (&r0)[6], const double (&r1)[6], double h, double s, double (&r)[3], double (&v)[3])
+        {
+            const double s2 = s * s, s3 = s2 * s;
+            const double h00 = 2. * s3 - 3. * s2 + 1., h10 = s3 - 2. * s2 + s;
+            const double h01 = -2. * s3 + 3. * s2, h11 = s3 - s2;
+            const double d00 = 6. * s2 - 6. * s, d10 = 3. * s2 - 4. * s + 1.;
+            const double d01 = -d00, d11 = 3. * s2 - 2. * s;
+
+            for (int32 k = 0; k < 3; ++k)
+            {
+                r[k] = h00 * r0[k] + h10 * h * r0[k + 3] + h01 * r1[k] + h11 * h * r1[k + 3];
+                v[k] = (d00 * r0[k] + d01 * r1[k]) / h + d10 * r0[k + 3] + d11 * r1[k + 3];
+            }
+        }
+
+        double RangeRate(const double (&r0)[6], const double (&r1)[6], double h, double s)
+        {
+            double r[3], v[3];
+            Hermite(r0, r1, h, s, r, v);
+            return r[0] * v[0] + r[1] * v[1] + r[2] * v[2];
+        }
+
+        // The closest approach along a step, as s, distance and relative
+        // speed.  Distance is huge if there's no minimum on the step.
+        void ClosestApproach(const double (&r0)[6], const double (&r1)[6], double h, bool bFirst, bool bLast, double& sMin, double& Distance, double& Speed)
+        {
+            double Best = TNumericLimits<double>::Max();
+            sMin = 0.;
+            Speed = 0.;
+            auto Consider = [&](double s)
+            {
+                double r[3], v[3];
+                Hermite(r0, r1, h, s, r, v);
+                const double d2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+                if (d2 < Best)
+                {
+                    Best = d2;
+                    sMin = s;
+                    Speed = FMath::Sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                }
+            };
+
+            // The span's ends are minima if the pair is receding from the
+            // first or closing at the last.  Any other step's ends belong to
+            // the minima of the steps either side.
+            double sLow = 0., gLow = RangeRate(r0, r1, h, 0.);
+            if (bFirst && gLow >= 0.) Consider(0.);
+            if (bLast && RangeRate(r0, r1, h, 1.) < 0.) Consider(1.);
+
+            for (int32 n = 1; n <= Samples; ++n)
+            {
+                const double sHigh = double(n) / Samples;
+                const double gHigh = RangeRate(r0, r1, h, sHigh);
+                if (gLow < 0. && gHigh >= 0.)
+                {
+                    double a = sLow, b = sHigh;
+                    for (int32 k = 0; k < Bisections; ++k)
+                    {
+                        const double m = 0.5 * (a + b);
+                        if (RangeRate(r0, r1, h, m) < 0.) a = m;
+                        else b = m;
+                    }
+                    Consider(0.5 * (a + b));
+                }
+                sLow = sHigh;
+                gLow = gHigh;
+            }
+
+            Distance = FMath::Sqrt(Best);
+        }
+
+        void Evaluate(const FTleBatch& Satellites, double et, FStep& Step, TArray<FSStateVector>& States, TArray<Sgp4::EError>& Errors)
+        {
+            const int32 Count = Satellites.Num();
+            Step.et = et;
+            Step.States.SetNumUninitialized(Count * 6);
+            Step.Valid.SetNumUninitialized(Count);
+
+            // Failures are flagged in Errors, and left out
+            Satellites.Evaluate(FSEphemerisTime(et), States, Errors);
+
+            ForEachBatch(Count, BatchSize, [&](int32 Begin, int32 End)
+            {
+                for (int32 i = Begin; i < End; ++i)
+                {
+                    double s[6];
+                    States[i].CopyTo(s);
+                    FMemory::Memcpy(&Step.States[i * 6], s, sizeof(s));
+                    Step.Valid[i] = Errors[i] == Sgp4::EError::None;
+                }
+            });
+        }
+    }
+
+
+    SPICE_API bool Screen(
+        const FTleBatch& Satellites,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        const FSDistance& Threshold,
+        TArray<FConjunction>& Conjunctions,
+        const FSettings& Settings,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        Conjunctions.Reset();
+
+        const double D = Threshold.km;
+        const double Step = Settings.Step.seconds;
+        if (!(D > 0.) || !(Step > 0.) || !(etEnd.seconds > et.seconds))
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Conjunctions: the threshold and step must be positive, and the span must end after it begins"));
+        }
+
+        const int32 Count = Satellites.Num();
+        const double ShellLimit = D + Settings.ShellMargin.km;
+
+        // Stage 1: orbit shells
+        TArray<double> Perigees, Apogees;
+        Perigees.SetNumUninitialized(Count);
+        Apogees.SetNumUninitialized(Count);
+        ForEachBatch(Count, BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                Satellites.GetPerigeeApogee(i, Perigees[i], Apogees[i]);
+            }
+        });
+
+        TArray<int32> ByPerigee;
+        ByPerigee.SetNumUninitialized(Count);
+        for (int32 i = 0; i < Count; ++i) ByPerigee[i] = i;
+        ByPerigee.Sort([&](int32 a, int32 b) { return Perigees[a] < Perigees[b]; });
+
+        TArray<bool> Kept;
+        Kept.Init(false, Count);
+        int32 HighestApogee = INDEX_NONE;
+        for (int32 i : ByPerigee)
+        {
+            if (HighestApogee != INDEX_NONE && Apogees[HighestApogee] >= Perigees[i] - ShellLimit)
+            {
+                Kept[i] = Kept[HighestApogee] = true;
+            }
+            if (HighestApogee == INDEX_NONE || Apogees[i] > Apogees[HighestApogee])
+            {
+                HighestApogee = i;
+            }
+        }
+
+        auto ShellsOverlap = [&](int32 i, int32 j)
+        {
+            return FMath::Max(Perigees[i], Perigees[j]) - FMath::Min(Apogees[i], Apogees[j]) <= ShellLimit;
+        };
+
+        // The fastest any kept satellite goes (at perigee)
+        double MaxSpeed = 0.;
+        for (int32 i = 0; i < Count; ++i)
+        {
+            if (Kept[i] && Perigees[i] > 0.)
+            {
+                const double a = 0.5 * (Perigees[i] + Apogees[i]);
+                MaxSpeed = FMath::Max(MaxSpeed, FMath::Sqrt(EarthGM * (2. / Perigees[i] - 1. / a)));
+            }
+        }
+
+        const double CellSize = D + SpeedMargin * MaxSpeed * Step;
+        const double CellSize2 = CellSize * CellSize;
+        const int32 NumSteps = FMath::Max(1, FMath::CeilToInt32((etEnd.seconds - et.seconds) / Step));
+
+        FCriticalSection Lock;
+        FStep Previous, Current;
+        TArray<FSStateVector> States;
+        TArray<Sgp4::EError> Errors;
+        States.SetNum(Count);
+        Errors.SetNum(Count);
+
+        TArray<FCell> Cells;
+        TArray<uint64> Found, Pending;
+
+        for (int32 k = 0; k <= NumSteps; ++k)
+        {
+            Evaluate(Satellites, k == NumSteps ? etEnd.seconds : et.seconds + k * Step, Current, States, Errors);
+
+            // Stage 2: hash this step's positions
+            Cells.Reset();
+            for (int32 i = 0; i < Count; ++i)
+            {
+                if (Kept[i] && Current.Valid[i])
+                {
+                    const double* r = &Current.States[i * 6];
+                    Cells.Add({ CellKey(FMath::FloorToInt64(r[0] / CellSize), FMath::FloorToInt64(r[1] / CellSize), FMath::FloorToInt64(r[2] / CellSize)), i });
+                }
+            }
+            Cells.Sort();
+
+            TArray<uint64> Keys;
+            Keys.SetNumUninitialized(Cells.Num());
+            for (int32 c = 0; c < Cells.Num(); ++c) Keys[c] = Cells[c].Key;
+
+            Found.Reset();
+            ForEachBatch(Cells.Num(), BatchSize, [&](int32 Begin, int32 End)
+            {
+                TArray<uint64> Local;
+                for (int32 c = Begin; c < End; ++c)
+                {
+                    const int32 i = Cells[c].Satellite;
+                    const double* ri = &Current.States[i * 6];
+                    const int64 x = FMath::FloorToInt64(ri[0] / CellSize);
+                    const int64 y = FMath::FloorToInt64(ri[1] / CellSize);
+                    const int64 z = FMath::FloorToInt64(ri[2] / CellSize);
+
+                    for (int64 dx = -1; dx <= 1; ++dx)
+                    for (int64 dy = -1; dy <= 1; ++dy)
+                    for (int64 dz = -1; dz <= 1; ++dz)
+                    {
+                        const uint64 Key = CellKey(x + dx, y + dy, z + dz);
+                        for (int32 n = Algo::LowerBound(Keys, Key); n < Keys.Num() && Keys[n] == Key; ++n)
+                        {
+                            const int32 j = Cells[n].Satellite;
+                            if (j <= i || !ShellsOverlap(i, j))
+                            {
+                                continue;
+                            }
+
+                            const double* rj = &Current.States[j * 6];
+                            const double d2 = FMath::Square(rj[0] - ri[0]) + FMath::Square(rj[1] - ri[1]) + FMath::Square(rj[2] - ri[2]);
+                            if (d2 <= CellSize2)
+                            {
+                                Local.Add(PairKey(i, j));
+                            }
+                        }
+                    }
+                }
+
+                FScopeLock ScopeLock(&Lock);
+                Found.Append(Local);
+            });
+
+            // Stage 3: the step before this one, with the pairs found at
+            // either end of it
+            if (k > 0)
+            {
+                Pending.Append(Found);
+                Pending.Sort();
+
+                TArray<uint64> Pairs;
+                Pairs.Reserve(Pending.Num());
+                for (int32 p = 0; p < Pending.Num(); ++p)
+                {
+                    if (p == 0 || Pending[p] != Pending[p - 1]) Pairs.Add(Pending[p]);
+                }
+
+                const double h = Current.et - Previous.et;
+                const bool bFirst = k == 1;
+                const bool bLast = k == NumSteps;
+
+                ForEachBatch(Pairs.Num(), BatchSize, [&](int32 Begin, int32 End)
+                {
+                    TArray<FConjunction> Local;
+                    for (int32 p = Begin; p < End; ++p)
+                    {
+                        const int32 i = int32(Pairs[p] >> 32);
+                        const int32 j = int32(Pairs[p] & 0xFFFFFFFFull);
+                        if (!Previous.Valid[i] || !Previous.Valid[j] || !Current.Valid[i] || !Current.Valid[j])
+                        {
+                            continue;
+                        }
+
+                        double r0[6], r1[6];
+                        for (int32 n = 0; n < 6; ++n)
+                        {
+                            r0[n] = Previous.States[j * 6 + n] - Previous.States[i * 6 + n];
+                            r1[n] = Current.States[j * 6 + n] - Current.States[i * 6 + n];
+                        }
+
+                        double s, Distance, Speed;
+                        ClosestApproach(r0, r1, h, bFirst, bLast, s, Distance, Speed);
+                        if (Distance <= D)
+                        {
+                            FConjunction& Conjunction = Local.AddDefaulted_GetRef();
+                            Conjunction.Primary = i;
+                            Conjunction.Secondary = j;
+                            Conjunction.TCA = FSEphemerisTime(Previous.et + s * h);
+                            Conjunction.MissDistance = FSDistance(Distance);
+                            Conjunction.RelativeSpeed = FSSpeed(Speed);
+                        }
+                    }
+
+                    FScopeLock ScopeLock(&Lock);
+                    Conjunctions.Append(Local);
+                });
+            }
+
+            Swap(Pending, Found);
+            Swap(Previous, Current);
+        }
+
+        Conjunctions.Sort([](const FConjunction& a, const FConjunction& b)
+        {
+            if (a.TCA.seconds != b.TCA.seconds) return a.TCA.seconds < b.TCA.seconds;
+            if (a.Primary != b.Primary) return a.Primary < b.Primary;
+            return a.Secondary < b.Secondary;
+        });
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
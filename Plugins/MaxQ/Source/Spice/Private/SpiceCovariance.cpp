@@ -0,0 +1,143 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceCovariance.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Batched 6x6 state covariance propagation
+//
+// The 6x6 products run on VectorRegister4Double.  Row i of A * B is the sum
+// over k of A[i][k] * (row k of B), so each output row is two four-wide
+// accumulators, over columns 0..3 and 2..5.  The two overlap in columns 2
+// and 3, where they compute the same values in the same order, so both can
+// be stored unaligned with no masking or padding.
+//
+// Phi * P * Phi^T is (Phi * P) times the transpose of Phi, which is
+// transposed once into a local so both products are row-by-row.  The result
+// is symmetrized, since rounding leaves its two halves a few ulps apart.
+//
+// The covariances in a batch are independent, so batches are split across
+// worker threads.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceCovariance.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceCovariance.h"
+#include "SpiceUtilities.h"
+#include "Math/VectorRegister.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Covariance
+{
+    namespace
+    {
+        // Covariances per batch, per worker
+        constexpr int32 BatchSize = 256;
+
+        // Out = A * B.  Out must not be A or B.
+        FORCEINLINE void MultiplyRows(const double(&A)[6][6], const double(&B)[6][6], double(&Out)[6][6])
+        {
+            for (int32 i = 0; i < 6; ++i)
+            {
+                VectorRegister4Double a = VectorSetFloat1(A[i][0]);
+                VectorRegister4Double Lo = VectorMultiply(a, VectorLoad(&B[0][0]));
+                VectorRegister4Double Hi = VectorMultiply(a, VectorLoad(&B[0][2]));
+
+                for (int32 k = 1; k < 6; ++k)
+                {
+                    a = VectorSetFloat1(A[i][k]);
+                    Lo = VectorMultiplyAdd(a, VectorLoad(&B[k][0]), Lo);
+                    Hi = VectorMultiplyAdd(a, VectorLoad(&B[k][2]), Hi);
+                }
+
+                VectorStore(Hi, &Out[i][2]);
+                VectorStore(Lo, &Out[i][0]);
+            }
+        }
+
+        FORCEINLINE void Transpose(const double(&In)[6][6], double(&Out)[6][6])
+        {
+            for (int32 i = 0; i < 6; ++i)
+            {
+                for (int32 j = 0; j < 6; ++j)
+                {
+                    Out[j][i] = In[i][j];
+                }
+            }
+        }
+
+        // Result = Phi * P * Phi^T, given Phi^T
+        FORCEINLINE void TransformTransposed(const double(&Phi)[6][6], const double(&PhiT)[6][6], const double(&P)[6][6], double(&Result)[6][6])
+        {
+            double PhiP[6][6];
+            MultiplyRows(Phi, P, PhiP);
+
+            double Product[6][6];
+            MultiplyRows(PhiP, PhiT, Product);
+
+            for (int32 i = 0; i < 6; ++i)
+            {
+                Result[i][i] = Product[i][i];
+                for (int32 j = i + 1; j < 6; ++j)
+                {
+                    Result[i][j] = Result[j][i] = 0.5 * (Product[i][j] + Product[j][i]);
+                }
+            }
+        }
+    }
+
+
+    SPICE_API void Transform(const FStateMatrix& Phi, const FStateMatrix& P, FStateMatrix& Result)
+    {
+        double PhiT[6][6];
+        Transpose(Phi.m, PhiT);
+        TransformTransposed(Phi.m, PhiT, P.m, Result.m);
+    }
+
+    SPICE_API void Multiply(const FStateMatrix& A, const FStateMatrix& B, FStateMatrix& Result)
+    {
+        double Product[6][6];
+        MultiplyRows(A.m, B.m, Product);
+        FMemory::Memcpy(Result.m, Product, sizeof(Product));
+    }
+
+    SPICE_API void Propagate(TConstArrayView<FStateMatrix> Transitions, TArrayView<FStateMatrix> Covariances)
+    {
+        check(Transitions.Num() == Covariances.Num());
+
+        ForEachBatch(Covariances.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                Transform(Transitions[i], Covariances[i], Covariances[i]);
+            }
+        });
+    }
+
+    SPICE_API void Propagate(const FStateMatrix& Transition, TArrayView<FStateMatrix> Covariances)
+    {
+        double PhiT[6][6];
+        Transpose(Transition.m, PhiT);
+
+        ForEachBatch(Covariances.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                TransformTransposed(Transition.m, PhiT, Covariances[i].m, Covariances[i].m);
+            }
+        });
+    }
+};
@@ -23,6 +23,7 @@
 
 #include "SpiceData.h"
 #include "SpiceUtilities.h"
+#include "SpiceTime.h"
 #include "Misc/Paths.h"
 #include "HAL/FileManager.h"
 
@@ -185,6 +186,22 @@ namespace MaxQ::Data
     SPICE_API FSEphemerisTime Now()
     {
         auto now = FDateTime::UtcNow();
+
+        // With a leapseconds kernel loaded, account for TAI-UTC and TDB-TT (~69s as of 2017.)
+        MaxQ::Time::FUtcCalendar utc;
+        utc.Year = now.GetYear();
+        utc.Month = now.GetMonth();
+        utc.Day = now.GetDay();
+        utc.Hour = now.GetHour();
+        utc.Minute = now.GetMinute();
+        utc.Second = now.GetSecond() + now.GetMillisecond() / 1000.;
+
+        FSEphemerisTime et;
+        if (MaxQ::Time::UtcToEt(utc, et))
+        {
+            return et;
+        }
+
         auto j2000 = FDateTime::FromJulianDay(2451545.0);
         auto now_j2000 = now - j2000;
 
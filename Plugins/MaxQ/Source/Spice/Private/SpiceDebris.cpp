@@ -0,0 +1,325 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceDebris.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Debris clouds from explosions and collisions, in bulk
+//
+// The breakup model's distributions, with lambda = log10(Lc) and
+// chi = log10(A/M):
+// * Lc: N(>Lc) = k Lc^-beta, truncated to [MinLength, MaxLength], sampled
+//   by inverting its CDF
+// * chi, for Lc > 11cm: alpha N(mu1, sigma1) + (1 - alpha) N(mu2, sigma2),
+//   the parameters piecewise linear in lambda.  Below 8cm: N(mu, sigma),
+//   likewise.  In between, either, with the large-fragment distribution's
+//   probability rising linearly in lambda.
+// * Area: 0.540424 Lc^2 below 1.67mm, 0.556945 Lc^2.0047077 above
+// * log10(delta-v, m/s): N(0.2 chi + 1.85, 0.4) for explosions,
+//   N(0.9 chi + 2.9, 0.4) for collisions
+//
+// Each batch has its own FRandomStream, seeded from Seed and the batch's
+// index.  The batches are fixed, so the fragments don't depend on how the
+// batches are spread across threads.
+//
+// ToTles() takes osculating elements as mean elements.  The mean motion is
+// the osculating semi-major axis's, sqrt(mu / a^3), in radians/minute, and
+// B* = Cd (A/M) rho0 / 2, with SGP4's reference density rho0 =
+// 0.15696615 kg/m^2/ER.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceDebris.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceDebris.h"
+#include "SpiceUtilities.h"
+#include "SpiceTeme.h"
+#include "Math/RandomStream.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Debris
+{
+    namespace
+    {
+        // Fragments per batch, per worker
+        constexpr int32 BatchSize = 1024;
+
+        constexpr double ExplosionExponent = 1.6;
+        constexpr double CollisionExponent = 1.71;
+
+        // SGP4's reference density, times an Earth radius (kg/m^2/ER)
+        constexpr double Rho0 = 0.15696615;
+
+        // Piecewise linear in x: y0 below x0, y1 above x1
+        double Ramp(double x, double x0, double y0, double x1, double y1)
+        {
+            return x <= x0 ? y0 : x >= x1 ? y1 : y0 + (y1 - y0) * (x - x0) / (x1 - x0);
+        }
+
+        double Normal(FRandomStream& Stream, double Mean, double Sigma)
+        {
+            // Box-Muller, on (0, 1] so the log is finite
+            const double u1 = 1. - Stream.GetFraction();
+            const double u2 = Stream.GetFraction();
+            return Mean + Sigma * FMath::Sqrt(-2. * FMath::Loge(u1)) * FMath::Cos(2. * UE_DOUBLE_PI * u2);
+        }
+
+        // log10(A/M) for a spacecraft fragment with lambda = log10(Lc)
+        double SampleAreaToMass(FRandomStream& Stream, double Lambda)
+        {
+            constexpr double Small = -1.09691;      // log10(0.08)
+            constexpr double Large = -0.958607;     // log10(0.11)
+
+            const bool bLarge = Lambda >= Large || (Lambda > Small && Stream.GetFraction() < (Lambda - Small) / (Large - Small));
+            if (!bLarge)
+            {
+                const double Mean = Ramp(Lambda, -1.75, -0.3, -1.25, -1.0);
+                const double Sigma = Lambda <= -3.5 ? 0.2 : 0.2 + 0.1333 * (Lambda + 3.5);
+                return Normal(Stream, Mean, Sigma);
+            }
+
+            const double Alpha = Ramp(Lambda, -1.95, 0., 0.55, 1.);
+            if (Stream.GetFraction() < Alpha)
+            {
+                return Normal(Stream, Ramp(Lambda, -1.1, -0.6, 0., -0.95), Ramp(Lambda, -1.3, 0.1, -0.3, 0.3));
+            }
+            return Normal(Stream, Ramp(Lambda, -0.7, -1.2, -0.1, -2.0), Ramp(Lambda, -0.5, 0.5, -0.3, 0.3));
+        }
+
+        // Uniform on the unit sphere
+        void SampleDirection(FRandomStream& Stream, double(&Direction)[3])
+        {
+            const double z = 2. * Stream.GetFraction() - 1.;
+            const double Phi = 2. * UE_DOUBLE_PI * Stream.GetFraction();
+            const double r = FMath::Sqrt(FMath::Max(0., 1. - z * z));
+            Direction[0] = r * FMath::Cos(Phi);
+            Direction[1] = r * FMath::Sin(Phi);
+            Direction[2] = z;
+        }
+
+        // N(>Lc) = Coefficient * Lc^-Exponent
+        void PowerLaw(const FBreakup& Breakup, double& Coefficient, double& Exponent)
+        {
+            if (Breakup.Type == EBreakup::Explosion)
+            {
+                Coefficient = 6. * Breakup.Scale;
+                Exponent = ExplosionExponent;
+            }
+            else
+            {
+                Coefficient = 0.1 * FMath::Pow(Breakup.Mass, 0.75);
+                Exponent = CollisionExponent;
+            }
+        }
+    }
+
+
+    void FFragments::Reset()
+    {
+        Length.Reset();
+        AreaToMass.Reset();
+        Area.Reset();
+        Mass.Reset();
+        DeltaV.Reset();
+        States.Reset();
+    }
+
+
+    SPICE_API int32 NumFragments(const FBreakup& Breakup)
+    {
+        if (Breakup.MinLength <= 0. || Breakup.MaxLength <= Breakup.MinLength)
+        {
+            return 0;
+        }
+
+        double Coefficient, Exponent;
+        PowerLaw(Breakup, Coefficient, Exponent);
+        const double Count = Coefficient * (FMath::Pow(Breakup.MinLength, -Exponent) - FMath::Pow(Breakup.MaxLength, -Exponent));
+        return FMath::Max(0, (int32)FMath::Min(FMath::RoundToDouble(Count), (double)MAX_int32));
+    }
+
+
+    SPICE_API bool Generate(
+        const FBreakup& Breakup,
+        const FSStateVector& Parent,
+        FFragments& Fragments,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        Fragments.Reset();
+
+        if (Breakup.MinLength <= 0. || Breakup.MaxLength <= Breakup.MinLength)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Debris: lengths %f to %f m are not a positive range"), Breakup.MinLength, Breakup.MaxLength));
+        }
+        if (Breakup.Type == EBreakup::Explosion ? Breakup.Scale <= 0. : Breakup.Mass <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, Breakup.Type == EBreakup::Explosion ? TEXT("MaxQ::Debris: explosion scale is not positive") : TEXT("MaxQ::Debris: collision mass is not positive"));
+        }
+
+        int32 Count = NumFragments(Breakup);
+        if (Breakup.MaxFragments > 0)
+        {
+            Count = FMath::Min(Count, Breakup.MaxFragments);
+        }
+
+        Fragments.Length.SetNumUninitialized(Count);
+        Fragments.AreaToMass.SetNumUninitialized(Count);
+        Fragments.Area.SetNumUninitialized(Count);
+        Fragments.Mass.SetNumUninitialized(Count);
+        Fragments.DeltaV.SetNumUninitialized(Count);
+        Fragments.States.SetNumUninitialized(Count);
+
+        double Coefficient, Exponent;
+        PowerLaw(Breakup, Coefficient, Exponent);
+        const double MinPower = FMath::Pow(Breakup.MinLength, -Exponent);
+        const double MaxPower = FMath::Pow(Breakup.MaxLength, -Exponent);
+        const bool bExplosion = Breakup.Type == EBreakup::Explosion;
+
+        double ParentState[6];
+        Parent.CopyTo(ParentState);
+
+        ForEachBatch(Count, BatchSize, [&](int32 Begin, int32 End)
+        {
+            FRandomStream Stream((int32)(Breakup.Seed + 0x9E3779B9u * (uint32)(Begin / BatchSize + 1)));
+
+            for (int32 i = Begin; i < End; ++i)
+            {
+                const double Length = FMath::Pow(MinPower - Stream.GetFraction() * (MinPower - MaxPower), -1. / Exponent);
+                const double Chi = SampleAreaToMass(Stream, FMath::LogX(10., Length));
+                const double AreaToMass = FMath::Pow(10., Chi);
+                const double Area = Length < 0.00167 ? 0.540424 * Length * Length : 0.556945 * FMath::Pow(Length, 2.0047077);
+
+                // m/s, to km/s
+                const double Mean = bExplosion ? 0.2 * Chi + 1.85 : 0.9 * Chi + 2.9;
+                const double DeltaV = FMath::Pow(10., Normal(Stream, Mean, 0.4)) / 1000.;
+                double Direction[3];
+                SampleDirection(Stream, Direction);
+
+                double State[6];
+                FMemory::Memcpy(State, ParentState, sizeof(State));
+                State[3] += DeltaV * Direction[0];
+                State[4] += DeltaV * Direction[1];
+                State[5] += DeltaV * Direction[2];
+
+                Fragments.Length[i] = Length;
+                Fragments.AreaToMass[i] = AreaToMass;
+                Fragments.Area[i] = Area;
+                Fragments.Mass[i] = Area / AreaToMass;
+                Fragments.DeltaV[i] = DeltaV;
+                Fragments.States[i] = FSStateVector(State);
+            }
+        });
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ToConics(
+        const FFragments& Fragments,
+        const FSEphemerisTime& et,
+        const FSMassConstant& mu,
+        Conics::FConicBatch& Orbits,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        TArray<FSConicElements> Elements;
+        Elements.SetNum(Fragments.Num());
+
+        if (!Conics::Osculate(Fragments.States, et, mu, Elements, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        return Orbits.Add(Elements, ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ToTles(
+        const FFragments& Fragments,
+        const FSEphemerisTime& et,
+        const FString& frame,
+        Sgp4::FTleBatch& Satellites,
+        TArrayView<bool> Added,
+        double DragCoefficient,
+        const FSMassConstant& mu,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Added.Num() == Fragments.Num());
+
+        const int32 Count = Fragments.Num();
+
+        Covariance::FStateMatrix ToTeme;
+        if (!Teme::FromFrame(et, frame, ToTeme, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        TArray<FSStateVector> States;
+        States.SetNumUninitialized(Count);
+        Teme::Transform(ToTeme, Fragments.States, States);
+
+        // Degenerate states are left with a zero periapsis, and skipped below
+        TArray<FSConicElements> Elements;
+        Elements.SetNum(Count);
+        Conics::Osculate(States, et, mu, Elements);
+
+        // Only bound orbits have a mean motion
+        TArray<double> Flat;
+        TArray<int32> Bound;
+        Flat.Reserve(Count * Sgp4::FTleBatch::NumElements);
+        Bound.Reserve(Count);
+
+        for (int32 i = 0; i < Count; ++i)
+        {
+            Added[i] = false;
+
+            double elts[8];
+            Elements[i].CopyTo(elts);
+            const double rp = elts[0], e = elts[1];
+            if (rp <= 0. || e >= 1.)
+            {
+                continue;
+            }
+
+            const double a = rp / (1. - e);
+            const double MeanMotion = FMath::Sqrt(mu.GM / (a * a * a)) * 60.;
+            const double Bstar = 0.5 * DragCoefficient * Fragments.AreaToMass[i] * Rho0;
+
+            // As getelm: NDT2O, NDD6O, BSTAR, INCL, NODE0, ECC, OMEGA, M0, N0, EPOCH
+            const double Tle[Sgp4::FTleBatch::NumElements] = { 0., 0., Bstar, elts[2], elts[3], e, elts[4], elts[5], MeanMotion, et.seconds };
+            Flat.Append(Tle, Sgp4::FTleBatch::NumElements);
+            Bound.Add(i);
+        }
+
+        TArray<bool> BoundAdded;
+        BoundAdded.SetNumZeroed(Bound.Num());
+        if (!Satellites.Add(Flat, BoundAdded, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        for (int32 j = 0; j < Bound.Num(); ++j)
+        {
+            Added[Bound[j]] = BoundAdded[j];
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,501 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceGravity.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Spherical-harmonic gravity fields
+//
+// The potential is evaluated with Cunningham's recursion (Montenbruck &
+// Gill, 3.2), in fully normalized form.  With U = V + iW, where
+//   Unm = (R / r)^(n+1) * Pnm(sin(lat)) * e^(i m lon)
+// is a solid harmonic in Cartesian coordinates, the normalized terms come
+// from two recurrences that need no trigonometry and stay well scaled to
+// high degree: the sectorial terms (m, m) from (m-1, m-1), and each
+// column (n, m) from (n-1, m) and (n-2, m).
+//
+// Derivatives come from the ladder operators D+ = d/dx + i d/dy,
+// D- = d/dx - i d/dy and d/dz, each of which takes Unm to a multiple of a
+// term of one higher degree:
+//   D+ Unm = -U(n+1, m+1)
+//   D- Unm = (n-m+2)(n-m+1) * U(n+1, m-1)
+//   dz Unm = -(n-m+1) * U(n+1, m)
+// with U(n, -k) = (-1)^k (n-k)! / (n+k)! * conj(U(n, k)).  The
+// acceleration is three of these operators, and the gradient six
+// products of two, so the field is summed once per operator, over terms to
+// degree + 1 (or + 2, for gradients).  Tabulate() folds each operator's
+// multiple and the ratio of normalizations into one factor per term.
+//
+// The recursion and sums are the same code over one double or a
+// VectorRegister4Double of four positions.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceGravity.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceGravity.h"
+#include "SpiceUtilities.h"
+#include "Misc/FileHelper.h"
+#include "Math/VectorRegister.h"
+#include <cmath>
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Gravity
+{
+    namespace
+    {
+        // Positions per batch, per worker (a multiple of the SIMD width)
+        constexpr int32 BatchSize = 32;
+        constexpr int32 Lanes = 4;
+
+        // D+, D-, dz for the acceleration, then D+D+, D+D-, D-D-, dzD+,
+        // dzD-, dzdz for the gradient
+        constexpr int32 AccelerationOperators = 3;
+        constexpr int32 GradientOperators = 9;
+
+        // x, y, z scaled by R / r^2, then (R / r)^2 and R / r
+        constexpr int32 ScaledSize = 5;
+
+        // Recursion terms a single position's sums keep on the stack, rather
+        // than the heap: Index(Degree + 3, 0), to degree 20
+        constexpr int32 InlineTerms = 23 * 24 / 2;
+
+        template<typename T> T Splat(double x);
+        template<> inline double Splat<double>(double x) { return x; }
+        template<> inline VectorRegister4Double Splat<VectorRegister4Double>(double x) { return VectorSetFloat1(x); }
+
+        inline double Multiply(double a, double b) { return a * b; }
+        inline double MultiplyAdd(double a, double b, double c) { return a * b + c; }
+        inline double NegateMultiplyAdd(double a, double b, double c) { return c - a * b; }
+
+        inline VectorRegister4Double Multiply(const VectorRegister4Double& a, const VectorRegister4Double& b) { return VectorMultiply(a, b); }
+        inline VectorRegister4Double MultiplyAdd(const VectorRegister4Double& a, const VectorRegister4Double& b, const VectorRegister4Double& c) { return VectorMultiplyAdd(a, b, c); }
+        inline VectorRegister4Double NegateMultiplyAdd(const VectorRegister4Double& a, const VectorRegister4Double& b, const VectorRegister4Double& c) { return VectorNegateMultiplyAdd(a, b, c); }
+
+        // log of the normalization of degree n, order m
+        double LogNormalization(int32 n, int32 m)
+        {
+            return 0.5 * (FMath::Loge(m == 0 ? 1. : 2.) + FMath::Loge(2. * n + 1.) + std::lgamma(n - m + 1.) - std::lgamma(n + m + 1.));
+        }
+
+        void Scale(const FSDistanceVector& Position, double R, double* Scaled)
+        {
+            double r[3];
+            Position.CopyTo(r);
+            const double r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+            const double k = R / r2;
+            Scaled[0] = k * r[0];
+            Scaled[1] = k * r[1];
+            Scaled[2] = k * r[2];
+            Scaled[3] = k * R;
+            Scaled[4] = R / FMath::Sqrt(r2);
+        }
+
+        // Combines the operator sums into the acceleration and gradient
+        void Combine(const double* Re, const double* Im, double ka, double kg, FAcceleration& a, FGradient* Gradient)
+        {
+            a.a[0] = ka * 0.5 * (Re[0] + Re[1]);
+            a.a[1] = ka * 0.5 * (Im[0] - Im[1]);
+            a.a[2] = ka * Re[2];
+
+            if (Gradient)
+            {
+                double(&g)[3][3] = Gradient->m;
+                g[0][0] = kg * 0.25 * (Re[3] + 2. * Re[4] + Re[5]);
+                g[1][1] = -kg * 0.25 * (Re[3] - 2. * Re[4] + Re[5]);
+                g[2][2] = kg * Re[8];
+                g[0][1] = g[1][0] = kg * 0.25 * (Im[3] - Im[5]);
+                g[0][2] = g[2][0] = kg * 0.5 * (Re[6] + Re[7]);
+                g[1][2] = g[2][1] = kg * 0.5 * (Im[6] - Im[7]);
+            }
+        }
+    }
+
+
+    bool FGravityField::Load(
+        const FString& file,
+        int32 maxDegree,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        *this = FGravityField();
+
+        TArray<FString> Lines;
+        if (!FFileHelper::LoadFileToStringArray(Lines, *toPath(file)))
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: couldn't read %s"), *file));
+        }
+
+        // Header keywords, up to end_of_head, then "gfc n m C S ..." lines.
+        // Time-variable terms (gfct's trnd, acos and asin lines) are left
+        // at their reference epoch.
+        double FileGM = 0., FileRadius = 0.;
+        int32 FileDegree = -1;
+        bool bHead = true;
+        bool bNormalized = true;
+        TArray<double> FileC, FileS;
+        TArray<FString> Tokens;
+
+        auto Number = [](FString Token)
+        {
+            // Fortran exponents
+            Token.ReplaceCharInline(TEXT('D'), TEXT('E'), ESearchCase::IgnoreCase);
+            return FCString::Atod(*Token);
+        };
+
+        for (const FString& Line : Lines)
+        {
+            if (Line.ParseIntoArrayWS(Tokens) == 0)
+            {
+                continue;
+            }
+
+            const FString& Key = Tokens[0];
+            if (bHead)
+            {
+                if (Key.Equals(TEXT("end_of_head"), ESearchCase::IgnoreCase))
+                {
+                    bHead = false;
+                    if (FileGM <= 0. || FileRadius <= 0. || FileDegree < 0)
+                    {
+                        return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: %s has no earth_gravity_constant, radius or max_degree"), *file));
+                    }
+                    if (!bNormalized)
+                    {
+                        return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: %s isn't fully normalized"), *file));
+                    }
+
+                    FileDegree = maxDegree > 0 ? FMath::Min(FileDegree, maxDegree) : FileDegree;
+                    FileC.SetNumZeroed(Index(FileDegree + 1, 0));
+                    FileS.SetNumZeroed(Index(FileDegree + 1, 0));
+                }
+                else if (Tokens.Num() >= 2)
+                {
+                    if (Key.Equals(TEXT("earth_gravity_constant"), ESearchCase::IgnoreCase) || Key.Equals(TEXT("gravity_constant"), ESearchCase::IgnoreCase))
+                    {
+                        // m^3/s^2
+                        FileGM = Number(Tokens[1]) * 1e-9;
+                    }
+                    else if (Key.Equals(TEXT("radius"), ESearchCase::IgnoreCase))
+                    {
+                        // m
+                        FileRadius = Number(Tokens[1]) * 1e-3;
+                    }
+                    else if (Key.Equals(TEXT("max_degree"), ESearchCase::IgnoreCase))
+                    {
+                        FileDegree = FCString::Atoi(*Tokens[1]);
+                    }
+                    else if (Key.Equals(TEXT("norm"), ESearchCase::IgnoreCase))
+                    {
+                        bNormalized = !Tokens[1].Equals(TEXT("unnormalized"), ESearchCase::IgnoreCase);
+                    }
+                }
+                continue;
+            }
+
+            if ((Key.Equals(TEXT("gfc"), ESearchCase::IgnoreCase) || Key.Equals(TEXT("gfct"), ESearchCase::IgnoreCase)) && Tokens.Num() >= 5)
+            {
+                const int32 n = FCString::Atoi(*Tokens[1]);
+                const int32 m = FCString::Atoi(*Tokens[2]);
+                if (m < 0 || m > n)
+                {
+                    return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: %s has a coefficient of degree %d, order %d"), *file, n, m));
+                }
+                if (n <= FileDegree)
+                {
+                    FileC[Index(n, m)] = Number(Tokens[3]);
+                    FileS[Index(n, m)] = Number(Tokens[4]);
+                }
+            }
+        }
+
+        if (bHead)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: %s isn't an ICGEM gravity field (no end_of_head)"), *file));
+        }
+
+        return Set(FSMassConstant(FileGM), FSDistance(FileRadius), FileDegree, FileC, FileS, ResultCode, ErrorMessage);
+    }
+
+
+    bool FGravityField::Set(
+        const FSMassConstant& InGM,
+        const FSDistance& ReferenceRadius,
+        int32 degree,
+        TConstArrayView<double> InC,
+        TConstArrayView<double> InS,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        *this = FGravityField();
+
+        if (InGM.GM <= 0. || ReferenceRadius.km <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Gravity: GM and the reference radius must be positive"));
+        }
+
+        if (degree < 0 || InC.Num() != Index(degree + 1, 0) || InS.Num() != InC.Num())
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Gravity: degree %d needs %d coefficients"), degree, Index(degree + 1, 0)));
+        }
+
+        Degree = degree;
+        GM = InGM.GM;
+        R = ReferenceRadius.km;
+        C.Append(InC.GetData(), InC.Num());
+        S.Append(InS.GetData(), InS.Num());
+        for (int32 n = 0; n <= Degree; ++n)
+        {
+            S[Index(n, 0)] = 0.;
+        }
+
+        Tabulate();
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    void FGravityField::Tabulate()
+    {
+        const int32 Top = Degree + 2;
+
+        ColumnA.SetNumZeroed(Index(Top + 1, 0));
+        ColumnB.SetNumZeroed(Index(Top + 1, 0));
+        Sectorial.SetNumZeroed(Top + 1);
+
+        for (int32 m = 1; m <= Top; ++m)
+        {
+            Sectorial[m] = m == 1 ? FMath::Sqrt(3.) : FMath::Sqrt((2. * m + 1.) / (2. * m));
+        }
+
+        for (int32 m = 0; m <= Top; ++m)
+        {
+            for (int32 n = m + 1; n <= Top; ++n)
+            {
+                ColumnA[Index(n, m)] = FMath::Sqrt((2. * n + 1.) * (2. * n - 1.) / ((n - m) * double(n + m)));
+                if (n >= m + 2)
+                {
+                    ColumnB[Index(n, m)] = FMath::Sqrt((2. * n + 1.) * (n + m - 1.) * (n - m - 1.) / ((2. * n - 3.) * (n + m) * double(n - m)));
+                }
+            }
+        }
+
+        Terms.SetNum(Index(Degree + 1, 0) * GradientOperators);
+
+        for (int32 n = 0; n <= Degree; ++n)
+        {
+            for (int32 m = 0; m <= n; ++m)
+            {
+                // Each operator's multiple, and the order and degree it goes to
+                const double k = n - m;
+                const struct { double Multiple; int32 Degree; int32 Order; } Operators[GradientOperators] = {
+                    { -1., n + 1, m + 1 },
+                    { (k + 2.) * (k + 1.), n + 1, m - 1 },
+                    { -(k + 1.), n + 1, m },
+                    { 1., n + 2, m + 2 },
+                    { -(k + 2.) * (k + 1.), n + 2, m },
+                    { (k + 4.) * (k + 3.) * (k + 2.) * (k + 1.), n + 2, m - 2 },
+                    { k + 1., n + 2, m + 1 },
+                    { -(k + 3.) * (k + 2.) * (k + 1.), n + 2, m - 1 },
+                    { (k + 2.) * (k + 1.), n + 2, m }
+                };
+
+                for (int32 o = 0; o < GradientOperators; ++o)
+                {
+                    const int32 To = Operators[o].Degree;
+                    const int32 Order = FMath::Abs(Operators[o].Order);
+
+                    // From the normalized (n, m) to the normalized (To, Order),
+                    // through the unnormalized terms
+                    double LogFactor = LogNormalization(n, m) - LogNormalization(To, Order) + FMath::Loge(FMath::Abs(Operators[o].Multiple));
+                    double Sign = Operators[o].Multiple < 0. ? -1. : 1.;
+
+                    const bool bNegative = Operators[o].Order < 0;
+                    if (bNegative)
+                    {
+                        LogFactor += std::lgamma(To - Order + 1.) - std::lgamma(To + Order + 1.);
+                        Sign *= (Order & 1) ? -1. : 1.;
+                    }
+
+                    FTerm& Term = Terms[Index(n, m) * GradientOperators + o];
+                    Term.Index = Index(To, Order);
+                    Term.Factor = Sign * FMath::Exp(LogFactor);
+                    Term.bConjugate = bNegative;
+                }
+            }
+        }
+    }
+
+
+    template<typename T>
+    void FGravityField::Sum(const T* Scaled, int32 Operators, int32 minDegree, T* V, T* W, T* Re, T* Im) const
+    {
+        const T& x = Scaled[0];
+        const T& y = Scaled[1];
+        const T& z = Scaled[2];
+        const T& rho = Scaled[3];
+        const T Zero = Splat<T>(0.);
+        const int32 Top = Degree + (Operators == GradientOperators ? 2 : 1);
+
+        V[0] = Scaled[4];
+        W[0] = Zero;
+
+        for (int32 m = 0; m <= Top; ++m)
+        {
+            const int32 mm = Index(m, m);
+            if (m > 0)
+            {
+                const int32 p = Index(m - 1, m - 1);
+                const T c = Splat<T>(Sectorial[m]);
+                V[mm] = Multiply(c, NegateMultiplyAdd(y, W[p], Multiply(x, V[p])));
+                W[mm] = Multiply(c, MultiplyAdd(y, V[p], Multiply(x, W[p])));
+            }
+
+            if (m < Top)
+            {
+                const int32 i = Index(m + 1, m);
+                const T az = Multiply(Splat<T>(ColumnA[i]), z);
+                V[i] = Multiply(az, V[mm]);
+                W[i] = Multiply(az, W[mm]);
+            }
+
+            for (int32 n = m + 2; n <= Top; ++n)
+            {
+                const int32 i = Index(n, m);
+                const int32 i1 = Index(n - 1, m);
+                const int32 i2 = Index(n - 2, m);
+                const T az = Multiply(Splat<T>(ColumnA[i]), z);
+                const T brho = Multiply(Splat<T>(ColumnB[i]), rho);
+                V[i] = NegateMultiplyAdd(brho, V[i2], Multiply(az, V[i1]));
+                W[i] = NegateMultiplyAdd(brho, W[i2], Multiply(az, W[i1]));
+            }
+        }
+
+        for (int32 o = 0; o < Operators; ++o)
+        {
+            Re[o] = Zero;
+            Im[o] = Zero;
+        }
+
+        // (C - iS) * Factor * (V + iW), with W negated for conjugates
+        for (int32 n = FMath::Max(minDegree, 0); n <= Degree; ++n)
+        {
+            for (int32 m = 0; m <= n; ++m)
+            {
+                const int32 k = Index(n, m);
+                if (C[k] == 0. && S[k] == 0.)
+                {
+                    continue;
+                }
+
+                const FTerm* Term = &Terms[k * GradientOperators];
+                for (int32 o = 0; o < Operators; ++o)
+                {
+                    const double Conjugate = Term[o].bConjugate ? -1. : 1.;
+                    const double fc = Term[o].Factor * C[k];
+                    const double fs = Term[o].Factor * S[k];
+                    const T& Vt = V[Term[o].Index];
+                    const T& Wt = W[Term[o].Index];
+
+                    Re[o] = MultiplyAdd(Splat<T>(fc), Vt, MultiplyAdd(Splat<T>(fs * Conjugate), Wt, Re[o]));
+                    Im[o] = MultiplyAdd(Splat<T>(fc * Conjugate), Wt, NegateMultiplyAdd(Splat<T>(fs), Vt, Im[o]));
+                }
+            }
+        }
+    }
+
+
+    void FGravityField::Acceleration(const FSDistanceVector& r, FAcceleration& a, FGradient* Gradient, int32 minDegree) const
+    {
+        check(IsValid());
+
+        const int32 Operators = Gradient ? GradientOperators : AccelerationOperators;
+        TArray<double, TInlineAllocator<InlineTerms>> V, W;
+        V.SetNumUninitialized(Index(Degree + 3, 0));
+        W.SetNumUninitialized(V.Num());
+
+        double Scaled[ScaledSize], Re[GradientOperators], Im[GradientOperators];
+        Scale(r, R, Scaled);
+        Sum(Scaled, Operators, minDegree, V.GetData(), W.GetData(), Re, Im);
+        Combine(Re, Im, GM / (R * R), GM / (R * R * R), a, Gradient);
+    }
+
+
+    void FGravityField::Acceleration(
+        TConstArrayView<FSDistanceVector> Positions,
+        TArrayView<FAcceleration> Accelerations,
+        TArrayView<FGradient> Gradients,
+        int32 minDegree
+    ) const
+    {
+        check(IsValid());
+        check(Accelerations.Num() == Positions.Num());
+        check(Gradients.Num() == 0 || Gradients.Num() == Positions.Num());
+
+        const bool bGradients = Gradients.Num() > 0;
+        const int32 Operators = bGradients ? GradientOperators : AccelerationOperators;
+        const double ka = GM / (R * R);
+        const double kg = ka / R;
+
+        ForEachBatch(Positions.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            TArray<VectorRegister4Double> V, W;
+            V.SetNumUninitialized(Index(Degree + 3, 0));
+            W.SetNumUninitialized(V.Num());
+
+            int32 i = Begin;
+            for (; i + Lanes <= End; i += Lanes)
+            {
+                // Transposed: component-major, then lane
+                double Scaled[ScaledSize][Lanes];
+                for (int32 Lane = 0; Lane < Lanes; ++Lane)
+                {
+                    double s[ScaledSize];
+                    Scale(Positions[i + Lane], R, s);
+                    for (int32 j = 0; j < ScaledSize; ++j) Scaled[j][Lane] = s[j];
+                }
+
+                VectorRegister4Double Registers[ScaledSize], Re[GradientOperators], Im[GradientOperators];
+                for (int32 j = 0; j < ScaledSize; ++j) Registers[j] = VectorLoad(Scaled[j]);
+
+                Sum(Registers, Operators, minDegree, V.GetData(), W.GetData(), Re, Im);
+
+                double LaneRe[GradientOperators][Lanes], LaneIm[GradientOperators][Lanes];
+                for (int32 o = 0; o < Operators; ++o)
+                {
+                    VectorStore(Re[o], LaneRe[o]);
+                    VectorStore(Im[o], LaneIm[o]);
+                }
+
+                for (int32 Lane = 0; Lane < Lanes; ++Lane)
+                {
+                    double re[GradientOperators], im[GradientOperators];
+                    for (int32 o = 0; o < Operators; ++o)
+                    {
+                        re[o] = LaneRe[o][Lane];
+                        im[o] = LaneIm[o][Lane];
+                    }
+                    Combine(re, im, ka, kg, Accelerations[i + Lane], bGradients ? &Gradients[i + Lane] : nullptr);
+                }
+            }
+
+            for (; i < End; ++i)
+            {
+                Acceleration(Positions[i], Accelerations[i], bGradients ? &Gradients[i] : nullptr, minDegree);
+            }
+        });
+    }
+};
@@ -0,0 +1,345 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceHybrid.cpp
+//
+// Implementation Comments
+//
+// Purpose:  One vehicle's trajectory, across TLEs, conics and maneuvers
+//
+// SegmentBegin is the segments' Begin epochs, ascending, for the binary
+// search.  Each segment's model is a one-satellite FTleBatch or a one-orbit
+// FConicBatch, which do the TLE and conic setup once, or the force model
+// that was current when it was appended.
+//
+// The batch Evaluate() sorts the epochs that fall in Numerical segments, so
+// each segment's epochs are a run, and integrates each run in one
+// Propagate() call from the segment's Begin.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceHybrid.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceHybrid.h"
+#include "SpiceUtilities.h"
+#include "SpiceTeme.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Hybrid
+{
+    namespace
+    {
+        // The Earth's, from DE431 (gm_de431.tpc)
+        constexpr double EarthGM = 398600.435436;
+    }
+
+
+    FTrajectory::FTrajectory()
+        : FTrajectory(TEXT("J2000"), FSMassConstant(EarthGM))
+    {
+    }
+
+    FTrajectory::FTrajectory(const FString& frame, const FSMassConstant& mu)
+        : Frame(frame)
+        , GM(mu)
+    {
+    }
+
+    void FTrajectory::Reset()
+    {
+        Segments.Reset();
+        SegmentBegin.Reset();
+        Models.Reset();
+    }
+
+    void FTrajectory::SetForceModel(const Propagator::FForceModel& Model, const Propagator::FSettings& Settings)
+    {
+        TSharedRef<FNumerical> Numerical = MakeShared<FNumerical>();
+        Numerical->Model = Model;
+        Numerical->Settings = Settings;
+        ForceModel = Numerical;
+    }
+
+    bool FTrajectory::AddTle(const FSEphemerisTime& et, const FSTwoLineElements& Elements, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        return AddSatellite(et, Elements, MakeShared<Sgp4::FTleBatch>(), ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::AddTle(const FSEphemerisTime& et, const FSTwoLineElements& Elements, const FSTLEGeophysicalConstants& geophs, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        return AddSatellite(et, Elements, MakeShared<Sgp4::FTleBatch>(geophs), ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::AddSatellite(const FSEphemerisTime& et, const FSTwoLineElements& Elements, const TSharedRef<Sgp4::FTleBatch>& Satellite, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        if (!Satellite->Add(Elements, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        FSegment Segment;
+        Segment.Type = ESegment::Tle;
+        Segment.Begin = et;
+        Segment.Tle = Elements;
+        if (!Teme::Evaluate(*Satellite, et, Frame, TArrayView<FSStateVector>(&Segment.State, 1), {}, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        FModel Model;
+        Model.Satellite = Satellite;
+        Append(MoveTemp(Segment), MoveTemp(Model));
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::AddState(const FSEphemerisTime& et, const FSStateVector& State, ESegment Type, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        FSegment Segment;
+        Segment.Type = Type;
+        Segment.Begin = et;
+        Segment.State = State;
+
+        FModel Model;
+        if (Type == ESegment::Conic)
+        {
+            if (!Conics::Osculate(TConstArrayView<FSStateVector>(&State, 1), et, GM, TArrayView<FSConicElements>(&Segment.Elements, 1), ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            TSharedRef<Conics::FConicBatch> Orbit = MakeShared<Conics::FConicBatch>();
+            if (!Orbit->Add(Segment.Elements, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+            Model.Orbit = Orbit;
+        }
+        else if (Type == ESegment::Numerical)
+        {
+            if (!ForceModel.IsValid())
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Hybrid: there's no force model for a numerical segment"));
+            }
+            if (!ForceModel->Model.Frame.Equals(Frame, ESearchCase::IgnoreCase))
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Hybrid: the force model is in %s, not %s"), *ForceModel->Model.Frame, *Frame));
+            }
+            Model.Numerical = ForceModel;
+        }
+        else
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Hybrid: a TLE segment can't start from a state"));
+        }
+
+        Append(MoveTemp(Segment), MoveTemp(Model));
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::Maneuver(const FSEphemerisTime& et, const FSVelocityVector& dv, ESegment Type, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        FSStateVector State;
+        if (!Evaluate(et, State, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        double s[6], v[3];
+        State.CopyTo(s);
+        dv.CopyTo(v);
+        for (int32 k = 0; k < 3; ++k)
+        {
+            s[k + 3] += v[k];
+        }
+
+        // A maneuver at a segment's own Begin starts from its state, which
+        // already includes its delta-v, so the two add up
+        double Total[3];
+        dv.CopyTo(Total);
+        const int32 Index = FindSegment(et);
+        if (Segments[Index].Begin.seconds == et.seconds)
+        {
+            double Earlier[3];
+            Segments[Index].DeltaV.CopyTo(Earlier);
+            for (int32 k = 0; k < 3; ++k)
+            {
+                Total[k] += Earlier[k];
+            }
+        }
+
+        if (!AddState(et, FSStateVector(s), Type, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        Segments.Last().DeltaV = FSVelocityVector(Total);
+
+        return true;
+    }
+
+    void FTrajectory::Append(FSegment&& Segment, FModel&& Model)
+    {
+        const int32 Keep = Algo::LowerBound(SegmentBegin, Segment.Begin.seconds);
+        Segments.SetNum(Keep);
+        SegmentBegin.SetNum(Keep);
+        Models.SetNum(Keep);
+
+        SegmentBegin.Add(Segment.Begin.seconds);
+        Segments.Add(MoveTemp(Segment));
+        Models.Add(MoveTemp(Model));
+    }
+
+    int32 FTrajectory::FindSegment(const FSEphemerisTime& et) const
+    {
+        if (Segments.Num() == 0)
+        {
+            return INDEX_NONE;
+        }
+
+        return FMath::Max(0, Algo::UpperBound(SegmentBegin, et.seconds) - 1);
+    }
+
+    bool FTrajectory::Evaluate(const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        return Evaluate(TConstArrayView<FSEphemerisTime>(&et, 1), TArrayView<FSStateVector>(&State, 1), ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(States.Num() == ets.Num());
+
+        if (Segments.Num() == 0)
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Hybrid: the trajectory is empty"));
+        }
+
+        // The first error, if any
+        ES_ResultCode Code = ES_ResultCode::Success;
+        bool bFailed = false;
+        FString Error;
+        auto Fail = [&](const FString& Message)
+        {
+            if (!bFailed)
+            {
+                bFailed = true;
+                Error = Message;
+            }
+        };
+
+        TArray<int32> Numerical;
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            const int32 Index = FindSegment(ets[i]);
+            const FSegment& Segment = Segments[Index];
+            const FModel& Model = Models[Index];
+            FString Message;
+
+            switch (Segment.Type)
+            {
+            case ESegment::Tle:
+                if (!Teme::Evaluate(*Model.Satellite, ets[i], Frame, States.Slice(i, 1), {}, &Code, &Message))
+                {
+                    Fail(Message);
+                }
+                break;
+
+            case ESegment::Conic:
+                if (!Model.Orbit->Evaluate(ets[i], States.Slice(i, 1), &Code, &Message))
+                {
+                    Fail(Message);
+                }
+                break;
+
+            case ESegment::Numerical:
+                if (ets[i].seconds < Segment.Begin.seconds)
+                {
+                    Fail(TEXT("MaxQ::Hybrid: epoch is before the trajectory begins"));
+                }
+                else
+                {
+                    Numerical.Add(i);
+                }
+                break;
+            }
+        }
+
+        // Segments are in order, so sorting by epoch groups them
+        Algo::Sort(Numerical, [&](int32 a, int32 b) { return ets[a].seconds < ets[b].seconds; });
+
+        TArray<FSEphemerisTime> RunEts;
+        TArray<FSStateVector> RunStates;
+        int32 First = 0;
+        while (First < Numerical.Num())
+        {
+            const int32 Index = FindSegment(ets[Numerical[First]]);
+            int32 Last = First + 1;
+            while (Last < Numerical.Num() && FindSegment(ets[Numerical[Last]]) == Index)
+            {
+                ++Last;
+            }
+
+            RunEts.Reset();
+            for (int32 j = First; j < Last; ++j)
+            {
+                RunEts.Add(ets[Numerical[j]]);
+            }
+            RunStates.SetNum(RunEts.Num());
+
+            const FSegment& Segment = Segments[Index];
+            const FNumerical& Model = *Models[Index].Numerical;
+            FString Message;
+            if (Propagator::Propagate(Model.Model, Model.Settings, Segment.State, Segment.Begin, RunEts, RunStates, {}, &Code, &Message))
+            {
+                for (int32 j = First; j < Last; ++j)
+                {
+                    States[Numerical[j]] = RunStates[j - First];
+                }
+            }
+            else
+            {
+                Fail(Message);
+            }
+
+            First = Last;
+        }
+
+        if (bFailed)
+        {
+            return Failed(ResultCode, ErrorMessage, Error);
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::Osculate(const FSEphemerisTime& et, FSConicElements& Elements, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        const int32 Index = FindSegment(et);
+        if (Index != INDEX_NONE && Segments[Index].Type == ESegment::Conic)
+        {
+            Elements = Segments[Index].Elements;
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+
+        FSStateVector State;
+        if (!Evaluate(et, State, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        return Conics::Osculate(TConstArrayView<FSStateVector>(&State, 1), et, GM, TArrayView<FSConicElements>(&Elements, 1), ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,575 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceLambert.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Lambert's problem, and porkchop plots built from it
+//
+// Izzo's formulation: the geometry reduces to one parameter, lambda, and the
+// time of flight to a non-dimensional T.  The unknown x (x < 1 ellipses,
+// x = 1 parabola, x > 1 hyperbolas) is found by Householder iteration on
+// T(x), which is evaluated with Battin's hypergeometric series close to the
+// parabola, Lagrange's equation a little further out, and Lancaster's
+// expression otherwise.
+//
+// For N revolutions, T(x) has a minimum; a time of flight below it has no
+// N-revolution solution, and above it has two, found from Izzo's left and
+// right starting guesses.
+//
+// The solver doesn't allocate, so porkchop cells can be solved in parallel
+// with nothing shared but the outputs.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceLambert.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceLambert.h"
+#include "SpiceUtilities.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Lambert
+{
+    namespace
+    {
+        // Porkchop cells per batch, per worker
+        constexpr int32 BatchSize = 256;
+
+        // Householder/Halley convergence, on x
+        constexpr double Tolerance = 1e-12;
+        constexpr int32 MaxIterations = 15;
+
+        // Which time of flight expression to use, by |x - 1|
+        constexpr double BattinRange = 0.01;
+        constexpr double LagrangeRange = 0.2;
+
+        // |r1^ x r2^| below this: r1 and r2 are (anti)parallel, and the
+        // transfer plane is undefined
+        constexpr double MinSinTransferAngle = 1e-12;
+
+        enum class EStatus : uint8
+        {
+            Solved,
+            NonPositiveTime,
+            ZeroPosition,
+            Collinear
+        };
+
+        inline double Dot(const double* a, const double* b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline double Norm(const double* a)
+        {
+            return FMath::Sqrt(Dot(a, a));
+        }
+
+        inline void Cross(const double* a, const double* b, double* out)
+        {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        struct FIzzo
+        {
+            double Lambda;
+            double Lambda2;
+            double Lambda3;
+
+            explicit FIzzo(double InLambda)
+                : Lambda(InLambda)
+                , Lambda2(InLambda * InLambda)
+                , Lambda3(InLambda * InLambda * InLambda)
+            {
+            }
+
+            static double Hypergeometric(double z)
+            {
+                double Sj = 1., Cj = 1.;
+                for (int32 j = 0; j < 1000; ++j)
+                {
+                    Cj = Cj * (3. + j) * (1. + j) / (2.5 + j) * z / (j + 1.);
+                    Sj += Cj;
+                    if (FMath::Abs(Cj) <= 1e-14) break;
+                }
+                return Sj;
+            }
+
+            double TimeOfFlightLagrange(double x, int32 N) const
+            {
+                const double a = 1. / (1. - x * x);
+                if (a > 0.)
+                {
+                    const double alpha = 2. * FMath::Acos(x);
+                    double beta = 2. * FMath::Asin(FMath::Sqrt(Lambda2 / a));
+                    if (Lambda < 0.) beta = -beta;
+                    return a * FMath::Sqrt(a) * ((alpha - FMath::Sin(alpha)) - (beta - FMath::Sin(beta)) + 2. * UE_DOUBLE_PI * N) / 2.;
+                }
+
+                const double alpha = 2. * acosh(x);
+                double beta = 2. * asinh(FMath::Sqrt(-Lambda2 / a));
+                if (Lambda < 0.) beta = -beta;
+                return -a * FMath::Sqrt(-a) * ((beta - sinh(beta)) - (alpha - sinh(alpha))) / 2.;
+            }
+
+            double TimeOfFlight(double x, int32 N) const
+            {
+                const double Distance = FMath::Abs(x - 1.);
+                if (Distance < LagrangeRange && Distance > BattinRange)
+                {
+                    return TimeOfFlightLagrange(x, N);
+                }
+
+                const double E = x * x - 1.;
+                const double rho = FMath::Abs(E);
+                const double z = FMath::Sqrt(1. + Lambda2 * E);
+
+                if (Distance < BattinRange)
+                {
+                    const double eta = z - Lambda * x;
+                    const double S1 = 0.5 * (1. - Lambda - x * eta);
+                    const double Q = 4. / 3. * Hypergeometric(S1);
+                    return (eta * eta * eta * Q + 4. * Lambda * eta) / 2. + N * UE_DOUBLE_PI / FMath::Pow(rho, 1.5);
+                }
+
+                const double y = FMath::Sqrt(rho);
+                const double g = x * z - Lambda * E;
+                double d;
+                if (E < 0.)
+                {
+                    d = N * UE_DOUBLE_PI + FMath::Acos(g);
+                }
+                else
+                {
+                    const double f = y * (z - Lambda * x);
+                    d = FMath::Loge(f + g);
+                }
+                return (x - Lambda * z - d / y) / E;
+            }
+
+            // First three derivatives of T(x)
+            void Derivatives(double x, double T, double& DT, double& DDT, double& DDDT) const
+            {
+                const double umx2 = 1. - x * x;
+                const double y = FMath::Sqrt(1. - Lambda2 * umx2);
+                const double y2 = y * y;
+                const double y3 = y2 * y;
+                DT = 1. / umx2 * (3. * T * x - 2. + 2. * Lambda3 * x / y);
+                DDT = 1. / umx2 * (3. * T + 5. * x * DT + 2. * (1. - Lambda2) * Lambda3 / y3);
+                DDDT = 1. / umx2 * (7. * x * DDT + 8. * DT - 6. * (1. - Lambda2) * Lambda2 * Lambda3 * x / y3 / y2);
+            }
+
+            double Householder(double T, double x, int32 N) const
+            {
+                for (int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+                {
+                    const double Tx = TimeOfFlight(x, N);
+                    double DT, DDT, DDDT;
+                    Derivatives(x, Tx, DT, DDT, DDDT);
+
+                    const double Delta = Tx - T;
+                    const double DT2 = DT * DT;
+                    const double Next = x - Delta * (DT2 - Delta * DDT / 2.) / (DT * (DT2 - Delta * DDT) + DDDT * Delta * Delta / 6.);
+
+                    const bool bConverged = FMath::Abs(Next - x) <= Tolerance;
+                    x = Next;
+                    if (bConverged) break;
+                }
+                return x;
+            }
+
+            // Minimum time of flight for N revolutions, by Halley iteration
+            // on dT/dx = 0, starting from x = 0 (where T = T0)
+            double MinimumTimeOfFlight(int32 N, double T0) const
+            {
+                double x = 0.;
+                double Tmin = T0;
+                for (int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+                {
+                    double DT, DDT, DDDT;
+                    Derivatives(x, Tmin, DT, DDT, DDDT);
+                    if (DT == 0.) break;
+
+                    const double Next = x - DT * DDT / (DDT * DDT - DT * DDDT / 2.);
+                    const bool bConverged = FMath::Abs(Next - x) <= Tolerance;
+                    x = Next;
+                    Tmin = TimeOfFlight(x, N);
+                    if (bConverged) break;
+                }
+                return Tmin;
+            }
+        };
+
+        // Calls Sink(v1, v2, N) for each solution, zero revolutions first
+        template<typename SinkType>
+        EStatus SolveImpl(const double(&r1)[3], const double(&r2)[3], double tof, double mu, int32 MaxRevolutions, bool bRetrograde, SinkType&& Sink)
+        {
+            if (!(tof > 0.))
+            {
+                return EStatus::NonPositiveTime;
+            }
+
+            const double r1n = Norm(r1);
+            const double r2n = Norm(r2);
+            if (r1n == 0. || r2n == 0.)
+            {
+                return EStatus::ZeroPosition;
+            }
+
+            const double c[3] = { r2[0] - r1[0], r2[1] - r1[1], r2[2] - r1[2] };
+            const double cn = Norm(c);
+            const double s = (r1n + r2n + cn) / 2.;
+
+            const double ir1[3] = { r1[0] / r1n, r1[1] / r1n, r1[2] / r1n };
+            const double ir2[3] = { r2[0] / r2n, r2[1] / r2n, r2[2] / r2n };
+
+            double ih[3];
+            Cross(ir1, ir2, ih);
+            const double SinTransferAngle = Norm(ih);
+            if (SinTransferAngle < MinSinTransferAngle)
+            {
+                return EStatus::Collinear;
+            }
+            for (double& Component : ih) Component /= SinTransferAngle;
+
+            // Lambda < 0 for transfers of more than 180 degrees
+            double Lambda = FMath::Sqrt(FMath::Max(0., 1. - cn / s));
+            double it1[3], it2[3];
+            if (ih[2] < 0.)
+            {
+                Lambda = -Lambda;
+                Cross(ir1, ih, it1);
+                Cross(ir2, ih, it2);
+            }
+            else
+            {
+                Cross(ih, ir1, it1);
+                Cross(ih, ir2, it2);
+            }
+            if (bRetrograde)
+            {
+                Lambda = -Lambda;
+                for (int k = 0; k < 3; ++k)
+                {
+                    it1[k] = -it1[k];
+                    it2[k] = -it2[k];
+                }
+            }
+
+            const FIzzo Izzo(Lambda);
+            const double T = FMath::Sqrt(2. * mu / (s * s * s)) * tof;
+
+            // How many revolutions T allows
+            const double T00 = FMath::Acos(Lambda) + Lambda * FMath::Sqrt(1. - Izzo.Lambda2);
+            const double T1 = 2. / 3. * (1. - Izzo.Lambda3);
+            int32 Nmax = FMath::Min(MaxRevolutions, static_cast<int32>(FMath::Min(T / UE_DOUBLE_PI, 1e6)));
+            if (Nmax > 0)
+            {
+                const double T0 = T00 + Nmax * UE_DOUBLE_PI;
+                if (T < T0 && Izzo.MinimumTimeOfFlight(Nmax, T0) > T)
+                {
+                    --Nmax;
+                }
+            }
+
+            // Velocities from x
+            const double gamma = FMath::Sqrt(mu * s / 2.);
+            const double rho = (r1n - r2n) / cn;
+            const double sigma = FMath::Sqrt(FMath::Max(0., 1. - rho * rho));
+
+            auto Emit = [&](double x, int32 N)
+            {
+                const double y = FMath::Sqrt(1. - Izzo.Lambda2 + Izzo.Lambda2 * x * x);
+                const double vr1 = gamma * ((Lambda * y - x) - rho * (Lambda * y + x)) / r1n;
+                const double vr2 = -gamma * ((Lambda * y - x) + rho * (Lambda * y + x)) / r2n;
+                const double vt = gamma * sigma * (y + Lambda * x);
+                const double vt1 = vt / r1n;
+                const double vt2 = vt / r2n;
+
+                double v1[3], v2[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    v1[k] = vr1 * ir1[k] + vt1 * it1[k];
+                    v2[k] = vr2 * ir2[k] + vt2 * it2[k];
+                }
+                Sink(v1, v2, N);
+            };
+
+            // Zero revolutions: Izzo's initial guess by T's range
+            double x0;
+            if (T >= T00)
+            {
+                x0 = -(T - T00) / (T - T00 + 4.);
+            }
+            else if (T <= T1)
+            {
+                x0 = T1 * (T1 - T) / (2. / 5. * (1. - Izzo.Lambda2 * Izzo.Lambda3) * T) + 1.;
+            }
+            else
+            {
+                x0 = FMath::Pow(T / T00, FMath::Loge(2.) / FMath::Loge(T1 / T00)) - 1.;
+            }
+            Emit(Izzo.Householder(T, x0, 0), 0);
+
+            for (int32 N = 1; N <= Nmax; ++N)
+            {
+                double Guess = FMath::Pow((N * UE_DOUBLE_PI + UE_DOUBLE_PI) / (8. * T), 2. / 3.);
+                Emit(Izzo.Householder(T, (Guess - 1.) / (Guess + 1.), N), N);
+
+                Guess = FMath::Pow((8. * T) / (N * UE_DOUBLE_PI), 2. / 3.);
+                Emit(Izzo.Householder(T, (Guess - 1.) / (Guess + 1.), N), N);
+            }
+
+            return EStatus::Solved;
+        }
+
+        const TCHAR* StatusMessage(EStatus Status)
+        {
+            switch (Status)
+            {
+            case EStatus::NonPositiveTime:
+                return TEXT("the time of flight is not positive");
+            case EStatus::ZeroPosition:
+                return TEXT("a position is a zero vector");
+            default:
+                return TEXT("the positions are parallel, so the transfer plane is undefined");
+            }
+        }
+
+        inline double SquaredDifference(const double* a, const double* b)
+        {
+            const double d[3] = { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+            return Dot(d, d);
+        }
+    }
+
+
+    SPICE_API bool Solve(
+        const FSDistanceVector& r1,
+        const FSDistanceVector& r2,
+        const FSEphemerisPeriod& tof,
+        const FSMassConstant& mu,
+        FSVelocityVector& v1,
+        FSVelocityVector& v2,
+        bool bRetrograde,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        TArray<FSolution> Solutions;
+        if (!Solve(r1, r2, tof, mu, Solutions, 0, bRetrograde, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        v1 = Solutions[0].v1;
+        v2 = Solutions[0].v2;
+        return true;
+    }
+
+
+    SPICE_API bool Solve(
+        const FSDistanceVector& r1,
+        const FSDistanceVector& r2,
+        const FSEphemerisPeriod& tof,
+        const FSMassConstant& mu,
+        TArray<FSolution>& Solutions,
+        int32 MaxRevolutions,
+        bool bRetrograde,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        Solutions.Empty();
+
+        if (mu.GM <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Lambert: GM %f is not positive"), mu.GM));
+        }
+
+        double _r1[3], _r2[3];
+        r1.CopyTo(_r1);
+        r2.CopyTo(_r2);
+
+        const EStatus Status = SolveImpl(_r1, _r2, tof.seconds, mu.GM, FMath::Max(0, MaxRevolutions), bRetrograde, [&](const double(&v1)[3], const double(&v2)[3], int32 N)
+        {
+            FSolution& Solution = Solutions.AddDefaulted_GetRef();
+            Solution.v1 = FSVelocityVector(v1);
+            Solution.v2 = FSVelocityVector(v2);
+            Solution.Revolutions = N;
+        });
+
+        if (Status != EStatus::Solved)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Lambert: %s"), StatusMessage(Status)));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool SampleStates(
+        const FString& target,
+        const FString& observer,
+        const FString& frame,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(States.Num() == ets.Num());
+
+        auto _target = StringCast<ANSICHAR>(*target);
+        auto _observer = StringCast<ANSICHAR>(*observer);
+        auto _frame = StringCast<ANSICHAR>(*frame);
+
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            SpiceDouble _state[6];
+            SpiceDouble _lt;
+            spkezr_c(_target.Get(), ets[i].seconds, _frame.Get(), "NONE", _observer.Get(), _state, &_lt);
+
+            if (ErrorCheck(ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            States[i] = FSStateVector(_state);
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Porkchop(
+        TConstArrayView<FSEphemerisTime> DepartureTimes,
+        TConstArrayView<FSStateVector> DepartureStates,
+        TConstArrayView<FSEphemerisTime> ArrivalTimes,
+        TConstArrayView<FSStateVector> ArrivalStates,
+        const FSMassConstant& mu,
+        TArrayView<double> C3,
+        TArrayView<double> ArrivalVInfinity,
+        int32 MaxRevolutions,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(DepartureTimes.Num() == DepartureStates.Num());
+        check(ArrivalTimes.Num() == ArrivalStates.Num());
+
+        const int32 NumDepartures = DepartureStates.Num();
+        const int32 NumCells = NumDepartures * ArrivalStates.Num();
+        check(C3.Num() == NumCells);
+        check(ArrivalVInfinity.Num() == NumCells);
+
+        if (mu.GM <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Lambert: GM %f is not positive"), mu.GM));
+        }
+
+        const double GM = mu.GM;
+        MaxRevolutions = FMath::Max(0, MaxRevolutions);
+
+        ForEachBatch(NumCells, BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 Cell = Begin; Cell < End; ++Cell)
+            {
+                const int32 d = Cell % NumDepartures;
+                const int32 a = Cell / NumDepartures;
+
+                double r1[3], r2[3], DepartureVelocity[3], ArrivalVelocity[3];
+                DepartureStates[d].r.CopyTo(r1);
+                DepartureStates[d].v.CopyTo(DepartureVelocity);
+                ArrivalStates[a].r.CopyTo(r2);
+                ArrivalStates[a].v.CopyTo(ArrivalVelocity);
+
+                double BestC3 = NoTransfer;
+                double BestVInfinity = NoTransfer;
+
+                SolveImpl(r1, r2, ArrivalTimes[a].seconds - DepartureTimes[d].seconds, GM, MaxRevolutions, false, [&](const double(&v1)[3], const double(&v2)[3], int32 N)
+                {
+                    const double CellC3 = SquaredDifference(v1, DepartureVelocity);
+                    if (FMath::IsFinite(CellC3) && (BestC3 == NoTransfer || CellC3 < BestC3))
+                    {
+                        BestC3 = CellC3;
+                        BestVInfinity = FMath::Sqrt(SquaredDifference(v2, ArrivalVelocity));
+                    }
+                });
+
+                C3[Cell] = BestC3;
+                ArrivalVInfinity[Cell] = BestVInfinity;
+            }
+        });
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Porkchop(
+        const FString& departureBody,
+        const FString& arrivalBody,
+        const FString& center,
+        const FString& frame,
+        const FSMassConstant& mu,
+        const FSEphemerisTime& departureStart,
+        const FSEphemerisPeriod& departureStep,
+        int32 departureCount,
+        const FSEphemerisTime& arrivalStart,
+        const FSEphemerisPeriod& arrivalStep,
+        int32 arrivalCount,
+        TArray<double>& C3,
+        TArray<double>& ArrivalVInfinity,
+        int32 MaxRevolutions,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        C3.Empty();
+        ArrivalVInfinity.Empty();
+
+        departureCount = FMath::Max(0, departureCount);
+        arrivalCount = FMath::Max(0, arrivalCount);
+
+        TArray<FSEphemerisTime> DepartureTimes, ArrivalTimes;
+        DepartureTimes.Reserve(departureCount);
+        ArrivalTimes.Reserve(arrivalCount);
+        for (int32 i = 0; i < departureCount; ++i)
+        {
+            DepartureTimes.Add(FSEphemerisTime(departureStart.seconds + i * departureStep.seconds));
+        }
+        for (int32 i = 0; i < arrivalCount; ++i)
+        {
+            ArrivalTimes.Add(FSEphemerisTime(arrivalStart.seconds + i * arrivalStep.seconds));
+        }
+
+        TArray<FSStateVector> DepartureStates, ArrivalStates;
+        DepartureStates.SetNum(departureCount);
+        ArrivalStates.SetNum(arrivalCount);
+        if (!SampleStates(departureBody, center, frame, DepartureTimes, DepartureStates, ResultCode, ErrorMessage)) return false;
+        if (!SampleStates(arrivalBody, center, frame, ArrivalTimes, ArrivalStates, ResultCode, ErrorMessage)) return false;
+
+        TArray<double> ResultC3, ResultVInfinity;
+        ResultC3.SetNum(departureCount * arrivalCount);
+        ResultVInfinity.SetNum(departureCount * arrivalCount);
+        if (!Porkchop(DepartureTimes, DepartureStates, ArrivalTimes, ArrivalStates, mu, ResultC3, ResultVInfinity, MaxRevolutions, ResultCode, ErrorMessage)) return false;
+
+        C3 = MoveTemp(ResultC3);
+        ArrivalVInfinity = MoveTemp(ResultVInfinity);
+        return true;
+    }
+};
@@ -14,7 +14,15 @@
 //------------------------------------------------------------------------------
 
 #include "SpiceOrbits.h"
+#include "Components/LineBatchComponent.h"
 #include "DrawDebugHelpers.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "SpiceConics.h"
+#include "SpiceCovariance.h"
+#include "SpiceLambert.h"
+#include "SpicePropagator.h"
+#include "SpiceRelativeMotion.h"
 #include "SpiceUtilities.h"
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
@@ -27,6 +35,39 @@ PRAGMA_POP_PLATFORM_DEFAULT_PACKING
 using namespace MaxQ;
 using namespace MaxQ::Private;
 
+namespace
+{
+    // Upper bound on a conic polyline's segment count
+    constexpr int32 MaxConicPolylineSegments = 8192;
+
+    // Relative error of the debug renderings (about 700 segments for a circle)
+    constexpr double DebugConicRelativeError = 0.00001;
+
+    void DrawDebugPolyline(const UWorld* world, const TArray<FSDistanceVector>& points, const FTransform& localTransform, const FColor& color, float thickness)
+    {
+#if ENABLE_DRAW_DEBUG
+        if (!world || !world->LineBatcher || points.Num() < 2 || GEngine->GetNetMode(world) == NM_DedicatedServer)
+        {
+            return;
+        }
+
+        // One batch for the whole conic, rather than a DrawDebugLine per segment
+        TArray<FBatchedLine> Lines;
+        Lines.Reserve(points.Num() - 1);
+
+        FVector Previous = localTransform.TransformPosition(MaxQ::Math::Swizzle(points[0]));
+        for (int32 i = 1; i < points.Num(); ++i)
+        {
+            const FVector Next = localTransform.TransformPosition(MaxQ::Math::Swizzle(points[i]));
+            Lines.Emplace(Previous, Next, color, world->LineBatcher->DefaultLifeTime, thickness, SDPG_World);
+            Previous = Next;
+        }
+
+        world->LineBatcher->DrawLines(Lines);
+#endif
+    }
+}
+
 void USpiceOrbits::EvaluateOrbit(
     ES_ResultCode& ResultCode,
     FString& ErrorMessage,
@@ -80,6 +121,169 @@ void USpiceOrbits::EvaluateOrbit(
     ErrorCheck(ResultCode, ErrorMessage);
 }
 
+void USpiceOrbits::EvaluateOrbits(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<FSStateVector>& states,
+    const FSEphemerisTime& et,
+    const TArray<FSConicElements>& orbits,
+    const FString& orbitReferenceFrame,
+    const FString& observerReferenceFrame
+)
+{
+    states.Empty();
+
+    MaxQ::Conics::FConicBatch Batch;
+    if (!Batch.Add(orbits, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
+    TArray<FSStateVector> Result;
+    Result.SetNum(orbits.Num());
+
+    if (orbitReferenceFrame.Compare(observerReferenceFrame, ESearchCase::IgnoreCase))
+    {
+        double m[3][3];
+        auto _orbitReferenceFrame = StringCast<ANSICHAR>(*orbitReferenceFrame);
+        auto _observerReferenceFrame = StringCast<ANSICHAR>(*observerReferenceFrame);
+        pxform_c(_orbitReferenceFrame.Get(), _observerReferenceFrame.Get(), et.AsSpiceDouble(), m);
+
+        if (ErrorCheck(ResultCode, ErrorMessage)) return;
+
+        // One rotation for the whole batch
+        if (!Batch.Evaluate(et, FSRotationMatrix(m), Result, &ResultCode, &ErrorMessage)) return;
+    }
+    else if (!Batch.Evaluate(et, Result, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
+    // Return Value
+    states = MoveTemp(Result);
+}
+
+void USpiceOrbits::ComputeOrbits(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<FSConicElements>& orbits,
+    const FSEphemerisTime& et,
+    const TArray<FSStateVector>& states,
+    const FSMassConstant& gm
+)
+{
+    orbits.Empty();
+
+    TArray<FSConicElements> Result;
+    Result.SetNum(states.Num());
+
+    if (!MaxQ::Conics::Osculate(states, et, gm, Result, &ResultCode, &ErrorMessage)) return;
+
+    // Return Value
+    orbits = MoveTemp(Result);
+}
+
+void USpiceOrbits::SolveLambert(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    FSVelocityVector& v1,
+    FSVelocityVector& v2,
+    const FSDistanceVector& r1,
+    const FSDistanceVector& r2,
+    const FSEphemerisPeriod& tof,
+    const FSMassConstant& gm,
+    bool retrograde
+)
+{
+    MaxQ::Lambert::Solve(r1, r2, tof, gm, v1, v2, retrograde, &ResultCode, &ErrorMessage);
+}
+
+void USpiceOrbits::ComputePorkchop(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<double>& c3,
+    TArray<double>& arrivalVInfinity,
+    const FString& departureBody,
+    const FString& arrivalBody,
+    const FSMassConstant& gm,
+    const FSEphemerisTime& departureStart,
+    const FSEphemerisPeriod& departureStep,
+    int departureCount,
+    const FSEphemerisTime& arrivalStart,
+    const FSEphemerisPeriod& arrivalStep,
+    int arrivalCount,
+    const FString& centerBody,
+    const FString& referenceFrame,
+    int maxRevolutions
+)
+{
+    MaxQ::Lambert::Porkchop(
+        departureBody, arrivalBody, centerBody, referenceFrame, gm,
+        departureStart, departureStep, departureCount,
+        arrivalStart, arrivalStep, arrivalCount,
+        c3, arrivalVInfinity, maxRevolutions,
+        &ResultCode, &ErrorMessage
+    );
+}
+
+void USpiceOrbits::PropagateStates(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<FSStateVector>& states,
+    const FSEphemerisTime& et,
+    const FSEphemerisTime& etEnd,
+    const TArray<FString>& thirdBodies,
+    const FString& centerBody,
+    const FString& referenceFrame,
+    bool gaussJackson
+)
+{
+    MaxQ::Propagator::FForceModel Model;
+    if (!MaxQ::Propagator::LoadForceModel(centerBody, referenceFrame, et, thirdBodies, Model, &ResultCode, &ErrorMessage))
+    {
+        return;
+    }
+
+    MaxQ::Propagator::FSettings Settings;
+    Settings.Integrator = gaussJackson ? MaxQ::Propagator::EIntegrator::GaussJackson8 : MaxQ::Propagator::EIntegrator::DormandPrince853;
+
+    MaxQ::Propagator::Propagate(Model, Settings, states, et, etEnd, &ResultCode, &ErrorMessage);
+}
+
+void USpiceOrbits::PropagateCovariance(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    FSStateVector& finalState,
+    FSStateTransform& finalCovariance,
+    const FSStateVector& state,
+    const FSStateTransform& covariance,
+    const FSEphemerisPeriod& dt,
+    const FSMassConstant& gm
+)
+{
+    MaxQ::Covariance::FStateMatrix Phi;
+    if (MaxQ::Conics::Transition(state, dt, gm, finalState, Phi, &ResultCode, &ErrorMessage))
+    {
+        MaxQ::Covariance::FStateMatrix P(covariance);
+        MaxQ::Covariance::Transform(Phi, P, P);
+        finalCovariance = P.ToStateTransform();
+    }
+}
+
+void USpiceOrbits::PropagateFormation(
+    ES_ResultCode& ResultCode,
+    FString& ErrorMessage,
+    TArray<FSStateVector>& relativeStates,
+    const FSStateVector& chief,
+    const FSEphemerisPeriod& dt,
+    const FSMassConstant& gm,
+    bool circular
+)
+{
+    const MaxQ::RelativeMotion::EModel Model = circular ? MaxQ::RelativeMotion::EModel::ClohessyWiltshire : MaxQ::RelativeMotion::EModel::YamanakaAnkersen;
+    MaxQ::RelativeMotion::Propagate(chief, gm, dt, relativeStates, relativeStates, Model, &ResultCode, &ErrorMessage);
+}
+
 void USpiceOrbits::RenderDebugConic(
     const AActor* actor,
     const FSEllipse& conic,
@@ -229,116 +433,73 @@ void USpiceOrbits::MakeSPKObservation(
 }
 
 
-void USpiceOrbits::RenderDebugEllipse(const UWorld* world, const FSEllipse& ellipse, const FTransform& localTransform, const FColor& color, float thickness)
+void USpiceOrbits::ComputeConicPolyline(
+    TArray<FSDistanceVector>& points,
+    const FSEllipse& conic,
+    bool isHyperbolic,
+    double relativeError,
+    double hyperbolicAnomalyLimit
+)
 {
-    for (double theta = 0.f; theta <= 360.f; )
+    points.Empty();
+
+    const double a = conic.v_major.Magnitude().AsSpiceDouble();
+    const double b = conic.v_minor.Magnitude().AsSpiceDouble();
+
+    // (Parabolas have no finite semi-major axis)
+    if (!(a > 0.) || !(b > 0.) || !FMath::IsFinite(a * b) || !(relativeError > 0.) || (isHyperbolic && !(hyperbolicAnomalyLimit > 0.)))
+    {
+        return;
+    }
+
+    // A chord of length L across a curve with curvature k strays from it by
+    // about k*L^2/8.  (a cos t, b sin t) has curvature a*b/s^3, where s is
+    // |dp/dt|, so a parameter step of sqrt(8*delta*s/(a*b)) keeps each chord
+    // within delta of the curve.  Likewise for (a cosh t, b sinh t).
+    const double Delta = relativeError * a;
+    const double Begin = isHyperbolic ? -hyperbolicAnomalyLimit : 0.;
+    const double End = isHyperbolic ? hyperbolicAnomalyLimit : Math::twopi;
+    const double MinStep = (End - Begin) / MaxConicPolylineSegments;
+    const double MaxStep = (End - Begin) / 16.;
+
+    for (double t = Begin; ; )
     {
-        float rads = Math::rpd * theta;
-        double _cos = cos(rads);
-        double _sin = sin(rads);
-        FVector  p1 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cos * ellipse.v_major + _sin * ellipse.v_minor
-            ));
-
-        theta += 0.25f;
-
-        rads = Math::rpd * theta;
-        _cos = cos(rads);
-        _sin = sin(rads);
-
-        // It's not efficient to recalculate since we just calculated it last iteration...
-        // ...But this is a debug function anyways
-        FVector p2 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cos * ellipse.v_major + _sin * ellipse.v_minor
-            ));
-
-        DrawDebugLine(world, p1, p2, color, false, -1.f, 0, thickness );
+        const double c = isHyperbolic ? cosh(t) : cos(t);
+        const double s = isHyperbolic ? sinh(t) : sin(t);
+        points.Add(conic.center + c * conic.v_major + s * conic.v_minor);
+
+        if (t >= End) break;
+
+        const double Speed = sqrt(a * a * s * s + b * b * c * c);
+        const double Step = FMath::Clamp(sqrt(8. * Delta * Speed / (a * b)), MinStep, MaxStep);
+        t = FMath::Min(t + Step, End);
     }
 }
 
 
+void USpiceOrbits::RenderDebugEllipse(const UWorld* world, const FSEllipse& ellipse, const FTransform& localTransform, const FColor& color, float thickness)
+{
+    TArray<FSDistanceVector> points;
+    ComputeConicPolyline(points, ellipse, false, DebugConicRelativeError);
+    DrawDebugPolyline(world, points, localTransform, color, thickness);
+}
+
+
 void USpiceOrbits::RenderDebugHyperbola(const UWorld* world, const FSEllipse& ellipse, const FTransform& localTransform, const FColor& color, float thickness)
 {
-    double sign = 1.;
+    TArray<FSDistanceVector> points;
 
-    for (double theta =-360.; theta <= 360.; )
-    {
-        double rads = Math::rpd * theta;
-        double _cosh = sign * cosh(rads);
-        double _sinh = sign * sinh(rads);
-        FVector  p1 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        theta += 0.25;
-
-        // It's not efficient to recalculate since we just calculated it last iteration...
-        // ...But this is a debug function anyways
-        rads = Math::rpd * theta;
-        _cosh = sign * cosh(rads);
-        _sinh = sign * sinh(rads);
-
-        FVector p2 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        DrawDebugLine(world, p1, p2, color, false, -1.f, 0, thickness);
-    }
+    // Long straight runs out towards the asymptotes, either side of the
+    // curved part (within +/- 360 degrees of hyperbolic anomaly): back to
+    // -30000 degrees, and on to +3000
+    const double FarBefore = Math::rpd * -30000.;
+    const double FarAfter = Math::rpd * 3000.;
+    points.Add(ellipse.center + cosh(FarBefore) * ellipse.v_major + sinh(FarBefore) * ellipse.v_minor);
 
-    {
-        double theta = -30000.;
-        double rads = Math::rpd * theta;
-        double _cosh = sign * cosh(rads);
-        double _sinh = sign * sinh(rads);
-        FVector  p1 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        theta = -360.;
-
-        // It's not efficient to recalculate since we just calculated it last iteration...
-        // ...But this is a debug function anyways
-        rads = Math::rpd * theta;
-        _cosh = sign * cosh(rads);
-        _sinh = sign * sinh(rads);
-
-        FVector p2 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        DrawDebugLine(world, p1, p2, color, false, -1.f, 0, thickness);
-    }
+    TArray<FSDistanceVector> arc;
+    ComputeConicPolyline(arc, ellipse, true, DebugConicRelativeError, Math::twopi);
+    points.Append(arc);
+    points.Add(ellipse.center + cosh(FarAfter) * ellipse.v_major + sinh(FarAfter) * ellipse.v_minor);
 
-    {
-        double theta = 360.;
-        double rads = Math::rpd * theta;
-        double _cosh = sign * cosh(rads);
-        double _sinh = sign * sinh(rads);
-        FVector  p1 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        theta = 3000.f;
-
-        // It's not efficient to recalculate since we just calculated it last iteration...
-        // ...But this is a debug function anyways
-        rads = Math::rpd * theta;
-        _cosh = sign * cosh(rads);
-        _sinh = sign * sinh(rads);
-
-        FVector p2 = localTransform.TransformPosition(
-            USpiceTypes::Conv_SDistanceVectorToVector(
-                ellipse.center + _cosh * ellipse.v_major + _sinh * ellipse.v_minor
-            ));
-
-        DrawDebugLine(world, p1, p2, color, false, -1.f, 0, thickness);
-    }
+    DrawDebugPolyline(world, points, localTransform, color, thickness);
 }
-
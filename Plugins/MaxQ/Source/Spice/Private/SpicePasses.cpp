@@ -0,0 +1,560 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePasses.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Ground-station pass prediction for many satellites
+//
+// The span is sampled in chunks, each chunk's first sample being the last
+// one of the chunk before, so only a chunk's states (bounded to a few tens
+// of MB) are ever held.  Each (station, satellite) pair keeps whether it's
+// in a pass, and the pass so far, from one chunk to the next.
+//
+// On a step, the horizon distance h = rho.up - |rho| sin(mask) changes no
+// faster than |v| (1 + |sin(mask)|), so if h at the step's ends is too
+// negative for the satellite to have come up in between, the step is
+// skipped.  That's most steps, for most pairs.
+//
+// The other steps are split where the elevation peaks or bottoms out (sign
+// changes of its rate, looked for at a few points per step, then bisected),
+// leaving pieces on which the elevation is monotonic.  A piece whose ends
+// straddle the mask has exactly one rise or set on it, which is bisected.
+// The highest elevation is at the end of a piece.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePasses.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpicePasses.h"
+#include "SpiceUtilities.h"
+#include "SpiceTeme.h"
+#include "Algo/Sort.h"
+#include "Misc/ScopeLock.h"
+
+using namespace MaxQ::Private;
+using MaxQ::Sgp4::FTleBatch;
+
+namespace MaxQ::Passes
+{
+    namespace
+    {
+        // Pairs (or satellites) per batch, per worker
+        constexpr int32 BatchSize = 256;
+
+        // Doubles of states per chunk
+        constexpr int32 ChunkDoubles = 1 << 22;
+
+        // Elevation rate sign changes are looked for at this many points per
+        // step, and every root is bisected this many times
+        constexpr int32 Samples = 4;
+        constexpr int32 Bisections = 48;
+
+        // On the bound on how fast the horizon distance changes
+        constexpr double SpeedMargin = 1.1;
+
+        // Fills States (6 per satellite per time) and Valid (1 per satellite
+        // per time) at each of Times
+        using FSampler = TFunctionRef<bool(TConstArrayView<double> Times, TArrayView<double> States, TArrayView<bool> Valid, ES_ResultCode* ResultCode, FString* ErrorMessage)>;
+
+        struct FStationFrame
+        {
+            double Position[3];
+            double Up[3];
+            double SinMask;
+        };
+
+        // A pair's pass in progress
+        struct FPassState
+        {
+            bool bStarted = false;
+            bool bUp = false;
+            double Rise = 0.;
+            double Culmination = 0.;
+            double MaxSinElevation = -1.;
+        };
+
+        // Elevation (as its sine, less the mask's) and the sign of its rate
+        struct FElevation
+        {
+            double Above;
+            double Rate;
+            double SinElevation;
+        };
+
+        FStationFrame StationFrame(const FStation& Station, const FSettings& Settings)
+        {
+            const double Lat = Station.Latitude.AsRadians(), Lon = Station.Longitude.AsRadians();
+            const double f = Settings.Flattening, e2 = f * (2. - f);
+            const double N = Settings.EquatorialRadius.km / FMath::Sqrt(1. - e2 * FMath::Square(FMath::Sin(Lat)));
+            const double h = Station.Altitude.km;
+
+            FStationFrame Frame;
+            Frame.Up[0] = FMath::Cos(Lat) * FMath::Cos(Lon);
+            Frame.Up[1] = FMath::Cos(Lat) * FMath::Sin(Lon);
+            Frame.Up[2] = FMath::Sin(Lat);
+            Frame.Position[0] = (N + h) * Frame.Up[0];
+            Frame.Position[1] = (N + h) * Frame.Up[1];
+            Frame.Position[2] = (N * (1. - e2) + h) * Frame.Up[2];
+            Frame.SinMask = FMath::Sin(Station.MinimumElevation.AsRadians());
+            return Frame;
+        }
+
+        // Position and velocity at s in [0, 1] along a step of h seconds
+        void Hermite(const double* r0, const double* r1, double h, double s, double (&r)[3], double (&v)[3])
+        {
+            const double s2 = s * s, s3 = s2 * s;
+            const double h00 = 2. * s3 - 3. * s2 + 1., h10 = s3 - 2. * s2 + s;
+            const double h01 = -2. * s3 + 3. * s2, h11 = s3 - s2;
+            const double d00 = 6. * s2 - 6. * s, d10 = 3. * s2 - 4. * s + 1.;
+            const double d01 = -d00, d11 = 3. * s2 - 2. * s;
+
+            for (int32 k = 0; k < 3; ++k)
+            {
+                r[k] = h00 * r0[k] + h10 * h * r0[k + 3] + h01 * r1[k] + h11 * h * r1[k + 3];
+                v[k] = (d00 * r0[k] + d01 * r1[k]) / h + d10 * r0[k + 3] + d11 * r1[k + 3];
+            }
+        }
+
+        FElevation Elevation(const FStationFrame& Station, const double (&r)[3], const double (&v)[3])
+        {
+            const double rho[3] = { r[0] - Station.Position[0], r[1] - Station.Position[1], r[2] - Station.Position[2] };
+            const double rho2 = rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2];
+            const double Range = FMath::Sqrt(rho2);
+            const double Height = rho[0] * Station.Up[0] + rho[1] * Station.Up[1] + rho[2] * Station.Up[2];
+            const double Climb = v[0] * Station.Up[0] + v[1] * Station.Up[1] + v[2] * Station.Up[2];
+            const double RangeRate = rho[0] * v[0] + rho[1] * v[1] + rho[2] * v[2];
+
+            FElevation Result;
+            Result.SinElevation = Height / Range;
+            Result.Above = Result.SinElevation - Station.SinMask;
+            Result.Rate = Climb * rho2 - Height * RangeRate;
+            return Result;
+        }
+
+        // Walks one pair across a chunk's steps
+        class FPairWalk
+        {
+        public:
+            FPairWalk(const FStationFrame& Station, int32 StationIndex, int32 Satellite, FPassState& State, TArray<FPass>& Passes)
+                : Station(Station), StationIndex(StationIndex), Satellite(Satellite), State(State), Passes(Passes)
+            {
+            }
+
+            // Samples at t0 and t1, states r0 and r1, either possibly invalid
+            void Step(double t0, double t1, const double* r0, const double* r1, bool bValid0, bool bValid1)
+            {
+                if (!bValid0)
+                {
+                    State.bStarted = false;
+                    return;
+                }
+
+                T0 = t0;
+                H = t1 - t0;
+                R0 = r0;
+                R1 = r1;
+
+                // From r0 itself, as r1 may not be valid
+                const double p0[3] = { r0[0], r0[1], r0[2] }, v0[3] = { r0[3], r0[4], r0[5] };
+                const FElevation e0 = Elevation(Station, p0, v0);
+                if (!State.bStarted)
+                {
+                    State.bStarted = true;
+                    State.bUp = e0.Above > 0.;
+                    if (State.bUp)
+                    {
+                        State.Rise = t0;
+                        State.Culmination = t0;
+                        State.MaxSinElevation = e0.SinElevation;
+                    }
+                }
+
+                if (!bValid1)
+                {
+                    if (State.bUp) Close(t0);
+                    State.bStarted = false;
+                    return;
+                }
+
+                if (!State.bUp && !CanRise())
+                {
+                    return;
+                }
+
+                double sLow = 0.;
+                FElevation eLow = e0;
+                for (int32 n = 1; n <= Samples; ++n)
+                {
+                    const double sHigh = double(n) / Samples;
+                    const FElevation eHigh = At(sHigh);
+
+                    // Split at a peak, or a trough
+                    if ((eLow.Rate > 0.) != (eHigh.Rate > 0.))
+                    {
+                        double a = sLow, b = sHigh;
+                        const bool bRising = eLow.Rate > 0.;
+                        for (int32 k = 0; k < Bisections; ++k)
+                        {
+                            const double m = 0.5 * (a + b);
+                            if ((At(m).Rate > 0.) == bRising) a = m;
+                            else b = m;
+                        }
+                        const double sTurn = 0.5 * (a + b);
+                        const FElevation eTurn = At(sTurn);
+                        Piece(sLow, eLow, sTurn, eTurn);
+                        Piece(sTurn, eTurn, sHigh, eHigh);
+                    }
+                    else
+                    {
+                        Piece(sLow, eLow, sHigh, eHigh);
+                    }
+
+                    sLow = sHigh;
+                    eLow = eHigh;
+                }
+            }
+
+            // Ends a pass in progress at the end of the span
+            void Finish(double etEnd)
+            {
+                if (State.bStarted && State.bUp) Close(etEnd);
+            }
+
+        private:
+            FElevation At(double s) const
+            {
+                double r[3], v[3];
+                Hermite(R0, R1, H, s, r, v);
+                return Elevation(Station, r, v);
+            }
+
+            // Whether the horizon distance can get above zero on the step
+            bool CanRise() const
+            {
+                auto Horizon = [&](const double* r, double& Speed)
+                {
+                    const double rho[3] = { r[0] - Station.Position[0], r[1] - Station.Position[1], r[2] - Station.Position[2] };
+                    Speed = FMath::Sqrt(r[3] * r[3] + r[4] * r[4] + r[5] * r[5]);
+                    return rho[0] * Station.Up[0] + rho[1] * Station.Up[1] + rho[2] * Station.Up[2] - FMath::Sqrt(rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2]) * Station.SinMask;
+                };
+
+                double Speed0, Speed1;
+                const double h0 = Horizon(R0, Speed0), h1 = Horizon(R1, Speed1);
+                const double Rate = SpeedMargin * FMath::Max(Speed0, Speed1) * (1. + FMath::Abs(Station.SinMask));
+                return h0 + h1 + Rate * H > 0.;
+            }
+
+            void Consider(double s, const FElevation& e)
+            {
+                if (e.SinElevation > State.MaxSinElevation)
+                {
+                    State.MaxSinElevation = e.SinElevation;
+                    State.Culmination = T0 + s * H;
+                }
+            }
+
+            // The elevation is monotonic from a to b
+            void Piece(double a, const FElevation& ea, double b, const FElevation& eb)
+            {
+                if (State.bUp)
+                {
+                    Consider(a, ea);
+                }
+
+                if (!State.bUp && ea.Above <= 0. && eb.Above > 0.)
+                {
+                    const double s = Crossing(a, b, true);
+                    State.bUp = true;
+                    State.Rise = T0 + s * H;
+                    State.Culmination = State.Rise;
+                    State.MaxSinElevation = At(s).SinElevation;
+                    Consider(b, eb);
+                }
+                else if (State.bUp && eb.Above <= 0.)
+                {
+                    Close(T0 + (ea.Above > 0. ? Crossing(a, b, false) : a) * H);
+                }
+                else if (State.bUp)
+                {
+                    Consider(b, eb);
+                }
+            }
+
+            double Crossing(double a, double b, bool bRise) const
+            {
+                for (int32 k = 0; k < Bisections; ++k)
+                {
+                    const double m = 0.5 * (a + b);
+                    if ((At(m).Above > 0.) != bRise) a = m;
+                    else b = m;
+                }
+                return 0.5 * (a + b);
+            }
+
+            void Close(double Set)
+            {
+                FPass& Pass = Passes.AddDefaulted_GetRef();
+                Pass.Station = StationIndex;
+                Pass.Satellite = Satellite;
+                Pass.Rise = FSEphemerisTime(State.Rise);
+                Pass.Culmination = FSEphemerisTime(State.Culmination);
+                Pass.Set = FSEphemerisTime(Set);
+                Pass.MaximumElevation = FSAngle(FMath::Asin(FMath::Clamp(State.MaxSinElevation, -1., 1.)));
+                State.bUp = false;
+            }
+
+            const FStationFrame& Station;
+            const int32 StationIndex;
+            const int32 Satellite;
+            FPassState& State;
+            TArray<FPass>& Passes;
+
+            double T0 = 0., H = 0.;
+            const double* R0 = nullptr;
+            const double* R1 = nullptr;
+        };
+
+        bool PredictSampled(
+            int32 Count,
+            FSampler Sample,
+            TConstArrayView<FStation> Stations,
+            const FSEphemerisTime& et,
+            const FSEphemerisTime& etEnd,
+            TArray<FPass>& Passes,
+            const FSettings& Settings,
+            ES_ResultCode* ResultCode,
+            FString* ErrorMessage
+        )
+        {
+            Passes.Reset();
+
+            if (!(Settings.Step.seconds > 0.) || !(etEnd.seconds > et.seconds))
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Passes: the step must be positive, and etEnd must be after et"));
+            }
+            if (!(Settings.EquatorialRadius.km > 0.) || !(Settings.Flattening >= 0. && Settings.Flattening < 1.))
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Passes: the stations' ellipsoid is invalid"));
+            }
+
+            const int32 NumStations = Stations.Num();
+            const int32 NumPairs = NumStations * Count;
+            if (NumPairs == 0)
+            {
+                return Succeeded(ResultCode, ErrorMessage);
+            }
+
+            TArray<FStationFrame> Frames;
+            Frames.Reserve(NumStations);
+            for (const FStation& Station : Stations)
+            {
+                Frames.Add(StationFrame(Station, Settings));
+            }
+
+            const double Span = etEnd.seconds - et.seconds;
+            const int32 NumSteps = FMath::Max(1, FMath::CeilToInt32(Span / Settings.Step.seconds));
+            const double Step = Span / NumSteps;
+            const int32 ChunkSamples = FMath::Clamp(ChunkDoubles / (6 * Count), 2, NumSteps + 1);
+
+            TArray<FPassState> States;
+            States.SetNum(NumPairs);
+
+            TArray<double> Times, Chunk;
+            TArray<bool> Valid;
+            Times.SetNumUninitialized(ChunkSamples);
+            Chunk.SetNumUninitialized(ChunkSamples * Count * 6);
+            Valid.SetNumUninitialized(ChunkSamples * Count);
+
+            FCriticalSection Lock;
+            int32 First = 0;
+            bool bFirstChunk = true;
+            while (First < NumSteps)
+            {
+                const int32 NumSamples = FMath::Min(ChunkSamples, NumSteps + 1 - First);
+                for (int32 n = 0; n < NumSamples; ++n)
+                {
+                    Times[n] = First + n == NumSteps ? etEnd.seconds : et.seconds + (First + n) * Step;
+                }
+
+                // After the first chunk, the first sample is the last chunk's last
+                const int32 Skip = bFirstChunk ? 0 : 1;
+                if (!bFirstChunk)
+                {
+                    FMemory::Memcpy(&Chunk[0], &Chunk[(ChunkSamples - 1) * Count * 6], Count * 6 * sizeof(double));
+                    FMemory::Memcpy(&Valid[0], &Valid[(ChunkSamples - 1) * Count], Count * sizeof(bool));
+                }
+                if (!Sample(
+                    TConstArrayView<double>(&Times[Skip], NumSamples - Skip),
+                    TArrayView<double>(&Chunk[Skip * Count * 6], (NumSamples - Skip) * Count * 6),
+                    TArrayView<bool>(&Valid[Skip * Count], (NumSamples - Skip) * Count),
+                    ResultCode, ErrorMessage))
+                {
+                    Passes.Reset();
+                    return false;
+                }
+
+                ForEachBatch(NumPairs, BatchSize, [&](int32 Begin, int32 End)
+                {
+                    TArray<FPass> Local;
+                    for (int32 p = Begin; p < End; ++p)
+                    {
+                        const int32 Station = p / Count, Satellite = p % Count;
+                        FPairWalk Walk(Frames[Station], Station, Satellite, States[p], Local);
+                        for (int32 n = 0; n + 1 < NumSamples; ++n)
+                        {
+                            const int32 i0 = n * Count + Satellite, i1 = i0 + Count;
+                            Walk.Step(Times[n], Times[n + 1], &Chunk[i0 * 6], &Chunk[i1 * 6], Valid[i0], Valid[i1]);
+                        }
+                        if (First + NumSamples - 1 == NumSteps)
+                        {
+                            Walk.Finish(etEnd.seconds);
+                        }
+                    }
+
+                    FScopeLock ScopeLock(&Lock);
+                    Passes.Append(Local);
+                });
+
+                First += NumSamples - 1;
+                bFirstChunk = false;
+            }
+
+            Sort(Passes, EPassOrder::Rise);
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+    }
+
+
+    SPICE_API bool Predict(
+        const FTleBatch& Satellites,
+        TConstArrayView<FStation> Stations,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        TArray<FPass>& Passes,
+        const FSettings& Settings,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        const int32 Count = Satellites.Num();
+        TArray<FSStateVector> States;
+        TArray<Sgp4::EError> Errors;
+        States.SetNum(Count);
+        Errors.SetNum(Count);
+
+        auto Sample = [&](TConstArrayView<double> Times, TArrayView<double> Samples, TArrayView<bool> Valid, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            for (int32 n = 0; n < Times.Num(); ++n)
+            {
+                // UT1 is taken as UTC
+                Covariance::FStateMatrix ToPef;
+                if (!Teme::ToPseudoEarthFixed(FSEphemerisTime(Times[n]), ToPef, FSEphemerisPeriod(), ResultCode, ErrorMessage))
+                {
+                    return false;
+                }
+
+                Satellites.Evaluate(FSEphemerisTime(Times[n]), States, Errors);
+                Teme::Transform(ToPef, States);
+
+                ForEachBatch(Count, BatchSize, [&](int32 Begin, int32 End)
+                {
+                    for (int32 i = Begin; i < End; ++i)
+                    {
+                        double pef[6];
+                        States[i].CopyTo(pef);
+                        FMemory::Memcpy(&Samples[(n * Count + i) * 6], pef, sizeof(pef));
+                        Valid[n * Count + i] = Errors[i] == Sgp4::EError::None;
+                    }
+                });
+            }
+            return true;
+        };
+
+        return PredictSampled(Count, Sample, Stations, et, etEnd, Passes, Settings, ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Predict(
+        TConstArrayView<FString> Targets,
+        const FString& EarthFixedFrame,
+        TConstArrayView<FStation> Stations,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        TArray<FPass>& Passes,
+        const FSettings& Settings,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        const int32 Count = Targets.Num();
+        auto _frame = StringCast<ANSICHAR>(*EarthFixedFrame);
+
+        // CSPICE isn't thread safe, so this part is serial
+        auto Sample = [&](TConstArrayView<double> Times, TArrayView<double> Samples, TArrayView<bool> Valid, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            for (int32 i = 0; i < Count; ++i)
+            {
+                auto _target = StringCast<ANSICHAR>(*Targets[i]);
+                for (int32 n = 0; n < Times.Num(); ++n)
+                {
+                    SpiceDouble _lt;
+                    spkezr_c(_target.Get(), Times[n], _frame.Get(), "NONE", "EARTH", &Samples[(n * Count + i) * 6], &_lt);
+                    if (ErrorCheck(ResultCode, ErrorMessage))
+                    {
+                        return false;
+                    }
+                    Valid[n * Count + i] = true;
+                }
+            }
+            return true;
+        };
+
+        return PredictSampled(Count, Sample, Stations, et, etEnd, Passes, Settings, ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API void Sort(TArrayView<FPass> Passes, EPassOrder Order)
+    {
+        auto ByRise = [](const FPass& a, const FPass& b)
+        {
+            if (a.Rise.seconds != b.Rise.seconds) return a.Rise.seconds < b.Rise.seconds;
+            if (a.Station != b.Station) return a.Station < b.Station;
+            return a.Satellite < b.Satellite;
+        };
+
+        switch (Order)
+        {
+        case EPassOrder::Station:
+            Algo::Sort(Passes, [&](const FPass& a, const FPass& b) { return a.Station != b.Station ? a.Station < b.Station : ByRise(a, b); });
+            break;
+        case EPassOrder::Satellite:
+            Algo::Sort(Passes, [&](const FPass& a, const FPass& b) { return a.Satellite != b.Satellite ? a.Satellite < b.Satellite : ByRise(a, b); });
+            break;
+        case EPassOrder::MaximumElevation:
+            Algo::Sort(Passes, [&](const FPass& a, const FPass& b) { return a.MaximumElevation.AsRadians() != b.MaximumElevation.AsRadians() ? a.MaximumElevation.AsRadians() > b.MaximumElevation.AsRadians() : ByRise(a, b); });
+            break;
+        case EPassOrder::Duration:
+            Algo::Sort(Passes, [&](const FPass& a, const FPass& b)
+            {
+                const double da = a.Set.seconds - a.Rise.seconds, db = b.Set.seconds - b.Rise.seconds;
+                return da != db ? da > db : ByRise(a, b);
+            });
+            break;
+        default:
+            Algo::Sort(Passes, ByRise);
+            break;
+        }
+    }
+};
@@ -0,0 +1,556 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePatchedConics.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Patched-conic trajectories across spheres of influence
+//
+// Build() samples every body's state relative to the root once, at evenly
+// spaced nodes, and Hermite-interpolates between them (as the propagator
+// does for its third bodies).  Everything after that, the scan, the
+// bisection and every later Evaluate(), runs without CSPICE.
+//
+// On a leg about body c, the vehicle has left the leg when it's outside c's
+// SOI, or inside the SOI of one of c's children.  Both are tested at the end
+// of each scan step.  The step is bounded by the time to the nearest of
+// those boundaries at the current closing speed, so a brief pass through a
+// child's SOI isn't stepped over.  Once a step ends past a boundary, the
+// crossing is bisected, keeping the late end of the bracket.  The next leg
+// then starts just across the boundary, so it doesn't immediately cross
+// back.
+//
+// Crossing re-references the state by the difference of the two bodies'
+// interpolated states, the same interpolation Evaluate() uses to put a
+// leg's state back relative to the root, so a trajectory is continuous to
+// within the bisection tolerance.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePatchedConics.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpicePatchedConics.h"
+#include "SpiceUtilities.h"
+#include "Algo/BinarySearch.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::PatchedConics
+{
+    namespace
+    {
+        // Evaluations per batch, per worker
+        constexpr int32 BatchSize = 1024;
+
+        // Laplace's SOI exponent
+        constexpr double SoiExponent = 0.4;
+
+        inline double Distance(const double* a, const double* b)
+        {
+            const double x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+            return FMath::Sqrt(x * x + y * y + z * z);
+        }
+
+        bool CheckSystem(const FSystem& System, int32 body, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            if (!System.Bodies.IsValidIndex(body))
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: body %d is not in the system"), body));
+            }
+
+            for (int32 i = 0; i < System.Bodies.Num(); ++i)
+            {
+                const FBody& Body = System.Bodies[i];
+                if (Body.GM.GM <= 0.)
+                {
+                    return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s's GM is not positive"), *Body.Name));
+                }
+                if (i == 0 && Body.Parent != INDEX_NONE)
+                {
+                    return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: the root, %s, has a parent"), *Body.Name));
+                }
+                if (i > 0 && (Body.Parent < 0 || Body.Parent >= i))
+                {
+                    return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s's parent must come before it"), *Body.Name));
+                }
+                if (i > 0 && Body.SphereOfInfluence.km <= 0.)
+                {
+                    return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s's sphere of influence is not positive"), *Body.Name));
+                }
+            }
+
+            return true;
+        }
+
+        bool CheckSettings(const FSettings& Settings, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            if (Settings.StepFactor <= 0. || Settings.MinStep.seconds <= 0. || Settings.MaxStep.seconds < Settings.MinStep.seconds)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::PatchedConics: the scan steps must be positive, and MaxStep at least MinStep"));
+            }
+            if (Settings.Tolerance.seconds <= 0. || Settings.EphemerisStep.seconds <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::PatchedConics: the tolerance and ephemeris step must be positive"));
+            }
+            return true;
+        }
+    }
+
+
+    SPICE_API bool AddBody(
+        FSystem& System,
+        const FString& name,
+        const FString& parent,
+        const FSEphemerisTime& et,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        if (System.Find(name) != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s is already in the system"), *name));
+        }
+
+        int32 Parent = INDEX_NONE;
+        if (parent.IsEmpty())
+        {
+            if (System.Bodies.Num() > 0)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: the system already has a root, %s"), *System.Bodies[0].Name));
+            }
+        }
+        else
+        {
+            Parent = System.Find(parent);
+            if (Parent == INDEX_NONE)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s's parent, %s, is not in the system"), *name, *parent));
+            }
+        }
+
+        SpiceInt _code = 0;
+        SpiceBoolean _found = SPICEFALSE;
+        bods2c_c(StringCast<ANSICHAR>(*name).Get(), &_code, &_found);
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+        if (!_found)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: no body named %s"), *name));
+        }
+
+        SpiceInt _n = 0;
+        SpiceDouble _gm = 0.;
+        bodvcd_c(_code, "GM", 1, &_n, &_gm);
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        FBody Body;
+        Body.Name = name;
+        Body.GM = FSMassConstant(_gm);
+        Body.Parent = Parent;
+
+        if (Parent != INDEX_NONE)
+        {
+            SpiceDouble _state[6];
+            SpiceDouble _lt;
+            spkezr_c(StringCast<ANSICHAR>(*name).Get(), et.seconds, StringCast<ANSICHAR>(*System.Frame).Get(), "NONE", StringCast<ANSICHAR>(*parent).Get(), _state, &_lt);
+            if (ErrorCheck(ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            const double ParentGM = System.Bodies[Parent].GM.GM;
+            const FSStateVector State(_state);
+            FSConicElements Elements;
+            FSDistance SemiMajorAxis;
+            if (!Conics::Osculate(TConstArrayView<FSStateVector>(&State, 1), et, FSMassConstant(ParentGM + _gm), TArrayView<FSConicElements>(&Elements, 1), TArrayView<FSAngle>(), TArrayView<FSDistance>(&SemiMajorAxis, 1), TArrayView<FSEphemerisPeriod>(), ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+            if (SemiMajorAxis.km <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: %s's orbit about %s isn't elliptic"), *name, *parent));
+            }
+
+            Body.SphereOfInfluence = FSDistance(SemiMajorAxis.km * FMath::Pow(_gm / ParentGM, SoiExponent));
+        }
+
+        System.Bodies.Add(Body);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    void FTrajectory::BodyState(int32 body, double et, double* state) const
+    {
+        // The root, or a body that was never sampled
+        if (body <= 0 || body >= NumBodies)
+        {
+            for (int32 k = 0; k < 6; ++k) state[k] = 0.;
+            return;
+        }
+
+        const double u = (et - First) / Step;
+        const int32 i = FMath::Clamp(FMath::FloorToInt32(u), 0, NumNodes - 2);
+        const double s = u - i;
+        const double s2 = s * s;
+        const double s3 = s2 * s;
+
+        // Cubic Hermite basis and its derivative, with the tangents scaled
+        // to the interval
+        const double h00 = 2. * s3 - 3. * s2 + 1.;
+        const double h10 = (s3 - 2. * s2 + s) * Step;
+        const double h01 = 3. * s2 - 2. * s3;
+        const double h11 = (s3 - s2) * Step;
+        const double d00 = (6. * s2 - 6. * s) / Step;
+        const double d10 = 3. * s2 - 4. * s + 1.;
+        const double d01 = -d00;
+        const double d11 = 3. * s2 - 2. * s;
+
+        const double* p0 = &Nodes[(body * NumNodes + i) * 6];
+        const double* p1 = p0 + 6;
+        for (int32 k = 0; k < 3; ++k)
+        {
+            state[k] = h00 * p0[k] + h10 * p0[k + 3] + h01 * p1[k] + h11 * p1[k + 3];
+            state[k + 3] = d00 * p0[k] + d10 * p0[k + 3] + d01 * p1[k] + d11 * p1[k + 3];
+        }
+    }
+
+    void FTrajectory::Reset()
+    {
+        Legs.Reset();
+        LegBegin.Reset();
+        Orbits.Reset();
+        Nodes.Reset();
+        NumBodies = NumNodes = 0;
+        First = Last = 0.;
+    }
+
+    bool FTrajectory::Build(
+        const FSystem& System,
+        int32 body,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        const FSettings& Settings,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        Reset();
+        if (BuildLegs(System, body, State, et, etEnd, Settings, ResultCode, ErrorMessage))
+        {
+            return true;
+        }
+
+        // Don't leave a partial trajectory behind
+        Reset();
+        return false;
+    }
+
+    bool FTrajectory::BuildLegs(
+        const FSystem& System,
+        int32 body,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        const FSettings& Settings,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        First = Last = et.seconds;
+
+        if (!CheckSystem(System, body, ResultCode, ErrorMessage) || !CheckSettings(Settings, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+        if (etEnd.seconds < et.seconds)
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::PatchedConics: etEnd is before et"));
+        }
+
+        // Sample every body but the root, relative to the root
+        const double Span = etEnd.seconds - et.seconds;
+        NumBodies = System.Bodies.Num();
+        NumNodes = FMath::Max(2, 1 + FMath::CeilToInt32(Span / Settings.EphemerisStep.seconds));
+        Step = Span > 0. ? Span / (NumNodes - 1) : Settings.EphemerisStep.seconds;
+        Nodes.SetNumZeroed(NumBodies * NumNodes * 6);
+
+        auto _root = StringCast<ANSICHAR>(*System.Bodies[0].Name);
+        auto _frame = StringCast<ANSICHAR>(*System.Frame);
+        for (int32 b = 1; b < NumBodies; ++b)
+        {
+            auto _target = StringCast<ANSICHAR>(*System.Bodies[b].Name);
+            for (int32 i = 0; i < NumNodes; ++i)
+            {
+                SpiceDouble _lt;
+                spkezr_c(_target.Get(), First + i * Step, _frame.Get(), "NONE", _root.Get(), &Nodes[(b * NumNodes + i) * 6], &_lt);
+
+                if (ErrorCheck(ResultCode, ErrorMessage))
+                {
+                    return false;
+                }
+            }
+        }
+
+        Last = etEnd.seconds;
+
+        TArray<TArray<int32>> Children;
+        Children.SetNum(NumBodies);
+        for (int32 b = 1; b < NumBodies; ++b)
+        {
+            Children[System.Bodies[b].Parent].Add(b);
+        }
+
+        double t = First;
+        int32 Center = body;
+        FSStateVector Current = State;
+
+        while (true)
+        {
+            if (Legs.Num() >= Settings.MaxLegs)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: the trajectory has more than %d legs"), Settings.MaxLegs));
+            }
+
+            FLeg Leg;
+            Leg.Begin = FSEphemerisTime(t);
+            Leg.Body = Center;
+            if (!Conics::Osculate(TConstArrayView<FSStateVector>(&Current, 1), Leg.Begin, System.Bodies[Center].GM, TArrayView<FSConicElements>(&Leg.Elements, 1), ResultCode, ErrorMessage)
+                || !Orbits.Add(Leg.Elements, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+            Legs.Add(Leg);
+            LegBegin.Add(t);
+
+            const int32 LegIndex = Legs.Num() - 1;
+            const double Soi = Center > 0 ? System.Bodies[Center].SphereOfInfluence.km : 0.;
+
+            auto LegState = [&](double When, FSStateVector& Out)
+            {
+                const FSEphemerisTime At(When);
+                return Orbits.Evaluate(TConstArrayView<int32>(&LegIndex, 1), TConstArrayView<FSEphemerisTime>(&At, 1), TArrayView<FSStateVector>(&Out, 1), ResultCode, ErrorMessage);
+            };
+
+            // The body the vehicle has crossed into at When, if any, and the
+            // time to the nearest boundary at the current closing speed
+            auto Crossed = [&](double When, const FSStateVector& Local, double* TimeToBoundary) -> int32
+            {
+                double s[6];
+                Local.CopyTo(s);
+                double Origin[6];
+                BodyState(Center, When, Origin);
+
+                double Nearest = DBL_MAX;
+                if (Center > 0)
+                {
+                    const double r = FMath::Sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+                    if (r > Soi) return System.Bodies[Center].Parent;
+                    const double v = FMath::Sqrt(s[3] * s[3] + s[4] * s[4] + s[5] * s[5]);
+                    Nearest = FMath::Min(Nearest, (Soi - r) / FMath::Max(v, DBL_MIN));
+                }
+
+                for (int32 Child : Children[Center])
+                {
+                    double Other[6];
+                    BodyState(Child, When, Other);
+                    for (int32 k = 0; k < 6; ++k) Other[k] -= Origin[k];
+
+                    const double d = Distance(s, Other);
+                    const double ChildSoi = System.Bodies[Child].SphereOfInfluence.km;
+                    if (d < ChildSoi) return Child;
+                    const double v = Distance(s + 3, Other + 3);
+                    Nearest = FMath::Min(Nearest, (d - ChildSoi) / FMath::Max(v, DBL_MIN));
+                }
+
+                if (TimeToBoundary) *TimeToBoundary = Nearest;
+                return INDEX_NONE;
+            };
+
+            double t0 = t;
+            FSStateVector State0 = Current;
+            int32 Next = INDEX_NONE;
+            double TimeToBoundary = DBL_MAX;
+            Crossed(t0, State0, &TimeToBoundary);
+
+            while (t0 < Last)
+            {
+                const double dt = FMath::Clamp(Settings.StepFactor * TimeToBoundary, Settings.MinStep.seconds, Settings.MaxStep.seconds);
+                const double t1 = FMath::Min(t0 + dt, Last);
+
+                FSStateVector State1;
+                if (!LegState(t1, State1))
+                {
+                    return false;
+                }
+
+                Next = Crossed(t1, State1, &TimeToBoundary);
+                if (Next == INDEX_NONE)
+                {
+                    t0 = t1;
+                    State0 = State1;
+                    continue;
+                }
+
+                // Bisect, keeping [no crossing, crossing]
+                double Lo = t0, Hi = t1;
+                FSStateVector StateHi = State1;
+                while (Hi - Lo > Settings.Tolerance.seconds)
+                {
+                    const double Mid = 0.5 * (Lo + Hi);
+                    FSStateVector StateMid;
+                    if (!LegState(Mid, StateMid))
+                    {
+                        return false;
+                    }
+
+                    const int32 Into = Crossed(Mid, StateMid, nullptr);
+                    if (Into == INDEX_NONE)
+                    {
+                        Lo = Mid;
+                    }
+                    else
+                    {
+                        Hi = Mid;
+                        StateHi = StateMid;
+                        Next = Into;
+                    }
+                }
+
+                // Re-reference to the new body
+                double s[6], From[6], To[6];
+                StateHi.CopyTo(s);
+                BodyState(Center, Hi, From);
+                BodyState(Next, Hi, To);
+                for (int32 k = 0; k < 6; ++k) s[k] += From[k] - To[k];
+
+                t = Hi;
+                Center = Next;
+                Current = FSStateVector(s);
+                break;
+            }
+
+            if (Next == INDEX_NONE)
+            {
+                break;
+            }
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    int32 FTrajectory::FindLeg(const FSEphemerisTime& et) const
+    {
+        return FMath::Max(0, Algo::UpperBound(LegBegin, et.seconds) - 1);
+    }
+
+    int32 FTrajectory::Lookup(TConstArrayView<FSEphemerisTime> ets, TArray<int32>& Indices) const
+    {
+        Indices.SetNumUninitialized(ets.Num());
+
+        int32 FirstOutside = INDEX_NONE;
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            Indices[i] = FindLeg(ets[i]);
+            if (!(ets[i].seconds >= First && ets[i].seconds <= Last) && FirstOutside == INDEX_NONE)
+            {
+                FirstOutside = i;
+            }
+        }
+        return FirstOutside;
+    }
+
+    bool FTrajectory::Evaluate(const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        return Evaluate(TConstArrayView<FSEphemerisTime>(&et, 1), TArrayView<FSStateVector>(&State, 1), ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::EvaluateLocal(const FSEphemerisTime& et, FSStateVector& State, int32& Body, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        return EvaluateLocal(TConstArrayView<FSEphemerisTime>(&et, 1), TArrayView<FSStateVector>(&State, 1), TArrayView<int32>(&Body, 1), ResultCode, ErrorMessage);
+    }
+
+    bool FTrajectory::Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(States.Num() == ets.Num());
+
+        TArray<FSStateVector> Local;
+        TArray<int32> Bodies;
+        Local.SetNum(ets.Num());
+        Bodies.Init(INDEX_NONE, ets.Num());
+        const bool bSucceeded = EvaluateLocal(ets, Local, Bodies, ResultCode, ErrorMessage);
+
+        ForEachBatch(ets.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                if (Bodies[i] == INDEX_NONE) continue;
+
+                double s[6], Origin[6];
+                Local[i].CopyTo(s);
+                BodyState(Bodies[i], ets[i].seconds, Origin);
+                for (int32 k = 0; k < 6; ++k) s[k] += Origin[k];
+                States[i] = FSStateVector(s);
+            }
+        });
+
+        return bSucceeded;
+    }
+
+    bool FTrajectory::EvaluateLocal(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, TArrayView<int32> Bodies, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(States.Num() == ets.Num() && Bodies.Num() == ets.Num());
+
+        if (Legs.Num() == 0)
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::PatchedConics: the trajectory hasn't been built"));
+        }
+
+        TArray<int32> Indices;
+        const int32 FirstOutside = Lookup(ets, Indices);
+
+        TArray<FSStateVector> Local;
+        Local.SetNum(ets.Num());
+        if (!Orbits.Evaluate(Indices, ets, Local, ResultCode, ErrorMessage))
+        {
+            for (int32 i = 0; i < ets.Num(); ++i) Bodies[i] = INDEX_NONE;
+            return false;
+        }
+
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            if (ets[i].seconds >= First && ets[i].seconds <= Last)
+            {
+                States[i] = Local[i];
+                Bodies[i] = Legs[Indices[i]].Body;
+            }
+            else
+            {
+                Bodies[i] = INDEX_NONE;
+            }
+        }
+
+        if (FirstOutside != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::PatchedConics: ET %f is outside the trajectory, [%f, %f]"), ets[FirstOutside].seconds, First, Last));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,1541 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePropagator.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Numerical orbit propagation with perturbations
+//
+// States are integrated as y = (r, v), dy/dt = (v, a).
+//
+// DOP853 follows Hairer's implementation (and SciPy's port of it): step size
+// control from the combined 5th/3rd order error estimate, and the 7th order
+// dense output, which costs three more force evaluations per step, and only
+// on steps that have an output epoch in them.
+//
+// Gauss-Jackson is in Berry & Healy's summed form.  s and S, the first and
+// second sums of the accelerations, carry the integral from step to step;
+// the position and velocity at step j are
+//   r(j) = h^2 * (S(j) + sum_k GaussJackson::A[j][k] * a(k))
+//   v(j) = h   * (s(j) + sum_k GaussJackson::B[j][k] * a(k))
+// over a window of nine accelerations.  The coefficients are exact for
+// accelerations that are polynomials of degree 8 over the window.  Startup
+// takes DOP853 to four steps either side of the initial epoch, then
+// iterates the window until it's self-consistent.
+//
+// PropagateTransition() integrates the variational equations alongside the
+// state, the 36 elements of the transition matrix appended to y.  The point
+// mass's gravity gradient is analytic; the perturbations' partials are
+// central differences, which are accurate to far better than the
+// perturbations' share of the gradient.
+//
+// Zonal accelerations are the gradient of
+//   U = GM / r * (1 - sum_n Jn * (R / r)^n * Pn(u)),  u = (r . pole) / r
+// with the Legendre polynomials Pn and their derivatives from the usual
+// recurrences.
+//
+// A gravity field is evaluated in the body-fixed frame.  Positions are
+// turned back about the spin axis by the spin since OrientationEpoch, then
+// rotated by Orientation, and the acceleration goes the same way back.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePropagator.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpicePropagator.h"
+#include "SpiceUtilities.h"
+#include "Misc/ScopeLock.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Propagator
+{
+    namespace
+    {
+        // Vehicles per batch, per worker.  Each is a whole integration.
+        constexpr int32 BatchSize = 4;
+
+        // A state, and a state with its transition matrix
+        constexpr int32 StateSize = 6;
+        constexpr int32 VariationalSize = 6 + 36;
+
+        // Relative step of the perturbations' central differences
+        constexpr double DifferenceStep = 1e-5;
+
+        // DOP853 step size control
+        constexpr double Safety = 0.9;
+        constexpr double MinFactor = 0.2;
+        constexpr double MaxFactor = 10.;
+        constexpr double ErrorExponent = -1. / 8.;
+
+        // Gauss-Jackson startup window, either side of the initial epoch
+        constexpr int32 StartupSteps = 4;
+        constexpr int32 WindowSize = 2 * StartupSteps + 1;
+        constexpr int32 MaxStartupIterations = 10;
+        constexpr int32 MaxCorrections = 4;
+
+        // Arcs shorter than this many fixed steps aren't worth the
+        // Gauss-Jackson startup, and are integrated with DOP853
+        constexpr int32 MinGaussJacksonSteps = 2 * WindowSize;
+
+        // Dormand & Prince's 8(5,3) coefficients, from Hairer's DOP853
+        namespace Dop853
+        {
+            constexpr int32 Stages = 12;
+            constexpr int32 ExtendedStages = 16;
+
+            constexpr double C[ExtendedStages] = {
+                0., 0.05260015195876773, 0.0789002279381516, 0.1183503419072274, 0.2816496580927726, 0.3333333333333333, 0.25, 0.3076923076923077,
+                0.6512820512820513, 0.6, 0.8571428571428571, 1., 1., 0.1, 0.2, 0.7777777777777778
+            };
+
+            // Row Stages is the solution's weights; the rows after it are the
+            // dense output's extra stages
+            constexpr double A[ExtendedStages][ExtendedStages - 1] = {
+                { },
+                { 0.05260015195876773 },
+                { 0.0197250569845379, 0.0591751709536137 },
+                { 0.02958758547680685, 0., 0.08876275643042054 },
+                { 0.2413651341592667, 0., -0.8845494793282861, 0.924834003261792 },
+                { 0.037037037037037035, 0., 0., 0.17082860872947386, 0.12546768756682242 },
+                { 0.037109375, 0., 0., 0.17025221101954405, 0.06021653898045596, -0.017578125 },
+                { 0.03709200011850479, 0., 0., 0.17038392571223998, 0.10726203044637328, -0.015319437748624402, 0.008273789163814023 },
+                { 0.6241109587160757, 0., 0., -3.3608926294469414, -0.868219346841726, 27.59209969944671, 20.154067550477894, -43.48988418106996 },
+                { 0.47766253643826434, 0., 0., -2.4881146199716677, -0.590290826836843, 21.230051448181193, 15.279233632882423, -33.28821096898486, -0.020331201708508627 },
+                { -0.9371424300859873, 0., 0., 5.186372428844064, 1.0914373489967295, -8.149787010746927, -18.52006565999696, 22.739487099350505, 2.4936055526796523, -3.0467644718982196 },
+                { 2.273310147516538, 0., 0., -10.53449546673725, -2.0008720582248625, -17.9589318631188, 27.94888452941996, -2.8589982771350235, -8.87285693353063, 12.360567175794303, 0.6433927460157636 },
+                { 0.054293734116568765, 0., 0., 0., 0., 4.450312892752409, 1.8915178993145003, -5.801203960010585, 0.3111643669578199, -0.1521609496625161, 0.20136540080403034, 0.04471061572777259 },
+                { 0.056167502283047954, 0., 0., 0., 0., 0., 0.25350021021662483, -0.2462390374708025, -0.12419142326381637, 0.15329179827876568, 0.00820105229563469, 0.007567897660545699, -0.008298 },
+                { 0.03183464816350214, 0., 0., 0., 0., 0.028300909672366776, 0.053541988307438566, -0.05492374857139099, 0., 0., -0.00010834732869724932, 0.0003825710908356584, -0.00034046500868740456, 0.1413124436746325 },
+                { -0.42889630158379194, 0., 0., 0., 0., -4.697621415361164, 7.683421196062599, 4.06898981839711, 0.3567271874552811, 0., 0., 0., -0.0013990241651590145, 2.9475147891527724, -9.15095847217987 }
+            };
+
+            // 3rd and 5th order error estimates
+            constexpr double E3[Stages] = {
+                -0.18980075407240762, 0., 0., 0., 0., 4.450312892752409, 1.8915178993145003, -5.801203960010585, -0.4226823213237919, -0.1521609496625161, 0.20136540080403034, 0.02265179219836082
+            };
+            constexpr double E5[Stages] = {
+                0.01312004499419488, 0., 0., 0., 0., -1.2251564463762044, -0.4957589496572502, 1.6643771824549864, -0.35032884874997366, 0.3341791187130175, 0.08192320648511571, -0.022355307863886294
+            };
+
+            // Dense output, 4th through 7th coefficients
+            constexpr double D[4][ExtendedStages] = {
+                { -8.428938276109013, 0., 0., 0., 0., 0.5667149535193777, -3.0689499459498917, 2.38466765651207, 2.117034582445028, -0.871391583777973, 2.2404374302607883, 0.6315787787694688, -0.08899033645133331, 18.148505520854727, -9.194632392478356, -4.436036387594894 },
+                { 10.427508642579134, 0., 0., 0., 0., 242.28349177525817, 165.20045171727028, -374.5467547226902, -22.113666853125306, 7.733432668472264, -30.674084731089398, -9.332130526430229, 15.697238121770845, -31.139403219565178, -9.35292435884448, 35.81684148639408 },
+                { 19.985053242002433, 0., 0., 0., 0., -387.0373087493518, -189.17813819516758, 527.8081592054236, -11.57390253995963, 6.8812326946963, -1.0006050966910838, 0.7777137798053443, -2.778205752353508, -60.19669523126412, 84.32040550667716, 11.99229113618279 },
+                { -25.69393346270375, 0., 0., 0., 0., -154.18974869023643, -231.5293791760455, 357.6391179106141, 93.40532418362432, -37.45832313645163, 104.0996495089623, 29.8402934266605, -43.53345659001114, 96.32455395918828, -39.17726167561544, -149.72683625798564 }
+            };
+        }
+
+        // 8th order Gauss-Jackson ordinate coefficients, for a window of
+        // accelerations at steps -4..4.  Row j + 4 is for the state at step
+        // j: -4..4 during startup, 4 for the corrector, and 5 (extrapolated)
+        // for the predictor.  The predictor's B row also extrapolates the
+        // a(n+1) / 2 term of s(n+1).
+        namespace GaussJackson
+        {
+            constexpr double A[WindowSize + 1][WindowSize] = {
+                { 3250463. / 53222400., 4009007. / 39916800., -8701051. / 39916800., 4025891. / 13305600., -916913. / 3193344., 7369409. / 39916800., -1025569. / 13305600., 754151. / 39916800., -330067. / 159667200. },
+                { -330067. / 159667200., 530083. / 6652800., 259601. / 9979200., -442411. / 9979200., 44815. / 1064448., -532151. / 19958400., 219001. / 19958400., -4421. / 1663200., 46001. / 159667200. },
+                { 46001. / 159667200., -186019. / 39916800., 171167. / 1900800., 72383. / 39916800., -25649. / 3193344., 77177. / 13305600., -98281. / 39916800., 23993. / 39916800., -3469. / 53222400. },
+                { -3469. / 53222400., 1247. / 1425600., -139841. / 19958400., 90787. / 950400., -20435. / 3193344., 901. / 4989600., 541. / 1663200., -2309. / 19958400., 2309. / 159667200. },
+                { 2309. / 159667200., -2599. / 13305600., 55697. / 39916800., -328171. / 39916800., 14803. / 152064., -328171. / 39916800., 55697. / 39916800., -2599. / 13305600., 2309. / 159667200. },
+                { 2309. / 159667200., -2309. / 19958400., 541. / 1663200., 901. / 4989600., -20435. / 3193344., 90787. / 950400., -139841. / 19958400., 1247. / 1425600., -3469. / 53222400. },
+                { -3469. / 53222400., 23993. / 39916800., -98281. / 39916800., 77177. / 13305600., -25649. / 3193344., 72383. / 39916800., 171167. / 1900800., -186019. / 39916800., 46001. / 159667200. },
+                { 46001. / 159667200., -4421. / 1663200., 219001. / 19958400., -532151. / 19958400., 44815. / 1064448., -442411. / 9979200., 259601. / 9979200., 530083. / 6652800., -330067. / 159667200. },
+                { -330067. / 159667200., 754151. / 39916800., -1025569. / 13305600., 7369409. / 39916800., -916913. / 3193344., 4025891. / 13305600., -8701051. / 39916800., 4009007. / 39916800., 3250463. / 53222400. },
+                { 3250463. / 53222400., -11011571. / 19958400., 3161309. / 1425600., -17321323. / 3326400., 25163053. / 3193344., -159315083. / 19958400., 36142807. / 6652800., -1507243. / 623700., 103798529. / 159667200. }
+            };
+
+            constexpr double B[WindowSize + 1][WindowSize] = {
+                { 19087. / 89600., -427487. / 725760., 3498217. / 3628800., -500327. / 403200., 6467. / 5670., -2616161. / 3628800., 24019. / 80640., -263077. / 3628800., 8183. / 1036800. },
+                { 8183. / 1036800., 57251. / 403200., -1106377. / 3628800., 218483. / 725760., -69. / 280., 530177. / 3628800., -210359. / 3628800., 5533. / 403200., -425. / 290304. },
+                { -425. / 290304., 76453. / 3628800., 5143. / 57600., -660127. / 3628800., 661. / 5670., -4997. / 80640., 83927. / 3628800., -19109. / 3628800., 7. / 12800. },
+                { 7. / 12800., -23173. / 3628800., 29579. / 725760., 2497. / 57600., -2563. / 22680., 172993. / 3628800., -6463. / 403200., 2497. / 725760., -2497. / 7257600. },
+                { -2497. / 7257600., 1469. / 403200., -68119. / 3628800., 252769. / 3628800., 0., -252769. / 3628800., 68119. / 3628800., -1469. / 403200., 2497. / 7257600. },
+                { 2497. / 7257600., -2497. / 725760., 6463. / 403200., -172993. / 3628800., 2563. / 22680., -2497. / 57600., -29579. / 725760., 23173. / 3628800., -7. / 12800. },
+                { -7. / 12800., 19109. / 3628800., -83927. / 3628800., 4997. / 80640., -661. / 5670., 660127. / 3628800., -5143. / 57600., -76453. / 3628800., 425. / 290304. },
+                { 425. / 290304., -5533. / 403200., 210359. / 3628800., -530177. / 3628800., 69. / 280., -218483. / 725760., 1106377. / 3628800., -57251. / 403200., -8183. / 1036800. },
+                { -8183. / 1036800., 263077. / 3628800., -24019. / 80640., 2616161. / 3628800., -6467. / 5670., 500327. / 403200., -3498217. / 3628800., 427487. / 725760., -19087. / 89600. },
+                { 25713. / 89600., -9401029. / 3628800., 5393233. / 518400., -9839609. / 403200., 167287. / 4536., -135352319. / 3628800., 10219841. / 403200., -40987771. / 3628800., 3288521. / 1036800. }
+            };
+
+            constexpr int32 Corrector = WindowSize - 1;
+            constexpr int32 Predictor = WindowSize;
+        }
+
+        enum class EStatus : uint8
+        {
+            Done,
+            TooManySteps,
+            StepUnderflow,
+            Diverged
+        };
+
+        FString StatusMessage(EStatus Status, double et, const FSettings& Settings)
+        {
+            switch (Status)
+            {
+            case EStatus::TooManySteps:
+                return FString::Printf(TEXT("took more than %d steps"), Settings.MaxSteps);
+            case EStatus::StepUnderflow:
+                return FString::Printf(TEXT("step size underflowed at ET %f"), et);
+            case EStatus::Diverged:
+                return FString::Printf(TEXT("diverged at ET %f"), et);
+            default:
+                return FString();
+            }
+        }
+
+        inline double Dot(const double* a, const double* b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline void Copy(const double* From, double* To, int32 Count = 6)
+        {
+            for (int32 i = 0; i < Count; ++i) To[i] = From[i];
+        }
+
+        // v rotated by Angle about the unit Axis (Rodrigues)
+        inline void Rotate(const double* Axis, double Angle, const double* v, double* Out)
+        {
+            const double c = FMath::Cos(Angle);
+            const double s = FMath::Sin(Angle);
+            const double k = Dot(Axis, v) * (1. - c);
+            Out[0] = v[0] * c + (Axis[1] * v[2] - Axis[2] * v[1]) * s + Axis[0] * k;
+            Out[1] = v[1] * c + (Axis[2] * v[0] - Axis[0] * v[2]) * s + Axis[1] * k;
+            Out[2] = v[2] * c + (Axis[0] * v[1] - Axis[1] * v[0]) * s + Axis[2] * k;
+        }
+
+        inline FSStateVector ToState(const double* y)
+        {
+            return FSStateVector(FSDistanceVector(y[0], y[1], y[2]), FSVelocityVector(y[3], y[4], y[5]));
+        }
+
+        // Third-body positions relative to the center, sampled from SPK at
+        // evenly spaced nodes, Hermite-interpolated between them.
+        class FEphemerisTable
+        {
+        public:
+            bool Sample(const FForceModel& Model, double Begin, double End, ES_ResultCode* ResultCode, FString* ErrorMessage)
+            {
+                NumBodies = Model.ThirdBodies.Num();
+                if (NumBodies == 0)
+                {
+                    return true;
+                }
+
+                const double Span = End - Begin;
+                NumNodes = FMath::Max(2, 1 + FMath::CeilToInt32(Span / Model.EphemerisStep.seconds));
+                Start = Begin;
+                Step = Span > 0. ? Span / (NumNodes - 1) : Model.EphemerisStep.seconds;
+                Nodes.SetNumUninitialized(NumBodies * NumNodes * 6);
+
+                auto _center = StringCast<ANSICHAR>(*Model.Center);
+                auto _frame = StringCast<ANSICHAR>(*Model.Frame);
+
+                for (int32 Body = 0; Body < NumBodies; ++Body)
+                {
+                    auto _target = StringCast<ANSICHAR>(*Model.ThirdBodies[Body].Name);
+                    for (int32 i = 0; i < NumNodes; ++i)
+                    {
+                        SpiceDouble _lt;
+                        spkezr_c(_target.Get(), Start + i * Step, _frame.Get(), "NONE", _center.Get(), &Nodes[(Body * NumNodes + i) * 6], &_lt);
+
+                        if (ErrorCheck(ResultCode, ErrorMessage))
+                        {
+                            return false;
+                        }
+                    }
+                }
+
+                return true;
+            }
+
+            void Position(int32 Body, double et, double* r) const
+            {
+                const double u = (et - Start) / Step;
+                const int32 i = FMath::Clamp(FMath::FloorToInt32(u), 0, NumNodes - 2);
+                const double s = u - i;
+                const double s2 = s * s;
+                const double s3 = s2 * s;
+
+                // Cubic Hermite basis, with the tangents scaled to the interval
+                const double h00 = 2. * s3 - 3. * s2 + 1.;
+                const double h10 = (s3 - 2. * s2 + s) * Step;
+                const double h01 = 3. * s2 - 2. * s3;
+                const double h11 = (s3 - s2) * Step;
+
+                const double* p0 = &Nodes[(Body * NumNodes + i) * 6];
+                const double* p1 = p0 + 6;
+                for (int32 k = 0; k < 3; ++k)
+                {
+                    r[k] = h00 * p0[k] + h10 * p0[k + 3] + h01 * p1[k] + h11 * p1[k + 3];
+                }
+            }
+
+        private:
+            int32 NumBodies = 0;
+            int32 NumNodes = 0;
+            double Start = 0.;
+            double Step = 1.;
+            // Body-major, then node, then state
+            TArray<double> Nodes;
+        };
+
+        // The force model, in the form the integrators use
+        class FForces
+        {
+        public:
+            FForces(const FForceModel& Model, const FEphemerisTable& InEphemeris)
+                : Ephemeris(InEphemeris)
+            {
+                GM = Model.GM.GM;
+                R = Model.ReferenceRadius.km;
+                Model.Pole.Normalized().CopyTo(Pole);
+
+                if (Model.GravityField.IsValid())
+                {
+                    Field = Model.GravityField.Get();
+                    Model.Orientation.CopyTo(Orientation);
+                    OrientationEpoch = Model.OrientationEpoch.seconds;
+
+                    double Spin[3];
+                    Model.AtmosphereRotation.CopyTo(Spin);
+                    SpinRate = FMath::Sqrt(Dot(Spin, Spin));
+                    if (SpinRate > 0.)
+                    {
+                        for (int32 i = 0; i < 3; ++i) SpinAxis[i] = Spin[i] / SpinRate;
+                    }
+                }
+                else
+                {
+                    for (int32 n = 0; n <= FForceModel::MaxZonalDegree; ++n)
+                    {
+                        J[n] = n >= 2 ? Model.J[n] : 0.;
+                        if (J[n] != 0.) ZonalDegree = n;
+                    }
+                }
+
+                for (const FThirdBody& Body : Model.ThirdBodies)
+                {
+                    ThirdBodyGM.Add(Body.GM.GM);
+                }
+
+                bPerturbed = ZonalDegree >= 2 || Field != nullptr || ThirdBodyGM.Num() > 0;
+
+                if (Model.BallisticCoefficient > 0. && Model.AtmosphereDensity > 0.)
+                {
+                    // kg/m^3 * m^2/kg = 1/m = 1000/km
+                    DragFactor = 0.5 * Model.BallisticCoefficient * Model.AtmosphereDensity * 1000.;
+                    DragAltitude = R + Model.AtmosphereAltitude.km;
+                    InverseScaleHeight = 1. / Model.ScaleHeight.km;
+                    Model.AtmosphereRotation.CopyTo(Omega);
+                    bPerturbed = true;
+                }
+            }
+
+            void Acceleration(double et, const double* r, const double* v, double* a) const
+            {
+                const double r2 = Dot(r, r);
+                const double rn = FMath::Sqrt(r2);
+                const double k = -GM / (r2 * rn);
+                for (int32 i = 0; i < 3; ++i) a[i] = k * r[i];
+
+                AddPerturbations(et, r, v, a);
+            }
+
+            // da/dr and da/dv: the point mass's analytically, the rest by
+            // central differences
+            void Jacobian(double et, const double* r, const double* v, double(&dadr)[3][3], double(&dadv)[3][3]) const
+            {
+                const double r2 = Dot(r, r);
+                const double rn = FMath::Sqrt(r2);
+                const double k = GM / (r2 * rn);
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    for (int32 j = 0; j < 3; ++j)
+                    {
+                        dadr[i][j] = 3. * k * r[i] * r[j] / r2 - (i == j ? k : 0.);
+                        dadv[i][j] = 0.;
+                    }
+                }
+
+                if (!bPerturbed)
+                {
+                    return;
+                }
+
+                const double hr = DifferenceStep * rn;
+                for (int32 j = 0; j < 3; ++j)
+                {
+                    double rPlus[3], rMinus[3], aPlus[3] = {}, aMinus[3] = {};
+                    Copy(r, rPlus, 3);
+                    Copy(r, rMinus, 3);
+                    rPlus[j] += hr;
+                    rMinus[j] -= hr;
+                    AddPerturbations(et, rPlus, v, aPlus);
+                    AddPerturbations(et, rMinus, v, aMinus);
+                    for (int32 i = 0; i < 3; ++i) dadr[i][j] += (aPlus[i] - aMinus[i]) / (2. * hr);
+                }
+
+                if (DragFactor > 0.)
+                {
+                    const double hv = DifferenceStep * FMath::Max(FMath::Sqrt(Dot(v, v)), 1e-3);
+                    for (int32 j = 0; j < 3; ++j)
+                    {
+                        double vPlus[3], vMinus[3], aPlus[3] = {}, aMinus[3] = {};
+                        Copy(v, vPlus, 3);
+                        Copy(v, vMinus, 3);
+                        vPlus[j] += hv;
+                        vMinus[j] -= hv;
+                        AddPerturbations(et, r, vPlus, aPlus);
+                        AddPerturbations(et, r, vMinus, aMinus);
+                        for (int32 i = 0; i < 3; ++i) dadv[i][j] = (aPlus[i] - aMinus[i]) / (2. * hv);
+                    }
+                }
+            }
+
+            // y is (r, v), followed by the row-major transition matrix when
+            // N is VariationalSize, whose derivative is
+            //   d(Phi)/dt = | 0      I     | * Phi
+            //               | da/dr  da/dv |
+            template<int32 N>
+            void Derivative(double et, const double* y, double* dy) const
+            {
+                Copy(y + 3, dy, 3);
+                Acceleration(et, y, y + 3, dy + 3);
+
+                if constexpr (N == VariationalSize)
+                {
+                    double dadr[3][3], dadv[3][3];
+                    Jacobian(et, y, y + 3, dadr, dadv);
+
+                    const double* Phi = y + 6;
+                    double* dPhi = dy + 6;
+                    Copy(Phi + 18, dPhi, 18);
+                    for (int32 i = 0; i < 3; ++i)
+                    {
+                        for (int32 j = 0; j < 6; ++j)
+                        {
+                            double Sum = 0.;
+                            for (int32 k = 0; k < 3; ++k)
+                            {
+                                Sum += dadr[i][k] * Phi[6 * k + j] + dadv[i][k] * Phi[6 * (k + 3) + j];
+                            }
+                            dPhi[6 * (i + 3) + j] = Sum;
+                        }
+                    }
+                }
+            }
+
+        private:
+            void AddPerturbations(double et, const double* r, const double* v, double* a) const
+            {
+                const double r2 = Dot(r, r);
+                const double rn = FMath::Sqrt(r2);
+
+                if (ZonalDegree >= 2)
+                {
+                    const double u = Dot(r, Pole) / rn;
+                    const double Ratio = R / rn;
+
+                    // Pn and Pn' (and P(n-1), P(n-1)') from n = 1
+                    double Pm = 1., P = u;
+                    double dPm = 0., dP = 1.;
+                    double RatioN = Ratio;
+                    double Radial = 0., Axial = 0.;
+
+                    for (int32 n = 1; n < ZonalDegree; ++n)
+                    {
+                        const double Pn = ((2 * n + 1) * u * P - n * Pm) / (n + 1);
+                        const double dPn = dPm + (2 * n + 1) * P;
+                        Pm = P;
+                        P = Pn;
+                        dPm = dP;
+                        dP = dPn;
+                        RatioN *= Ratio;
+
+                        const int32 Degree = n + 1;
+                        if (J[Degree] != 0.)
+                        {
+                            const double Term = J[Degree] * RatioN;
+                            Radial += Term * ((Degree + 1) * P + u * dP);
+                            Axial -= Term * dP;
+                        }
+                    }
+
+                    const double Scale = GM / r2;
+                    for (int32 i = 0; i < 3; ++i)
+                    {
+                        a[i] += Scale * (Radial * r[i] / rn + Axial * Pole[i]);
+                    }
+                }
+
+                if (Field)
+                {
+                    const double Angle = SpinRate * (et - OrientationEpoch);
+                    double Turned[3], Fixed[3], Back[3], Inertial[3];
+                    Rotate(SpinAxis, -Angle, r, Turned);
+                    for (int32 i = 0; i < 3; ++i) Fixed[i] = Dot(Orientation[i], Turned);
+
+                    // Degree 1 up, the point mass being the caller's
+                    Gravity::FAcceleration Perturbation;
+                    Field->Acceleration(FSDistanceVector(Fixed[0], Fixed[1], Fixed[2]), Perturbation, nullptr, 1);
+
+                    for (int32 i = 0; i < 3; ++i)
+                    {
+                        Back[i] = Orientation[0][i] * Perturbation.a[0] + Orientation[1][i] * Perturbation.a[1] + Orientation[2][i] * Perturbation.a[2];
+                    }
+                    Rotate(SpinAxis, Angle, Back, Inertial);
+                    for (int32 i = 0; i < 3; ++i) a[i] += Inertial[i];
+                }
+
+                for (int32 Body = 0; Body < ThirdBodyGM.Num(); ++Body)
+                {
+                    double s[3], d[3];
+                    Ephemeris.Position(Body, et, s);
+                    for (int32 i = 0; i < 3; ++i) d[i] = s[i] - r[i];
+
+                    const double s2 = Dot(s, s);
+                    const double d2 = Dot(d, d);
+                    const double ks = ThirdBodyGM[Body] / (s2 * FMath::Sqrt(s2));
+                    const double kd = ThirdBodyGM[Body] / (d2 * FMath::Sqrt(d2));
+                    for (int32 i = 0; i < 3; ++i)
+                    {
+                        a[i] += kd * d[i] - ks * s[i];
+                    }
+                }
+
+                if (DragFactor > 0.)
+                {
+                    // Velocity relative to the co-rotating atmosphere
+                    double w[3];
+                    w[0] = v[0] - (Omega[1] * r[2] - Omega[2] * r[1]);
+                    w[1] = v[1] - (Omega[2] * r[0] - Omega[0] * r[2]);
+                    w[2] = v[2] - (Omega[0] * r[1] - Omega[1] * r[0]);
+
+                    const double Density = DragFactor * FMath::Exp((DragAltitude - rn) * InverseScaleHeight);
+                    const double kw = -Density * FMath::Sqrt(Dot(w, w));
+                    for (int32 i = 0; i < 3; ++i) a[i] += kw * w[i];
+                }
+            }
+
+            const FEphemerisTable& Ephemeris;
+            bool bPerturbed = false;
+
+            double GM = 0.;
+            double R = 0.;
+            double Pole[3] = { 0., 0., 1. };
+            double J[FForceModel::MaxZonalDegree + 1] = {};
+            int32 ZonalDegree = 0;
+
+            const Gravity::FGravityField* Field = nullptr;
+            double Orientation[3][3] = {};
+            double OrientationEpoch = 0.;
+            double SpinAxis[3] = { 0., 0., 1. };
+            double SpinRate = 0.;
+
+            TArray<double> ThirdBodyGM;
+
+            double DragFactor = 0.;
+            double DragAltitude = 0.;
+            double InverseScaleHeight = 0.;
+            double Omega[3] = { 0., 0., 0. };
+        };
+
+        // Hairer's starting step size
+        double InitialStep(const FForces& Forces, const FSettings& Settings, double t, const double* y, const double* f0, double Span)
+        {
+            const double Direction = Span > 0. ? 1. : -1.;
+
+            double Scale[6];
+            double d0 = 0., d1 = 0.;
+            for (int32 i = 0; i < 6; ++i)
+            {
+                Scale[i] = Settings.AbsoluteTolerance + FMath::Abs(y[i]) * Settings.RelativeTolerance;
+                d0 += FMath::Square(y[i] / Scale[i]);
+                d1 += FMath::Square(f0[i] / Scale[i]);
+            }
+            d0 = FMath::Sqrt(d0 / 6.);
+            d1 = FMath::Sqrt(d1 / 6.);
+
+            double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+            h0 = FMath::Min(h0, FMath::Abs(Span));
+
+            double y1[6], f1[6];
+            for (int32 i = 0; i < 6; ++i) y1[i] = y[i] + Direction * h0 * f0[i];
+            Forces.Derivative<StateSize>(t + Direction * h0, y1, f1);
+
+            double d2 = 0.;
+            for (int32 i = 0; i < 6; ++i)
+            {
+                d2 += FMath::Square((f1[i] - f0[i]) / Scale[i]);
+            }
+            d2 = FMath::Sqrt(d2 / 6.) / h0;
+
+            const double h1 = (d1 <= 1e-15 && d2 <= 1e-15)
+                ? FMath::Max(1e-6, h0 * 1e-3)
+                : FMath::Pow(0.01 / FMath::Max(d1, d2), 1. / 8.);
+
+            return FMath::Min3(100. * h0, h1, FMath::Abs(Span));
+        }
+
+        // Integrates y from t to tEnd with DOP853.  OutputTimes must be in
+        // order, between t and tEnd; Outputs gets their y's, N apiece.  Step
+        // size control is on the state alone, so a transition matrix riding
+        // along doesn't change the steps.
+        template<int32 N>
+        EStatus IntegrateDormandPrince(const FForces& Forces, const FSettings& Settings, double& t, double(&y)[N], double tEnd, const double* OutputTimes, double* Outputs, int32 NumOutputs, int32& Steps)
+        {
+            using namespace Dop853;
+
+            int32 Next = 0;
+            while (Next < NumOutputs && OutputTimes[Next] == t)
+            {
+                Copy(y, &Outputs[N * Next++], N);
+            }
+
+            if (t == tEnd)
+            {
+                return EStatus::Done;
+            }
+
+            const double Direction = tEnd > t ? 1. : -1.;
+            const double MaxStep = Settings.MaxStep.seconds != 0. ? FMath::Abs(Settings.MaxStep.seconds) : DBL_MAX;
+
+            double K[ExtendedStages][N];
+            Forces.Derivative<N>(t, y, K[0]);
+
+            double h = FMath::Min(MaxStep, InitialStep(Forces, Settings, t, y, K[0], tEnd - t));
+
+            double yNew[N], Stage[N];
+            for (;;)
+            {
+                if (++Steps > Settings.MaxSteps)
+                {
+                    return EStatus::TooManySteps;
+                }
+
+                double Step = 0.;
+                double tNew = t;
+                bool bRejected = false;
+
+                for (;;)
+                {
+                    if (h < 10. * DBL_EPSILON * FMath::Max(FMath::Abs(t), 1.))
+                    {
+                        return EStatus::StepUnderflow;
+                    }
+
+                    Step = Direction * h;
+                    tNew = t + Step;
+                    if (Direction * (tNew - tEnd) > 0.)
+                    {
+                        Step = tEnd - t;
+                        tNew = tEnd;
+                    }
+
+                    for (int32 s = 1; s < Stages; ++s)
+                    {
+                        for (int32 i = 0; i < N; ++i)
+                        {
+                            double Sum = 0.;
+                            for (int32 j = 0; j < s; ++j) Sum += A[s][j] * K[j][i];
+                            Stage[i] = y[i] + Step * Sum;
+                        }
+                        Forces.Derivative<N>(t + C[s] * Step, Stage, K[s]);
+                    }
+
+                    for (int32 i = 0; i < N; ++i)
+                    {
+                        double Sum = 0.;
+                        for (int32 j = 0; j < Stages; ++j) Sum += A[Stages][j] * K[j][i];
+                        yNew[i] = y[i] + Step * Sum;
+                    }
+                    Forces.Derivative<N>(tNew, yNew, K[Stages]);
+
+                    double Error5 = 0., Error3 = 0.;
+                    for (int32 i = 0; i < StateSize; ++i)
+                    {
+                        const double Scale = Settings.AbsoluteTolerance + FMath::Max(FMath::Abs(y[i]), FMath::Abs(yNew[i])) * Settings.RelativeTolerance;
+                        double e5 = 0., e3 = 0.;
+                        for (int32 j = 0; j < Stages; ++j)
+                        {
+                            e5 += E5[j] * K[j][i];
+                            e3 += E3[j] * K[j][i];
+                        }
+                        Error5 += FMath::Square(e5 / Scale);
+                        Error3 += FMath::Square(e3 / Scale);
+                    }
+
+                    double ErrorNorm = 0.;
+                    if (Error5 > 0. || Error3 > 0.)
+                    {
+                        ErrorNorm = FMath::Abs(Step) * Error5 / FMath::Sqrt((Error5 + 0.01 * Error3) * StateSize);
+                    }
+
+                    if (!FMath::IsFinite(ErrorNorm))
+                    {
+                        h = FMath::Abs(Step) * MinFactor;
+                        bRejected = true;
+                    }
+                    else if (ErrorNorm < 1.)
+                    {
+                        double Factor = ErrorNorm == 0. ? MaxFactor : FMath::Min(MaxFactor, Safety * FMath::Pow(ErrorNorm, ErrorExponent));
+                        if (bRejected) Factor = FMath::Min(1., Factor);
+                        h = FMath::Min(MaxStep, FMath::Abs(Step) * Factor);
+                        break;
+                    }
+                    else
+                    {
+                        h = FMath::Abs(Step) * FMath::Max(MinFactor, Safety * FMath::Pow(ErrorNorm, ErrorExponent));
+                        bRejected = true;
+                    }
+                }
+
+                // Dense output, for any output epochs in this step
+                if (Next < NumOutputs && Direction * (OutputTimes[Next] - tNew) <= 0.)
+                {
+                    for (int32 s = Stages + 1; s < ExtendedStages; ++s)
+                    {
+                        for (int32 i = 0; i < N; ++i)
+                        {
+                            double Sum = 0.;
+                            for (int32 j = 0; j < s; ++j) Sum += A[s][j] * K[j][i];
+                            Stage[i] = y[i] + Step * Sum;
+                        }
+                        Forces.Derivative<N>(t + C[s] * Step, Stage, K[s]);
+                    }
+
+                    double F[7][N];
+                    for (int32 i = 0; i < N; ++i)
+                    {
+                        const double dy = yNew[i] - y[i];
+                        F[0][i] = dy;
+                        F[1][i] = Step * K[0][i] - dy;
+                        F[2][i] = 2. * dy - Step * (K[Stages][i] + K[0][i]);
+                        for (int32 m = 0; m < 4; ++m)
+                        {
+                            double Sum = 0.;
+                            for (int32 j = 0; j < ExtendedStages; ++j) Sum += D[m][j] * K[j][i];
+                            F[m + 3][i] = Step * Sum;
+                        }
+                    }
+
+                    while (Next < NumOutputs && Direction * (OutputTimes[Next] - tNew) <= 0.)
+                    {
+                        const double x = (OutputTimes[Next] - t) / Step;
+                        double* Output = &Outputs[N * Next++];
+                        for (int32 i = 0; i < N; ++i)
+                        {
+                            double Value = 0.;
+                            for (int32 m = 6; m >= 0; --m)
+                            {
+                                Value += F[m][i];
+                                Value *= (m % 2 == 0) ? x : 1. - x;
+                            }
+                            Output[i] = y[i] + Value;
+                        }
+                    }
+                }
+
+                t = tNew;
+                Copy(yNew, y, N);
+                Copy(K[Stages], K[0], N);
+
+                if (t == tEnd)
+                {
+                    return EStatus::Done;
+                }
+            }
+        }
+
+        // Gauss-Jackson's first and second sums over the startup window,
+        // from the state at its middle
+        void StartupSums(const double(&r)[WindowSize][3], const double(&v)[WindowSize][3], const double(&a)[WindowSize][3], double h, double(&s)[WindowSize][3], double(&S)[WindowSize][3])
+        {
+            using namespace GaussJackson;
+            constexpr int32 Middle = StartupSteps;
+
+            for (int32 i = 0; i < 3; ++i)
+            {
+                double SumA = 0., SumB = 0.;
+                for (int32 k = 0; k < WindowSize; ++k)
+                {
+                    SumA += A[Middle][k] * a[k][i];
+                    SumB += B[Middle][k] * a[k][i];
+                }
+                s[Middle][i] = v[Middle][i] / h - SumB;
+                S[Middle][i] = r[Middle][i] / (h * h) - SumA;
+
+                for (int32 j = Middle + 1; j < WindowSize; ++j)
+                {
+                    s[j][i] = s[j - 1][i] + (a[j - 1][i] + a[j][i]) / 2.;
+                    S[j][i] = S[j - 1][i] + s[j - 1][i] + a[j - 1][i] / 2.;
+                }
+                for (int32 j = Middle - 1; j >= 0; --j)
+                {
+                    s[j][i] = s[j + 1][i] - (a[j + 1][i] + a[j][i]) / 2.;
+                    S[j][i] = S[j + 1][i] - s[j][i] - a[j][i] / 2.;
+                }
+            }
+        }
+
+        // Position and velocity from row j of the coefficients
+        void Ordinate(int32 j, const double(&a)[WindowSize][3], const double* s, const double* S, double h, double* r, double* v)
+        {
+            using namespace GaussJackson;
+
+            for (int32 i = 0; i < 3; ++i)
+            {
+                double SumA = 0., SumB = 0.;
+                for (int32 k = 0; k < WindowSize; ++k)
+                {
+                    SumA += A[j][k] * a[k][i];
+                    SumB += B[j][k] * a[k][i];
+                }
+                r[i] = h * h * (S[i] + SumA);
+                v[i] = h * (s[i] + SumB);
+            }
+        }
+
+        inline bool Converged(const double* Old, const double* New, double Tolerance)
+        {
+            const double Limit = Tolerance * FMath::Sqrt(Dot(New, New));
+            return FMath::Abs(New[0] - Old[0]) <= Limit && FMath::Abs(New[1] - Old[1]) <= Limit && FMath::Abs(New[2] - Old[2]) <= Limit;
+        }
+
+        // Integrates y from t to tEnd with Gauss-Jackson, as above
+        EStatus IntegrateGaussJackson(const FForces& Forces, const FSettings& Settings, double& t, double(&y)[6], double tEnd, const double* OutputTimes, double* Outputs, int32 NumOutputs, int32& Steps)
+        {
+            const double Span = tEnd - t;
+            const double h = (Span > 0. ? 1. : -1.) * FMath::Abs(Settings.FixedStep.seconds);
+            const int32 NumSteps = Span != 0. ? FMath::FloorToInt32(FMath::Min(Span / h, double(MAX_int32))) : 0;
+
+            if (NumSteps < MinGaussJacksonSteps)
+            {
+                return IntegrateDormandPrince(Forces, Settings, t, y, tEnd, OutputTimes, Outputs, NumOutputs, Steps);
+            }
+
+            const double t0 = t;
+
+            // Grid steps n-8..n
+            double r[WindowSize][3], v[WindowSize][3], a[WindowSize][3];
+            double s[WindowSize][3], S[WindowSize][3];
+
+            // Startup: DOP853 from t0 out to four steps either way
+            Copy(y, r[StartupSteps], 3);
+            Copy(y + 3, v[StartupSteps], 3);
+            for (double Side : { -1., 1. })
+            {
+                double Times[StartupSteps], States[StartupSteps * 6];
+                for (int32 k = 0; k < StartupSteps; ++k)
+                {
+                    Times[k] = t0 + Side * (k + 1) * h;
+                }
+
+                double ts = t0;
+                double ys[6];
+                Copy(y, ys);
+                const EStatus Status = IntegrateDormandPrince(Forces, Settings, ts, ys, Times[StartupSteps - 1], Times, States, StartupSteps, Steps);
+                if (Status != EStatus::Done)
+                {
+                    t = ts;
+                    return Status;
+                }
+
+                for (int32 k = 0; k < StartupSteps; ++k)
+                {
+                    const int32 w = StartupSteps + (Side > 0. ? k + 1 : -(k + 1));
+                    Copy(&States[6 * k], r[w], 3);
+                    Copy(&States[6 * k + 3], v[w], 3);
+                }
+            }
+
+            for (int32 w = 0; w < WindowSize; ++w)
+            {
+                Forces.Acceleration(t0 + (w - StartupSteps) * h, r[w], v[w], a[w]);
+            }
+
+            // Iterate the startup window until it's consistent with the
+            // Gauss-Jackson formulas
+            for (int32 Iteration = 0; Iteration < MaxStartupIterations; ++Iteration)
+            {
+                StartupSums(r, v, a, h, s, S);
+
+                bool bConverged = true;
+                for (int32 w = 0; w < WindowSize; ++w)
+                {
+                    if (w == StartupSteps) continue;
+
+                    double rNew[3], vNew[3];
+                    Ordinate(w, a, s[w], S[w], h, rNew, vNew);
+                    bConverged &= Converged(r[w], rNew, Settings.RelativeTolerance);
+                    Copy(rNew, r[w], 3);
+                    Copy(vNew, v[w], 3);
+                    Forces.Acceleration(t0 + (w - StartupSteps) * h, r[w], v[w], a[w]);
+                }
+
+                if (bConverged) break;
+            }
+            StartupSums(r, v, a, h, s, S);
+
+            double sn[3], Sn[3];
+            Copy(s[WindowSize - 1], sn, 3);
+            Copy(S[WindowSize - 1], Sn, 3);
+
+            // Outputs between grid steps, by DOP853 from the step before.
+            // Those after the last grid step go with the final stretch.
+            auto GridStep = [&](double et)
+            {
+                return FMath::Clamp(FMath::FloorToInt32((et - t0) / h), 0, NumSteps);
+            };
+
+            int32 Next = 0;
+            auto EmitOutputs = [&](int32 Newest) -> EStatus
+            {
+                while (Next < NumOutputs)
+                {
+                    const int32 m = GridStep(OutputTimes[Next]);
+                    if (m > Newest || m == NumSteps) break;
+
+                    int32 Last = Next + 1;
+                    while (Last < NumOutputs && GridStep(OutputTimes[Last]) == m) ++Last;
+
+                    const int32 w = WindowSize - 1 - (Newest - m);
+                    double tm = t0 + m * h;
+                    double ym[6];
+                    Copy(r[w], ym, 3);
+                    Copy(v[w], ym + 3, 3);
+
+                    const EStatus Status = IntegrateDormandPrince(Forces, Settings, tm, ym, OutputTimes[Last - 1], &OutputTimes[Next], &Outputs[6 * Next], Last - Next, Steps);
+                    if (Status != EStatus::Done)
+                    {
+                        t = tm;
+                        return Status;
+                    }
+                    Next = Last;
+                }
+                return EStatus::Done;
+            };
+
+            EStatus Status = EmitOutputs(StartupSteps);
+            if (Status != EStatus::Done) return Status;
+
+            for (int32 n = StartupSteps; n < NumSteps; ++n)
+            {
+                if (++Steps > Settings.MaxSteps)
+                {
+                    return EStatus::TooManySteps;
+                }
+
+                const double tNext = t0 + (n + 1) * h;
+
+                // Predict
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    Sn[i] += sn[i] + a[WindowSize - 1][i] / 2.;
+                }
+
+                double sPredict[3];
+                for (int32 i = 0; i < 3; ++i) sPredict[i] = sn[i] + a[WindowSize - 1][i] / 2.;
+
+                double rNext[3], vNext[3], aNext[3];
+                Ordinate(GaussJackson::Predictor, a, sPredict, Sn, h, rNext, vNext);
+                Forces.Acceleration(tNext, rNext, vNext, aNext);
+
+                // Slide the window along, and correct
+                const double aPrevious[3] = { a[WindowSize - 1][0], a[WindowSize - 1][1], a[WindowSize - 1][2] };
+                for (int32 w = 0; w < WindowSize - 1; ++w)
+                {
+                    Copy(r[w + 1], r[w], 3);
+                    Copy(v[w + 1], v[w], 3);
+                    Copy(a[w + 1], a[w], 3);
+                }
+
+                for (int32 Correction = 0; Correction < MaxCorrections; ++Correction)
+                {
+                    Copy(aNext, a[WindowSize - 1], 3);
+                    for (int32 i = 0; i < 3; ++i) sPredict[i] = sn[i] + (aPrevious[i] + aNext[i]) / 2.;
+
+                    double rCorrect[3];
+                    Ordinate(GaussJackson::Corrector, a, sPredict, Sn, h, rCorrect, vNext);
+                    const bool bConverged = Converged(rNext, rCorrect, Settings.RelativeTolerance);
+                    Copy(rCorrect, rNext, 3);
+                    Forces.Acceleration(tNext, rNext, vNext, aNext);
+
+                    if (bConverged) break;
+                }
+
+                if (!FMath::IsFinite(Dot(rNext, rNext)) || !FMath::IsFinite(Dot(vNext, vNext)))
+                {
+                    t = tNext;
+                    return EStatus::Diverged;
+                }
+
+                Copy(rNext, r[WindowSize - 1], 3);
+                Copy(vNext, v[WindowSize - 1], 3);
+                Copy(aNext, a[WindowSize - 1], 3);
+                for (int32 i = 0; i < 3; ++i) sn[i] += (aPrevious[i] + aNext[i]) / 2.;
+
+                Status = EmitOutputs(n + 1);
+                if (Status != EStatus::Done) return Status;
+            }
+
+            t = t0 + NumSteps * h;
+            Copy(r[WindowSize - 1], y, 3);
+            Copy(v[WindowSize - 1], y + 3, 3);
+            return IntegrateDormandPrince(Forces, Settings, t, y, tEnd, OutputTimes + Next, Outputs + 6 * Next, NumOutputs - Next, Steps);
+        }
+
+        EStatus Integrate(const FForces& Forces, const FSettings& Settings, double& t, double(&y)[6], double tEnd, const double* OutputTimes, double* Outputs, int32 NumOutputs, int32& Steps)
+        {
+            if (Settings.Integrator == EIntegrator::GaussJackson8)
+            {
+                return IntegrateGaussJackson(Forces, Settings, t, y, tEnd, OutputTimes, Outputs, NumOutputs, Steps);
+            }
+            return IntegrateDormandPrince(Forces, Settings, t, y, tEnd, OutputTimes, Outputs, NumOutputs, Steps);
+        }
+
+        // Transition matrices are always integrated with DOP853
+        EStatus Integrate(const FForces& Forces, const FSettings& Settings, double& t, double(&y)[VariationalSize], double tEnd, const double* OutputTimes, double* Outputs, int32 NumOutputs, int32& Steps)
+        {
+            return IntegrateDormandPrince(Forces, Settings, t, y, tEnd, OutputTimes, Outputs, NumOutputs, Steps);
+        }
+
+        bool CheckModel(const FForceModel& Model, const FSettings& Settings, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            if (Model.GM.GM <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Propagator: GM %f is not positive"), Model.GM.GM));
+            }
+
+            if (Model.GravityField.IsValid() && !Model.GravityField->IsValid())
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: the gravity field has no coefficients"));
+            }
+
+            bool bZonals = false;
+            for (int32 n = 2; n <= FForceModel::MaxZonalDegree && !Model.GravityField.IsValid(); ++n)
+            {
+                bZonals |= Model.J[n] != 0.;
+            }
+
+            if ((bZonals || Model.BallisticCoefficient > 0.) && Model.ReferenceRadius.km <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: zonal terms and drag need a positive reference radius"));
+            }
+
+            if (Model.ThirdBodies.Num() > 0 && Model.EphemerisStep.seconds <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: the ephemeris step must be positive"));
+            }
+
+            if (Model.BallisticCoefficient > 0. && Model.ScaleHeight.km <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: drag needs a positive scale height"));
+            }
+
+            if (Settings.RelativeTolerance <= 0. || Settings.AbsoluteTolerance <= 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: tolerances must be positive"));
+            }
+
+            if (Settings.Integrator == EIntegrator::GaussJackson8 && Settings.FixedStep.seconds == 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: the fixed step must be nonzero"));
+            }
+
+            return true;
+        }
+
+        // How far past the integration span the third-body samples must go
+        double EphemerisMargin(const FSettings& Settings)
+        {
+            return Settings.Integrator == EIntegrator::GaussJackson8 ? (StartupSteps + 1) * FMath::Abs(Settings.FixedStep.seconds) : 0.;
+        }
+
+        double PoolValue(SpiceInt _body, const TCHAR* Item, double Default)
+        {
+            const FString Name = FString::Printf(TEXT("BODY%d_%s"), _body, Item);
+            auto _name = StringCast<ANSICHAR>(*Name);
+            SpiceInt _n = 0;
+            SpiceDouble _value = 0.;
+            SpiceBoolean _found = SPICEFALSE;
+            gdpool_c(_name.Get(), 0, 1, &_n, &_value, &_found);
+            return _found ? _value : Default;
+        }
+
+        bool BodyCode(const FString& name, SpiceInt& _code, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            SpiceBoolean _found = SPICEFALSE;
+            bods2c_c(StringCast<ANSICHAR>(*name).Get(), &_code, &_found);
+
+            if (ErrorCheck(ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+            if (!_found)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Propagator: no body named %s"), *name));
+            }
+            return true;
+        }
+
+        bool BodyGM(SpiceInt _code, FSMassConstant& GM, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            SpiceInt _n = 0;
+            SpiceDouble _gm = 0.;
+            bodvcd_c(_code, "GM", 1, &_n, &_gm);
+
+            if (ErrorCheck(ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            GM = FSMassConstant(_gm);
+            return true;
+        }
+
+        // State, then the identity matrix
+        void StartVariational(const FSStateVector& State, double(&y)[VariationalSize])
+        {
+            double state[StateSize];
+            State.CopyTo(state);
+            Copy(state, y);
+
+            FMemory::Memzero(y + StateSize, sizeof(double) * (VariationalSize - StateSize));
+            for (int32 i = 0; i < 6; ++i)
+            {
+                y[StateSize + 7 * i] = 1.;
+            }
+        }
+
+        // Integrates y from et through each of ets, arc by arc between the
+        // maneuvers.  Outputs gets the y's, N apiece.
+        template<int32 N>
+        bool PropagateOutputs(const FForceModel& Model, const FSettings& Settings, double(&y)[N], const FSEphemerisTime& et, TConstArrayView<FSEphemerisTime> ets, TConstArrayView<FManeuver> Maneuvers, TArray<double>& Outputs, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            if (!CheckModel(Model, Settings, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            const int32 NumOutputs = ets.Num();
+            if (NumOutputs == 0)
+            {
+                return true;
+            }
+
+            const double tEnd = ets[NumOutputs - 1].seconds;
+            const double Direction = tEnd >= et.seconds ? 1. : -1.;
+
+            TArray<double> OutputTimes;
+            OutputTimes.SetNumUninitialized(NumOutputs);
+            for (int32 i = 0; i < NumOutputs; ++i)
+            {
+                OutputTimes[i] = ets[i].seconds;
+                if (Direction * (OutputTimes[i] - (i > 0 ? OutputTimes[i - 1] : et.seconds)) < 0.)
+                {
+                    return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: ets must be in order, moving away from et"));
+                }
+            }
+
+            for (int32 i = 0; i < Maneuvers.Num(); ++i)
+            {
+                const double Epoch = Maneuvers[i].et.seconds;
+                if (Direction < 0. || Epoch < (i > 0 ? Maneuvers[i - 1].et.seconds : et.seconds) || Epoch > tEnd)
+                {
+                    return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: maneuvers must be in ascending order, between et and the last of ets, propagating forwards"));
+                }
+            }
+
+            const double Margin = EphemerisMargin(Settings);
+            FEphemerisTable Ephemeris;
+            if (!Ephemeris.Sample(Model, FMath::Min(et.seconds, tEnd) - Margin, FMath::Max(et.seconds, tEnd) + Margin, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            const FForces Forces(Model, Ephemeris);
+
+            Outputs.SetNumUninitialized(N * NumOutputs);
+
+            double t = et.seconds;
+            int32 Steps = 0;
+            int32 Next = 0;
+
+            // One arc per maneuver, then the rest.  An impulsive maneuver
+            // doesn't change the transition matrix.
+            for (int32 Maneuver = 0; Maneuver <= Maneuvers.Num(); ++Maneuver)
+            {
+                const bool bFinal = Maneuver == Maneuvers.Num();
+                const double ArcEnd = bFinal ? tEnd : Maneuvers[Maneuver].et.seconds;
+
+                // Outputs at a maneuver's epoch belong to the next arc
+                int32 Last = Next;
+                while (Last < NumOutputs && (bFinal || OutputTimes[Last] < ArcEnd)) ++Last;
+
+                const EStatus Status = Integrate(Forces, Settings, t, y, ArcEnd, OutputTimes.GetData() + Next, Outputs.GetData() + N * Next, Last - Next, Steps);
+                if (Status != EStatus::Done)
+                {
+                    return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: propagation ") + StatusMessage(Status, t, Settings));
+                }
+                Next = Last;
+
+                if (!bFinal)
+                {
+                    double dv[3];
+                    Maneuvers[Maneuver].dv.CopyTo(dv);
+                    for (int32 i = 0; i < 3; ++i) y[i + 3] += dv[i];
+                }
+            }
+
+            return true;
+        }
+
+        // Integrates Count y's from et to etEnd in parallel.  Load(i, y)
+        // and Store(i, y) move them in and out; failures aren't stored.
+        template<int32 N, typename LoadType, typename StoreType>
+        bool PropagateInPlace(const FForceModel& Model, const FSettings& Settings, int32 Count, double et, double etEnd, LoadType&& Load, StoreType&& Store, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            if (!CheckModel(Model, Settings, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            const double Margin = EphemerisMargin(Settings);
+            FEphemerisTable Ephemeris;
+            if (!Ephemeris.Sample(Model, FMath::Min(et, etEnd) - Margin, FMath::Max(et, etEnd) + Margin, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            const FForces Forces(Model, Ephemeris);
+
+            FCriticalSection FailureLock;
+            int32 FirstFailure = INDEX_NONE;
+            EStatus FirstFailureStatus = EStatus::Done;
+            double FirstFailureEt = 0.;
+
+            ForEachBatch(Count, BatchSize, [&](int32 Begin, int32 End)
+            {
+                for (int32 i = Begin; i < End; ++i)
+                {
+                    double t = et;
+                    double y[N];
+                    Load(i, y);
+
+                    int32 Steps = 0;
+                    const EStatus Status = Integrate(Forces, Settings, t, y, etEnd, nullptr, nullptr, 0, Steps);
+
+                    if (Status == EStatus::Done)
+                    {
+                        Store(i, y);
+                    }
+                    else
+                    {
+                        FScopeLock Lock(&FailureLock);
+                        if (FirstFailure == INDEX_NONE || i < FirstFailure)
+                        {
+                            FirstFailure = i;
+                            FirstFailureStatus = Status;
+                            FirstFailureEt = t;
+                        }
+                    }
+                }
+            });
+
+            if (FirstFailure != INDEX_NONE)
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Propagator: state %d "), FirstFailure) + StatusMessage(FirstFailureStatus, FirstFailureEt, Settings));
+            }
+
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+    }
+
+
+    SPICE_API bool LoadForceModel(
+        const FString& center,
+        const FString& frame,
+        const FSEphemerisTime& et,
+        TConstArrayView<FString> thirdBodies,
+        FForceModel& Model,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        FForceModel Loaded;
+        Loaded.Center = center;
+        Loaded.Frame = frame;
+
+        SpiceInt _center = 0;
+        if (!BodyCode(center, _center, ResultCode, ErrorMessage)) return false;
+        if (!BodyGM(_center, Loaded.GM, ResultCode, ErrorMessage)) return false;
+
+        for (int32 n = 2; n <= FForceModel::MaxZonalDegree; ++n)
+        {
+            Loaded.J[n] = PoolValue(_center, *FString::Printf(TEXT("J%d"), n), 0.);
+        }
+
+        // The zonal terms' own reference radius (geophysical.ker), or
+        // else the equatorial radius
+        Loaded.ReferenceRadius = FSDistance(PoolValue(_center, TEXT("ER"), 0.));
+        if (Loaded.ReferenceRadius.km <= 0. && bodfnd_c(_center, "RADII"))
+        {
+            SpiceInt _n = 0;
+            SpiceDouble _radii[3];
+            bodvcd_c(_center, "RADII", 3, &_n, _radii);
+            Loaded.ReferenceRadius = FSDistance(_radii[0]);
+        }
+
+        // Pole and spin, from the body-fixed frame's orientation
+        SpiceInt _frcode = 0;
+        SpiceChar _frname[33];
+        SpiceBoolean _found = SPICEFALSE;
+        cidfrm_c(_center, sizeof(_frname), &_frcode, _frname, &_found);
+
+        if (_found && bodfnd_c(_center, "POLE_RA"))
+        {
+            SpiceDouble _xform[6][6], _rot[3][3], _av[3];
+            sxform_c(StringCast<ANSICHAR>(*frame).Get(), _frname, et.seconds, _xform);
+            xf2rav_c(_xform, _rot, _av);
+
+            // The body-fixed +z axis, in frame
+            Loaded.Pole = FSDimensionlessVector(_rot[2][0], _rot[2][1], _rot[2][2]);
+            Loaded.Orientation = FSRotationMatrix(_rot);
+            Loaded.OrientationEpoch = et;
+            Loaded.AtmosphereRotation = FSAngularVelocity(_av);
+        }
+
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        for (const FString& Name : thirdBodies)
+        {
+            FThirdBody& Body = Loaded.ThirdBodies.AddDefaulted_GetRef();
+            Body.Name = Name;
+
+            SpiceInt _body = 0;
+            if (!BodyCode(Name, _body, ResultCode, ErrorMessage)) return false;
+            if (!BodyGM(_body, Body.GM, ResultCode, ErrorMessage)) return false;
+        }
+
+        Model = MoveTemp(Loaded);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Propagate(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        TConstArrayView<FManeuver> Maneuvers,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(States.Num() == ets.Num());
+
+        double y[StateSize];
+        State.CopyTo(y);
+
+        TArray<double> Outputs;
+        if (!PropagateOutputs(Model, Settings, y, et, ets, Maneuvers, Outputs, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            States[i] = ToState(&Outputs[StateSize * i]);
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Propagate(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        TArrayView<FSStateVector> States,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        return PropagateInPlace<StateSize>(Model, Settings, States.Num(), et.seconds, etEnd.seconds,
+            [&](int32 i, double(&y)[StateSize]) { States[i].CopyTo(y); },
+            [&](int32 i, const double(&y)[StateSize]) { States[i] = ToState(y); },
+            ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool PropagateTransition(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        TArrayView<Covariance::FStateMatrix> Transitions,
+        TConstArrayView<FManeuver> Maneuvers,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(States.Num() == ets.Num());
+        check(Transitions.Num() == ets.Num());
+
+        double y[VariationalSize];
+        StartVariational(State, y);
+
+        TArray<double> Outputs;
+        if (!PropagateOutputs(Model, Settings, y, et, ets, Maneuvers, Outputs, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        for (int32 i = 0; i < ets.Num(); ++i)
+        {
+            const double* Output = &Outputs[VariationalSize * i];
+            States[i] = ToState(Output);
+            FMemory::Memcpy(Transitions[i].m, Output + StateSize, sizeof(Transitions[i].m));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool PropagateTransition(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        TArrayView<FSStateVector> States,
+        TArrayView<Covariance::FStateMatrix> Transitions,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Transitions.Num() == States.Num());
+
+        return PropagateInPlace<VariationalSize>(Model, Settings, States.Num(), et.seconds, etEnd.seconds,
+            [&](int32 i, double(&y)[VariationalSize]) { StartVariational(States[i], y); },
+            [&](int32 i, const double(&y)[VariationalSize])
+            {
+                States[i] = ToState(y);
+                FMemory::Memcpy(Transitions[i].m, y + StateSize, sizeof(Transitions[i].m));
+            },
+            ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool WriteSpk(
+        const FString& file,
+        const FString& body,
+        const FString& center,
+        const FString& frame,
+        TConstArrayView<FSEphemerisTime> ets,
+        TConstArrayView<FSStateVector> States,
+        const FString& segmentId,
+        int32 degree,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(States.Num() == ets.Num());
+
+        const int32 Count = ets.Num();
+        if (degree < 1 || degree > 15 || degree % 2 == 0)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Propagator: SPK type 13 degree %d must be odd, from 1 to 15"), degree));
+        }
+        if (Count < (degree + 1) / 2 || Count < 2)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Propagator: %d states are too few for degree %d"), Count, degree));
+        }
+
+        TArray<double> _epochs;
+        TArray<double> _states;
+        _epochs.SetNumUninitialized(Count);
+        _states.SetNumUninitialized(6 * Count);
+        for (int32 i = 0; i < Count; ++i)
+        {
+            _epochs[i] = ets[i].seconds;
+            if (i > 0 && _epochs[i] <= _epochs[i - 1])
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::Propagator: SPK epochs must be strictly ascending"));
+            }
+
+            double _state[6];
+            States[i].CopyTo(_state);
+            Copy(_state, &_states[6 * i]);
+        }
+
+        SpiceInt _body = 0, _center = 0;
+        if (!BodyCode(body, _body, ResultCode, ErrorMessage)) return false;
+        if (!BodyCode(center, _center, ResultCode, ErrorMessage)) return false;
+
+        auto _file = StringCast<ANSICHAR>(*toPath(file));
+        SpiceInt _handle = 0;
+        if (exists_c(_file.Get()))
+        {
+            spkopa_c(_file.Get(), &_handle);
+        }
+        else
+        {
+            spkopn_c(_file.Get(), "MaxQ", 0, &_handle);
+        }
+
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        spkw13_c(
+            _handle, _body, _center,
+            StringCast<ANSICHAR>(*frame).Get(),
+            _epochs[0], _epochs[Count - 1],
+            StringCast<ANSICHAR>(*segmentId).Get(),
+            degree, Count,
+            reinterpret_cast<const SpiceDouble(*)[6]>(_states.GetData()),
+            _epochs.GetData()
+        );
+
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            spkcls_c(_handle);
+            UnexpectedErrorCheck();
+            return false;
+        }
+
+        spkcls_c(_handle);
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,418 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceRelativeMotion.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Linearized relative motion of deputies about a chief
+//
+// Yamanaka-Ankersen works in transformed coordinates, with the chief's true
+// anomaly theta as the independent variable:
+//   r~ = rho * r,  r~' = -e*sin(theta) * r + v / (k^2 * rho)
+//   rho = 1 + e*cos(theta),  k^2 = h / p^2
+// where the motion is the Tschauner-Hempel equations, solved in closed form.
+// The paper's LVLH axes are x along track, y against the angular momentum
+// and z towards the primary, so its in-plane matrix is permuted and
+// re-signed into this file's radial/along-track/cross-track axes.  Its
+// out-of-plane motion is a rotation by the change in true anomaly, which
+// the change of sign doesn't affect.
+//
+// The transition matrix is the product of the transformation at the start,
+// the Tschauner-Hempel solution, and the inverse transformation at the end.
+// The chief's true anomaly at the end comes from Kepler's equation.  For a
+// nearly circular chief the true anomaly is poorly defined, but only its
+// change matters there, and that's well defined.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceRelativeMotion.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceRelativeMotion.h"
+#include "SpiceUtilities.h"
+
+using namespace MaxQ::Private;
+using MaxQ::Covariance::FStateMatrix;
+
+namespace MaxQ::RelativeMotion
+{
+    namespace
+    {
+        // Deputies per batch, per worker
+        constexpr int32 BatchSize = 1024;
+
+        constexpr int32 KeplerMaxIterations = 50;
+
+        inline double Dot(const double* a, const double* b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        inline void Cross(const double* a, const double* b, double* out)
+        {
+            out[0] = a[1] * b[2] - a[2] * b[1];
+            out[1] = a[2] * b[0] - a[0] * b[2];
+            out[2] = a[0] * b[1] - a[1] * b[0];
+        }
+
+        struct FLvlh
+        {
+            double Chief[6];
+            // Rows are the LVLH axes, in the inertial frame
+            double Axes[3][3];
+            // The frame's angular velocity, in the inertial frame
+            double Omega[3];
+        };
+
+        bool MakeLvlh(const FSStateVector& Chief, FLvlh& Frame, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            Chief.CopyTo(Frame.Chief);
+            const double* r = Frame.Chief;
+            const double* v = Frame.Chief + 3;
+
+            double h[3];
+            Cross(r, v, h);
+
+            const double r2 = Dot(r, r);
+            const double h2 = Dot(h, h);
+            if (r2 == 0. || h2 == 0.)
+            {
+                return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::RelativeMotion: the chief's state has no angular momentum"));
+            }
+
+            const double rn = FMath::Sqrt(r2);
+            const double hn = FMath::Sqrt(h2);
+            for (int32 i = 0; i < 3; ++i)
+            {
+                Frame.Axes[0][i] = r[i] / rn;
+                Frame.Axes[2][i] = h[i] / hn;
+                Frame.Omega[i] = h[i] / r2;
+            }
+            Cross(Frame.Axes[2], Frame.Axes[0], Frame.Axes[1]);
+
+            return true;
+        }
+
+        void ApplyToAll(const FStateMatrix& Phi, TConstArrayView<FSStateVector> In, TArrayView<FSStateVector> Out)
+        {
+            ForEachBatch(In.Num(), BatchSize, [&](int32 Begin, int32 End)
+            {
+                for (int32 n = Begin; n < End; ++n)
+                {
+                    double x[6], y[6];
+                    In[n].CopyTo(x);
+                    for (int32 i = 0; i < 6; ++i)
+                    {
+                        y[i] = Phi.m[i][0] * x[0] + Phi.m[i][1] * x[1] + Phi.m[i][2] * x[2] + Phi.m[i][3] * x[3] + Phi.m[i][4] * x[4] + Phi.m[i][5] * x[5];
+                    }
+                    Out[n] = FSStateVector(y);
+                }
+            });
+        }
+
+        void ClohessyWiltshire(double n, double dt, FStateMatrix& Phi)
+        {
+            const double nt = n * dt;
+            const double c = FMath::Cos(nt);
+            const double s = FMath::Sin(nt);
+
+            const double m[6][6] = {
+                { 4. - 3. * c,       0., 0., s / n,              2. * (1. - c) / n,       0.    },
+                { 6. * (s - nt),     1., 0., -2. * (1. - c) / n, (4. * s - 3. * nt) / n,  0.    },
+                { 0.,                0., c,  0.,                 0.,                      s / n },
+                { 3. * n * s,        0., 0., c,                  2. * s,                  0.    },
+                { -6. * n * (1. - c), 0., 0., -2. * s,           4. * c - 3.,             0.    },
+                { 0.,                0., -n * s, 0.,             0.,                      c     }
+            };
+            Phi = FStateMatrix(m);
+        }
+
+        // Yamanaka & Ankersen's in-plane fundamental matrix, on their
+        // (x, z, x', z'), at true anomaly Theta with J = k^2 * (t - t0)...
+        void YamanakaAnkersenMatrix(double e, double Theta, double J, double(&m)[4][4])
+        {
+            const double rho = 1. + e * FMath::Cos(Theta);
+            const double s = rho * FMath::Sin(Theta);
+            const double c = rho * FMath::Cos(Theta);
+            const double ds = FMath::Cos(Theta) + e * FMath::Cos(2. * Theta);
+            const double dc = -(FMath::Sin(Theta) + e * FMath::Sin(2. * Theta));
+
+            m[0][0] = 1.; m[0][1] = -c * (1. + 1. / rho); m[0][2] = s * (1. + 1. / rho); m[0][3] = 3. * rho * rho * J;
+            m[1][0] = 0.; m[1][1] = s;                    m[1][2] = c;                   m[1][3] = 2. - 3. * e * s * J;
+            m[2][0] = 0.; m[2][1] = 2. * s;               m[2][2] = 2. * c - e;          m[2][3] = 3. * (1. - 2. * e * s * J);
+            m[3][0] = 0.; m[3][1] = ds;                   m[3][2] = dc;                  m[3][3] = -3. * e * (ds * J + s / (rho * rho));
+        }
+
+        // ...and its inverse at J = 0
+        void YamanakaAnkersenInverse(double e, double Theta, double(&m)[4][4])
+        {
+            const double rho = 1. + e * FMath::Cos(Theta);
+            const double s = rho * FMath::Sin(Theta);
+            const double c = rho * FMath::Cos(Theta);
+            const double k = 1. / (1. - e * e);
+
+            m[0][0] = k * (1. - e * e); m[0][1] = k * 3. * e * s * (1. / rho + 1. / (rho * rho)); m[0][2] = -k * e * s * (1. + 1. / rho); m[0][3] = k * (2. - e * c);
+            m[1][0] = 0.;               m[1][1] = -k * 3. * s * (1. / rho + e * e / (rho * rho)); m[1][2] = k * s * (1. + 1. / rho);      m[1][3] = k * (c - 2. * e);
+            m[2][0] = 0.;               m[2][1] = -k * 3. * (c / rho + e);                        m[2][2] = k * (c * (1. + 1. / rho) + e); m[2][3] = -k * s;
+            m[3][0] = 0.;               m[3][1] = k * (3. * rho + e * e - 1.);                    m[3][2] = -k * rho * rho;                m[3][3] = k * e * s;
+        }
+
+        // The transformation to (r~, r~') at Theta
+        void ToTransformed(double e, double Theta, double k2, FStateMatrix& m)
+        {
+            const double rho = 1. + e * FMath::Cos(Theta);
+            m = FStateMatrix();
+            for (int32 i = 0; i < 3; ++i)
+            {
+                m.m[i][i] = rho;
+                m.m[i + 3][i] = -e * FMath::Sin(Theta);
+                m.m[i + 3][i + 3] = 1. / (k2 * rho);
+            }
+        }
+
+        // ...and back
+        void FromTransformed(double e, double Theta, double k2, FStateMatrix& m)
+        {
+            const double rho = 1. + e * FMath::Cos(Theta);
+            m = FStateMatrix();
+            for (int32 i = 0; i < 3; ++i)
+            {
+                m.m[i][i] = 1. / rho;
+                m.m[i + 3][i] = k2 * e * FMath::Sin(Theta);
+                m.m[i + 3][i + 3] = k2 * rho;
+            }
+        }
+
+        double SolveKepler(double M, double e)
+        {
+            M = FMath::Fmod(M, 2. * UE_DOUBLE_PI);
+            double E = e < 0.8 ? M : UE_DOUBLE_PI * (M < 0. ? -1. : 1.);
+            for (int32 Iteration = 0; Iteration < KeplerMaxIterations; ++Iteration)
+            {
+                const double Step = (E - e * FMath::Sin(E) - M) / (1. - e * FMath::Cos(E));
+                E -= Step;
+                if (FMath::Abs(Step) <= 4. * DBL_EPSILON * FMath::Max(1., FMath::Abs(E))) break;
+            }
+            return E;
+        }
+
+        void YamanakaAnkersen(const double* r, const double* v, double mu, double dt, FStateMatrix& Phi)
+        {
+            double h[3];
+            Cross(r, v, h);
+            const double hn = FMath::Sqrt(Dot(h, h));
+            const double rn = FMath::Sqrt(Dot(r, r));
+            const double p = hn * hn / mu;
+
+            // e*cos(theta) and e*sin(theta) at the start
+            const double eCos = p / rn - 1.;
+            const double eSin = Dot(r, v) * hn / (mu * rn);
+            const double e = FMath::Sqrt(eCos * eCos + eSin * eSin);
+            const double Theta0 = FMath::Atan2(eSin, eCos);
+
+            // Through Kepler's equation to the end
+            const double Root = FMath::Sqrt(1. - e * e);
+            const double a = p / (1. - e * e);
+            const double n = FMath::Sqrt(mu / (a * a * a));
+            const double E0 = FMath::Atan2(Root * FMath::Sin(Theta0), e + FMath::Cos(Theta0));
+            const double E1 = SolveKepler(E0 - e * FMath::Sin(E0) + n * dt, e);
+            const double Theta1 = FMath::Atan2(Root * FMath::Sin(E1), FMath::Cos(E1) - e);
+
+            const double k2 = hn / (p * p);
+
+            double Start[4][4], End[4][4];
+            YamanakaAnkersenInverse(e, Theta0, Start);
+            YamanakaAnkersenMatrix(e, Theta1, k2 * dt, End);
+
+            // The paper's (x, z, x', z') in this file's transformed state:
+            // x is along track (+y here), z towards the primary (-x here)
+            constexpr int32 Index[4] = { 1, 0, 4, 3 };
+            constexpr double Sign[4] = { 1., -1., 1., -1. };
+
+            FStateMatrix Solution;
+            for (int32 i = 0; i < 4; ++i)
+            {
+                for (int32 j = 0; j < 4; ++j)
+                {
+                    double Sum = 0.;
+                    for (int32 k = 0; k < 4; ++k) Sum += End[i][k] * Start[k][j];
+                    Solution.m[Index[i]][Index[j]] = Sign[i] * Sign[j] * Sum;
+                }
+            }
+
+            const double dTheta = Theta1 - Theta0;
+            Solution.m[2][2] = Solution.m[5][5] = FMath::Cos(dTheta);
+            Solution.m[2][5] = FMath::Sin(dTheta);
+            Solution.m[5][2] = -FMath::Sin(dTheta);
+
+            FStateMatrix To, From;
+            ToTransformed(e, Theta0, k2, To);
+            FromTransformed(e, Theta1, k2, From);
+
+            Covariance::Multiply(Solution, To, Phi);
+            Covariance::Multiply(From, Phi, Phi);
+        }
+    }
+
+
+    SPICE_API bool ToLvlh(
+        const FSStateVector& Chief,
+        TConstArrayView<FSStateVector> Deputies,
+        TArrayView<FSStateVector> Relative,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Relative.Num() == Deputies.Num());
+
+        FLvlh Frame;
+        if (!MakeLvlh(Chief, Frame, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        ForEachBatch(Deputies.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 n = Begin; n < End; ++n)
+            {
+                double d[6];
+                Deputies[n].CopyTo(d);
+
+                double dr[3], dv[3], w[3];
+                for (int32 i = 0; i < 3; ++i) dr[i] = d[i] - Frame.Chief[i];
+                Cross(Frame.Omega, dr, w);
+                for (int32 i = 0; i < 3; ++i) dv[i] = d[i + 3] - Frame.Chief[i + 3] - w[i];
+
+                double x[6];
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    x[i] = Dot(Frame.Axes[i], dr);
+                    x[i + 3] = Dot(Frame.Axes[i], dv);
+                }
+                Relative[n] = FSStateVector(x);
+            }
+        });
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool FromLvlh(
+        const FSStateVector& Chief,
+        TConstArrayView<FSStateVector> Relative,
+        TArrayView<FSStateVector> Deputies,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Deputies.Num() == Relative.Num());
+
+        FLvlh Frame;
+        if (!MakeLvlh(Chief, Frame, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        ForEachBatch(Relative.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 n = Begin; n < End; ++n)
+            {
+                double x[6];
+                Relative[n].CopyTo(x);
+
+                double dr[3], w[3];
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    dr[i] = Frame.Axes[0][i] * x[0] + Frame.Axes[1][i] * x[1] + Frame.Axes[2][i] * x[2];
+                }
+                Cross(Frame.Omega, dr, w);
+
+                double d[6];
+                for (int32 i = 0; i < 3; ++i)
+                {
+                    d[i] = Frame.Chief[i] + dr[i];
+                    d[i + 3] = Frame.Chief[i + 3] + Frame.Axes[0][i] * x[3] + Frame.Axes[1][i] * x[4] + Frame.Axes[2][i] * x[5] + w[i];
+                }
+                Deputies[n] = FSStateVector(d);
+            }
+        });
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Transition(
+        const FSStateVector& Chief,
+        const FSMassConstant& mu,
+        const FSEphemerisPeriod& dt,
+        Covariance::FStateMatrix& Phi,
+        EModel Model,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        if (mu.GM <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::RelativeMotion: GM %f is not positive"), mu.GM));
+        }
+
+        FLvlh Frame;
+        if (!MakeLvlh(Chief, Frame, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        const double* r = Frame.Chief;
+        const double* v = Frame.Chief + 3;
+        const double Alpha = 2. / FMath::Sqrt(Dot(r, r)) - Dot(v, v) / mu.GM;
+        if (Alpha <= 0.)
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::RelativeMotion: the chief's orbit isn't elliptic"));
+        }
+
+        if (Model == EModel::ClohessyWiltshire)
+        {
+            ClohessyWiltshire(FMath::Sqrt(mu.GM * Alpha * Alpha * Alpha), dt.seconds, Phi);
+        }
+        else
+        {
+            YamanakaAnkersen(r, v, mu.GM, dt.seconds, Phi);
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool Propagate(
+        const FSStateVector& Chief,
+        const FSMassConstant& mu,
+        const FSEphemerisPeriod& dt,
+        TConstArrayView<FSStateVector> Relative,
+        TArrayView<FSStateVector> Propagated,
+        EModel Model,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Propagated.Num() == Relative.Num());
+
+        FStateMatrix Phi;
+        if (!Transition(Chief, mu, dt, Phi, Model, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        ApplyToAll(Phi, Relative, Propagated);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,542 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSclk.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Native spacecraft clock (SCLK) conversions
+//
+// The math mirrors CSPICE:
+//   ticks <-> parallel time    sc01 (scte01/scec01)
+//   string -> ticks            sc01 (sctk01)
+//   ticks -> encoded SCLK      scencd (partition totals)
+//   parallel time <-> TDB      unitim, via MaxQ::Time, for TDT clocks
+//
+// CSPICE already caches the SCLK tables it reads, but every call still pays
+// for chkin/chkout, the pool watcher check, and re-summing the partition
+// lengths.  The model here does all of that once per clock.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSclk.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceSclk.h"
+#include "SpiceTime.h"
+#include "SpiceUtilities.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/ScopeLock.h"
+
+PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
+extern "C"
+{
+#include "SpiceUsr.h"
+
+// for zzctruin, zzpctrck
+#include "SpiceZfc.h"
+}
+PRAGMA_POP_PLATFORM_DEFAULT_PACKING
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Sclk
+{
+    namespace
+    {
+        // Conversions per batch, per worker
+        constexpr int32 BatchSize = 4096;
+        // sc01's limit
+        constexpr int32 MaxFields = 10;
+
+        struct FSclkModel
+        {
+            // Parallel time is TDT rather than TDB
+            bool bTdt = false;
+
+            // Per field: the offset, and ticks per count (sctk01's CMPTKS)
+            TArray<double> Offsets;
+            TArray<double> FieldTicks;
+
+            // SCLK01_COEFFICIENTS columns, plus the rates converted to
+            // seconds per tick and ticks per second
+            TArray<double> CoefTicks;
+            TArray<double> CoefTime;
+            TArray<double> SecondsPerTick;
+            TArray<double> TicksPerSecond;
+            TArray<bool> bValidRate;
+
+            // Last encoded tick of the last partition
+            double MaxTick = 0.;
+
+            // Rounded partition bounds, and the total ticks through the end of
+            // each partition (scencd's PTOTLS)
+            TArray<double> PartitionStart;
+            TArray<double> PartitionEnd;
+            TArray<double> PartitionTotals;
+        };
+
+        typedef TSharedPtr<const FSclkModel, ESPMode::ThreadSafe> FSclkModelPtr;
+
+        FCriticalSection ModelLock;
+        // Clocks without a usable kernel are cached as nullptr, so repeated
+        // misses don't go back to the kernel pool.
+        TMap<int32, FSclkModelPtr> Models;
+        bool bPoolCounterInitialized = false;
+        integer PoolStateCounter[2];
+
+        FString VariableName(const TCHAR* Name, int sc)
+        {
+            return FString::Printf(TEXT("%s_%d"), Name, -sc);
+        }
+
+        bool ReadIntegers(const FString& Name, TArray<int32>& Values)
+        {
+            SpiceBoolean found = SPICEFALSE;
+            SpiceInt count = 0;
+            SpiceChar type = 0;
+            dtpool_c(TCHAR_TO_ANSI(*Name), &found, &count, &type);
+            if (!found || type != 'N' || count < 1) return false;
+
+            TArray<SpiceInt> Buffer;
+            Buffer.SetNumUninitialized(count);
+            SpiceInt n = 0;
+            gipool_c(TCHAR_TO_ANSI(*Name), 0, count, &n, Buffer.GetData(), &found);
+            if (!found || n != count) return false;
+
+            Values.SetNumUninitialized(n);
+            for (int32 i = 0; i < n; ++i) Values[i] = (int32)Buffer[i];
+            return true;
+        }
+
+        bool ReadDoubles(const FString& Name, TArray<double>& Values)
+        {
+            SpiceBoolean found = SPICEFALSE;
+            SpiceInt count = 0;
+            SpiceChar type = 0;
+            dtpool_c(TCHAR_TO_ANSI(*Name), &found, &count, &type);
+            if (!found || type != 'N' || count < 1) return false;
+
+            Values.SetNumUninitialized(count);
+            SpiceInt n = 0;
+            gdpool_c(TCHAR_TO_ANSI(*Name), 0, count, &n, Values.GetData(), &found);
+            return found && n == count;
+        }
+
+        FSclkModelPtr ReadModel(int sc)
+        {
+            TArray<int32> DataType, NumFields, TimeSystem;
+            TArray<double> Moduli, Offsets, Start, End, Coefficients;
+
+            bool bFound = ReadIntegers(VariableName(TEXT("SCLK_DATA_TYPE"), sc), DataType) && DataType.Num() == 1 && DataType[0] == 1;
+            bFound = bFound && ReadIntegers(VariableName(TEXT("SCLK01_N_FIELDS"), sc), NumFields) && NumFields.Num() == 1;
+            bFound = bFound && NumFields[0] >= 1 && NumFields[0] <= MaxFields;
+            bFound = bFound && ReadDoubles(VariableName(TEXT("SCLK01_MODULI"), sc), Moduli) && Moduli.Num() == NumFields[0];
+            bFound = bFound && ReadDoubles(VariableName(TEXT("SCLK01_OFFSETS"), sc), Offsets) && Offsets.Num() == NumFields[0];
+            bFound = bFound && ReadDoubles(VariableName(TEXT("SCLK_PARTITION_START"), sc), Start);
+            bFound = bFound && ReadDoubles(VariableName(TEXT("SCLK_PARTITION_END"), sc), End) && Start.Num() == End.Num();
+            bFound = bFound && ReadDoubles(VariableName(TEXT("SCLK01_COEFFICIENTS"), sc), Coefficients) && Coefficients.Num() % 3 == 0;
+
+            // The time system is optional, and defaults to TDB
+            if (bFound && ReadIntegers(VariableName(TEXT("SCLK01_TIME_SYSTEM"), sc), TimeSystem))
+            {
+                bFound = TimeSystem.Num() == 1 && (TimeSystem[0] == 1 || TimeSystem[0] == 2);
+            }
+
+            if (UnexpectedErrorCheck() || !bFound)
+            {
+                return nullptr;
+            }
+
+            auto Model = MakeShared<FSclkModel, ESPMode::ThreadSafe>();
+            const int32 nfield = NumFields[0];
+            Model->bTdt = TimeSystem.Num() == 1 && TimeSystem[0] == 2;
+            Model->Offsets = Offsets;
+
+            // Same order of multiplication as sc01, so results are bit-identical
+            double TicksPerCount = 1.;
+            for (int32 i = nfield - 1; i >= 1; --i)
+            {
+                TicksPerCount *= Moduli[i];
+            }
+
+            Model->FieldTicks.SetNumUninitialized(nfield);
+            Model->FieldTicks[nfield - 1] = 1.;
+            for (int32 i = nfield - 2; i >= 0; --i)
+            {
+                Model->FieldTicks[i] = Model->FieldTicks[i + 1] * Moduli[i + 1];
+            }
+
+            const int32 NumCoefficients = Coefficients.Num() / 3;
+            Model->CoefTicks.SetNumUninitialized(NumCoefficients);
+            Model->CoefTime.SetNumUninitialized(NumCoefficients);
+            Model->SecondsPerTick.SetNumUninitialized(NumCoefficients);
+            Model->TicksPerSecond.SetNumUninitialized(NumCoefficients);
+            Model->bValidRate.SetNumUninitialized(NumCoefficients);
+            for (int32 i = 0; i < NumCoefficients; ++i)
+            {
+                const double Rate = Coefficients[3 * i + 2];
+                Model->CoefTicks[i] = Coefficients[3 * i];
+                Model->CoefTime[i] = Coefficients[3 * i + 1];
+                Model->SecondsPerTick[i] = Rate / TicksPerCount;
+                Model->TicksPerSecond[i] = 1. / (Rate / TicksPerCount);
+                Model->bValidRate[i] = Rate > 0.;
+            }
+
+            const int32 NumPartitions = Start.Num();
+            Model->PartitionStart.SetNumUninitialized(NumPartitions);
+            Model->PartitionEnd.SetNumUninitialized(NumPartitions);
+            Model->PartitionTotals.SetNumUninitialized(NumPartitions);
+
+            double MaxTick = 0.;
+            double Total = 0.;
+            for (int32 i = 0; i < NumPartitions; ++i)
+            {
+                MaxTick = FMath::RoundHalfFromZero(End[i] - Start[i] + MaxTick);
+
+                Model->PartitionStart[i] = FMath::RoundHalfFromZero(Start[i]);
+                Model->PartitionEnd[i] = FMath::RoundHalfFromZero(End[i]);
+                Total = FMath::RoundHalfFromZero(Total + Model->PartitionEnd[i] - Model->PartitionStart[i]);
+                Model->PartitionTotals[i] = Total;
+            }
+            Model->MaxTick = MaxTick;
+
+            return Model;
+        }
+
+        FSclkModelPtr GetModel(int sc)
+        {
+            // CSPICE isn't thread safe, so only the game thread reads the kernel pool.
+            if (IsInGameThread())
+            {
+                if (!bPoolCounterInitialized)
+                {
+                    zzctruin_(PoolStateCounter);
+                    bPoolCounterInitialized = true;
+                }
+
+                // The SCLK variable names depend on the clock, so rather than
+                // watching each clock's variables any pool change drops every model.
+                logical bPoolChanged = 0;
+                zzpctrck_(PoolStateCounter, &bPoolChanged);
+
+                {
+                    FScopeLock Lock(&ModelLock);
+                    if (bPoolChanged)
+                    {
+                        Models.Reset();
+                    }
+                    else if (const FSclkModelPtr* Model = Models.Find(sc))
+                    {
+                        return *Model;
+                    }
+                }
+
+                FSclkModelPtr Model = ReadModel(sc);
+
+                FScopeLock Lock(&ModelLock);
+                Models.Add(sc, Model);
+                return Model;
+            }
+
+            FScopeLock Lock(&ModelLock);
+            const FSclkModelPtr* Model = Models.Find(sc);
+            return Model ? *Model : nullptr;
+        }
+
+        bool NoModel(int sc, ES_ResultCode* pResultCode, FString* pErrorMessage)
+        {
+            return Failed(pResultCode, pErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: no type 1 SCLK kernel is loaded for clock %d"), sc));
+        }
+
+        // Index of the last entry <= Value, Values[0] <= Value
+        inline int32 FindRecord(const TArray<double>& Values, double Value)
+        {
+            return Algo::UpperBound(Values, Value) - 1;
+        }
+
+        // scte01, without the TDT -> TDB step
+        inline bool TicksToParallelTime(const FSclkModel& M, double sclkdp, double& partim)
+        {
+            if (sclkdp < M.CoefTicks[0] || sclkdp > M.MaxTick) return false;
+
+            const int32 i = FindRecord(M.CoefTicks, sclkdp);
+            if (!M.bValidRate[i]) return false;
+
+            partim = M.CoefTime[i] + M.SecondsPerTick[i] * (sclkdp - M.CoefTicks[i]);
+            return true;
+        }
+
+        // scec01, after the TDB -> TDT step
+        inline bool ParallelTimeToTicks(const FSclkModel& M, double partim, double& sclkdp)
+        {
+            if (partim < M.CoefTime[0]) return false;
+
+            const int32 i = FindRecord(M.CoefTime, partim);
+            if (!M.bValidRate[i]) return false;
+
+            const double ticks = M.CoefTicks[i] + M.TicksPerSecond[i] * (partim - M.CoefTime[i]);
+            if (ticks > M.MaxTick) return false;
+
+            sclkdp = ticks;
+            return true;
+        }
+
+        inline bool IsDelimiter(TCHAR c)
+        {
+            return c == TEXT('.') || c == TEXT(':') || c == TEXT('-') || c == TEXT(',') || c == TEXT(' ');
+        }
+
+        // Unsigned integer field, at most 15 digits so the value is exact
+        bool ParseField(FStringView str, int32& Pos, double& Value)
+        {
+            const int32 Begin = Pos;
+            int64 n = 0;
+            while (Pos < str.Len() && FChar::IsDigit(str[Pos]) && Pos - Begin < 15)
+            {
+                n = n * 10 + (str[Pos] - TEXT('0'));
+                ++Pos;
+            }
+            Value = (double)n;
+            return Pos > Begin && (Pos == str.Len() || !FChar::IsDigit(str[Pos]));
+        }
+
+        enum class EParseResult : uint8
+        {
+            Success,
+            Unsupported,
+            Invalid
+        };
+
+        // sctk01 + scencd, for the "[p/]field[delim field]..." subset
+        EParseResult EncodeString(const FSclkModel& M, FStringView str, double& sclkdp)
+        {
+            str = str.TrimStartAndEnd();
+
+            int32 Partition = INDEX_NONE;
+            int32 Slash = INDEX_NONE;
+            if (str.FindChar(TEXT('/'), Slash))
+            {
+                FStringView Prefix = str.Left(Slash).TrimStartAndEnd();
+                int32 Pos = 0;
+                double Value = 0.;
+                if (!ParseField(Prefix, Pos, Value) || Pos != Prefix.Len()) return EParseResult::Unsupported;
+                if (Value < 1. || Value > M.PartitionStart.Num()) return EParseResult::Invalid;
+
+                Partition = (int32)Value - 1;
+                str = str.Mid(Slash + 1).TrimStart();
+            }
+
+            const int32 NumFields = M.FieldTicks.Num();
+            double ticks = 0.;
+            int32 Pos = 0;
+            for (int32 i = 0; ; ++i)
+            {
+                if (i >= NumFields) return EParseResult::Invalid;
+
+                double Value = 0.;
+                if (!ParseField(str, Pos, Value)) return EParseResult::Unsupported;
+
+                const double Count = Value - M.Offsets[i];
+                if (FMath::RoundHalfFromZero(Count) < 0.) return EParseResult::Invalid;
+                ticks += Count * M.FieldTicks[i];
+
+                if (Pos == str.Len()) break;
+                if (!IsDelimiter(str[Pos])) return EParseResult::Unsupported;
+                ++Pos;
+            }
+            ticks = FMath::RoundHalfFromZero(ticks);
+
+            auto InPartition = [&M, ticks](int32 p) { return ticks >= M.PartitionStart[p] && ticks <= M.PartitionEnd[p]; };
+
+            if (Partition == INDEX_NONE)
+            {
+                Partition = 0;
+                while (Partition < M.PartitionStart.Num() && !InPartition(Partition)) ++Partition;
+                if (Partition == M.PartitionStart.Num()) return EParseResult::Invalid;
+            }
+            else if (!InPartition(Partition))
+            {
+                return EParseResult::Invalid;
+            }
+
+            sclkdp = ticks - M.PartitionStart[Partition];
+            if (Partition > 0)
+            {
+                sclkdp += M.PartitionTotals[Partition - 1];
+            }
+            return EParseResult::Success;
+        }
+
+        bool BadString(int sc, FStringView sclkch, EParseResult Result, ES_ResultCode* pResultCode, FString* pErrorMessage)
+        {
+            const TCHAR* Reason = (Result == EParseResult::Unsupported) ? TEXT("is not in the supported SCLK string syntax") : TEXT("is not a valid SCLK string");
+            return Failed(pResultCode, pErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: '%s' %s for clock %d"), *FString(sclkch), Reason, sc));
+        }
+    }
+
+
+    SPICE_API bool HasClock(int sc)
+    {
+        return GetModel(sc).IsValid();
+    }
+
+    SPICE_API bool EtToTicks(int sc, const FSEphemerisTime& et, double& sclkdp, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Model = GetModel(sc);
+        if (!Model) return NoModel(sc, ResultCode, ErrorMessage);
+
+        double partim = et.seconds;
+        if (Model->bTdt && !MaxQ::Time::EtToTt(et, partim, ResultCode, ErrorMessage)) return false;
+
+        if (!ParallelTimeToTicks(*Model, partim, sclkdp))
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: ET %f is outside the coverage of clock %d"), et.seconds, sc));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TicksToEt(int sc, double sclkdp, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Model = GetModel(sc);
+        if (!Model) return NoModel(sc, ResultCode, ErrorMessage);
+
+        double partim = 0.;
+        if (!TicksToParallelTime(*Model, sclkdp, partim))
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: encoded SCLK %f is outside the coverage of clock %d"), sclkdp, sc));
+        }
+
+        if (Model->bTdt) return MaxQ::Time::TtToEt(partim, et, ResultCode, ErrorMessage);
+
+        et = FSEphemerisTime(partim);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool StrToTicks(int sc, FStringView sclkch, double& sclkdp, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Model = GetModel(sc);
+        if (!Model) return NoModel(sc, ResultCode, ErrorMessage);
+
+        const EParseResult Result = EncodeString(*Model, sclkch, sclkdp);
+        if (Result != EParseResult::Success) return BadString(sc, sclkch, Result, ResultCode, ErrorMessage);
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool StrToEt(int sc, FStringView sclkch, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        double sclkdp = 0.;
+        return StrToTicks(sc, sclkch, sclkdp, ResultCode, ErrorMessage) && TicksToEt(sc, sclkdp, et, ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToTicks(int sc, TConstArrayView<FSEphemerisTime> et, TArrayView<double> sclkdp, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == sclkdp.Num());
+        const auto Model = GetModel(sc);
+        if (!Model) return NoModel(sc, ResultCode, ErrorMessage);
+
+        // TDT clocks convert the whole batch to TT first
+        TArray<double> tt;
+        if (Model->bTdt)
+        {
+            tt.SetNumUninitialized(et.Num());
+            if (!MaxQ::Time::EtToTt(et, tt, ResultCode, ErrorMessage)) return false;
+        }
+
+        const FSclkModel& M = *Model;
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+
+        ForEachBatch(et.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                const double partim = M.bTdt ? tt[i] : et[i].seconds;
+                if (!ParallelTimeToTicks(M, partim, sclkdp[i]))
+                {
+                    FScopeLock Lock(&FailureLock);
+                    FirstFailure = (FirstFailure == INDEX_NONE) ? i : FMath::Min(FirstFailure, i);
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: ET %f (index %d) is outside the coverage of clock %d"), et[FirstFailure].seconds, FirstFailure, sc));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TicksToEt(int sc, TConstArrayView<double> sclkdp, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == sclkdp.Num());
+        const auto Model = GetModel(sc);
+        if (!Model) return NoModel(sc, ResultCode, ErrorMessage);
+
+        const FSclkModel& M = *Model;
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+
+        // TDT clocks collect parallel times, and convert them to TDB as a second pass
+        TArray<double> tt;
+        TArray<bool> bConverted;
+        if (M.bTdt)
+        {
+            tt.SetNumZeroed(sclkdp.Num());
+            bConverted.SetNumZeroed(sclkdp.Num());
+        }
+
+        ForEachBatch(sclkdp.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                double partim = 0.;
+                if (!TicksToParallelTime(M, sclkdp[i], partim))
+                {
+                    FScopeLock Lock(&FailureLock);
+                    FirstFailure = (FirstFailure == INDEX_NONE) ? i : FMath::Min(FirstFailure, i);
+                }
+                else if (M.bTdt)
+                {
+                    tt[i] = partim;
+                    bConverted[i] = true;
+                }
+                else
+                {
+                    et[i].seconds = partim;
+                }
+            }
+        });
+
+        if (M.bTdt)
+        {
+            TArray<FSEphemerisTime> tdb;
+            tdb.SetNumUninitialized(tt.Num());
+            if (!MaxQ::Time::TtToEt(tt, tdb, ResultCode, ErrorMessage)) return false;
+
+            for (int32 i = 0; i < tdb.Num(); ++i)
+            {
+                if (bConverted[i]) et[i] = tdb[i];
+            }
+        }
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sclk: encoded SCLK %f (index %d) is outside the coverage of clock %d"), sclkdp[FirstFailure], FirstFailure, sc));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
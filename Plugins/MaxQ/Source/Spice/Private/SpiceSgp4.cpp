@@ -0,0 +1,1207 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSgp4.cpp
+//
+// Implementation Comments
+//
+// Purpose:  SGP4/SDP4 propagation of whole TLE catalogs
+//
+// A port of CSPICE's SGP4 (zzsgp4.c and the zzds* deep-space routines,
+// which are Vallado's "Revisiting Spacetrack Report #3" code), with
+// opmode 1, as evsgp4_c uses.  Variable names follow CSPICE's, so the two
+// can be read side by side.
+//
+// Near-Earth satellites' models are SoA, and PropagateNear is the same code
+// over one double or a VectorRegister4Double of four satellites.  The
+// "simple" model (perigee under 220 km) is the full model with its extra
+// coefficients zeroed, so there's no branch; the only loop, Kepler's
+// equation, runs until every lane has converged, and each lane keeps the
+// sine and cosine from its own last iteration.  A few identities stand in
+// for functions with no SIMD form (atan2 of the argument of latitude, in
+// particular), and differ from evsgp4_c in the last bits.
+//
+// Deep-space satellites stay scalar: their resonance integration steps a
+// data-dependent number of times.  Like evsgp4_c, which initializes the
+// model on every call, the integration restarts from the TLE's epoch for
+// every evaluation, so evaluating is free of state and thread safe.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSgp4.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceSgp4.h"
+#include "SpiceUtilities.h"
+#include "SpiceTime.h"
+#include "Math/VectorRegister.h"
+#include "Misc/ScopeLock.h"
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Sgp4
+{
+    namespace
+    {
+        // Satellites per batch, per worker (a multiple of the SIMD width)
+        constexpr int32 BatchSize = 256;
+        constexpr int32 DeepBatchSize = 32;
+        constexpr int32 Lanes = 4;
+
+        constexpr double TwoPi = 2. * UE_DOUBLE_PI;
+        constexpr double J2000 = 2451545.;
+        constexpr double X2o3 = 2. / 3.;
+
+        // Minutes past the TLE's epoch, for the SGP4 model's clock
+        constexpr double MinutesPerSecond = 1. / 60.;
+
+        // Four satellites, one per lane.  Comparisons return lane masks.
+        struct FLanes
+        {
+            VectorRegister4Double v;
+
+            FLanes() {}
+            FLanes(const VectorRegister4Double& In) : v(In) {}
+            FLanes(double x) : v(VectorSetFloat1(x)) {}
+        };
+
+        inline FLanes operator+(const FLanes& a, const FLanes& b) { return VectorAdd(a.v, b.v); }
+        inline FLanes operator-(const FLanes& a, const FLanes& b) { return VectorSubtract(a.v, b.v); }
+        inline FLanes operator*(const FLanes& a, const FLanes& b) { return VectorMultiply(a.v, b.v); }
+        inline FLanes operator/(const FLanes& a, const FLanes& b) { return VectorDivide(a.v, b.v); }
+        inline FLanes operator-(const FLanes& a) { return VectorNegate(a.v); }
+
+        inline double Sin(double x) { return FMath::Sin(x); }
+        inline double Cos(double x) { return FMath::Cos(x); }
+        inline double Sqrt(double x) { return FMath::Sqrt(x); }
+        inline double Abs(double x) { return FMath::Abs(x); }
+        // Vallado's limit on a Newton step of the Kepler solution
+        inline double ClampStep(double x) { return FMath::Clamp(x, -0.95, 0.95); }
+        inline double Mod2Pi(double x) { return FMath::Fmod(x, TwoPi); }
+        inline bool Less(double a, double b) { return a < b; }
+        inline bool And(bool a, bool b) { return a && b; }
+        inline bool Any(bool a) { return a; }
+        inline double Select(bool Mask, double a, double b) { return Mask ? a : b; }
+
+        inline FLanes Sin(const FLanes& x) { return VectorSin(x.v); }
+        inline FLanes Cos(const FLanes& x) { return VectorCos(x.v); }
+        inline FLanes Sqrt(const FLanes& x) { return VectorSqrt(x.v); }
+        inline FLanes Abs(const FLanes& x) { return VectorAbs(x.v); }
+        inline FLanes ClampStep(const FLanes& x) { return VectorMin(VectorMax(x.v, VectorSetFloat1(-0.95)), VectorSetFloat1(0.95)); }
+        inline FLanes Mod2Pi(const FLanes& x) { return x - FLanes(VectorTruncate(VectorDivide(x.v, VectorSetFloat1(TwoPi)))) * TwoPi; }
+        inline FLanes Less(const FLanes& a, const FLanes& b) { return VectorCompareLT(a.v, b.v); }
+        inline FLanes And(const FLanes& a, const FLanes& b) { return VectorBitwiseAnd(a.v, b.v); }
+        inline bool Any(const FLanes& Mask) { return VectorMaskBits(Mask.v) != 0; }
+        inline FLanes Select(const FLanes& Mask, const FLanes& a, const FLanes& b) { return VectorSelect(Mask.v, a.v, b.v); }
+
+        template<typename T> T Load(const TArray<double>& Array, int32 i);
+        template<> inline double Load<double>(const TArray<double>& Array, int32 i) { return Array[i]; }
+        template<> inline FLanes Load<FLanes>(const TArray<double>& Array, int32 i) { return VectorLoad(&Array[i]); }
+
+        // Error as a number, so it can ride in a lane
+        inline double Code(EError Error) { return (double)(uint8)Error; }
+
+        // The last of xxsgp4e, from the perturbed elements to the state:
+        // Kepler's equation, short-period periodics, and orientation.
+        // Error holds any error found so far, which takes precedence.
+        template<typename T>
+        void Finish(
+            double J2, double Ke, double Er,
+            const T& am, const T& xn, const T& eccp, const T& xincp, const T& sinip, const T& cosip,
+            const T& argpp, const T& nodep, const T& mp,
+            const T& aycof, const T& xlcof, const T& con41, const T& x1mth2, const T& x7thm1,
+            T (&State)[6], T& Error)
+        {
+            const T axnl = eccp * Cos(argpp);
+            T temp = T(1.) / (am * (T(1.) - eccp * eccp));
+            const T aynl = eccp * Sin(argpp) + temp * aycof;
+            const T xl = mp + argpp + nodep + temp * xlcof * axnl;
+
+            // Kepler's equation for the eccentric longitude
+            const T u = Mod2Pi(xl - nodep);
+            T eo1 = u;
+            T sineo1 = T(0.), coseo1 = T(1.);
+            auto Active = Less(T(0.), T(1.));
+            for (int32 Iteration = 0; Iteration < 10 && Any(Active); ++Iteration)
+            {
+                const T s = Sin(eo1);
+                const T c = Cos(eo1);
+                sineo1 = Select(Active, s, sineo1);
+                coseo1 = Select(Active, c, coseo1);
+
+                const T tem5 = (u - aynl * c + axnl * s - eo1) / (T(1.) - c * axnl - s * aynl);
+                eo1 = Select(Active, eo1 + ClampStep(tem5), eo1);
+                Active = And(Active, Less(T(1e-12), Abs(tem5)));
+            }
+
+            const T ecose = axnl * coseo1 + aynl * sineo1;
+            const T esine = axnl * sineo1 - aynl * coseo1;
+            const T el2 = axnl * axnl + aynl * aynl;
+            const T pl = am * (T(1.) - el2);
+
+            const T rl = am * (T(1.) - ecose);
+            const T rdotl = Sqrt(am) * esine / rl;
+            const T rvdotl = Sqrt(pl) / rl;
+            const T betal = Sqrt(T(1.) - el2);
+            temp = esine / (betal + T(1.));
+            const T sinu = am / rl * (sineo1 - aynl - axnl * temp);
+            const T cosu = am / rl * (coseo1 - axnl + aynl * temp);
+            const T sin2u = (cosu + cosu) * sinu;
+            const T cos2u = T(1.) - T(2.) * sinu * sinu;
+
+            temp = T(1.) / pl;
+            const T temp1 = T(0.5 * J2) * temp;
+            const T temp2 = temp1 * temp;
+
+            const T mr = rl * (T(1.) - T(1.5) * temp2 * betal * con41) + T(0.5) * temp1 * x1mth2 * cos2u;
+            const T dsu = T(0.25) * temp2 * x7thm1 * sin2u;
+            const T xnode = nodep + T(1.5) * temp2 * cosip * sin2u;
+            const T xinc = xincp + T(1.5) * temp2 * cosip * sinip * cos2u;
+            const T mv = rdotl - xn * temp1 * x1mth2 * sin2u / T(Ke);
+            const T rvdot = rvdotl + xn * temp1 * (x1mth2 * cos2u + T(1.5) * con41) / T(Ke);
+
+            // su = atan2(sinu, cosu) - dsu
+            const T RcpNorm = T(1.) / Sqrt(sinu * sinu + cosu * cosu);
+            const T sdsu = Sin(dsu);
+            const T cdsu = Cos(dsu);
+            const T sinsu = (sinu * cdsu - cosu * sdsu) * RcpNorm;
+            const T cossu = (cosu * cdsu + sinu * sdsu) * RcpNorm;
+
+            const T snod = Sin(xnode);
+            const T cnod = Cos(xnode);
+            const T sini = Sin(xinc);
+            const T cosi = Cos(xinc);
+            const T xmx = -snod * cosi;
+            const T xmy = cnod * cosi;
+            const T ux = xmx * sinsu + cnod * cossu;
+            const T uy = xmy * sinsu + snod * cossu;
+            const T uz = sini * sinsu;
+            const T vx = xmx * cossu - cnod * sinsu;
+            const T vy = xmy * cossu - snod * sinsu;
+            const T vz = sini * cossu;
+
+            const T r = mr * T(Er);
+            const T kps = T(Er * Ke / 60.);
+            State[0] = r * ux;
+            State[1] = r * uy;
+            State[2] = r * uz;
+            State[3] = (mv * ux + rvdot * vx) * kps;
+            State[4] = (mv * uy + rvdot * vy) * kps;
+            State[5] = (mv * uz + rvdot * vz) * kps;
+
+            T Late = Select(Less(mr, T(1.)), T(Code(EError::Decayed)), T(0.));
+            Late = Select(Less(pl, T(0.)), T(Code(EError::SemiLatusRectum)), Late);
+            Error = Select(Less(T(0.), Error), Error, Late);
+        }
+
+        // xlcof, guarded against its singularity at 180 degrees inclination
+        inline double ComputeXlcof(double J3oJ2, double sinio, double cosio)
+        {
+            const double Denominator = FMath::Abs(cosio + 1.) > 1.5e-12 ? cosio + 1. : 1.5e-12;
+            return -0.25 * J3oJ2 * sinio * (3. + 5. * cosio) / Denominator;
+        }
+    }
+
+
+    const TCHAR* ToString(EError Error)
+    {
+        switch (Error)
+        {
+        case EError::None: return TEXT("no error");
+        case EError::MeanMotion: return TEXT("has a mean motion less than zero");
+        case EError::MeanEccentricity: return TEXT("has a mean eccentricity out of range");
+        case EError::MeanSemiMajorAxis: return TEXT("has a mean semi-major axis under 0.95 Earth radii");
+        case EError::PerturbedEccentricity: return TEXT("has a perturbed eccentricity out of range");
+        case EError::SemiLatusRectum: return TEXT("has a semi-latus rectum less than zero");
+        case EError::Decayed: return TEXT("has decayed");
+        }
+        return TEXT("failed");
+    }
+
+
+    // One satellite's near-Earth model, before it's split into the arrays
+    struct FTleBatch::FNearEarth
+    {
+        double Epoch, Mo, Mdot, Argpo, Argpdot, Nodeo, Nodedot, Nodecf;
+        double Ecco, Inclo, No, Ao, Bstar;
+        double Cc1, Cc4, Cc5, T2cof, T3cof, T4cof, T5cof;
+        double Omgcof, Xmcof, Eta, Delmo, Sinmao, D2, D3, D4;
+        double Aycof, Xlcof, Con41, X1mth2, X7thm1;
+    };
+
+
+    FTleBatch::FTleBatch()
+    {
+        J2 = 1.082616e-3;
+        J3oJ2 = -2.53881e-6 / J2;
+        J4 = -1.65597e-6;
+        Ke = 7.43669161e-2;
+        Er = 6378.135;
+    }
+
+
+    FTleBatch::FTleBatch(const FSTLEGeophysicalConstants& geophs)
+    {
+        check(geophs.geophs.Num() == 8);
+        J2 = geophs.geophs[0];
+        J3oJ2 = geophs.geophs[1] / J2;
+        J4 = geophs.geophs[2];
+        Ke = geophs.geophs[3];
+        Er = geophs.geophs[6];
+    }
+
+
+    void FTleBatch::Reset()
+    {
+        NumSatellites = 0;
+        Slots.Reset();
+        NearIndices.Reset();
+        for (TArray<double>* Array : {
+            &Epoch, &Mo, &Mdot, &Argpo, &Argpdot, &Nodeo, &Nodedot, &Nodecf,
+            &Ecco, &Inclo, &No, &Ao, &Bstar,
+            &Cc1, &Cc4, &Cc5, &T2cof, &T3cof, &T4cof, &T5cof,
+            &Omgcof, &Xmcof, &Eta, &Delmo, &Sinmao, &D2, &D3, &D4,
+            &Aycof, &Xlcof, &Con41, &X1mth2, &X7thm1 })
+        {
+            Array->Reset();
+        }
+        DeepSatellites.Reset();
+        DeepIndices.Reset();
+    }
+
+
+    void FTleBatch::Reserve(int32 Count)
+    {
+        // Most of a catalog is near-Earth
+        Slots.Reserve(Count);
+        NearIndices.Reserve(Count);
+        for (TArray<double>* Array : {
+            &Epoch, &Mo, &Mdot, &Argpo, &Argpdot, &Nodeo, &Nodedot, &Nodecf,
+            &Ecco, &Inclo, &No, &Ao, &Bstar,
+            &Cc1, &Cc4, &Cc5, &T2cof, &T3cof, &T4cof, &T5cof,
+            &Omgcof, &Xmcof, &Eta, &Delmo, &Sinmao, &D2, &D3, &D4,
+            &Aycof, &Xlcof, &Con41, &X1mth2, &X7thm1 })
+        {
+            Array->Reserve(Count);
+        }
+    }
+
+
+    bool FTleBatch::Add(const FSTwoLineElements& Elements, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        return Add(TConstArrayView<FSTwoLineElements>(&Elements, 1), ResultCode, ErrorMessage);
+    }
+
+
+    bool FTleBatch::Add(TConstArrayView<FSTwoLineElements> Elements, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        TArray<double> Flat;
+        Flat.Reserve(Elements.Num() * NumElements);
+        for (const FSTwoLineElements& Satellite : Elements)
+        {
+            check(Satellite.elems.Num() == NumElements);
+            Flat.Append(Satellite.elems);
+        }
+
+        return Add(Flat, {}, ResultCode, ErrorMessage);
+    }
+
+
+    bool FTleBatch::Add(TConstArrayView<double> Elements, TArrayView<bool> Added, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(Elements.Num() % NumElements == 0);
+        const int32 Count = Elements.Num() / NumElements;
+        check(Added.Num() == 0 || Added.Num() == Count);
+
+        // SGP4's epoch is UTC, as a Julian date
+        TArray<double> Epochs;
+        TArray<FSEphemerisPeriod> Deltas;
+        Epochs.SetNumUninitialized(Count);
+        Deltas.SetNumUninitialized(Count);
+        for (int32 i = 0; i < Count; ++i)
+        {
+            Epochs[i] = Elements[i * NumElements + FSTwoLineElements::EPOCH];
+        }
+
+        if (!Time::DeltaEt(Epochs, ES_EpochType::ET, Deltas, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        TArray<FNearEarth> Near;
+        TArray<FDeepSpace> Deep;
+        TArray<uint8> IsDeep;
+        Near.SetNumUninitialized(Count);
+        Deep.SetNumUninitialized(Count);
+        IsDeep.SetNumUninitialized(Count);
+
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+        FString FirstFailureReason;
+
+        ForEachBatch(Count, DeepBatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                const double EpochJdUtc = J2000 + (Epochs[i] - Deltas[i].seconds) / 86400.;
+
+                bool bDeep = false;
+                FString Reason;
+                const bool bInitialized = Initialize(&Elements[i * NumElements], EpochJdUtc, Near[i], Deep[i], bDeep, Reason);
+                IsDeep[i] = bDeep;
+
+                if (Added.Num() > 0)
+                {
+                    Added[i] = bInitialized;
+                }
+                else if (!bInitialized)
+                {
+                    FScopeLock Lock(&FailureLock);
+                    if (FirstFailure == INDEX_NONE || i < FirstFailure)
+                    {
+                        FirstFailure = i;
+                        FirstFailureReason = Reason;
+                    }
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sgp4: elements %d %s"), FirstFailure, *FirstFailureReason));
+        }
+
+        for (int32 i = 0; i < Count; ++i)
+        {
+            if (Added.Num() == 0 || Added[i])
+            {
+                Append(Near[i], Deep[i], IsDeep[i] != 0);
+            }
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    void FTleBatch::GetPerigeeApogee(int32 i, double& Perigee, double& Apogee) const
+    {
+        const int32 Slot = Slots[i];
+        const double a = (Slot >= 0 ? Ao[Slot] : FMath::Pow(Ke / DeepSatellites[-1 - Slot].No, X2o3)) * Er;
+        const double e = Slot >= 0 ? Ecco[Slot] : DeepSatellites[-1 - Slot].Ecco;
+        Perigee = a * (1. - e);
+        Apogee = a * (1. + e);
+    }
+
+
+    void FTleBatch::Append(const FNearEarth& Near, const FDeepSpace& Deep, bool bDeep)
+    {
+        if (bDeep)
+        {
+            Slots.Add(-1 - DeepSatellites.Add(Deep));
+            DeepIndices.Add(NumSatellites++);
+            return;
+        }
+
+        Slots.Add(NearIndices.Add(NumSatellites++));
+        Epoch.Add(Near.Epoch); Mo.Add(Near.Mo); Mdot.Add(Near.Mdot); Argpo.Add(Near.Argpo);
+        Argpdot.Add(Near.Argpdot); Nodeo.Add(Near.Nodeo); Nodedot.Add(Near.Nodedot); Nodecf.Add(Near.Nodecf);
+        Ecco.Add(Near.Ecco); Inclo.Add(Near.Inclo); No.Add(Near.No); Ao.Add(Near.Ao); Bstar.Add(Near.Bstar);
+        Cc1.Add(Near.Cc1); Cc4.Add(Near.Cc4); Cc5.Add(Near.Cc5);
+        T2cof.Add(Near.T2cof); T3cof.Add(Near.T3cof); T4cof.Add(Near.T4cof); T5cof.Add(Near.T5cof);
+        Omgcof.Add(Near.Omgcof); Xmcof.Add(Near.Xmcof); Eta.Add(Near.Eta); Delmo.Add(Near.Delmo); Sinmao.Add(Near.Sinmao);
+        D2.Add(Near.D2); D3.Add(Near.D3); D4.Add(Near.D4);
+        Aycof.Add(Near.Aycof); Xlcof.Add(Near.Xlcof); Con41.Add(Near.Con41); X1mth2.Add(Near.X1mth2); X7thm1.Add(Near.X7thm1);
+    }
+
+
+    // xxsgp4i (and zzinil, zzdscm, zzdsin), for one satellite
+    bool FTleBatch::Initialize(const double* e, double EpochJdUtc, FNearEarth& Near, FDeepSpace& Deep, bool& bDeep, FString& Error) const
+    {
+        const double bstar = e[FSTwoLineElements::BSTAR];
+        const double inclo = e[FSTwoLineElements::XINCL];
+        const double nodeo = e[FSTwoLineElements::XNODEO];
+        const double ecco = e[FSTwoLineElements::EO];
+        const double argpo = e[FSTwoLineElements::OMEGAO];
+        const double mo = e[FSTwoLineElements::XMO];
+        double no = e[FSTwoLineElements::XNO];
+
+        // Days since 1950 Jan 0.0 UTC
+        const double epoch = EpochJdUtc - 2433281.5;
+
+        // zzinil: un-Kozai the mean motion
+        const double eccsq = ecco * ecco;
+        const double omeosq = 1. - eccsq;
+        const double rteosq = FMath::Sqrt(omeosq);
+        const double cosio = FMath::Cos(inclo);
+        const double cosio2 = cosio * cosio;
+
+        const double ak = FMath::Pow(Ke / no, X2o3);
+        const double d1 = 0.75 * J2 * (3. * cosio2 - 1.) / (rteosq * omeosq);
+        double del = d1 / (ak * ak);
+        const double adel = ak * (1. - del * del - del * (1. / 3. + 134. * del * del / 81.));
+        del = d1 / (adel * adel);
+        no /= (1. + del);
+
+        const double ao = FMath::Pow(Ke / no, X2o3);
+        const double sinio = FMath::Sin(inclo);
+        const double po = ao * omeosq;
+        const double con42 = 1. - 5. * cosio2;
+        const double con41 = -con42 - cosio2 - cosio2;
+        const double posq = po * po;
+        const double rp = ao * (1. - ecco);
+
+        // Greenwich sidereal time at epoch, AFSPC's form (opmode 1)
+        const double ts70 = epoch - 7305.;
+        const double ids70 = FMath::FloorToDouble(ts70 + 1e-8);
+        const double tfrac = ts70 - ids70;
+        const double c1 = 0.0172027916940703639;
+        const double thgr70 = 1.7321343856509374;
+        const double fk5r = 5.07551419432269442e-15;
+        double gsto = FMath::Fmod(thgr70 + c1 * ids70 + (c1 + TwoPi) * tfrac + ts70 * ts70 * fk5r, TwoPi);
+        if (gsto < 0.)
+        {
+            gsto += TwoPi;
+        }
+
+        if (rp < 1.)
+        {
+            Error = TEXT("is suborbital");
+            return false;
+        }
+
+        bool dosimp = rp < 220. / Er + 1.;
+
+        // Drag: the atmosphere's density parameters, lowered for low perigees
+        double sfour = 78. / Er + 1.;
+        double qzms24 = FMath::Pow(42. / Er, 4.);
+        const double perige = (rp - 1.) * Er;
+        if (perige < 156.)
+        {
+            sfour = perige <= 98. ? 20. : perige - 78.;
+            qzms24 = FMath::Pow((120. - sfour) / Er, 4.);
+            sfour = sfour / Er + 1.;
+        }
+
+        const double pinvsq = 1. / posq;
+        const double tsi = 1. / (ao - sfour);
+        const double eta = ao * ecco * tsi;
+        const double etasq = eta * eta;
+        const double eeta = ecco * eta;
+        const double psisq = FMath::Abs(1. - etasq);
+        const double coef = qzms24 * FMath::Pow(tsi, 4.);
+        const double coef1 = coef / FMath::Pow(psisq, 3.5);
+        const double cc2 = coef1 * no * (ao * (1. + 1.5 * etasq + eeta * (4. + etasq)) + 0.375 * J2 * tsi / psisq * con41 * (8. + 3. * etasq * (8. + etasq)));
+        const double cc1 = bstar * cc2;
+        const double cc3 = ecco > 1e-4 ? -2. * coef * tsi * J3oJ2 * no * sinio / ecco : 0.;
+        const double x1mth2 = 1. - cosio2;
+        const double cc4 = 2. * no * coef1 * ao * omeosq * (eta * (2. + 0.5 * etasq) + ecco * (0.5 + 2. * etasq) - J2 * tsi / (ao * psisq) * (-3. * con41 * (1. - 2. * eeta + etasq * (1.5 - 0.5 * eeta)) + 0.75 * x1mth2 * (2. * etasq - eeta * (1. + etasq)) * FMath::Cos(2. * argpo)));
+        const double cc5 = 2. * coef1 * ao * omeosq * (1. + 2.75 * (etasq + eeta) + eeta * etasq);
+
+        // Secular rates
+        const double cosio4 = cosio2 * cosio2;
+        const double temp1 = 1.5 * J2 * pinvsq * no;
+        const double temp2 = 0.5 * temp1 * J2 * pinvsq;
+        const double temp3 = -0.46875 * J4 * pinvsq * pinvsq * no;
+        const double mdot = no + 0.5 * temp1 * rteosq * con41 + 0.0625 * temp2 * rteosq * (13. - 78. * cosio2 + 137. * cosio4);
+        const double argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7. - 114. * cosio2 + 395. * cosio4) + temp3 * (3. - 36. * cosio2 + 49. * cosio4);
+        const double xhdot1 = -temp1 * cosio;
+        const double nodedot = xhdot1 + (0.5 * temp2 * (4. - 19. * cosio2) + 2. * temp3 * (3. - 7. * cosio2)) * cosio;
+        const double xpidot = argpdot + nodedot;
+        const double omgcof = bstar * cc3 * FMath::Cos(argpo);
+        const double xmcof = ecco > 1e-4 ? -X2o3 * coef * bstar / eeta : 0.;
+        const double nodecf = 3.5 * omeosq * xhdot1 * cc1;
+        const double t2cof = 1.5 * cc1;
+        const double xlcof = ComputeXlcof(J3oJ2, sinio, cosio);
+        const double aycof = -0.5 * J3oJ2 * sinio;
+        const double delmo = FMath::Pow(1. + eta * FMath::Cos(mo), 3.);
+        const double sinmao = FMath::Sin(mo);
+        const double x7thm1 = 7. * cosio2 - 1.;
+
+        bDeep = TwoPi / no >= 225.;
+        if (bDeep)
+        {
+            Deep.Epoch = e[FSTwoLineElements::EPOCH];
+            Deep.Mo = mo; Deep.Mdot = mdot; Deep.Argpo = argpo; Deep.Argpdot = argpdot;
+            Deep.Nodeo = nodeo; Deep.Nodedot = nodedot; Deep.Nodecf = nodecf;
+            Deep.Ecco = ecco; Deep.Inclo = inclo; Deep.No = no; Deep.Bstar = bstar;
+            Deep.Cc1 = cc1; Deep.Cc4 = cc4; Deep.T2cof = t2cof; Deep.Gsto = gsto;
+
+            // zzdscm: lunar-solar terms, at epoch
+            const double zes = 0.01675;
+            const double zel = 0.0549;
+            const double c1ss = 2.9864797e-6;
+            const double c1l = 4.7968065e-7;
+            const double zsinis = 0.39785416;
+            const double zcosis = 0.91744867;
+            const double zcosgs = 0.1945905;
+            const double zsings = -0.98088458;
+
+            const double snodm = FMath::Sin(nodeo);
+            const double cnodm = FMath::Cos(nodeo);
+            const double sinomm = FMath::Sin(argpo);
+            const double cosomm = FMath::Cos(argpo);
+            const double sinim = sinio;
+            const double cosim = cosio;
+            const double emsq = eccsq;
+            const double betasq = 1. - emsq;
+            const double rtemsq = FMath::Sqrt(betasq);
+
+            const double day = epoch + 18261.5;
+            const double xnodce = FMath::Fmod(4.523602 - 9.2422029e-4 * day, TwoPi);
+            const double stem = FMath::Sin(xnodce);
+            const double ctem = FMath::Cos(xnodce);
+            const double zcosil = 0.91375164 - 0.03568096 * ctem;
+            const double zsinil = FMath::Sqrt(1. - zcosil * zcosil);
+            const double zsinhl = 0.089683511 * stem / zsinil;
+            const double zcoshl = FMath::Sqrt(1. - zsinhl * zsinhl);
+            const double gam = 5.8351514 + 0.001944368 * day;
+            double zx = 0.39785416 * stem / zsinil;
+            const double zy = zcoshl * ctem + 0.91744867 * zsinhl * stem;
+            zx = FMath::Atan2(zx, zy);
+            zx = gam + zx - xnodce;
+            const double zcosgl = FMath::Cos(zx);
+            const double zsingl = FMath::Sin(zx);
+
+            // Solar, then lunar
+            double zcosg = zcosgs, zsing = zsings, zcosi = zcosis, zsini = zsinis;
+            double zcosh = cnodm, zsinh = snodm;
+            double cc = c1ss;
+            const double xnoi = 1. / no;
+
+            double s[2][8], z[2][4][4];
+            for (int32 lsflg = 0; lsflg < 2; ++lsflg)
+            {
+                const double a1 = zcosg * zcosh + zsing * zcosi * zsinh;
+                const double a3 = -zsing * zcosh + zcosg * zcosi * zsinh;
+                const double a7 = -zcosg * zsinh + zsing * zcosi * zcosh;
+                const double a8 = zsing * zsini;
+                const double a9 = zsing * zsinh + zcosg * zcosi * zcosh;
+                const double a10 = zcosg * zsini;
+                const double a2 = cosim * a7 + sinim * a8;
+                const double a4 = cosim * a9 + sinim * a10;
+                const double a5 = -sinim * a7 + cosim * a8;
+                const double a6 = -sinim * a9 + cosim * a10;
+
+                const double x1 = a1 * cosomm + a2 * sinomm;
+                const double x2 = a3 * cosomm + a4 * sinomm;
+                const double x3 = -a1 * sinomm + a2 * cosomm;
+                const double x4 = -a3 * sinomm + a4 * cosomm;
+                const double x5 = a5 * sinomm;
+                const double x6 = a6 * sinomm;
+                const double x7 = a5 * cosomm;
+                const double x8 = a6 * cosomm;
+
+                // z[.][0][k] is z1..z3, z[.][j][k] is zjk
+                double (&zz)[4][4] = z[lsflg];
+                zz[3][1] = 12. * x1 * x1 - 3. * x3 * x3;
+                zz[3][2] = 24. * x1 * x2 - 6. * x3 * x4;
+                zz[3][3] = 12. * x2 * x2 - 3. * x4 * x4;
+                zz[0][1] = 3. * (a1 * a1 + a2 * a2) + zz[3][1] * emsq;
+                zz[0][2] = 6. * (a1 * a3 + a2 * a4) + zz[3][2] * emsq;
+                zz[0][3] = 3. * (a3 * a3 + a4 * a4) + zz[3][3] * emsq;
+                zz[1][1] = -6. * a1 * a5 + emsq * (-24. * x1 * x7 - 6. * x3 * x5);
+                zz[1][2] = -6. * (a1 * a6 + a3 * a5) + emsq * (-24. * (x2 * x7 + x1 * x8) - 6. * (x3 * x6 + x4 * x5));
+                zz[1][3] = -6. * a3 * a6 + emsq * (-24. * x2 * x8 - 6. * x4 * x6);
+                zz[2][1] = 6. * a2 * a5 + emsq * (24. * x1 * x5 - 6. * x3 * x7);
+                zz[2][2] = 6. * (a4 * a5 + a2 * a6) + emsq * (24. * (x2 * x5 + x1 * x6) - 6. * (x4 * x7 + x3 * x8));
+                zz[2][3] = 6. * a4 * a6 + emsq * (24. * x2 * x6 - 6. * x4 * x8);
+                zz[0][1] = zz[0][1] + zz[0][1] + betasq * zz[3][1];
+                zz[0][2] = zz[0][2] + zz[0][2] + betasq * zz[3][2];
+                zz[0][3] = zz[0][3] + zz[0][3] + betasq * zz[3][3];
+
+                double (&ss)[8] = s[lsflg];
+                ss[3] = cc * xnoi;
+                ss[2] = -0.5 * ss[3] / rtemsq;
+                ss[4] = ss[3] * rtemsq;
+                ss[1] = -15. * ecco * ss[4];
+                ss[5] = x1 * x3 + x2 * x4;
+                ss[6] = x2 * x3 + x1 * x4;
+                ss[7] = x2 * x4 - x1 * x3;
+
+                zcosg = zcosgl;
+                zsing = zsingl;
+                zcosi = zcosil;
+                zsini = zsinil;
+                zcosh = zcoshl * cnodm + zsinhl * snodm;
+                zsinh = snodm * zcoshl - cnodm * zsinhl;
+                cc = c1l;
+            }
+
+            const double (&ss)[8] = s[0];
+            const double (&sz)[4][4] = z[0];
+            const double (&sl)[8] = s[1];
+            const double (&zl)[4][4] = z[1];
+
+            Deep.Zmol = FMath::Fmod(4.7199672 + 0.2299715 * day - gam, TwoPi);
+            Deep.Zmos = FMath::Fmod(6.2565837 + 0.017201977 * day, TwoPi);
+
+            Deep.Se2 = 2. * ss[1] * ss[6];
+            Deep.Se3 = 2. * ss[1] * ss[7];
+            Deep.Si2 = 2. * ss[2] * sz[1][2];
+            Deep.Si3 = 2. * ss[2] * (sz[1][3] - sz[1][1]);
+            Deep.Sl2 = -2. * ss[3] * sz[0][2];
+            Deep.Sl3 = -2. * ss[3] * (sz[0][3] - sz[0][1]);
+            Deep.Sl4 = -2. * ss[3] * (-21. - 9. * emsq) * zes;
+            Deep.Sgh2 = 2. * ss[4] * sz[3][2];
+            Deep.Sgh3 = 2. * ss[4] * (sz[3][3] - sz[3][1]);
+            Deep.Sgh4 = -18. * ss[4] * zes;
+            Deep.Sh2 = -2. * ss[2] * sz[2][2];
+            Deep.Sh3 = -2. * ss[2] * (sz[2][3] - sz[2][1]);
+
+            Deep.Ee2 = 2. * sl[1] * sl[6];
+            Deep.E3 = 2. * sl[1] * sl[7];
+            Deep.Xi2 = 2. * sl[2] * zl[1][2];
+            Deep.Xi3 = 2. * sl[2] * (zl[1][3] - zl[1][1]);
+            Deep.Xl2 = -2. * sl[3] * zl[0][2];
+            Deep.Xl3 = -2. * sl[3] * (zl[0][3] - zl[0][1]);
+            Deep.Xl4 = -2. * sl[3] * (-21. - 9. * emsq) * zel;
+            Deep.Xgh2 = 2. * sl[4] * zl[3][2];
+            Deep.Xgh3 = 2. * sl[4] * (zl[3][3] - zl[3][1]);
+            Deep.Xgh4 = -18. * sl[4] * zel;
+            Deep.Xh2 = -2. * sl[2] * zl[2][2];
+            Deep.Xh3 = -2. * sl[2] * (zl[2][3] - zl[2][1]);
+
+            // zzdsin: secular rates, and the resonances
+            const double q22 = 1.7891679e-6;
+            const double q31 = 2.1460748e-6;
+            const double q33 = 2.2123015e-7;
+            const double root22 = 1.7891679e-6;
+            const double root44 = 7.3636953e-9;
+            const double root54 = 2.1765803e-9;
+            const double rptim = 0.00437526908801129966;
+            const double root32 = 3.7393792e-7;
+            const double root52 = 1.1428639e-7;
+            const double znl = 1.5835218e-4;
+            const double zns = 1.19459e-5;
+
+            const double xn = no;
+            Deep.Irez = 0;
+            if (xn < 0.0052359877 && xn > 0.0034906585)
+            {
+                Deep.Irez = 1;
+            }
+            if (xn >= 0.00826 && xn <= 0.00924 && ecco >= 0.5)
+            {
+                Deep.Irez = 2;
+            }
+
+            const bool bPolar = inclo < 0.052359877 || inclo > UE_DOUBLE_PI - 0.052359877;
+            const double ses = ss[1] * zns * ss[5];
+            const double sis = ss[2] * zns * (sz[1][1] + sz[1][3]);
+            const double sls = -zns * ss[3] * (sz[0][1] + sz[0][3] - 14. - 6. * emsq);
+            const double sghs = ss[4] * zns * (sz[3][1] + sz[3][3] - 6.);
+            double shs = bPolar ? 0. : -zns * ss[2] * (sz[2][1] + sz[2][3]);
+            if (sinim != 0.)
+            {
+                shs /= sinim;
+            }
+            const double sgs = sghs - cosim * shs;
+
+            Deep.Dedt = ses + sl[1] * znl * sl[5];
+            Deep.Didt = sis + sl[2] * znl * (zl[1][1] + zl[1][3]);
+            Deep.Dmdt = sls - znl * sl[3] * (zl[0][1] + zl[0][3] - 14. - 6. * emsq);
+            const double sghl = sl[4] * znl * (zl[3][1] + zl[3][3] - 6.);
+            const double shl = bPolar ? 0. : -znl * sl[2] * (zl[2][1] + zl[2][3]);
+            Deep.Domdt = sgs + sghl;
+            Deep.Dnodt = shs;
+            if (sinim != 0.)
+            {
+                Deep.Domdt -= cosim / sinim * shl;
+                Deep.Dnodt += shl / sinim;
+            }
+
+            Deep.Del1 = Deep.Del2 = Deep.Del3 = 0.;
+            Deep.D2201 = Deep.D2211 = Deep.D3210 = Deep.D3222 = Deep.D4410 = Deep.D4422 = 0.;
+            Deep.D5220 = Deep.D5232 = Deep.D5421 = Deep.D5433 = 0.;
+            Deep.Xfact = Deep.Xlamo = 0.;
+
+            const double theta = FMath::Fmod(gsto, TwoPi);
+            if (Deep.Irez != 0)
+            {
+                const double aonv = FMath::Pow(xn / Ke, X2o3);
+                if (Deep.Irez == 2)
+                {
+                    // 12 hour resonance
+                    const double cosisq = cosim * cosim;
+                    const double eoc = ecco * emsq;
+                    const double g201 = -0.306 - (ecco - 0.64) * 0.44;
+                    double g211, g310, g322, g410, g422, g520, g533, g521, g532;
+                    if (ecco <= 0.65)
+                    {
+                        g211 = 3.616 - 13.247 * ecco + 16.29 * emsq;
+                        g310 = -19.302 + 117.39 * ecco - 228.419 * emsq + 156.591 * eoc;
+                        g322 = -18.9068 + 109.7927 * ecco - 214.6334 * emsq + 146.5816 * eoc;
+                        g410 = -41.122 + 242.694 * ecco - 471.094 * emsq + 313.953 * eoc;
+                        g422 = -146.407 + 841.88 * ecco - 1629.014 * emsq + 1083.435 * eoc;
+                        g520 = -532.114 + 3017.977 * ecco - 5740.032 * emsq + 3708.276 * eoc;
+                    }
+                    else
+                    {
+                        g211 = -72.099 + 331.819 * ecco - 508.738 * emsq + 266.724 * eoc;
+                        g310 = -346.844 + 1582.851 * ecco - 2415.925 * emsq + 1246.113 * eoc;
+                        g322 = -342.585 + 1554.908 * ecco - 2366.899 * emsq + 1215.972 * eoc;
+                        g410 = -1052.797 + 4758.686 * ecco - 7193.992 * emsq + 3651.957 * eoc;
+                        g422 = -3581.69 + 16178.11 * ecco - 24462.77 * emsq + 12422.52 * eoc;
+                        g520 = ecco > 0.715
+                            ? -5149.66 + 29936.92 * ecco - 54087.36 * emsq + 31324.56 * eoc
+                            : 1464.74 - 4664.75 * ecco + 3763.64 * emsq;
+                    }
+                    if (ecco < 0.7)
+                    {
+                        g533 = -919.2277 + 4988.61 * ecco - 9064.77 * emsq + 5542.21 * eoc;
+                        g521 = -822.71072 + 4568.6173 * ecco - 8491.4146 * emsq + 5337.524 * eoc;
+                        g532 = -853.666 + 4690.25 * ecco - 8624.77 * emsq + 5341.4 * eoc;
+                    }
+                    else
+                    {
+                        g533 = -37995.78 + 161616.52 * ecco - 229838.2 * emsq + 109377.94 * eoc;
+                        g521 = -51752.104 + 218913.95 * ecco - 309468.16 * emsq + 146349.42 * eoc;
+                        g532 = -40023.88 + 170470.89 * ecco - 242699.48 * emsq + 115605.82 * eoc;
+                    }
+
+                    const double sini2 = sinim * sinim;
+                    const double f220 = 0.75 * (1. + 2. * cosim + cosisq);
+                    const double f221 = 1.5 * sini2;
+                    const double f321 = 1.875 * sinim * (1. - 2. * cosim - 3. * cosisq);
+                    const double f322 = -1.875 * sinim * (1. + 2. * cosim - 3. * cosisq);
+                    const double f441 = 35. * sini2 * f220;
+                    const double f442 = 39.375 * sini2 * sini2;
+                    const double f522 = 9.84375 * sinim * (sini2 * (1. - 2. * cosim - 5. * cosisq) + 0.33333333 * (-2. + 4. * cosim + 6. * cosisq));
+                    const double f523 = sinim * (4.92187512 * sini2 * (-2. - 4. * cosim + 10. * cosisq) + 6.56250012 * (1. + 2. * cosim - 3. * cosisq));
+                    const double f542 = 29.53125 * sinim * (2. - 8. * cosim + cosisq * (-12. + 8. * cosim + 10. * cosisq));
+                    const double f543 = 29.53125 * sinim * (-2. - 8. * cosim + cosisq * (12. + 8. * cosim - 10. * cosisq));
+
+                    const double xno2 = xn * xn;
+                    const double ainv2 = aonv * aonv;
+                    double rtemp1 = 3. * xno2 * ainv2;
+                    double rtemp = rtemp1 * root22;
+                    Deep.D2201 = rtemp * f220 * g201;
+                    Deep.D2211 = rtemp * f221 * g211;
+                    rtemp1 *= aonv;
+                    rtemp = rtemp1 * root32;
+                    Deep.D3210 = rtemp * f321 * g310;
+                    Deep.D3222 = rtemp * f322 * g322;
+                    rtemp1 *= aonv;
+                    rtemp = 2. * rtemp1 * root44;
+                    Deep.D4410 = rtemp * f441 * g410;
+                    Deep.D4422 = rtemp * f442 * g422;
+                    rtemp1 *= aonv;
+                    rtemp = rtemp1 * root52;
+                    Deep.D5220 = rtemp * f522 * g520;
+                    Deep.D5232 = rtemp * f523 * g532;
+                    rtemp = 2. * rtemp1 * root54;
+                    Deep.D5421 = rtemp * f542 * g521;
+                    Deep.D5433 = rtemp * f543 * g533;
+
+                    Deep.Xlamo = FMath::Fmod(mo + nodeo + nodeo - theta - theta, TwoPi);
+                    Deep.Xfact = mdot + Deep.Dmdt + 2. * (nodedot + Deep.Dnodt - rptim) - no;
+                }
+                else
+                {
+                    // 24 hour (synchronous) resonance
+                    const double g200 = 1. + emsq * (-2.5 + 0.8125 * emsq);
+                    const double g310 = 1. + 2. * emsq;
+                    const double g300 = 1. + emsq * (-6. + 6.60937 * emsq);
+                    const double f220 = 0.75 * (1. + cosim) * (1. + cosim);
+                    const double f311 = 0.9375 * sinim * sinim * (1. + 3. * cosim) - 0.75 * (1. + cosim);
+                    double f330 = 1. + cosim;
+                    f330 = 1.875 * f330 * f330 * f330;
+                    const double del1 = 3. * xn * xn * aonv * aonv;
+                    Deep.Del2 = 2. * del1 * f220 * g200 * q22;
+                    Deep.Del3 = 3. * del1 * f330 * g300 * q33 * aonv;
+                    Deep.Del1 = del1 * f311 * g310 * q31 * aonv;
+
+                    Deep.Xlamo = FMath::Fmod(mo + nodeo + argpo - theta, TwoPi);
+                    Deep.Xfact = mdot + xpidot - rptim + Deep.Dmdt + Deep.Domdt + Deep.Dnodt - no;
+                }
+            }
+
+            return true;
+        }
+
+        Near.Epoch = e[FSTwoLineElements::EPOCH];
+        Near.Mo = mo; Near.Mdot = mdot; Near.Argpo = argpo; Near.Argpdot = argpdot;
+        Near.Nodeo = nodeo; Near.Nodedot = nodedot; Near.Nodecf = nodecf;
+        Near.Ecco = ecco; Near.Inclo = inclo; Near.No = no; Near.Ao = ao; Near.Bstar = bstar;
+        Near.Cc1 = cc1; Near.Cc4 = cc4; Near.T2cof = t2cof;
+        Near.Eta = eta; Near.Aycof = aycof; Near.Xlcof = xlcof;
+        Near.Con41 = con41; Near.X1mth2 = x1mth2; Near.X7thm1 = x7thm1;
+
+        // The simple model is the full one without these terms
+        Near.Cc5 = Near.Omgcof = Near.Xmcof = Near.Delmo = Near.Sinmao = 0.;
+        Near.D2 = Near.D3 = Near.D4 = Near.T3cof = Near.T4cof = Near.T5cof = 0.;
+        if (!dosimp)
+        {
+            const double cc1sq = cc1 * cc1;
+            const double d2 = 4. * ao * tsi * cc1sq;
+            const double temp = d2 * tsi * cc1 / 3.;
+            const double d3 = (17. * ao + sfour) * temp;
+            const double d4 = 0.5 * temp * ao * tsi * (221. * ao + 31. * sfour) * cc1;
+
+            Near.Cc5 = cc5; Near.Omgcof = omgcof; Near.Xmcof = xmcof; Near.Delmo = delmo; Near.Sinmao = sinmao;
+            Near.D2 = d2; Near.D3 = d3; Near.D4 = d4;
+            Near.T3cof = d2 + 2. * cc1sq;
+            Near.T4cof = 0.25 * (3. * d3 + cc1 * (12. * d2 + 10. * cc1sq));
+            Near.T5cof = 0.2 * (3. * d4 + 12. * cc1 * d3 + 6. * d2 * d2 + 15. * cc1sq * (2. * d2 + cc1sq));
+        }
+
+        return true;
+    }
+
+
+    template<typename T>
+    void FTleBatch::PropagateNear(int32 Slot, double et, T (&State)[6], T& Error) const
+    {
+        const T t = (T(et) - Load<T>(Epoch, Slot)) * T(MinutesPerSecond);
+        const T t2 = t * t;
+        const T t3 = t2 * t;
+        const T t4 = t3 * t;
+
+        const T bstar = Load<T>(Bstar, Slot);
+        const T no = Load<T>(No, Slot);
+
+        // Secular gravity and drag
+        const T xmdf = Load<T>(Mo, Slot) + Load<T>(Mdot, Slot) * t;
+        const T omgadf = Load<T>(Argpo, Slot) + Load<T>(Argpdot, Slot) * t;
+        const T xnoddf = Load<T>(Nodeo, Slot) + Load<T>(Nodedot, Slot) * t;
+        T nodem = xnoddf + Load<T>(Nodecf, Slot) * t2;
+
+        const T eta = Load<T>(Eta, Slot);
+        const T cm = T(1.) + eta * Cos(xmdf);
+        const T delomg = Load<T>(Omgcof, Slot) * t;
+        const T delm = Load<T>(Xmcof, Slot) * (cm * cm * cm - Load<T>(Delmo, Slot));
+        T mm = xmdf + (delomg + delm);
+        T argpm = omgadf - (delomg + delm);
+
+        const T tempa = T(1.) - Load<T>(Cc1, Slot) * t - Load<T>(D2, Slot) * t2 - Load<T>(D3, Slot) * t3 - Load<T>(D4, Slot) * t4;
+        const T tempe = bstar * Load<T>(Cc4, Slot) * t + bstar * Load<T>(Cc5, Slot) * (Sin(mm) - Load<T>(Sinmao, Slot));
+        const T templ = Load<T>(T2cof, Slot) * t2 + Load<T>(T3cof, Slot) * t3 + t4 * (Load<T>(T4cof, Slot) + t * Load<T>(T5cof, Slot));
+
+        // (ke / no)^(2/3) is ao
+        const T am = Load<T>(Ao, Slot) * tempa * tempa;
+        const T xn = T(Ke) / (am * Sqrt(am));
+        T eccm = Load<T>(Ecco, Slot) - tempe;
+
+        Error = Select(Less(am, T(0.95)), T(Code(EError::MeanSemiMajorAxis)), T(0.));
+        Error = Select(Less(eccm, T(-0.001)), T(Code(EError::MeanEccentricity)), Error);
+        Error = Select(Less(eccm, T(1.)), Error, T(Code(EError::MeanEccentricity)));
+        eccm = Select(Less(eccm, T(1e-6)), T(1e-6), eccm);
+
+        mm = mm + no * templ;
+        T xlm = mm + argpm + nodem;
+        nodem = Mod2Pi(nodem);
+        argpm = Mod2Pi(argpm);
+        xlm = Mod2Pi(xlm);
+        mm = Mod2Pi(xlm - argpm - nodem);
+
+        const T inclo = Load<T>(Inclo, Slot);
+        Finish<T>(J2, Ke, Er,
+            am, xn, eccm, inclo, Sin(inclo), Cos(inclo), argpm, nodem, mm,
+            Load<T>(Aycof, Slot), Load<T>(Xlcof, Slot), Load<T>(Con41, Slot), Load<T>(X1mth2, Slot), Load<T>(X7thm1, Slot),
+            State, Error);
+    }
+
+
+    EError FTleBatch::PropagateDeep(const FDeepSpace& d, double et, double (&State)[6]) const
+    {
+        const double t = (et - d.Epoch) * MinutesPerSecond;
+        const double t2 = t * t;
+
+        const double xmdf = d.Mo + d.Mdot * t;
+        const double omgadf = d.Argpo + d.Argpdot * t;
+        const double xnoddf = d.Nodeo + d.Nodedot * t;
+        double argpm = omgadf;
+        double mm = xmdf;
+        double nodem = xnoddf + d.Nodecf * t2;
+        const double tempa = 1. - d.Cc1 * t;
+        const double tempe = d.Bstar * d.Cc4 * t;
+        const double templ = d.T2cof * t2;
+
+        // zzdspc: lunar-solar secular terms, and the resonances
+        const double rptim = 0.00437526908801129966;
+        const double theta = FMath::Fmod(d.Gsto + t * rptim, TwoPi);
+        double eccm = d.Ecco + d.Dedt * t;
+        double inclm = d.Inclo + d.Didt * t;
+        argpm += d.Domdt * t;
+        nodem += d.Dnodt * t;
+        mm += d.Dmdt * t;
+
+        double xn = d.No;
+        if (d.Irez != 0)
+        {
+            const double fasx2 = 0.13130908;
+            const double fasx4 = 2.8843198;
+            const double fasx6 = 0.37448087;
+            const double g22 = 5.7686396;
+            const double g32 = 0.95240898;
+            const double g44 = 1.8014998;
+            const double g52 = 1.050833;
+            const double g54 = 4.4108898;
+            const double stepp = 720.;
+            const double step2 = 259200.;
+
+            // Euler-Maclaurin steps from epoch
+            const double delt = t > 0. ? stepp : -stepp;
+            double atime = 0.;
+            double xni = d.No;
+            double xli = d.Xlamo;
+            double xndt, xldot, xnddt, ft;
+            for (;;)
+            {
+                if (d.Irez != 2)
+                {
+                    xndt = d.Del1 * FMath::Sin(xli - fasx2) + d.Del2 * FMath::Sin(2. * (xli - fasx4)) + d.Del3 * FMath::Sin(3. * (xli - fasx6));
+                    xldot = xni + d.Xfact;
+                    xnddt = d.Del1 * FMath::Cos(xli - fasx2) + 2. * d.Del2 * FMath::Cos(2. * (xli - fasx4)) + 3. * d.Del3 * FMath::Cos(3. * (xli - fasx6));
+                    xnddt *= xldot;
+                }
+                else
+                {
+                    const double xomi = d.Argpo + d.Argpdot * atime;
+                    const double x2omi = xomi + xomi;
+                    const double x2li = xli + xli;
+                    xndt = d.D2201 * FMath::Sin(x2omi + xli - g22) + d.D2211 * FMath::Sin(xli - g22)
+                        + d.D3210 * FMath::Sin(xomi + xli - g32) + d.D3222 * FMath::Sin(-xomi + xli - g32)
+                        + d.D4410 * FMath::Sin(x2omi + x2li - g44) + d.D4422 * FMath::Sin(x2li - g44)
+                        + d.D5220 * FMath::Sin(xomi + xli - g52) + d.D5232 * FMath::Sin(-xomi + xli - g52)
+                        + d.D5421 * FMath::Sin(xomi + x2li - g54) + d.D5433 * FMath::Sin(-xomi + x2li - g54);
+                    xldot = xni + d.Xfact;
+                    xnddt = d.D2201 * FMath::Cos(x2omi + xli - g22) + d.D2211 * FMath::Cos(xli - g22)
+                        + d.D3210 * FMath::Cos(xomi + xli - g32) + d.D3222 * FMath::Cos(-xomi + xli - g32)
+                        + d.D5220 * FMath::Cos(xomi + xli - g52) + d.D5232 * FMath::Cos(-xomi + xli - g52)
+                        + 2. * (d.D4410 * FMath::Cos(x2omi + x2li - g44) + d.D4422 * FMath::Cos(x2li - g44)
+                            + d.D5421 * FMath::Cos(xomi + x2li - g54) + d.D5433 * FMath::Cos(-xomi + x2li - g54));
+                    xnddt *= xldot;
+                }
+
+                if (FMath::Abs(t - atime) < stepp)
+                {
+                    ft = t - atime;
+                    break;
+                }
+
+                xli = xli + xldot * delt + xndt * step2;
+                xni = xni + xndt * delt + xnddt * step2;
+                atime += delt;
+            }
+
+            xn = xni + xndt * ft + xnddt * ft * ft * 0.5;
+            const double xl = xli + xldot * ft + xndt * ft * ft * 0.5;
+            mm = d.Irez != 1 ? xl - 2. * nodem + 2. * theta : xl - nodem - argpm + theta;
+        }
+
+        if (xn <= 0.)
+        {
+            return EError::MeanMotion;
+        }
+
+        const double am = FMath::Pow(Ke / xn, X2o3) * tempa * tempa;
+        xn = Ke / FMath::Pow(am, 1.5);
+        eccm -= tempe;
+        if (eccm >= 1. || eccm < -0.001)
+        {
+            return EError::MeanEccentricity;
+        }
+        if (am < 0.95)
+        {
+            return EError::MeanSemiMajorAxis;
+        }
+        eccm = FMath::Max(eccm, 1e-6);
+
+        mm += d.No * templ;
+        double xlm = mm + argpm + nodem;
+        nodem = FMath::Fmod(nodem, TwoPi);
+        argpm = FMath::Fmod(argpm, TwoPi);
+        xlm = FMath::Fmod(xlm, TwoPi);
+        mm = FMath::Fmod(xlm - argpm - nodem, TwoPi);
+
+        // zzdspr: lunar-solar periodics
+        double eccp = eccm, xincp = inclm, argpp = argpm, nodep = nodem, mp = mm;
+        {
+            const double zes = 0.01675;
+            const double zel = 0.0549;
+            const double zns = 1.19459e-5;
+            const double znl = 1.5835218e-4;
+
+            double zm = d.Zmos + zns * t;
+            double zf = zm + 2. * zes * FMath::Sin(zm);
+            double sinzf = FMath::Sin(zf);
+            double f2 = 0.5 * sinzf * sinzf - 0.25;
+            double f3 = -0.5 * sinzf * FMath::Cos(zf);
+            const double ses = d.Se2 * f2 + d.Se3 * f3;
+            const double sis = d.Si2 * f2 + d.Si3 * f3;
+            const double sls = d.Sl2 * f2 + d.Sl3 * f3 + d.Sl4 * sinzf;
+            const double sghs = d.Sgh2 * f2 + d.Sgh3 * f3 + d.Sgh4 * sinzf;
+            const double shs = d.Sh2 * f2 + d.Sh3 * f3;
+
+            zm = d.Zmol + znl * t;
+            zf = zm + 2. * zel * FMath::Sin(zm);
+            sinzf = FMath::Sin(zf);
+            f2 = 0.5 * sinzf * sinzf - 0.25;
+            f3 = -0.5 * sinzf * FMath::Cos(zf);
+            const double sel = d.Ee2 * f2 + d.E3 * f3;
+            const double sil = d.Xi2 * f2 + d.Xi3 * f3;
+            const double sll = d.Xl2 * f2 + d.Xl3 * f3 + d.Xl4 * sinzf;
+            const double sghl = d.Xgh2 * f2 + d.Xgh3 * f3 + d.Xgh4 * sinzf;
+            const double shl = d.Xh2 * f2 + d.Xh3 * f3;
+
+            const double pe = ses + sel;
+            const double pinc = sis + sil;
+            const double pl = sls + sll;
+            double pgh = sghs + sghl;
+            double ph = shs + shl;
+
+            xincp += pinc;
+            eccp += pe;
+            const double sinip = FMath::Sin(xincp);
+            const double cosip = FMath::Cos(xincp);
+
+            if (xincp >= 0.2)
+            {
+                ph /= sinip;
+                pgh -= cosip * ph;
+                argpp += pgh;
+                nodep += ph;
+                mp += pl;
+            }
+            else
+            {
+                // Lyddane's modification, for low inclinations
+                const double sinop = FMath::Sin(nodep);
+                const double cosop = FMath::Cos(nodep);
+                const double alfdp = sinip * sinop + (ph * cosop + pinc * cosip * sinop);
+                const double betdp = sinip * cosop + (-ph * sinop + pinc * cosip * cosop);
+                nodep = FMath::Fmod(nodep, TwoPi);
+                if (nodep < 0.)
+                {
+                    nodep += TwoPi;
+                }
+                const double xls = mp + argpp + cosip * nodep + (pl + pgh - pinc * nodep * sinip);
+                const double xnoh = nodep;
+                nodep = FMath::Atan2(alfdp, betdp);
+                if (nodep < 0.)
+                {
+                    nodep += TwoPi;
+                }
+                if (FMath::Abs(xnoh - nodep) > UE_DOUBLE_PI)
+                {
+                    nodep += nodep < xnoh ? TwoPi : -TwoPi;
+                }
+                mp += pl;
+                argpp = xls - mp - cosip * nodep;
+            }
+        }
+
+        if (xincp < 0.)
+        {
+            xincp = -xincp;
+            nodep += UE_DOUBLE_PI;
+            argpp -= UE_DOUBLE_PI;
+        }
+        if (eccp < 0. || eccp > 1.)
+        {
+            return EError::PerturbedEccentricity;
+        }
+
+        const double sinip = FMath::Sin(xincp);
+        const double cosip = FMath::Cos(xincp);
+        const double cosisq = cosip * cosip;
+
+        double Error = 0.;
+        Finish<double>(J2, Ke, Er,
+            am, xn, eccp, xincp, sinip, cosip, argpp, nodep, mp,
+            -0.5 * J3oJ2 * sinip, ComputeXlcof(J3oJ2, sinip, cosip), 3. * cosisq - 1., 1. - cosisq, 7. * cosisq - 1.,
+            State, Error);
+
+        return (EError)(uint8)Error;
+    }
+
+
+    bool FTleBatch::Evaluate(const FSEphemerisTime& et, TArrayView<FSStateVector> States, TArrayView<EError> Errors, ES_ResultCode* ResultCode, FString* ErrorMessage) const
+    {
+        check(States.Num() == NumSatellites);
+        check(Errors.Num() == 0 || Errors.Num() == NumSatellites);
+
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+        EError FirstFailureReason = EError::None;
+
+        auto Store = [&](int32 i, const double (&State)[6], EError Error)
+        {
+            if (Errors.Num() > 0)
+            {
+                Errors[i] = Error;
+            }
+
+            if (Error == EError::None)
+            {
+                States[i] = FSStateVector(State);
+                return;
+            }
+
+            FScopeLock Lock(&FailureLock);
+            if (FirstFailure == INDEX_NONE || i < FirstFailure)
+            {
+                FirstFailure = i;
+                FirstFailureReason = Error;
+            }
+        };
+
+        const int32 NumNear = NearIndices.Num();
+        ForEachBatch(NumNear, BatchSize, [&](int32 Begin, int32 End)
+        {
+            int32 Slot = Begin;
+            for (; Slot + Lanes <= End; Slot += Lanes)
+            {
+                FLanes State[6], Error;
+                PropagateNear(Slot, et.seconds, State, Error);
+
+                alignas(32) double Out[6][Lanes], Codes[Lanes];
+                for (int32 k = 0; k < 6; ++k)
+                {
+                    VectorStore(State[k].v, Out[k]);
+                }
+                VectorStore(Error.v, Codes);
+
+                for (int32 Lane = 0; Lane < Lanes; ++Lane)
+                {
+                    const double LaneState[6] = { Out[0][Lane], Out[1][Lane], Out[2][Lane], Out[3][Lane], Out[4][Lane], Out[5][Lane] };
+                    Store(NearIndices[Slot + Lane], LaneState, (EError)(uint8)Codes[Lane]);
+                }
+            }
+
+            for (; Slot < End; ++Slot)
+            {
+                double State[6], Error;
+                PropagateNear(Slot, et.seconds, State, Error);
+                Store(NearIndices[Slot], State, (EError)(uint8)Error);
+            }
+        });
+
+        ForEachBatch(DeepSatellites.Num(), DeepBatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 Slot = Begin; Slot < End; ++Slot)
+            {
+                double State[6];
+                const EError Error = PropagateDeep(DeepSatellites[Slot], et.seconds, State);
+                Store(DeepIndices[Slot], State, Error);
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Sgp4: satellite %d %s at ET %f"), FirstFailure, ToString(FirstFailureReason), et.seconds));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
@@ -0,0 +1,381 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSmallBodies.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Small-body catalogs (asteroids, comets) as conic batches
+//
+// MPCORB.DAT is read in blocks of BlockSize bytes, and parsed in place as
+// ANSI text, line by line, carrying each block's last partial line over to
+// the next.  Its columns, from MPC's format description (1-based,
+// inclusive):
+//   1-7 designation, 9-13 H, 21-25 packed epoch, 27-35 M, 38-46 peri,
+//   49-57 node, 60-68 i, 71-79 e, 93-103 a, 167-194 readable designation
+// Packed epochs are a century letter (I = 1800, J = 1900, K = 2000), two
+// digits of year, then month and day as 1-9, A = 10, ... V = 31.
+//
+// Blueprint structs (such as SmallBodyRecord_STRUCT) name their fields
+// e.g. "e_33_AA846854419394571D22888EE7ED3517"; a field matches if its name
+// is the wanted one, or the wanted one with such a suffix.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSmallBodies.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceSmallBodies.h"
+#include "SpiceUtilities.h"
+#include "Engine/DataTable.h"
+#include "HAL/FileManager.h"
+#include "UObject/UnrealType.h"
+#include <cstdlib>
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::SmallBodies
+{
+    namespace
+    {
+        constexpr int32 BlockSize = 1 << 20;
+
+        // Shortest line with every element (through a)
+        constexpr int32 MinLineLength = 103;
+
+        // Julian date of J2000, and days from 1970-01-01 to 2000-01-01
+        constexpr double J2000 = 2451545.0;
+        constexpr int64 J2000Days = 10957;
+
+        // Days from 1970-01-01 to a Gregorian date (Hinnant's days_from_civil)
+        int64 DaysFromCivil(int64 y, int32 m, int32 d)
+        {
+            y -= m <= 2;
+            const int64 Era = (y >= 0 ? y : y - 399) / 400;
+            const int64 YearOfEra = y - Era * 400;
+            const int64 DayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+            const int64 DayOfEra = YearOfEra * 365 + YearOfEra / 4 - YearOfEra / 100 + DayOfYear;
+            return Era * 146097 + DayOfEra - 719468;
+        }
+
+        // 0-9, then A-V for 10-31
+        int32 Unpack(ANSICHAR c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'A' && c <= 'V') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool UnpackEpoch(const ANSICHAR* Packed, double& et)
+        {
+            const int32 Century = Unpack(Packed[0]);
+            const int32 Tens = Unpack(Packed[1]);
+            const int32 Units = Unpack(Packed[2]);
+            const int32 Month = Unpack(Packed[3]);
+            const int32 Day = Unpack(Packed[4]);
+
+            if (Century < 18 || Century > 21 || Tens < 0 || Tens > 9 || Units < 0 || Units > 9 || Month < 1 || Month > 12 || Day < 1)
+            {
+                return false;
+            }
+
+            const int64 Days = DaysFromCivil(Century * 100 + Tens * 10 + Units, Month, Day);
+            et = ((Days - J2000Days) - 0.5) * 86400.;
+            return true;
+        }
+
+        // Columns First through Last (1-based, inclusive), trimmed
+        FAnsiStringView Field(const ANSICHAR* Line, int32 First, int32 Last)
+        {
+            int32 Begin = First - 1;
+            int32 End = Last;
+            while (Begin < End && Line[Begin] == ' ') ++Begin;
+            while (End > Begin && Line[End - 1] == ' ') --End;
+            return FAnsiStringView(Line + Begin, End - Begin);
+        }
+
+        bool Number(FAnsiStringView Text, double& Value)
+        {
+            ANSICHAR Buffer[32];
+            if (Text.Len() == 0 || Text.Len() >= int32(UE_ARRAY_COUNT(Buffer)))
+            {
+                return false;
+            }
+
+            FMemory::Memcpy(Buffer, Text.GetData(), Text.Len());
+            Buffer[Text.Len()] = 0;
+
+            ANSICHAR* End = nullptr;
+            Value = std::strtod(Buffer, &End);
+            return End == Buffer + Text.Len();
+        }
+
+        // Adds one MPCORB line, if it's an orbit
+        void AddMpcorbLine(const ANSICHAR* Line, int32 Length, float maxMagnitude, double GM, FCatalog& Catalog)
+        {
+            if (Length < MinLineLength)
+            {
+                return;
+            }
+
+            double H = FCatalog::UnknownMagnitude;
+            const FAnsiStringView HField = Field(Line, 9, 13);
+            if (HField.Len() > 0 && !Number(HField, H))
+            {
+                return;
+            }
+            // (Never true of an unknown H)
+            if (H > maxMagnitude)
+            {
+                return;
+            }
+
+            double et, M, Peri, Node, i, e, a;
+            if (!UnpackEpoch(Line + 20, et)
+                || !Number(Field(Line, 27, 35), M)
+                || !Number(Field(Line, 38, 46), Peri)
+                || !Number(Field(Line, 49, 57), Node)
+                || !Number(Field(Line, 60, 68), i)
+                || !Number(Field(Line, 71, 79), e)
+                || !Number(Field(Line, 93, 103), a))
+            {
+                return;
+            }
+
+            // The readable designation if there is one, else the packed one
+            FAnsiStringView AnsiName = Length >= 167 ? Field(Line, 167, FMath::Min(Length, 194)) : FAnsiStringView();
+            if (AnsiName.Len() == 0)
+            {
+                AnsiName = Field(Line, 1, 7);
+            }
+
+            TCHAR Name[32];
+            const int32 NameLength = FMath::Min(AnsiName.Len(), int32(UE_ARRAY_COUNT(Name)));
+            for (int32 c = 0; c < NameLength; ++c) Name[c] = TCHAR(AnsiName[c]);
+
+            const FSConicElements Orbit(
+                FSDistance::FromAstronomicalUnits(a * (1. - e)),
+                e,
+                FSAngle::FromDegrees(i),
+                FSAngle::FromDegrees(Node),
+                FSAngle::FromDegrees(Peri),
+                FSAngle::FromDegrees(M),
+                FSEphemerisTime(et),
+                FSMassConstant(GM)
+            );
+
+            // Hyperbolic or degenerate lines are skipped
+            Catalog.Add(Orbit, FStringView(Name, NameLength), float(H));
+        }
+
+        // A struct field's name, without a Blueprint struct's "_<n>_<GUID>"
+        FString AuthoredName(const FProperty* Property)
+        {
+            FString Name = Property->GetName();
+
+            int32 Guid = INDEX_NONE;
+            if (Name.FindLastChar(TEXT('_'), Guid) && Name.Len() - Guid - 1 == 32)
+            {
+                const FString Prefix = Name.Left(Guid);
+                int32 Index = INDEX_NONE;
+                if (Prefix.FindLastChar(TEXT('_'), Index) && Prefix.RightChop(Index + 1).IsNumeric())
+                {
+                    return Prefix.Left(Index);
+                }
+            }
+
+            return Name;
+        }
+
+        const FProperty* FindField(const UScriptStruct* RowStruct, const TCHAR* Name)
+        {
+            for (TFieldIterator<FProperty> It(RowStruct); It; ++It)
+            {
+                if (AuthoredName(*It).Equals(Name, ESearchCase::IgnoreCase))
+                {
+                    return *It;
+                }
+            }
+            return nullptr;
+        }
+
+        double NumericValue(const FNumericProperty* Property, const uint8* Row)
+        {
+            const void* Value = Property->ContainerPtrToValuePtr<void>(Row);
+            return Property->IsFloatingPoint() ? Property->GetFloatingPointPropertyValue(Value) : double(Property->GetSignedIntPropertyValue(Value));
+        }
+    }
+
+
+    void FCatalog::Reset()
+    {
+        Orbits.Reset();
+        Names.Reset();
+        NameOffsets = { 0 };
+        AbsoluteMagnitudes.Reset();
+    }
+
+
+    bool FCatalog::Add(const FSConicElements& Orbit, FStringView Name, float AbsoluteMagnitude, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        if (!Orbits.Add(Orbit, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        Names.Append(Name.GetData(), Name.Len());
+        NameOffsets.Add(Names.Num());
+        AbsoluteMagnitudes.Add(AbsoluteMagnitude);
+        return true;
+    }
+
+
+    void FCatalog::Select(float maxMagnitude, TArray<int32>& Indices) const
+    {
+        Indices.Reset();
+        for (int32 i = 0; i < AbsoluteMagnitudes.Num(); ++i)
+        {
+            if (AbsoluteMagnitudes[i] <= maxMagnitude || !HasAbsoluteMagnitude(i))
+            {
+                Indices.Add(i);
+            }
+        }
+    }
+
+
+    SPICE_API bool LoadMpcorb(
+        const FString& file,
+        FCatalog& Catalog,
+        float maxMagnitude,
+        const FSMassConstant& GM,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*toPath(file)));
+        if (!Reader)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::SmallBodies: couldn't open %s"), *file));
+        }
+
+        int64 Remaining = Reader->TotalSize();
+        TArray<ANSICHAR> Block;
+        int32 Kept = 0;
+
+        auto AddLine = [&](int32 Begin, int32 End)
+        {
+            if (End > Begin && Block[End - 1] == '\r') --End;
+            AddMpcorbLine(Block.GetData() + Begin, End - Begin, maxMagnitude, GM.GM, Catalog);
+        };
+
+        while (Remaining > 0)
+        {
+            const int32 Count = int32(FMath::Min<int64>(Remaining, BlockSize));
+            Block.SetNumUninitialized(Kept + Count);
+            Reader->Serialize(Block.GetData() + Kept, Count);
+            Remaining -= Count;
+
+            if (Reader->IsError())
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::SmallBodies: couldn't read %s"), *file));
+            }
+
+            int32 Begin = 0;
+            for (int32 i = Kept; i < Block.Num(); ++i)
+            {
+                if (Block[i] == '\n')
+                {
+                    AddLine(Begin, i);
+                    Begin = i + 1;
+                }
+            }
+
+            // The last line may not end in a newline
+            Kept = Block.Num() - Begin;
+            if (Remaining == 0 && Kept > 0)
+            {
+                AddLine(Begin, Block.Num());
+            }
+            else if (Begin > 0)
+            {
+                FMemory::Memmove(Block.GetData(), Block.GetData() + Begin, Kept);
+            }
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ImportDataTable(
+        const UDataTable* Table,
+        FCatalog& Catalog,
+        const FSMassConstant& GM,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        if (!Table || !Table->GetRowStruct())
+        {
+            return Failed(ResultCode, ErrorMessage, TEXT("MaxQ::SmallBodies: no data table"));
+        }
+
+        const UScriptStruct* RowStruct = Table->GetRowStruct();
+
+        // e, q, i, om, w, ma, epoch
+        constexpr int32 NumElements = 7;
+        const TCHAR* Required[NumElements] = { TEXT("e"), TEXT("q"), TEXT("i"), TEXT("om"), TEXT("w"), TEXT("ma"), TEXT("epoch") };
+        const FNumericProperty* Elements[NumElements];
+        for (int32 k = 0; k < NumElements; ++k)
+        {
+            Elements[k] = CastField<FNumericProperty>(FindField(RowStruct, Required[k]));
+            if (!Elements[k])
+            {
+                return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::SmallBodies: %s has no numeric field %s"), *Table->GetName(), Required[k]));
+            }
+        }
+
+        const FNumericProperty* Magnitude = CastField<FNumericProperty>(FindField(RowStruct, TEXT("H")));
+        const FProperty* Name = FindField(RowStruct, TEXT("full_name"));
+        const FStrProperty* StrName = CastField<FStrProperty>(Name);
+        const FNameProperty* NameName = CastField<FNameProperty>(Name);
+
+        for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+        {
+            double Values[NumElements];
+            for (int32 k = 0; k < NumElements; ++k)
+            {
+                Values[k] = NumericValue(Elements[k], Row.Value);
+            }
+
+            const FSConicElements Orbit(
+                FSDistance::FromAstronomicalUnits(Values[1]),
+                Values[0],
+                FSAngle::FromDegrees(Values[2]),
+                FSAngle::FromDegrees(Values[3]),
+                FSAngle::FromDegrees(Values[4]),
+                FSAngle::FromDegrees(Values[5]),
+                FSEphemerisTime((Values[6] - J2000) * 86400.),
+                GM
+            );
+
+            FString RowName;
+            if (StrName) RowName = StrName->GetPropertyValue_InContainer(Row.Value).TrimStartAndEnd();
+            else if (NameName) RowName = NameName->GetPropertyValue_InContainer(Row.Value).ToString();
+            else RowName = Row.Key.ToString();
+
+            const float H = Magnitude ? float(NumericValue(Magnitude, Row.Value)) : FCatalog::UnknownMagnitude;
+            Catalog.Add(Orbit, RowName, H);
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+};
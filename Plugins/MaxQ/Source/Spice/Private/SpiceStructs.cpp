@@ -20,6 +20,7 @@
 #include "Containers/StringFwd.h"
 #include "Spice.h"
 #include "SpiceUtilities.h"
+#include "SpiceTime.h"
 
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
@@ -142,6 +143,13 @@ FString FSComplexScalar::ToString() const
 
 FString FSEphemerisTime::ToString() const
 {
+    FString Result;
+    if (MaxQ::Time::EtToUtcString(*this, ES_UTCTimeFormat::Calendar, 4, Result))
+    {
+        Result += TEXT(" UTC");
+        return Result;
+    }
+
     SpiceChar sz[SPICE_MAX_PATH];
     memset(sz, 0, sizeof(sz));
 
@@ -163,6 +171,13 @@ FString FSEphemerisTime::ToString(ES_UTCTimeFormat TimeFormat, int precision /*=
 
 FSEphemerisTime FSEphemerisTime::FromString(const FString& Str)
 {
+    // ISO-8601 strings are parsed natively, anything else goes to str2et_c.
+    FSEphemerisTime Result;
+    if (MaxQ::Time::StrToEt(Str, Result))
+    {
+        return Result;
+    }
+
     double et = 0.;
     str2et_c(TCHAR_TO_ANSI(*Str), &et);
 
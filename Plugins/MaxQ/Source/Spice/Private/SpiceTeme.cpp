@@ -0,0 +1,333 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTeme.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Batched frame changes for SGP4's TEME states
+//
+// TEME to J2000 follows Vallado's teme2eci (Vallado, Crawford, Hujsak &
+// Kelso, "Revisiting Spacetrack Report #3", 2006):
+//   J2000 <- MOD    precession, IAU 1976 (zzeprc76)
+//   MOD   <- TOD    nutation, IAU 1980 (zzenut80)
+//   TOD   <- TEME   about z, by the equation of the equinoxes,
+//                   dpsi cos(mean obliquity), with no kinematic terms
+// CSPICE's private routines give the first two as state transformations
+// from J2000, column-major, and the last is built from zzwahr's nutation
+// angles and zzmobliq's obliquity.  Each is a rotation R with derivative
+// dR, so its inverse is R^T with dR^T.
+//
+// TEME to pseudo Earth-fixed is about z, by GMST, turning at Vallado's
+// constant rate.
+//
+// Transform() multiplies each state by the 6x6 matrix as the sum over k of
+// state[k] * (column k), in two overlapping four-wide accumulators, as in
+// SpiceCovariance.cpp's products.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTeme.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceTeme.h"
+#include "SpiceUtilities.h"
+#include "SpiceTime.h"
+#include "Math/VectorRegister.h"
+
+PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
+extern "C"
+{
+#include "SpiceUsr.h"
+
+// for zzeprc76, zzenut80, zzwahr, zzmobliq
+#include "SpiceZfc.h"
+}
+PRAGMA_POP_PLATFORM_DEFAULT_PACKING
+
+using namespace MaxQ::Private;
+using MaxQ::Covariance::FStateMatrix;
+
+namespace MaxQ::Teme
+{
+    namespace
+    {
+        // States per batch, per worker
+        constexpr int32 BatchSize = 1024;
+
+        constexpr double SecondsPerDay = 86400.;
+
+        // The Earth's rotation rate (rad/s), as Vallado's teme2ecef
+        constexpr double EarthRate = 7.29211514670698e-5;
+
+        // Greenwich mean sidereal time (IAU 1982), radians, from UT1 seconds
+        // past J2000 (not a Julian date, which would round to ~40us)
+        double Gmst(double Ut1)
+        {
+            const double T = Ut1 / (SecondsPerDay * 36525.);
+            const double Seconds = 67310.54841 + (876600. * 3600. + 8640184.812866) * T + 0.093104 * T * T - 6.2e-6 * T * T * T;
+            const double Angle = FMath::Fmod(Seconds, SecondsPerDay) * (2. * UE_DOUBLE_PI / SecondsPerDay);
+            return Angle < 0. ? Angle + 2. * UE_DOUBLE_PI : Angle;
+        }
+
+        // The state transformation of a frame turned by Angle about z,
+        // turning at Rate
+        void AboutZ(double Angle, double Rate, FStateMatrix& Transform)
+        {
+            const double c = FMath::Cos(Angle), s = FMath::Sin(Angle);
+            Transform = FStateMatrix();
+            Transform.m[0][0] = Transform.m[1][1] = Transform.m[3][3] = Transform.m[4][4] = c;
+            Transform.m[0][1] = Transform.m[3][4] = s;
+            Transform.m[1][0] = Transform.m[4][3] = -s;
+            Transform.m[2][2] = Transform.m[5][5] = 1.;
+            Transform.m[3][0] = Transform.m[4][1] = -s * Rate;
+            Transform.m[3][1] = c * Rate;
+            Transform.m[4][0] = -c * Rate;
+        }
+
+        // Fortran's column-major 6x6, row-major
+        void FromColumnMajor(const doublereal(&In)[36], FStateMatrix& Out)
+        {
+            for (int32 i = 0; i < 6; ++i)
+            {
+                for (int32 j = 0; j < 6; ++j)
+                {
+                    Out.m[i][j] = In[j * 6 + i];
+                }
+            }
+        }
+
+        // The inverse of a rotation's state transformation: R^T and dR^T
+        void Invert(const FStateMatrix& In, FStateMatrix& Out)
+        {
+            for (int32 i = 0; i < 3; ++i)
+            {
+                for (int32 j = 0; j < 3; ++j)
+                {
+                    Out.m[i][j] = Out.m[i + 3][j + 3] = In.m[j][i];
+                    Out.m[i + 3][j] = In.m[j + 3][i];
+                    Out.m[i][j + 3] = 0.;
+                }
+            }
+        }
+
+        // Out[i] = xform * In[i], for i in Begin..End, given xform's columns.
+        // Out may be In.
+        FORCEINLINE void TransformRange(const double(&Columns)[6][6], const FSStateVector* In, FSStateVector* Out, int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                double State[6];
+                In[i].CopyTo(State);
+
+                VectorRegister4Double s = VectorSetFloat1(State[0]);
+                VectorRegister4Double Lo = VectorMultiply(s, VectorLoad(&Columns[0][0]));
+                VectorRegister4Double Hi = VectorMultiply(s, VectorLoad(&Columns[0][2]));
+
+                for (int32 k = 1; k < 6; ++k)
+                {
+                    s = VectorSetFloat1(State[k]);
+                    Lo = VectorMultiplyAdd(s, VectorLoad(&Columns[k][0]), Lo);
+                    Hi = VectorMultiplyAdd(s, VectorLoad(&Columns[k][2]), Hi);
+                }
+
+                VectorStore(Hi, &State[2]);
+                VectorStore(Lo, &State[0]);
+                Out[i] = FSStateVector(State);
+            }
+        }
+
+        void Transpose(const FStateMatrix& In, double(&Out)[6][6])
+        {
+            for (int32 i = 0; i < 6; ++i)
+            {
+                for (int32 j = 0; j < 6; ++j)
+                {
+                    Out[j][i] = In.m[i][j];
+                }
+            }
+        }
+    }
+
+
+    SPICE_API void ToJ2000(const FSEphemerisTime& et, FStateMatrix& Transform)
+    {
+        doublereal _et = et.seconds;
+        doublereal _precxf[36], _nutxf[36], _dvnut[4], _mob, _dmob;
+        zzeprc76_(&_et, _precxf);
+        zzenut80_(&_et, _nutxf);
+        zzwahr_(&_et, _dvnut);
+        zzmobliq_(&_et, &_mob, &_dmob);
+
+        // TEME <- TOD <- MOD <- J2000
+        FStateMatrix Precession, Nutation, Equinoxes;
+        FromColumnMajor(_precxf, Precession);
+        FromColumnMajor(_nutxf, Nutation);
+
+        const double Equation = _dvnut[0] * FMath::Cos(_mob);
+        const double EquationRate = _dvnut[2] * FMath::Cos(_mob) - _dvnut[0] * FMath::Sin(_mob) * _dmob;
+        AboutZ(Equation, EquationRate, Equinoxes);
+
+        FStateMatrix FromJ2000;
+        Covariance::Multiply(Nutation, Precession, FromJ2000);
+        Covariance::Multiply(Equinoxes, FromJ2000, FromJ2000);
+        Invert(FromJ2000, Transform);
+    }
+
+
+    SPICE_API bool ToPseudoEarthFixed(
+        const FSEphemerisTime& et,
+        FStateMatrix& Transform,
+        const FSEphemerisPeriod& Ut1MinusUtc,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        FSEphemerisPeriod DeltaUtc;
+        if (!Time::DeltaEt(et.seconds, ES_EpochType::ET, DeltaUtc, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        const double Ut1 = et.seconds - DeltaUtc.seconds + Ut1MinusUtc.seconds;
+        AboutZ(Gmst(Ut1), EarthRate, Transform);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ToFrame(
+        const FSEphemerisTime& et,
+        const FString& frame,
+        FStateMatrix& Transform,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        if (frame.Equals(TEXT("TEME"), ESearchCase::IgnoreCase))
+        {
+            Transform = FStateMatrix::Identity();
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+
+        if (frame.Equals(TEXT("PEF"), ESearchCase::IgnoreCase))
+        {
+            return ToPseudoEarthFixed(et, Transform, FSEphemerisPeriod(), ResultCode, ErrorMessage);
+        }
+
+        FStateMatrix ToJ2000Transform;
+        ToJ2000(et, ToJ2000Transform);
+
+        if (frame.Equals(TEXT("J2000"), ESearchCase::IgnoreCase))
+        {
+            Transform = ToJ2000Transform;
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+
+        SpiceDouble _xform[6][6];
+        sxform_c("J2000", StringCast<ANSICHAR>(*frame).Get(), et.seconds, _xform);
+
+        if (ErrorCheck(ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        Covariance::Multiply(FStateMatrix(_xform), ToJ2000Transform, Transform);
+        return true;
+    }
+
+
+    SPICE_API bool FromFrame(
+        const FSEphemerisTime& et,
+        const FString& frame,
+        FStateMatrix& Transform,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        FStateMatrix ToFrameTransform;
+        if (!ToFrame(et, frame, ToFrameTransform, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        // Every frame here is a rotation of TEME
+        Invert(ToFrameTransform, Transform);
+        return true;
+    }
+
+
+    SPICE_API void Transform(const FStateMatrix& xform, TArrayView<FSStateVector> States)
+    {
+        Transform(xform, States, States);
+    }
+
+
+    SPICE_API void Transform(const FStateMatrix& xform, TConstArrayView<FSStateVector> In, TArrayView<FSStateVector> Out)
+    {
+        check(In.Num() == Out.Num());
+
+        double Columns[6][6];
+        Transpose(xform, Columns);
+
+        ForEachBatch(In.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            TransformRange(Columns, In.GetData(), Out.GetData(), Begin, End);
+        });
+    }
+
+
+    SPICE_API bool Evaluate(
+        const Sgp4::FTleBatch& Satellites,
+        const FSEphemerisTime& et,
+        const FString& frame,
+        TArrayView<FSStateVector> States,
+        TArrayView<Sgp4::EError> Errors,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        check(Errors.Num() == 0 || Errors.Num() == States.Num());
+
+        FStateMatrix xform;
+        if (!ToFrame(et, frame, xform, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        TArray<Sgp4::EError> LocalErrors;
+        if (Errors.Num() == 0)
+        {
+            LocalErrors.SetNum(States.Num());
+            Errors = LocalErrors;
+        }
+
+        const bool bEvaluated = Satellites.Evaluate(et, States, Errors, ResultCode, ErrorMessage);
+
+        double Columns[6][6];
+        Transpose(xform, Columns);
+
+        // Failed satellites' states are left as they were
+        ForEachBatch(States.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            FSStateVector* Data = States.GetData();
+            for (int32 i = Begin; i < End; ++i)
+            {
+                if (Errors[i] == Sgp4::EError::None)
+                {
+                    TransformRange(Columns, Data, Data, i, i + 1);
+                }
+            }
+        });
+
+        return bEvaluated;
+    }
+};
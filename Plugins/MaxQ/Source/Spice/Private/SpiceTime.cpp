@@ -0,0 +1,1128 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTime.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Native time conversions (UTC/TAI/TT/TDB)
+//
+// The math mirrors CSPICE:
+//   TAI <-> TDT          unitim (TDT = TAI + DELTA_T_A)
+//   TDT <-> TDB          unitim (TDB = TDT + K sin E, iterated inverse)
+//   TAI <-> UTC calendar ttrans (TAITAB/DAYTAB leapsecond day tables)
+//   string formats       et2utc (rounding of TAI before the calendar split)
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTime.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceTime.h"
+#include "SpiceUtilities.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/StringBuilder.h"
+
+PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
+extern "C"
+{
+#include "SpiceUsr.h"
+
+// for zzctruin, zzpctrck
+#include "SpiceZfc.h"
+}
+PRAGMA_POP_PLATFORM_DEFAULT_PACKING
+
+using namespace MaxQ::Private;
+
+namespace MaxQ::Time
+{
+    namespace
+    {
+        constexpr double SecondsPerDay = 86400.;
+        constexpr double HalfDay = 43200.;
+        // Days from 1 Jan 1 A.D. to 1 Jan 2000 (proleptic Gregorian)
+        constexpr int32 DayNumberJ2000 = 730119;
+        constexpr double JulianDateJ2000 = 2451545.;
+        // Julian date of 1 Jan 1 A.D. 00:00
+        constexpr double JulianDate0101 = JulianDateJ2000 - DayNumberJ2000 - 0.5;
+        // Conversions per batch, per worker
+        constexpr int32 BatchSize = 4096;
+
+        const ANSICHAR* WatcherAgent = "MAXQ_TIME";
+        const TCHAR* NoLeapSecondsMessage = TEXT("MaxQ::Time: no leapseconds kernel is loaded (DELTET/* variables not found in the kernel pool)");
+
+        // Exact, unlike Pow(10., n)
+        constexpr double PowersOfTen[] = { 1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14 };
+
+        const TCHAR* MonthNames[] = { TEXT("JAN"), TEXT("FEB"), TEXT("MAR"), TEXT("APR"), TEXT("MAY"), TEXT("JUN"), TEXT("JUL"), TEXT("AUG"), TEXT("SEP"), TEXT("OCT"), TEXT("NOV"), TEXT("DEC") };
+        // Days preceding each month, normal and leap years
+        const int32 DaysBeforeMonth[2][13] = {
+            { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+            { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+        };
+
+        struct FLeapSecondTable
+        {
+            double DeltaTA = 0.;
+            double K = 0.;
+            double EB = 0.;
+            double M0 = 0.;
+            double M1 = 0.;
+
+            // Same layout as ttrans:
+            // TaiTable[2i]   : TAI at the start of the UTC day on which DELTA_AT[i] changed
+            // TaiTable[2i+1] : TAI at the start of the following UTC day
+            // DayTable[...]  : the day numbers (days past 1 Jan 1 A.D.) of those days
+            TArray<double> TaiTable;
+            TArray<int32> DayTable;
+
+            // deltet's view of DELTA_AT:
+            // LeapDeltaAt[i] : TAI-UTC from the i'th leapsecond on
+            // LeapUtc[i]     : the formal UTC epoch it took effect
+            // LeapEt[i]      : the same epoch as ET, by deltet's whole-second approximation
+            TArray<double> LeapDeltaAt;
+            TArray<double> LeapUtc;
+            TArray<double> LeapEt;
+        };
+
+        FCriticalSection TableLock;
+        TSharedPtr<const FLeapSecondTable, ESPMode::ThreadSafe> CurrentTable;
+        // Bumped whenever CurrentTable changes, so cached conversions can tell
+        // they're stale.  0 is never a valid table.
+        uint32 CurrentGeneration = 0;
+        bool bWatcherRegistered = false;
+        integer PoolStateCounter[2];
+
+        TSharedPtr<const FLeapSecondTable, ESPMode::ThreadSafe> ReadLeapSecondTable()
+        {
+            auto Table = MakeShared<FLeapSecondTable, ESPMode::ThreadSafe>();
+
+            SpiceInt n = 0;
+            SpiceBoolean found = SPICEFALSE;
+            double m[2];
+
+            bool bFound = true;
+            gdpool_c("DELTET/DELTA_T_A", 0, 1, &n, &Table->DeltaTA, &found); bFound &= (found && n == 1);
+            gdpool_c("DELTET/K", 0, 1, &n, &Table->K, &found); bFound &= (found && n == 1);
+            gdpool_c("DELTET/EB", 0, 1, &n, &Table->EB, &found); bFound &= (found && n == 1);
+            gdpool_c("DELTET/M", 0, 2, &n, m, &found); bFound &= (found && n == 2);
+
+            SpiceChar type = 0;
+            SpiceInt count = 0;
+            dtpool_c("DELTET/DELTA_AT", &found, &count, &type);
+            bFound &= (found && type == 'N' && count >= 2 && count % 2 == 0);
+
+            TArray<double> DeltaAt;
+            if (bFound)
+            {
+                DeltaAt.SetNumUninitialized(count);
+                gdpool_c("DELTET/DELTA_AT", 0, count, &n, DeltaAt.GetData(), &found);
+                bFound &= (found && n == count);
+            }
+
+            if (UnexpectedErrorCheck() || !bFound)
+            {
+                return nullptr;
+            }
+
+            Table->M0 = m[0];
+            Table->M1 = m[1];
+
+            // DELTA_AT is pairs of (TAI-UTC, formal UTC epoch it took effect).
+            // Before the first epoch, ttrans treats TAI-UTC as one less than the first value.
+            const int32 NumRefs = count;
+            Table->TaiTable.SetNumUninitialized(NumRefs);
+            Table->DayTable.SetNumUninitialized(NumRefs);
+
+            double LastDeltaAt = DeltaAt[0] - 1.;
+            for (int32 i = 0; i < NumRefs; i += 2)
+            {
+                const double dt = DeltaAt[i];
+                const double formal = DeltaAt[i + 1];
+                const int32 daynum = (int32)FMath::FloorToDouble((formal + HalfDay) / SecondsPerDay) + DayNumberJ2000;
+
+                Table->TaiTable[i] = formal - SecondsPerDay + LastDeltaAt;
+                Table->TaiTable[i + 1] = formal + dt;
+                Table->DayTable[i] = daynum - 1;
+                Table->DayTable[i + 1] = daynum;
+                LastDeltaAt = dt;
+            }
+
+            const int32 NumLeaps = count / 2;
+            Table->LeapDeltaAt.SetNumUninitialized(NumLeaps);
+            Table->LeapUtc.SetNumUninitialized(NumLeaps);
+            Table->LeapEt.SetNumUninitialized(NumLeaps);
+            for (int32 i = 0; i < NumLeaps; ++i)
+            {
+                const double dt = DeltaAt[2 * i];
+                const double formal = DeltaAt[2 * i + 1];
+                const double aet = FMath::RoundHalfFromZero(formal + Table->DeltaTA + dt);
+                const double ma = Table->M0 + Table->M1 * aet;
+
+                Table->LeapDeltaAt[i] = dt;
+                Table->LeapUtc[i] = formal;
+                Table->LeapEt[i] = formal + Table->DeltaTA + dt + Table->K * FMath::Sin(ma + Table->EB * FMath::Sin(ma));
+            }
+
+            for (int32 i = 1; i < NumRefs; ++i)
+            {
+                if (Table->TaiTable[i - 1] >= Table->TaiTable[i])
+                {
+                    UE_LOG(LogSpice, Error, TEXT("MaxQ::Time: the leapsecond epochs in the kernel pool are not properly ordered"));
+                    return nullptr;
+                }
+            }
+
+            return Table;
+        }
+
+        TSharedPtr<const FLeapSecondTable, ESPMode::ThreadSafe> GetTable(uint32* OutGeneration = nullptr)
+        {
+            // CSPICE isn't thread safe, so only the game thread polls the kernel pool.
+            if (IsInGameThread())
+            {
+                if (!bWatcherRegistered)
+                {
+                    const SpiceInt nnames = 5;
+                    const SpiceInt lenvals = 32;
+                    const SpiceChar names[nnames][lenvals] = { "DELTET/DELTA_T_A", "DELTET/K", "DELTET/EB", "DELTET/M", "DELTET/DELTA_AT" };
+                    swpool_c(WatcherAgent, nnames, lenvals, names);
+                    zzctruin_(PoolStateCounter);
+                    bWatcherRegistered = !UnexpectedErrorCheck();
+                }
+
+                // cvpool_c costs a few hundred ns, which would dominate a conversion.
+                // The pool's state counter is a cheap test for "anything changed at all".
+                logical bPoolChanged = 0;
+                zzpctrck_(PoolStateCounter, &bPoolChanged);
+
+                SpiceBoolean update = SPICEFALSE;
+                if (bPoolChanged)
+                {
+                    cvpool_c(WatcherAgent, &update);
+                }
+
+                if (update)
+                {
+                    auto Table = ReadLeapSecondTable();
+
+                    FScopeLock Lock(&TableLock);
+                    CurrentTable = Table;
+                    ++CurrentGeneration;
+                }
+            }
+
+            FScopeLock Lock(&TableLock);
+            if (OutGeneration) *OutGeneration = CurrentGeneration;
+            return CurrentTable;
+        }
+
+        bool NoTable(ES_ResultCode* pResultCode, FString* pErrorMessage)
+        {
+            return Failed(pResultCode, pErrorMessage, NoLeapSecondsMessage);
+        }
+
+        bool NoScale(ES_ResultCode* pResultCode, FString* pErrorMessage)
+        {
+            return Failed(pResultCode, pErrorMessage, TEXT("MaxQ::Time: a time scale is required (NONE is not a time scale)"));
+        }
+
+        inline bool IsLeapYear(int32 year)
+        {
+            return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        }
+
+        // -------------------------------------------------------------------
+        // unitim
+        inline double TdtToTdb(const FLeapSecondTable& T, double tdt)
+        {
+            const double ma = T.M0 + T.M1 * tdt;
+            return tdt + T.K * FMath::Sin(ma + T.EB * FMath::Sin(ma));
+        }
+
+        inline double TdbToTdt(const FLeapSecondTable& T, double tdb)
+        {
+            // unitim iterates 3 times, but K*M1 is ~1e-9 so each iteration shrinks the
+            // error by ~1e-9.  After 2 the third can't change a double past J2000.
+            double tdt = tdb;
+            for (int32 i = 0; i < 2; ++i)
+            {
+                const double ma = T.M0 + T.M1 * tdt;
+                tdt = tdb - T.K * FMath::Sin(ma + T.EB * FMath::Sin(ma));
+            }
+            return tdt;
+        }
+
+        inline double TdbToTai(const FLeapSecondTable& T, double tdb)
+        {
+            return TdbToTdt(T, tdb) - T.DeltaTA;
+        }
+
+        inline double TaiToTdb(const FLeapSecondTable& T, double tai)
+        {
+            return TdtToTdb(T, tai + T.DeltaTA);
+        }
+
+        inline bool IsTdtScale(ES_TimeScale scale)
+        {
+            return scale == ES_TimeScale::TAI || scale == ES_TimeScale::TDT || scale == ES_TimeScale::JDTDT;
+        }
+
+        inline bool IsJulianDateScale(ES_TimeScale scale)
+        {
+            return scale == ES_TimeScale::JDTDT || scale == ES_TimeScale::JDTDB || scale == ES_TimeScale::JED;
+        }
+
+        // Same steps as unitim: to seconds past J2000 (TDT or TDB), across, and out
+        inline double ConvertScale(const FLeapSecondTable& T, double epoch, ES_TimeScale insys, ES_TimeScale outsys)
+        {
+            if (insys == outsys) return epoch;
+
+            double t = epoch;
+            if (insys == ES_TimeScale::TAI) t += T.DeltaTA;
+            else if (IsJulianDateScale(insys)) t = (t - JulianDateJ2000) * SecondsPerDay;
+
+            const bool bInTdt = IsTdtScale(insys);
+            const bool bOutTdt = IsTdtScale(outsys);
+            if (bInTdt && !bOutTdt) t = TdtToTdb(T, t);
+            else if (!bInTdt && bOutTdt) t = TdbToTdt(T, t);
+
+            if (outsys == ES_TimeScale::TAI) t -= T.DeltaTA;
+            else if (IsJulianDateScale(outsys)) t = t / SecondsPerDay + JulianDateJ2000;
+
+            return t;
+        }
+
+        // -------------------------------------------------------------------
+        // deltet
+        inline double EtMinusUtc(const FLeapSecondTable& T, double epoch, ES_EpochType eptype)
+        {
+            const bool bUtc = (eptype == ES_EpochType::UTC);
+
+            // deltet's test for ET is epoch > the UTC epoch and epoch >= the ET epoch
+            int32 i = Algo::UpperBound(bUtc ? T.LeapUtc : T.LeapEt, epoch) - 1;
+            while (!bUtc && i >= 0 && !(epoch > T.LeapUtc[i])) --i;
+
+            // Before the first leapsecond, TAI-UTC is one less than the first value
+            const double leaps = (i >= 0) ? T.LeapDeltaAt[i] : T.LeapDeltaAt[0] - 1.;
+            const double aet = FMath::RoundHalfFromZero(bUtc ? epoch + T.DeltaTA + leaps : epoch);
+
+            const double ma = T.M0 + T.M1 * aet;
+            return T.DeltaTA + leaps + T.K * FMath::Sin(ma + T.EB * FMath::Sin(ma));
+        }
+
+        // -------------------------------------------------------------------
+        // ttrans
+        // TAI -> day number (days past 1 Jan 1 A.D.) and seconds into that UTC
+        // day.  Seconds run past 86400 in a day with a positive leapsecond.
+        inline void TaiToDaySeconds(const FLeapSecondTable& T, double tai, int32& daynum, double& secs)
+        {
+            const int32 taiptr = Algo::UpperBound(T.TaiTable, tai) - 1;
+
+            if (taiptr >= 0 && (taiptr % 2) == 0)
+            {
+                // A day in which TAI-UTC changed
+                daynum = T.DayTable[taiptr];
+                secs = tai - T.TaiTable[taiptr];
+            }
+            else
+            {
+                // All other days are SecondsPerDay long
+                const int32 ptr = FMath::Max(taiptr, 0);
+                const double elapsed = tai - T.TaiTable[ptr];
+                double days = FMath::TruncToDouble(elapsed / SecondsPerDay);
+                secs = elapsed - days * SecondsPerDay;
+                if (secs < 0.)
+                {
+                    days -= 1.;
+                    secs += SecondsPerDay;
+                }
+                daynum = T.DayTable[ptr] + (int32)days;
+            }
+        }
+
+        inline double DaySecondsToTai(const FLeapSecondTable& T, int32 daynum, double secs)
+        {
+            const int32 dayptr = FMath::Max(Algo::UpperBound(T.DayTable, daynum) - 1, 0);
+            secs += (double)(daynum - T.DayTable[dayptr]) * SecondsPerDay;
+            return T.TaiTable[dayptr] + secs;
+        }
+
+        inline int32 DayNumber(int32 year, int32 dayOfYear)
+        {
+            const int32 y = year - 1;
+            return y * 365 + y / 4 - y / 100 + y / 400 + dayOfYear - 1;
+        }
+
+        inline void DayNumberToCalendar(int32 daynum, FUtcCalendar& utc)
+        {
+            int32 yr400 = daynum / 146097;
+            int32 rem = daynum - yr400 * 146097;
+            if (rem < 0)
+            {
+                --yr400;
+                rem += 146097;
+            }
+            const int32 yr100 = FMath::Min(3, rem / 36524);
+            rem -= yr100 * 36524;
+            const int32 yr4 = FMath::Min(24, rem / 1461);
+            rem -= yr4 * 1461;
+            const int32 yr1 = FMath::Min(3, rem / 365);
+            rem -= yr1 * 365;
+
+            utc.Year = yr400 * 400 + yr100 * 100 + yr4 * 4 + yr1 + 1;
+            utc.DayOfYear = rem + 1;
+
+            const int32* before = DaysBeforeMonth[IsLeapYear(utc.Year) ? 1 : 0];
+            int32 month = 1;
+            while (month < 12 && before[month] < utc.DayOfYear)
+            {
+                ++month;
+            }
+            utc.Month = month;
+            utc.Day = utc.DayOfYear - before[month - 1];
+        }
+
+        inline void SecondsToTimeOfDay(double secs, FUtcCalendar& utc)
+        {
+            // Anything past 86399 stays in the last minute (leapseconds)
+            const double exsecs = FMath::Max(0., secs - SecondsPerDay + 1.);
+            double tsecs = secs - exsecs;
+            const double hours = FMath::TruncToDouble(tsecs / 3600.);
+            tsecs -= hours * 3600.;
+            const double mins = FMath::TruncToDouble(tsecs / 60.);
+            tsecs -= mins * 60.;
+
+            utc.Hour = (int32)hours;
+            utc.Minute = (int32)mins;
+            utc.Second = tsecs + exsecs;
+        }
+
+        inline void TaiToCalendar(const FLeapSecondTable& T, double tai, FUtcCalendar& utc)
+        {
+            int32 daynum;
+            double secs;
+            TaiToDaySeconds(T, tai, daynum, secs);
+            DayNumberToCalendar(daynum, utc);
+            SecondsToTimeOfDay(secs, utc);
+        }
+
+        inline double CalendarToTai(const FLeapSecondTable& T, const FUtcCalendar& utc)
+        {
+            const int32 month = FMath::Clamp(utc.Month, 1, 12);
+            const int32 dayOfYear = DaysBeforeMonth[IsLeapYear(utc.Year) ? 1 : 0][month - 1] + utc.Day;
+            const double secs = (double)utc.Hour * 3600. + (double)utc.Minute * 60. + utc.Second;
+            return DaySecondsToTai(T, DayNumber(utc.Year, dayOfYear), secs);
+        }
+
+        // -------------------------------------------------------------------
+        // parsing
+        struct FCursor
+        {
+            const TCHAR* p;
+            const TCHAR* end;
+
+            bool AtEnd() const { return p >= end; }
+            TCHAR Peek() const { return p < end ? *p : TCHAR(0); }
+
+            bool Digits(int32 count, int32& value)
+            {
+                if (end - p < count) return false;
+                value = 0;
+                for (int32 i = 0; i < count; ++i)
+                {
+                    const TCHAR c = p[i];
+                    if (c < '0' || c > '9') return false;
+                    value = value * 10 + (c - '0');
+                }
+                p += count;
+                return true;
+            }
+
+            int32 CountDigits() const
+            {
+                const TCHAR* q = p;
+                while (q < end && *q >= '0' && *q <= '9') ++q;
+                return (int32)(q - p);
+            }
+
+            bool Accept(TCHAR c)
+            {
+                if (p < end && *p == c)
+                {
+                    ++p;
+                    return true;
+                }
+                return false;
+            }
+
+            bool AcceptNoCase(const TCHAR* word)
+            {
+                const TCHAR* q = p;
+                for (; *word; ++word, ++q)
+                {
+                    if (q >= end || FChar::ToUpper(*q) != *word) return false;
+                }
+                p = q;
+                return true;
+            }
+
+            void SkipWhitespace()
+            {
+                while (p < end && FChar::IsWhitespace(*p)) ++p;
+            }
+        };
+
+        // -------------------------------------------------------------------
+        // formatting
+        void AppendDigits(FStringBuilderBase& str, int64 value, int32 width)
+        {
+            TCHAR buffer[24];
+            int32 i = UE_ARRAY_COUNT(buffer);
+            do
+            {
+                buffer[--i] = TCHAR('0' + (value % 10));
+                value /= 10;
+                --width;
+            } while (value > 0 || width > 0);
+            str.Append(buffer + i, UE_ARRAY_COUNT(buffer) - i);
+        }
+
+        // Overwrites exactly width digits in place
+        inline void WriteDigits(TCHAR* str, int64 value, int32 width)
+        {
+            for (int32 i = width - 1; i >= 0; --i)
+            {
+                str[i] = TCHAR('0' + (value % 10));
+                value /= 10;
+            }
+        }
+
+        // et2utc gives sigdig significant digits (at most 14) and always shows
+        // the decimal point.  (The last digit may differ from et2utc at times;
+        // dpstrf's digit generation isn't exactly rounded.)
+        void AppendJulianDate(FStringBuilderBase& str, double jd, int32 sigdig)
+        {
+            const int32 intDigits = FMath::Max(1, (int32)FMath::FloorToDouble(FMath::LogX(10., FMath::Abs(jd))) + 1);
+            const int32 decimals = FMath::Max(0, FMath::Min(sigdig, 14) - intDigits);
+            str.Appendf(TEXT("%.*f"), decimals, jd);
+            if (decimals == 0)
+            {
+                str.AppendChar('.');
+            }
+        }
+
+        // Round TAI to the requested precision before the calendar split,
+        // so rounding carries into minutes, days, etc. exactly as et2utc does.
+        inline void RoundTai(double tai, int32 precision, double& whlsec, int64& frcsec)
+        {
+            whlsec = FMath::FloorToDouble(tai);
+            const double scale = PowersOfTen[precision];
+            double fraction = FMath::RoundHalfFromZero(scale * (tai - whlsec));
+            if (fraction == scale)
+            {
+                whlsec += 1.;
+                fraction = 0.;
+            }
+            frcsec = (int64)fraction;
+        }
+
+        // Where the time of day landed in a formatted string, and the TAI range
+        // of the UTC day it shows, so the string can be patched in place.
+        struct FUtcLayout
+        {
+            double DayStartTai = 0.;
+            double DayEndTai = 0.;
+            int32 TimeOffset = INDEX_NONE;
+            int32 Hour = 0;
+            int32 Minute = 0;
+            int32 Second = 0;
+            int64 Fraction = 0;
+        };
+
+        bool FormatUtc(const FLeapSecondTable& T, double et, ES_UTCTimeFormat format, int32 precision, FStringBuilderBase& utcstr, FString& ErrorMessage, FUtcLayout* Layout = nullptr)
+        {
+            const int32 myprec = FMath::Clamp(precision, 0, 14);
+
+            if (format == ES_UTCTimeFormat::JulianDate)
+            {
+                // JDUTC is a formal system; the clock stands still during a leapsecond.
+                int32 daynum;
+                double secs;
+                TaiToDaySeconds(T, TdbToTai(T, et), daynum, secs);
+                if (secs > SecondsPerDay)
+                {
+                    ++daynum;
+                    secs = 0.;
+                }
+                const double jd = JulianDate0101 + (double)daynum + secs / SecondsPerDay;
+
+                utcstr += TEXT("JD ");
+                AppendJulianDate(utcstr, jd, myprec + 7);
+                return true;
+            }
+
+            double whlsec;
+            int64 frcsec;
+            RoundTai(TdbToTai(T, et), myprec, whlsec, frcsec);
+
+            int32 daynum;
+            double secs;
+            TaiToDaySeconds(T, whlsec, daynum, secs);
+
+            FUtcCalendar utc;
+            DayNumberToCalendar(daynum, utc);
+            SecondsToTimeOfDay(secs, utc);
+            int32 second = FMath::RoundToInt(utc.Second);
+
+            const bool bDayOfYear = (format == ES_UTCTimeFormat::DayOfYear || format == ES_UTCTimeFormat::ISODayOfYear);
+            const bool bIso = (format == ES_UTCTimeFormat::ISOCalendar || format == ES_UTCTimeFormat::ISODayOfYear);
+
+            // Era labels for years before 1000 A.D., as et2utc
+            bool bEra = false;
+            if (utc.Year >= 1000)
+            {
+                AppendDigits(utcstr, utc.Year, 1);
+            }
+            else if (utc.Year > 0)
+            {
+                AppendDigits(utcstr, utc.Year, 1);
+                if (!bIso)
+                {
+                    utcstr += TEXT(" A.D.");
+                    bEra = true;
+                }
+            }
+            else
+            {
+                if (bIso)
+                {
+                    ErrorMessage = FString::Printf(TEXT("The year of the ET epoch supplied is %d B.C.  Years in this era are not supported in ISO format."), -utc.Year + 1);
+                    return false;
+                }
+                AppendDigits(utcstr, -utc.Year + 1, 1);
+                utcstr += TEXT(" B.C.");
+                bEra = true;
+            }
+
+            if (!bDayOfYear)
+            {
+                if (!bIso)
+                {
+                    utcstr.AppendChar(' ');
+                    utcstr += MonthNames[utc.Month - 1];
+                    utcstr.AppendChar(' ');
+                }
+                else
+                {
+                    utcstr.AppendChar('-');
+                    AppendDigits(utcstr, utc.Month, 2);
+                    utcstr.AppendChar('-');
+                }
+                AppendDigits(utcstr, utc.Day, 2);
+            }
+            else
+            {
+                utcstr.AppendChar(bEra ? ' ' : '-');
+                AppendDigits(utcstr, utc.DayOfYear, 3);
+            }
+
+            utcstr += bIso ? TEXT("T") : (bDayOfYear ? TEXT(" // ") : TEXT(" "));
+            const int32 TimeOffset = utcstr.Len();
+            AppendDigits(utcstr, utc.Hour, 2);
+            utcstr.AppendChar(':');
+            AppendDigits(utcstr, utc.Minute, 2);
+            utcstr.AppendChar(':');
+            AppendDigits(utcstr, second, 2);
+
+            if (myprec > 0)
+            {
+                utcstr.AppendChar('.');
+                AppendDigits(utcstr, frcsec, myprec);
+            }
+
+            if (Layout)
+            {
+                Layout->DayStartTai = DaySecondsToTai(T, daynum, 0.);
+                Layout->DayEndTai = DaySecondsToTai(T, daynum + 1, 0.);
+                Layout->TimeOffset = TimeOffset;
+                Layout->Hour = utc.Hour;
+                Layout->Minute = utc.Minute;
+                Layout->Second = second;
+                Layout->Fraction = frcsec;
+            }
+
+            return true;
+        }
+    }
+
+    SPICE_API bool HasLeapSeconds()
+    {
+        return GetTable().IsValid();
+    }
+
+    SPICE_API bool EtToTai(const FSEphemerisTime& et, double& tai, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        tai = TdbToTai(*Table, et.seconds);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TaiToEt(double tai, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        et = FSEphemerisTime(TaiToTdb(*Table, tai));
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToTt(const FSEphemerisTime& et, double& tt, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        tt = TdbToTdt(*Table, et.seconds);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TtToEt(double tt, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        et = FSEphemerisTime(TdtToTdb(*Table, tt));
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToUtc(const FSEphemerisTime& et, FUtcCalendar& utc, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        TaiToCalendar(*Table, TdbToTai(*Table, et.seconds), utc);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool UtcToEt(const FUtcCalendar& utc, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        et = FSEphemerisTime(TaiToTdb(*Table, CalendarToTai(*Table, utc)));
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool ConvertTimeScale(double epoch, ES_TimeScale insys, ES_TimeScale outsys, double& out, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        if (insys == ES_TimeScale::NONE || outsys == ES_TimeScale::NONE) return NoScale(ResultCode, ErrorMessage);
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        out = ConvertScale(*Table, epoch, insys, outsys);
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool DeltaEt(double epoch, ES_EpochType eptype, FSEphemerisPeriod& delta, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        delta = FSEphemerisPeriod(EtMinusUtc(*Table, epoch, eptype));
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToTai(TConstArrayView<FSEphemerisTime> et, TArrayView<double> tai, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == tai.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(et.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) tai[i] = TdbToTai(T, et[i].seconds);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TaiToEt(TConstArrayView<double> tai, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == tai.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(tai.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) et[i].seconds = TaiToTdb(T, tai[i]);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToTt(TConstArrayView<FSEphemerisTime> et, TArrayView<double> tt, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == tt.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(et.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) tt[i] = TdbToTdt(T, et[i].seconds);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool TtToEt(TConstArrayView<double> tt, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == tt.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(tt.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) et[i].seconds = TdtToTdb(T, tt[i]);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToUtc(TConstArrayView<FSEphemerisTime> et, TArrayView<FUtcCalendar> utc, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == utc.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(et.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) TaiToCalendar(T, TdbToTai(T, et[i].seconds), utc[i]);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool UtcToEt(TConstArrayView<FUtcCalendar> utc, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(et.Num() == utc.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(utc.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) et[i].seconds = TaiToTdb(T, CalendarToTai(T, utc[i]));
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool ConvertTimeScale(TConstArrayView<double> epoch, ES_TimeScale insys, ES_TimeScale outsys, TArrayView<double> out, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(epoch.Num() == out.Num());
+        if (insys == ES_TimeScale::NONE || outsys == ES_TimeScale::NONE) return NoScale(ResultCode, ErrorMessage);
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(epoch.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) out[i] = ConvertScale(T, epoch[i], insys, outsys);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool DeltaEt(TConstArrayView<double> epoch, ES_EpochType eptype, TArrayView<FSEphemerisPeriod> delta, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(epoch.Num() == delta.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        ForEachBatch(epoch.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i) delta[i].seconds = EtMinusUtc(T, epoch[i], eptype);
+        });
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool ParseUtc(FStringView str, FUtcCalendar& utc)
+    {
+        FCursor c { str.GetData(), str.GetData() + str.Len() };
+        c.SkipWhitespace();
+
+        FUtcCalendar result;
+        result.Hour = 0;
+
+        if (!c.Digits(4, result.Year) || !c.Accept('-')) return false;
+        if (result.Year < 1583) return false;
+
+        const int32* before = DaysBeforeMonth[IsLeapYear(result.Year) ? 1 : 0];
+        const int32 nDigits = c.CountDigits();
+
+        if (nDigits == 3)
+        {
+            // YYYY-DDD
+            if (!c.Digits(3, result.DayOfYear)) return false;
+            if (result.DayOfYear < 1 || result.DayOfYear > before[12]) return false;
+
+            int32 month = 1;
+            while (month < 12 && before[month] < result.DayOfYear) ++month;
+            result.Month = month;
+            result.Day = result.DayOfYear - before[month - 1];
+        }
+        else if (nDigits == 2)
+        {
+            // YYYY-MM-DD
+            if (!c.Digits(2, result.Month) || !c.Accept('-') || !c.Digits(2, result.Day)) return false;
+            if (result.Month < 1 || result.Month > 12) return false;
+            if (result.Day < 1 || result.Day > before[result.Month] - before[result.Month - 1]) return false;
+            result.DayOfYear = before[result.Month - 1] + result.Day;
+        }
+        else
+        {
+            return false;
+        }
+
+        // Optional time of day, 'T' or whitespace separated
+        const TCHAR* mark = c.p;
+        bool bTime = c.Accept('T');
+        if (!bTime)
+        {
+            c.SkipWhitespace();
+            bTime = c.CountDigits() == 2;
+            if (!bTime) c.p = mark;
+        }
+
+        if (bTime)
+        {
+            if (!c.Digits(2, result.Hour) || !c.Accept(':') || !c.Digits(2, result.Minute)) return false;
+
+            int32 whole = 0;
+            if (c.Accept(':'))
+            {
+                if (!c.Digits(2, whole)) return false;
+            }
+
+            double fraction = 0.;
+            if (c.Accept('.'))
+            {
+                const int32 nFraction = c.CountDigits();
+                if (nFraction == 0) return false;
+
+                // Keep 15 significant digits, ignore the rest
+                int64 mantissa = 0;
+                int32 nKept = FMath::Min(nFraction, 15);
+                for (int32 i = 0; i < nKept; ++i) mantissa = mantissa * 10 + (c.p[i] - '0');
+                c.p += nFraction;
+                fraction = (double)mantissa / FMath::Pow(10., (double)nKept);
+            }
+
+            const bool bLastMinute = (result.Hour == 23 && result.Minute == 59);
+            if (result.Hour > 23 || result.Minute > 59 || whole > (bLastMinute ? 60 : 59)) return false;
+
+            result.Second = (double)whole + fraction;
+        }
+
+        // Optional zone designator
+        if (!c.Accept('Z'))
+        {
+            c.SkipWhitespace();
+            c.AcceptNoCase(TEXT("UTC"));
+        }
+        c.SkipWhitespace();
+
+        if (!c.AtEnd()) return false;
+
+        utc = result;
+        return true;
+    }
+
+    SPICE_API bool StrToEt(FStringView str, FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        FUtcCalendar utc;
+        if (!ParseUtc(str, utc))
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Time: '%s' is not an ISO-8601 UTC time string"), *FString(str)));
+        }
+
+        return UtcToEt(utc, et, ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool StrToEt(TConstArrayView<FString> strs, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        check(strs.Num() == et.Num());
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        const FLeapSecondTable& T = *Table;
+        FCriticalSection FailureLock;
+        int32 FirstFailure = INDEX_NONE;
+
+        ForEachBatch(strs.Num(), BatchSize, [&](int32 Begin, int32 End)
+        {
+            for (int32 i = Begin; i < End; ++i)
+            {
+                FUtcCalendar utc;
+                if (ParseUtc(strs[i], utc))
+                {
+                    et[i].seconds = TaiToTdb(T, CalendarToTai(T, utc));
+                }
+                else
+                {
+                    FScopeLock Lock(&FailureLock);
+                    FirstFailure = (FirstFailure == INDEX_NONE) ? i : FMath::Min(FirstFailure, i);
+                }
+            }
+        });
+
+        if (FirstFailure != INDEX_NONE)
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Time: '%s' (index %d) is not an ISO-8601 UTC time string"), *strs[FirstFailure], FirstFailure));
+        }
+
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    SPICE_API bool EtToUtcString(const FSEphemerisTime& et, ES_UTCTimeFormat format, int precision, FString& utcstr, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const auto Table = GetTable();
+        if (!Table) return NoTable(ResultCode, ErrorMessage);
+
+        TStringBuilder<64> Builder;
+        FString Message;
+        if (!FormatUtc(*Table, et.seconds, format, precision, Builder, Message))
+        {
+            return Failed(ResultCode, ErrorMessage, Message);
+        }
+
+        utcstr = Builder.ToString();
+        return Succeeded(ResultCode, ErrorMessage);
+    }
+
+    FUtcFormatter::FUtcFormatter(ES_UTCTimeFormat InFormat, int InPrecision)
+    {
+        SetFormat(InFormat, InPrecision);
+    }
+
+    void FUtcFormatter::SetFormat(ES_UTCTimeFormat InFormat, int InPrecision)
+    {
+        Format = InFormat;
+        Precision = FMath::Clamp(InPrecision, 0, 14);
+        Invalidate();
+    }
+
+    void FUtcFormatter::Invalidate()
+    {
+        // An empty day range never matches, so the next Update formats from scratch
+        TableGeneration = 0;
+        LastEt = 0.;
+        DayStartTai = DayEndTai = 0.;
+        TimeOffset = INDEX_NONE;
+        Length = 0;
+        Buffer[0] = TCHAR(0);
+    }
+
+    const TCHAR* FUtcFormatter::Update(const FSEphemerisTime& et, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        uint32 Generation = 0;
+        const auto Table = GetTable(&Generation);
+        if (!Table)
+        {
+            Invalidate();
+            NoTable(ResultCode, ErrorMessage);
+            return Buffer;
+        }
+
+        const FLeapSecondTable& T = *Table;
+
+        if (Generation == TableGeneration && et.seconds == LastEt)
+        {
+            // Paused clock
+            Succeeded(ResultCode, ErrorMessage);
+            return Buffer;
+        }
+
+        if (Generation == TableGeneration && TimeOffset != INDEX_NONE)
+        {
+            LastEt = et.seconds;
+
+            double whlsec;
+            int64 frcsec;
+            RoundTai(TdbToTai(T, et.seconds), Precision, whlsec, frcsec);
+
+            if (whlsec >= DayStartTai && whlsec < DayEndTai)
+            {
+                // Same UTC day, the date is already in the buffer.
+                FUtcCalendar utc;
+                SecondsToTimeOfDay(whlsec - DayStartTai, utc);
+                const int32 second = FMath::RoundToInt(utc.Second);
+
+                TCHAR* Time = Buffer + TimeOffset;
+                if (utc.Hour != Hour)
+                {
+                    WriteDigits(Time, utc.Hour, 2);
+                    Hour = utc.Hour;
+                }
+                if (utc.Minute != Minute)
+                {
+                    WriteDigits(Time + 3, utc.Minute, 2);
+                    Minute = utc.Minute;
+                }
+                if (second != Second)
+                {
+                    WriteDigits(Time + 6, second, 2);
+                    Second = second;
+                }
+                if (frcsec != Fraction && Precision > 0)
+                {
+                    WriteDigits(Time + 9, frcsec, Precision);
+                    Fraction = frcsec;
+                }
+
+                Succeeded(ResultCode, ErrorMessage);
+                return Buffer;
+            }
+        }
+
+        // New day (or first call, or a new leapseconds kernel): format it all.
+        TStringBuilder<UE_ARRAY_COUNT(Buffer)> Builder;
+        FString Message;
+        FUtcLayout Layout;
+        if (!FormatUtc(T, et.seconds, Format, Precision, Builder, Message, &Layout) || Builder.Len() >= UE_ARRAY_COUNT(Buffer))
+        {
+            Invalidate();
+            Failed(ResultCode, ErrorMessage, Message.IsEmpty() ? FString(TEXT("MaxQ::Time: the formatted UTC string is too long")) : Message);
+            return Buffer;
+        }
+
+        Length = Builder.Len();
+        FMemory::Memcpy(Buffer, Builder.GetData(), Length * sizeof(TCHAR));
+        Buffer[Length] = TCHAR(0);
+
+        TableGeneration = Generation;
+        LastEt = et.seconds;
+        DayStartTai = Layout.DayStartTai;
+        DayEndTai = Layout.DayEndTai;
+        TimeOffset = Layout.TimeOffset;
+        Hour = Layout.Hour;
+        Minute = Layout.Minute;
+        Second = Layout.Second;
+        Fraction = Layout.Fraction;
+
+        Succeeded(ResultCode, ErrorMessage);
+        return Buffer;
+    }
+};
@@ -0,0 +1,793 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com | https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTleCatalog.cpp
+//
+// Implementation Comments
+//
+// Purpose:  Satellite catalogs (TLEs, OMMs) as SGP4 batches
+//
+// Parsing is three passes over the text:
+// 1. (Serial) split the text into lines, and the lines into records: a
+//    TLE's line pair and its name line, or a CSV row.  This only looks at
+//    each line's first character.
+// 2. (Parallel) parse each record's fields, in place as ANSI text, into
+//    getelm's elements and a UTC calendar epoch.
+// 3. (Parallel, in MaxQ::Time::UtcToEt) convert the epochs to ET.
+//
+// TLE columns, from Space-Track's format description (1-based, inclusive),
+// and as read by zzgetelm:
+//   Line 1: 3-7 catalog number, 19-20 year, 21-32 day of year,
+//           34-43 ndot/2, 45-52 nddot/6 and 54-61 bstar (both with an
+//           implied leading decimal point and a power of ten), 69 checksum
+//   Line 2: 3-7 catalog number, 9-16 i, 18-25 node, 27-33 e (implied
+//           leading decimal point), 35-42 peri, 44-51 M, 53-63 n,
+//           69 checksum
+// Checksums are the sum of a line's digits, plus one per '-', mod 10.
+// Catalog numbers past 99999 are "Alpha-5": a letter (skipping I and O)
+// for the ten thousands, A = 10.
+//
+// The cache is the parsed records, before the batch sees them: a header
+// (with the source's size and CityHash64), the elements, catalog numbers,
+// name offsets, then the names, each as a flat array, so that reading it
+// back is a few copies.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTleCatalog.cpp is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#include "SpiceTleCatalog.h"
+#include "SpiceUtilities.h"
+#include "SpiceTime.h"
+#include "SpiceLog.h"
+#include "Algo/Count.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <cstdlib>
+
+using namespace MaxQ::Private;
+using MaxQ::Sgp4::FTleBatch;
+using MaxQ::Time::FUtcCalendar;
+
+namespace MaxQ::Tle
+{
+    namespace
+    {
+        // Records per batch, per worker
+        constexpr int32 BatchSize = 512;
+
+        constexpr int32 NumElements = FTleBatch::NumElements;
+        constexpr int32 TleLineLength = 69;
+
+        // Two-digit years are 1957 (Sputnik) through 2056, as getelm's FRSTYR
+        constexpr int32 FirstYear = 1957;
+
+        constexpr double TwoPi = 2. * UE_DOUBLE_PI;
+        constexpr double MinutesPerDay = 1440.;
+
+        constexpr uint32 CacheMagic = 0x4354514D; // "MQTC"
+        constexpr uint32 CacheVersion = 1;
+
+        struct FCacheHeader
+        {
+            uint32 Magic;
+            uint32 Version;
+            uint64 SourceHash;
+            int64 SourceSize;
+            int32 Count;
+            int32 NameLength;
+        };
+
+        // A record, as found in pass 1, then parsed in pass 2
+        struct FRecord
+        {
+            FAnsiStringView Name;
+            FAnsiStringView Lines[2];
+            int32 CatalogNumber;
+            double Elements[NumElements];
+            FUtcCalendar Epoch;
+            bool bValid;
+        };
+
+        // Parsed records, ready for the catalog (or the cache)
+        struct FParsed
+        {
+            TArray<double> Elements;
+            TArray<int32> CatalogNumbers;
+            TArray<ANSICHAR> Names;
+            TArray<int32> NameOffsets = { 0 };
+
+            // Each record's text, if asked for (never cached)
+            TArray<FAnsiStringView> Sources;
+        };
+
+        // Columns First through Last (1-based, inclusive), trimmed
+        FAnsiStringView Field(FAnsiStringView Line, int32 First, int32 Last)
+        {
+            int32 Begin = First - 1;
+            int32 End = FMath::Min(Last, Line.Len());
+            while (Begin < End && Line[Begin] == ' ') ++Begin;
+            while (End > Begin && Line[End - 1] == ' ') --End;
+            return FAnsiStringView(Line.GetData() + FMath::Min(Begin, End), FMath::Max(End - Begin, 0));
+        }
+
+        FAnsiStringView Trim(FAnsiStringView Text)
+        {
+            return Field(Text, 1, Text.Len());
+        }
+
+        bool Number(FAnsiStringView Text, double& Value)
+        {
+            ANSICHAR Buffer[32];
+            if (Text.Len() == 0 || Text.Len() >= int32(UE_ARRAY_COUNT(Buffer)))
+            {
+                return false;
+            }
+
+            FMemory::Memcpy(Buffer, Text.GetData(), Text.Len());
+            Buffer[Text.Len()] = 0;
+
+            ANSICHAR* End = nullptr;
+            Value = std::strtod(Buffer, &End);
+            return End == Buffer + Text.Len();
+        }
+
+        bool Integer(FAnsiStringView Text, int32& Value)
+        {
+            double d;
+            if (!Number(Text, d) || d != FMath::FloorToDouble(d) || FMath::Abs(d) > double(MAX_int32))
+            {
+                return false;
+            }
+            Value = int32(d);
+            return true;
+        }
+
+        // "-12345-4" is -0.12345e-4: a sign, five digits after an implied
+        // decimal point, and a signed power of ten
+        bool ImpliedDecimal(FAnsiStringView Line, int32 First, double& Value)
+        {
+            const ANSICHAR* f = Line.GetData() + First - 1;
+            ANSICHAR Buffer[] = { '+', '0', '.', '0', '0', '0', '0', '0', 'e', '+', '0', 0 };
+
+            if (f[0] == '-') Buffer[0] = '-';
+            else if (f[0] != ' ' && f[0] != '+') return false;
+
+            for (int32 k = 0; k < 5; ++k)
+            {
+                if (f[1 + k] >= '0' && f[1 + k] <= '9') Buffer[3 + k] = f[1 + k];
+                else if (f[1 + k] != ' ') return false;
+            }
+
+            if (f[6] == '-') Buffer[9] = '-';
+            else if (f[6] != ' ' && f[6] != '+') return false;
+            if (f[7] < '0' || f[7] > '9') return false;
+            Buffer[10] = f[7];
+
+            Value = std::strtod(Buffer, nullptr);
+            return true;
+        }
+
+        bool Checksum(FAnsiStringView Line)
+        {
+            int32 Sum = 0;
+            for (int32 c = 0; c < TleLineLength - 1; ++c)
+            {
+                if (Line[c] >= '0' && Line[c] <= '9') Sum += Line[c] - '0';
+                else if (Line[c] == '-') Sum += 1;
+            }
+            return Line[TleLineLength - 1] - '0' == Sum % 10;
+        }
+
+        // Columns 3-7, with Alpha-5 numbers past 99999
+        bool CatalogNumber(FAnsiStringView Line, int32& Number)
+        {
+            const ANSICHAR Lead = Line[2];
+            int32 TenThousands;
+            if (Lead >= '0' && Lead <= '9') TenThousands = Lead - '0';
+            else if (Lead == ' ') TenThousands = 0;
+            else if (Lead >= 'A' && Lead <= 'Z' && Lead != 'I' && Lead != 'O') TenThousands = 10 + (Lead - 'A') - (Lead > 'I') - (Lead > 'O');
+            else return false;
+
+            int32 Rest;
+            if (!Integer(Field(Line, 4, 7), Rest) || Rest < 0)
+            {
+                return false;
+            }
+
+            Number = TenThousands * 10000 + Rest;
+            return true;
+        }
+
+        bool IsLeapYear(int32 Year)
+        {
+            return (Year % 4 == 0 && Year % 100 != 0) || Year % 400 == 0;
+        }
+
+        // A year and fractional day of year (1.0 = Jan 1, 0h) as calendar fields
+        bool DayOfYearToCalendar(int32 Year, double Day, FUtcCalendar& Utc)
+        {
+            static const int32 MonthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+            const int32 WholeDay = FMath::FloorToInt32(Day);
+            const int32 DaysInYear = IsLeapYear(Year) ? 366 : 365;
+            if (WholeDay < 1 || WholeDay > DaysInYear)
+            {
+                return false;
+            }
+
+            Utc.Year = Year;
+            Utc.DayOfYear = WholeDay;
+            Utc.Month = 1;
+            Utc.Day = WholeDay;
+            for (int32 m = 0; m < 12; ++m)
+            {
+                const int32 Length = MonthDays[m] + (m == 1 && DaysInYear == 366);
+                if (Utc.Day <= Length) break;
+                Utc.Day -= Length;
+                ++Utc.Month;
+            }
+
+            const double Seconds = (Day - WholeDay) * 86400.;
+            Utc.Hour = FMath::Min(int32(Seconds / 3600.), 23);
+            Utc.Minute = FMath::Min(int32((Seconds - Utc.Hour * 3600.) / 60.), 59);
+            Utc.Second = Seconds - Utc.Hour * 3600. - Utc.Minute * 60.;
+            return true;
+        }
+
+        // Degrees, revolutions/day^n, as getelm's units (radians, radians/minute^n)
+        bool Convert(double ndt20, double ndd60, double bstar, double incl, double node, double ecc, double omega, double mo, double no, double (&e)[NumElements])
+        {
+            if (incl < 0. || incl > 180. || node < 0. || node >= 360. || omega < 0. || omega >= 360. || mo < 0. || mo >= 360.
+                || ecc < 0. || ecc >= 1. || no <= 0. || no > 20.)
+            {
+                return false;
+            }
+
+            e[FSTwoLineElements::XNDT2O] = ndt20 * TwoPi / (MinutesPerDay * MinutesPerDay);
+            e[FSTwoLineElements::XNDD6O] = ndd60 * TwoPi / (MinutesPerDay * MinutesPerDay * MinutesPerDay);
+            e[FSTwoLineElements::BSTAR] = bstar;
+            e[FSTwoLineElements::XINCL] = FMath::DegreesToRadians(incl);
+            e[FSTwoLineElements::XNODEO] = FMath::DegreesToRadians(node);
+            e[FSTwoLineElements::EO] = ecc;
+            e[FSTwoLineElements::OMEGAO] = FMath::DegreesToRadians(omega);
+            e[FSTwoLineElements::XMO] = FMath::DegreesToRadians(mo);
+            e[FSTwoLineElements::XNO] = no * TwoPi / MinutesPerDay;
+            e[FSTwoLineElements::EPOCH] = 0.;
+            return true;
+        }
+
+        // Digits with an implied leading decimal point
+        bool ImpliedFraction(FAnsiStringView Line, int32 First, int32 Last, double& Value)
+        {
+            Value = 0.;
+            double Place = 0.1;
+            for (int32 c = First - 1; c < Last; ++c, Place *= 0.1)
+            {
+                if (Line[c] >= '0' && Line[c] <= '9') Value += (Line[c] - '0') * Place;
+                else if (Line[c] != ' ') return false;
+            }
+            return true;
+        }
+
+        bool ParseTle(FRecord& Record)
+        {
+            const FAnsiStringView L1 = Record.Lines[0];
+            const FAnsiStringView L2 = Record.Lines[1];
+            if (!Checksum(L1) || !Checksum(L2) || FMemory::Memcmp(L1.GetData() + 2, L2.GetData() + 2, 5) != 0)
+            {
+                return false;
+            }
+
+            int32 Year;
+            double Day, ndt20, ndd60, bstar, incl, node, ecc, omega, mo, no;
+            if (!CatalogNumber(L1, Record.CatalogNumber)
+                || !Integer(Field(L1, 19, 20), Year) || Year < 0 || Year > 99
+                || !Number(Field(L1, 21, 32), Day)
+                || !Number(Field(L1, 34, 43), ndt20)
+                || !ImpliedDecimal(L1, 45, ndd60)
+                || !ImpliedDecimal(L1, 54, bstar)
+                || !Number(Field(L2, 9, 16), incl)
+                || !Number(Field(L2, 18, 25), node)
+                || !ImpliedFraction(L2, 27, 33, ecc)
+                || !Number(Field(L2, 35, 42), omega)
+                || !Number(Field(L2, 44, 51), mo)
+                || !Number(Field(L2, 53, 63), no))
+            {
+                return false;
+            }
+
+            Year += FirstYear / 100 * 100;
+            if (Year < FirstYear) Year += 100;
+
+            return DayOfYearToCalendar(Year, Day, Record.Epoch)
+                && Convert(ndt20, ndd60, bstar, incl, node, ecc, omega, mo, no, Record.Elements);
+        }
+
+        // OMM CSV columns, by header name
+        enum EColumn
+        {
+            ObjectName, NoradCatId, Epoch, MeanMotion, Eccentricity, Inclination, RaOfAscNode,
+            ArgOfPericenter, MeanAnomaly, Bstar, MeanMotionDot, MeanMotionDdot, NumColumns
+        };
+
+        const ANSICHAR* const ColumnNames[NumColumns] = {
+            "OBJECT_NAME", "NORAD_CAT_ID", "EPOCH", "MEAN_MOTION", "ECCENTRICITY", "INCLINATION", "RA_OF_ASC_NODE",
+            "ARG_OF_PERICENTER", "MEAN_ANOMALY", "BSTAR", "MEAN_MOTION_DOT", "MEAN_MOTION_DDOT"
+        };
+
+        constexpr int32 MaxCsvFields = 64;
+
+        // Splits a CSV row, removing any quotes around a field.  Returns the
+        // number of fields.
+        int32 SplitCsv(FAnsiStringView Line, FAnsiStringView (&Fields)[MaxCsvFields])
+        {
+            int32 Count = 0;
+            int32 c = 0;
+            while (Count < MaxCsvFields)
+            {
+                int32 Begin = c, End;
+                if (c < Line.Len() && Line[c] == '"')
+                {
+                    Begin = ++c;
+                    while (c < Line.Len() && Line[c] != '"') ++c;
+                    End = c;
+                    while (c < Line.Len() && Line[c] != ',') ++c;
+                }
+                else
+                {
+                    while (c < Line.Len() && Line[c] != ',') ++c;
+                    End = c;
+                }
+
+                Fields[Count++] = Trim(FAnsiStringView(Line.GetData() + Begin, End - Begin));
+                if (c++ >= Line.Len())
+                {
+                    break;
+                }
+            }
+            return Count;
+        }
+
+        bool ParseOmm(FRecord& Record, const int32 (&Columns)[NumColumns])
+        {
+            FAnsiStringView Fields[MaxCsvFields];
+            const int32 NumFields = SplitCsv(Record.Lines[0], Fields);
+
+            double Values[NumColumns];
+            for (int32 k = NoradCatId; k < NumColumns; ++k)
+            {
+                if (Columns[k] >= NumFields || (k != Epoch && !Number(Fields[Columns[k]], Values[k])))
+                {
+                    return false;
+                }
+            }
+
+            if (Values[NoradCatId] < 0. || Values[NoradCatId] > double(MAX_int32))
+            {
+                return false;
+            }
+            Record.CatalogNumber = int32(Values[NoradCatId]);
+            Record.Name = Columns[ObjectName] < NumFields ? Fields[Columns[ObjectName]] : FAnsiStringView();
+
+            const FAnsiStringView EpochField = Fields[Columns[Epoch]];
+            TCHAR EpochText[64];
+            if (EpochField.Len() >= int32(UE_ARRAY_COUNT(EpochText)))
+            {
+                return false;
+            }
+            for (int32 c = 0; c < EpochField.Len(); ++c) EpochText[c] = TCHAR(EpochField[c]);
+
+            return Time::ParseUtc(FStringView(EpochText, EpochField.Len()), Record.Epoch)
+                && Convert(Values[MeanMotionDot], Values[MeanMotionDdot], Values[Bstar], Values[Inclination], Values[RaOfAscNode],
+                    Values[Eccentricity], Values[ArgOfPericenter], Values[MeanAnomaly], Values[MeanMotion], Record.Elements);
+        }
+
+        // Pass 1, for 2LE/3LE text
+        void FindTles(TConstArrayView<FAnsiStringView> Lines, TArray<FRecord>& Records)
+        {
+            auto IsTleLine = [&](int32 i, ANSICHAR Number)
+            {
+                return i < Lines.Num() && Lines[i].Len() >= TleLineLength && Lines[i][0] == Number && Lines[i][1] == ' ';
+            };
+
+            for (int32 i = 0; i < Lines.Num(); ++i)
+            {
+                if (!IsTleLine(i, '1') || !IsTleLine(i + 1, '2'))
+                {
+                    continue;
+                }
+
+                FRecord& Record = Records.AddDefaulted_GetRef();
+                Record.Lines[0] = Lines[i];
+                Record.Lines[1] = Lines[i + 1];
+
+                // A 3LE's name line, if the line before isn't part of a TLE
+                if (i > 0 && !IsTleLine(i - 1, '2') && Lines[i - 1].Len() > 0)
+                {
+                    Record.Name = Lines[i - 1];
+                    if (Record.Name.StartsWith("0 "))
+                    {
+                        Record.Name = Trim(Record.Name.RightChop(2));
+                    }
+                }
+                else
+                {
+                    // Without one, the catalog number
+                    Record.Name = Field(Lines[i], 3, 7);
+                }
+
+                ++i;
+            }
+        }
+
+        bool Parse(FAnsiStringView Text, FParsed& Parsed, bool bSources, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            // Pass 1: lines, then records
+            TArray<FAnsiStringView> Lines;
+            int32 Begin = Text.StartsWith("\xEF\xBB\xBF") ? 3 : 0;
+            for (int32 i = Begin; i <= Text.Len(); ++i)
+            {
+                if (i == Text.Len() || Text[i] == '\n')
+                {
+                    FAnsiStringView Line(Text.GetData() + Begin, i - Begin);
+                    while (Line.Len() > 0 && (Line[Line.Len() - 1] == '\r' || Line[Line.Len() - 1] == ' '))
+                    {
+                        Line.LeftChopInline(1);
+                    }
+                    Lines.Add(Line);
+                    Begin = i + 1;
+                }
+            }
+
+            int32 FirstLine = 0;
+            while (FirstLine < Lines.Num() && Lines[FirstLine].Len() == 0) ++FirstLine;
+            const bool bCsv = FirstLine < Lines.Num() && Lines[FirstLine].Contains("MEAN_MOTION");
+
+            TArray<FRecord> Records;
+            int32 Columns[NumColumns] = {};
+            if (bCsv)
+            {
+                FAnsiStringView Header[MaxCsvFields];
+                const int32 NumHeaders = SplitCsv(Lines[FirstLine], Header);
+                for (int32 k = 0; k < NumColumns; ++k)
+                {
+                    Columns[k] = MaxCsvFields;
+                    for (int32 h = 0; h < NumHeaders; ++h)
+                    {
+                        if (Header[h].Equals(ColumnNames[k], ESearchCase::IgnoreCase))
+                        {
+                            Columns[k] = h;
+                        }
+                    }
+                    if (Columns[k] == MaxCsvFields && k != ObjectName)
+                    {
+                        return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Tle: the CSV has no %s column"), ANSI_TO_TCHAR(ColumnNames[k])));
+                    }
+                }
+
+                for (int32 i = FirstLine + 1; i < Lines.Num(); ++i)
+                {
+                    if (Lines[i].Len() > 0)
+                    {
+                        Records.AddDefaulted_GetRef().Lines[0] = Lines[i];
+                    }
+                }
+            }
+            else
+            {
+                FindTles(Lines, Records);
+            }
+
+            // Pass 2: fields
+            ForEachBatch(Records.Num(), BatchSize, [&](int32 First, int32 End)
+            {
+                for (int32 i = First; i < End; ++i)
+                {
+                    Records[i].bValid = bCsv ? ParseOmm(Records[i], Columns) : ParseTle(Records[i]);
+                }
+            });
+
+            const int32 Skipped = Algo::CountIf(Records, [](const FRecord& Record) { return !Record.bValid; });
+            if (Skipped > 0)
+            {
+                UE_LOG(LogSpice, Warning, TEXT("MaxQ::Tle: skipped %d malformed records of %d"), Skipped, Records.Num());
+            }
+
+            // Pass 3: epochs
+            TArray<FUtcCalendar> Utc;
+            TArray<FSEphemerisTime> et;
+            Utc.Reserve(Records.Num() - Skipped);
+            for (const FRecord& Record : Records)
+            {
+                if (Record.bValid) Utc.Add(Record.Epoch);
+            }
+            et.SetNum(Utc.Num());
+
+            if (!Time::UtcToEt(Utc, et, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            Parsed.Elements.Reserve(et.Num() * NumElements);
+            Parsed.CatalogNumbers.Reserve(et.Num());
+            Parsed.NameOffsets.Reserve(et.Num() + 1);
+
+            int32 k = 0;
+            for (const FRecord& Record : Records)
+            {
+                if (Record.bValid)
+                {
+                    Parsed.Elements.Append(Record.Elements, NumElements);
+                    Parsed.Elements.Last() = et[k++].seconds;
+                    Parsed.CatalogNumbers.Add(Record.CatalogNumber);
+                    Parsed.Names.Append(Record.Name.GetData(), Record.Name.Len());
+                    Parsed.NameOffsets.Add(Parsed.Names.Num());
+                    if (bSources)
+                    {
+                        const ANSICHAR* End = bCsv ? Record.Lines[0].GetData() + Record.Lines[0].Len() : Record.Lines[1].GetData() + Record.Lines[1].Len();
+                        Parsed.Sources.Add(FAnsiStringView(Record.Lines[0].GetData(), int32(End - Record.Lines[0].GetData())));
+                    }
+                }
+            }
+
+            return Succeeded(ResultCode, ErrorMessage);
+        }
+
+        FString CachePath(uint64 Hash)
+        {
+            return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MaxQ"), TEXT("TleCache"), FString::Printf(TEXT("%016llx.tlecache"), Hash));
+        }
+
+        bool ReadCache(const FString& Path, uint64 Hash, int64 Size, FParsed& Parsed)
+        {
+            TArray<uint8> Bytes;
+            if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent) || Bytes.Num() < int32(sizeof(FCacheHeader)))
+            {
+                return false;
+            }
+
+            FCacheHeader Header;
+            FMemory::Memcpy(&Header, Bytes.GetData(), sizeof(Header));
+            if (Header.Magic != CacheMagic || Header.Version != CacheVersion || Header.SourceHash != Hash || Header.SourceSize != Size
+                || Header.Count < 0 || Header.NameLength < 0)
+            {
+                return false;
+            }
+
+            const int64 ElementBytes = int64(Header.Count) * NumElements * sizeof(double);
+            const int64 NumberBytes = int64(Header.Count) * sizeof(int32);
+            const int64 OffsetBytes = int64(Header.Count + 1) * sizeof(int32);
+            if (Bytes.Num() != sizeof(Header) + ElementBytes + NumberBytes + OffsetBytes + Header.NameLength)
+            {
+                return false;
+            }
+
+            const uint8* p = Bytes.GetData() + sizeof(Header);
+            Parsed.Elements.SetNumUninitialized(Header.Count * NumElements);
+            Parsed.CatalogNumbers.SetNumUninitialized(Header.Count);
+            Parsed.NameOffsets.SetNumUninitialized(Header.Count + 1);
+            Parsed.Names.SetNumUninitialized(Header.NameLength);
+            FMemory::Memcpy(Parsed.Elements.GetData(), p, ElementBytes); p += ElementBytes;
+            FMemory::Memcpy(Parsed.CatalogNumbers.GetData(), p, NumberBytes); p += NumberBytes;
+            FMemory::Memcpy(Parsed.NameOffsets.GetData(), p, OffsetBytes); p += OffsetBytes;
+            FMemory::Memcpy(Parsed.Names.GetData(), p, Header.NameLength);
+
+            return Parsed.NameOffsets[0] == 0 && Parsed.NameOffsets.Last() == Header.NameLength;
+        }
+
+        void WriteCache(const FString& Path, uint64 Hash, int64 Size, const FParsed& Parsed)
+        {
+            const FCacheHeader Header = { CacheMagic, CacheVersion, Hash, Size, Parsed.CatalogNumbers.Num(), Parsed.Names.Num() };
+
+            TArray<uint8> Bytes;
+            Bytes.Append((const uint8*)&Header, sizeof(Header));
+            Bytes.Append((const uint8*)Parsed.Elements.GetData(), Parsed.Elements.Num() * sizeof(double));
+            Bytes.Append((const uint8*)Parsed.CatalogNumbers.GetData(), Parsed.CatalogNumbers.Num() * sizeof(int32));
+            Bytes.Append((const uint8*)Parsed.NameOffsets.GetData(), Parsed.NameOffsets.Num() * sizeof(int32));
+            Bytes.Append((const uint8*)Parsed.Names.GetData(), Parsed.Names.Num());
+
+            // Only a missed optimization if it fails
+            IFileManager::Get().MakeDirectory(*FPaths::GetPath(Path), true);
+            if (!FFileHelper::SaveArrayToFile(Bytes, *Path))
+            {
+                UE_LOG(LogSpice, Warning, TEXT("MaxQ::Tle: couldn't write the cache %s"), *Path);
+            }
+        }
+
+        bool AddParsed(const FParsed& Parsed, FCatalog& Catalog, TArray<FAnsiStringView>* Records, ES_ResultCode* ResultCode, FString* ErrorMessage)
+        {
+            TArray<TCHAR> Names;
+            Names.SetNumUninitialized(Parsed.Names.Num());
+            for (int32 c = 0; c < Names.Num(); ++c) Names[c] = TCHAR(Parsed.Names[c]);
+
+            TArray<bool> Added;
+            if (Records)
+            {
+                Added.SetNumUninitialized(Parsed.CatalogNumbers.Num());
+            }
+
+            if (!Catalog.Add(Parsed.Elements, Parsed.CatalogNumbers, FStringView(Names.GetData(), Names.Num()), Parsed.NameOffsets, Added, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+
+            for (int32 i = 0; i < Added.Num(); ++i)
+            {
+                if (Added[i]) Records->Add(Parsed.Sources[i]);
+            }
+            return true;
+        }
+    }
+
+
+    void FCatalog::Reset()
+    {
+        Satellites.Reset();
+        Elements.Reset();
+        CatalogNumbers.Reset();
+        Indices.Reset();
+        Names.Reset();
+        NameOffsets = { 0 };
+    }
+
+
+    bool FCatalog::Add(const FSTwoLineElements& Satellite, int32 CatalogNumber, FStringView Name, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        if (!Satellites.Add(Satellite, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        Elements.Append(Satellite.elems);
+        Indices.Add(CatalogNumber, CatalogNumbers.Add(CatalogNumber));
+        Names.Append(Name.GetData(), Name.Len());
+        NameOffsets.Add(Names.Num());
+        return true;
+    }
+
+
+    bool FCatalog::Add(TConstArrayView<double> SatelliteElements, TConstArrayView<int32> SatelliteNumbers, FStringView SatelliteNames, TConstArrayView<int32> SatelliteNameOffsets, TArrayView<bool> Added, ES_ResultCode* ResultCode, FString* ErrorMessage)
+    {
+        const int32 Count = SatelliteNumbers.Num();
+        check(SatelliteElements.Num() == Count * NumElements);
+        check(SatelliteNameOffsets.Num() == Count + 1);
+        check(Added.Num() == 0 || Added.Num() == Count);
+
+        TArray<bool> Flags;
+        if (Added.Num() == 0)
+        {
+            Flags.SetNumUninitialized(Count);
+            Added = Flags;
+        }
+
+        if (!Satellites.Add(SatelliteElements, Added, ResultCode, ErrorMessage))
+        {
+            return false;
+        }
+
+        const int32 NumAdded = Algo::Count(Added, true);
+        Elements.Reserve(Elements.Num() + NumAdded * NumElements);
+        CatalogNumbers.Reserve(CatalogNumbers.Num() + NumAdded);
+        NameOffsets.Reserve(NameOffsets.Num() + NumAdded);
+        Names.Reserve(Names.Num() + SatelliteNames.Len());
+        Indices.Reserve(Indices.Num() + NumAdded);
+
+        for (int32 i = 0; i < Count; ++i)
+        {
+            if (Added[i])
+            {
+                Elements.Append(&SatelliteElements[i * NumElements], NumElements);
+                Indices.Add(SatelliteNumbers[i], CatalogNumbers.Add(SatelliteNumbers[i]));
+                Names.Append(SatelliteNames.GetData() + SatelliteNameOffsets[i], SatelliteNameOffsets[i + 1] - SatelliteNameOffsets[i]);
+                NameOffsets.Add(Names.Num());
+            }
+        }
+
+        return true;
+    }
+
+
+    FSTwoLineElements FCatalog::GetElements(int32 Index) const
+    {
+        double elems[NumElements];
+        FMemory::Memcpy(elems, &Elements[Index * NumElements], sizeof(elems));
+        return FSTwoLineElements(elems);
+    }
+
+
+    int32 FCatalog::Find(int32 CatalogNumber) const
+    {
+        const int32* Index = Indices.Find(CatalogNumber);
+        return Index ? *Index : INDEX_NONE;
+    }
+
+
+    SPICE_API bool LoadCatalog(
+        const FString& file,
+        FCatalog& Catalog,
+        bool bUseCache,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        const FString Path = toPath(file);
+
+        // Mapped, where the platform can; otherwise read whole
+        TUniquePtr<IMappedFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+        TUniquePtr<IMappedFileRegion> Region(Handle && Handle->GetFileSize() > 0 ? Handle->MapRegion() : nullptr);
+        TArray<uint8> Loaded;
+
+        FAnsiStringView Text;
+        if (Region)
+        {
+            Text = FAnsiStringView((const ANSICHAR*)Region->GetMappedPtr(), int32(Region->GetMappedSize()));
+        }
+        else if (FFileHelper::LoadFileToArray(Loaded, *Path, FILEREAD_Silent))
+        {
+            Text = FAnsiStringView((const ANSICHAR*)Loaded.GetData(), Loaded.Num());
+        }
+        else
+        {
+            return Failed(ResultCode, ErrorMessage, FString::Printf(TEXT("MaxQ::Tle: couldn't read %s"), *file));
+        }
+
+        FParsed Parsed;
+        if (!bUseCache)
+        {
+            return Parse(Text, Parsed, false, ResultCode, ErrorMessage) && AddParsed(Parsed, Catalog, nullptr, ResultCode, ErrorMessage);
+        }
+
+        const uint64 Hash = CityHash64(Text.GetData(), Text.Len());
+        const FString Cache = CachePath(Hash);
+        if (!ReadCache(Cache, Hash, Text.Len(), Parsed))
+        {
+            if (!Parse(Text, Parsed, false, ResultCode, ErrorMessage))
+            {
+                return false;
+            }
+            WriteCache(Cache, Hash, Text.Len(), Parsed);
+        }
+
+        return AddParsed(Parsed, Catalog, nullptr, ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ParseCatalog(
+        FAnsiStringView Text,
+        FCatalog& Catalog,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        FParsed Parsed;
+        return Parse(Text, Parsed, false, ResultCode, ErrorMessage) && AddParsed(Parsed, Catalog, nullptr, ResultCode, ErrorMessage);
+    }
+
+
+    SPICE_API bool ParseCatalog(
+        FAnsiStringView Text,
+        FCatalog& Catalog,
+        TArray<FAnsiStringView>& Records,
+        ES_ResultCode* ResultCode,
+        FString* ErrorMessage
+    )
+    {
+        FParsed Parsed;
+        return Parse(Text, Parsed, true, ResultCode, ErrorMessage) && AddParsed(Parsed, Catalog, &Records, ResultCode, ErrorMessage);
+    }
+};
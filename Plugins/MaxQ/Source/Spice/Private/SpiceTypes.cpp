@@ -53,6 +53,7 @@
 #include "Containers/StringFwd.h"
 #include "Spice.h"
 #include "SpiceUtilities.h"
+#include "SpiceTime.h"
 
 #include <iomanip>
 #include <sstream>
@@ -1641,7 +1642,13 @@ FString USpiceTypes::FormatSpeed(const FSSpeed& speed, ES_Units NumeratorUnits /
 
 FString USpiceTypes::FormatUtcTime(const FSEphemerisTime& time, ES_UTCTimeFormat TimeFormat, int precision)
 {
-    FString Result = TEXT("Time Format Error");
+    FString Result;
+    if (MaxQ::Time::EtToUtcString(time, TimeFormat, precision, Result))
+    {
+        return Result;
+    }
+
+    Result = TEXT("Time Format Error");
     ES_ResultCode ResultCode;
     FString ErrorMessage;
     USpice::et2utc(ResultCode, ErrorMessage, time, TimeFormat, Result, precision);
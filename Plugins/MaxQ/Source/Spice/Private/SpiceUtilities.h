@@ -25,6 +25,7 @@
 
 #include "CoreMinimal.h"
 #include "SpiceTypes.h"
+#include "Async/ParallelFor.h"
 
 PRAGMA_PUSH_PLATFORM_DEFAULT_PACKING
 extern "C"
@@ -65,4 +66,33 @@ namespace MaxQ::Private
     uint8 ErrorCheck(ES_ResultCode& ResultCode, FString& ErrorMessage, bool BeQuiet = false);
     uint8 UnexpectedErrorCheck(bool bReset = true);
     void MakeErrorGutter(ES_ResultCode*& pResultCode, FString*& pErrorMessage);
+
+    // Result reporting for the refined API's optional ResultCode/ErrorMessage
+    inline bool Succeeded(ES_ResultCode* pResultCode, FString* pErrorMessage)
+    {
+        if (pResultCode) *pResultCode = ES_ResultCode::Success;
+        if (pErrorMessage) pErrorMessage->Empty();
+        return true;
+    }
+
+    inline bool Failed(ES_ResultCode* pResultCode, FString* pErrorMessage, const FString& Message)
+    {
+        MakeErrorGutter(pResultCode, pErrorMessage);
+        *pResultCode = ES_ResultCode::Error;
+        *pErrorMessage = Message;
+        return false;
+    }
+
+    // Runs Body(Begin, End) over [0, Count) in batches of BatchSize,
+    // spread across worker threads when there's more than one batch.
+    template<typename BodyType>
+    void ForEachBatch(int32 Count, int32 BatchSize, BodyType&& Body)
+    {
+        const int32 NumBatches = FMath::DivideAndRoundUp(Count, BatchSize);
+        ParallelFor(NumBatches, [&](int32 Batch)
+        {
+            const int32 Begin = Batch * BatchSize;
+            Body(Begin, FMath::Min(Count, Begin + BatchSize));
+        }, NumBatches < 2);
+    }
 }
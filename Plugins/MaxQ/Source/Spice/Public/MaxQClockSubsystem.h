@@ -0,0 +1,155 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQClockSubsystem.h
+//
+// API Comments
+//
+// Purpose: One authoritative simulation clock per world.
+//
+// Actors that each keep their own "CurrentTime += DeltaTime * TimeScale"
+// drift apart, and at large time scales a single double ET loses sub-
+// millisecond precision.  The clock keeps ET as whole days + seconds into
+// the day, advances once per frame before physics, and broadcasts the new
+// time to everyone listening.
+//
+// Modes:
+// * Scaled:    ET advances by (frame DeltaTime) * TimeScale
+// * FixedStep: ET advances by FixedStep every frame, regardless of frame rate
+// Either mode can be paused.  While paused, SetEphemerisTime/Scrub move the
+// clock (and the next update is still broadcast.)
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SpiceTypes.h"
+#include "MaxQClockSubsystem.generated.h"
+
+class UMaxQClockSubsystem;
+
+UENUM(BlueprintType)
+enum class ES_ClockMode : uint8
+{
+    Scaled UMETA(DisplayName = "Scaled"),
+    FixedStep UMETA(DisplayName = "Fixed Step")
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMaxQClockUpdated, const FSEphemerisTime&, et, const FSEphemerisPeriod&, DeltaEt);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMaxQClockUpdatedNative, const FSEphemerisTime& /* et */, const FSEphemerisPeriod& /* DeltaEt */);
+
+
+USTRUCT()
+struct FMaxQClockTickFunction : public FTickFunction
+{
+    GENERATED_BODY()
+
+    UMaxQClockSubsystem* Clock = nullptr;
+
+    virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+    virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FMaxQClockTickFunction> : public TStructOpsTypeTraitsBase2<FMaxQClockTickFunction>
+{
+    enum
+    {
+        WithCopy = false
+    };
+};
+
+
+UCLASS(Category = "MaxQ")
+class SPICE_API UMaxQClockSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    UMaxQClockSubsystem();
+
+    // USubsystem/UWorldSubsystem
+    virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+    virtual void Deinitialize() override;
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+    static UMaxQClockSubsystem* Get(const UObject* WorldContextObject);
+
+    // Current time, as a single ET
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Clock")
+    FSEphemerisTime GetEphemerisTime() const;
+
+    // Current time, full precision: ET = Days * 86400 + Seconds, Seconds in [0, 86400)
+    void GetTwoPartTime(int64& OutDays, double& OutSeconds) const;
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void SetEphemerisTime(const FSEphemerisTime& et);
+
+    // Moves the clock by DeltaEt, paused or not
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void Scrub(const FSEphemerisPeriod& DeltaEt);
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Clock")
+    FSEphemerisPeriod GetTimeScale() const { return FSEphemerisPeriod(TimeScale); }
+
+    // Ephemeris seconds per real second (Scaled mode)
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void SetTimeScale(const FSEphemerisPeriod& InTimeScale);
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Clock")
+    ES_ClockMode GetMode() const { return Mode; }
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void SetMode(ES_ClockMode InMode);
+
+    // Ephemeris seconds per frame (FixedStep mode)
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void SetFixedStep(const FSEphemerisPeriod& InFixedStep);
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Clock")
+    bool IsPaused() const { return bPaused; }
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Clock")
+    void SetPaused(bool bInPaused);
+
+    // Increments once per clock update, so consumers can cache per-frame results
+    uint64 GetUpdateNumber() const { return UpdateNumber; }
+
+    // Makes ConsumerTick wait for the clock each frame
+    void AddTickPrerequisite(FTickFunction& ConsumerTick);
+
+    // Broadcast once per frame, after the clock advances
+    UPROPERTY(BlueprintAssignable, Category = "MaxQ|Clock")
+    FMaxQClockUpdated OnTimeUpdated;
+
+    FMaxQClockUpdatedNative OnTimeUpdatedNative;
+
+    void Tick(float DeltaTime);
+
+private:
+    void Advance(double DeltaSeconds);
+
+    // ET = Days * 86400 + Seconds
+    int64 Days;
+    double Seconds;
+
+    double TimeScale;
+    double FixedStep;
+    ES_ClockMode Mode;
+    bool bPaused;
+
+    // ET moved by SetEphemerisTime/Scrub since the last update
+    double PendingDelta;
+
+    uint64 UpdateNumber;
+
+    FMaxQClockTickFunction TickFunction;
+};
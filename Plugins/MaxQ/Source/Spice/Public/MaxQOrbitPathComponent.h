@@ -0,0 +1,111 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQOrbitPathComponent.h
+//
+// API Comments
+//
+// Purpose: Renders an orbit's path (ellipse or hyperbola) as lines.
+//
+// USpiceOrbits::RenderDebugConic re-tessellates and re-submits every segment
+// every frame.  This component tessellates its conic once, into several
+// levels of detail, each placed by curvature (USpiceOrbits::
+// ComputeConicPolyline), and only again when the conic changes.  Each frame
+// the renderer picks the coarsest level whose chord error is under
+// ScreenSpaceError pixels for that view, and draws it as batched lines.
+//
+// Conic coordinates are kilometers, in the component's local space, with the
+// usual MaxQ swizzle to Unreal's axes.  Scale the component (e.g. by
+// 1/DistanceScale) to place the orbit in the world.
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "SpiceTypes.h"
+#include "MaxQOrbitPathComponent.generated.h"
+
+struct FMaxQOrbitPathGeometry;
+
+UCLASS(ClassGroup = "MaxQ", meta = (BlueprintSpawnableComponent), HideCategories = (Collision, Physics, Lighting, Navigation))
+class SPICE_API UMaxQOrbitPathComponent : public UPrimitiveComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Largest allowed distance between a line segment and the true conic, in pixels
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Orbits", meta = (ClampMin = "0.01"))
+    float ScreenSpaceError;
+
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Orbits")
+    FColor LineColor;
+
+    // In pixels
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Orbits", meta = (ClampMin = "0"))
+    float LineThickness;
+
+    // How far along a hyperbola to draw, in hyperbolic anomaly (radians)
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Orbits", meta = (ClampMin = "0"))
+    double HyperbolicAnomalyLimit;
+
+    // Conic changes smaller than this, relative to the conic's size, don't
+    // rebuild the path.  (Osculating conics change slightly every frame.)
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Orbits", meta = (ClampMin = "0"))
+    double RebuildTolerance;
+
+public:
+    UMaxQOrbitPathComponent();
+
+    /// <summary>Sets the conic to render</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ToolTip = "Sets the ellipse or hyperbola to render.  The path is only rebuilt if it changed"
+            ))
+    void SetConic(const FSEllipse& conic, bool isHyperbolic);
+
+    /// <summary>Sets the conic to render from orbital elements</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ToolTip = "Sets the orbit to render, from conic elements.  The path is only rebuilt if it changed"
+            ))
+    void SetOrbit(
+        const FSConicElements& orbit,
+        const FSEphemerisTime& et,
+        const FString& orbitReferenceFrame = "ECLIPJ2000",
+        const FString& observerReferenceFrame = "ECLIPJ2000"
+    );
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Orbits")
+    void SetLineColor(const FColor& color);
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Orbits")
+    void SetLineThickness(float thickness);
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Orbits")
+    void SetScreenSpaceError(float pixels);
+
+    // UPrimitiveComponent
+    virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+    virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+#if WITH_EDITOR
+    virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+    void Rebuild();
+
+    FSEllipse Conic;
+    bool bIsHyperbolic;
+
+    // Shared with the scene proxy, which is recreated on any change
+    TSharedPtr<const FMaxQOrbitPathGeometry, ESPMode::ThreadSafe> Geometry;
+};
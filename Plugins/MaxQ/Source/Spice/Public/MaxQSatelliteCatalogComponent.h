@@ -0,0 +1,211 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQSatelliteCatalogComponent.h
+//
+// API Comments
+//
+// Purpose: Renders a satellite catalog (SpiceTleCatalog.h) as mesh
+// instances.
+//
+// Each clock update the component propagates every satellite with SGP4
+// (FTleBatch), rotates them out of TEME into ObserverReferenceFrame
+// (SpiceTeme.h), drops those outside the view or too small on screen, and
+// writes the rest to its instance buffer in one batch.  Nothing is spawned
+// per satellite, so the whole tracked catalog costs one draw call per mesh
+// LOD.
+//
+// Only a few satellites are "promoted": the MaxPromoted nearest the camera
+// that are drawn, and any that are selected.  Promoted satellites get orbit
+// lines (one pooled UMaxQOrbitPathComponent each), and OnPromotionChanged
+// tells the owner which to add or remove per-object extras (e.g. labels)
+// for.  Changing the catalog demotes them all.
+//
+// Positions are kilometers from the Earth's center, in
+// ObserverReferenceFrame, in the component's local space, with the usual
+// MaxQ swizzle to Unreal's axes.  Place the component at the Earth and scale
+// it (e.g. by 1/DistanceScale) to put the satellites in the world.
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "SpiceTypes.h"
+#include "SpiceSgp4.h"
+#include "SpiceTleCatalog.h"
+#include "MaxQSatelliteCatalogComponent.generated.h"
+
+class UMaxQOrbitPathComponent;
+
+// Catalog indices of the satellites newly promoted, and of those no longer
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMaxQSatellitePromotionChanged, const TArray<int32>&, Promoted, const TArray<int32>&, Demoted);
+
+UCLASS(ClassGroup = "MaxQ", meta = (BlueprintSpawnableComponent))
+class SPICE_API UMaxQSatelliteCatalogComponent : public UInstancedStaticMeshComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Any frame Teme::ToFrame accepts: J2000, PEF, ITRF93, ...
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites")
+    FString ObserverReferenceFrame;
+
+    // Each instance's scale, in the component's space
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites", meta = (ClampMin = "0"))
+    float SatelliteScale;
+
+    // Satellites outside the player's view aren't drawn
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites")
+    bool bCullByView;
+
+    // Satellites smaller than this on screen, in pixels across, aren't drawn.
+    // Zero for no limit.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites", meta = (ClampMin = "0"))
+    float MinScreenSize;
+
+    // How many of the nearest drawn satellites are promoted, besides the
+    // selected ones
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites", meta = (ClampMin = "0"))
+    int32 MaxPromoted;
+
+    // Draw promoted satellites' orbits
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites")
+    bool bDrawPromotedOrbits;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites")
+    FColor OrbitColor;
+
+    // Seconds (of ephemeris time) between re-osculating a promoted
+    // satellite's orbit.  Perturbations move the osculating conic a little
+    // every update, so re-osculating every update would rebuild every orbit
+    // line every frame.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites", meta = (ClampMin = "0"))
+    double OrbitRefreshInterval;
+
+    // The Earth's, for the promoted satellites' osculating orbits
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|Satellites")
+    FSMassConstant GM;
+
+    // Update every time the world's MaxQ clock does.  Otherwise, only on
+    // SetEphemerisTime.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|Satellites")
+    bool bFollowClock;
+
+    UPROPERTY(BlueprintAssignable, Category = "MaxQ|Satellites")
+    FMaxQSatellitePromotionChanged OnPromotionChanged;
+
+public:
+    UMaxQSatelliteCatalogComponent();
+
+    /// <summary>Adds the satellites in a TLE, 3LE or OMM CSV file</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Satellites",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Adds the satellites in a 2LE, 3LE or OMM CSV file (e.g. from CelesTrak)"
+            ))
+    void LoadCatalog(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        const FString& file
+    );
+
+    /// <summary>Adds the satellites in TLE text</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Satellites",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Adds the satellites in 2LE, 3LE or OMM CSV text (e.g. a telemetry response)"
+            ))
+    void AddTelemetry(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        const FString& Telemetry
+    );
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Satellites")
+    void ClearCatalog();
+
+    /// <summary>Moves the satellites to et</summary>
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Satellites")
+    void SetEphemerisTime(const FSEphemerisTime& et);
+
+    // Selected satellites (by catalog index) are always promoted
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Satellites")
+    void SetSelected(int32 SatelliteIndex, bool bSelected);
+
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|Satellites")
+    void ClearSelection();
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    int32 GetNumSatellites() const { return Catalog.Num(); }
+
+    // Satellites drawn at the last update
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    int32 GetNumVisible() const { return InstanceSatellites.Num(); }
+
+    // The catalog index of the satellite drawn as an instance (e.g. from a
+    // hit result's Item), or INDEX_NONE
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    int32 GetInstanceSatellite(int32 InstanceIndex) const;
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    FString GetSatelliteName(int32 SatelliteIndex) const;
+
+    // Where a satellite was at the last update, in the world.  False if it
+    // failed to propagate (e.g. decayed).
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    bool GetSatelliteLocation(int32 SatelliteIndex, FVector& WorldLocation) const;
+
+    // Catalog indices of the promoted satellites
+    UFUNCTION(BlueprintPure, Category = "MaxQ|Satellites")
+    TArray<int32> GetPromoted() const { return Promoted; }
+
+    const MaxQ::Tle::FCatalog& GetCatalog() const { return Catalog; }
+
+    // The catalog's states, in ObserverReferenceFrame, at the last update
+    TConstArrayView<FSStateVector> GetStates() const { return States; }
+
+    // UActorComponent
+    virtual void BeginPlay() override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+    void CatalogChanged();
+    void Update(const FSEphemerisTime& et);
+    void UpdatePromoted(bool bHaveView);
+    void UpdateOrbits(const FSEphemerisTime& et);
+
+    MaxQ::Tle::FCatalog Catalog;
+
+    // Scratch, kept to avoid reallocating every update
+    TArray<FSStateVector> States;
+    TArray<MaxQ::Sgp4::EError> Errors;
+    TArray<FTransform> Transforms;
+    TArray<uint8> Visible;
+    TArray<double> CameraDistances;
+
+    // Catalog index of each instance
+    TArray<int32> InstanceSatellites;
+
+    TSet<int32> Selected;
+    TArray<int32> Promoted;
+
+    // Pooled, reused as the promoted set changes
+    UPROPERTY(Transient)
+    TArray<TObjectPtr<UMaxQOrbitPathComponent>> OrbitPaths;
+
+    // The OrbitPaths index of each promoted satellite's (by catalog index),
+    // the time each path's orbit was osculated at, and the unused paths
+    TMap<int32, int32> SatelliteOrbitPaths;
+    TArray<double> OrbitPathEpochs;
+    TArray<int32> FreeOrbitPaths;
+
+    uint64 LastClockUpdate;
+};
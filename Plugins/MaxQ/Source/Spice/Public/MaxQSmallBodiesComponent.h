@@ -0,0 +1,139 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// MaxQSmallBodiesComponent.h
+//
+// API Comments
+//
+// Purpose: Renders a small-body catalog (SpiceSmallBodies.h) as mesh
+// instances.
+//
+// Each clock update the component propagates every body bright enough
+// (MaxMagnitude) across worker threads, drops those farther than
+// MaxDistance from CullingOrigin, and writes the rest to its instance buffer
+// in one batch.  Nothing is spawned per body, so hundreds of thousands of
+// bodies cost one draw call per mesh LOD.
+//
+// Positions are kilometers from the Sun, in ObserverReferenceFrame, in the
+// component's local space, with the usual MaxQ swizzle to Unreal's axes.
+// Place the component at the Sun and scale it (e.g. by 1/DistanceScale) to
+// put the bodies in the world.
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "SpiceTypes.h"
+#include "SpiceSmallBodies.h"
+#include "MaxQSmallBodiesComponent.generated.h"
+
+class UDataTable;
+
+UCLASS(ClassGroup = "MaxQ", meta = (BlueprintSpawnableComponent))
+class SPICE_API UMaxQSmallBodiesComponent : public UInstancedStaticMeshComponent
+{
+    GENERATED_BODY()
+
+public:
+    // Faintest absolute magnitude (H) drawn.  Bodies without an H are always
+    // drawn.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|SmallBodies")
+    float MaxMagnitude;
+
+    // Bodies farther than this from CullingOrigin aren't drawn.  Zero for no
+    // limit.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|SmallBodies")
+    FSDistance MaxDistance;
+
+    // Relative to the Sun, in ObserverReferenceFrame (e.g. the camera's focus)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|SmallBodies")
+    FSDistanceVector CullingOrigin;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|SmallBodies")
+    FString ObserverReferenceFrame;
+
+    // Each instance's scale, in the component's space
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MaxQ|SmallBodies", meta = (ClampMin = "0"))
+    float BodyScale;
+
+    // Update every time the world's MaxQ clock does.  Otherwise, only on
+    // SetEphemerisTime.
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MaxQ|SmallBodies")
+    bool bFollowClock;
+
+public:
+    UMaxQSmallBodiesComponent();
+
+    /// <summary>Replaces the catalog with the bodies in an MPCORB file</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|SmallBodies",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Replaces the catalog with the orbits in a Minor Planet Center MPCORB.DAT-format file, leaving out bodies fainter than maxMagnitude"
+            ))
+    void LoadMpcorb(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        const FString& file,
+        float maxMagnitude = 30.f
+    );
+
+    /// <summary>Replaces the catalog with the rows of a data table</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|SmallBodies",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Replaces the catalog with a data table of JPL Small-Body Database rows (e, q, i, om, w, ma, epoch)"
+            ))
+    void ImportDataTable(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        const UDataTable* Table
+    );
+
+    /// <summary>Moves the bodies to et</summary>
+    UFUNCTION(BlueprintCallable, Category = "MaxQ|SmallBodies")
+    void SetEphemerisTime(const FSEphemerisTime& et);
+
+    UFUNCTION(BlueprintPure, Category = "MaxQ|SmallBodies")
+    int32 GetNumBodies() const { return Catalog.Num(); }
+
+    // Bodies drawn at the last update
+    UFUNCTION(BlueprintPure, Category = "MaxQ|SmallBodies")
+    int32 GetNumVisible() const { return InstanceBodies.Num(); }
+
+    // The name of the body drawn as an instance (e.g. from a hit result's Item)
+    UFUNCTION(BlueprintPure, Category = "MaxQ|SmallBodies")
+    FString GetBodyName(int32 InstanceIndex) const;
+
+    const MaxQ::SmallBodies::FCatalog& GetCatalog() const { return Catalog; }
+
+    // UActorComponent
+    virtual void BeginPlay() override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+    void Update(const FSEphemerisTime& et);
+
+    MaxQ::SmallBodies::FCatalog Catalog;
+
+    // Bodies bright enough, for the MaxMagnitude they were selected with
+    TArray<int32> Candidates;
+    float CandidatesMagnitude;
+
+    // Scratch, kept to avoid reallocating every update
+    TArray<FSDistanceVector> Positions;
+    TArray<FTransform> Transforms;
+    TArray<uint8> Visible;
+
+    // Catalog index of each instance
+    TArray<int32> InstanceBodies;
+
+    uint64 LastClockUpdate;
+};
@@ -1362,6 +1362,28 @@ public:
         FSEphemerisPeriod& delta
     );
 
+    /// <summary>Return the value of Delta ET (ET-UTC) for each of a list of epochs</summary>
+    /// <param name="epochs">[in] Input epochs (seconds past J2000)</param>
+    /// <param name="eptype">[in] Type of the input epochs ("UTC" or "ET")</param>
+    /// <param name="deltas">[out] Delta ET (ET-UTC) at each input epoch</param>
+    /// <returns></returns>
+    UFUNCTION(
+        BlueprintCallable,
+        Category = "MaxQ|Time",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            Keywords = "TIME",
+            ShortToolTip = "Delta ET, ET - UTC, for a list of epochs",
+            ToolTip = "Return the value of Delta ET (ET-UTC) for each of a list of epochs"
+            ))
+    static void deltet_list(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        const TArray<double>& epochs,
+        ES_EpochType            eptype,
+        TArray<FSEphemerisPeriod>& deltas
+    );
+
     /// <summary>Compute the determinant of a double precision 3x3 matrix</summary>
     /// <param name="m1">Matrix whose determinant is to be found</param>
     /// <returns>the value of the determinant found by direct application of the definition of the determinan</returns>
@@ -5338,6 +5360,28 @@ public:
         ES_TimeScale outsys = ES_TimeScale::ET
     );
 
+    /// <summary>Transform a list of times from one uniform scale to another</summary>
+    /// <param name="epochs">[in] Epochs to be converted</param>
+    /// <param name="insys">[in] The time scale associated with the input epochs</param>
+    /// <param name="outsys">[in] The time scale associated with the output</param>
+    /// <returns> d.p.'s in outsys equivalent to the epochs on the insys time scale</returns>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Time",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            Keywords = "CONVERSION, TIME, UTILITY",
+            ShortToolTip = "Uniform time scale transformation, for a list of epochs",
+            ToolTip = "Transform a list of times from one uniform scale to another.  The uniform time scales are TAI, TDT, TDB, ET, JED, JDTDB, JDTDT"
+            ))
+    static void unitim_list(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        TArray<double>& out,
+        const TArray<double>& epochs,
+        ES_TimeScale insys = ES_TimeScale::ET,
+        ES_TimeScale outsys = ES_TimeScale::ET
+    );
+
     /// <summary>Unit vector and norm, 3 dimensional</summary>
     /// <param name="v1">[in] Vector to be normalized</param>
     /// <param name="vout">[out] Unit vector v1</param>
@@ -6284,7 +6328,7 @@ public:
         meta = (
             Keywords = "TIME",
             ShortToolTip = "Approximate current et (suitable for visualizations)",
-            ToolTip = "Approximate current ephemeris time, based on clock of local and sketchy CRT conversion"
+            ToolTip = "Approximate current ephemeris time, based on the local clock.  Accounts for leapseconds when a leapseconds kernel is loaded"
             ))
     static void et_now(FSEphemerisTime& Now);
 
@@ -0,0 +1,154 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceConics.h
+//
+// API Comments
+//
+// Purpose:  Native two-body propagation of many conic orbits at once
+//
+// conics_c recomputes each orbit's periapsis state and mean motion on every
+// call, then propagates it with prop2b.  FConicBatch does the per-orbit work
+// once, when the orbit is added, and keeps the results as a structure of
+// arrays.  Evaluating the batch at an epoch is then one universal-variable
+// Kepler solve per orbit, with no CSPICE calls, and large batches are split
+// across worker threads.
+//
+// Elliptic, parabolic and hyperbolic orbits are all supported, with the same
+// element conventions and validation as conics_c.  Results agree with
+// conics_c to within the solver tolerance (relative to the orbit's size and
+// speed).
+//
+// Osculate() is the inverse: osculating elements (oscelt, oscltx) of many
+// states about the same primary, with the same singular-case handling.
+//
+// Transition() propagates states (rather than elements) along with their
+// state transition matrices, d(final state)/d(initial state), for
+// covariance propagation (see SpiceCovariance.h).
+//
+// Frames:
+// The optional rotation is applied to every state in the batch, so a frame
+// change costs one pxform per batch rather than one per orbit.
+//
+// Threading:
+// An FConicBatch may be evaluated from any thread, and concurrently, as long
+// as nothing is adding to it.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceConics.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceCovariance.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Conics
+{
+    class SPICE_API FConicBatch
+    {
+    public:
+        // Solver convergence: the last correction to each orbit's universal
+        // anomaly, relative to the anomaly.  The solver converges cubically,
+        // so results are usually far more accurate than this.
+        double Tolerance = 1e-12;
+        int32 MaxIterations = 32;
+
+        void Reset();
+        void Reserve(int32 Count);
+        int32 Num() const { return Rp.Num(); }
+
+        // Adds an orbit.  Returns false, and doesn't add it, for elements
+        // conics_c would reject (negative eccentricity, non-positive periapsis
+        // distance or GM).
+        bool Add(const FSConicElements& Orbit, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Adds all of the orbits, or none of them if any is invalid.
+        bool Add(TConstArrayView<FSConicElements> Orbits, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // States (or positions) of every orbit at et.  Outputs must be sized
+        // to Num().  Returns false if any orbit's state isn't finite (a
+        // hyperbola propagated too far); those entries are left unchanged.
+        bool Evaluate(const FSEphemerisTime& et, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+        bool Evaluate(const FSEphemerisTime& et, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // As above, rotated by m (e.g. from pxform) into another frame
+        bool Evaluate(const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+        bool Evaluate(const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // Each orbit's state at its own epoch, ets[i]
+        bool Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // Orbit Orbits[i]'s state at ets[i], for any number of lookups into
+        // the batch.  ets and States must be sized to Orbits.Num().
+        bool Evaluate(TConstArrayView<int32> Orbits, TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // Positions of a subset of the batch, Orbits, at et, rotated by m.
+        // Positions must be sized to Orbits.Num().
+        bool Evaluate(TConstArrayView<int32> Orbits, const FSEphemerisTime& et, const FSRotationMatrix& m, TArrayView<FSDistanceVector> Positions, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+    private:
+        template<typename OutType>
+        bool EvaluateBatch(double et, const FSEphemerisTime* ets, const int32* Orbits, const double(*m)[3], TArrayView<OutType> Out, ES_ResultCode* ResultCode, FString* ErrorMessage) const;
+
+        // Periapsis state, rp*P and vp*Q, where P and Q are the unit vectors
+        // towards periapsis and along the periapsis velocity.
+        TArray<double> R0x, R0y, R0z;
+        TArray<double> V0x, V0y, V0z;
+
+        TArray<double> Rp;
+        TArray<double> Eccentricity;
+        // 1/a: positive for ellipses, zero for parabolas, negative for hyperbolas
+        TArray<double> Alpha;
+        TArray<double> SqrtMu;
+
+        // Time past periapsis is (et - Epoch) + MeanAnomalyTime, reduced by
+        // Period for ellipses (Period is zero otherwise).
+        TArray<double> Epoch;
+        TArray<double> MeanAnomalyTime;
+        TArray<double> Period;
+    };
+
+    // Single orbit, same as conics_c
+    SPICE_API bool Evaluate(const FSConicElements& Orbit, const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Each orbit's state at the orbit's own epoch (T0), the inverse of
+    // Osculate.  States must be sized to Orbits.Num().
+    SPICE_API bool Evaluate(TConstArrayView<FSConicElements> Orbits, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Osculating elements of each state at et, about a primary with
+    // gravitational parameter mu, same as oscelt_c.  Elements must be sized
+    // to States.Num().  Returns false if any state is degenerate (zero
+    // position, velocity or angular momentum); those entries are left
+    // unchanged.  A non-positive mu fails the whole call.
+    SPICE_API bool Osculate(TConstArrayView<FSStateVector> States, const FSEphemerisTime& et, const FSMassConstant& mu, TArrayView<FSConicElements> Elements, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // As above, plus oscltx_c's true anomaly, semi-major axis and period.
+    // As in oscltx_c, the semi-major axis is zero for parabolas and the
+    // period is zero unless the orbit is elliptic (or where either would
+    // overflow).  Each extended output may be empty, if it's not wanted, or
+    // sized to States.Num().
+    SPICE_API bool Osculate(TConstArrayView<FSStateVector> States, const FSEphemerisTime& et, const FSMassConstant& mu, TArrayView<FSConicElements> Elements, TArrayView<FSAngle> TrueAnomaly, TArrayView<FSDistance> SemiMajorAxis, TArrayView<FSEphemerisPeriod> Period, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // State propagated by dt about a primary with gravitational parameter
+    // mu (as prop2b_c), and the two-body state transition matrix
+    // Phi = d(Final)/d(State).
+    SPICE_API bool Transition(const FSStateVector& State, const FSEphemerisPeriod& dt, const FSMassConstant& mu, FSStateVector& Final, Covariance::FStateMatrix& Phi, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // As above, for each state.  Finals and Transitions must be sized to
+    // States.Num().  Returns false if any state can't be propagated (zero
+    // position, or a hyperbola propagated too far); those entries are left
+    // unchanged.
+    SPICE_API bool Transition(TConstArrayView<FSStateVector> States, const FSEphemerisPeriod& dt, const FSMassConstant& mu, TArrayView<FSStateVector> Finals, TArrayView<Covariance::FStateMatrix> Transitions, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+};
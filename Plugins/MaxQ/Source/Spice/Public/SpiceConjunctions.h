@@ -0,0 +1,87 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceConjunctions.h
+//
+// API Comments
+//
+// Purpose:  All-vs-all conjunction screening of satellite catalogs
+//
+// Which pairs of satellites come within a threshold distance of each other
+// over a time span?  Checking every pair at every step, with evsgp4 and
+// vdist, is O(n^2) per step.  Screen() narrows the pairs down in stages:
+// 1. Orbit shells: a pair whose perigee-apogee ranges are further apart
+//    than the threshold (plus a margin) can never meet, and a satellite
+//    whose shell overlaps no other satellite's is dropped entirely.
+// 2. A spatial hash, at each coarse time step: only satellites in
+//    neighbouring cells are compared.  The cells are large enough that a
+//    pair within the threshold at any time in a step is close enough at one
+//    of the step's ends to be found.
+// 3. Each candidate pair's closest approach, on the steps either side of
+//    where it was found, from Hermite interpolation of the coarse states.
+// Each stage runs in parallel.
+//
+// Conjunctions are relative to the satellites' SGP4 states, in TEME.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceConjunctions.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceSgp4.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Conjunctions
+{
+    struct FConjunction
+    {
+        // Satellite indices in the batch, Primary < Secondary
+        int32 Primary = INDEX_NONE;
+        int32 Secondary = INDEX_NONE;
+
+        // Time of closest approach, and the distance and relative speed then
+        FSEphemerisTime TCA;
+        FSDistance MissDistance;
+        FSSpeed RelativeSpeed;
+    };
+
+    struct FSettings
+    {
+        // Coarse time step.  Interpolation errors grow as its fourth power;
+        // at 60 s they're well under a meter in low Earth orbit.
+        FSEphemerisPeriod Step = FSEphemerisPeriod(60.);
+
+        // Added to the threshold when comparing orbit shells, for the
+        // difference between mean and osculating perigees and apogees, and
+        // for drag or lunar-solar changes over the span
+        FSDistance ShellMargin = FSDistance(50.);
+    };
+
+    // Every close approach, within Threshold, between satellites in
+    // Satellites, from et to etEnd, which must be later.  Conjunctions is
+    // sorted by TCA.  An approach that's closest at et or etEnd is reported
+    // there.  Satellites that fail to propagate (e.g. decayed) are left out
+    // of the steps they fail at.
+    SPICE_API bool Screen(
+        const Sgp4::FTleBatch& Satellites,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        const FSDistance& Threshold,
+        TArray<FConjunction>& Conjunctions,
+        const FSettings& Settings = FSettings(),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
@@ -0,0 +1,88 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceCovariance.h
+//
+// API Comments
+//
+// Purpose:  Batched 6x6 state covariance propagation
+//
+// A state covariance P is carried from one epoch to another by the state
+// transition matrix Phi between them:
+//   P' = Phi * P * Phi^T
+// Conics::Transition() gives Phi for two-body motion, and
+// Propagator::PropagateTransition() for the numerical force models.  A frame
+// change is the same product, with sxform's matrix as Phi.
+//
+// FStateMatrix is a plain 6x6 array, rather than an FSStateTransform (an
+// array of rows on the heap), so batches of them are contiguous.  The
+// products use fixed-size SIMD kernels instead of the general mxmg_c path,
+// and batches are split across worker threads.
+//
+// Units are km and km/s throughout: a covariance's upper-left block is
+// km^2, a transition matrix's upper-right block is seconds.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceCovariance.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Covariance
+{
+    // Row-major, like sxform's matrices: m[row][column]
+    struct FStateMatrix
+    {
+        double m[6][6] = {};
+
+        FStateMatrix() = default;
+
+        explicit FStateMatrix(const double(&_m)[6][6])
+        {
+            FMemory::Memcpy(m, _m, sizeof(m));
+        }
+
+        explicit FStateMatrix(const FSStateTransform& Transform)
+        {
+            Transform.CopyTo(m);
+        }
+
+        FSStateTransform ToStateTransform() const
+        {
+            return FSStateTransform(m);
+        }
+
+        static FStateMatrix Identity()
+        {
+            FStateMatrix Result;
+            for (int32 i = 0; i < 6; ++i) Result.m[i][i] = 1.;
+            return Result;
+        }
+    };
+
+    // Result = Phi * P * Phi^T.  Result may be P.
+    SPICE_API void Transform(const FStateMatrix& Phi, const FStateMatrix& P, FStateMatrix& Result);
+
+    // Result = A * B.  Result may be A or B.
+    SPICE_API void Multiply(const FStateMatrix& A, const FStateMatrix& B, FStateMatrix& Result);
+
+    // Each covariance, in place, by its own transition matrix.
+    // Transitions must be sized to Covariances.Num().
+    SPICE_API void Propagate(TConstArrayView<FStateMatrix> Transitions, TArrayView<FStateMatrix> Covariances);
+
+    // Every covariance, in place, by the same matrix (e.g. a frame change)
+    SPICE_API void Propagate(const FStateMatrix& Transition, TArrayView<FStateMatrix> Covariances);
+};
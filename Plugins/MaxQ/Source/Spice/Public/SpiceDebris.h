@@ -0,0 +1,148 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceDebris.h
+//
+// API Comments
+//
+// Purpose:  Debris clouds from explosions and collisions, in bulk
+//
+// Generate() breaks a parent up into fragments following the NASA standard
+// breakup model (Johnson, Krisko, Liou & Anz-Meador, "NASA's new breakup
+// model of EVOLVE 4.0", 2001):
+// * How many: a power law in characteristic length, Lc.  Explosions give
+//   6 S Lc^-1.6 fragments larger than Lc (S scales for the parent type);
+//   collisions 0.1 M^0.75 Lc^-1.71, M being the mass involved (kg).
+// * Each fragment's Lc, from that power law, between MinLength and
+//   MaxLength
+// * Its area-to-mass ratio, from the spacecraft distributions in
+//   log10(A/M), and so its area and mass
+// * Its delta-v, log-normal in speed with a mean that depends on A/M, in
+//   a uniformly random direction, added to the parent's state
+// Fragments are generated in parallel, from random streams seeded per
+// batch, so the same Seed always gives the same cloud.  As in the model,
+// neither mass nor momentum is conserved exactly.
+//
+// The fragments' states can then be turned into orbits in one batch, for
+// either engine:
+// * ToConics(): osculating elements (Conics::Osculate), into an
+//   FConicBatch.  Two-body, so exact at the breakup and good for hours.
+// * ToTles(): the same elements, taken as SGP4 mean elements, with B* from
+//   each fragment's A/M, into an FTleBatch.  The osculating elements are
+//   off from SGP4's mean ones by J2's short-period terms (kilometers), but
+//   drag and secular J2 make it the better choice over days.
+//
+// Units are SI for the fragments' physical properties (m, m^2, kg) and km,
+// km/s for their states, as everywhere else.
+//
+// Threading:
+// Generate() and ToConics() may be called from any thread.  ToTles()
+// belongs on the game thread, as it uses CSPICE.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceDebris.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceConics.h"
+#include "SpiceSgp4.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Debris
+{
+    enum class EBreakup : uint8
+    {
+        Explosion,
+        Collision
+    };
+
+    struct FBreakup
+    {
+        EBreakup Type = EBreakup::Explosion;
+
+        // Explosions: the model's scaling factor, S, for the parent
+        double Scale = 1.;
+
+        // Collisions: the mass involved (kg).  For a catastrophic collision,
+        // both objects' masses; otherwise the projectile's mass times the
+        // impact speed (km/s) squared.
+        double Mass = 0.;
+
+        // Characteristic lengths of the fragments generated (m)
+        double MinLength = 0.1;
+        double MaxLength = 10.;
+
+        // Zero for as many as the model gives
+        int32 MaxFragments = 0;
+
+        uint32 Seed = 0;
+    };
+
+    // Fragments, as a structure of arrays, fragment i being element i of
+    // each
+    struct SPICE_API FFragments
+    {
+        TArray<double> Length;          // characteristic length (m)
+        TArray<double> AreaToMass;      // m^2/kg
+        TArray<double> Area;            // average cross-section (m^2)
+        TArray<double> Mass;            // kg
+        TArray<double> DeltaV;          // km/s
+        TArray<FSStateVector> States;   // the parent's, plus the delta-v
+
+        int32 Num() const { return States.Num(); }
+        void Reset();
+    };
+
+    // How many fragments the model gives for a breakup, before MaxFragments
+    SPICE_API int32 NumFragments(const FBreakup& Breakup);
+
+    // Replaces Fragments with the fragments of a Parent breaking up
+    SPICE_API bool Generate(
+        const FBreakup& Breakup,
+        const FSStateVector& Parent,
+        FFragments& Fragments,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Appends each fragment's orbit at et, about a primary with gravitational
+    // parameter mu, to Orbits.  Returns false, adding nothing, if any
+    // fragment's state is degenerate.
+    SPICE_API bool ToConics(
+        const FFragments& Fragments,
+        const FSEphemerisTime& et,
+        const FSMassConstant& mu,
+        Conics::FConicBatch& Orbits,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Appends each fragment to Satellites, with elements at et.  The
+    // fragments' states are in frame (see SpiceTeme.h).  Fragments the batch
+    // rejects (suborbital, or escaping) are skipped, and flagged false in
+    // Added, which must be sized to Fragments.Num().  mu is the batch's
+    // (WGS-72's, by default).
+    SPICE_API bool ToTles(
+        const FFragments& Fragments,
+        const FSEphemerisTime& et,
+        const FString& frame,
+        Sgp4::FTleBatch& Satellites,
+        TArrayView<bool> Added,
+        double DragCoefficient = 2.2,
+        const FSMassConstant& mu = FSMassConstant(398600.8),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
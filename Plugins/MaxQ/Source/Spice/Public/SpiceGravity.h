@@ -0,0 +1,144 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceGravity.h
+//
+// API Comments
+//
+// Purpose:  Spherical-harmonic gravity fields
+//
+// An FGravityField is a body's gravity potential as a series of fully
+// normalized spherical harmonics,
+//   U = GM / r * sum_n (R / r)^n * sum_m Pnm(sin(lat)) * (Cnm cos(m lon) + Snm sin(m lon))
+// in the body-fixed frame, up to some degree.  Load() reads the fields
+// published by ICGEM (.gfc files, e.g. EGM2008, EIGEN-6C4 or GGM05C) from
+// disk; Set() takes coefficients from anywhere else.
+//
+// Acceleration() evaluates the gradient of U at body-fixed positions, and
+// optionally the gravity gradient (the acceleration's partials, for state
+// transition matrices).  Batches are evaluated four positions at a time
+// in SIMD registers, across worker threads.  The cost per position grows
+// with the square of the degree: a degree 70 field is a few thousand terms.
+//
+// Positions are km from the body's center of mass; accelerations are
+// km/s^2, and gradients 1/s^2, all in the body-fixed frame.  A field is
+// immutable once loaded, so any number of threads may evaluate it at once.
+//
+// SpicePropagator.h's force model takes an FGravityField in place of its
+// zonal terms.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceGravity.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Gravity
+{
+    // km/s^2
+    struct FAcceleration
+    {
+        double a[3] = {};
+    };
+
+    // d(a)/d(r), row-major, 1/s^2
+    struct FGradient
+    {
+        double m[3][3] = {};
+    };
+
+    class SPICE_API FGravityField
+    {
+    public:
+        // Coefficients are stored by degree, then order: (n, m) at
+        // n * (n + 1) / 2 + m
+        static int32 Index(int32 n, int32 m) { return n * (n + 1) / 2 + m; }
+
+        // Reads an ICGEM gravity field file, truncated to maxDegree if that's
+        // positive.  Missing coefficients are zero.  Any previous field is
+        // discarded, even on failure.
+        bool Load(
+            const FString& file,
+            int32 maxDegree = 0,
+            ES_ResultCode* ResultCode = nullptr,
+            FString* ErrorMessage = nullptr
+        );
+
+        // Sets fully normalized coefficients, C and S each sized to
+        // Index(degree + 1, 0).  C[0] is normally 1; S[Index(n, 0)] are unused.
+        bool Set(
+            const FSMassConstant& GM,
+            const FSDistance& ReferenceRadius,
+            int32 degree,
+            TConstArrayView<double> C,
+            TConstArrayView<double> S,
+            ES_ResultCode* ResultCode = nullptr,
+            FString* ErrorMessage = nullptr
+        );
+
+        bool IsValid() const { return Degree >= 0; }
+        int32 GetDegree() const { return Degree; }
+        FSMassConstant GetGM() const { return FSMassConstant(GM); }
+        FSDistance GetReferenceRadius() const { return FSDistance(R); }
+        double GetC(int32 n, int32 m) const { return C[Index(n, m)]; }
+        double GetS(int32 n, int32 m) const { return S[Index(n, m)]; }
+
+        // Acceleration at r, and the gradient if Gradient isn't null.  Terms
+        // of degree below minDegree are left out: a minDegree of 1 leaves out
+        // the point mass, for adding to a two-body acceleration.
+        void Acceleration(const FSDistanceVector& r, FAcceleration& a, FGradient* Gradient = nullptr, int32 minDegree = 0) const;
+
+        // As above, at each of Positions.  Accelerations must be sized to
+        // Positions.Num(), and Gradients either the same, or empty to skip
+        // them.
+        void Acceleration(
+            TConstArrayView<FSDistanceVector> Positions,
+            TArrayView<FAcceleration> Accelerations,
+            TArrayView<FGradient> Gradients = {},
+            int32 minDegree = 0
+        ) const;
+
+    private:
+        void Tabulate();
+
+        // Sums each derivative operator's series over SIMD lanes (or one
+        // double), given the positions scaled to the reference radius
+        template<typename T>
+        void Sum(const T* Scaled, int32 Operators, int32 minDegree, T* V, T* W, T* Re, T* Im) const;
+
+        int32 Degree = -1;
+        double GM = 0.;
+        double R = 0.;
+        TArray<double> C;
+        TArray<double> S;
+
+        // Normalized recursion factors to Degree + 2, indexed as C and S,
+        // and the sectorial ones by order
+        TArray<double> ColumnA;
+        TArray<double> ColumnB;
+        TArray<double> Sectorial;
+
+        // Per coefficient and derivative operator, which V + iW term of a
+        // higher degree it takes, and by how much
+        struct FTerm
+        {
+            int32 Index = 0;
+            double Factor = 0.;
+            bool bConjugate = false;
+        };
+        TArray<FTerm> Terms;
+    };
+};
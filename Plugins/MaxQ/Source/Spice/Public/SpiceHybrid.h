@@ -0,0 +1,174 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceHybrid.h
+//
+// API Comments
+//
+// Purpose:  One vehicle's trajectory, across TLEs, conics and maneuvers
+//
+// A vehicle tracked by TLE until it maneuvers can't be propagated by that
+// TLE afterwards.  FTrajectory keeps the vehicle's whole history as a
+// sequence of segments, each from its Begin epoch up to the next one's,
+// propagated one of three ways:
+// * Tle - SGP4/SDP4, from the TLE's elements (SpiceSgp4.h)
+// * Conic - two-body, from the osculating elements at Begin (SpiceConics.h)
+// * Numerical - integrated under a force model from the state at Begin
+//   (SpicePropagator.h)
+//
+// Maneuver() applies an impulsive delta-v: it evaluates the state at its
+// epoch, adds the delta-v, and appends a Conic or Numerical segment from
+// there.  Each segment's model is set up once, when it's appended (the TLE
+// initialized, the state osculated and the conic solved for), so
+// evaluating is a binary search for the segment plus one propagation.
+// Segments never change once appended, so past states are replayed
+// exactly, and a trajectory may be copied to try maneuvers out on.
+//
+// Appending (AddTle, AddState, Maneuver) at an epoch replaces whatever came
+// from that epoch on, so plans can be revised.  The first segment also
+// covers the time before its Begin, unless it's Numerical.
+//
+// Numerical segments integrate from Begin on every call, so they're the
+// costly kind to evaluate; the batch Evaluate() integrates each segment
+// once, for all of its epochs.
+//
+// States are in the trajectory's frame, which must be inertial, or TEME
+// (SGP4's own frame).  Tle segments' states are converted from TEME (see
+// SpiceTeme.h); Numerical segments' force models must be in the same frame.
+//
+// Threading:
+// Appending belongs on the game thread, as it may use CSPICE.  So does
+// evaluating, unless the trajectory is only Conic segments, or Tle segments
+// in TEME, or Numerical segments without third bodies.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceHybrid.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceConics.h"
+#include "SpiceSgp4.h"
+#include "SpicePropagator.h"
+#include "Containers/ArrayView.h"
+#include "Templates/SharedPointer.h"
+
+namespace MaxQ::Hybrid
+{
+    enum class ESegment : uint8
+    {
+        Tle,
+        Conic,
+        Numerical
+    };
+
+    struct FSegment
+    {
+        ESegment Type = ESegment::Conic;
+        FSEphemerisTime Begin;
+
+        // State at Begin, including DeltaV
+        FSStateVector State;
+
+        // The maneuver(s) that started the segment, zero if none did
+        FSVelocityVector DeltaV;
+
+        // Conic segments: osculating elements at Begin
+        FSConicElements Elements;
+
+        // Tle segments: getelm's elements
+        FSTwoLineElements Tle;
+    };
+
+    class SPICE_API FTrajectory
+    {
+    public:
+        // In J2000, about the Earth (GM from DE431)
+        FTrajectory();
+
+        // mu is the central body's GM, for Conic segments
+        FTrajectory(const FString& frame, const FSMassConstant& mu);
+
+        void Reset();
+
+        // The force model for Numerical segments appended from now on.  Its
+        // frame must be the trajectory's.
+        void SetForceModel(const Propagator::FForceModel& Model, const Propagator::FSettings& Settings = Propagator::FSettings());
+
+        // Appends a Tle segment from et, with the WGS-72 constants (as
+        // FTleBatch's), or geophs.  Fails for elements evsgp4_c would reject,
+        // or if the state at et can't be evaluated (e.g. it's decayed).
+        bool AddTle(const FSEphemerisTime& et, const FSTwoLineElements& Elements, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+        bool AddTle(const FSEphemerisTime& et, const FSTwoLineElements& Elements, const FSTLEGeophysicalConstants& geophs, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Appends a Conic or Numerical segment from State at et
+        bool AddState(const FSEphemerisTime& et, const FSStateVector& State, ESegment Type = ESegment::Conic, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Adds dv to the state at et, appending a Conic or Numerical segment
+        // from there.  A zero dv just switches how the vehicle is propagated
+        // (e.g. from its TLE to a conic).  Maneuvers at the same epoch add
+        // up, into one segment whose DeltaV is their sum.
+        bool Maneuver(const FSEphemerisTime& et, const FSVelocityVector& dv, ESegment Type = ESegment::Conic, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        int32 Num() const { return Segments.Num(); }
+        const FSegment& GetSegment(int32 Index) const { return Segments[Index]; }
+        const FString& GetFrame() const { return Frame; }
+        const FSMassConstant& GetGM() const { return GM; }
+
+        // Index of the segment flying at et, or INDEX_NONE if it's empty
+        int32 FindSegment(const FSEphemerisTime& et) const;
+
+        // State at et
+        bool Evaluate(const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // As above, at each of ets, in any order.  States must be sized to
+        // ets.Num().  Returns false if any state can't be evaluated; those
+        // entries are left unchanged.
+        bool Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // Osculating elements at et (e.g. to draw the orbit).  For Conic
+        // segments, they're the segment's own, with no work at all.
+        bool Osculate(const FSEphemerisTime& et, FSConicElements& Elements, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+    private:
+        struct FNumerical
+        {
+            Propagator::FForceModel Model;
+            Propagator::FSettings Settings;
+        };
+
+        // A segment's propagator, set up when it's appended.  Shared, as it
+        // never changes.
+        struct FModel
+        {
+            TSharedPtr<const Sgp4::FTleBatch> Satellite;
+            TSharedPtr<const Conics::FConicBatch> Orbit;
+            TSharedPtr<const FNumerical> Numerical;
+        };
+
+        bool AddSatellite(const FSEphemerisTime& et, const FSTwoLineElements& Elements, const TSharedRef<Sgp4::FTleBatch>& Satellite, ES_ResultCode* ResultCode, FString* ErrorMessage);
+
+        // Drops the segments from Segment's Begin on, and appends it
+        void Append(FSegment&& Segment, FModel&& Model);
+
+        FString Frame;
+        FSMassConstant GM;
+        TSharedPtr<const FNumerical> ForceModel;
+
+        // Per segment
+        TArray<FSegment> Segments;
+        TArray<double> SegmentBegin;
+        TArray<FModel> Models;
+    };
+};
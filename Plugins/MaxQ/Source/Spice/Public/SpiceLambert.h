@@ -0,0 +1,137 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceLambert.h
+//
+// API Comments
+//
+// Purpose:  Lambert's problem, and porkchop plots built from it
+//
+// Solve() finds the two-body transfer orbits from position r1 to position r2
+// in a given time of flight, using Izzo's method ("Revisiting Lambert's
+// problem", 2015).  With MaxRevolutions > 0 it also finds the multiple-
+// revolution transfers, two for each number of revolutions the time of
+// flight allows.
+//
+// Porkchop() evaluates a departure-date x arrival-date grid of transfers.
+// Planet states come from tables sampled once per departure date and once
+// per arrival date (SampleStates, one spkezr each), not once per cell, and
+// the cells are solved in parallel.  Its outputs are flat arrays, one row
+// per arrival date, ready to copy into a texture or a Niagara array:
+//   C3[ArrivalIndex * NumDepartures + DepartureIndex]
+//
+// Transfers are prograde (counter-clockwise about +z of the frame) unless
+// bRetrograde is set.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceLambert.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Lambert
+{
+    struct FSolution
+    {
+        // Velocities at r1 and at r2
+        FSVelocityVector v1;
+        FSVelocityVector v2;
+        int32 Revolutions = 0;
+    };
+
+    // Porkchop cells with no transfer (arrival before departure, or a
+    // degenerate geometry) are set to this
+    constexpr double NoTransfer = -1.;
+
+    // The zero-revolution transfer
+    SPICE_API bool Solve(
+        const FSDistanceVector& r1,
+        const FSDistanceVector& r2,
+        const FSEphemerisPeriod& tof,
+        const FSMassConstant& mu,
+        FSVelocityVector& v1,
+        FSVelocityVector& v2,
+        bool bRetrograde = false,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Every transfer with up to MaxRevolutions revolutions: the zero-
+    // revolution transfer first, then for each number of revolutions the
+    // two solutions, lower energy (long period) first.
+    SPICE_API bool Solve(
+        const FSDistanceVector& r1,
+        const FSDistanceVector& r2,
+        const FSEphemerisPeriod& tof,
+        const FSMassConstant& mu,
+        TArray<FSolution>& Solutions,
+        int32 MaxRevolutions,
+        bool bRetrograde = false,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Geometric state (no aberration correction) of target relative to
+    // observer at each et.  States must be sized to ets.Num().
+    SPICE_API bool SampleStates(
+        const FString& target,
+        const FString& observer,
+        const FString& frame,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Departure C3 (km^2/s^2) and arrival v-infinity (km/s) of the transfer
+    // from each departure state to each arrival state.  When MaxRevolutions
+    // > 0 each cell is the transfer with the lowest C3.  C3 and
+    // ArrivalVInfinity must be sized to DepartureStates.Num() *
+    // ArrivalStates.Num().
+    SPICE_API bool Porkchop(
+        TConstArrayView<FSEphemerisTime> DepartureTimes,
+        TConstArrayView<FSStateVector> DepartureStates,
+        TConstArrayView<FSEphemerisTime> ArrivalTimes,
+        TConstArrayView<FSStateVector> ArrivalStates,
+        const FSMassConstant& mu,
+        TArrayView<double> C3,
+        TArrayView<double> ArrivalVInfinity,
+        int32 MaxRevolutions = 0,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // As above, sampling the departure and arrival bodies' states relative
+    // to center on evenly spaced dates.  C3 and ArrivalVInfinity are resized.
+    SPICE_API bool Porkchop(
+        const FString& departureBody,
+        const FString& arrivalBody,
+        const FString& center,
+        const FString& frame,
+        const FSMassConstant& mu,
+        const FSEphemerisTime& departureStart,
+        const FSEphemerisPeriod& departureStep,
+        int32 departureCount,
+        const FSEphemerisTime& arrivalStart,
+        const FSEphemerisPeriod& arrivalStep,
+        int32 arrivalCount,
+        TArray<double>& C3,
+        TArray<double>& ArrivalVInfinity,
+        int32 MaxRevolutions = 0,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
@@ -51,6 +51,146 @@ public:
     );
 
 
+    /// <summary>Evaluates many orbits at once</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Evaluates a list of orbits at one time, while transforming frames if needed (one pxform for the whole list)"
+            ))
+    static void EvaluateOrbits(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        TArray<FSStateVector>& states,
+        const FSEphemerisTime& et,
+        const TArray<FSConicElements>& orbits,
+        const FString& orbitReferenceFrame = "ECLIPJ2000",
+        const FString& observerReferenceFrame = "ECLIPJ2000"
+    );
+
+
+    /// <summary>Computes osculating elements for many states at once</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Computes the osculating conic elements (oscelt) of a list of states, all about the same primary"
+            ))
+    static void ComputeOrbits(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        TArray<FSConicElements>& orbits,
+        const FSEphemerisTime& et,
+        const TArray<FSStateVector>& states,
+        const FSMassConstant& gm
+    );
+
+
+    /// <summary>Solves Lambert's problem</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Finds the (zero revolution) two-body transfer from r1 to r2 in a time of flight"
+            ))
+    static void SolveLambert(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        FSVelocityVector& v1,
+        FSVelocityVector& v2,
+        const FSDistanceVector& r1,
+        const FSDistanceVector& r2,
+        const FSEphemerisPeriod& tof,
+        const FSMassConstant& gm,
+        bool retrograde = false
+    );
+
+    /// <summary>Computes a porkchop plot</summary>
+    // c3 and arrivalVInfinity have one row per arrival date, one column per
+    // departure date.  Cells with no transfer are -1.
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Computes departure C3 and arrival v-infinity for a grid of departure and arrival dates"
+            ))
+    static void ComputePorkchop(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        TArray<double>& c3,
+        TArray<double>& arrivalVInfinity,
+        const FString& departureBody,
+        const FString& arrivalBody,
+        const FSMassConstant& gm,
+        const FSEphemerisTime& departureStart,
+        const FSEphemerisPeriod& departureStep,
+        int departureCount,
+        const FSEphemerisTime& arrivalStart,
+        const FSEphemerisPeriod& arrivalStep,
+        int arrivalCount,
+        const FString& centerBody = "SUN",
+        const FString& referenceFrame = "ECLIPJ2000",
+        int maxRevolutions = 0
+    );
+
+    /// <summary>Propagates states numerically, with perturbations</summary>
+    // Gravity (GM, J2..J6, and the pole) comes from the kernel pool; see
+    // SpicePropagator.h.  Drag is left off.
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            AutoCreateRefTerm = "thirdBodies",
+            ToolTip = "Advances states from et to etEnd under the center body's zonal gravity and third-body point masses"
+            ))
+    static void PropagateStates(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        UPARAM(ref) TArray<FSStateVector>& states,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        const TArray<FString>& thirdBodies,
+        const FString& centerBody = "EARTH",
+        const FString& referenceFrame = "J2000",
+        bool gaussJackson = false
+    );
+
+    /// <summary>Propagates a state and its covariance on a conic</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Propagates a state by dt on a two-body orbit, carrying its 6x6 covariance along with the state transition matrix"
+            ))
+    static void PropagateCovariance(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        FSStateVector& finalState,
+        FSStateTransform& finalCovariance,
+        const FSStateVector& state,
+        const FSStateTransform& covariance,
+        const FSEphemerisPeriod& dt,
+        const FSMassConstant& gm
+    );
+
+    /// <summary>Propagates a formation's states relative to its chief</summary>
+    UFUNCTION(BlueprintCallable,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ExpandEnumAsExecs = "ResultCode",
+            ToolTip = "Propagates LVLH states relative to an elliptic chief by dt, with Yamanaka-Ankersen (or Clohessy-Wiltshire, if circular)"
+            ))
+    static void PropagateFormation(
+        ES_ResultCode& ResultCode,
+        FString& ErrorMessage,
+        UPARAM(ref) TArray<FSStateVector>& relativeStates,
+        const FSStateVector& chief,
+        const FSEphemerisPeriod& dt,
+        const FSMassConstant& gm,
+        bool circular = false
+    );
+
+
     /// <summary>Converts a distance to a double (kilometers)</summary>
     UFUNCTION(BlueprintPure,
         Category = "MaxQ|Orbits",
@@ -66,6 +206,25 @@ public:
         const FString& observerReferenceFrame = "ECLIPJ2000"
     );
 
+    /// <summary>Computes an adaptive polyline along a conic</summary>
+    // Points are spaced by curvature, so no chord strays from the conic by
+    // more than relativeError * (semi-major axis length).  Ellipses are closed
+    // (the last point repeats the first); hyperbolas run from
+    // -hyperbolicAnomalyLimit to +hyperbolicAnomalyLimit.
+    UFUNCTION(BlueprintPure,
+        Category = "MaxQ|Orbits",
+        meta = (
+            ToolTip = "Computes a polyline along an ellipse or hyperbola, with more points where it curves more sharply",
+            AdvancedDisplay = "hyperbolicAnomalyLimit"
+            ))
+    static void ComputeConicPolyline(
+        TArray<FSDistanceVector>& points,
+        const FSEllipse& conic,
+        bool isHyperbolic,
+        double relativeError = 0.00001,
+        double hyperbolicAnomalyLimit = 6.283185307179586
+    );
+
     /// <summary>Renders an ellipse in debug lines</summary>
     // For static orbits this better than rendering orbits, slightly, because
     // you can cache the ellipse and forget about it.
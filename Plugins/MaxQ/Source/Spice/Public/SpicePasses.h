@@ -0,0 +1,132 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePasses.h
+//
+// API Comments
+//
+// Purpose:  Ground-station pass prediction for many satellites
+//
+// When is each satellite above each station's elevation mask?  gfposc finds
+// one target's windows over one station per call, single threaded, with at
+// most MAXWIN windows.  Predict() finds every (station, satellite) pair's
+// passes over a span at once:
+// 1. Every satellite's Earth-fixed state is sampled on a coarse grid, a
+//    chunk of the span at a time, by FTleBatch (SpiceSgp4.h) or from SPK
+//    kernels.
+// 2. The pairs are spread across worker threads.  Each pair walks the grid,
+//    skipping steps on which its satellite can't reach the mask, and on the
+//    rest finds where the elevation peaks, and where it crosses the mask,
+//    by bisection on Hermite interpolation of the samples.
+//
+// A pass has rise, culmination (highest elevation) and set times.  A pass
+// already in progress at the span's start rises then; one still in progress
+// at its end sets then.
+//
+// TLE satellites' TEME states are rotated to the pseudo Earth-fixed frame
+// (SpiceTeme.h), by Greenwich mean sidereal time (IAU 1982), with UT1 taken
+// as UTC, and no polar motion.  SPK targets' states are in whichever
+// Earth-fixed frame is named.
+//
+// Threading:
+// Predict() belongs on the game thread: it needs the leapseconds table
+// (SpiceTime.h), and the SPK overload calls CSPICE.  The work is spread
+// across worker threads within it.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePasses.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceSgp4.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Passes
+{
+    struct FStation
+    {
+        // Geodetic, on the ellipsoid in FSettings
+        FSAngle Latitude;
+        FSAngle Longitude;
+        FSDistance Altitude;
+
+        // Passes are when a satellite is above this
+        FSAngle MinimumElevation;
+    };
+
+    struct FPass
+    {
+        // Indices in the stations and the satellites (or targets)
+        int32 Station = INDEX_NONE;
+        int32 Satellite = INDEX_NONE;
+
+        FSEphemerisTime Rise;
+        FSEphemerisTime Culmination;
+        FSEphemerisTime Set;
+        FSAngle MaximumElevation;
+    };
+
+    struct FSettings
+    {
+        // Sampling step.  Each step is searched for peaks, so a pass shorter
+        // than the step is still found, but the step should be well under a
+        // quarter of the shortest orbital period.
+        FSEphemerisPeriod Step = FSEphemerisPeriod(60.);
+
+        // The stations' ellipsoid (WGS-84)
+        FSDistance EquatorialRadius = FSDistance(6378.137);
+        double Flattening = 1. / 298.257223563;
+    };
+
+    // Every pass of every satellite in Satellites over every station, from
+    // et to etEnd, sorted by rise time.  Satellites that fail to propagate
+    // (e.g. decayed) end any pass in progress at the last step they
+    // propagated.
+    SPICE_API bool Predict(
+        const Sgp4::FTleBatch& Satellites,
+        TConstArrayView<FStation> Stations,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        TArray<FPass>& Passes,
+        const FSettings& Settings = FSettings(),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // The same, for SPK targets, from spkezr relative to "EARTH" in
+    // EarthFixedFrame (e.g. ITRF93, or IAU_EARTH).
+    SPICE_API bool Predict(
+        TConstArrayView<FString> Targets,
+        const FString& EarthFixedFrame,
+        TConstArrayView<FStation> Stations,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        TArray<FPass>& Passes,
+        const FSettings& Settings = FSettings(),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    enum class EPassOrder : uint8
+    {
+        Rise,
+        Station,            // then by rise
+        Satellite,          // then by rise
+        MaximumElevation,   // highest first
+        Duration            // longest first
+    };
+
+    SPICE_API void Sort(TArrayView<FPass> Passes, EPassOrder Order);
+};
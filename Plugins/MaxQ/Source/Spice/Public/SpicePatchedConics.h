@@ -0,0 +1,197 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePatchedConics.h
+//
+// API Comments
+//
+// Purpose:  Patched-conic trajectories across spheres of influence
+//
+// A patched-conic trajectory is a chain of two-body legs.  Each leg is a
+// conic about the one body whose sphere of influence (SOI) the vehicle is
+// in.  At each SOI crossing, the state is re-referenced to the new body and
+// a new conic is started.
+//
+// FTrajectory::Build() does all of the expensive work once: it samples the
+// bodies' ephemerides from SPK, finds each SOI crossing by scanning and
+// bisecting against them, and keeps each leg's elements in an
+// FConicBatch.  Evaluate() is then a binary search for the leg plus one
+// conic evaluation, with no CSPICE calls.  The batch Evaluate() is for
+// previews and trails, and runs across worker threads.
+//
+// Systems:
+// An FSystem is a tree of bodies, with one root (e.g. the Sun, whose SOI is
+// unbounded).  Every other body has a parent and an SOI radius.  AddBody()
+// fills a body in from the kernel pool and SPK: its GM from a PCK, and its
+// SOI from Laplace's approximation, a * (GM / GM_parent)^(2/5), with the
+// body's osculating semi-major axis about its parent.
+//
+// Only SOI crossings end a leg.  Impacts, maneuvers and perturbations
+// aren't modeled (see SpicePropagator.h for those).
+//
+// States are in the system's frame, which must be inertial.
+//
+// Threading:
+// An FTrajectory may be evaluated from any thread, and concurrently, as long
+// as nothing is building it.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePatchedConics.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceConics.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::PatchedConics
+{
+    struct FBody
+    {
+        // SPK body name or ID
+        FString Name;
+        FSMassConstant GM;
+        // Ignored for the root
+        FSDistance SphereOfInfluence;
+        // Index of the body this one orbits, INDEX_NONE for the root
+        int32 Parent = INDEX_NONE;
+    };
+
+    struct FSystem
+    {
+        FString Frame = TEXT("J2000");
+        // Parents come before their children, so the root is Bodies[0]
+        TArray<FBody> Bodies;
+
+        // Index of the body with this name, or INDEX_NONE
+        int32 Find(const FString& name) const
+        {
+            return Bodies.IndexOfByPredicate([&](const FBody& Body) { return Body.Name.Equals(name, ESearchCase::IgnoreCase); });
+        }
+    };
+
+    // Appends name to System, orbiting parent (which must already be in
+    // System), or as the root if parent is empty.  The SOI comes from the
+    // body's osculating orbit about parent at et.
+    SPICE_API bool AddBody(
+        FSystem& System,
+        const FString& name,
+        const FString& parent,
+        const FSEphemerisTime& et,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    struct FLeg
+    {
+        FSEphemerisTime Begin;
+        // Index of the central body in the system
+        int32 Body = INDEX_NONE;
+        // Osculating elements about Body, at Begin
+        FSConicElements Elements;
+    };
+
+    struct FSettings
+    {
+        // The SOI scan steps by the time to the nearest boundary at the
+        // current closing speed, times StepFactor, within [MinStep, MaxStep].
+        // Closing speeds change along a conic, so it's less than one.
+        double StepFactor = 0.5;
+        FSEphemerisPeriod MinStep = FSEphemerisPeriod(1.);
+        FSEphemerisPeriod MaxStep = FSEphemerisPeriod(86400.);
+
+        // Crossing times are bisected to within this
+        FSEphemerisPeriod Tolerance = FSEphemerisPeriod(1e-3);
+
+        // Spacing of the bodies' ephemeris samples, which are Hermite-
+        // interpolated.  It should be well under the fastest moon's period.
+        FSEphemerisPeriod EphemerisStep = FSEphemerisPeriod(3600.);
+
+        int32 MaxLegs = 64;
+    };
+
+    class SPICE_API FTrajectory
+    {
+    public:
+        // Builds the trajectory of State, relative to System.Bodies[body], from
+        // et forward to etEnd.  Any previous trajectory is discarded, even on
+        // failure.
+        bool Build(
+            const FSystem& System,
+            int32 body,
+            const FSStateVector& State,
+            const FSEphemerisTime& et,
+            const FSEphemerisTime& etEnd,
+            const FSettings& Settings = FSettings(),
+            ES_ResultCode* ResultCode = nullptr,
+            FString* ErrorMessage = nullptr
+        );
+
+        int32 NumLegs() const { return Legs.Num(); }
+        const FLeg& GetLeg(int32 Index) const { return Legs[Index]; }
+        FSEphemerisTime Begin() const { return FSEphemerisTime(First); }
+        FSEphemerisTime End() const { return FSEphemerisTime(Last); }
+
+        // Index of the leg that's flying at et
+        int32 FindLeg(const FSEphemerisTime& et) const;
+
+        // State at et relative to the system's root.  et must be within
+        // [Begin(), End()].
+        bool Evaluate(const FSEphemerisTime& et, FSStateVector& State, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // State at et relative to the leg's central body, whose index is
+        // returned in Body
+        bool EvaluateLocal(const FSEphemerisTime& et, FSStateVector& State, int32& Body, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+        // As above, at each of ets, in any order.  The outputs must be sized
+        // to ets.Num().  Returns false if any of ets is outside the
+        // trajectory; those states are left unchanged, and their Bodies are
+        // INDEX_NONE.
+        bool Evaluate(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+        bool EvaluateLocal(TConstArrayView<FSEphemerisTime> ets, TArrayView<FSStateVector> States, TArrayView<int32> Bodies, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+    private:
+        void Reset();
+
+        // Build's work, which may leave a partial trajectory on failure
+        bool BuildLegs(
+            const FSystem& System,
+            int32 body,
+            const FSStateVector& State,
+            const FSEphemerisTime& et,
+            const FSEphemerisTime& etEnd,
+            const FSettings& Settings,
+            ES_ResultCode* ResultCode,
+            FString* ErrorMessage
+        );
+
+        // Fills Indices with each et's leg, returning the first et outside
+        // the trajectory (or INDEX_NONE)
+        int32 Lookup(TConstArrayView<FSEphemerisTime> ets, TArray<int32>& Indices) const;
+        void BodyState(int32 body, double et, double* state) const;
+
+        TArray<FLeg> Legs;
+        TArray<double> LegBegin;
+        Conics::FConicBatch Orbits;
+        double First = 0.;
+        double Last = 0.;
+
+        // Each body's state relative to the root, sampled every Step from
+        // First.  Body-major, then node, then state.
+        int32 NumBodies = 0;
+        int32 NumNodes = 0;
+        double Step = 1.;
+        TArray<double> Nodes;
+    };
+};
@@ -0,0 +1,243 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpicePropagator.h
+//
+// API Comments
+//
+// Purpose:  Numerical orbit propagation with perturbations
+//
+// prop2b and conics only model two-body motion.  Propagate() integrates the
+// equations of motion numerically, under a force model of:
+// * The central body's point mass
+// * Its zonal harmonics, J2 through J6, about its pole, or else a full
+//   spherical-harmonic field (see SpiceGravity.h) in its body-fixed frame
+// * Point-mass third bodies (the Moon and Sun, for an Earth orbiter)
+// * Drag, through an exponential atmosphere that co-rotates with the body
+//
+// LoadForceModel() fills in the gravity terms and the body's orientation from
+// the kernel pool: GM from a PCK (e.g. gm_de431.tpc), J2..J6 and the
+// reference radius from BODYnnn_J2.. and BODYnnn_ER (e.g. geophysical.ker),
+// and the pole, orientation and spin from the body's PCK orientation.  Drag
+// parameters, and any gravity field, are the caller's.
+//
+// Third-body positions come from SPK, but not once per force evaluation.
+// Each call samples every third body once per EphemerisStep over the span it
+// will integrate, on the calling thread, and interpolates the samples (cubic
+// Hermite, from the positions and velocities).  All of the integration runs
+// without CSPICE, so the batch Propagate() runs vehicles in parallel.
+//
+// Integrators:
+// * DormandPrince853 - Dormand & Prince's adaptive 8th order Runge-Kutta,
+//   with 5th and 3rd order error estimates (Hairer's DOP853).  Output
+//   epochs are interpolated from its 7th order dense output, so they don't
+//   constrain the step size.
+// * GaussJackson8 - 8th order Gauss-Jackson, a fixed-step predictor-
+//   corrector (Berry & Healy, 2004).  About two force evaluations per step,
+//   against DOP853's twelve, so it's the faster choice for long, smooth
+//   arcs.  It starts up with DOP853, and outputs between its steps are
+//   DOP853 steps from the nearest earlier one.
+//
+// Maneuvers are impulsive velocity changes, applied at their epochs.
+//
+// PropagateTransition() also integrates the variational equations, for the
+// state transition matrix of a propagation under the full force model (see
+// SpiceCovariance.h).  It always uses DormandPrince853.
+//
+// WriteSpk() saves a propagated trajectory as an SPK (type 13, Hermite)
+// segment, so it can be furnsh'ed and used by anything that reads SPK.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpicePropagator.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceCovariance.h"
+#include "SpiceGravity.h"
+#include "Containers/ArrayView.h"
+#include "Templates/SharedPointer.h"
+
+namespace MaxQ::Propagator
+{
+    enum class EIntegrator : uint8
+    {
+        DormandPrince853,
+        GaussJackson8
+    };
+
+    struct FThirdBody
+    {
+        // SPK body name or ID
+        FString Name;
+        FSMassConstant GM;
+    };
+
+    struct FForceModel
+    {
+        static constexpr int32 MaxZonalDegree = 6;
+
+        // States are relative to Center, in Frame (which must be inertial)
+        FString Center = TEXT("EARTH");
+        FString Frame = TEXT("J2000");
+        FSMassConstant GM;
+
+        // Unnormalized zonal coefficients, J[n] being Jn (J[0] and J[1]
+        // are unused), about Pole.  Zero terms are skipped.
+        double J[MaxZonalDegree + 1] = {};
+        FSDistance ReferenceRadius;
+        FSDimensionlessVector Pole = FSDimensionlessVector(0., 0., 1.);
+
+        // A spherical-harmonic field, which replaces the zonal terms while
+        // it's set.  Its terms from degree 1 are added to the point mass.
+        // Orientation rotates Frame to the field's body-fixed frame at
+        // OrientationEpoch, from which the body turns at AtmosphereRotation.
+        TSharedPtr<const Gravity::FGravityField> GravityField;
+        FSRotationMatrix Orientation;
+        FSEphemerisTime OrientationEpoch;
+
+        TArray<FThirdBody> ThirdBodies;
+
+        // Spacing of the third-body ephemeris samples
+        FSEphemerisPeriod EphemerisStep = FSEphemerisPeriod(3600.);
+
+        // Drag, off while BallisticCoefficient is zero.  Density falls off
+        // exponentially with altitude above ReferenceRadius:
+        //   AtmosphereDensity * exp(-(altitude - AtmosphereAltitude) / ScaleHeight)
+        // Cd * A / m, in m^2/kg
+        double BallisticCoefficient = 0.;
+        // kg/m^3
+        double AtmosphereDensity = 0.;
+        FSDistance AtmosphereAltitude;
+        FSDistance ScaleHeight;
+        // The body's spin, in Frame, which the atmosphere moves with
+        FSAngularVelocity AtmosphereRotation;
+    };
+
+    struct FSettings
+    {
+        EIntegrator Integrator = EIntegrator::DormandPrince853;
+
+        // DormandPrince853 local error control.  Per step, the error in each
+        // component stays under AbsoluteTolerance (km, km/s) +
+        // RelativeTolerance * |component|.  GaussJackson8 iterates its
+        // corrector to RelativeTolerance.
+        double RelativeTolerance = 1e-11;
+        double AbsoluteTolerance = 1e-9;
+
+        // DormandPrince853's largest step, or zero for no limit
+        FSEphemerisPeriod MaxStep;
+
+        // GaussJackson8's step
+        FSEphemerisPeriod FixedStep = FSEphemerisPeriod(60.);
+
+        // Per vehicle, per call
+        int32 MaxSteps = 1000000;
+    };
+
+    struct FManeuver
+    {
+        FSEphemerisTime et;
+        FSVelocityVector dv;
+    };
+
+    // Fills in Model's gravity terms and orientation for center, and the
+    // third bodies' GMs.  Zonal terms that aren't in the kernel pool are
+    // zero.  The pole, orientation and spin are evaluated at et, and ignored
+    // if center has no PCK orientation.
+    SPICE_API bool LoadForceModel(
+        const FString& center,
+        const FString& frame,
+        const FSEphemerisTime& et,
+        TConstArrayView<FString> thirdBodies,
+        FForceModel& Model,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Propagates State from et to each of ets, which must be in order,
+    // moving away from et (ascending to propagate forwards, descending to
+    // propagate backwards).  States must be sized to ets.Num().  Maneuvers
+    // must be in ascending order, between et and the last of ets, and
+    // need forward propagation.  A state at a maneuver's epoch includes it.
+    SPICE_API bool Propagate(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        TConstArrayView<FManeuver> Maneuvers = {},
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Advances every state, in place, from et to etEnd, integrating the
+    // vehicles in parallel.  Returns false if any of them fails (too many
+    // steps, or the step size underflowed); those are left unchanged.
+    SPICE_API bool Propagate(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        TArrayView<FSStateVector> States,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // As Propagate(), with the state transition matrices from et as well:
+    // Transitions[i] is d(States[i])/d(State).  Transitions must be sized to
+    // ets.Num().  Step sizes are controlled on the states alone.
+    SPICE_API bool PropagateTransition(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        const FSStateVector& State,
+        const FSEphemerisTime& et,
+        TConstArrayView<FSEphemerisTime> ets,
+        TArrayView<FSStateVector> States,
+        TArrayView<Covariance::FStateMatrix> Transitions,
+        TConstArrayView<FManeuver> Maneuvers = {},
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // As the batch Propagate(), setting each of Transitions (sized to
+    // States.Num()) to its state's transition matrix from et to etEnd.
+    SPICE_API bool PropagateTransition(
+        const FForceModel& Model,
+        const FSettings& Settings,
+        TArrayView<FSStateVector> States,
+        TArrayView<Covariance::FStateMatrix> Transitions,
+        const FSEphemerisTime& et,
+        const FSEphemerisTime& etEnd,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Writes body's states (relative to center, in frame) as an SPK type 13
+    // segment, appending to file if it exists.  ets must be ascending, with
+    // at least (degree + 1) / 2 of them; degree is odd, from 1 to 15.
+    SPICE_API bool WriteSpk(
+        const FString& file,
+        const FString& body,
+        const FString& center,
+        const FString& frame,
+        TConstArrayView<FSEphemerisTime> ets,
+        TConstArrayView<FSStateVector> States,
+        const FString& segmentId = TEXT("MaxQ propagation"),
+        int32 degree = 7,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
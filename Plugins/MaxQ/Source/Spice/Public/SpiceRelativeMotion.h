@@ -0,0 +1,107 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceRelativeMotion.h
+//
+// API Comments
+//
+// Purpose:  Linearized relative motion of deputies about a chief
+//
+// Formation flying and rendezvous scenes have many deputies close to one
+// chief.  Propagating each deputy's inertial state and subtracting the
+// chief's loses the small separation in the large positions, and repeats
+// the same Kepler solve for every vehicle.  Here deputies live in the
+// chief's LVLH frame, and are propagated with closed-form solutions of the
+// linearized two-body relative motion:
+// * ClohessyWiltshire - Clohessy & Wiltshire (1960), for a circular chief.
+//   An eccentric chief's orbit is treated as circular, at its mean motion.
+// * YamanakaAnkersen - Yamanaka & Ankersen (2002), for an elliptic chief,
+//   from the Tschauner-Hempel equations.
+// Both are linear, so a propagation is one 6x6 matrix for the whole
+// formation, applied to each deputy.
+//
+// The chief's state comes from wherever it's known (spkezr, conics, or
+// Conics::FConicBatch), as an inertial state about the primary.
+//
+// LVLH (Hill, or RSW) frame:
+// * x is radial, away from the primary, along the chief's position
+// * z is along the chief's orbital angular momentum
+// * y completes the frame: along track, in the direction of motion
+// Relative velocities are rates in the rotating frame, so a deputy that
+// stays put relative to the chief has zero velocity.  The frame rotates at
+// the chief's orbital rate, |h| / r^2, about z.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceRelativeMotion.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceCovariance.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::RelativeMotion
+{
+    enum class EModel : uint8
+    {
+        ClohessyWiltshire,
+        YamanakaAnkersen
+    };
+
+    // Each deputy's inertial state (in the chief's frame and about the same
+    // primary) to its state relative to the chief, in LVLH.  Relative must
+    // be sized to Deputies.Num(), and may be the same array.
+    SPICE_API bool ToLvlh(
+        const FSStateVector& Chief,
+        TConstArrayView<FSStateVector> Deputies,
+        TArrayView<FSStateVector> Relative,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // The inverse of ToLvlh
+    SPICE_API bool FromLvlh(
+        const FSStateVector& Chief,
+        TConstArrayView<FSStateVector> Relative,
+        TArrayView<FSStateVector> Deputies,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // The relative-motion state transition matrix, from the LVLH frame of
+    // Chief to the LVLH frame of the chief dt later.  The chief's orbit
+    // must be elliptic (or circular).
+    SPICE_API bool Transition(
+        const FSStateVector& Chief,
+        const FSMassConstant& mu,
+        const FSEphemerisPeriod& dt,
+        Covariance::FStateMatrix& Phi,
+        EModel Model = EModel::YamanakaAnkersen,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Propagates each relative state by dt.  Propagated must be sized to
+    // Relative.Num(), and may be the same array.
+    SPICE_API bool Propagate(
+        const FSStateVector& Chief,
+        const FSMassConstant& mu,
+        const FSEphemerisPeriod& dt,
+        TConstArrayView<FSStateVector> Relative,
+        TArrayView<FSStateVector> Propagated,
+        EModel Model = EModel::YamanakaAnkersen,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
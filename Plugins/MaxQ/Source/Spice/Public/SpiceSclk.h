@@ -0,0 +1,70 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSclk.h
+//
+// API Comments
+//
+// Purpose:  Native spacecraft clock (SCLK) conversions
+//
+// A type 1 SCLK kernel describes a clock as partitions (resets) and a table
+// of (ticks, parallel time, rate) coefficients.  The first conversion for a
+// clock reads those tables from the kernel pool and compiles them into a
+// model; after that conversions are a binary search plus a multiply-add,
+// with no CSPICE calls.  Any change to the kernel pool discards all models,
+// and they're rebuilt on next use.
+//
+// Results match sce2c_c/sct2e_c/scencd_c/scs2e_c.  Only type 1 clocks are
+// supported, and the string parser accepts the common subset of the SCLK
+// string syntax:
+//   [partition/]field[delimiter field]...
+// where each field is an unsigned integer and each delimiter is one of
+// '.', ':', '-', ',' or ' '.  Anything else returns false; use scencd or
+// scs2e for the full grammar.
+//
+// Threading:
+// Models are read from the kernel pool on the game thread only.  Other
+// threads may call any conversion, but only for clocks that have already
+// been used on the game thread since the last kernel pool change.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSclk.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+#include "Containers/StringView.h"
+
+namespace MaxQ::Sclk
+{
+    // True if a type 1 SCLK kernel for clock sc (a NAIF spacecraft ID) is loaded.
+    SPICE_API bool HasClock(int sc);
+
+    // ET <-> continuous encoded SCLK (sce2c/sct2e)
+    SPICE_API bool EtToTicks(int sc, const FSEphemerisTime& et, double& sclkdp, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TicksToEt(int sc, double sclkdp, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // SCLK string -> encoded SCLK (scencd)
+    SPICE_API bool StrToTicks(int sc, FStringView sclkch, double& sclkdp, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // SCLK string -> ET (scs2e)
+    SPICE_API bool StrToEt(int sc, FStringView sclkch, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Batched conversions.  Outputs must be sized to match the inputs.
+    // Large batches are split across worker threads.  Returns false if any
+    // entry is outside the clock's coverage; those entries are left unchanged.
+    SPICE_API bool EtToTicks(int sc, TConstArrayView<FSEphemerisTime> et, TArrayView<double> sclkdp, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TicksToEt(int sc, TConstArrayView<double> sclkdp, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+};
@@ -0,0 +1,159 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSgp4.h
+//
+// API Comments
+//
+// Purpose:  SGP4/SDP4 propagation of whole TLE catalogs
+//
+// evsgp4_c initializes the SGP4 model from its TLE (xxsgp4i), then
+// propagates it (xxsgp4e), on every call.  FTleBatch does the initialization
+// once per TLE, when the TLE is added, and keeps each satellite's model as a
+// structure of arrays.  Evaluating the batch at an epoch is then one pass
+// over the arrays, with no CSPICE calls:
+// * Near-Earth satellites (periods under 225 minutes) are propagated four at
+//   a time, in SIMD registers.
+// * Deep-space satellites (SDP4: lunar-solar perturbations, and the 12 and
+//   24 hour resonances) are propagated one at a time.
+// Both are split across worker threads.
+//
+// Results match evsgp4_c, with the same element conventions (getelm), the
+// same geophysical constants (getgeophs) and the same opmode.  States are in
+// TEME, km and km/s, relative to the Earth's center.
+//
+// Threading:
+// An FTleBatch may be evaluated from any thread, and concurrently, as long
+// as nothing is adding to it.  Adding needs the epoch's UTC, from the
+// leapseconds table (SpiceTime.h), so it belongs on the game thread.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSgp4.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Sgp4
+{
+    // Why a satellite couldn't be propagated, as evsgp4_c's errors
+    enum class EError : uint8
+    {
+        None,
+        MeanMotion,             // SPICE(BADMEANMOTION)
+        MeanEccentricity,       // SPICE(BADMECCENTRICITY)
+        MeanSemiMajorAxis,      // SPICE(BADMSEMIMAJOR)
+        PerturbedEccentricity,  // SPICE(BADPECCENTRICITY)
+        SemiLatusRectum,        // SPICE(BADSEMILATUS)
+        Decayed                 // SPICE(ORBITDECAY)
+    };
+
+    SPICE_API const TCHAR* ToString(EError Error);
+
+    class SPICE_API FTleBatch
+    {
+    public:
+        // WGS-72, as in the geophysical.ker that ships with the SPICE toolkit
+        FTleBatch();
+
+        // Constants as from getgeophs: J2, J3, J4, KE, QO, SO, ER, AE
+        explicit FTleBatch(const FSTLEGeophysicalConstants& geophs);
+
+        void Reset();
+        void Reserve(int32 Count);
+        int32 Num() const { return NumSatellites; }
+
+        // Adds a satellite, from getelm's elements.  Returns false, and
+        // doesn't add it, for elements evsgp4_c would reject (suborbital), or
+        // if there's no leapseconds kernel.
+        bool Add(const FSTwoLineElements& Elements, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Adds all of the satellites, or none of them if any is rejected.
+        bool Add(TConstArrayView<FSTwoLineElements> Elements, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // The same, from elements stored end to end, NumElements per
+        // satellite, in FSTwoLineElements' order.  If Added is given (sized
+        // to the satellites), rejected satellites are skipped and flagged
+        // false instead, and the rest are added.
+        static constexpr int32 NumElements = 10;
+        bool Add(TConstArrayView<double> Elements, TArrayView<bool> Added = {}, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Whether satellite i uses the deep-space (SDP4) model
+        bool IsDeepSpace(int32 i) const { return Slots[i] < 0; }
+
+        // Satellite i's perigee and apogee radii (km), from its mean
+        // semi-major axis and eccentricity at epoch
+        void GetPerigeeApogee(int32 i, double& Perigee, double& Apogee) const;
+
+        // States of every satellite at et.  States must be sized to Num(),
+        // and Errors either the same, or empty.  Returns false if any
+        // satellite fails (Errors says which, and why); those entries are left
+        // unchanged.
+        bool Evaluate(const FSEphemerisTime& et, TArrayView<FSStateVector> States, TArrayView<EError> Errors = {}, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr) const;
+
+    private:
+        struct FDeepSpace
+        {
+            // As for near-Earth satellites
+            double Epoch, Mo, Mdot, Argpo, Argpdot, Nodeo, Nodedot, Nodecf;
+            double Ecco, Inclo, No, Bstar, Cc1, Cc4, T2cof;
+
+            // Lunar-solar periodics (dpper)
+            double E3, Ee2, Se2, Se3, Sgh2, Sgh3, Sgh4, Sh2, Sh3, Si2, Si3, Sl2, Sl3, Sl4;
+            double Xgh2, Xgh3, Xgh4, Xh2, Xh3, Xi2, Xi3, Xl2, Xl3, Xl4, Zmol, Zmos;
+
+            // Lunar-solar secular rates, and the resonance terms (dspace)
+            double Dedt, Didt, Dmdt, Dnodt, Domdt, Gsto;
+            double Del1, Del2, Del3, D2201, D2211, D3210, D3222, D4410, D4422, D5220, D5232, D5421, D5433;
+            double Xfact, Xlamo;
+
+            // 0: none, 1: 24 hour (synchronous), 2: 12 hour (Molniya)
+            int32 Irez;
+        };
+
+        // One satellite's near-Earth model, before it's split into the arrays
+        struct FNearEarth;
+
+        bool Initialize(const double* e, double EpochJdUtc, FNearEarth& Near, FDeepSpace& Deep, bool& bDeep, FString& Error) const;
+        void Append(const FNearEarth& Near, const FDeepSpace& Deep, bool bDeep);
+
+        // Near-Earth slots Slot..Slot+3 in SIMD lanes, or Slot alone
+        template<typename T>
+        void PropagateNear(int32 Slot, double et, T (&State)[6], T& Error) const;
+
+        EError PropagateDeep(const FDeepSpace& Satellite, double et, double (&State)[6]) const;
+
+        // J2, J3/J2, J4, KE, ER
+        double J2 = 0., J3oJ2 = 0., J4 = 0., Ke = 0., Er = 0.;
+
+        int32 NumSatellites = 0;
+
+        // Satellite i is near-Earth satellite Slots[i], or deep-space
+        // satellite -1 - Slots[i]
+        TArray<int32> Slots;
+
+        // Near-Earth models, by slot, and the satellite in each slot
+        TArray<int32> NearIndices;
+        TArray<double> Epoch, Mo, Mdot, Argpo, Argpdot, Nodeo, Nodedot, Nodecf;
+        TArray<double> Ecco, Inclo, No, Ao, Bstar;
+        TArray<double> Cc1, Cc4, Cc5, T2cof, T3cof, T4cof, T5cof;
+        TArray<double> Omgcof, Xmcof, Eta, Delmo, Sinmao, D2, D3, D4;
+        TArray<double> Aycof, Xlcof, Con41, X1mth2, X7thm1;
+
+        // Deep-space models, by slot, and the satellite in each slot
+        TArray<FDeepSpace> DeepSatellites;
+        TArray<int32> DeepIndices;
+    };
+};
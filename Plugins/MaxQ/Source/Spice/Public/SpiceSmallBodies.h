@@ -0,0 +1,114 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceSmallBodies.h
+//
+// API Comments
+//
+// Purpose:  Small-body catalogs (asteroids, comets) as conic batches
+//
+// The numbered-asteroid catalog is over 600,000 orbits, far too many for an
+// FSConicElements and a conics_c call each.  An FCatalog keeps each body's
+// orbit in an FConicBatch (see SpiceConics.h), with its name and absolute
+// magnitude alongside in flat arrays.
+//
+// Sources:
+// * LoadMpcorb() streams the Minor Planet Center's MPCORB.DAT format (or
+//   any extract of it, e.g. NEA.txt) from disk, a block at a time, without
+//   holding the file in memory.
+// * ImportDataTable() reads a UDataTable of JPL Small-Body Database rows,
+//   such as Content/Spice/Simple/csv/SmallBodies_TABLE.
+//
+// Both sets of elements are heliocentric, in ecliptic J2000.
+//
+// UMaxQSmallBodiesComponent (MaxQSmallBodiesComponent.h) draws a catalog as
+// mesh instances.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceSmallBodies.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceConics.h"
+#include "Containers/ArrayView.h"
+#include "Containers/StringView.h"
+#include <limits>
+
+class UDataTable;
+
+namespace MaxQ::SmallBodies
+{
+    // The Sun's GM (DE440), km^3/s^2
+    constexpr double SunGM = 132712440041.279419;
+
+    class SPICE_API FCatalog
+    {
+    public:
+        // The frame of the orbits' elements
+        FString Frame = TEXT("ECLIPJ2000");
+        Conics::FConicBatch Orbits;
+
+        int32 Num() const { return Orbits.Num(); }
+        void Reset();
+
+        // Adds a body.  Returns false, and doesn't add it, if the batch
+        // rejects its orbit.
+        bool Add(const FSConicElements& Orbit, FStringView Name, float AbsoluteMagnitude, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        FStringView GetName(int32 Index) const { return FStringView(&Names[NameOffsets[Index]], NameOffsets[Index + 1] - NameOffsets[Index]); }
+
+        // H.  Bodies that came without one have UnknownMagnitude (NaN, as
+        // H = 0 is a real magnitude).
+        float GetAbsoluteMagnitude(int32 Index) const { return AbsoluteMagnitudes[Index]; }
+        bool HasAbsoluteMagnitude(int32 Index) const { return !FMath::IsNaN(AbsoluteMagnitudes[Index]); }
+        static constexpr float UnknownMagnitude = std::numeric_limits<float>::quiet_NaN();
+
+        // Indices of the bodies no fainter than maxMagnitude, and those of
+        // unknown magnitude, in order
+        void Select(float maxMagnitude, TArray<int32>& Indices) const;
+
+    private:
+        // Every name, end to end; body i's is [NameOffsets[i], NameOffsets[i + 1])
+        TArray<TCHAR> Names;
+        TArray<int32> NameOffsets = { 0 };
+        TArray<float> AbsoluteMagnitudes;
+    };
+
+    // Appends each orbit in file, in MPCORB.DAT's fixed columns, to
+    // Catalog.  Lines that aren't orbits (the header, blank lines) are
+    // skipped, as are bodies fainter than maxMagnitude.  Epochs are TT,
+    // taken as TDB (they differ by under 2 ms).
+    SPICE_API bool LoadMpcorb(
+        const FString& file,
+        FCatalog& Catalog,
+        float maxMagnitude = TNumericLimits<float>::Max(),
+        const FSMassConstant& GM = FSMassConstant(SunGM),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Appends each row of Table to Catalog.  Rows are JPL Small-Body Database
+    // fields: e, q (AU), i, om, w and ma (degrees), epoch (JD TDB), and
+    // optionally full_name and H.  Field names match without regard to case,
+    // or to a Blueprint struct's decorations.  Rows with an invalid orbit are
+    // skipped.
+    SPICE_API bool ImportDataTable(
+        const UDataTable* Table,
+        FCatalog& Catalog,
+        const FSMassConstant& GM = FSMassConstant(SunGM),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
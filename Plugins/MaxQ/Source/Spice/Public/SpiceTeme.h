@@ -0,0 +1,110 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTeme.h
+//
+// API Comments
+//
+// Purpose:  Batched frame changes for SGP4's TEME states
+//
+// evsgp4_c, and FTleBatch (SpiceSgp4.h), return states in TEME (true
+// equator, mean equinox), which isn't a SPICE frame, so pxform/sxform can't
+// convert them.  And the rotation out of TEME depends only on the time, not
+// the satellite, so it's wasted work per satellite anyway.  Instead:
+// 1. ToFrame() gives the 6x6 state transformation from TEME to a frame, at
+//    an epoch, once.
+// 2. Transform() applies it to a whole array of states, such as an
+//    FTleBatch's output, in place.  The products run on SIMD registers, and
+//    large arrays are split across worker threads.
+//
+// Evaluate() does both, for an FTleBatch.  FromFrame() goes the other way,
+// e.g. to turn states into SGP4 elements.
+//
+// Frames:
+// * "J2000": IAU 1976 precession, IAU 1980 nutation (no corrections), and
+//   the equation of the equinoxes, as Vallado's teme2eci.
+// * "PEF" (pseudo Earth-fixed): Greenwich mean sidereal time (IAU 1982), as
+//   Vallado's teme2ecef without polar motion.  This needs UT1, which is
+//   taken as UTC unless UT1 - UTC is given.
+// * Anything else SPICE knows (ITRF93, IAU_EARTH, ECLIPJ2000, ...): through
+//   J2000, by sxform, with whatever kernels that needs.
+// * "TEME": no change.
+//
+// Threading:
+// ToFrame() and Evaluate() belong on the game thread, as they use CSPICE
+// and the leapseconds table (SpiceTime.h).  Transform() may be called from
+// any thread.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTeme.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceCovariance.h"
+#include "SpiceSgp4.h"
+#include "Containers/ArrayView.h"
+
+namespace MaxQ::Teme
+{
+    // The state transformation from TEME to J2000 at et
+    SPICE_API void ToJ2000(const FSEphemerisTime& et, Covariance::FStateMatrix& Transform);
+
+    // The state transformation from TEME to pseudo Earth-fixed at et.  Fails
+    // if there's no leapseconds kernel.
+    SPICE_API bool ToPseudoEarthFixed(
+        const FSEphemerisTime& et,
+        Covariance::FStateMatrix& Transform,
+        const FSEphemerisPeriod& Ut1MinusUtc = FSEphemerisPeriod(),
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // The state transformation from TEME to frame at et (see the frames,
+    // above)
+    SPICE_API bool ToFrame(
+        const FSEphemerisTime& et,
+        const FString& frame,
+        Covariance::FStateMatrix& Transform,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // The inverse: the state transformation from frame to TEME at et
+    SPICE_API bool FromFrame(
+        const FSEphemerisTime& et,
+        const FString& frame,
+        Covariance::FStateMatrix& Transform,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Every state, in place, by the same transformation
+    SPICE_API void Transform(const Covariance::FStateMatrix& xform, TArrayView<FSStateVector> States);
+
+    // The same, into Out, which must be sized to In.Num().  Out may be In.
+    SPICE_API void Transform(const Covariance::FStateMatrix& xform, TConstArrayView<FSStateVector> In, TArrayView<FSStateVector> Out);
+
+    // FTleBatch::Evaluate, with the states in frame.  Satellites that fail
+    // are left unchanged, as there.
+    SPICE_API bool Evaluate(
+        const Sgp4::FTleBatch& Satellites,
+        const FSEphemerisTime& et,
+        const FString& frame,
+        TArrayView<FSStateVector> States,
+        TArrayView<Sgp4::EError> Errors = {},
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
@@ -0,0 +1,157 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTime.h
+//
+// API Comments
+//
+// Purpose:  Native time conversions (UTC/TAI/TT/TDB)
+//
+// The leapseconds table (DELTET/* variables from an LSK such as naif0012.tls)
+// is read from the kernel pool once, and re-read only when a kernel pool
+// watcher reports a change.  All conversions after that are plain arithmetic,
+// there's no round trip through the CSPICE time string parser/formatter.
+//
+// Results match str2et_c/et2utc_c (to well under a microsecond), including
+// the UTC seconds "60" shown during a positive leapsecond.  Calendar dates
+// are in the proleptic Gregorian calendar, as in CSPICE's ttrans.
+//
+// Threading:
+// The leapseconds table is refreshed from the kernel pool on the game thread
+// only.  Other threads may call any conversion and will use the most recently
+// loaded table, but must not be the first to use it.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTime.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "Containers/ArrayView.h"
+#include "Containers/StringView.h"
+
+namespace MaxQ::Time
+{
+    // UTC calendar fields.
+    // Second is in [60, 61) during a positive leapsecond.
+    // DayOfYear is an output only; inputs are given by Year, Month, Day.
+    struct FUtcCalendar
+    {
+        int32 Year {2000};
+        int32 Month {1};
+        int32 Day {1};
+        int32 DayOfYear {1};
+        int32 Hour {12};
+        int32 Minute {0};
+        double Second {0.};
+    };
+
+    // True if a leapseconds kernel has been loaded into the kernel pool.
+    SPICE_API bool HasLeapSeconds();
+
+    // Uniform time scales, all given as seconds past J2000 in that scale.
+    // ET is TDB.
+    SPICE_API bool EtToTai(const FSEphemerisTime& et, double& tai, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TaiToEt(double tai, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool EtToTt(const FSEphemerisTime& et, double& tt, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TtToEt(double tt, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // UTC calendar <-> ET
+    SPICE_API bool EtToUtc(const FSEphemerisTime& et, FUtcCalendar& utc, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool UtcToEt(const FUtcCalendar& utc, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Any uniform time scale to any other (unitim), including the Julian date scales
+    SPICE_API bool ConvertTimeScale(double epoch, ES_TimeScale insys, ES_TimeScale outsys, double& out, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Delta ET, ET - UTC, at an epoch given as UTC or ET seconds past J2000 (deltet)
+    SPICE_API bool DeltaEt(double epoch, ES_EpochType eptype, FSEphemerisPeriod& delta, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Batched conversions.  Outputs must be sized to match the inputs.
+    // Large batches are split across worker threads.
+    SPICE_API bool EtToTai(TConstArrayView<FSEphemerisTime> et, TArrayView<double> tai, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TaiToEt(TConstArrayView<double> tai, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool EtToTt(TConstArrayView<FSEphemerisTime> et, TArrayView<double> tt, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool TtToEt(TConstArrayView<double> tt, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool EtToUtc(TConstArrayView<FSEphemerisTime> et, TArrayView<FUtcCalendar> utc, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool UtcToEt(TConstArrayView<FUtcCalendar> utc, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool ConvertTimeScale(TConstArrayView<double> epoch, ES_TimeScale insys, ES_TimeScale outsys, TArrayView<double> out, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+    SPICE_API bool DeltaEt(TConstArrayView<double> epoch, ES_EpochType eptype, TArrayView<FSEphemerisPeriod> delta, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Fast parser for ISO-8601 style UTC strings, calendar or day-of-year:
+    //   2022-03-15T12:34:56.789Z
+    //   2022-074 12:34:56.789 UTC
+    //   2022-03-15
+    // Only years 1583-9999 are accepted, anything else (or any other format)
+    // returns false; use str2et for the full CSPICE grammar.
+    SPICE_API bool ParseUtc(FStringView str, FUtcCalendar& utc);
+
+    // ParseUtc + UtcToEt.
+    SPICE_API bool StrToEt(FStringView str, FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Bulk ingestion.  Returns false if any string failed to parse, entries that
+    // failed are left unchanged.
+    SPICE_API bool StrToEt(TConstArrayView<FString> strs, TArrayView<FSEphemerisTime> et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Same output as et2utc_c (precision is clamped to 0..14, as et2utc does.)
+    SPICE_API bool EtToUtcString(const FSEphemerisTime& et, ES_UTCTimeFormat format, int precision, FString& utcstr, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+    // Formatter for clocks that are redrawn every frame.
+    // The UTC day of the previous call is cached; while time stays within that
+    // day only the hh:mm:ss.fff fields that changed are rewritten, in place,
+    // in an internal buffer.  Nothing is allocated per call.  The output is
+    // the same as EtToUtcString's.
+    // Not thread safe, use one formatter per clock.
+    //
+    //   MaxQ::Time::FUtcFormatter Clock(ES_UTCTimeFormat::ISOCalendar, 3);
+    //   ...
+    //   DrawText(Clock.Update(et));
+    class SPICE_API FUtcFormatter
+    {
+    public:
+        FUtcFormatter(ES_UTCTimeFormat InFormat = ES_UTCTimeFormat::Calendar, int InPrecision = 4);
+
+        void SetFormat(ES_UTCTimeFormat InFormat, int InPrecision);
+        ES_UTCTimeFormat GetFormat() const { return Format; }
+        int GetPrecision() const { return Precision; }
+
+        // Returns the formatted string, which stays valid until the next call.
+        // On failure the string is empty.
+        const TCHAR* Update(const FSEphemerisTime& et, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // The most recent result
+        const TCHAR* operator*() const { return Buffer; }
+        FStringView ToView() const { return FStringView(Buffer, Length); }
+        int32 Len() const { return Length; }
+
+    private:
+        void Invalidate();
+
+        ES_UTCTimeFormat Format;
+        int32 Precision;
+
+        // Calendar decomposition of the previous call
+        uint32 TableGeneration;
+        double LastEt;
+        double DayStartTai;
+        double DayEndTai;
+        int32 TimeOffset;
+        int32 Hour;
+        int32 Minute;
+        int32 Second;
+        int64 Fraction;
+
+        int32 Length;
+        TCHAR Buffer[64];
+    };
+};
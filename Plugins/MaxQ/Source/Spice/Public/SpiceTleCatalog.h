@@ -0,0 +1,138 @@
+// Copyright 2021 Gamergenic.  See full copyright notice in Spice.h.
+// Author: chucknoble@gamergenic.com|https://www.gamergenic.com
+//
+// Project page:   https://www.gamergenic.com/project/maxq/
+// Documentation:  https://maxq.gamergenic.com/
+// GitHub:         https://github.com/Gamergenic1/MaxQ/
+
+//------------------------------------------------------------------------------
+// SpiceTleCatalog.h
+//
+// API Comments
+//
+// Purpose:  Satellite catalogs (TLEs, OMMs) as SGP4 batches
+//
+// getelm parses one TLE, from a pair of strings, per call.  An FCatalog
+// holds a whole catalog (CelesTrak's active satellites, or all ~30,000
+// tracked objects), each satellite's elements already in an FTleBatch (see
+// SpiceSgp4.h), with its catalog number and name alongside in flat arrays.
+//
+// Sources:
+// * LoadCatalog() maps a file into memory and parses every record in
+//   parallel.  Files may be:
+//   * Two-line elements (2LE), or three-line elements (3LE, each TLE
+//     preceded by a name line, optionally starting "0 ").  Lines whose
+//     checksums fail are skipped.
+//   * OMM CSV, as from CelesTrak's FORMAT=CSV queries.  Columns are found by
+//     their header names; their order doesn't matter.
+// * ParseCatalog() parses the same text, already in memory (e.g. the body of
+//   an HTTP response).
+//
+// The elements are as from getelm (radians, minutes, and ET epochs), with
+// two-digit years read as 1957-2056.
+//
+// A loaded file's parsed elements are cached in a binary file, named for the
+// hash of the file's contents, so reloading an unchanged catalog skips
+// parsing altogether.
+//
+// Threading:
+// As for FTleBatch::Add: loading needs the leapseconds table (SpiceTime.h),
+// so it belongs on the game thread.  A loaded catalog may be read, and its
+// batch evaluated, from any thread.
+//
+// MaxQ:
+// * Base API
+// * Refined API
+//    * C++
+//    * Blueprints
+//
+// SpiceTleCatalog.h is part of the "refined C++ API".
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "SpiceTypes.h"
+#include "SpiceSgp4.h"
+#include "Containers/ArrayView.h"
+#include "Containers/StringView.h"
+
+namespace MaxQ::Tle
+{
+    class SPICE_API FCatalog
+    {
+    public:
+        // WGS-72, as FTleBatch
+        FCatalog() {}
+
+        // Constants as from getgeophs, for every satellite
+        explicit FCatalog(const FSTLEGeophysicalConstants& geophs) : Satellites(geophs) {}
+
+        // Satellite i's SGP4 model is Satellites' satellite i
+        Sgp4::FTleBatch Satellites;
+
+        int32 Num() const { return CatalogNumbers.Num(); }
+        void Reset();
+
+        // Adds a satellite.  Returns false, and doesn't add it, if the batch
+        // rejects its elements.
+        bool Add(const FSTwoLineElements& Satellite, int32 CatalogNumber, FStringView Name, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        // Adds satellites from elements stored end to end (as
+        // FTleBatch::Add), skipping those the batch rejects.  Names are end
+        // to end, satellite i's being [SatelliteNameOffsets[i],
+        // SatelliteNameOffsets[i + 1]).  If Added is given (sized to the
+        // number of satellites), Added[i] is whether satellite i was.
+        // Returns false, adding nothing, only if there's no leapseconds
+        // kernel.
+        bool Add(TConstArrayView<double> SatelliteElements, TConstArrayView<int32> SatelliteNumbers, FStringView SatelliteNames, TConstArrayView<int32> SatelliteNameOffsets, TArrayView<bool> Added = {}, ES_ResultCode* ResultCode = nullptr, FString* ErrorMessage = nullptr);
+
+        FStringView GetName(int32 Index) const { return FStringView(&Names[NameOffsets[Index]], NameOffsets[Index + 1] - NameOffsets[Index]); }
+        int32 GetCatalogNumber(int32 Index) const { return CatalogNumbers[Index]; }
+        FSTwoLineElements GetElements(int32 Index) const;
+
+        // The index of the satellite with a NORAD catalog number, or
+        // INDEX_NONE.  If a number was added more than once, the latest.
+        int32 Find(int32 CatalogNumber) const;
+
+    private:
+        // Every satellite's elements, end to end, as FTleBatch::Add
+        TArray<double> Elements;
+        TArray<int32> CatalogNumbers;
+        TMap<int32, int32> Indices;
+
+        // Every name, end to end; satellite i's is [NameOffsets[i], NameOffsets[i + 1])
+        TArray<TCHAR> Names;
+        TArray<int32> NameOffsets = { 0 };
+    };
+
+    // Appends each record in file (2LE, 3LE or OMM CSV) to Catalog.
+    // Malformed records, or ones whose checksums fail, are skipped, as are
+    // satellites the batch rejects.  With bUseCache, the parsed records
+    // are read from, or written to, the cache in Saved/MaxQ/TleCache.
+    SPICE_API bool LoadCatalog(
+        const FString& file,
+        FCatalog& Catalog,
+        bool bUseCache = true,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // Appends each record in Text to Catalog, as LoadCatalog, without a cache.
+    SPICE_API bool ParseCatalog(
+        FAnsiStringView Text,
+        FCatalog& Catalog,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+
+    // As above, also appending to Records the text of each satellite added
+    // to Catalog, in the catalog's order, as views of Text: a TLE's two
+    // lines (without its name line), or an OMM CSV row.
+    SPICE_API bool ParseCatalog(
+        FAnsiStringView Text,
+        FCatalog& Catalog,
+        TArray<FAnsiStringView>& Records,
+        ES_ResultCode* ResultCode = nullptr,
+        FString* ErrorMessage = nullptr
+    );
+};
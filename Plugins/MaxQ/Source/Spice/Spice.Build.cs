@@ -15,7 +15,7 @@ public class Spice : ModuleRules
         PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
         PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine" });
-        PrivateDependencyModuleNames.AddRange(new string[] { "CSpice_Library"});
+        PrivateDependencyModuleNames.AddRange(new string[] { "CSpice_Library", "RenderCore" });
 
         PublicDefinitions.Add("MAXQ_SPICE_MODULE=1");
     }